@@ -820,6 +820,10 @@ CAI::~CAI()
 	// Take us out of the stimulusmgr
 	g_pAIStimulusMgr->RemoveSensingObject( this );
 
+	// Cached paths are kept per AI.
+
+	g_pAIPathMgr->ForgetAI( this );
+
 	if ( m_pState )
 	{
 		AI_FACTORY_DELETE(m_pState);
@@ -7,7 +7,7 @@
 #include "AIRegionMgr.h"
 #include "AIVolumeMgr.h"
 #include "AINodeMgr.h"
-#include "FastHeap.h"
+#include "AIPathPlanner.h"
 #include "ProjectileTypes.h"
 #include "Door.h"
 #include "AIInformationVolumeMgr.h"
@@ -20,20 +20,6 @@
 #define CURVE_MIN_ANGLE_DELTA_FAST 40.f
 
 
-// Functors
-
-struct CompareVolumeDistance
-{
-	// The overloaded () operator should return true if pVolume1 has a higher heap
-	// key than pVolume2. In the case of these Volumes, though, a shorter distance
-	// means a higher heap key, so we are doing a "less than"
-
-	inline bool operator()(const AIVolume* pVolume1, const AIVolume* pVolume2) const
-	{
-		return pVolume1->GetShortestEstimate() < pVolume2->GetShortestEstimate();
-	}
-};
-
 //
 // PATH_INFO
 //
@@ -51,6 +37,126 @@ public:
 	LTBOOL m_bDivergePaths;
 };
 
+//
+// CAIVolumeGraph
+//
+// The volumes as the path planner sees them.
+//
+class CAIVolumeGraph
+{
+public:
+	typedef AIVolume NODE;
+
+	uint32 GetNumNodes() const { return g_pAIVolumeMgr->GetNumVolumes(); }
+	AIVolume* GetNode(uint32 iNode) const { return g_pAIVolumeMgr->GetVolume(iNode); }
+
+	uint32 GetNumNeighbors(AIVolume* pVolume) const { return pVolume->GetNumNeighbors(); }
+	AIVolume* GetNeighbor(AIVolume* pVolume, uint32 iNeighbor) const { return pVolume->GetNeighborByIndex(iNeighbor)->GetVolume(); }
+
+	LTVector GetNodeCenter(AIVolume* pVolume) const { return pVolume->GetCenter(); }
+
+	uint32 GetNodeIndex(AIVolume* pVolume) const { return pVolume->GetPathNodeIndex(); }
+	void SetNodeIndex(AIVolume* pVolume, uint32 iNode) { pVolume->SetPathNodeIndex(iNode); }
+};
+
+class CAIVolumePathPlanner : public CAIPathPlanner<CAIVolumeGraph>
+{
+public:
+	CAIVolumeGraph m_Graph;
+};
+
+//
+// AIVOLUME_PATH_SEARCH
+//
+// What a particular AI is allowed to path through.
+//
+struct AIVOLUME_PATH_SEARCH
+{
+public:
+	bool CanUse(AIVolume* pVolume)
+	{
+		// AI may be resticted to using lower weighted (more preferred) volumes.
+
+		return !( ( m_fMinPathWeight > 0.f ) && ( pVolume->GetPathWeight( LTTRUE, LTFALSE ) > m_fMinPathWeight ) );
+	}
+
+	LTFLOAT GetStepCost(AIVolume* pVolume, const LTVector& vEntry, uint32 iNeighbor, LTVector* pvNeighborEntry)
+	{
+		*pvNeighborEntry = pVolume->GetNeighborByIndex(iNeighbor)->GetConnectionPos();
+		return pVolume->GetPathWeight( m_bIncludeBaseWeight, m_bDivergePaths ) * vEntry.DistSqr(*pvNeighborEntry);
+	}
+
+	bool CanStep(AIVolume* pPreviousVolume, AIVolume* pCurrentVolume, AIVolume* pNeighborVolume)
+	{
+		// Do not path thru disabled volumes.
+
+		if( !pNeighborVolume->IsVolumeEnabled() )
+		{
+			return false;
+		}
+
+		if ( pNeighborVolume->HasDoors() )
+		{
+			// Some AI cannot use doors.
+
+			if( !m_bUseDoors )
+			{
+				return false;
+			}
+
+			// If this is a door volume, make sure the doors aren't locked.
+			// Only consider doors locked if they are not open, and are locked.
+			// LevelDesigners sometimes need to lock doors in the open state.
+
+			for ( uint32 iDoor = 0 ; iDoor < 2 ; iDoor++ )
+			{
+				HOBJECT hDoor = pNeighborVolume->GetDoor(iDoor);
+				if ( hDoor )
+				{
+					Door* pDoor = (Door*)g_pLTServer->HandleToObject(hDoor);
+					if( pDoor->IsLockedForCharacter(m_pAI->m_hObject) &&
+						( pDoor->GetState() != DOORSTATE_OPEN ) )
+					{
+						return false;
+					}
+				}	
+			}
+		}
+
+		// Check special properties of volume.
+
+		if( !pCurrentVolume->CanBuildPathTo( m_pAI, pNeighborVolume ) )
+		{
+			return false;
+		}
+
+		if( !pNeighborVolume->CanBuildPathFrom( m_pAI, pCurrentVolume ) )
+		{
+			return false;
+		}
+
+		if ( !pCurrentVolume->CanBuildPathThrough( m_pAI, pPreviousVolume, pNeighborVolume ) )
+		{
+			return false;
+		}
+
+		return true;
+	}
+
+	CAI* m_pAI;
+	LTBOOL m_bUseDoors;
+	LTBOOL m_bIncludeBaseWeight;
+	LTBOOL m_bDivergePaths;
+	LTFLOAT m_fMinPathWeight;
+};
+
+// Number of volume paths remembered.
+#define PATH_CACHE_SIZE 256
+
+// Flags in a path cache key.
+#define PATH_CACHE_BASE_WEIGHT	0x01
+#define PATH_CACHE_USE_DOORS	0x02
+
 
 // Globals
 
@@ -75,6 +181,10 @@ CAIPathMgr::CAIPathMgr()
 	m_pAIVolumeMgr = debug_new( CAIVolumeMgr );
 	m_pAIInformationVolumeMgr = debug_new( CAIInformationVolumeMgr );
 	m_pAIRegionMgr = debug_new( CAIRegionMgr );
+
+	m_pPathPlanner = debug_new( CAIVolumePathPlanner );
+	m_pPathCache = debug_new1( CAIPathCache, PATH_CACHE_SIZE );
+	m_nPathCacheKnowledgeIndex = 0;
 }
 
 CAIPathMgr::~CAIPathMgr()
@@ -85,6 +195,9 @@ CAIPathMgr::~CAIPathMgr()
 	debug_delete( m_pAIVolumeMgr );
 	debug_delete( m_pAIInformationVolumeMgr );
 	debug_delete( m_pAIRegionMgr );
+
+	debug_delete( m_pPathPlanner );
+	debug_delete( m_pPathCache );
 }
 
 void CAIPathMgr::Term()
@@ -96,6 +209,9 @@ void CAIPathMgr::Term()
 	m_pAIInformationVolumeMgr->Term();
 	m_pAINodeMgr->Term();
 
+	m_pPathPlanner->Term();
+	m_pPathCache->Clear();
+
     m_bInitialized = LTFALSE;
 }
 
@@ -129,6 +245,11 @@ void CAIPathMgr::Load(ILTMessage_Read *pMsg)
 	LOAD_DWORD(m_nPathIndex);
 	LOAD_DWORD(m_nWaypointID);
 	LOAD_DWORD(m_nPathKnowledgeIndex);
+
+	// Volume numbering isn't saved, so the planner starts over.
+
+	m_pPathPlanner->Term();
+	m_pPathCache->Clear();
 }
 
 void CAIPathMgr::Save(ILTMessage_Write *pMsg)
@@ -662,15 +783,6 @@ CAIPathMgr::EnumPathBuildStatus CAIPathMgr::BuildVolumePath(PATH_INFO* pPathInfo
         eStatus = kPath_NoPathFound;
 	}
 
-	// Make sure we're not going to blow the heap
-
-	else if ( g_pAIVolumeMgr->GetNumVolumes() >= 1024 )
-	{
-		Warn( "**** Number of volumes exceed the max count (1024)!  No pathfinding possible! ****" );
-		AIASSERT( 0, pAI->m_hObject, "More than 1024 volumes -- Up the heap size to a new max" );
-		eStatus = kPath_NoPathFound;
-	}
-
 	// Early out if no djikstra's is necessary.
 
 	if( ( eStatus != kPath_Unknown ) && pAI->GetPathKnowledgeMgr() )
@@ -684,37 +796,6 @@ CAIPathMgr::EnumPathBuildStatus CAIPathMgr::BuildVolumePath(PATH_INFO* pPathInfo
 	}
 
 
-	// pq is the priority queue (heap) used for dijkstra's
-
-	CFastHeap<AIVolume, 1024, CompareVolumeDistance> pq;
-
-
-	// Setup all Volumes
-
-	for ( uint32 iVolume = 0 ; iVolume < g_pAIVolumeMgr->GetNumVolumes() ; iVolume++ )
-	{
-		// Initialized values, we know shortest estimate for source Volume is 0
-
-		AIVolume* pVolume = g_pAIVolumeMgr->GetVolume(iVolume);
-
-		if ( pVolume == pPathInfo->m_pSourceVolume )
-		{
-			pVolume->SetShortestEstimate(0.0f);
-			pVolume->SetEntryPosition(pPathInfo->m_vPosition);
-			pVolume->SetWalkthroughPosition(pPathInfo->m_vPosition);
-		}
-		else
-		{
-			pVolume->SetShortestEstimate(FLT_MAX);
-		}
-
-        pVolume->SetPreviousVolume(LTNULL);
-
-		// Add to priority queue
-
-		pq.Push(pVolume);
-	}
-
 	// Some AI cannot open doors.
 
 	LTBOOL bUseDoors = LTTRUE;
@@ -726,11 +807,6 @@ CAIPathMgr::EnumPathBuildStatus CAIPathMgr::BuildVolumePath(PATH_INFO* pPathInfo
 		}
 	}
 
-	// Do djikstra's
-
-//	int32 nPathfindingIterations = 0;
-//	int32 nNeighborTouches = 0;
-
 	AIASSERT( pAI->GetBrain(), pAI->m_hObject, "CAIPathMgr::FindPath: AI is brainless!" );
 	LTFLOAT fMinPathWeight = 0.f;
 	if( pAI->GetBrain() && pAI->GetBrain()->GetAIDataExist( kAIData_MinPathWeight ) )
@@ -738,112 +814,62 @@ CAIPathMgr::EnumPathBuildStatus CAIPathMgr::BuildVolumePath(PATH_INFO* pPathInfo
 		fMinPathWeight = pAI->GetBrain()->GetAIData( kAIData_MinPathWeight );
 	}
 
-	while ( !pq.IsEmpty() )
-	{
-//		nPathfindingIterations++;
-
-		// Extract the Volume on the fringe with the minimum estimate
+	AIVOLUME_PATH_SEARCH search;
+	search.m_pAI = pAI;
+	search.m_bUseDoors = bUseDoors;
+	search.m_bIncludeBaseWeight = ( pAI->GetAwareness() != kAware_Alert );	// AI ignore preferred path weighting when alert.
+	search.m_bDivergePaths = pPathInfo->m_bDivergePaths;
+	search.m_fMinPathWeight = fMinPathWeight;
 
-		AIVolume *pCurrentVolume = pq.Pop();
+	// (Re)number the volumes the first time through, or if any were added.
 
-		// If the highest priority volume already costs more than the shortest known path, this whole path is bogus
+	if( !m_pPathPlanner->IsInitialized() ||
+		( m_pPathPlanner->GetNumNodes() != g_pAIVolumeMgr->GetNumVolumes() ) )
+	{
+		m_pPathPlanner->Init( &m_pPathPlanner->m_Graph );
+		m_pPathCache->Clear();
+	}
 
-		if ( pCurrentVolume->GetShortestEstimate() > pPathInfo->m_pDesinationVolume->GetShortestEstimate() )
-		{
-			continue;
-		}
+	// Anything that invalidates path knowledge (doors, disabled volumes)
+	// invalidates the cached paths too.
 
-		// Relax all the neighbors
+	if( m_nPathCacheKnowledgeIndex != m_nPathKnowledgeIndex )
+	{
+		m_pPathCache->Clear();
+		m_nPathCacheKnowledgeIndex = m_nPathKnowledgeIndex;
+	}
 
-		for ( uint32 iNeighbor = 0 ; iNeighbor < pCurrentVolume->GetNumNeighbors() ; iNeighbor++ )
-		{
-//			nNeighborTouches++;
+	// Diverging paths are randomized, so they're never cached.  Cached paths
+	// were found from wherever the AI stood in the source volume then, which
+	// is close enough.
 
-			AIVolumeNeighbor* pVolumeNeighbor = pCurrentVolume->GetNeighborByIndex(iNeighbor);
-			AIVolume *pNeighborVolume = pVolumeNeighbor->GetVolume();
+	AIPATH_CACHE_KEY key;
+	key.pOwner = pAI;
+	key.iSrc = pPathInfo->m_pSourceVolume ? pPathInfo->m_pSourceVolume->GetPathNodeIndex() : CAIVolumePathPlanner::kInvalidNode;
+	key.iDest = pPathInfo->m_pDesinationVolume->GetPathNodeIndex();
+	key.nFlags = ( search.m_bIncludeBaseWeight ? PATH_CACHE_BASE_WEIGHT : 0 ) | ( bUseDoors ? PATH_CACHE_USE_DOORS : 0 );
+	memcpy( &key.nParam, &fMinPathWeight, sizeof( key.nParam ) );
 
-			// AI may be resticted to using lower weighted (more preferred) volumes.
+	LTBOOL bCache = ( pPathInfo->m_pSourceVolume && !pPathInfo->m_bDivergePaths );
 
-			if( ( fMinPathWeight > 0.f ) && ( pNeighborVolume->GetPathWeight( LTTRUE, LTFALSE ) > fMinPathWeight ) )
+	const std::vector<uint32>* paCachedPath = bCache ? m_pPathCache->Find( key ) : LTNULL;
+	if( paCachedPath )
+	{
+		SetVolumePath( pPathInfo, *paCachedPath );
+	}
+	else
+	{
+		std::vector<uint32> aPath;
+		if( m_pPathPlanner->FindPath( search, pPathInfo->m_pSourceVolume, pPathInfo->m_vPosition, pPathInfo->m_pDesinationVolume ) )
+		{
+			m_pPathPlanner->GetPath( pPathInfo->m_pDesinationVolume, &aPath );
+			if( bCache )
 			{
-				continue;
-			}
-
-			LTVector vNeighborConnection = pVolumeNeighbor->GetConnectionPos();
-
-			// AI ignore preferred path weighting when alert.
-
-            LTFLOAT fDistance = pCurrentVolume->GetShortestEstimate() + ( pCurrentVolume->GetPathWeight( ( pAI->GetAwareness() != kAware_Alert ), pPathInfo->m_bDivergePaths ) * pCurrentVolume->GetEntryPosition().DistSqr(vNeighborConnection) );
-
-			if ( (pNeighborVolume->GetShortestEstimate() > fDistance) && (fDistance < pPathInfo->m_pDesinationVolume->GetShortestEstimate()) )
-			{
-				// Do not path thru disabled volumes.
-
-				if( !pNeighborVolume->IsVolumeEnabled() )
-				{
-					continue;
-				}
-
-				if ( pNeighborVolume->HasDoors() )
-				{
-					// Some AI cannot use doors.
-
-					if( !bUseDoors )
-					{
-						continue;
-					}
-
-					// If this is a door volume, make sure the doors aren't locked.
-					// Only consider doors locked if they are not open, and are locked.
-					// LevelDesigners sometimes need to lock doors in the open state.
-
-					LTBOOL bLocked = LTFALSE;
-
-					for ( uint32 iDoor = 0 ; iDoor < 2 ; iDoor++ )
-					{
-						HOBJECT hDoor = pNeighborVolume->GetDoor(iDoor);
-						if ( hDoor )
-						{
-							Door* pDoor = (Door*)g_pLTServer->HandleToObject(hDoor);
-							if( pDoor->IsLockedForCharacter(pAI->m_hObject) &&
-								( pDoor->GetState() != DOORSTATE_OPEN ) )
-							{
-								bLocked = LTTRUE;
-								break;
-							}
-						}	
-					}
-
-					if ( bLocked ) 
-					{
-						continue;
-					}
-				}
-
-				// Check special properties of volume.
-
-				if( !pCurrentVolume->CanBuildPathTo( pAI, pNeighborVolume ) )
-				{
-					continue;
-				}
-
-				if( !pNeighborVolume->CanBuildPathFrom( pAI, pCurrentVolume ) )
-				{
-					continue;
-				}
-
-				if ( !pCurrentVolume->CanBuildPathThrough( pAI, pCurrentVolume->GetPreviousVolume(), pNeighborVolume ) )
-				{
-					continue;
-				}
-
-
-				pNeighborVolume->SetShortestEstimate(fDistance);
-				pNeighborVolume->SetPreviousVolume(pCurrentVolume);
-				pNeighborVolume->SetEntryPosition(vNeighborConnection);
-				pq.Update(pNeighborVolume);
+				m_pPathCache->Add( key, aPath );
 			}
 		}
+
+		SetVolumePath( pPathInfo, aPath );
 	}
 
 	// Uncomment this for debugging.
@@ -969,6 +995,60 @@ path follow context
 /*/////////////////////////////////////////////////////
 
 
+//----------------------------------------------------------------------------
+//              
+//	ROUTINE:	CAIPathMgr::SetVolumePath()
+//              
+//	PURPOSE:	Links up the volumes of a path (by planner index, source
+//				first) through their previous pointers, so it can be
+//				reversed and built.  An empty path leaves the destination
+//				without a previous volume.
+//              
+//----------------------------------------------------------------------------
+void CAIPathMgr::SetVolumePath(PATH_INFO* pPathInfo, const std::vector<uint32>& aPath)
+{
+	pPathInfo->m_pDesinationVolume->SetPreviousVolume( LTNULL );
+
+	AIVolume* pPreviousVolume = LTNULL;
+	for( uint32 iPath = 0 ; iPath < aPath.size() ; ++iPath )
+	{
+		AIVolume* pVolume = g_pAIVolumeMgr->GetVolume( aPath[iPath] );
+		pVolume->SetPreviousVolume( pPreviousVolume );
+
+		if( pPreviousVolume )
+		{
+			for ( uint32 iNeighbor = 0 ; iNeighbor < pPreviousVolume->GetNumNeighbors() ; iNeighbor++ )
+			{
+				AIVolumeNeighbor* pVolumeNeighbor = pPreviousVolume->GetNeighborByIndex(iNeighbor);
+				if( pVolumeNeighbor->GetVolume() == pVolume )
+				{
+					pVolume->SetEntryPosition( pVolumeNeighbor->GetConnectionPos() );
+					break;
+				}
+			}
+		}
+		else {
+			pVolume->SetEntryPosition( pPathInfo->m_vPosition );
+			pVolume->SetWalkthroughPosition( pPathInfo->m_vPosition );
+		}
+
+		pPreviousVolume = pVolume;
+	}
+}
+
+//----------------------------------------------------------------------------
+//              
+//	ROUTINE:	CAIPathMgr::ForgetAI()
+//              
+//	PURPOSE:	Drops the cached paths of an AI that's going away.  Another
+//				AI could be created at the same address.
+//              
+//----------------------------------------------------------------------------
+void CAIPathMgr::ForgetAI(CAI* pAI)
+{
+	m_pPathCache->Forget( pAI );
+}
+
 void CAIPathMgr::ReversePath(AIVolume* pVolume, AIVolume* pVolumeNext /* = LTNULL */)
 {
 	if ( !pVolume )
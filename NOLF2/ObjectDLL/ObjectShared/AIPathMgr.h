@@ -11,6 +11,8 @@ class CAINodeMgr;
 class CAIVolumeMgr;
 class CAIRegionMgr;
 class CAIInformationVolumeMgr;
+class CAIVolumePathPlanner;
+class CAIPathCache;
 struct PATH_INFO;
 
 // Externs
@@ -120,6 +122,10 @@ class CAIPathMgr
 		const uint32 GetPathKnowledgeIndex() const { return m_nPathKnowledgeIndex; }
 		void InvalidatePathKnowledge() { ++m_nPathKnowledgeIndex; }
 
+		// Drop any cached paths found for an AI that's going away.
+
+		void ForgetAI(CAI* pAI);
+
 		// Simple accessors
 
         inline LTBOOL IsInitialized() { return m_bInitialized; }
@@ -148,6 +154,7 @@ class CAIPathMgr
 
         LTBOOL EstimatePath(CAI* pAI, const LTVector& vPosSrc, AIVolume* pVolumeSrc, const LTVector& vPosDest, AIVolume* pVolumeDest, LTFLOAT* pfDistanceEstimate);
         void ReversePath(AIVolume* pVolume, AIVolume* pVolumeNext = LTNULL);
+		void SetVolumePath(PATH_INFO* pPathInfo, const std::vector<uint32>& aPath);
         void BuildPath(CAI* pAI, CAIPath* pPath, AIVolume* pVolume, const LTVector& vPosDest);
 		void BuildEstimate(CAI* pAI, AIVolume* pVolume, const LTVector& vPosCurrent, const LTVector& vPosDest, LTFLOAT* pfDistanceEstimate);
 
@@ -185,6 +192,10 @@ class CAIPathMgr
 		CAIInformationVolumeMgr* m_pAIInformationVolumeMgr;
 		CAIVolumeMgr*			m_pAIVolumeMgr;
 		CAIRegionMgr*			m_pAIRegionMgr;
+
+		CAIVolumePathPlanner*	m_pPathPlanner;
+		CAIPathCache*			m_pPathCache;
+		uint32					m_nPathCacheKnowledgeIndex;
 };
 
 #endif // __AI_PATH_MGR_H__
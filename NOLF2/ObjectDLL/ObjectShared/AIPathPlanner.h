@@ -0,0 +1,743 @@
+// ----------------------------------------------------------------------- //
+//
+// MODULE  : AIPathPlanner.h
+//
+// PURPOSE : Shortest path search over the AI volume graph, and a cache
+//			 of the paths it finds.
+//
+// ----------------------------------------------------------------------- //
+
+#ifndef __AI_PATH_PLANNER_H__
+#define __AI_PATH_PLANNER_H__
+
+#include "FastHeap.h"
+#include <float.h>
+#include <algorithm>
+#include <list>
+#include <map>
+#include <vector>
+
+/*
+
+  CAIPathPlanner does Dijkstra's over any graph that looks like:
+
+class CGraph
+{
+	typedef CFoo NODE;
+
+	uint32 GetNumNodes() const;
+	NODE* GetNode(uint32 iNode) const;
+
+	uint32 GetNumNeighbors(NODE* pNode) const;
+	NODE* GetNeighbor(NODE* pNode, uint32 iNeighbor) const;
+
+	LTVector GetNodeCenter(NODE* pNode) const;
+
+	// The planner numbers the nodes in Init, and needs to get the numbers
+	// back quickly.
+
+	uint32 GetNodeIndex(NODE* pNode) const;
+	void SetNodeIndex(NODE* pNode, uint32 iNode);
+};
+
+  ...what a particular search is allowed to do (which depends on who's
+  asking) comes from a SEARCH passed to FindPath:
+
+struct CSearch
+{
+	// Cheap checks done before the cost of a step is figured.
+
+	bool CanUse(CFoo* pTo);
+
+	// The cost of stepping from pFrom, which was entered at vEntry, to its
+	// iNeighbor'th neighbor.  Returns where the neighbor gets entered.
+
+	LTFLOAT GetStepCost(CFoo* pFrom, const LTVector& vEntry, uint32 iNeighbor, LTVector* pvNeighborEntry);
+
+	// Expensive checks, done only once a step would improve the path.
+	// pPrev is where pFrom was entered from (NULL for the source).
+
+	bool CanStep(CFoo* pPrev, CFoo* pFrom, CFoo* pTo);
+};
+
+  Big graphs are split into clusters of neighboring nodes.  A search first
+  finds the cheapest chain of clusters between the source and destination,
+  then only looks at nodes in that corridor (the chain, plus every cluster
+  touching it).  That keeps each search to a small part of the level, at
+  the cost of sometimes missing a slightly shorter path that leaves the
+  corridor.  If the corridor search fails (a locked door in the way, say)
+  the whole graph is searched, so a path is never missed.
+
+*/
+
+template <class GRAPH>
+class CAIPathPlanner
+{
+	public :
+
+		typedef typename GRAPH::NODE NODE;
+
+		enum Constants
+		{
+			kInvalidNode = 0xFFFFFFFF,
+
+			// Graphs smaller than this aren't clustered, so they keep
+			// getting exact paths.  Pathfinding used to give up at this
+			// many volumes, so only those levels get cluster paths.
+
+			kDefaultMinNodesForClusters = 1024,
+
+			kDefaultClusterSize = 32,
+		};
+
+	public :
+
+		CAIPathPlanner();
+
+		// Number the nodes and build the clusters.  Needs to be redone
+		// whenever the graph changes.
+
+		void Init(GRAPH* pGraph, uint32 nMinNodesForClusters = kDefaultMinNodesForClusters, uint32 nClusterSize = kDefaultClusterSize);
+		void Term();
+
+		bool IsInitialized() const { return m_pGraph != NULL; }
+
+		// Find the cheapest path from pSrc (starting at vSrcPos) to pDest.
+		// Returns false if there isn't one.
+
+		template <class SEARCH>
+		bool FindPath(SEARCH& search, NODE* pSrc, const LTVector& vSrcPos, NODE* pDest, bool bUseClusters = true);
+
+		// Results of the last FindPath.  GetPath fills in the nodes from the
+		// source to pDest (both included).
+
+		NODE* GetPreviousNode(NODE* pNode) const;
+		const LTVector& GetEntryPosition(NODE* pNode) const;
+		void GetPath(NODE* pDest, std::vector<uint32>* paPath) const;
+
+		// Simple accessors
+
+		GRAPH* GetGraph() const { return m_pGraph; }
+		uint32 GetNumNodes() const { return (uint32)m_aNodes.size(); }
+		uint32 GetNumClusters() const { return (uint32)m_aClusters.size(); }
+		uint32 GetNodesExpanded() const { return m_nNodesExpanded; }
+
+	protected :
+
+		struct NODE_STATE
+		{
+			LTFLOAT		fCost;
+			uint32		iPrev;
+			uint32		nSearchID;
+			uint32		iCluster;
+			LTVector	vEntry;
+		};
+
+		struct CLUSTER
+		{
+			LTVector	vCenter;
+			LTFLOAT		fCost;
+			uint32		iPrev;
+			uint32		nSearchID;
+			uint32		nCorridorID;
+			std::vector<uint32> aNeighbors;
+		};
+
+		struct OPEN_NODE
+		{
+			LTFLOAT		fCost;
+			uint32		iNode;
+		};
+
+		struct CompareOpenNode
+		{
+			inline bool operator()(const OPEN_NODE& node1, const OPEN_NODE& node2) const
+			{
+				return node1.fCost < node2.fCost;
+			}
+		};
+
+		typedef CGrowableHeap<OPEN_NODE, CompareOpenNode> OPEN_HEAP;
+		typedef std::vector<NODE_STATE> NODE_STATE_LIST;
+		typedef std::vector<CLUSTER> CLUSTER_LIST;
+
+	protected :
+
+		void BuildClusters(uint32 nClusterSize);
+		bool FindCorridor(uint32 iSrcCluster, uint32 iDestCluster);
+
+		template <class SEARCH>
+		bool Search(SEARCH& search, uint32 iSrc, const LTVector& vSrcPos, uint32 iDest, bool bInCorridor);
+
+		NODE_STATE& GetState(uint32 iNode)
+		{
+			NODE_STATE& state = m_aNodes[iNode];
+			if ( state.nSearchID != m_nSearchID )
+			{
+				state.nSearchID = m_nSearchID;
+				state.fCost = FLT_MAX;
+				state.iPrev = kInvalidNode;
+			}
+			return state;
+		}
+
+		uint32 NextSearchID(uint32* pnID);
+
+	protected :
+
+		GRAPH*			m_pGraph;
+		NODE_STATE_LIST	m_aNodes;
+		CLUSTER_LIST	m_aClusters;
+		OPEN_HEAP		m_heapOpen;
+
+		uint32			m_nSearchID;
+		uint32			m_nClusterSearchID;
+		uint32			m_nCorridorID;
+		uint32			m_nNodesExpanded;
+};
+
+template <class GRAPH>
+CAIPathPlanner<GRAPH>::CAIPathPlanner()
+{
+	m_pGraph = NULL;
+	m_nSearchID = 0;
+	m_nClusterSearchID = 0;
+	m_nCorridorID = 0;
+	m_nNodesExpanded = 0;
+}
+
+template <class GRAPH>
+void CAIPathPlanner<GRAPH>::Init(GRAPH* pGraph, uint32 nMinNodesForClusters, uint32 nClusterSize)
+{
+	Term();
+
+	m_pGraph = pGraph;
+
+	uint32 nNodes = m_pGraph->GetNumNodes();
+	m_aNodes.resize(nNodes);
+
+	for ( uint32 iNode = 0 ; iNode < nNodes ; iNode++ )
+	{
+		m_pGraph->SetNodeIndex(m_pGraph->GetNode(iNode), iNode);
+
+		NODE_STATE& state = m_aNodes[iNode];
+		state.fCost = FLT_MAX;
+		state.iPrev = kInvalidNode;
+		state.nSearchID = 0;
+		state.iCluster = kInvalidNode;
+	}
+
+	m_nSearchID = 0;
+
+	if ( nNodes >= nMinNodesForClusters && nClusterSize > 1 )
+	{
+		BuildClusters(nClusterSize);
+	}
+}
+
+template <class GRAPH>
+void CAIPathPlanner<GRAPH>::Term()
+{
+	m_pGraph = NULL;
+	m_aNodes.clear();
+	m_aClusters.clear();
+	m_heapOpen.Clear();
+}
+
+template <class GRAPH>
+uint32 CAIPathPlanner<GRAPH>::NextSearchID(uint32* pnID)
+{
+	// Search IDs mark which states belong to the current search, so nothing
+	// needs to be cleared between searches.  When the ID wraps, the old
+	// marks have to go.
+
+	if ( ++(*pnID) == 0 )
+	{
+		if ( pnID == &m_nSearchID )
+		{
+			for ( uint32 iNode = 0 ; iNode < m_aNodes.size() ; iNode++ )
+			{
+				m_aNodes[iNode].nSearchID = 0;
+			}
+		}
+		else
+		{
+			for ( uint32 iCluster = 0 ; iCluster < m_aClusters.size() ; iCluster++ )
+			{
+				m_aClusters[iCluster].nSearchID = 0;
+				m_aClusters[iCluster].nCorridorID = 0;
+			}
+			m_nCorridorID = 0;
+		}
+
+		*pnID = 1;
+	}
+
+	return *pnID;
+}
+
+template <class GRAPH>
+void CAIPathPlanner<GRAPH>::BuildClusters(uint32 nClusterSize)
+{
+	// Grow each cluster breadth first from the lowest unclustered node, so
+	// clusters are compact and their nodes connected.
+
+	std::vector<uint32> aQueue;
+	aQueue.reserve(nClusterSize);
+
+	uint32 nNodes = (uint32)m_aNodes.size();
+	for ( uint32 iSeed = 0 ; iSeed < nNodes ; iSeed++ )
+	{
+		if ( m_aNodes[iSeed].iCluster != kInvalidNode )
+		{
+			continue;
+		}
+
+		uint32 iCluster = (uint32)m_aClusters.size();
+		m_aClusters.push_back(CLUSTER());
+
+		CLUSTER& cluster = m_aClusters.back();
+		cluster.fCost = FLT_MAX;
+		cluster.iPrev = kInvalidNode;
+		cluster.nSearchID = 0;
+		cluster.nCorridorID = 0;
+
+		aQueue.clear();
+		aQueue.push_back(iSeed);
+		m_aNodes[iSeed].iCluster = iCluster;
+
+		LTVector vCenter(0.f, 0.f, 0.f);
+
+		for ( uint32 iQueue = 0 ; iQueue < aQueue.size() ; iQueue++ )
+		{
+			NODE* pNode = m_pGraph->GetNode(aQueue[iQueue]);
+			vCenter += m_pGraph->GetNodeCenter(pNode);
+
+			uint32 nNeighbors = m_pGraph->GetNumNeighbors(pNode);
+			for ( uint32 iNeighbor = 0 ; iNeighbor < nNeighbors && aQueue.size() < nClusterSize ; iNeighbor++ )
+			{
+				uint32 iTo = m_pGraph->GetNodeIndex(m_pGraph->GetNeighbor(pNode, iNeighbor));
+				if ( m_aNodes[iTo].iCluster == kInvalidNode )
+				{
+					m_aNodes[iTo].iCluster = iCluster;
+					aQueue.push_back(iTo);
+				}
+			}
+		}
+
+		cluster.vCenter = vCenter / (LTFLOAT)aQueue.size();
+	}
+
+	// Link clusters with any neighboring nodes.
+
+	for ( uint32 iNode = 0 ; iNode < nNodes ; iNode++ )
+	{
+		NODE* pNode = m_pGraph->GetNode(iNode);
+		uint32 iCluster = m_aNodes[iNode].iCluster;
+
+		uint32 nNeighbors = m_pGraph->GetNumNeighbors(pNode);
+		for ( uint32 iNeighbor = 0 ; iNeighbor < nNeighbors ; iNeighbor++ )
+		{
+			uint32 iTo = m_pGraph->GetNodeIndex(m_pGraph->GetNeighbor(pNode, iNeighbor));
+			uint32 iToCluster = m_aNodes[iTo].iCluster;
+			if ( iToCluster == iCluster )
+			{
+				continue;
+			}
+
+			// Links are added both ways, in case the graph's aren't.
+
+			std::vector<uint32>& aFrom = m_aClusters[iCluster].aNeighbors;
+			if ( std::find(aFrom.begin(), aFrom.end(), iToCluster) == aFrom.end() )
+			{
+				aFrom.push_back(iToCluster);
+			}
+
+			std::vector<uint32>& aTo = m_aClusters[iToCluster].aNeighbors;
+			if ( std::find(aTo.begin(), aTo.end(), iCluster) == aTo.end() )
+			{
+				aTo.push_back(iCluster);
+			}
+		}
+	}
+}
+
+template <class GRAPH>
+bool CAIPathPlanner<GRAPH>::FindCorridor(uint32 iSrcCluster, uint32 iDestCluster)
+{
+	// Dijkstra's over the clusters, by distance between their centers.
+
+	uint32 nSearchID = NextSearchID(&m_nClusterSearchID);
+
+	CLUSTER& src = m_aClusters[iSrcCluster];
+	src.nSearchID = nSearchID;
+	src.fCost = 0.f;
+	src.iPrev = kInvalidNode;
+
+	m_heapOpen.Clear();
+
+	OPEN_NODE open;
+	open.fCost = 0.f;
+	open.iNode = iSrcCluster;
+	m_heapOpen.Push(open);
+
+	bool bFound = false;
+	while ( !m_heapOpen.IsEmpty() )
+	{
+		open = m_heapOpen.Pop();
+		if ( open.iNode == iDestCluster )
+		{
+			bFound = true;
+			break;
+		}
+
+		CLUSTER& cur = m_aClusters[open.iNode];
+		if ( open.fCost > cur.fCost )
+		{
+			continue;
+		}
+
+		for ( uint32 iNeighbor = 0 ; iNeighbor < cur.aNeighbors.size() ; iNeighbor++ )
+		{
+			uint32 iTo = cur.aNeighbors[iNeighbor];
+			CLUSTER& to = m_aClusters[iTo];
+
+			LTFLOAT fCost = cur.fCost + cur.vCenter.Dist(to.vCenter);
+			if ( to.nSearchID != nSearchID || fCost < to.fCost )
+			{
+				to.nSearchID = nSearchID;
+				to.fCost = fCost;
+				to.iPrev = open.iNode;
+
+				OPEN_NODE next;
+				next.fCost = fCost;
+				next.iNode = iTo;
+				m_heapOpen.Push(next);
+			}
+		}
+	}
+
+	if ( !bFound )
+	{
+		return false;
+	}
+
+	// Mark the chain and everything touching it.
+
+	uint32 nCorridorID = ++m_nCorridorID;
+
+	for ( uint32 iCluster = iDestCluster ; iCluster != kInvalidNode ; iCluster = m_aClusters[iCluster].iPrev )
+	{
+		CLUSTER& cluster = m_aClusters[iCluster];
+		cluster.nCorridorID = nCorridorID;
+
+		for ( uint32 iNeighbor = 0 ; iNeighbor < cluster.aNeighbors.size() ; iNeighbor++ )
+		{
+			m_aClusters[cluster.aNeighbors[iNeighbor]].nCorridorID = nCorridorID;
+		}
+	}
+
+	return true;
+}
+
+template <class GRAPH>
+template <class SEARCH>
+bool CAIPathPlanner<GRAPH>::FindPath(SEARCH& search, NODE* pSrc, const LTVector& vSrcPos, NODE* pDest, bool bUseClusters)
+{
+	m_nNodesExpanded = 0;
+
+	if ( !m_pGraph || !pSrc || !pDest )
+	{
+		return false;
+	}
+
+	uint32 iSrc = m_pGraph->GetNodeIndex(pSrc);
+	uint32 iDest = m_pGraph->GetNodeIndex(pDest);
+
+	if ( bUseClusters && !m_aClusters.empty() )
+	{
+		uint32 iSrcCluster = m_aNodes[iSrc].iCluster;
+		uint32 iDestCluster = m_aNodes[iDest].iCluster;
+
+		// Clusters are linked wherever nodes are, so if the clusters aren't
+		// connected the nodes can't be either.
+
+		if ( !FindCorridor(iSrcCluster, iDestCluster) )
+		{
+			return false;
+		}
+
+		if ( Search(search, iSrc, vSrcPos, iDest, true) )
+		{
+			return true;
+		}
+	}
+
+	return Search(search, iSrc, vSrcPos, iDest, false);
+}
+
+template <class GRAPH>
+template <class SEARCH>
+bool CAIPathPlanner<GRAPH>::Search(SEARCH& search, uint32 iSrc, const LTVector& vSrcPos, uint32 iDest, bool bInCorridor)
+{
+	NextSearchID(&m_nSearchID);
+
+	NODE_STATE& src = GetState(iSrc);
+	src.fCost = 0.f;
+	src.vEntry = vSrcPos;
+
+	NODE_STATE& dest = GetState(iDest);
+
+	m_heapOpen.Clear();
+
+	OPEN_NODE open;
+	open.fCost = 0.f;
+	open.iNode = iSrc;
+	m_heapOpen.Push(open);
+
+	while ( !m_heapOpen.IsEmpty() )
+	{
+		open = m_heapOpen.Pop();
+
+		// Skip copies left behind when a node's cost went down.
+
+		NODE_STATE& cur = m_aNodes[open.iNode];
+		if ( open.fCost > cur.fCost )
+		{
+			continue;
+		}
+
+		// Everything left costs more than the path already found.
+
+		if ( cur.fCost > dest.fCost )
+		{
+			break;
+		}
+
+		++m_nNodesExpanded;
+
+		NODE* pCur = m_pGraph->GetNode(open.iNode);
+		NODE* pPrev = ( cur.iPrev != kInvalidNode ) ? m_pGraph->GetNode(cur.iPrev) : NULL;
+
+		// Relax all the neighbors
+
+		uint32 nNeighbors = m_pGraph->GetNumNeighbors(pCur);
+		for ( uint32 iNeighbor = 0 ; iNeighbor < nNeighbors ; iNeighbor++ )
+		{
+			NODE* pTo = m_pGraph->GetNeighbor(pCur, iNeighbor);
+			uint32 iTo = m_pGraph->GetNodeIndex(pTo);
+
+			if ( iTo == iSrc )
+			{
+				continue;
+			}
+
+			if ( bInCorridor && m_aClusters[m_aNodes[iTo].iCluster].nCorridorID != m_nCorridorID )
+			{
+				continue;
+			}
+
+			if ( !search.CanUse(pTo) )
+			{
+				continue;
+			}
+
+			LTVector vEntry;
+			LTFLOAT fCost = cur.fCost + search.GetStepCost(pCur, cur.vEntry, iNeighbor, &vEntry);
+
+			NODE_STATE& to = GetState(iTo);
+			if ( ( to.fCost > fCost ) && ( fCost < dest.fCost ) )
+			{
+				if ( !search.CanStep(pPrev, pCur, pTo) )
+				{
+					continue;
+				}
+
+				to.fCost = fCost;
+				to.iPrev = open.iNode;
+				to.vEntry = vEntry;
+
+				OPEN_NODE next;
+				next.fCost = fCost;
+				next.iNode = iTo;
+				m_heapOpen.Push(next);
+			}
+		}
+	}
+
+	return ( iSrc == iDest ) || ( dest.iPrev != kInvalidNode );
+}
+
+template <class GRAPH>
+typename CAIPathPlanner<GRAPH>::NODE* CAIPathPlanner<GRAPH>::GetPreviousNode(NODE* pNode) const
+{
+	const NODE_STATE& state = m_aNodes[m_pGraph->GetNodeIndex(pNode)];
+	if ( state.nSearchID != m_nSearchID || state.iPrev == kInvalidNode )
+	{
+		return NULL;
+	}
+
+	return m_pGraph->GetNode(state.iPrev);
+}
+
+template <class GRAPH>
+const LTVector& CAIPathPlanner<GRAPH>::GetEntryPosition(NODE* pNode) const
+{
+	return m_aNodes[m_pGraph->GetNodeIndex(pNode)].vEntry;
+}
+
+template <class GRAPH>
+void CAIPathPlanner<GRAPH>::GetPath(NODE* pDest, std::vector<uint32>* paPath) const
+{
+	paPath->clear();
+
+	uint32 iNode = m_pGraph->GetNodeIndex(pDest);
+	while ( iNode != kInvalidNode )
+	{
+		paPath->push_back(iNode);
+
+		const NODE_STATE& state = m_aNodes[iNode];
+		iNode = ( state.nSearchID == m_nSearchID ) ? state.iPrev : kInvalidNode;
+	}
+
+	std::reverse(paPath->begin(), paPath->end());
+}
+
+
+//
+// CAIPathCache
+//
+// Remembers the last paths found, by node index, and throws out the least
+// recently used ones when full.  Whoever owns the cache has to Clear it
+// when anything that affects paths changes.
+//
+
+struct AIPATH_CACHE_KEY
+{
+	const void*	pOwner;		// Whoever the path was found for.
+	uint32		iSrc;
+	uint32		iDest;
+	uint32		nFlags;		// Anything else the search depended on.
+	uint32		nParam;
+
+	bool operator<(const AIPATH_CACHE_KEY& key) const
+	{
+		if ( pOwner != key.pOwner ) return pOwner < key.pOwner;
+		if ( iSrc != key.iSrc ) return iSrc < key.iSrc;
+		if ( iDest != key.iDest ) return iDest < key.iDest;
+		if ( nFlags != key.nFlags ) return nFlags < key.nFlags;
+		return nParam < key.nParam;
+	}
+};
+
+class CAIPathCache
+{
+	public :
+
+		enum Constants
+		{
+			kDefaultMaxEntries = 256,
+		};
+
+	public :
+
+		CAIPathCache(uint32 nMaxEntries = kDefaultMaxEntries)
+		{
+			m_nMaxEntries = nMaxEntries;
+			m_nHits = 0;
+			m_nMisses = 0;
+		}
+
+		// Returns the path (source first), or NULL if it isn't cached.
+
+		const std::vector<uint32>* Find(const AIPATH_CACHE_KEY& key)
+		{
+			ENTRY_MAP::iterator itEntry = m_mapEntries.find(key);
+			if ( itEntry == m_mapEntries.end() )
+			{
+				++m_nMisses;
+				return NULL;
+			}
+
+			++m_nHits;
+
+			// Move it to the front of the LRU list.
+
+			m_lstEntries.splice(m_lstEntries.begin(), m_lstEntries, itEntry->second);
+			return &itEntry->second->aPath;
+		}
+
+		void Add(const AIPATH_CACHE_KEY& key, const std::vector<uint32>& aPath)
+		{
+			ENTRY_MAP::iterator itEntry = m_mapEntries.find(key);
+			if ( itEntry != m_mapEntries.end() )
+			{
+				itEntry->second->aPath = aPath;
+				m_lstEntries.splice(m_lstEntries.begin(), m_lstEntries, itEntry->second);
+				return;
+			}
+
+			if ( m_mapEntries.size() >= m_nMaxEntries && !m_lstEntries.empty() )
+			{
+				m_mapEntries.erase(m_lstEntries.back().key);
+				m_lstEntries.pop_back();
+			}
+
+			m_lstEntries.push_front(ENTRY());
+			m_lstEntries.front().key = key;
+			m_lstEntries.front().aPath = aPath;
+			m_mapEntries[key] = m_lstEntries.begin();
+		}
+
+		// Throw out everything found for pOwner.
+
+		void Forget(const void* pOwner)
+		{
+			ENTRY_LIST::iterator itEntry = m_lstEntries.begin();
+			while ( itEntry != m_lstEntries.end() )
+			{
+				if ( itEntry->key.pOwner == pOwner )
+				{
+					m_mapEntries.erase(itEntry->key);
+					itEntry = m_lstEntries.erase(itEntry);
+				}
+				else
+				{
+					++itEntry;
+				}
+			}
+		}
+
+		void Clear()
+		{
+			m_lstEntries.clear();
+			m_mapEntries.clear();
+		}
+
+		// Simple accessors
+
+		uint32 GetNumEntries() const { return (uint32)m_mapEntries.size(); }
+		uint32 GetNumHits() const { return m_nHits; }
+		uint32 GetNumMisses() const { return m_nMisses; }
+
+	protected :
+
+		struct ENTRY
+		{
+			AIPATH_CACHE_KEY	key;
+			std::vector<uint32>	aPath;
+		};
+
+		typedef std::list<ENTRY> ENTRY_LIST;
+		typedef std::map<AIPATH_CACHE_KEY, ENTRY_LIST::iterator> ENTRY_MAP;
+
+	protected :
+
+		uint32		m_nMaxEntries;
+		uint32		m_nHits;
+		uint32		m_nMisses;
+		ENTRY_LIST	m_lstEntries;
+		ENTRY_MAP	m_mapEntries;
+};
+
+#endif // __AI_PATH_PLANNER_H__
@@ -0,0 +1,309 @@
+// ----------------------------------------------------------------------- //
+//
+// MODULE  : AIStimulusGrid.h
+//
+// PURPOSE : AIStimulusGrid class definition
+//
+// CREATED : 10/17/26
+//
+// ----------------------------------------------------------------------- //
+
+#ifndef __AISTIMULUS_GRID_H__
+#define __AISTIMULUS_GRID_H__
+
+#include <vector>
+#include <algorithm>
+#include <math.h>
+
+//
+// CLASS: Spatial hash of stimulus records over the ground plane (x, z).
+//        Each record is placed in every cell its sense radius touches, so
+//        a sensing AI only needs to look at the cells its own sense
+//        distances touch.  Records are referred to by their index in the
+//        order they were added, and are returned in that same order.
+//
+class CAIStimulusGrid
+{
+	public : // Public methods
+
+		CAIStimulusGrid();
+
+		// Clear the grid and start adding records.
+
+		void	Clear();
+		void	AddItem(uint32 iItem, const LTVector& vPos, LTFLOAT fRadius);
+
+		// Hash the records added since Clear.  Must be called before
+		// GetItemsNear.  The cells are sized by the largest sense
+		// radius of the records.
+
+		void	Build();
+
+		// Fill the list with every record whose sense radius comes
+		// within fRadius of vPos on the ground plane, sorted by index.
+		// Some records that are farther away may be included as well.
+
+		void	GetItemsNear(const LTVector& vPos, LTFLOAT fRadius, std::vector<uint32>* plstItems);
+
+		uint32	GetNumItems() const { return (uint32)m_lstItems.size(); }
+		LTFLOAT	GetCellSize() const { return m_fCellSize; }
+
+	private:
+
+		enum { kMaxItemCells = 16, kMaxQueryCells = 64, kMaxCellCoord = (1 << 20) };
+
+		struct ITEM
+		{
+			uint32	iItem;
+			float	fX, fZ, fRadius;
+		};
+
+		int		GetCell(float fCoord) const;
+		uint32	GetNumCells(float fX, float fZ, float fRadius) const;
+		uint32	GetBucket(int x, int z) const;
+		void	AddCandidate(uint32 iItem, std::vector<uint32>* plstItems);
+
+	private : // Private member variables
+
+		LTFLOAT					m_fCellSize;
+		LTFLOAT					m_fInvCellSize;
+
+		std::vector<ITEM>		m_lstItems;			// Records added since Clear.
+		std::vector<uint32>		m_lstEverywhere;	// Records covering too many cells to hash.
+
+		uint32					m_nBucketMask;
+		std::vector<uint32>		m_lstBucketStart;	// First entry of each bucket in m_lstBucketItems.
+		std::vector<uint32>		m_lstBucketItems;	// Records in each bucket, by index.
+
+		uint32					m_nQueryStamp;		// Stamps records already found by a query.
+		std::vector<uint32>		m_lstItemStamps;
+};
+
+inline CAIStimulusGrid::CAIStimulusGrid()
+{
+	m_fCellSize		= 1.f;
+	m_fInvCellSize	= 1.f;
+	m_nBucketMask	= 0;
+	m_nQueryStamp	= 0;
+}
+
+inline void CAIStimulusGrid::Clear()
+{
+	m_lstItems.clear();
+	m_lstEverywhere.clear();
+	m_lstBucketStart.clear();
+	m_lstBucketItems.clear();
+	m_nBucketMask = 0;
+}
+
+inline void CAIStimulusGrid::AddItem(uint32 iItem, const LTVector& vPos, LTFLOAT fRadius)
+{
+	ITEM Item;
+	Item.iItem = iItem;
+	Item.fX = vPos.x;
+	Item.fZ = vPos.z;
+	Item.fRadius = ( fRadius > 0.f ) ? fRadius : 0.f;
+	m_lstItems.push_back( Item );
+}
+
+inline int CAIStimulusGrid::GetCell(float fCoord) const
+{
+	float fCell = (float)floor( fCoord * m_fInvCellSize );
+	if( fCell < -(float)kMaxCellCoord )
+	{
+		return -kMaxCellCoord;
+	}
+	if( fCell > (float)kMaxCellCoord )
+	{
+		return kMaxCellCoord;
+	}
+	return (int)fCell;
+}
+
+inline uint32 CAIStimulusGrid::GetNumCells(float fX, float fZ, float fRadius) const
+{
+	// Stop counting once it's more than anything is allowed to cover.
+	uint32 cWidth = (uint32)( GetCell( fX + fRadius ) - GetCell( fX - fRadius ) + 1 );
+	uint32 cDepth = (uint32)( GetCell( fZ + fRadius ) - GetCell( fZ - fRadius ) + 1 );
+	if( ( cWidth > kMaxQueryCells ) || ( cDepth > kMaxQueryCells ) )
+	{
+		return kMaxQueryCells + 1;
+	}
+	return cWidth * cDepth;
+}
+
+inline uint32 CAIStimulusGrid::GetBucket(int x, int z) const
+{
+	return ( ( (uint32)x * 73856093u ) ^ ( (uint32)z * 19349663u ) ) & m_nBucketMask;
+}
+
+inline void CAIStimulusGrid::Build()
+{
+	uint32 iItem;
+	int x, z;
+
+	// Size the cells to fit the largest radius, so most records only
+	// touch a few cells.  Records that are too big or not anywhere
+	// are checked by everyone.
+
+	LTFLOAT fMaxRadius = 0.f;
+	for( iItem = 0; iItem < m_lstItems.size(); ++iItem )
+	{
+		fMaxRadius = std::max( fMaxRadius, m_lstItems[iItem].fRadius );
+	}
+	m_fCellSize = std::max( 256.f, std::min( fMaxRadius, 2048.f ) );
+	m_fInvCellSize = 1.f / m_fCellSize;
+
+	std::vector<uint32> lstItemCells;
+	uint32 cEntries = 0;
+	for( iItem = 0; iItem < m_lstItems.size(); ++iItem )
+	{
+		const ITEM& Item = m_lstItems[iItem];
+		if( !( Item.fX == Item.fX ) || !( Item.fZ == Item.fZ ) || !( Item.fRadius == Item.fRadius ) )
+		{
+			lstItemCells.push_back( 0 );
+			m_lstEverywhere.push_back( iItem );
+			continue;
+		}
+
+		uint32 cCells = GetNumCells( Item.fX, Item.fZ, Item.fRadius );
+		if( cCells > kMaxItemCells )
+		{
+			lstItemCells.push_back( 0 );
+			m_lstEverywhere.push_back( iItem );
+			continue;
+		}
+
+		lstItemCells.push_back( cCells );
+		cEntries += cCells;
+	}
+
+	// Twice as many buckets as entries, so few cells share a bucket.
+
+	uint32 cBuckets = 64;
+	while( cBuckets < cEntries * 2 )
+	{
+		cBuckets <<= 1;
+	}
+	m_nBucketMask = cBuckets - 1;
+
+	// Count the records in each bucket, then fill them in by index.
+
+	m_lstBucketStart.assign( cBuckets + 1, 0 );
+	for( iItem = 0; iItem < m_lstItems.size(); ++iItem )
+	{
+		if( !lstItemCells[iItem] )
+		{
+			continue;
+		}
+
+		const ITEM& Item = m_lstItems[iItem];
+		for( x = GetCell( Item.fX - Item.fRadius ); x <= GetCell( Item.fX + Item.fRadius ); ++x )
+		{
+			for( z = GetCell( Item.fZ - Item.fRadius ); z <= GetCell( Item.fZ + Item.fRadius ); ++z )
+			{
+				++m_lstBucketStart[GetBucket( x, z ) + 1];
+			}
+		}
+	}
+
+	for( uint32 iBucket = 0; iBucket < cBuckets; ++iBucket )
+	{
+		m_lstBucketStart[iBucket + 1] += m_lstBucketStart[iBucket];
+	}
+
+	std::vector<uint32> lstBucketFill( m_lstBucketStart.begin(), m_lstBucketStart.end() - 1 );
+	m_lstBucketItems.resize( cEntries );
+	for( iItem = 0; iItem < m_lstItems.size(); ++iItem )
+	{
+		if( !lstItemCells[iItem] )
+		{
+			continue;
+		}
+
+		const ITEM& Item = m_lstItems[iItem];
+		for( x = GetCell( Item.fX - Item.fRadius ); x <= GetCell( Item.fX + Item.fRadius ); ++x )
+		{
+			for( z = GetCell( Item.fZ - Item.fRadius ); z <= GetCell( Item.fZ + Item.fRadius ); ++z )
+			{
+				m_lstBucketItems[lstBucketFill[GetBucket( x, z )]++] = iItem;
+			}
+		}
+	}
+
+	if( m_lstItemStamps.size() < m_lstItems.size() )
+	{
+		m_lstItemStamps.resize( m_lstItems.size(), m_nQueryStamp );
+	}
+}
+
+inline void CAIStimulusGrid::AddCandidate(uint32 iItem, std::vector<uint32>* plstItems)
+{
+	if( m_lstItemStamps[iItem] != m_nQueryStamp )
+	{
+		m_lstItemStamps[iItem] = m_nQueryStamp;
+		plstItems->push_back( m_lstItems[iItem].iItem );
+	}
+}
+
+inline void CAIStimulusGrid::GetItemsNear(const LTVector& vPos, LTFLOAT fRadius, std::vector<uint32>* plstItems)
+{
+	uint32 iItem;
+	int x, z;
+
+	plstItems->clear();
+	if( m_lstItems.empty() )
+	{
+		return;
+	}
+
+	// Start a new query.  Forget the old stamps if the counter wraps.
+
+	if( ++m_nQueryStamp == 0 )
+	{
+		std::fill( m_lstItemStamps.begin(), m_lstItemStamps.end(), 0 );
+		m_nQueryStamp = 1;
+	}
+
+	// A query that isn't anywhere or covers most of the world
+	// gets every record.
+
+	if( fRadius < 0.f )
+	{
+		fRadius = 0.f;
+	}
+
+	bool bEverything = !( vPos.x == vPos.x ) || !( vPos.z == vPos.z ) || !( fRadius == fRadius ) ||
+		( GetNumCells( vPos.x, vPos.z, fRadius ) > kMaxQueryCells );
+
+	if( bEverything )
+	{
+		for( iItem = 0; iItem < m_lstItems.size(); ++iItem )
+		{
+			plstItems->push_back( m_lstItems[iItem].iItem );
+		}
+	}
+	else
+	{
+		for( x = GetCell( vPos.x - fRadius ); x <= GetCell( vPos.x + fRadius ); ++x )
+		{
+			for( z = GetCell( vPos.z - fRadius ); z <= GetCell( vPos.z + fRadius ); ++z )
+			{
+				uint32 iBucket = GetBucket( x, z );
+				for( uint32 iEntry = m_lstBucketStart[iBucket]; iEntry < m_lstBucketStart[iBucket + 1]; ++iEntry )
+				{
+					AddCandidate( m_lstBucketItems[iEntry], plstItems );
+				}
+			}
+		}
+
+		for( iItem = 0; iItem < m_lstEverywhere.size(); ++iItem )
+		{
+			AddCandidate( m_lstEverywhere[iItem], plstItems );
+		}
+	}
+
+	std::sort( plstItems->begin(), plstItems->end() );
+}
+
+#endif
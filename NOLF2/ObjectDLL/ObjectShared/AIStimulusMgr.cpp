@@ -36,6 +36,7 @@ static HOBJECT s_hStimulusModel[MAX_STIMULUS_RENDER];
 #define STIMULUS_RADIUS_SMALL		256.0f
 #define STIMULUS_RADIUS_LARGE		512.0f
 #define INTERSECT_SEGMENT_QUOTA		3
+#define INTERSECT_SEGMENT_BUDGET	16
 
 
 //
@@ -242,6 +243,9 @@ CAIStimulusMgr::CAIStimulusMgr()
 	m_bRenderStimulus	= LTFALSE;
 	m_nNextTargetMatchID = 0;
 
+	m_iNextSensing		= 0;
+	m_flagsStimulusSenses = kSense_None;
+
 	// ResponseIndex differentiates instances of AIs responding to stimulus.
 	// AIs get the next available index when they activate a stimulated goal.
 	// This index can be used by AI to determine if an Ally is alert due to
@@ -335,6 +339,13 @@ void CAIStimulusMgr::Term()
 	// Remove all sensing objects.
 
 	m_lstSensing.clear();
+	m_iNextSensing = 0;
+
+	// Forget the stimuli in the grid.
+
+	m_StimulusGrid.Clear();
+	m_lstStimulusOrder.clear();
+	m_flagsStimulusSenses = kSense_None;
 }
 
 
@@ -1201,27 +1212,41 @@ void CAIStimulusMgr::Update()
 //----------------------------------------------------------------------------
 void CAIStimulusMgr::UpdateSensingList()
 {
-	AISTIMULUS_MAP::iterator itRecordPair;
-	
-	CAIStimulusRecord* pRecord = LTNULL;
+	CAIStimulusRecord* pRecord;
 	IAISensing* pSensing;
 
 	LTBOOL bNewSenseUpdate;
 	int cPermittedIntersectSegmentCalls;
 	int cIntersectSegmentCallsPrev;
+	uint32 iNearStimulus;
 
 	LTFLOAT fCurTime = g_pLTServer->GetTime();
 
+	// Sort the stimuli by position, so each AI only needs to look
+	// at the ones close enough to sense.
+
+	BuildStimulusGrid();
+
 	// The list of sensing AI is treated like a time-share system.
 	// Each AI gets to process the stimuli until a relevant one is found,
 	// or an expensive check has been performed.
 	// If the AI does not find a stimulus within one update, it will
 	// continue to process the list in subsequent updates.
 
-	AISENSING_LIST::iterator it;
-	for( it = m_lstSensing.begin(); it != m_lstSensing.end(); ++it )
+	// All AIs share a budget of IntersectSegment calls per update.
+	// If it runs out, the AIs that did not get a turn go first
+	// next update.
+
+	int cBudgetIntersectSegmentCalls = INTERSECT_SEGMENT_BUDGET;
+
+	uint32 cSensing = (uint32)m_lstSensing.size();
+	uint32 iFirstSensing = ( m_iNextSensing < cSensing ) ? m_iNextSensing : 0;
+	m_iNextSensing = 0;
+
+	for( uint32 iTurn = 0; iTurn < cSensing; ++iTurn )
 	{
-		pSensing = *it;
+		uint32 iSensing = ( iFirstSensing + iTurn ) % cSensing;
+		pSensing = m_lstSensing[iSensing];
 		
 		// Ignore AIs who are not sensing.
 
@@ -1232,6 +1257,23 @@ void CAIStimulusMgr::UpdateSensingList()
 			continue;
 		}
 
+		// Check if we have already finished processing stimuli for
+		// this sense update (because one has already been found, 
+		// or list has been exhausted), and it is not time for a new one.
+
+		if( ( fCurTime <= pSensing->GetNextSenseUpdate() ) &&
+			( pSensing->GetDoneProcessingStimuli() ) )
+		{
+			continue;
+		}
+
+		// Stop when the budget is spent, and start with this AI next update.
+
+		if( cBudgetIntersectSegmentCalls <= 0 )
+		{
+			m_iNextSensing = iSensing;
+			break;
+		}
 
 		// Each AI is allowed one intersect segment call per update.
 
@@ -1279,35 +1321,43 @@ void CAIStimulusMgr::UpdateSensingList()
 			bNewSenseUpdate = LTTRUE;
 		}
 
-		// Check if we have already finished processing stimuli for
-		// this sense update (because one has already been found, 
-		// or list has been exhausted).
+		// Never allow more than what is left of the budget.
+
+		cPermittedIntersectSegmentCalls = Min( cPermittedIntersectSegmentCalls, cBudgetIntersectSegmentCalls );
+
+		cIntersectSegmentCallsPrev = g_cIntersectSegmentCalls;
+
+		// Find the stimuli this AI might be close enough to sense.
+		// Everything else is too far away for CanSense to pass.
 
-		else if( pSensing->GetDoneProcessingStimuli() ) 
+		LTFLOAT fSenseDistance = 0.f;
+		uint32 flagsSenses = pSensing->GetCurSenseFlags() & m_flagsStimulusSenses;
+		for( uint32 iSense = 0; flagsSenses; ++iSense, flagsSenses >>= 1 )
 		{
-			continue;
+			if( flagsSenses & 1 )
+			{
+				fSenseDistance = Max( fSenseDistance, pSensing->GetSenseDistance( (EnumAISenseType)( 1 << iSense ) ) );
+			}
 		}
 
-		cIntersectSegmentCallsPrev = g_cIntersectSegmentCalls;
+		m_StimulusGrid.GetItemsNear( pSensing->GetSensingPosition(), fSenseDistance, &m_lstNearStimuli );
 
 
 		// Try to sense the nearest player, so that AI in multiplayer
 		// games behave appropriately.
 
-		if( bNewSenseUpdate && SenseNearestPlayer( pSensing ) )
+		if( bNewSenseUpdate && SenseNearestPlayer( pSensing, m_lstNearStimuli ) )
 		{
 			pSensing->SetDoneProcessingStimuli( LTTRUE );
 		}
 
-		// Iterate over existing stimulus records.
+		// Iterate over nearby stimulus records, most alarming first.
 		
 		else {
 
-			for(itRecordPair = m_stmStimuliMap.begin();
-				itRecordPair != m_stmStimuliMap.end();
-				++itRecordPair)
+			for( iNearStimulus = 0; iNearStimulus < m_lstNearStimuli.size(); ++iNearStimulus )
 			{
-				pRecord = itRecordPair->second;
+				pRecord = m_lstStimulusOrder[m_lstNearStimuli[iNearStimulus]];
 
 				if( !pSensing->ProcessStimulus( pRecord ) )
 				{
@@ -1347,11 +1397,15 @@ void CAIStimulusMgr::UpdateSensingList()
 				}
 			}
 		}
+
+		// Charge the budget for every call this AI made.
+
+		cBudgetIntersectSegmentCalls -= g_cIntersectSegmentCalls - cIntersectSegmentCallsPrev;
 		
 		// Call HandleSenses to increment/decrement sense values after a
 		// a stimulus has been found, or the list has been exhausted.
 
-		if( ( pRecord == NULL) ||
+		if( ( m_lstStimulusOrder.empty() ) ||
 			( pSensing->GetDoneProcessingStimuli() ) )
 		{
 			// Handle senses in the AI's sense recorder.  This will check the cycle stamp to
@@ -1363,6 +1417,39 @@ void CAIStimulusMgr::UpdateSensingList()
 	}
 }
 
+//----------------------------------------------------------------------------
+//              
+//	ROUTINE:	CAIStimulusMgr::BuildStimulusGrid()
+//              
+//	PURPOSE:	Put the existing stimuli in the grid, each covering its
+//				own radius.  Grid entries index m_lstStimulusOrder, so
+//				nearby stimuli come out sorted by Alarm level.
+//              
+//----------------------------------------------------------------------------
+
+void CAIStimulusMgr::BuildStimulusGrid()
+{
+	m_StimulusGrid.Clear();
+	m_lstStimulusOrder.clear();
+	m_flagsStimulusSenses = kSense_None;
+
+	CAIStimulusRecord* pRecord;
+	AISTIMULUS_MAP::iterator itRecordPair;
+	for(itRecordPair = m_stmStimuliMap.begin();
+		itRecordPair != m_stmStimuliMap.end();
+		++itRecordPair)
+	{
+		pRecord = itRecordPair->second;
+
+		m_StimulusGrid.AddItem( (uint32)m_lstStimulusOrder.size(), pRecord->m_vStimulusPos, pRecord->m_fDistance );
+		m_lstStimulusOrder.push_back( pRecord );
+
+		m_flagsStimulusSenses |= pRecord->m_pAIBM_Stimulus->eSenseType;
+	}
+
+	m_StimulusGrid.Build();
+}
+
 //----------------------------------------------------------------------------
 //              
 //	ROUTINE:	CAIStimulusMgr::SenseNearestPlayer()
@@ -1373,19 +1460,17 @@ void CAIStimulusMgr::UpdateSensingList()
 //				
 //----------------------------------------------------------------------------
 
-LTBOOL CAIStimulusMgr::SenseNearestPlayer(IAISensing* pSensing)
+LTBOOL CAIStimulusMgr::SenseNearestPlayer(IAISensing* pSensing, const std::vector<uint32>& lstNearStimuli)
 {
 	CAIStimulusRecord* pRecord = LTNULL;
 	CAIStimulusRecord* pNearestPlayerRecord = LTNULL;
 	LTFLOAT fNearestPlayerDistSqr = FLT_MAX;
 	LTFLOAT fPlayerDistSqr;
 
-	AISTIMULUS_MAP::iterator itRecordPair;
-	for(itRecordPair = m_stmStimuliMap.begin();
-		itRecordPair != m_stmStimuliMap.end();
-		++itRecordPair)
+	uint32 iNearStimulus;
+	for( iNearStimulus = 0; iNearStimulus < lstNearStimuli.size(); ++iNearStimulus )
 	{
-		pRecord = itRecordPair->second;
+		pRecord = m_lstStimulusOrder[lstNearStimuli[iNearStimulus]];
 
 		if( pRecord->m_eStimulusType != kStim_EnemyVisible )
 		{
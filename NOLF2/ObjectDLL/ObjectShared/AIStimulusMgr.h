@@ -15,6 +15,7 @@
 #include "AIButeMgr.h"
 #include "AIClassFactory.h"
 #include "ltobjref.h"
+#include "AIStimulusGrid.h"
 
 
 #pragma warning (disable : 4786)
@@ -236,7 +237,8 @@ class CAIStimulusMgr : public ILTObjRefReceiver
 		const CAIStimulusRecord::_listAlignments& AlignmentRequirement ) const;
 
 		void	UpdateSensingList();
-		LTBOOL	SenseNearestPlayer(IAISensing* pSensing);
+		void	BuildStimulusGrid();
+		LTBOOL	SenseNearestPlayer(IAISensing* pSensing, const std::vector<uint32>& lstNearStimuli);
 		bool	CanSense(IAISensing* pSensing,CAIStimulusRecord* pRecord) const;
 
 	private : // Private member variables
@@ -255,6 +257,12 @@ class CAIStimulusMgr : public ILTObjRefReceiver
 		// Do NOT save the following:
 
 		AISENSING_LIST			m_lstSensing;			// List of sensing objects. Recreated as objects activate/deactivate.
+		uint32					m_iNextSensing;			// Sensing object to start with next update, if the last ran out of IntersectSegment calls.
+
+		CAIStimulusGrid			m_StimulusGrid;			// Stimuli by position.  Rebuilt every update.
+		std::vector<CAIStimulusRecord*> m_lstStimulusOrder;	// Stimuli in the grid, sorted by Alarm level.
+		uint32					m_flagsStimulusSenses;	// Senses of all stimuli in the grid.
+		std::vector<uint32>		m_lstNearStimuli;		// Stimuli near the sensing object being updated.
 };
 
 #endif
@@ -781,6 +781,7 @@ AIVolume::AIVolume()
 	}
 	
 	m_nPathIndex = 0;
+	m_iPathNode = 0;
 }
 
 AIVolume::~AIVolume()
@@ -402,6 +402,9 @@ class AIVolume : public AISpatialRepresentation
 		uint32 GetPathIndex() const { return m_nPathIndex; }
 		void SetPathIndex(uint32 nPathIndex) { m_nPathIndex = nPathIndex; }
 
+		uint32 GetPathNodeIndex() const { return m_iPathNode; }
+		void SetPathNodeIndex(uint32 iPathNode) { m_iPathNode = iPathNode; }
+
 		virtual AIVolumeNeighbor* GetNeighborByIndex(uint32 iNeighbor);
 
 		// Type 
@@ -441,6 +444,7 @@ class AIVolume : public AISpatialRepresentation
 		LTVector			m_vEntryPosition;
 		LTVector			m_vWalkthroughPosition;
 		uint32				m_nPathIndex;
+		uint32				m_iPathNode;
 };
 
 // ----------------------------------------------------------------------- //
@@ -552,6 +552,34 @@ void Door::SetPowerOff( )
 	ActiveWorldModel::SetPowerOff( );
 	
 	PlayDoorKnobAni( "Open" );
+
+	// AI can path through locked doors only while they're open.
+
+	if( IsLocked() )
+	{
+		g_pAIPathMgr->InvalidatePathKnowledge();
+	}
+}
+
+
+// ----------------------------------------------------------------------- //
+//
+//  ROUTINE:	Door::SetOn
+//
+//  PURPOSE:	The door finished opening
+//
+// ----------------------------------------------------------------------- //
+
+void Door::SetOn( LTBOOL bInitialize )
+{
+	ActiveWorldModel::SetOn( bInitialize );
+
+	// AI can path through locked doors only while they're open.
+
+	if( IsLocked() && !bInitialize )
+	{
+		g_pAIPathMgr->InvalidatePathKnowledge();
+	}
 }
 
 
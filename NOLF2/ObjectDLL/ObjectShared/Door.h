@@ -77,6 +77,7 @@ class Door : public ActiveWorldModel
 
 		virtual void	SetPowerOn( );
 		virtual void	SetPowerOff( );
+		virtual void	SetOn( LTBOOL bInitialize = LTFALSE );
 
 		// Activation...
 
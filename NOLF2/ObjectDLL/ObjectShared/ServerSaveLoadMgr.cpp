@@ -88,7 +88,9 @@ bool CServerSaveLoadMgr::Init( char const* pszProfileName, bool bUseMultiplayerF
 	m_eSaveDataState = eSaveDataStateNone;
 	m_bPlayerTrackerAborted = false;
 
-	// Clear working dir since we're starting fresh.
+	// Clear working dir since we're starting fresh.  Let any saves the engine
+	// is writing in the background finish first.
+	g_pLTServer->FlushSaveObjects( );
 	ClearWorkingDir( );
 
 	return true;
@@ -248,6 +250,9 @@ bool CServerSaveLoadMgr::LoadSaveFile( char const* pszSaveIniKey, char const* ps
 	if( !szWorldName[0] )
 		return false;
 
+	// Make sure the engine has finished writing the save dir.
+	g_pLTServer->FlushSaveObjects( );
+
 	if( !CopyToWorkingDir( pszSaveDir ))
 		return false;
 
@@ -1166,7 +1171,9 @@ bool CServerSaveLoadMgr::FinishSaveGame( )
 		return false;
 	}
 
-	// Copy in the save dir.
+	// Copy in the save dir.  The last save into it may still be being
+	// written in the background, so wait for it first.
+	g_pLTServer->FlushSaveObjects( );
 	if( !CopyWorkingDir( m_sSaveGameDir )) 
 		return false;
 
@@ -1225,8 +1232,10 @@ bool CServerSaveLoadMgr::FinishSaveGame( )
 
 	if( pSaveList->m_nInList > 0 )
 	{
+		// Nothing else touches the save dir until it's loaded or saved over,
+		// and those flush first, so let the engine write it in the background.
         LTRESULT dResult = g_pLTServer->SaveObjects(( char* )( char const* )m_sSaveGameFile, pSaveList, LOAD_RESTORE_GAME,
-												 SAVEOBJECTS_SAVEGAMECONSOLE);
+												 SAVEOBJECTS_SAVEGAMECONSOLE | SAVEOBJECTS_BACKGROUNDWRITE);
 		if (dResult != LT_OK)
 		{
             ASSERT( !"CGameServerShell::FinishSaveGame: Couldn't save objects!" );
@@ -2,6 +2,9 @@
 #ifndef _FASTHEAP_H_
 #define _FASTHEAP_H_
 
+#include <algorithm>
+#include <vector>
+
 /* 
 
   ...to use a CFastHeap for heaping CFoo*'s , define a class like:
@@ -137,4 +140,75 @@ inline void CFastHeap<TYPE, SIZE, COMPARE>::Heapify(int iTYPE)
 	}
 }
 
+
+/*
+
+  ...a CGrowableHeap holds TYPEs by value and grows as needed, so it has no
+  size limit.  It takes the same kind of CompareFunction, only on values:
+
+struct CompareFunction
+{
+	inline bool operator()(const CFoo& foo1, const CFoo& foo2) const
+	{
+		return foo1.m_fPriority > foo2.m_fPriority;
+	}
+};
+
+  ...there's no Update.  To change something's key, push it again with the
+  new key, and skip the old copy when it gets popped (it's stale if its key
+  doesn't match the current one).  That makes each change O(log n) instead
+  of a search through the heap.
+
+*/
+
+template <class TYPE, class COMPARE>
+class CGrowableHeap
+{
+	public :
+
+		inline void Push(const TYPE& type);
+		inline TYPE Pop();
+
+		inline void Clear() { m_aTYPEs.clear(); }
+		inline void Reserve(int nSize) { m_aTYPEs.reserve(nSize); }
+
+		inline bool IsEmpty() const { return m_aTYPEs.empty(); }
+
+		inline int GetSize() const { return (int)m_aTYPEs.size(); }
+
+	protected :
+
+		// std::push_heap keeps the largest element on top by operator<, so
+		// "less" means a lower heap key.
+
+		struct LowerKey
+		{
+			inline bool operator()(const TYPE& type1, const TYPE& type2) const
+			{
+				COMPARE comp;
+				return comp(type2, type1);
+			}
+		};
+
+	protected :
+
+		std::vector<TYPE>	m_aTYPEs;
+};
+
+template <class TYPE, class COMPARE>
+inline void CGrowableHeap<TYPE, COMPARE>::Push(const TYPE& type)
+{
+	m_aTYPEs.push_back(type);
+	std::push_heap(m_aTYPEs.begin(), m_aTYPEs.end(), LowerKey());
+}
+
+template <class TYPE, class COMPARE>
+inline TYPE CGrowableHeap<TYPE, COMPARE>::Pop()
+{
+	std::pop_heap(m_aTYPEs.begin(), m_aTYPEs.end(), LowerKey());
+	TYPE type = m_aTYPEs.back();
+	m_aTYPEs.pop_back();
+	return type;
+}
+
 #endif
@@ -112,7 +112,7 @@ LTBOOL CGameButeMgr::Parse(const char* sButeFile)
 		}
 		else
 		{
-			bRet = m_buteMgr.Parse(m_strAttributeFile);
+			bRet = ParseCompiled(m_strAttributeFile);
 		}
 
 		return bRet;
@@ -209,6 +209,51 @@ LTBOOL CGameButeMgr::Parse(const char* sButeFile)
 	return(TRUE);
 }
 
+// ----------------------------------------------------------------------- //
+//
+//	ROUTINE:	CGameButeMgr::ParseCompiled()
+//
+//	PURPOSE:	Parse a file on disk through a compiled copy kept next to
+//				it, recompiling the copy whenever the text has changed
+//
+// ----------------------------------------------------------------------- //
+
+LTBOOL CGameButeMgr::ParseCompiled(const char* sButeFile)
+{
+	std::ifstream is(sButeFile, std::ios_base::binary);
+	if (!is)
+		return(LTFALSE);
+
+	std::vector<char> data((std::istreambuf_iterator<char>(is)), std::istreambuf_iterator<char>());
+	is.close();
+
+	if (data.empty())
+	{
+		return m_buteMgr.Parse(sButeFile);
+	}
+
+	uint32 nSourceHash = CButeMgr::HashSource(&data[0], (unsigned long)data.size());
+
+	CString strCompiledFile;
+	strCompiledFile.Format("%sc", sButeFile);
+
+	if (m_buteMgr.LoadCompiled(strCompiledFile, nSourceHash, sButeFile))
+	{
+		return(LTTRUE);
+	}
+
+	if (!m_buteMgr.Parse(&data[0], (unsigned long)data.size(), 0, sButeFile))
+	{
+		return(LTFALSE);
+	}
+
+	// If the copy can't be written the next load just parses the text again.
+	m_buteMgr.SaveCompiled(strCompiledFile, nSourceHash);
+
+	return(LTTRUE);
+}
+
+
 // ----------------------------------------------------------------------- //
 //
 //	ROUTINE:	CGameButeMgr::Save()
@@ -105,6 +105,7 @@ class CGameButeMgr
         LTBOOL       m_bInRezFile;
 
         LTBOOL       Parse(const char* sButeFile);
+        LTBOOL       ParseCompiled(const char* sButeFile);
 };
 
 
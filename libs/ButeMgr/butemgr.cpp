@@ -5,6 +5,17 @@
 #include "stdafx.h"
 #include "butemgr.h"
 
+#include <algorithm>
+#include <map>
+#include <string>
+
+#if defined(__LINUX)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #if defined(_DEBUG)
 	#define new DEBUG_NEW
 #endif
@@ -287,6 +298,13 @@ CButeMgr::CButeMgr()
 
 	m_pCurrTabOfItems = 0;
 
+	// m_KeyIndexEntries
+	// m_KeyIndexDisps
+	// m_KeyIndexSlots
+	// m_KeyIndexNames
+	m_nKeyIndexSeed = 0;
+	m_nKeyIndexTags = 0;
+
 	m_pData = 0;
 	m_pSaveData = 0;
 
@@ -433,6 +451,14 @@ void CButeMgr::Term( )
 	m_newTagTab.clear();
 	//m_stringHolder.clear();
 
+	// The key index points at the items freed above.
+	m_KeyIndexEntries.clear();
+	m_KeyIndexDisps.clear();
+	m_KeyIndexSlots.clear();
+	m_KeyIndexNames.clear();
+	m_nKeyIndexSeed = 0;
+	m_nKeyIndexTags = 0;
+
 	m_RectBank.Init( 8, 0 );
 	m_PointBank.Init( 8, 0 );
 	m_AVectorBank.Init( 8, 0 );
@@ -1537,7 +1563,19 @@ CButeMgr::CSymTabItem* CButeMgr::FindSymTabItem( char const* pszTagName, char co
 
 	TableOfItems* pTabOfItems;
 
-	pTabOfItems = FindTableOfItems( m_tagTab, pszTagName );
+	// Keys loaded from a compiled file are found through its perfect hash index.
+	// Unless other files were parsed in since, the index covers the whole main table.
+	bool bCheckMainTable = true;
+	if( !m_KeyIndexSlots.empty( ))
+	{
+		CSymTabItem* pItem = FindIndexedSymTabItem( pszTagName, pszAttName );
+		if (pItem)
+			return pItem;
+
+		bCheckMainTable = ( m_tagTab.size( ) != m_nKeyIndexTags );
+	}
+
+	pTabOfItems = bCheckMainTable ? FindTableOfItems( m_tagTab, pszTagName ) : NULL;
 	if( pTabOfItems )
 	{
 		CSymTabItem* pItem = FindSymTabItem( *pTabOfItems, pszAttName );
@@ -2331,3 +2369,844 @@ void CButeMgr::TraverseTableOfTags( TableOfTags& tableOfTags, TraverseTableOfTag
 		iter++;
 	}
 }
+
+
+
+////////////////////////////////////////////////////////////////////////
+//
+// Key handles
+//
+// A key handle is the CSymTabItem itself.  Items in the tables are only
+// ever re-initialized in place by the Set functions, so a handle sees
+// later changes to its key and stays valid until Term.
+//
+////////////////////////////////////////////////////////////////////////
+
+CButeMgr::KeyHandle CButeMgr::GetKeyHandle(const char* szTagName, const char* szAttName)
+{
+	KeyHandle hKey = FindSymTabItem( szTagName, szAttName );
+	m_bSuccess = ( hKey != NULL );
+	return hKey;
+}
+
+
+int CButeMgr::GetInt(KeyHandle hKey, int defVal)
+{
+	m_bSuccess = true;
+	if (hKey)
+	{
+		if (hKey->SymType == IntType)
+			return (hKey->data.i);
+		else
+			DisplayMessage("Type mismatch - key handle");
+	}
+
+	m_bSuccess = false;
+	return defVal;
+}
+
+
+DWORD CButeMgr::GetDword(KeyHandle hKey, DWORD defVal)
+{
+	m_bSuccess = true;
+	if (hKey)
+	{
+		if (hKey->SymType == DwordType)
+			return (hKey->data.dw);
+		else
+			DisplayMessage("Type mismatch - key handle");
+	}
+
+	m_bSuccess = false;
+	return defVal;
+}
+
+
+BYTE CButeMgr::GetByte(KeyHandle hKey, BYTE defVal)
+{
+	m_bSuccess = true;
+	if (hKey)
+	{
+		if (hKey->SymType == ByteType)
+			return (hKey->data.byte);
+		else
+			DisplayMessage("Type mismatch - key handle");
+	}
+
+	m_bSuccess = false;
+	return defVal;
+}
+
+
+bool CButeMgr::GetBool(KeyHandle hKey, bool defVal)
+{
+	m_bSuccess = true;
+	if (hKey)
+	{
+		if (hKey->SymType == BoolType)
+			return (hKey->data.b);
+		else
+			DisplayMessage("Type mismatch - key handle");
+	}
+
+	m_bSuccess = false;
+	return defVal;
+}
+
+
+float CButeMgr::GetFloat(KeyHandle hKey, float defVal)
+{
+	m_bSuccess = true;
+	if (hKey)
+	{
+		switch (hKey->SymType)
+		{
+		case FloatType:
+			return (hKey->data.f);
+		case IntType:
+			return (float)((hKey->data.i));
+		default:
+			DisplayMessage("Type mismatch - key handle");
+		}
+	}
+
+	m_bSuccess = false;
+	return defVal;
+}
+
+
+double CButeMgr::GetDouble(KeyHandle hKey, double defVal)
+{
+	m_bSuccess = true;
+	if (hKey)
+	{
+		switch (hKey->SymType)
+		{
+		case DoubleType:
+			return (hKey->data.d);
+		case IntType:
+			return (double)((hKey->data.i));
+		default:
+			DisplayMessage("Type mismatch - key handle");
+		}
+	}
+
+	m_bSuccess = false;
+	return defVal;
+}
+
+
+const char *CButeMgr::GetString(KeyHandle hKey, const char *defVal)
+{
+	m_bSuccess = true;
+	if (hKey)
+	{
+		if (hKey->SymType == StringType)
+			return *(hKey->data.s);
+		else
+			DisplayMessage("Type mismatch - key handle");
+	}
+
+	m_bSuccess = false;
+	return defVal;
+}
+
+
+CRect& CButeMgr::GetRect(KeyHandle hKey, CRect& defVal)
+{
+	m_bSuccess = true;
+	if (hKey)
+	{
+		if (hKey->SymType == RectType)
+			return *(hKey->data.r);
+		else
+			DisplayMessage("Type mismatch - key handle");
+	}
+
+	m_bSuccess = false;
+	return defVal;
+}
+
+
+CPoint& CButeMgr::GetPoint(KeyHandle hKey, CPoint& defVal)
+{
+	m_bSuccess = true;
+	if (hKey)
+	{
+		if (hKey->SymType == PointType)
+			return *(hKey->data.point);
+		else
+			DisplayMessage("Type mismatch - key handle");
+	}
+
+	m_bSuccess = false;
+	return defVal;
+}
+
+
+const CAVector& CButeMgr::GetVector(KeyHandle hKey, const CAVector& defVal)
+{
+	m_bSuccess = true;
+	if (hKey)
+	{
+		if (hKey->SymType == VectorType)
+			return *(hKey->data.v);
+		else
+			DisplayMessage("Type mismatch - key handle");
+	}
+
+	m_bSuccess = false;
+	return defVal;
+}
+
+
+CARange& CButeMgr::GetRange(KeyHandle hKey, CARange& defVal)
+{
+	m_bSuccess = true;
+	if (hKey)
+	{
+		if (hKey->SymType == RangeType)
+			return *(hKey->data.range);
+		else
+			DisplayMessage("Type mismatch - key handle");
+	}
+
+	m_bSuccess = false;
+	return defVal;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+//
+// Compiled attribute files
+//
+// The image is a header followed by the item records, the tag records,
+// the perfect hash displacements and slots, and the string pool.  It
+// holds no pointers, everything is an index or a string pool offset, so
+// it can be read straight out of a mapped file.  The image is in native
+// byte order; it is a cache, not a distribution format.
+//
+// The index is hash and displace: a key hashes to a bucket, and the
+// bucket's displacement picks the key's slot.  Displacements are chosen
+// when compiling so that no two keys share a slot.
+//
+////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+	const uint32 kCompiledMagic		= 'B' | ('U' << 8) | ('T' << 16) | ('C' << 24);
+	const uint32 kCompiledVersion	= 1;
+	const uint32 kEmptySlot			= 0xFFFFFFFF;
+	const uint32 kMaxDisp			= 1 << 16;
+	const uint32 kMaxSeeds			= 32;
+
+	struct CompiledHeader
+	{
+		uint32 m_nMagic;
+		uint32 m_nVersion;
+		uint32 m_nSourceHash;
+		uint32 m_nChecksum;
+		uint32 m_nNumTags;
+		uint32 m_nNumItems;
+		uint32 m_nNumBuckets;
+		uint32 m_nNumSlots;
+		uint32 m_nSeed;
+		uint32 m_nStringsSize;
+	};
+
+	struct CompiledTag
+	{
+		uint32 m_nName;
+		uint32 m_nFirstItem;
+		uint32 m_nNumItems;
+	};
+
+	struct CompiledItem
+	{
+		uint32 m_nName;
+		uint32 m_nType;
+		union
+		{
+			int32 m_nInt[4];		// int, byte, bool, string pool offset, rect, point
+			uint64 m_nDword;
+			float m_fFloat;
+			double m_fDouble[3];	// double, vector, range
+		} m_Value;
+	};
+
+	// Section offsets, all derived from the counts in the header.
+	struct CompiledLayout
+	{
+		CompiledLayout( CompiledHeader const& header )
+		{
+			m_nItems = Align( sizeof( CompiledHeader ));
+			m_nTags = Align( m_nItems + (uint64)header.m_nNumItems * sizeof( CompiledItem ));
+			m_nDisps = m_nTags + (uint64)header.m_nNumTags * sizeof( CompiledTag );
+			m_nSlots = m_nDisps + (uint64)header.m_nNumBuckets * sizeof( uint32 );
+			m_nStrings = m_nSlots + (uint64)header.m_nNumSlots * sizeof( uint32 );
+			m_nSize = m_nStrings + header.m_nStringsSize;
+		}
+
+		static uint64 Align( uint64 nOffset ) { return ( nOffset + 7 ) & ~(uint64)7; }
+
+		uint64 m_nItems;
+		uint64 m_nTags;
+		uint64 m_nDisps;
+		uint64 m_nSlots;
+		uint64 m_nStrings;
+		uint64 m_nSize;
+	};
+
+	inline uint8 ToLower( char c )
+	{
+		return ( c >= 'A' && c <= 'Z' ) ? (uint8)( c - 'A' + 'a' ) : (uint8)c;
+	}
+
+	bool IsEqualNoCase( char const* pszA, char const* pszB )
+	{
+		for( ; ToLower( *pszA ) == ToLower( *pszB ); ++pszA, ++pszB )
+		{
+			if( !*pszA )
+				return true;
+		}
+		return false;
+	}
+
+	// Case insensitive 64 bit FNV-1a over both names, finished with the
+	// MurmurHash3 mixer so that both halves can be used.
+	uint64 HashKey( char const* pszTagName, char const* pszAttName, uint32 nSeed )
+	{
+		uint64 nHash = 14695981039346656037ULL ^ nSeed;
+		for( ; *pszTagName; ++pszTagName )
+			nHash = ( nHash ^ ToLower( *pszTagName )) * 1099511628211ULL;
+
+		// Keep "ab" + "c" apart from "a" + "bc".
+		nHash = ( nHash ^ 0xFF ) * 1099511628211ULL;
+
+		for( ; *pszAttName; ++pszAttName )
+			nHash = ( nHash ^ ToLower( *pszAttName )) * 1099511628211ULL;
+
+		nHash ^= nHash >> 33;
+		nHash *= 0xFF51AFD7ED558CCDULL;
+		nHash ^= nHash >> 33;
+		nHash *= 0xC4CEB9FE1A85EC53ULL;
+		nHash ^= nHash >> 33;
+		return nHash;
+	}
+
+	inline uint32 KeyBucket( uint64 nHash, uint32 nNumBuckets )
+	{
+		return (uint32)nHash % nNumBuckets;
+	}
+
+	inline uint32 KeySlot( uint64 nHash, uint32 nDisp, uint32 nNumSlots )
+	{
+		uint32 nSlot = (uint32)( nHash >> 32 ) + nDisp * 0x9E3779B9;
+		nSlot ^= nSlot >> 16;
+		nSlot *= 0x85EBCA6B;
+		nSlot ^= nSlot >> 13;
+		nSlot *= 0xC2B2AE35;
+		nSlot ^= nSlot >> 16;
+		return nSlot % nNumSlots;
+	}
+
+	struct KeyNames
+	{
+		char const* m_pszTagName;
+		char const* m_pszAttName;
+	};
+
+	// Places the buckets largest first, each at the first displacement that puts
+	// all of its keys in free slots.  Fails if some bucket can't be placed, which
+	// a different seed will fix.
+	bool BuildKeyIndex( std::vector< KeyNames > const& keys, uint32 nSeed, uint32 nNumBuckets, uint32 nNumSlots,
+		std::vector< uint32 >& disps, std::vector< uint32 >& slots )
+	{
+		std::vector< uint64 > hashes( keys.size( ));
+		std::vector< std::vector< uint32 > > buckets( nNumBuckets );
+		for( uint32 nKey = 0; nKey < keys.size( ); ++nKey )
+		{
+			hashes[nKey] = HashKey( keys[nKey].m_pszTagName, keys[nKey].m_pszAttName, nSeed );
+			buckets[KeyBucket( hashes[nKey], nNumBuckets )].push_back( nKey );
+		}
+
+		std::vector< uint32 > order( nNumBuckets );
+		for( uint32 nBucket = 0; nBucket < nNumBuckets; ++nBucket )
+			order[nBucket] = nBucket;
+		std::stable_sort( order.begin( ), order.end( ),
+			[&buckets]( uint32 nA, uint32 nB ) { return buckets[nA].size( ) > buckets[nB].size( ); } );
+
+		disps.assign( nNumBuckets, 0 );
+		slots.assign( nNumSlots, kEmptySlot );
+
+		std::vector< uint32 > bucketSlots;
+		for( uint32 nOrder = 0; nOrder < nNumBuckets; ++nOrder )
+		{
+			std::vector< uint32 > const& bucket = buckets[order[nOrder]];
+			if( bucket.empty( ))
+				break;
+
+			uint32 nDisp;
+			for( nDisp = 0; nDisp < kMaxDisp; ++nDisp )
+			{
+				bucketSlots.clear( );
+				for( uint32 nKey = 0; nKey < bucket.size( ); ++nKey )
+				{
+					uint32 nSlot = KeySlot( hashes[bucket[nKey]], nDisp, nNumSlots );
+					if( slots[nSlot] != kEmptySlot ||
+						std::find( bucketSlots.begin( ), bucketSlots.end( ), nSlot ) != bucketSlots.end( ))
+						break;
+					bucketSlots.push_back( nSlot );
+				}
+
+				if( bucketSlots.size( ) == bucket.size( ))
+					break;
+			}
+
+			if( nDisp == kMaxDisp )
+				return false;
+
+			disps[order[nOrder]] = nDisp;
+			for( uint32 nKey = 0; nKey < bucket.size( ); ++nKey )
+				slots[bucketSlots[nKey]] = bucket[nKey];
+		}
+
+		return true;
+	}
+}
+
+
+////////////////////////////////////////////////////////////////////////
+//
+// CButeMgr::HashSource
+//
+// Return:		uint32 - Hash of the data.
+// Argument:	const void* pData - Attribute file text, as handed to Parse.
+// Argument:	unsigned long size - Size of the data.
+//
+// Description:	32 bit FNV-1a of the attribute text.  A compiled file
+//				records the hash of the text it was compiled from.
+//
+////////////////////////////////////////////////////////////////////////
+uint32 CButeMgr::HashSource( const void* pData, unsigned long size )
+{
+	uint8 const* pByte = ( uint8 const* )pData;
+	uint32 nHash = 2166136261u;
+	for( unsigned long i = 0; i < size; ++i )
+		nHash = ( nHash ^ pByte[i] ) * 16777619u;
+
+	return nHash;
+}
+
+
+////////////////////////////////////////////////////////////////////////
+//
+// CButeMgr::SaveCompiled
+//
+// Return:		bool - true if the file was written.
+// Argument:	const char* szFileName - File to write.
+// Argument:	uint32 nSourceHash - HashSource of the parsed text.
+//
+// Description:	Writes the main tag table as a compiled image.  Values set
+//				since parsing are written too, so call this right after
+//				parsing.  The auxiliary and new tag tables are not written.
+//
+////////////////////////////////////////////////////////////////////////
+bool CButeMgr::SaveCompiled( const char* szFileName, uint32 nSourceHash )
+{
+	if( !szFileName )
+		return false;
+
+	std::vector< CompiledTag > tags;
+	std::vector< CompiledItem > items;
+	std::vector< KeyNames > keys;
+
+	// Names repeat across tags, so the pool only holds each string once.
+	std::vector< char > strings;
+	std::map< std::string, uint32 > stringOffsets;
+	auto AddPoolString = [&strings, &stringOffsets]( char const* pszString ) -> uint32
+	{
+		std::pair< std::map< std::string, uint32 >::iterator, bool > pr =
+			stringOffsets.insert( std::make_pair( std::string( pszString ), (uint32)strings.size( )));
+		if( pr.second )
+			strings.insert( strings.end( ), pszString, pszString + strlen( pszString ) + 1 );
+		return pr.first->second;
+	};
+
+	for( TableOfTags::iterator iterTag = m_tagTab.begin( ); iterTag != m_tagTab.end( ); ++iterTag )
+	{
+		TableOfItems* pTableOfItems = (*iterTag).second;
+		if( !pTableOfItems )
+			continue;
+
+		CompiledTag tag;
+		tag.m_nName = AddPoolString( (*iterTag).first );
+		tag.m_nFirstItem = (uint32)items.size( );
+		tag.m_nNumItems = 0;
+
+		for( TableOfItems::iterator iterItem = pTableOfItems->begin( ); iterItem != pTableOfItems->end( ); ++iterItem )
+		{
+			CSymTabItem* pSymTabItem = (*iterItem).second;
+			if( !pSymTabItem )
+				continue;
+
+			CompiledItem item;
+			memset( &item, 0, sizeof( item ));
+			item.m_nName = AddPoolString( (*iterItem).first );
+			item.m_nType = pSymTabItem->SymType;
+
+			switch( pSymTabItem->SymType )
+			{
+			case IntType:
+				item.m_Value.m_nInt[0] = pSymTabItem->data.i;
+				break;
+			case DwordType:
+				item.m_Value.m_nDword = pSymTabItem->data.dw;
+				break;
+			case ByteType:
+				item.m_Value.m_nInt[0] = pSymTabItem->data.byte;
+				break;
+			case BoolType:
+				item.m_Value.m_nInt[0] = pSymTabItem->data.b;
+				break;
+			case DoubleType:
+				item.m_Value.m_fDouble[0] = pSymTabItem->data.d;
+				break;
+			case FloatType:
+				item.m_Value.m_fFloat = pSymTabItem->data.f;
+				break;
+			case StringType:
+				item.m_Value.m_nInt[0] = AddPoolString( *pSymTabItem->data.s );
+				break;
+			case RectType:
+				item.m_Value.m_nInt[0] = pSymTabItem->data.r->left;
+				item.m_Value.m_nInt[1] = pSymTabItem->data.r->top;
+				item.m_Value.m_nInt[2] = pSymTabItem->data.r->right;
+				item.m_Value.m_nInt[3] = pSymTabItem->data.r->bottom;
+				break;
+			case PointType:
+				item.m_Value.m_nInt[0] = pSymTabItem->data.point->x;
+				item.m_Value.m_nInt[1] = pSymTabItem->data.point->y;
+				break;
+			case VectorType:
+				item.m_Value.m_fDouble[0] = pSymTabItem->data.v->Geti( );
+				item.m_Value.m_fDouble[1] = pSymTabItem->data.v->Getj( );
+				item.m_Value.m_fDouble[2] = pSymTabItem->data.v->Getk( );
+				break;
+			case RangeType:
+				item.m_Value.m_fDouble[0] = pSymTabItem->data.range->GetMin( );
+				item.m_Value.m_fDouble[1] = pSymTabItem->data.range->GetMax( );
+				break;
+			default:
+				break;
+			}
+
+			KeyNames names = { (*iterTag).first, (*iterItem).first };
+			keys.push_back( names );
+			items.push_back( item );
+			++tag.m_nNumItems;
+		}
+
+		tags.push_back( tag );
+	}
+
+	if( strings.empty( ))
+		strings.push_back( 0 );
+
+	CompiledHeader header;
+	memset( &header, 0, sizeof( header ));
+	header.m_nMagic = kCompiledMagic;
+	header.m_nVersion = kCompiledVersion;
+	header.m_nSourceHash = nSourceHash;
+	header.m_nChecksum = (uint32)m_checksum;
+	header.m_nNumTags = (uint32)tags.size( );
+	header.m_nNumItems = (uint32)items.size( );
+	header.m_nNumBuckets = header.m_nNumItems / 4 + 1;
+	header.m_nNumSlots = header.m_nNumItems + header.m_nNumItems / 4 + 1;
+	header.m_nStringsSize = (uint32)strings.size( );
+
+	std::vector< uint32 > disps;
+	std::vector< uint32 > slots;
+	for( ;; ++header.m_nSeed )
+	{
+		if( header.m_nSeed == kMaxSeeds )
+			return false;
+
+		if( BuildKeyIndex( keys, header.m_nSeed, header.m_nNumBuckets, header.m_nNumSlots, disps, slots ))
+			break;
+	}
+
+	// Lay out the image and write it in one go.
+	CompiledLayout layout( header );
+	std::vector< char > image( (size_t)layout.m_nSize, 0 );
+	memcpy( &image[0], &header, sizeof( header ));
+	if( !items.empty( ))
+		memcpy( &image[(size_t)layout.m_nItems], &items[0], items.size( ) * sizeof( CompiledItem ));
+	if( !tags.empty( ))
+		memcpy( &image[(size_t)layout.m_nTags], &tags[0], tags.size( ) * sizeof( CompiledTag ));
+	memcpy( &image[(size_t)layout.m_nDisps], &disps[0], disps.size( ) * sizeof( uint32 ));
+	memcpy( &image[(size_t)layout.m_nSlots], &slots[0], slots.size( ) * sizeof( uint32 ));
+	memcpy( &image[(size_t)layout.m_nStrings], &strings[0], strings.size( ));
+
+	std::ofstream os( szFileName, std::ios_base::binary | std::ios_base::trunc );
+	if( !os )
+		return false;
+
+	os.write( &image[0], (std::streamsize)image.size( ));
+	return !os.fail( );
+}
+
+
+////////////////////////////////////////////////////////////////////////
+//
+// CButeMgr::LoadCompiled
+//
+// Return:		bool - true if the compiled file was loaded.
+// Argument:	const char* szFileName - Compiled file to load.
+// Argument:	uint32 nSourceHash - HashSource of the current text.
+// Argument:	CString sAttributeFilename - Text file, for Save.
+//
+// Description:	Maps the compiled file and loads it.  Returns false without
+//				touching the tables if the file is missing, stale or bad,
+//				in which case the caller should parse the text instead.
+//
+////////////////////////////////////////////////////////////////////////
+bool CButeMgr::LoadCompiled( const char* szFileName, uint32 nSourceHash, CString sAttributeFilename )
+{
+	if( !szFileName )
+		return false;
+
+#if defined(__LINUX)
+	int nFile = open( szFileName, O_RDONLY );
+	if( nFile < 0 )
+		return false;
+
+	struct stat fileStat;
+	if( fstat( nFile, &fileStat ) != 0 || fileStat.st_size <= 0 )
+	{
+		close( nFile );
+		return false;
+	}
+
+	size_t nSize = (size_t)fileStat.st_size;
+	void* pImage = mmap( NULL, nSize, PROT_READ, MAP_PRIVATE, nFile, 0 );
+	close( nFile );
+	if( pImage == MAP_FAILED )
+		return false;
+
+	bool bRet = LoadCompiled( pImage, (unsigned long)nSize, nSourceHash, sAttributeFilename );
+
+	munmap( pImage, nSize );
+	return bRet;
+#else
+	std::ifstream is( szFileName, std::ios_base::binary );
+	if( !is )
+		return false;
+
+	is.seekg( 0, std::ios_base::end );
+	std::streamoff nSize = is.tellg( );
+	is.seekg( 0 );
+	if( nSize <= 0 )
+		return false;
+
+	std::vector< char > image( (size_t)nSize );
+	is.read( &image[0], nSize );
+	if( is.gcount( ) != nSize )
+		return false;
+
+	return LoadCompiled( &image[0], (unsigned long)nSize, nSourceHash, sAttributeFilename );
+#endif
+}
+
+
+bool CButeMgr::LoadCompiled( const void* pData, unsigned long size, uint32 nSourceHash, CString sAttributeFilename )
+{
+	if( !pData || size < sizeof( CompiledHeader ))
+		return false;
+
+	uint8 const* pImage = ( uint8 const* )pData;
+
+	CompiledHeader header;
+	memcpy( &header, pImage, sizeof( header ));
+	if( header.m_nMagic != kCompiledMagic || header.m_nVersion != kCompiledVersion ||
+		header.m_nSourceHash != nSourceHash )
+		return false;
+
+	CompiledLayout layout( header );
+	if( layout.m_nSize != size || !header.m_nNumBuckets || !header.m_nNumSlots || !header.m_nStringsSize )
+		return false;
+
+	// Records are copied out rather than cast in place, the image needn't be aligned.
+	char const* pStrings = ( char const* )( pImage + layout.m_nStrings );
+	if( pStrings[header.m_nStringsSize - 1] != 0 )
+		return false;
+
+	std::vector< CompiledTag > tags( header.m_nNumTags );
+	if( !tags.empty( ))
+		memcpy( &tags[0], pImage + layout.m_nTags, tags.size( ) * sizeof( CompiledTag ));
+
+	// Check the whole image before touching the tables, so that a bad one leaves
+	// the manager ready to parse the text instead.
+	uint32 nNextItem = 0;
+	for( uint32 nTag = 0; nTag < header.m_nNumTags; ++nTag )
+	{
+		CompiledTag const& tag = tags[nTag];
+		if( tag.m_nName >= header.m_nStringsSize || tag.m_nFirstItem != nNextItem ||
+			tag.m_nNumItems > header.m_nNumItems - nNextItem )
+			return false;
+
+		if( FindTableOfItems( m_tagTab, pStrings + tag.m_nName ))
+		{
+			DisplayMessage("Duplicate tag encountered - %s", pStrings + tag.m_nName);
+			return false;
+		}
+
+		nNextItem += tag.m_nNumItems;
+	}
+	if( nNextItem != header.m_nNumItems )
+		return false;
+
+	for( uint32 nItem = 0; nItem < header.m_nNumItems; ++nItem )
+	{
+		CompiledItem item;
+		memcpy( &item, pImage + layout.m_nItems + (uint64)nItem * sizeof( CompiledItem ), sizeof( item ));
+		if( item.m_nName >= header.m_nStringsSize || item.m_nType > RangeType )
+			return false;
+		if( item.m_nType == StringType && (uint32)item.m_Value.m_nInt[0] >= header.m_nStringsSize )
+			return false;
+	}
+
+	std::vector< uint32 > slots( header.m_nNumSlots );
+	memcpy( &slots[0], pImage + layout.m_nSlots, slots.size( ) * sizeof( uint32 ));
+	for( uint32 nSlot = 0; nSlot < header.m_nNumSlots; ++nSlot )
+	{
+		if( slots[nSlot] != kEmptySlot && slots[nSlot] >= header.m_nNumItems )
+			return false;
+	}
+
+	Reset();
+	m_sAttributeFilename = sAttributeFilename;
+	m_checksum = header.m_nChecksum;
+
+	// The index can only stand in for the main table if it covers all of it.
+	bool bInstallIndex = m_tagTab.empty( );
+	if( bInstallIndex )
+	{
+		m_KeyIndexEntries.resize( header.m_nNumItems );
+		m_KeyIndexDisps.resize( header.m_nNumBuckets );
+		memcpy( &m_KeyIndexDisps[0], pImage + layout.m_nDisps, m_KeyIndexDisps.size( ) * sizeof( uint32 ));
+		m_KeyIndexSlots.swap( slots );
+		m_KeyIndexNames.assign( pStrings, pStrings + header.m_nStringsSize );
+		m_nKeyIndexSeed = header.m_nSeed;
+		m_nKeyIndexTags = header.m_nNumTags;
+	}
+
+#if defined(__LINUX)
+	// Every tag and item name goes into the string holder, and so may a value.
+	m_tagTab.reserve( m_tagTab.size( ) + header.m_nNumTags );
+	m_stringHolder.reserve( m_stringHolder.size( ) + header.m_nNumTags + 2 * header.m_nNumItems );
+#endif
+
+	for( uint32 nTag = 0; nTag < header.m_nNumTags; ++nTag )
+	{
+		CompiledTag const& tag = tags[nTag];
+		TableOfItems* pTableOfItems = CreateTableOfItems( m_tagTab, pStrings + tag.m_nName );
+		if( !pTableOfItems )
+			return false;
+
+#if defined(__LINUX)
+		pTableOfItems->reserve( tag.m_nNumItems );
+#endif
+
+		for( uint32 nItem = tag.m_nFirstItem; nItem < tag.m_nFirstItem + tag.m_nNumItems; ++nItem )
+		{
+			CompiledItem item;
+			memcpy( &item, pImage + layout.m_nItems + (uint64)nItem * sizeof( CompiledItem ), sizeof( item ));
+
+			CSymTabItem* pSymTabItem = CreateSymTabItem( *pTableOfItems, pStrings + item.m_nName );
+			if( !pSymTabItem )
+				return false;
+
+			switch( item.m_nType )
+			{
+			case IntType:
+				pSymTabItem->Init( *this, IntType, (int)item.m_Value.m_nInt[0] );
+				break;
+			case DwordType:
+				pSymTabItem->Init( *this, DwordType, (DWORD)item.m_Value.m_nDword );
+				break;
+			case ByteType:
+				pSymTabItem->Init( *this, ByteType, (BYTE)item.m_Value.m_nInt[0] );
+				break;
+			case BoolType:
+				pSymTabItem->Init( *this, BoolType, item.m_Value.m_nInt[0] != 0 );
+				break;
+			case DoubleType:
+				pSymTabItem->Init( *this, DoubleType, item.m_Value.m_fDouble[0] );
+				break;
+			case FloatType:
+				pSymTabItem->Init( *this, FloatType, item.m_Value.m_fFloat );
+				break;
+			case StringType:
+				pSymTabItem->Init( *this, StringType, pStrings + item.m_Value.m_nInt[0] );
+				break;
+			case RectType:
+				pSymTabItem->Init( *this, RectType, CRect( item.m_Value.m_nInt[0], item.m_Value.m_nInt[1],
+					item.m_Value.m_nInt[2], item.m_Value.m_nInt[3] ));
+				break;
+			case PointType:
+				pSymTabItem->Init( *this, PointType, CPoint( item.m_Value.m_nInt[0], item.m_Value.m_nInt[1] ));
+				break;
+			case VectorType:
+				pSymTabItem->Init( *this, VectorType, CAVector( item.m_Value.m_fDouble[0], item.m_Value.m_fDouble[1],
+					item.m_Value.m_fDouble[2] ));
+				break;
+			case RangeType:
+				pSymTabItem->Init( *this, RangeType, CARange( item.m_Value.m_fDouble[0], item.m_Value.m_fDouble[1] ));
+				break;
+			default:
+				break;
+			}
+
+			if( bInstallIndex )
+			{
+				KeyIndexEntry& entry = m_KeyIndexEntries[nItem];
+				entry.m_nTagName = tag.m_nName;
+				entry.m_nAttName = item.m_nName;
+				entry.m_pItem = pSymTabItem;
+			}
+		}
+	}
+
+	return true;
+}
+
+
+////////////////////////////////////////////////////////////////////////
+//
+// CButeMgr::FindIndexedSymTabItem
+//
+// Return:		CButeMgr::CSymTabItem*	- Found symtabitem.
+// Argument:	const char* pszTagName	- Tag to find.
+// Argument:	const char* pszAttName - Attribute name to search with.
+//
+// Description:	Finds a CSymTabItem of the main table through the perfect
+//				hash index.  One probe, then a name check.
+//
+////////////////////////////////////////////////////////////////////////
+CButeMgr::CSymTabItem* CButeMgr::FindIndexedSymTabItem( char const* pszTagName, char const* pszAttName )
+{
+	uint64 nHash = HashKey( pszTagName, pszAttName, m_nKeyIndexSeed );
+	uint32 nDisp = m_KeyIndexDisps[KeyBucket( nHash, (uint32)m_KeyIndexDisps.size( ))];
+	uint32 nEntry = m_KeyIndexSlots[KeySlot( nHash, nDisp, (uint32)m_KeyIndexSlots.size( ))];
+	if( nEntry == kEmptySlot )
+		return NULL;
+
+	KeyIndexEntry const& entry = m_KeyIndexEntries[nEntry];
+	if( !IsEqualNoCase( &m_KeyIndexNames[entry.m_nAttName], pszAttName ) ||
+		!IsEqualNoCase( &m_KeyIndexNames[entry.m_nTagName], pszTagName ))
+		return NULL;
+
+	return entry.m_pItem;
+}
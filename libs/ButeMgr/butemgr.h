@@ -27,6 +27,7 @@
 #endif
 
 #include <functional>
+#include <vector>
 #if _MSC_VER >= 1300 && _MSC_VER < 1916 && !defined(__clang__)
 #	include <iosfwd>
 #	include <strstream>
@@ -42,6 +43,7 @@
 #   include <iostream>
 #   include <fstream>
 #   include <sstream>
+#   include <strings.h>
 
 struct ci_char_traits : public std::char_traits<char> {
     static char to_upper(char ch) {
@@ -144,8 +146,7 @@ struct equal_str_nocase
 	bool operator()(const char* s1, const char* s2) const
 	{
 #ifndef WIN32
-        ci_string sc1{s1}, sc2{s2};
-		return (sc1 == sc2);
+		return strcasecmp(s1, s2) == 0;
 #else
 		return stricmp(s1, s2) == 0;
 #endif
@@ -359,6 +360,33 @@ public:
 	const char * GetString(const char* szTagName, const char* szAttName, const char * defVal);
 	const char * GetString(const char* szTagName, const char* szAttName);
 
+	// Key handles let hot callers resolve a tag/attribute pair once and then read
+	// the value without looking up the names again.  GetKeyHandle returns NULL if
+	// the key doesn't exist.  Handles stay valid until Term.
+	typedef CSymTabItem* KeyHandle;
+	KeyHandle GetKeyHandle(const char* szTagName, const char* szAttName);
+
+	int GetInt(KeyHandle hKey, int defVal);
+	DWORD GetDword(KeyHandle hKey, DWORD defVal);
+	BYTE GetByte(KeyHandle hKey, BYTE defVal);
+	bool GetBool(KeyHandle hKey, bool defVal);
+	float GetFloat(KeyHandle hKey, float defVal);
+	double GetDouble(KeyHandle hKey, double defVal);
+	const char * GetString(KeyHandle hKey, const char * defVal);
+	CRect& GetRect(KeyHandle hKey, CRect& defVal);
+	CPoint& GetPoint(KeyHandle hKey, CPoint& defVal);
+	const CAVector& GetVector(KeyHandle hKey, const CAVector& defVal);
+	CARange& GetRange(KeyHandle hKey, CARange& defVal);
+
+	// Compiled attribute files.  SaveCompiled writes the main tag table as a flat,
+	// pointer free image with a perfect hash index over its keys.  LoadCompiled
+	// reads that image back in place of parsing the text, but only if nSourceHash
+	// still matches the HashSource of the text it was compiled from.
+	static uint32 HashSource(const void* pData, unsigned long size);
+	bool SaveCompiled(const char* szFileName, uint32 nSourceHash);
+	bool LoadCompiled(const char* szFileName, uint32 nSourceHash, CString sAttributeFilename=CString{""});
+	bool LoadCompiled(const void* pData, unsigned long size, uint32 nSourceHash, CString sAttributeFilename=CString{""});
+
 private:
 
 	void Reset();
@@ -451,6 +479,25 @@ private:
 	// Current table of items.
 	TableOfItems* m_pCurrTabOfItems;
 
+	// Perfect hash index over the main tag table, installed by LoadCompiled when
+	// the compiled file is the first thing loaded.  Names are kept in
+	// m_KeyIndexNames, the entries refer to them by offset.
+	struct KeyIndexEntry
+	{
+		uint32 m_nTagName;
+		uint32 m_nAttName;
+		CSymTabItem* m_pItem;
+	};
+	std::vector< KeyIndexEntry > m_KeyIndexEntries;
+	std::vector< uint32 > m_KeyIndexDisps;
+	std::vector< uint32 > m_KeyIndexSlots;
+	std::vector< char > m_KeyIndexNames;
+	uint32 m_nKeyIndexSeed;
+	uint32 m_nKeyIndexTags;
+
+	// Looks a key up in the perfect hash index.
+	CSymTabItem* FindIndexedSymTabItem( char const* pszTagName, char const* pszAttName );
+
 
 	// Callback function passed to TraverseTableOfTags.  Returns false to stop iterating.
 	typedef bool (*TraverseTableOfTagsCallback)( char const* pszTagName, TableOfItems& theTableOfItems, void* pContext );
@@ -49,6 +49,11 @@ public:
 	//nVal will not be 0. If it returns false, the value for nVal is undefined
 	inline bool GetBit(uint8& nVal);
 
+	//extracts the next nNumBits bits, up to 24 at a time, with the first bit read
+	//becoming the most significant bit of nVal. Returns false if the file doesn't
+	//have that many bits left
+	inline bool GetBits(uint32 nNumBits, uint32& nVal);
+
 	//sets a bit
 	inline bool SetBit(uint8 nVal);
 
@@ -57,9 +62,22 @@ private:
 	//don't allow copying of these objects
 	CLTABitFile(const CLTABitFile&) {}
 
+	//makes sure that at least nNumBits bits are waiting in m_nReadBits
+	inline bool FillReadBits(uint32 nNumBits);
+
 	//internal file
 	CLTAFileBuffer		m_File;
 
+	//bits that have been read in from the file but not extracted yet, in the
+	//order they will be extracted starting from the most significant bit. This
+	//lets a whole value be pulled out at once instead of a bit at a time
+	uint32				m_nReadBits;
+	uint32				m_nNumReadBits;
+
+	//bytes with their bits in reverse order, since the file stores the first
+	//bit in the least significant bit of each byte
+	static const uint8	s_nReversedBits[256];
+
 	//the current byte of data
 	uint8				m_nCurrData;
 
@@ -81,20 +99,59 @@ bool CLTABitFile::GetBit(uint8& nVal)
 	ASSERT(GetMode() == CLTAFileBuffer::OPEN_READ);
 
 	//see if we need to get new data
-	if(m_nMask == 0x00)
+	if(FillReadBits(1) == false)
 	{
-		if(m_File.ReadByte(m_nCurrData) == false)
-		{
-			return false;
-		}
-		m_nMask = 0x01;
+		return false;
 	}
 
 	//set the value
-	nVal = m_nCurrData & m_nMask;
+	nVal = (uint8)(m_nReadBits >> 31);
+
+	//move onto the next bit
+	m_nReadBits <<= 1;
+	m_nNumReadBits--;
+
+	return true;
+}
+
+//extracts the next nNumBits bits, up to 24 at a time, with the first bit read
+//becoming the most significant bit of nVal. Returns false if the file doesn't
+//have that many bits left
+bool CLTABitFile::GetBits(uint32 nNumBits, uint32& nVal)
+{
+	//make sure we are in the right mode
+	ASSERT(GetMode() == CLTAFileBuffer::OPEN_READ);
+	ASSERT((nNumBits > 0) && (nNumBits <= 24));
 
-	//update the mask
-	m_nMask <<= 1;	
+	if(FillReadBits(nNumBits) == false)
+	{
+		return false;
+	}
+
+	//pull the bits off of the top
+	nVal = m_nReadBits >> (32 - nNumBits);
+
+	m_nReadBits <<= nNumBits;
+	m_nNumReadBits -= nNumBits;
+
+	return true;
+}
+
+//makes sure that at least nNumBits bits are waiting in m_nReadBits
+bool CLTABitFile::FillReadBits(uint32 nNumBits)
+{
+	while(m_nNumReadBits < nNumBits)
+	{
+		uint8 nByte;
+		if(m_File.ReadByte(nByte) == false)
+		{
+			return false;
+		}
+
+		//add the byte's bits in below the ones we already have
+		m_nReadBits		|= (uint32)s_nReversedBits[nByte] << (24 - m_nNumReadBits);
+		m_nNumReadBits	+= 8;
+	}
 
 	return true;
 }
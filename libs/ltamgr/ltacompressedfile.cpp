@@ -103,91 +103,80 @@ bool CLTACompressedFile::WriteBlock(const uint8* pBlock, uint32 nBlockSize)
 	return bRV;
 }
 
-//reads in a byte
-bool CLTACompressedFile::ReadByte(uint8& nByte)
+//reads in the next token. A character is added to the window and returned in
+//nByte, a span is set up in m_nDecSpanPos and m_nDecSpanLen
+CLTACompressedFile::ETokenType CLTACompressedFile::ReadToken(uint8& nByte)
 {
-	//sanity check
-	ASSERT(GetMode() == CLTAFileBuffer::OPEN_READ);
+	//see if it is raw data or a span
+	uint8 nType;
+	
+	if(m_BitFile.GetBit(nType) == false)
+	{
+		//end of input stream
+		return TOKEN_END;
+	}
 
-	//see if we are at the end of a span
-	if(m_nDecSpanLen == 0)
+	if(nType == 0)
 	{
-		//we are, so we need to load in a new span
-		
-		//see if it is raw data or a span
-		uint8 nType;
-		
-		if(m_BitFile.GetBit(nType) == false)
+		//we have a span, read in the offset and length in one go. The writer
+		//doesn't flush the last partial byte, so running out of bits here means
+		//that we have hit the end of stream token
+		uint32 nSpan;
+		if(m_BitFile.GetBits(NUM_OFFSET_BITS + NUM_LENGTH_BITS, nSpan) == false)
 		{
-			//end of input stream
-			return false;
+			return TOKEN_END;
 		}
 
-		if(nType == 0)
+		m_nDecSpanPos = nSpan >> NUM_LENGTH_BITS;
+		
+		//see if this is the special end of stream token
+		if(m_nDecSpanPos == 0)
 		{
-			//we have a span
-			uint8 nBit;
-			uint32 nCurrBit;
+			return TOKEN_END;
+		}
 
-			//read in the offset
-			m_nDecSpanPos = 0; 
+		//adjust for the values that aren't possible
+		m_nDecSpanLen = (nSpan & ((1 << NUM_LENGTH_BITS) - 1)) + (BREAK_EVEN_POINT + 1);
 
-			for(nCurrBit = 0; nCurrBit < NUM_OFFSET_BITS; nCurrBit++)
-			{
-				m_nDecSpanPos <<= 1;
-				m_BitFile.GetBit(nBit);
-				if(nBit)
-				{
-					m_nDecSpanPos |= 1;
-				}
-			}
-			
-			//see if this is the special end of stream token
-			if(m_nDecSpanPos == 0)
-			{
-				return false;
-			}
+		return TOKEN_SPAN;
+	}
 
-			//now read in the span length
-			m_nDecSpanLen = 0;
+	//we have a single character, read in the value
+	uint32 nChar;
+	if(m_BitFile.GetBits(8, nChar) == false)
+	{
+		return TOKEN_END;
+	}
 
-			for(nCurrBit = 0; nCurrBit < NUM_LENGTH_BITS; nCurrBit++)
-			{
-				m_nDecSpanLen <<= 1;
-				m_BitFile.GetBit(nBit);
-				if(nBit)
-				{
-					m_nDecSpanLen |= 1;
-				}
-			}
+	nByte = (uint8)nChar;
 
-			//adjust for the values that aren't possible
-			m_nDecSpanLen += (BREAK_EVEN_POINT + 1);
-		}
-		else
-		{
-			//we have a single character, read in the value
-			nByte			= 0;
-			uint8 nBit		= 0;
+	//add this to the window
+	m_DecWnd[m_nDecWndPos] = nByte;
 
-			for(uint32 nCurrBit = 0; nCurrBit < 8; nCurrBit++)
-			{
-				nByte <<= 1;
+	//adjust the position in the window
+	m_nDecWndPos = WINDOW_POS(m_nDecWndPos + 1);
 
-				m_BitFile.GetBit(nBit);
-				if(nBit)
-				{
-					nByte |= 1;
-				}
-			}
+	return TOKEN_CHAR;
+}
 
-			//add this to the window
-			m_DecWnd[m_nDecWndPos] = nByte;
+//reads in a byte
+bool CLTACompressedFile::ReadByte(uint8& nByte)
+{
+	//sanity check
+	ASSERT(GetMode() == CLTAFileBuffer::OPEN_READ);
 
-			//adjust the position in the window
-			m_nDecWndPos = WINDOW_POS(m_nDecWndPos + 1);
+	//see if we are at the end of a span
+	if(m_nDecSpanLen == 0)
+	{
+		//we are, so we need to load in a new span
+		ETokenType eToken = ReadToken(nByte);
 
-			//return the value
+		if(eToken == TOKEN_END)
+		{
+			return false;
+		}
+		else if(eToken == TOKEN_CHAR)
+		{
 			return true;
 		}
 	}
@@ -211,12 +200,55 @@ bool CLTACompressedFile::ReadByte(uint8& nByte)
 //reads in a block of the file
 bool CLTACompressedFile::ReadBlock(uint8* pBlock, uint32 nBlockSize)
 {
-	bool bRV = true;
+	return ReadUpTo(pBlock, nBlockSize) == nBlockSize;
+}
 
-	for(uint32 nCurrByte = 0; nCurrByte < nBlockSize; nCurrByte++)
+//reads in as much of the file as will fit in the buffer, returning the number of
+//bytes read. This is only less than the buffer size at the end of the file
+uint32 CLTACompressedFile::ReadUpTo(uint8* pBuffer, uint32 nBufferSize)
+{
+	//sanity check
+	ASSERT(GetMode() == CLTAFileBuffer::OPEN_READ);
+
+	uint32 nBytesRead = 0;
+
+	while(nBytesRead < nBufferSize)
 	{
-		bRV = ReadByte(pBlock[nCurrByte]) && bRV;
+		if(m_nDecSpanLen == 0)
+		{
+			ETokenType eToken = ReadToken(pBuffer[nBytesRead]);
+
+			if(eToken == TOKEN_END)
+			{
+				break;
+			}
+			else if(eToken == TOKEN_CHAR)
+			{
+				nBytesRead++;
+				continue;
+			}
+		}
+
+		//copy out as much of the span as fits. The span can overlap the part of
+		//the window it is writing, so this has to go a character at a time
+		uint32 nCopy = LTMIN(m_nDecSpanLen, nBufferSize - nBytesRead);
+		uint32 nSpanPos = m_nDecSpanPos;
+		uint32 nWndPos = m_nDecWndPos;
+
+		for(uint32 nCurrByte = 0; nCurrByte < nCopy; nCurrByte++)
+		{
+			uint8 nByte = m_DecWnd[nSpanPos];
+			m_DecWnd[nWndPos] = nByte;
+			pBuffer[nBytesRead++] = nByte;
+
+			nSpanPos	= WINDOW_POS(nSpanPos + 1);
+			nWndPos		= WINDOW_POS(nWndPos + 1);
+		}
+
+		m_nDecSpanPos	= nSpanPos;
+		m_nDecWndPos	= nWndPos;
+		m_nDecSpanLen	-= nCopy;
 	}
 
-	return bRV;
-}
\ No newline at end of file
+	return nBytesRead;
+}
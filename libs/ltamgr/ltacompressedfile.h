@@ -57,8 +57,22 @@ public:
 	//reads in a block of the file
 	bool ReadBlock(uint8* pBlock, uint32 nBlockSize);
 
+	//reads in as much of the file as will fit in the buffer, returning the number of
+	//bytes read. This is only less than the buffer size at the end of the file
+	uint32 ReadUpTo(uint8* pBuffer, uint32 nBufferSize);
+
 private:
 
+	//the kinds of tokens in the compressed stream
+	enum ETokenType	{	TOKEN_END,			//end of the stream
+						TOKEN_CHAR,			//a single character
+						TOKEN_SPAN			//a run of characters already in the window
+					};
+
+	//reads in the next token. A character is added to the window and returned in
+	//nByte, a span is set up in m_nDecSpanPos and m_nDecSpanLen
+	ETokenType ReadToken(uint8& nByte);
+
 	//don't allow copying of this object
 	CLTACompressedFile(const CLTACompressedFile& rhs)	{}
 
@@ -50,6 +50,10 @@ public:
 	//read in a block of data of the specified number of bytes
 	inline bool Read(uint8* pBuffer, uint32 nBufferLen);
 
+	//read in as much as will fit in the buffer, returning the number of bytes read.
+	//This is only less than the buffer size at the end of the file
+	inline uint32 ReadUpTo(uint8* pBuffer, uint32 nBufferLen);
+
 	//read in a single byte
 	inline bool ReadByte(uint8& nByte);
 
@@ -102,6 +106,21 @@ bool CLTAFile::Read(uint8* pBuffer, uint32 nBufferLen)
 }
 
 
+//read in as much as will fit in the buffer, returning the number of bytes read.
+//This is only less than the buffer size at the end of the file
+uint32 CLTAFile::ReadUpTo(uint8* pBuffer, uint32 nBufferLen)
+{
+	if(m_bCompressed)
+	{
+		return m_CompressedFile.ReadUpTo(pBuffer, nBufferLen);
+	}
+	else
+	{
+		return m_FileBuffer.ReadUpTo(pBuffer, nBufferLen);
+	}
+}
+
+
 //read in a single byte
 bool CLTAFile::ReadByte(uint8& nByte)
 {
@@ -57,6 +57,10 @@ public:
 	//be read.
 	inline bool		ReadBlock(uint8* pBuffer, uint32 nBufferSize);
 
+	//reads in as much data as will fit in the buffer, returning the number of bytes
+	//read. This is only less than the buffer size at the end of the file
+	inline uint32	ReadUpTo(uint8* pBuffer, uint32 nBufferSize);
+
 	//reads in a single byte of data
 	inline bool		ReadByte(uint8& nData);
 
@@ -150,6 +154,39 @@ bool CLTAFileBuffer::ReadBlock(uint8* pBuffer, uint32 nBufferSize)
 	return true;
 }
 
+//reads in as much data as will fit in the buffer, returning the number of bytes
+//read. This is only less than the buffer size at the end of the file
+uint32 CLTAFileBuffer::ReadUpTo(uint8* pBuffer, uint32 nBufferSize)
+{
+	//make sure this is okay to do
+	ASSERT(m_eMode == OPEN_READ);
+
+	uint32 nBytesRead = 0;
+
+	while(nBytesRead < nBufferSize)
+	{
+		//see if we need to cache the file
+		if(m_nCachePos >= m_nCurrCacheSize)
+		{
+			if(FillCache() == false)
+			{
+				//hit the end of the file
+				break;
+			}
+		}
+
+		//take as much as we can out of the cache
+		uint32 nAmountToRead = LTMIN(m_nCurrCacheSize - m_nCachePos, nBufferSize - nBytesRead);
+
+		memcpy(pBuffer + nBytesRead, m_pCache + m_nCachePos, nAmountToRead);
+
+		m_nCachePos += nAmountToRead;
+		nBytesRead	+= nAmountToRead;
+	}
+
+	return nBytesRead;
+}
+
 //reads in a single byte of data
 bool CLTAFileBuffer::ReadByte(uint8& nData)
 {
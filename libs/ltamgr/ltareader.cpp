@@ -18,7 +18,7 @@ inline void InitIsSpace()
 	g_cSpaceList['\t'] = true;
 }
 
-inline bool IsSpace(char ch)
+inline bool IsSpace(uint8 ch)
 {
 	return g_cSpaceList[ch];
 }
@@ -28,7 +28,9 @@ inline bool IsSpace(char ch)
 
 
 CLTAReader::CLTAReader() :
-	m_nPeekChar(' ')
+	m_nPeekChar(' '),
+	m_nReadBufferPos(0),
+	m_nReadBufferLen(0)
 {
 }
 
@@ -55,6 +57,20 @@ void CLTAReader::Close()
 
 	//reset the peek char
 	m_nPeekChar = ' ';
+
+	//and throw out anything that was read ahead
+	m_nReadBufferPos = 0;
+	m_nReadBufferLen = 0;
+}
+
+
+//refills the read buffer from the file
+bool CLTAReader::FillReadBuffer()
+{
+	m_nReadBufferPos = 0;
+	m_nReadBufferLen = m_File.ReadUpTo(m_ReadBuffer, READ_BUFFER_SIZE);
+
+	return m_nReadBufferLen > 0;
 }
 
 
@@ -79,7 +95,7 @@ CLTAReader::ETokenType CLTAReader::NextToken(char* pszValueBuffer, uint32 nBuffe
 	//skip over whitespace
 	while(IsSpace(nCurrChar))
 	{
-		if(m_File.ReadByte(nCurrChar) == false)
+		if(ReadChar(nCurrChar) == false)
 		{
 			//end of file
 			return TK_ERROR;
@@ -104,7 +120,7 @@ CLTAReader::ETokenType CLTAReader::NextToken(char* pszValueBuffer, uint32 nBuffe
 
 		do
 		{
-			if(m_File.ReadByte(nCurrChar) == false)
+			if(ReadChar(nCurrChar) == false)
 			{
 				//end of file
 				break;
@@ -136,7 +152,7 @@ CLTAReader::ETokenType CLTAReader::NextToken(char* pszValueBuffer, uint32 nBuffe
 
 		do
 		{
-			if(m_File.ReadByte(nCurrChar) == false)
+			if(ReadChar(nCurrChar) == false)
 			{
 				//end of file
 				break;
@@ -48,13 +48,46 @@ public:
 
 private:
 
+	//the size of the block the file is read in with
+	enum	{ READ_BUFFER_SIZE = 4096 };
+
+	//gets the next character of the file out of the read buffer, refilling it
+	//when it runs out. Returns false at the end of the file
+	inline bool	ReadChar(uint8& nChar);
+
+	//refills the read buffer from the file
+	bool		FillReadBuffer();
+
 	//used to carry over characters to prevent them from being lost
 	//when tokens butt up against each other
 	uint8		m_nPeekChar;
 
 	CLTAFile	m_File;
 
+	//a block of the file that has been read in, so that characters don't have to
+	//be pulled out of the file one at a time
+	uint8		m_ReadBuffer[READ_BUFFER_SIZE];
+	uint32		m_nReadBufferPos;
+	uint32		m_nReadBufferLen;
+
 };
 
+//---------------------------------------
+// Inlines
+//---------------------------------------
+
+//gets the next character of the file out of the read buffer, refilling it
+//when it runs out. Returns false at the end of the file
+bool CLTAReader::ReadChar(uint8& nChar)
+{
+	if((m_nReadBufferPos >= m_nReadBufferLen) && (FillReadBuffer() == false))
+	{
+		return false;
+	}
+
+	nChar = m_ReadBuffer[m_nReadBufferPos++];
+	return true;
+}
+
 #endif
 
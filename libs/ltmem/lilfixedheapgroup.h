@@ -17,6 +17,8 @@
 #include "lilfixedheap.h"
 #endif
 
+#include <atomic>
+
 class CLilFixedHeapGroup 
 {
 public:
@@ -90,8 +92,10 @@ private:
 	// that is allocated after the first one
 	uint32 m_nGrowElemSize;
 
-	// contains a pointer to the first item in the heap list
-	CLilFixedHeapItem* m_pHeapList;
+	// contains a pointer to the first item in the heap list.  heaps are only
+	// added to the front (with a release store, under the caller's lock) so
+	// InHeap can walk the list from an acquire load without the lock
+	std::atomic<CLilFixedHeapItem*> m_pHeapList;
 };
 
 
@@ -104,13 +108,15 @@ inline bool CLilFixedHeapGroup::Init(
 	if (nInitialNumElements > 0)
 	{
 		// allocate initial heap item
-		m_pHeapList = new CLilFixedHeapItem;
-//		m_pHeapList = (CLilFixedHeapItem*)malloc(sizeof(CLilFixedHeapItem));
-		m_pHeapList->m_pNext = NULL;
-		if (m_pHeapList == NULL) return false;
+		CLilFixedHeapItem* pHeap = new CLilFixedHeapItem;
+//		pHeap = (CLilFixedHeapItem*)malloc(sizeof(CLilFixedHeapItem));
+		if (pHeap == NULL) return false;
+		pHeap->m_pNext = NULL;
 
 		// initialize initial heap item
-		if (!m_pHeapList->m_heap.Init(nElemSizeBytes, nInitialNumElements))
+		bool bInitialized = pHeap->m_heap.Init(nElemSizeBytes, nInitialNumElements);
+		m_pHeapList.store(pHeap, std::memory_order_release);
+		if (!bInitialized)
 		{
 			return false;
 		}
@@ -118,7 +124,7 @@ inline bool CLilFixedHeapGroup::Init(
 
 	else
 	{
-		m_pHeapList = NULL;
+		m_pHeapList.store(NULL, std::memory_order_release);
 	}
 	
 	// save element size to grow by
@@ -140,13 +146,15 @@ inline void CLilFixedHeapGroup::Term()
 	if (!m_bInitialized) return;
 
 	// go through list and delete all heaps
-	while (m_pHeapList != NULL)
+	CLilFixedHeapItem* pCurHeap = m_pHeapList.load(std::memory_order_relaxed);
+	m_pHeapList.store(NULL, std::memory_order_release);
+	while (pCurHeap != NULL)
 	{
-		CLilFixedHeapItem* pNextHeapList = m_pHeapList->m_pNext;
-		m_pHeapList->m_heap.Term();
-		delete m_pHeapList;
-//		free(m_pHeapList);
-		m_pHeapList = pNextHeapList;
+		CLilFixedHeapItem* pNextHeapList = pCurHeap->m_pNext;
+		pCurHeap->m_heap.Term();
+		delete pCurHeap;
+//		free(pCurHeap);
+		pCurHeap = pNextHeapList;
 	}
 
 	// class is no longer initialized
@@ -160,8 +168,8 @@ inline void* CLilFixedHeapGroup::Alloc()
 	// memory we are going to allocate
 	void* pMem = NULL;
 
-	// current heap we are looking at
-	CLilFixedHeapItem* pCurHeap = m_pHeapList;
+	// current heap we are looking at, only this thread adds heaps
+	CLilFixedHeapItem* pCurHeap = m_pHeapList.load(std::memory_order_relaxed);
 
 	// try to find space in one of the existing heaps
 	while (pCurHeap != NULL)
@@ -184,7 +192,7 @@ inline void* CLilFixedHeapGroup::Alloc()
 	pCurHeap = new CLilFixedHeapItem;
 //	pCurHeap = (CLilFixedHeapItem*)malloc(sizeof(CLilFixedHeapItem));
 	if (pCurHeap == NULL) return NULL;
-	pCurHeap->m_pNext = m_pHeapList;
+	pCurHeap->m_pNext = m_pHeapList.load(std::memory_order_relaxed);
 	if (!pCurHeap->m_heap.Init(m_nElemSizeBytes, m_nGrowElemSize))
 	{
 		delete pCurHeap;
@@ -192,7 +200,9 @@ inline void* CLilFixedHeapGroup::Alloc()
 		return NULL;
 	}
 	pMem = pCurHeap->m_heap.Alloc();
-	m_pHeapList = pCurHeap;
+
+	// publish the new heap only once it is fully set up
+	m_pHeapList.store(pCurHeap, std::memory_order_release);
 
 	// return memory we allocated
 	return pMem;
@@ -203,7 +213,7 @@ inline bool CLilFixedHeapGroup::Free(void* pFreeMem)
 	ASSERT(m_bInitialized);
 
 	// current heap we are looking at
-	CLilFixedHeapItem* pCurHeap = m_pHeapList;
+	CLilFixedHeapItem* pCurHeap = m_pHeapList.load(std::memory_order_relaxed);
 
 	// find which heap this memory belongs to
 	while (pCurHeap != NULL)
@@ -232,8 +242,9 @@ inline bool CLilFixedHeapGroup::InHeap(void* pMem)
 {
 	ASSERT(m_bInitialized);
 
-	// current heap we are looking at
-	CLilFixedHeapItem* pCurHeap = m_pHeapList;
+	// current heap we are looking at, this may be called without the lock
+	// so pairs with the release store in Alloc
+	CLilFixedHeapItem* pCurHeap = m_pHeapList.load(std::memory_order_acquire);
 
 	// find which heap this memory belongs to
 	while (pCurHeap != NULL)
@@ -7,6 +7,7 @@
 #include "ltmemheap.h"
 #include "ltmemdebug.h"
 #include "ltmemtrack.h"
+#include "ltmemthreadcache.h"
 
 ///////////////////////////////////////////////////////////////////////////////////////////
 // ltheap global variables
@@ -17,6 +18,26 @@ bool g_bLTMemInitialized = false;
 
 #ifdef USELTMEM
 
+#ifndef _WIN32
+#include <pthread.h>
+
+// on linux the critical section is a recursive pthread mutex
+typedef pthread_mutex_t CRITICAL_SECTION;
+
+static void InitializeCriticalSection(CRITICAL_SECTION* pCS)
+{
+	pthread_mutexattr_t attr;
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+	pthread_mutex_init(pCS, &attr);
+	pthread_mutexattr_destroy(&attr);
+}
+
+static void DeleteCriticalSection(CRITICAL_SECTION* pCS) { pthread_mutex_destroy(pCS); }
+static void EnterCriticalSection(CRITICAL_SECTION* pCS) { pthread_mutex_lock(pCS); }
+static void LeaveCriticalSection(CRITICAL_SECTION* pCS) { pthread_mutex_unlock(pCS); }
+#endif
+
 // critical section to make heap thread safe
 CRITICAL_SECTION g_LTMemCriticalSection; 
 
@@ -36,9 +57,10 @@ CLTMemInitialize::CLTMemInitialize()
 	LTMemInit();
 }
 
+// the heaps aren't terminated at exit, static objects destroyed after this
+// one still use and free the memory they got from them
 CLTMemInitialize::~CLTMemInitialize()
 {
-	LTMemTerm();
 }
 
 
@@ -89,6 +111,11 @@ void LTMemTerm()
 	// Request ownership of the LTMem critical section.
 	EnterCriticalSection(&g_LTMemCriticalSection); 
 
+#ifdef LTMEMUSETHREADCACHE
+	// give back anything the threads are holding on to
+	LTMemThreadCacheFlushAll();
+#endif
+
 	// term heap
 	LTMemHeapTerm();
 
@@ -119,6 +146,12 @@ void* LTMemAlloc(size_t nSize)
 	// make sure memory system is initialize
 	if (g_bLTMemInitialized == false) LTMemInit();
 
+#ifdef LTMEMUSETHREADCACHE
+	// small allocations come from this thread's cache without taking the lock
+	pRet = LTMemThreadCacheAlloc(nSize);
+	if (pRet != NULL) return pRet;
+#endif
+
 	// Request ownership of the LTMem critical section.
 	EnterCriticalSection(&g_LTMemCriticalSection); 
 
@@ -147,6 +180,14 @@ void* LTMemAlloc(size_t nSize)
 void LTMemFree(void* pMem)
 {
 #ifdef USELTMEM
+	// memory freed after LTMemTerm went away with the heaps
+	if (g_bLTMemInitialized == false) return;
+
+#ifdef LTMEMUSETHREADCACHE
+	// small allocations go back to this thread's cache without taking the lock
+	if (LTMemThreadCacheFree(pMem)) return;
+#endif
+
 	// Request ownership of the LTMem critical section.
 	EnterCriticalSection(&g_LTMemCriticalSection); 
 
@@ -175,6 +216,11 @@ void* LTMemReAlloc(void* pOldMem, uint32 nNewSize)
 #ifdef USELTMEM
 	void* pRet;
 
+#ifdef LTMEMUSETHREADCACHE
+	// small allocations are resized through this thread's cache
+	if (LTMemThreadCacheReAlloc(pOldMem, nNewSize, pRet)) return pRet;
+#endif
+
 	// Request ownership of the LTMem critical section.
 	EnterCriticalSection(&g_LTMemCriticalSection); 
 
@@ -199,3 +245,19 @@ void* LTMemReAlloc(void* pOldMem, uint32 nNewSize)
 }
 
 
+#ifdef USELTMEM
+
+// Enter the LTMem critical section
+void LTMemLock()
+{
+	EnterCriticalSection(&g_LTMemCriticalSection); 
+}
+
+
+// Leave the LTMem critical section
+void LTMemUnlock()
+{
+	LeaveCriticalSection(&g_LTMemCriticalSection);
+}
+
+#endif
@@ -4,6 +4,8 @@
 #include "ltmemheap.h"
 #include "generalheapgroup.h"
 
+#include <new>
+
 // define if we are using the simple heaps
 #define LTMEMUSESIMPLEHEAP
 
@@ -23,8 +25,6 @@ bool g_bLTMemHeapInitialized = false;
 // simple heaps
 ///////////////////////////////////////////////////////////////////////////////////////////
 
-#define LTMEMHEAPNUMSIMPLEHEAPSIZES 4
-
 // size of the simple heaps 
 uint32 g_nSimpleHeapSizes[] = { 16, 32, 48, 64 };
 
@@ -34,8 +34,13 @@ uint32 g_nSimpleHeapNumItems[] = { 10000, 5000, 5000, 5000 };
 // grow number of items in each of the simple heap 
 uint32 g_nSimpleHeapGrowItems[] = { 10000, 5000, 5000, 5000 };
 
+// storage for the simple heaps, they are built in here by LTMemHeapInit and
+// never destroyed so static objects can still free into them while the
+// process exits (the memory goes back to the system with the process)
+alignas(CLilFixedHeapGroup) static uint8 g_arySimpleHeapStorage[sizeof(CLilFixedHeapGroup) * LTMEMHEAPNUMSIMPLEHEAPSIZES];
+
 // array of simple heaps
-CLilFixedHeapGroup g_arySimpleHeaps[4];
+#define g_arySimpleHeaps ((CLilFixedHeapGroup*)g_arySimpleHeapStorage)
 
 
 ///////////////////////////////////////////////////////////////////////////////////////////
@@ -50,8 +55,11 @@ const uint32 g_nGeneralHeapGrowSize = 1024*1024*16;
 // alignment of the general heap
 const uint32 g_nGeneralHeapAlign = 16;
 
+// storage for the general heap, never destroyed for the same reason
+alignas(CGeneralHeapGroup) static uint8 g_GeneralHeapStorage[sizeof(CGeneralHeapGroup)];
+
 // general heap
-CGeneralHeapGroup g_GeneralHeap;
+#define g_GeneralHeap (*(CGeneralHeapGroup*)g_GeneralHeapStorage)
 
 
 // Initialize the LTMemHeap
@@ -64,6 +72,7 @@ void LTMemHeapInit()
 	{
 		for (uint32 n = 0; n < LTMEMHEAPNUMSIMPLEHEAPSIZES; n++)
 		{
+			::new (&g_arySimpleHeaps[n]) CLilFixedHeapGroup;
 			g_arySimpleHeaps[n].Init(g_nSimpleHeapSizes[n],g_nSimpleHeapNumItems[n],g_nSimpleHeapGrowItems[n]);
 		}
 	}
@@ -72,6 +81,7 @@ void LTMemHeapInit()
 	if (g_nGeneralHeapSize > 0)
 	{
 		// initialize the general heap
+		::new (&g_GeneralHeap) CGeneralHeapGroup;
 		g_GeneralHeap.Init(g_nGeneralHeapSize, g_nGeneralHeapGrowSize, g_nGeneralHeapAlign);
 	}
 }
@@ -109,6 +119,9 @@ void* LTMemHeapAlloc(uint32 nSize)
 			if (nSize <= g_nSimpleHeapSizes[n])
 			{
 				pMem = g_arySimpleHeaps[n].Alloc();
+
+				// use the smallest heap that fits
+				break;
 			}
 		}
 	}
@@ -206,7 +219,7 @@ void* LTMemHeapReAlloc(void* pMem, uint32 nNewSize)
 	LTMemHeapFree(pMem);	
 
 	// return value
-	return pMem;
+	return pNewMem;
 }
 
 
@@ -243,3 +256,82 @@ uint32 LTMemHeapGetSize(void* pMem)
 
 	return nSize;
 }
+
+
+// get the simple heap an allocation of this size comes from
+int32 LTMemHeapGetSimpleHeapIndex(uint32 nSize)
+{
+	for (uint32 n = 0; n < LTMEMHEAPNUMSIMPLEHEAPSIZES; n++)
+	{
+		if (nSize <= g_nSimpleHeapSizes[n])
+		{
+			return (int32)n;
+		}
+	}
+
+	// this size goes to the general heap
+	return -1;
+}
+
+
+// get the simple heap this memory belongs to
+int32 LTMemHeapFindSimpleHeap(void* pMem)
+{
+	// if memory is null it isn't in any heap
+	if (pMem == NULL) return -1;
+
+	for (uint32 n = 0; n < LTMEMHEAPNUMSIMPLEHEAPSIZES; n++)
+	{
+		if (g_arySimpleHeaps[n].InHeap(pMem))
+		{
+			return (int32)n;
+		}
+	}
+
+	// memory is not from a simple heap
+	return -1;
+}
+
+
+// get the element size of a simple heap
+uint32 LTMemHeapGetSimpleHeapSize(int32 nIndex)
+{
+	ASSERT((nIndex >= 0) && (nIndex < LTMEMHEAPNUMSIMPLEHEAPSIZES));
+	return g_nSimpleHeapSizes[nIndex];
+}
+
+
+// allocate a list of elements from a simple heap
+void* LTMemHeapAllocSimpleList(int32 nIndex, uint32 nCount, uint32& nNumAllocated)
+{
+	ASSERT((nIndex >= 0) && (nIndex < LTMEMHEAPNUMSIMPLEHEAPSIZES));
+
+	// head of the list we are building
+	void* pList = NULL;
+
+	for (nNumAllocated = 0; nNumAllocated < nCount; nNumAllocated++)
+	{
+		void* pMem = g_arySimpleHeaps[nIndex].Alloc();
+		if (pMem == NULL) break;
+
+		// link this element onto the front of the list
+		*(void**)pMem = pList;
+		pList = pMem;
+	}
+
+	return pList;
+}
+
+
+// free a list of elements back to a simple heap
+void LTMemHeapFreeSimpleList(int32 nIndex, void* pList)
+{
+	ASSERT((nIndex >= 0) && (nIndex < LTMEMHEAPNUMSIMPLEHEAPSIZES));
+
+	while (pList != NULL)
+	{
+		void* pNext = *(void**)pList;
+		g_arySimpleHeaps[nIndex].Free(pList);
+		pList = pNext;
+	}
+}
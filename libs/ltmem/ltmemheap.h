@@ -32,4 +32,25 @@ void* LTMemHeapReAlloc(void* pMem, uint32 nRequestedSize);
 // Get the size of the allocated memory
 uint32 LTMemHeapGetSize(void* pMem);
 
+// number of simple heap size classes
+#define LTMEMHEAPNUMSIMPLEHEAPSIZES 4
+
+// Get the simple heap that an allocation of this size comes from
+// returns -1 if the allocation goes to the general heap
+int32 LTMemHeapGetSimpleHeapIndex(uint32 nSize);
+
+// Get the simple heap this memory was allocated from or -1 if it is not from a simple heap
+// this does not modify the heaps so it may be called without holding the LTMem critical section
+int32 LTMemHeapFindSimpleHeap(void* pMem);
+
+// Get the element size of a simple heap
+uint32 LTMemHeapGetSimpleHeapSize(int32 nIndex);
+
+// Allocate up to nCount elements from a simple heap, returned as a list linked 
+// through the first pointer of each element
+void* LTMemHeapAllocSimpleList(int32 nIndex, uint32 nCount, uint32& nNumAllocated);
+
+// Free a list of elements linked through their first pointer back to a simple heap
+void LTMemHeapFreeSimpleList(int32 nIndex, void* pList);
+
 #endif
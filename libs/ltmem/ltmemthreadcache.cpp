@@ -0,0 +1,319 @@
+// ----------------------------------------------------------------------- //
+//
+// MODULE  : ltmemthreadcache.cpp
+//
+// PURPOSE : Per-thread cache of simple heap elements
+//
+// ----------------------------------------------------------------------- //
+
+#include "stdafx.h"
+#include "ltmem.h"
+#include "ltmemheap.h"
+#include "ltmemthreadcache.h"
+
+#include <atomic>
+
+#ifdef USELTMEM
+
+// from ltmem.cpp
+extern bool g_bLTMemInitialized;
+
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// thread cache global variables
+///////////////////////////////////////////////////////////////////////////////////////////
+
+// true if the thread caches are in use
+static std::atomic<bool> g_bLTMemThreadCacheEnabled(true);
+
+// number of times a thread cache has gone to the simple heaps
+static std::atomic<uint32> g_nLTMemThreadCacheLockCount(0);
+
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// thread cache
+///////////////////////////////////////////////////////////////////////////////////////////
+
+class CLTMemThreadCache;
+
+// every thread cache that has taken elements from the simple heaps so
+// LTMemTerm can take them back (only changed inside the LTMem critical section)
+static CLTMemThreadCache* g_pLTMemThreadCacheList = NULL;
+
+class CLTMemThreadCache
+{
+public:
+	CLTMemThreadCache()
+	{
+		for (uint32 n = 0; n < LTMEMHEAPNUMSIMPLEHEAPSIZES; n++)
+		{
+			m_pFreeList[n] = NULL;
+			m_nNumFree[n] = 0;
+		}
+		m_pPrevCache = NULL;
+		m_pNextCache = NULL;
+		m_bRegistered = false;
+	}
+
+	// give everything back when the thread exits
+	~CLTMemThreadCache()
+	{
+		Flush();
+
+		// if the heaps are already gone LTMemTerm took us off the list
+		if (m_bRegistered && g_bLTMemInitialized)
+		{
+			LTMemLock();
+			Unregister();
+			LTMemUnlock();
+		}
+	}
+
+	// allocate an element of the given simple heap
+	inline void* Alloc(int32 nIndex);
+
+	// free an element of the given simple heap
+	inline void Free(int32 nIndex, void* pMem);
+
+	// return all elements to the simple heaps
+	void Flush();
+
+	// take this cache off the global list (must be in the LTMem critical section)
+	void Unregister();
+
+private:
+
+	// put this cache on the global list (must be in the LTMem critical section)
+	void Register();
+
+	// get a batch of elements from the simple heap
+	void Refill(int32 nIndex);
+
+	// give a batch of elements back to the simple heap
+	void Release(int32 nIndex, uint32 nCount);
+
+	// list of free elements for each simple heap, linked through their first pointer
+	void* m_pFreeList[LTMEMHEAPNUMSIMPLEHEAPSIZES];
+
+	// number of elements in each free list
+	uint32 m_nNumFree[LTMEMHEAPNUMSIMPLEHEAPSIZES];
+
+	// links in the global list of thread caches
+	CLTMemThreadCache* m_pPrevCache;
+	CLTMemThreadCache* m_pNextCache;
+
+	// true if this cache is in the global list
+	bool m_bRegistered;
+};
+
+// the cache for the current thread
+static thread_local CLTMemThreadCache g_LTMemThreadCache;
+
+
+inline void* CLTMemThreadCache::Alloc(int32 nIndex)
+{
+	// get more elements if we are out
+	if (m_pFreeList[nIndex] == NULL)
+	{
+		Refill(nIndex);
+		if (m_pFreeList[nIndex] == NULL) return NULL;
+	}
+
+	// pop the first element off the list
+	void* pMem = m_pFreeList[nIndex];
+	m_pFreeList[nIndex] = *(void**)pMem;
+	m_nNumFree[nIndex]--;
+
+	return pMem;
+}
+
+
+inline void CLTMemThreadCache::Free(int32 nIndex, void* pMem)
+{
+	// push the element onto the front of the list
+	*(void**)pMem = m_pFreeList[nIndex];
+	m_pFreeList[nIndex] = pMem;
+	m_nNumFree[nIndex]++;
+
+	// if we are holding too many give a batch back so other threads can use it
+	if (m_nNumFree[nIndex] > LTMEMTHREADCACHEMAXITEMS)
+	{
+		Release(nIndex, LTMEMTHREADCACHEBATCHSIZE);
+	}
+}
+
+
+void CLTMemThreadCache::Refill(int32 nIndex)
+{
+	uint32 nNumAllocated = 0;
+
+	LTMemLock();
+	g_nLTMemThreadCacheLockCount++;
+	if (!m_bRegistered) Register();
+	void* pList = LTMemHeapAllocSimpleList(nIndex, LTMEMTHREADCACHEBATCHSIZE, nNumAllocated);
+	LTMemUnlock();
+
+	// the list is only refilled when empty so we can just take it
+	m_pFreeList[nIndex] = pList;
+	m_nNumFree[nIndex] = nNumAllocated;
+}
+
+
+void CLTMemThreadCache::Release(int32 nIndex, uint32 nCount)
+{
+	if (m_pFreeList[nIndex] == NULL) return;
+
+	// split off the first nCount elements
+	void* pList = m_pFreeList[nIndex];
+	void* pLast = pList;
+	uint32 nNumReleased = 1;
+	while ((nNumReleased < nCount) && (*(void**)pLast != NULL))
+	{
+		pLast = *(void**)pLast;
+		nNumReleased++;
+	}
+	m_pFreeList[nIndex] = *(void**)pLast;
+	m_nNumFree[nIndex] -= nNumReleased;
+	*(void**)pLast = NULL;
+
+	// if the heaps are already gone there is nothing to give the memory back to
+	if (!g_bLTMemInitialized) return;
+
+	LTMemLock();
+	g_nLTMemThreadCacheLockCount++;
+	LTMemHeapFreeSimpleList(nIndex, pList);
+	LTMemUnlock();
+}
+
+
+void CLTMemThreadCache::Flush()
+{
+	for (uint32 n = 0; n < LTMEMHEAPNUMSIMPLEHEAPSIZES; n++)
+	{
+		Release((int32)n, m_nNumFree[n]);
+	}
+}
+
+
+void CLTMemThreadCache::Register()
+{
+	m_pPrevCache = NULL;
+	m_pNextCache = g_pLTMemThreadCacheList;
+	if (m_pNextCache != NULL) m_pNextCache->m_pPrevCache = this;
+	g_pLTMemThreadCacheList = this;
+	m_bRegistered = true;
+}
+
+
+void CLTMemThreadCache::Unregister()
+{
+	if (!m_bRegistered) return;
+
+	if (m_pPrevCache != NULL) m_pPrevCache->m_pNextCache = m_pNextCache;
+	else g_pLTMemThreadCacheList = m_pNextCache;
+	if (m_pNextCache != NULL) m_pNextCache->m_pPrevCache = m_pPrevCache;
+
+	m_pPrevCache = NULL;
+	m_pNextCache = NULL;
+	m_bRegistered = false;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// thread cache functions
+///////////////////////////////////////////////////////////////////////////////////////////
+
+// allocate from this thread's cache
+void* LTMemThreadCacheAlloc(uint32 nSize)
+{
+	if (!g_bLTMemThreadCacheEnabled.load(std::memory_order_relaxed)) return NULL;
+
+	// only simple heap sizes are cached
+	int32 nIndex = LTMemHeapGetSimpleHeapIndex(nSize);
+	if (nIndex < 0) return NULL;
+
+	return g_LTMemThreadCache.Alloc(nIndex);
+}
+
+
+// free memory to this thread's cache
+bool LTMemThreadCacheFree(void* pMem)
+{
+	if (!g_bLTMemThreadCacheEnabled.load(std::memory_order_relaxed)) return false;
+
+	// only simple heap memory is cached
+	int32 nIndex = LTMemHeapFindSimpleHeap(pMem);
+	if (nIndex < 0) return false;
+
+	g_LTMemThreadCache.Free(nIndex, pMem);
+	return true;
+}
+
+
+// resize memory that came from a simple heap
+bool LTMemThreadCacheReAlloc(void* pOldMem, uint32 nNewSize, void*& pNewMem)
+{
+	if (!g_bLTMemThreadCacheEnabled.load(std::memory_order_relaxed)) return false;
+
+	// only simple heap memory is cached
+	int32 nIndex = LTMemHeapFindSimpleHeap(pOldMem);
+	if (nIndex < 0) return false;
+
+	// if it still fits leave it where it is
+	uint32 nOldSize = LTMemHeapGetSimpleHeapSize(nIndex);
+	if (nNewSize <= nOldSize)
+	{
+		pNewMem = pOldMem;
+		return true;
+	}
+
+	// allocate new memory which may come from the cache or the general heap
+	pNewMem = LTMemAlloc(nNewSize);
+	if (pNewMem == NULL) return true;
+
+	// copy data over and free the old memory
+	memcpy(pNewMem, pOldMem, nOldSize);
+	g_LTMemThreadCache.Free(nIndex, pOldMem);
+
+	return true;
+}
+
+
+// return all memory in this thread's cache
+void LTMemThreadCacheFlush()
+{
+	g_LTMemThreadCache.Flush();
+}
+
+
+// return all memory in every thread's cache
+void LTMemThreadCacheFlushAll()
+{
+	LTMemLock();
+
+	// a cache that is used again afterwards puts itself back on the list
+	while (g_pLTMemThreadCacheList != NULL)
+	{
+		CLTMemThreadCache* pCache = g_pLTMemThreadCacheList;
+		pCache->Flush();
+		pCache->Unregister();
+	}
+
+	LTMemUnlock();
+}
+
+
+// turn the thread caches on or off
+void LTMemThreadCacheEnable(bool bEnable)
+{
+	g_bLTMemThreadCacheEnabled = bEnable;
+}
+
+
+// get the number of times the caches have taken the lock
+uint32 LTMemThreadCacheGetLockCount()
+{
+	return g_nLTMemThreadCacheLockCount;
+}
+
+#endif
@@ -0,0 +1,62 @@
+// ----------------------------------------------------------------------- //
+//
+// MODULE  : ltmemthreadcache.h
+//
+// PURPOSE : Per-thread cache of simple heap elements.  Small allocations
+//			 are served from the calling thread's cache without taking the
+//			 LTMem critical section, and the cache refills from and returns
+//			 to the simple heaps in batches.
+//
+// ----------------------------------------------------------------------- //
+
+#ifndef __LTMEMTHREADCACHE_H__
+#define __LTMEMTHREADCACHE_H__
+
+#ifndef __LTMEM_H__
+#include "ltmem.h"
+#endif
+
+// define this to use the per-thread cache for small allocations
+// the cache hands out raw heap elements so it can't be used when memory 
+// is being tracked or debugged since those add headers to every allocation
+#if !defined(LTMEMDEBUG) && !defined(LTMEMTRACK)
+#define LTMEMUSETHREADCACHE
+#endif
+
+// number of elements moved between a thread cache and the simple heaps at once
+#define LTMEMTHREADCACHEBATCHSIZE	32
+
+// number of elements a thread cache may hold per size before it returns a batch
+#define LTMEMTHREADCACHEMAXITEMS	(LTMEMTHREADCACHEBATCHSIZE * 2)
+
+// Enter and leave the LTMem critical section (implemented in ltmem.cpp)
+void LTMemLock();
+void LTMemUnlock();
+
+// Allocate from this thread's cache
+// returns NULL if the size is too large for the cache or the cache is disabled
+void* LTMemThreadCacheAlloc(uint32 nSize);
+
+// Free memory to this thread's cache
+// returns false if the memory did not come from a simple heap and must be freed normally
+bool LTMemThreadCacheFree(void* pMem);
+
+// Resize memory that came from a simple heap
+// returns false if the memory did not come from a simple heap and must be resized normally
+bool LTMemThreadCacheReAlloc(void* pOldMem, uint32 nNewSize, void*& pNewMem);
+
+// Return all memory in this thread's cache to the simple heaps
+void LTMemThreadCacheFlush();
+
+// Return all memory in every thread's cache to the simple heaps
+// the other threads must not be allocating or freeing while this runs
+void LTMemThreadCacheFlushAll();
+
+// Turn the thread caches on or off (they are on by default)
+// memory already in a cache stays there until that thread frees more memory or exits
+void LTMemThreadCacheEnable(bool bEnable);
+
+// Get the number of times any thread cache has taken the LTMem critical section
+uint32 LTMemThreadCacheGetLockCount();
+
+#endif
@@ -8,6 +8,12 @@
 #include <string.h>
 #include <sys/stat.h>
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
 // -----------------------------------------------------------------------------------------
 // CBaseRezFileList
 
@@ -238,6 +244,130 @@ char* CRezFile::GetFileName() {
 };
 
 
+#ifndef _WIN32
+// -----------------------------------------------------------------------------------------
+// CRezFileMapped
+
+// -----------------------------------------------------------------------------------------
+CRezFileMapped::CRezFileMapped(CRezMgr* pRezMgr) : CBaseRezFile(pRezMgr) {
+  ASSERT(pRezMgr != NULL);
+  m_pMapping = NULL;
+  m_nMappingSize = 0;
+  m_sFileName = NULL;
+};
+
+
+// -----------------------------------------------------------------------------------------
+CRezFileMapped::~CRezFileMapped() {
+  if (m_pMapping != NULL) Close();
+  if (m_sFileName != NULL) delete [] m_sFileName;
+};
+
+
+// -----------------------------------------------------------------------------------------
+DWORD CRezFileMapped::Read(DWORD nItemPos, DWORD nItemOffset, DWORD nSize, void* pData) {
+  ASSERT(pData != NULL);
+
+  // if size is zero just return
+  if (nSize <= 0) return 0;
+
+  const BYTE* pSrc = GetMappedData((REZFILEPOS)nItemPos+nItemOffset,nSize);
+  if (pSrc == NULL) {
+    ASSERT(FALSE); // Read past the end of the file!
+    return 0;
+  }
+
+  memcpy(pData,pSrc,nSize);
+  return nSize;
+};
+
+
+// -----------------------------------------------------------------------------------------
+DWORD CRezFileMapped::Write(DWORD nItemPos, DWORD nItemOffset, DWORD nSize, void* pData) {
+  ASSERT(FALSE); // Mapped rez files are read only!
+  return 0;
+};
+
+
+// -----------------------------------------------------------------------------------------
+BOOL CRezFileMapped::Open(const char* sFileName, BOOL bReadOnly, BOOL bCreateNew) {
+  ASSERT(m_pMapping == NULL);
+  if (!bReadOnly || bCreateNew) return FALSE;
+
+  int nFile;
+  do {
+    nFile = open(sFileName,O_RDONLY);
+    if (nFile < 0) {
+      if (!m_pRezMgr->DiskError()) return FALSE;
+    }
+  } while (nFile < 0);
+
+  // map the whole file, the descriptor isn't needed once the mapping exists
+  struct stat FileInfo;
+  void* pMapping = MAP_FAILED;
+  if ((fstat(nFile,&FileInfo) == 0) && (FileInfo.st_size > 0)) {
+    pMapping = mmap(NULL,(size_t)FileInfo.st_size,PROT_READ,MAP_PRIVATE,nFile,0);
+  }
+  close(nFile);
+  if (pMapping == MAP_FAILED) return FALSE;
+
+  m_pMapping = (BYTE*)pMapping;
+  m_nMappingSize = (REZFILEPOS)FileInfo.st_size;
+
+  if (m_sFileName != NULL) 
+	  delete [] m_sFileName;
+
+  uint32 nNewStrLen = (uint32)(strlen(sFileName)+1);
+  LT_MEM_TRACK_ALLOC(m_sFileName = new char[nNewStrLen],LT_MEM_TYPE_MISC);
+
+  if (m_sFileName != NULL) 
+	  LTStrCpy(m_sFileName,sFileName,nNewStrLen);
+
+  return TRUE;
+};
+
+
+// -----------------------------------------------------------------------------------------
+BOOL CRezFileMapped::Close() {
+  if (m_pMapping == NULL) return FALSE;
+  munmap(m_pMapping,(size_t)m_nMappingSize);
+  m_pMapping = NULL;
+  m_nMappingSize = 0;
+  if (m_sFileName != NULL) delete [] m_sFileName;
+  m_sFileName = NULL;
+  return TRUE;
+};
+
+
+// -----------------------------------------------------------------------------------------
+BOOL CRezFileMapped::Flush() {
+  // nothing is ever written
+  return (m_pMapping != NULL);
+};
+
+
+// -----------------------------------------------------------------------------------------
+BOOL CRezFileMapped::VerifyFileOpen() {
+  // a mapping stays valid until it is closed
+  return (m_pMapping != NULL);
+};
+
+
+// -----------------------------------------------------------------------------------------
+char* CRezFileMapped::GetFileName() {
+  return m_sFileName;
+};
+
+
+// -----------------------------------------------------------------------------------------
+const BYTE* CRezFileMapped::GetMappedData(REZFILEPOS nItemPos, REZFILEPOS nSize) {
+  if (m_pMapping == NULL) return NULL;
+  if ((nItemPos > m_nMappingSize) || (nSize > m_nMappingSize-nItemPos)) return NULL;
+  return m_pMapping+nItemPos;
+};
+#endif
+
+
 // -----------------------------------------------------------------------------------------
 // CRezFileDirectory
 
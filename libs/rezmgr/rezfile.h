@@ -59,6 +59,7 @@ public:
   virtual BOOL Flush() = 0;
   virtual BOOL VerifyFileOpen() = 0;
   virtual char* GetFileName() = 0;
+  virtual const BYTE* GetMappedData(REZFILEPOS nItemPos, REZFILEPOS nSize) { return NULL; }; // pointer into the file data if it is memory mapped (NULL otherwise)
   CBaseRezFile* Next() { return (CBaseRezFile*)CVirtBaseListItem::Next(); };
   void VirtualFoo();
 protected:
@@ -88,6 +89,31 @@ private:
   DWORD m_nLastSeekPos;
 };
 
+#ifndef _WIN32
+// -----------------------------------------------------------------------------------------
+// CRezFileMapped
+// Read only rez file that is memory mapped.  Reads are a memcpy out of the mapping so they
+// don't share any seek state and can be made from several threads at once.
+
+class CRezFileMapped : public CBaseRezFile {
+public:
+  CRezFileMapped(CRezMgr* pRezMgr);
+  ~CRezFileMapped();
+  virtual DWORD Read(DWORD nItemPos, DWORD nItemOffset, DWORD nSize, void* pData);
+  virtual DWORD Write(DWORD nItemPos, DWORD nItemOffset, DWORD nSize, void* pData);
+  virtual BOOL Open(const char* sFileName, BOOL bReadOnly, BOOL bCreateNew);
+  virtual BOOL Close();
+  virtual BOOL Flush();
+  virtual BOOL VerifyFileOpen();
+  virtual char* GetFileName();
+  virtual const BYTE* GetMappedData(REZFILEPOS nItemPos, REZFILEPOS nSize);
+private:
+  BYTE* m_pMapping;
+  REZFILEPOS m_nMappingSize;
+  char* m_sFileName;
+};
+#endif
+
 // -----------------------------------------------------------------------------------------
 // CRezFileDirectory
 
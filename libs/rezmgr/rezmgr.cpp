@@ -259,6 +259,23 @@ BYTE* CRezItm::Load() {
   return m_pData;
 };
 
+//---------------------------------------------------------------------------------------------------
+const BYTE* CRezItm::DirectRead_GetData() {
+  ASSERT(m_pParentDir != NULL);
+  ASSERT(m_pRezFile != NULL);
+
+  // check if the whole directory is in memory already
+  if (m_pParentDir->m_pMemBlock != NULL) {
+    return m_pParentDir->m_pMemBlock+m_nFilePos-m_pParentDir->m_nItemsPos;
+  }
+
+  // check if the data is already in memory
+  if (m_pData != NULL) return m_pData;
+
+  // point straight into the rez file if it is mapped
+  return m_pRezFile->GetMappedData(m_nFilePos,m_nSize);
+};
+
 //---------------------------------------------------------------------------------------------------
 BOOL CRezItm::UnLoad() {
   if (m_pData != NULL) {
@@ -1297,9 +1314,8 @@ BOOL CRezMgr::Open(const char* FileName, BOOL ReadOnly, BOOL CreateNew) {
     return TRUE;
   }
 
-  // create a new CRezFile object for the RezFile
-  CRezFile* pRezFile;
-  LT_MEM_TRACK_ALLOC(pRezFile = new CRezFile(this),LT_MEM_TYPE_MISC);
+  // create a new CRezFile object for the RezFile (memory mapped if we are only reading)
+  CBaseRezFile* pRezFile = CreateRezFile(ReadOnly,CreateNew);
   ASSERT(pRezFile != NULL);
   if (pRezFile == NULL) {
 	delete [] m_sFileName;
@@ -1421,9 +1437,8 @@ BOOL CRezMgr::OpenAdditional(const char* FileName, BOOL bOverwriteItems) {
     return TRUE;
   }
 
-  // create a new CRezFile object for the RezFile
-  CRezFile* pRezFile;
-  LT_MEM_TRACK_ALLOC(pRezFile = new CRezFile(this),LT_MEM_TYPE_MISC);
+  // create a new CRezFile object for the RezFile (memory mapped if we are only reading)
+  CBaseRezFile* pRezFile = CreateRezFile(ReadOnly,CreateNew);
   ASSERT(pRezFile != NULL);
   if (pRezFile == NULL) {
 	delete [] m_sFileName;
@@ -2356,6 +2371,20 @@ BOOL CRezMgr::Reset()
 }
 
 
+//---------------------------------------------------------------------------------------------------
+CBaseRezFile* CRezMgr::CreateRezFile(BOOL ReadOnly, BOOL CreateNew) {
+  CBaseRezFile* pRezFile;
+#ifndef _WIN32
+  if (ReadOnly && !CreateNew) {
+    LT_MEM_TRACK_ALLOC(pRezFile = new CRezFileMapped(this),LT_MEM_TYPE_MISC);
+    return pRezFile;
+  }
+#endif
+  LT_MEM_TRACK_ALLOC(pRezFile = new CRezFile(this),LT_MEM_TYPE_MISC);
+  return pRezFile;
+};
+
+
 //---------------------------------------------------------------------------------------------------
 BOOL CRezMgr::IsDirectory(const char* sFileName) {
    struct stat buf;
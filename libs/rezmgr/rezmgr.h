@@ -89,6 +89,7 @@ public:
 	// functions that can be used to gain direct read access to the rez file (DANGER!!!!!)
 	const char* DirectRead_GetFullRezName() { if (m_pRezFile == NULL) return NULL; else return m_pRezFile->GetFileName(); };
 	DWORD		DirectRead_GetFileOffset() { return m_nFilePos; };
+	const BYTE* DirectRead_GetData();														// Returns a pointer to the data without copying it if it is in memory or mapped (NULL otherwise)
 
 	BYTE*		Create(DWORD Size);														// Allocates memory for data (primairly for a new resource)
 	BOOL		Save();																    // Saves the data for the internally kept memory to disk
@@ -333,6 +334,7 @@ private:
     // other internal functions
     REZTIME     GetCurTime();                                                           // For use by any internal function that wants to get the current time
     BOOL		IsDirectory(const char* sFileName);
+    CBaseRezFile* CreateRezFile(BOOL ReadOnly, BOOL CreateNew);                         // Creates the right kind of rez file object for the access we need
     BOOL        ReadEmulationDirectory(CRezFileDirectoryEmulation* pRezFileEmulation, CRezDir* pDir, char* sParamPath, BOOL bOverwriteItems);
 	BOOL		Flush();
 
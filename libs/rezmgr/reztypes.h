@@ -28,6 +28,7 @@ typedef DWORD REZSIZE;		// The size type for a resource
 typedef DWORD REZKEYINDEX;	// The index value for a resource key
 typedef DWORD REZKEYVAL;	// The value in a resource key
 typedef DWORD REZTIME;     // The time value for resources
+typedef unsigned long long REZFILEPOS; // A 64 bit position inside a resource file
 
 #endif
 
@@ -22,6 +22,13 @@ struct FTClient;
 #define NUM_CFM_SERVER_FILES    100
 #define NUM_HASHED_IDENTIFIERS  200
 
+// Where files transferred from the server are kept.
+#ifdef __LINUX
+#define CLIENT_CACHE_DIR        "de_cache"
+#else
+#define CLIENT_CACHE_DIR        "c:\\de_cache"
+#endif
+
 // ------------------------------------------------------------ //
 // Structures.
 // ------------------------------------------------------------ //
@@ -67,7 +74,8 @@ public:
     ILTStream* OpenFileIdentifier(FileIdentifier *pFile);
     ILTStream* OpenFile(FileRef *pDesc);
     LTRESULT CopyFile(const char *pSrc, const char *pDest);
-    int OnNewFile(FTClient *hClient, const char *pFilename, uint32 size, uint32 fileID);
+    int OnNewFile(FTClient *hClient, const char *pFilename, uint32 size, uint32 fileID,
+        const char *pCachedFilename);
 	FTClient* GetFTClient();
     //
     //Client File Mgr data.
@@ -224,15 +232,17 @@ void CClientFileMgr::OnConnect(CBaseConn *serverID) {
     for (i=0; i < NUM_CFM_SERVER_FILES; i++)
         dl_TieOff(&m_ServerFiles[i]);
 
-    // Setup the cache tree.
-    df_OpenTree("c:\\de_cache", m_hCacheTree);
-
-    // Init the file transfer client.
+    // Init the file transfer client.  This creates the cache directory
+    // if it isn't there yet.
     initStruct.m_pNetMgr = &g_pClientMgr->m_NetMgr;
     initStruct.m_ConnID = serverID;
+    initStruct.m_pCacheDir = CLIENT_CACHE_DIR;
 
     m_hFTClient = ftc_Init(&initStruct);
     ftc_SetUserData1(m_hFTClient, NULL);
+
+    // Setup the cache tree.
+    df_OpenTree(CLIENT_CACHE_DIR, m_hCacheTree);
 }
 
 
@@ -422,7 +432,17 @@ FileIdentifier* CClientFileMgr::GetFileIdentifier(FileRef *pDesc, uint8 typeCode
                 return pFile->m_pIdentifier;
             }
             else {
-                pFilename = pDesc->m_pFilename;
+                LT_MEM_TRACK_ALLOC(pIdentifier = m_FileIdentifierBank.Allocate(), LT_MEM_TYPE_FILE);
+                memset(pIdentifier, 0, sizeof(FileIdentifier));
+                pIdentifier->m_hFileTree = m_hCacheTree;
+                pIdentifier->m_FileID = pFile->m_FileID;
+                pIdentifier->m_NameLen = (uint16)strlen(pFile->m_ClientFilename);
+                pIdentifier->m_Link.m_pData = pIdentifier;
+                pIdentifier->m_TypeCode = typeCode;
+                pIdentifier->m_Filename = pFile->m_ClientFilename;
+
+                pFile->m_pIdentifier = pIdentifier;
+                return pIdentifier;
             }
         }
         else {
@@ -567,25 +587,14 @@ LTRESULT CClientFileMgr::CopyFile(const char *pSrc, const char *pDest)
     return LT_NOTFOUND;
 }
 
-int CClientFileMgr::OnNewFile(FTClient *hClient, const char *pFilename, uint32 size, uint32 fileID) 
+int CClientFileMgr::OnNewFile(FTClient *hClient, const char *pFilename, uint32 size, uint32 fileID,
+    const char *pCachedFilename) 
 {
     ServerFile *pFile;
     ClientFileTree *pTree;
+    HLTFileTree *hFileTree;
     char formattedFilename[512];
 
-    
-    // Right now, it just finds the file in the client's list of resources
-    // and sets up a ServerFile right away.
-
-    pTree = FindInFileTrees(pFilename);
-    if (!pTree)
-    {
-        con_WhitePrintf("Unable to find server file: %s", pFilename);
-        return NF_HAVEFILE;
-    }
-
-	CHelpers::FormatFilename(pFilename, formattedFilename, sizeof(formattedFilename));
-
     // Is there already a file with this ID?
     pFile = FindServerFile((uint16)fileID);
     if (pFile)
@@ -593,13 +602,38 @@ int CClientFileMgr::OnNewFile(FTClient *hClient, const char *pFilename, uint32 s
         return NF_HAVEFILE;
     }
 
+    // Use our own copy of the file if we have one, otherwise the one
+    // that was transferred into the cache.
+    pTree = FindInFileTrees(pFilename);
+    if (pTree)
+    {
+        hFileTree = pTree->m_hFileTree;
+    }
+    else if (pCachedFilename && m_hCacheTree)
+    {
+        hFileTree = m_hCacheTree;
+    }
+    else
+    {
+        return NF_DONTHAVEFILE;
+    }
+
+	CHelpers::FormatFilename(pFilename, formattedFilename, sizeof(formattedFilename));
+
     LT_MEM_TRACK_ALLOC(pFile = m_ServerFileBank.Allocate(), LT_MEM_TYPE_FILE);
     memset(pFile, 0, sizeof(ServerFile));
     LT_MEM_TRACK_ALLOC(pFile->m_Filename = m_Strings.AddString(formattedFilename), LT_MEM_TYPE_FILE);
-    pFile->m_ClientFilename = pFile->m_Filename;
     pFile->m_RealFilename = pFile->m_Filename;
+    if (pTree)
+    {
+        pFile->m_ClientFilename = pFile->m_Filename;
+    }
+    else
+    {
+        LT_MEM_TRACK_ALLOC(pFile->m_ClientFilename = m_Strings.AddString(pCachedFilename), LT_MEM_TYPE_FILE);
+    }
     pFile->m_FileID = (uint16)fileID;
-    pFile->m_hFileTree = pTree->m_hFileTree;
+    pFile->m_hFileTree = hFileTree;
     pFile->m_NameLen = (uint16)strlen(formattedFilename);
     pFile->m_Link.m_pData = pFile;
 
@@ -103,8 +103,10 @@ public:
     virtual LTRESULT CopyFile(const char *pSrc, const char *pDest) = 0;
 
 
-    //called by file transfer client.
-    virtual int OnNewFile(FTClient *hClient, const char *pFilename, uint32 size, uint32 fileID) = 0;
+    //called by file transfer client.  pCachedFilename is the file's name in
+    //the cache directory if the transfer client has it there, otherwise NULL.
+    virtual int OnNewFile(FTClient *hClient, const char *pFilename, uint32 size, uint32 fileID,
+        const char *pCachedFilename) = 0;
 
 
 	// used when calling OnNewFile from outside of the implementation class
@@ -52,9 +52,12 @@
 #include "particlesystem.h"
 #include "client_ticks.h"
 #include "iltdrawprim.h"
+#include "workerpool.h"
 
 #include "dtxmgr.h"
 
+#include <string>
+
 //------------------------------------------------------------------
 //------------------------------------------------------------------
 // Holders and their headers.
@@ -78,6 +81,12 @@ define_holder(IWorldClientBSP, world_bsp_client);
 static IClientFileMgr *client_file_mgr;
 define_holder(IClientFileMgr, client_file_mgr);
 
+//IClientLoaderThread
+#include "client_loaderthread.h"
+#include "cloaderthread.h"
+static IClientLoaderThread *client_loaderthread;
+define_holder(IClientLoaderThread, client_loaderthread);
+
 //IClientShell game client shell object.
 #include "iclientshell.h"
 static IClientShell *i_client_shell;
@@ -135,6 +144,9 @@ extern LTVector g_ConsoleModelAdd;
 extern float g_CV_MaxFPS;
 extern int32 g_CV_ForceConsole;
 extern int32 g_CV_RenderEnable;
+extern int32 g_CV_LoaderThreads;
+extern float g_CV_LoaderFinishBudget;
+extern int32 g_CV_ModelUpdateThreads;
 extern int32 g_CV_ForceSoundDisable;
 extern int32 g_CV_DrawDebugGeometry;
 
@@ -343,6 +355,15 @@ LTRESULT CClientMgr::Init(const char **resTrees, uint32 nResTrees, uint32 nNumCo
 
     m_pCollisionInfo = NULL;
 
+    // Start the background loader.
+#ifdef __LINUX
+    client_loaderthread->LoaderThread()->Init((uint32)LTMAX(g_CV_LoaderThreads, 0));
+#else
+    // The Windows rez reader shares one FILE* between all its streams, so
+    // files are read on the main thread as part of the loader's frame budget.
+    client_loaderthread->LoaderThread()->Init(0);
+#endif
+
     // Initialize the listener info.
 //  m_bListenerInClient = true;
 //  VEC_INIT(m_vListenerPos);
@@ -1021,6 +1042,9 @@ LTRESULT CClientMgr::Update()
     // Update all sounds.
 	UpdateAllSounds();
 
+    // Finish whatever the background loader has ready.
+    client_loaderthread->LoaderThread()->Update(g_CV_LoaderFinishBudget);
+
     // Update the console if it's up.
     if (dsi_IsConsoleUp())
     {
@@ -1378,6 +1402,9 @@ void CClientMgr::Term()
         i_client_shell->OnEngineTerm();
     }
 
+    // Stop background loading before anything it loads into goes away.
+    client_loaderthread->LoaderThread()->Term();
+
 	// Turn off rendering
     r_TermRender(2, true);
 
@@ -1579,7 +1606,7 @@ LTRESULT CClientMgr::UncacheModelFile( Model *pModel )
  Case 2 is ideal, because the model dbs are shared; information is kept by the dbs.
  when the server sets the db, the client spontaneously knows of the change.
 ------------------------------------------------------------------------ */
-LTRESULT CClientMgr::LoadModel( const FileRef & file_ref , Model *&pModel )
+LTRESULT CClientMgr::LoadModel( const FileRef & file_ref , Model *&pModel, ILTStream *pStream )
 {
 	FileIdentifier* pIdent;
 
@@ -1618,9 +1645,23 @@ LTRESULT CClientMgr::LoadModel( const FileRef & file_ref , Model *&pModel )
 			return LT_OK ;
 		}
 
-		// else we must load the data from disk.
 		LTRESULT dResult ;
-		dResult = LoadModelData( pIdent, pModel);
+
+		// if the background loader already has it, finish it now instead of reading it twice.
+		if( !pStream && client_loaderthread->LoaderThread()->IsLoadingFile( pIdent ) )
+		{
+			void *pObj;
+			dResult = client_loaderthread->LoaderThread()->WaitForFile( pIdent, &pObj );
+			pModel = (Model*)pObj;
+			if( dResult == LT_OK && file_ref.m_FileType == FILE_SERVERFILE )
+			{
+				pModel->m_FileID = file_ref.m_FileID ;
+			}
+			return dResult ;
+		}
+
+		// else we must load the data from disk.
+		dResult = LoadModelData( pIdent, pModel, pStream);
 
 		if(dResult == LT_OK )
 		{
@@ -1685,14 +1726,15 @@ static LTRESULT ClientLoadChildModelCB(ModelLoadRequest *pRequest, Model **ppMod
 }
 
 
-LTRESULT CClientMgr::LoadModelData(FileIdentifier *pIdent, Model* &pModel)
+LTRESULT CClientMgr::LoadModelData(FileIdentifier *pIdent, Model* &pModel, ILTStream *pStream)
 {
     ModelLoadRequest request;
     LTRESULT dResult;
 
 	const char *pFilename = pIdent->m_Filename ;
 
-    request.m_pFile = client_file_mgr->OpenFileIdentifier(pIdent);
+    // Use the caller's stream if it already has the data.
+    request.m_pFile = pStream ? pStream : client_file_mgr->OpenFileIdentifier(pIdent);
     if (!request.m_pFile)
     {
         SetupError(LT_MISSINGMODELFILE, pFilename);
@@ -1702,7 +1744,8 @@ LTRESULT CClientMgr::LoadModelData(FileIdentifier *pIdent, Model* &pModel)
 	LT_MEM_TRACK_ALLOC(pModel = new Model, LT_MEM_TYPE_MODEL);
     if (!pModel)
     {
-	    request.m_pFile->Release();
+        if (!pStream)
+	        request.m_pFile->Release();
         RETURN_ERROR(1, cm_LoadModelData, LT_OUTOFMEMORY);
     }
 
@@ -1710,7 +1753,8 @@ LTRESULT CClientMgr::LoadModelData(FileIdentifier *pIdent, Model* &pModel)
     request.m_pLoadFnUserData = (void*)pFilename;
     dResult = pModel->Load(&request, pFilename);
 
-    request.m_pFile->Release();
+    if (!pStream)
+        request.m_pFile->Release();
 
     if (dResult != LT_OK )
     {
@@ -1764,6 +1808,9 @@ void CClientMgr::OnExitServer(CClientShell *pShell) {
 
     memset(m_SkyObjects, 0xFF, sizeof(m_SkyObjects));
 
+    // Anything still loading may refer to server files.
+    client_loaderthread->LoaderThread()->CancelAll();
+
     // Tell the file manager.
     client_file_mgr->OnDisconnect();
 
@@ -2178,8 +2225,42 @@ LTRESULT CClientMgr::AddObjectToClientWorld(uint16 objectID,
 }
 
 
+// Models are animated on worker threads (see UpdateModels).  Key strings hit
+// while doing that are held here and handed to the client shell afterwards.
+struct SModelUpdate
+{
+	ModelInstance				*m_pInst;
+	std::vector<std::string>	m_Keys;
+};
+
+static CWorkerPool g_ModelUpdatePool;
+
+// Only worth posing models ahead of time when there are workers to share it.
+static bool g_bPrePoseModels = false;
+
+// One entry per model updated this frame.  Entries past g_nModelUpdates are
+// kept around so their key lists don't have to be reallocated.
+static std::vector<SModelUpdate> g_ModelUpdates;
+static uint32 g_nModelUpdates = 0;
+
+// Set while the held keys are being sent, g_iCurModelUpdate is the model
+// whose keys are being sent.
+static bool g_bSendingModelKeys = false;
+static uint32 g_iCurModelUpdate = 0;
+
+
 LTRESULT CClientMgr::RemoveObjectFromClientWorld(LTObject *pObject)
 {
+    // Don't send it any more of this frame's model keys.
+    if (g_bSendingModelKeys)
+    {
+        for (uint32 i = g_iCurModelUpdate; i < g_nModelUpdates; i++)
+        {
+            if (g_ModelUpdates[i].m_pInst == pObject)
+                g_ModelUpdates[i].m_pInst = LTNULL;
+        }
+    }
+
     // Detach it from whatever it's standing on.
     DetachObjectStanding(pObject);
     DetachObjectsStandingOn(pObject);
@@ -2349,17 +2430,12 @@ void CClientMgr::UpdateLineSystems() {
 
 uint32 g_Ticks_UpdateObjects;
 
-static void ClientStringKeyCallback(LTAnimTracker *pTracker, AnimKeyFrame *pFrame)
+static void ClientModelKey(ModelInstance *pInst, const char *pString)
 {
     ArgList argList;
     ConParse parse;
-    ModelInstance *pInst;
 
 
-    pInst = pTracker->GetModelInstance();
-    if (!pInst)
-        return;
-
     if (!(pInst->cd.m_ClientFlags & CF_NOTIFYMODELKEYS))
         return;
 
@@ -2367,7 +2443,7 @@ static void ClientStringKeyCallback(LTAnimTracker *pTracker, AnimKeyFrame *pFram
         return;
     }
 
-    parse.Init(pFrame->m_pString);
+    parse.Init(pString);
     argList.argv = parse.m_Args;
 
     while (parse.Parse()) {
@@ -2378,6 +2454,30 @@ static void ClientStringKeyCallback(LTAnimTracker *pTracker, AnimKeyFrame *pFram
     }
 }
 
+// The model being updated by this thread in UpdateModels.
+static thread_local SModelUpdate *t_pModelUpdate = LTNULL;
+
+static void ClientStringKeyCallback(LTAnimTracker *pTracker, AnimKeyFrame *pFrame)
+{
+    ModelInstance *pInst;
+
+
+    pInst = pTracker->GetModelInstance();
+    if (!pInst)
+        return;
+
+    // Hold onto it if we're on a worker, otherwise send it now.
+    if (t_pModelUpdate)
+    {
+        if (pInst->cd.m_ClientFlags & CF_NOTIFYMODELKEYS)
+            t_pModelUpdate->m_Keys.push_back(pFrame->m_pString);
+    }
+    else
+    {
+        ClientModelKey(pInst, pFrame->m_pString);
+    }
+}
+
 
 // Called by the server in a local game.
 #ifdef USE_LOCAL_STUFF
@@ -2388,17 +2488,47 @@ static void ClientStringKeyCallback(LTAnimTracker *pTracker, AnimKeyFrame *pFram
     }
 #endif
 
+// Advance one model's animations and pose it.  Runs on a worker thread.
+static void UpdateModelJob(uint32 nIndex, void *pUser)
+{
+	SModelUpdate *pUpdate = &g_ModelUpdates[nIndex];
+	ModelInstance *pModel = pUpdate->m_pInst;
+
+	t_pModelUpdate = pUpdate;
+	pModel->ClientUpdate(*(uint32*)pUser);
+	t_pModelUpdate = LTNULL;
+
+	// Models that were drawn or queried last frame will most likely need their
+	// pose again, so build it here where it's spread across the workers.
+	bool bPose = g_bPrePoseModels && pModel->m_bPoseUsed && (pModel->m_Flags & FLAG_VISIBLE);
+	pModel->m_bPoseUsed = false;
+
+	if (bPose)
+	{
+		pModel->BuildModelSpacePose();
+	}
+}
+
 void CClientMgr::UpdateModels()
 {
 	//determine if any time has even elapsed
     if (m_nFrameTimeMS)
     {
-		//it has, so we need to run through and update all models
+		// (Re)start the workers if the thread count changed.
+		uint32 nNumThreads = (g_CV_ModelUpdateThreads > 0) ? (uint32)g_CV_ModelUpdateThreads : LTMAX(std::thread::hardware_concurrency(), 1);
+		if (g_ModelUpdatePool.GetNumThreads() != nNumThreads)
+		{
+			g_ModelUpdatePool.Init(nNumThreads);
+		}
+		g_bPrePoseModels = (nNumThreads > 1);
+
+		//it has, so we need to run through and find all the models to update
         LTLink *pListHead = &m_ObjectMgr.m_ObjectLists[OT_MODEL].m_Head;
 
 		ModelInstance *pModel;
 		uint32         i;
 
+		g_nModelUpdates = 0;
 		for (LTLink *pCur = pListHead->m_pNext; pCur != pListHead; pCur = pCur->m_pNext)
         {
             pModel = (ModelInstance*)pCur->m_pData;
@@ -2406,32 +2536,63 @@ void CClientMgr::UpdateModels()
 			//but don't update paused models
 			if(!pModel->IsPaused())
 			{
-				//setup the string callback and update the model animation
+				if (g_nModelUpdates == g_ModelUpdates.size())
+				{
+					g_ModelUpdates.push_back(SModelUpdate());
+				}
+
+				SModelUpdate &cUpdate = g_ModelUpdates[g_nModelUpdates++];
+				cUpdate.m_pInst = pModel;
+				cUpdate.m_Keys.clear();
+
+				//setup the string callback
 				pModel->SetStringKeyCallback(ClientStringKeyCallback);
-				pModel->ClientUpdate(m_nFrameTimeMS);
+			}
+        }
 
-				//count down how many sprites we have to update. This is mainly because most
-				//don't have sprites, or only a single one so it avoids the need to go through
-				//every texture index since there can be quite a few
-				uint32 nSpritesLeft = pModel->m_nNumSprites;
+		//update the model animations
+		g_ModelUpdatePool.ParallelFor(g_nModelUpdates, UpdateModelJob, &m_nFrameTimeMS);
 
-				for (i = 0; nSpritesLeft && (i < MAX_MODEL_TEXTURES); i++)
+		//now send the keys in model order, the client shell can remove models
+		//while handling them (see RemoveObjectFromClientWorld)
+		g_bSendingModelKeys = true;
+
+		for (g_iCurModelUpdate = 0; g_iCurModelUpdate < g_nModelUpdates; g_iCurModelUpdate++)
+		{
+			SModelUpdate &cUpdate = g_ModelUpdates[g_iCurModelUpdate];
+
+			for (i = 0; cUpdate.m_pInst && (i < cUpdate.m_Keys.size()); i++)
+			{
+				ClientModelKey(cUpdate.m_pInst, cUpdate.m_Keys[i].c_str());
+			}
+
+			pModel = cUpdate.m_pInst;
+			if (!pModel)
+				continue;
+
+			//count down how many sprites we have to update. This is mainly because most
+			//don't have sprites, or only a single one so it avoids the need to go through
+			//every texture index since there can be quite a few
+			uint32 nSpritesLeft = pModel->m_nNumSprites;
+
+			for (i = 0; nSpritesLeft && (i < MAX_MODEL_TEXTURES); i++)
+			{
+				if (pModel->m_pSprites[i])
 				{
-					if (pModel->m_pSprites[i])
-					{
-						spr_UpdateTracker(&pModel->m_SpriteTrackers[i], m_nFrameTimeMS);
-
-						FileRef        skinName;
-						skinName.m_pFilename = pModel->m_SpriteTrackers[i].m_pCurFrame->m_pTex->m_pFile->m_Filename;
-						skinName.m_FileType = FILE_CLIENTFILE;
-						AddSharedTexture2(&skinName, pModel->m_pSkins[i]);
-
-						//we have one sprite left to update
-						nSpritesLeft--;
-					}
+					spr_UpdateTracker(&pModel->m_SpriteTrackers[i], m_nFrameTimeMS);
+
+					FileRef        skinName;
+					skinName.m_pFilename = pModel->m_SpriteTrackers[i].m_pCurFrame->m_pTex->m_pFile->m_Filename;
+					skinName.m_FileType = FILE_CLIENTFILE;
+					AddSharedTexture2(&skinName, pModel->m_pSkins[i]);
+
+					//we have one sprite left to update
+					nSpritesLeft--;
 				}
 			}
-        }
+		}
+
+		g_bSendingModelKeys = false;
     }
 }
 
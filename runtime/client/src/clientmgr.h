@@ -203,7 +203,7 @@ class CClientMgr {
         // MODEL INTERFACE FUNCTIONS
 		// load file from rez.
 		LTRESULT				LoadModel( const char *filename, Model *& );
-		LTRESULT				LoadModel( const FileRef &file_ref , Model *&);
+		LTRESULT				LoadModel( const FileRef &file_ref , Model *&, ILTStream *pStream = LTNULL);
 
 		// this will return true if the file has been cached on the client,
 		// the file may or many not be cached on the server...
@@ -472,7 +472,9 @@ class CClientMgr {
         // Sets up a CSharedTexture for the texture (if one doesn't exist already).
         SharedTexture* AddSharedTexture(FileRef *pRef);
         LTRESULT AddSharedTexture2(FileRef *pRef, SharedTexture* &pTexture);
-        LTRESULT AddSharedTexture3(FileIdentifier *pIdent, SharedTexture* &pTexture);
+        // If pStream is given, a texture that isn't loaded yet is read from it
+        // (the caller still owns it) rather than from the file.
+        LTRESULT AddSharedTexture3(FileIdentifier *pIdent, SharedTexture* &pTexture, ILTStream *pStream = LTNULL);
 
         void FreeSharedTexture(SharedTexture *pTexture);
 
@@ -543,7 +545,7 @@ private :
 private:
 
 	// The actual file loading.
-    LTRESULT LoadModelData(FileIdentifier *pIdent, Model* &pModel);
+    LTRESULT LoadModelData(FileIdentifier *pIdent, Model* &pModel, ILTStream *pStream = LTNULL);
 
 	// Default net handling for when we don't have a client shell
 	class CDefaultNetHandler : public CNetHandler
@@ -157,6 +157,9 @@ CClientShell::CClientShell()
     m_ClientID = (uint16)-1;
     
     m_ClientObjectID = (uint16)-1;
+    m_nUnguaranteedAck = 0;
+    m_bUnguaranteedReceived = false;
+    m_bUnguaranteedAckPending = false;
     dl_TieOff(&m_MovingObjects);
     dl_TieOff(&m_RotatingObjects);
     m_pFrameClientObject = NULL;
@@ -27,6 +27,10 @@ struct FileIdentifier;
 #include "netmgr.h"
 #endif
 
+#ifndef __NETDELTA_H__
+#include "netdelta.h"
+#endif
+
 class CClientShell : public CNetHandler
 {
 	// Main stuff.
@@ -166,6 +170,14 @@ class CClientShell : public CNetHandler
 		uint16					m_ClientID;
 		bool					m_bLocal;	// Are we connected to the server locally?
 
+		// The last few unguaranteed updates from the server, which later ones
+		// are delta compressed against, and the newest one received.  That
+		// gets acknowledged with the next CMSG_UPDATEACK.
+		CNetSnapshotRing		m_UnguaranteedSnapshots;
+		uint16					m_nUnguaranteedAck;
+		bool					m_bUnguaranteedReceived;
+		bool					m_bUnguaranteedAckPending;
+
 
 	public:
 
@@ -1,127 +1,416 @@
-
 #include "bdefs.h"
 #include "cloaderthread.h"
 #include "clientmgr.h"
-#include "setupobject.h"
+#include "soundmgr.h"
+#include "sysstreamsim.h"
+#include "syscounter.h"
+
+
+//------------------------------------------------------------------
+//------------------------------------------------------------------
+// Holders and their headers.
+//------------------------------------------------------------------
+//------------------------------------------------------------------
+
+//IClientFileMgr holder
+static IClientFileMgr *client_file_mgr;
+define_holder(IClientFileMgr, client_file_mgr);
 
 
 extern int32 g_CV_DebugLoaders;
 
 
-CLoaderThread::CLoaderThread()
+CLoaderThread::CLoaderThread() :
+	m_bShutdown(false)
 {
+}
 
+
+CLoaderThread::~CLoaderThread()
+{
+	Term();
 }
 
 
-bool CLoaderThread::IsLoadingFile(FileIdentifier *pIdent)
+void CLoaderThread::Init(uint32 nNumThreads)
 {
-	CSAccess cs(&m_Incoming.m_MessageCS);
-	CSAccess cs2(&m_Outgoing.m_MessageCS);
-	GPOS pos;
+	Term();
 
-	ASSERT(!IsInThisThread());
+	m_bShutdown = false;
 
-	// Check all our messages.
-	for(pos=m_Incoming.m_Messages; pos; )
+	for (uint32 i = 0; i < nNumThreads; i++)
 	{
-		if(m_Incoming.m_Messages.GetNext(pos)->m_Data[1].m_pData == pIdent)
-			return LTTRUE;
+		m_Workers.push_back(std::thread(&CLoaderThread::WorkerMain, this));
 	}
+}
+
+
+void CLoaderThread::Term()
+{
+	CancelAll();
+
+	if (m_Workers.empty())
+		return;
 
-	for(pos=m_Outgoing.m_Messages; pos; )
 	{
-		if(m_Outgoing.m_Messages.GetNext(pos)->m_Data[1].m_pData == pIdent)
-			return LTTRUE;
+		std::lock_guard<std::mutex> cLock(m_Mutex);
+		m_bShutdown = true;
 	}
+	m_WorkCondition.notify_all();
 
-	return LTFALSE;
+	for (std::vector<std::thread>::iterator iCur = m_Workers.begin(); iCur != m_Workers.end(); ++iCur)
+	{
+		iCur->join();
+	}
+	m_Workers.clear();
 }
 
 
-LTRESULT CLoaderThread::WaitForFile(FileIdentifier *pIdent, void **ppObj)
+LTRESULT CLoaderThread::QueueFile(uint32 nFileType, const FileRef &cRef, uint32 nPriority,
+	LoaderCallbackFn pFn, void *pUser)
+{
+	uint8 nTypeCode;
+	switch (nFileType)
+	{
+		case FT_MODEL :		nTypeCode = TYPECODE_MODEL; break;
+		case FT_TEXTURE :	nTypeCode = TYPECODE_TEXTURE; break;
+		case FT_SOUND :		nTypeCode = TYPECODE_SOUND; break;
+		default :
+			RETURN_ERROR(1, CLoaderThread::QueueFile, LT_INVALIDPARAMS);
+	}
+
+	FileIdentifier *pIdent = client_file_mgr->GetFileIdentifier(const_cast<FileRef*>(&cRef), nTypeCode);
+	if (!pIdent)
+	{
+		RETURN_ERROR(1, CLoaderThread::QueueFile, LT_MISSINGFILE);
+	}
+
+	CCallback cCallback;
+	cCallback.m_pFn = pFn;
+	cCallback.m_pUser = pUser;
+
+	// Join the existing request if there is one.
+	{
+		std::lock_guard<std::mutex> cLock(m_Mutex);
+
+		TRequestMap::iterator iFind = m_Requests.find(pIdent);
+		if (iFind != m_Requests.end())
+		{
+			CRequest *pRequest = iFind->second;
+			pRequest->m_Callbacks.push_back(cCallback);
+
+			if ((nPriority > pRequest->m_nPriority) && !pRequest->m_bReading)
+			{
+				TRequestQueue &cQueue = pRequest->m_bRead ? m_Loaded : m_Pending;
+				cQueue.erase(pRequest->m_iQueuePos);
+				pRequest->m_iQueuePos = cQueue.insert(std::make_pair(nPriority, pRequest));
+			}
+			pRequest->m_nPriority = LTMAX(pRequest->m_nPriority, nPriority);
+			return LT_OK;
+		}
+	}
+
+	if (g_CV_DebugLoaders)
+	{
+		dsi_ConsolePrint("CLoaderThread::QueueFile(%s)", pIdent->m_Filename);
+	}
+
+	CRequest *pRequest;
+	LT_MEM_TRACK_ALLOC(pRequest = new CRequest, LT_MEM_TYPE_FILE);
+	pRequest->m_pIdent = pIdent;
+	pRequest->m_Ref = cRef;
+	if (cRef.m_FileType != FILE_SERVERFILE)
+	{
+		// The caller's string may not outlive the request.
+		pRequest->m_Ref.m_pFilename = pIdent->m_Filename;
+	}
+	pRequest->m_nFileType = nFileType;
+	pRequest->m_nPriority = nPriority;
+	pRequest->m_Callbacks.push_back(cCallback);
+	pRequest->m_pData = LTNULL;
+	pRequest->m_nDataSize = 0;
+	pRequest->m_dReadResult = LT_OK;
+	pRequest->m_bReading = false;
+	pRequest->m_bRead = false;
+
+	{
+		std::lock_guard<std::mutex> cLock(m_Mutex);
+
+		m_Requests[pIdent] = pRequest;
+		pRequest->m_iQueuePos = m_Pending.insert(std::make_pair(nPriority, pRequest));
+	}
+	m_WorkCondition.notify_one();
+
+	return LT_OK;
+}
+
+
+bool CLoaderThread::IsLoadingFile(FileIdentifier *pIdent)
 {
-	LThreadMessage msg;
+	std::lock_guard<std::mutex> cLock(m_Mutex);
 
+	return m_Requests.find(pIdent) != m_Requests.end();
+}
+
+
+LTRESULT CLoaderThread::WaitForFile(FileIdentifier *pIdent, void **ppObj)
+{
 	*ppObj = LTNULL;
 
-	// Get messages until it's done.
-	while(m_Outgoing.GetMessage(msg, LTTRUE) == LT_OK)
+	CRequest *pRequest;
+	{
+		std::unique_lock<std::mutex> cLock(m_Mutex);
+		pRequest = RemoveRequest(pIdent, cLock);
+	}
+
+	if (!pRequest)
+	{
+		RETURN_ERROR(1, CLoaderThread::WaitForFile, LT_NOTFOUND);
+	}
+
+	// Still queued, so read it here rather than waiting for a worker.
+	if (!pRequest->m_bRead)
+	{
+		ReadRequest(pRequest);
+	}
+
+	LTRESULT dResult = pRequest->m_dReadResult;
+	if (dResult == LT_OK)
+	{
+		dResult = CreateObject(pRequest, ppObj);
+	}
+
+	for (std::vector<CCallback>::iterator iCur = pRequest->m_Callbacks.begin(); iCur != pRequest->m_Callbacks.end(); ++iCur)
 	{
-		// Give it to the server..
-		// t.f fix
-		//if(g_pClientMgr)
-			//g_pClientMgr->ProcessThreadMessage(msg);
+		if (iCur->m_pFn)
+			iCur->m_pFn(pIdent, dResult, *ppObj, iCur->m_pUser);
+	}
+
+	FreeRequest(pRequest);
+	return dResult;
+}
 
-		// See if it's our file.
-		if(msg.m_Data[1].m_pData == pIdent)
+
+void CLoaderThread::Update(float fBudgetMS)
+{
+	CounterFinal cTimer(CSTART_MICRO);
+	uint32 nBudget = (uint32)(fBudgetMS * 1000.0f);
+
+	// Always finish at least one file so a tiny budget can't stall loading.
+	do
+	{
+		CRequest *pRequest = LTNULL;
 		{
-			if(msg.m_ID == CLT_LOADEDFILE)
+			std::lock_guard<std::mutex> cLock(m_Mutex);
+
+			if (!m_Loaded.empty())
 			{
-				*ppObj = msg.m_Data[2].m_pData;
-				return LT_OK;
+				pRequest = m_Loaded.begin()->second;
+				m_Loaded.erase(m_Loaded.begin());
+			}
+			else if (m_Workers.empty() && !m_Pending.empty())
+			{
+				pRequest = m_Pending.begin()->second;
+				m_Pending.erase(m_Pending.begin());
 			}
 			else
 			{
-				return LT_ERROR;
+				break;
 			}
+
+			m_Requests.erase(pRequest->m_pIdent);
 		}
+
+		if (!pRequest->m_bRead)
+		{
+			ReadRequest(pRequest);
+		}
+
+		FinishRequest(pRequest);
 	}
+	while (cTimer.CountMicro() < nBudget);
+}
+
+
+void CLoaderThread::CancelAll()
+{
+	std::unique_lock<std::mutex> cLock(m_Mutex);
+
+	while (!m_Requests.empty())
+	{
+		CRequest *pRequest = RemoveRequest(m_Requests.begin()->first, cLock);
+
+		cLock.unlock();
 
-	RETURN_ERROR(1, CLoaderThread::WaitForFile, LT_ERROR);
+		for (std::vector<CCallback>::iterator iCur = pRequest->m_Callbacks.begin(); iCur != pRequest->m_Callbacks.end(); ++iCur)
+		{
+			if (iCur->m_pFn)
+				iCur->m_pFn(pRequest->m_pIdent, LT_ERROR, LTNULL, iCur->m_pUser);
+		}
+		FreeRequest(pRequest);
+
+		cLock.lock();
+	}
 }
 
 
-void CLoaderThread::ProcessMessage(LThreadMessage &msg)
+uint32 CLoaderThread::GetNumRequests()
 {
-	uint32 resType;
-	FileIdentifier *pIdent;
+	std::lock_guard<std::mutex> cLock(m_Mutex);
 
+	return (uint32)m_Requests.size();
+}
 
-	if(msg.m_ID == CLT_LOADFILE)
-	{
-		resType = msg.m_Data[0].m_dwData;
-		pIdent = (FileIdentifier*)msg.m_Data[1].m_pData;
 
-		switch(resType)
+void CLoaderThread::WorkerMain()
+{
+	std::unique_lock<std::mutex> cLock(m_Mutex);
+
+	while (1)
+	{
+		while (!m_bShutdown && m_Pending.empty())
 		{
-			case FT_MODEL:
-			{
-				// t.f deprecate
-				//LoadModel(pIdent);
-			}
-			break;
+			m_WorkCondition.wait(cLock);
 		}
+
+		if (m_bShutdown)
+			return;
+
+		CRequest *pRequest = m_Pending.begin()->second;
+		m_Pending.erase(m_Pending.begin());
+		pRequest->m_bReading = true;
+
+		cLock.unlock();
+		ReadRequest(pRequest);
+		cLock.lock();
+
+		pRequest->m_bReading = false;
+		pRequest->m_iQueuePos = m_Loaded.insert(std::make_pair(pRequest->m_nPriority, pRequest));
+		m_ReadCondition.notify_all();
 	}
 }
 
 
-void CLoaderThread::LoadModel(FileIdentifier *pIdent)
+void CLoaderThread::ReadRequest(CRequest *pRequest)
 {
-	//Model *pModel;
-	LThreadMessage msg;
-	//LTRESULT dResult;
+	pRequest->m_bRead = true;
+
+	ILTStream *pStream = client_file_mgr->OpenFileIdentifier(pRequest->m_pIdent);
+	if (!pStream)
+	{
+		pRequest->m_dReadResult = LT_MISSINGFILE;
+		return;
+	}
+
+	uint32 nSize = 0;
+	pStream->GetLen(&nSize);
 
-	if(g_CV_DebugLoaders)
+	// Everything is built straight out of memory when it's finished.
+	LT_MEM_TRACK_ALLOC(pRequest->m_pData = new uint8[nSize + 1], LT_MEM_TYPE_FILE);
+	pRequest->m_nDataSize = nSize;
+	if (pStream->Read(pRequest->m_pData, nSize) != LT_OK)
 	{
-		dsi_ConsolePrint("CLoaderThread::LoadModel(%s)", pIdent->m_Filename);
+		pRequest->m_dReadResult = LT_ERROR;
 	}
-	assert(0); // we should never get here.
-	return;
-	//dResult = g_pClientMgr->LoadModelData(pIdent->m_Filename, pIdent, pModel);
-	//if(dResult == LT_OK)
-	//{
-		//msg.m_ID = CLT_LOADEDFILE;
-	//}
-	//else
-	//{
-		//msg.m_ID = CLT_LOADERROR;
-	//}
-//
-	//msg.m_Data[0].m_dwData = FT_MODEL;
-	//msg.m_Data[1].m_pData = pIdent;
-	//msg.m_Data[2].m_pData = pModel;
-	m_Outgoing.PostMessage(msg);
+
+	pStream->Release();
 }
 
 
+void CLoaderThread::FinishRequest(CRequest *pRequest)
+{
+	void *pObj = LTNULL;
+
+	LTRESULT dResult = pRequest->m_dReadResult;
+	if (dResult == LT_OK)
+	{
+		dResult = CreateObject(pRequest, &pObj);
+	}
+
+	if (g_CV_DebugLoaders)
+	{
+		dsi_ConsolePrint("CLoaderThread: finished %s (%d)", pRequest->m_pIdent->m_Filename, dResult);
+	}
+
+	for (std::vector<CCallback>::iterator iCur = pRequest->m_Callbacks.begin(); iCur != pRequest->m_Callbacks.end(); ++iCur)
+	{
+		if (iCur->m_pFn)
+			iCur->m_pFn(pRequest->m_pIdent, dResult, pObj, iCur->m_pUser);
+	}
+
+	FreeRequest(pRequest);
+}
+
+
+LTRESULT CLoaderThread::CreateObject(CRequest *pRequest, void **ppObj)
+{
+	LTRESULT dResult;
+
+	ILTStream *pStream = streamsim_MemStreamFromBuffer(pRequest->m_pData, pRequest->m_nDataSize);
+
+	switch (pRequest->m_nFileType)
+	{
+		case FT_MODEL :
+		{
+			Model *pModel = LTNULL;
+			dResult = g_pClientMgr->LoadModel(pRequest->m_Ref, pModel, pStream);
+			*ppObj = pModel;
+		}
+		break;
+
+		case FT_TEXTURE :
+		{
+			SharedTexture *pTexture = LTNULL;
+			dResult = g_pClientMgr->AddSharedTexture3(pRequest->m_pIdent, pTexture, pStream);
+			*ppObj = pTexture;
+		}
+		break;
+
+		case FT_SOUND :
+		{
+			CSoundBuffer *pBuffer = GetClientILTSoundMgrImpl()->CreateBuffer(*pRequest->m_pIdent, pStream);
+			dResult = pBuffer ? LT_OK : LT_ERROR;
+			*ppObj = pBuffer;
+		}
+		break;
+
+		default :
+			dResult = LT_INVALIDPARAMS;
+		break;
+	}
+
+	pStream->Release();
+	return dResult;
+}
+
+
+void CLoaderThread::FreeRequest(CRequest *pRequest)
+{
+	delete [] pRequest->m_pData;
+	delete pRequest;
+}
+
+
+CLoaderThread::CRequest* CLoaderThread::RemoveRequest(FileIdentifier *pIdent, std::unique_lock<std::mutex> &cLock)
+{
+	TRequestMap::iterator iFind = m_Requests.find(pIdent);
+	if (iFind == m_Requests.end())
+		return LTNULL;
+
+	CRequest *pRequest = iFind->second;
+
+	// Let the worker that has it finish up.
+	while (pRequest->m_bReading)
+	{
+		m_ReadCondition.wait(cLock);
+	}
+
+	if (pRequest->m_bRead)
+		m_Loaded.erase(pRequest->m_iQueuePos);
+	else
+		m_Pending.erase(pRequest->m_iQueuePos);
+
+	m_Requests.erase(pIdent);
+	return pRequest;
+}
+
@@ -1,55 +1,136 @@
+// The client-side background loader.
+//
+// Files are queued with a priority and read into memory by a small pool of
+// worker threads.  The main thread then turns the loaded data into engine
+// objects (models, textures, sounds) a few at a time in Update, staying
+// inside a per-frame time budget so streaming doesn't cause hitches.
+
 #ifndef __CLOADERTHREAD_H__
 #define __CLOADERTHREAD_H__
 
-#ifndef __SYSLTHREAD_H__
-#include "syslthread.h"
-#endif
-
-struct FileIdentifier;
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
-// Messages in the loader thread.
-// m_Data[0].m_dwData is a FT_ define from de_codes.h
-// m_Data[1].m_pData is the FileIdentifier*.
-// m_Data[2].m_dwData is a TEXTURELOAD_ define.
-#define CLT_LOADFILE	0
+#ifndef __CLIENT_FILEMGR_H__
+#include "client_filemgr.h"
+#endif
 
-// Notification that a resource is done loading.
-#define CLT_LOADEDFILE	0
-#define CLT_LOADERROR	1
+class ILTStream;
 
+// Called on the main thread when a queued file is done.  pObj is the
+// Model*, SharedTexture* or CSoundBuffer* that was loaded (NULL on error).
+typedef void (*LoaderCallbackFn)(FileIdentifier *pIdent, LTRESULT dResult, void *pObj, void *pUser);
 
-class CClientMgr;
+// Load priorities.  Higher priorities are read and finished first.
+#define LOADPRI_LOW		0
+#define LOADPRI_NORMAL	1
+#define LOADPRI_HIGH	2
 
 
-class CLoaderThread : public LThread
+class CLoaderThread
 {
-// Out of thread.
 public:
 
 					CLoaderThread();
+					~CLoaderThread();
+
+	// Start the worker threads.  With no workers, Update reads the files
+	// itself as part of its budget.
+	void			Init(uint32 nNumThreads);
+
+	// Cancel everything and stop the workers.
+	void			Term();
+
+	// Queue a file to be loaded.  nFileType is FT_MODEL, FT_TEXTURE or FT_SOUND.
+	// Files already in flight aren't loaded twice; the callback is added to
+	// the existing request and its priority is raised if needed.
+	LTRESULT		QueueFile(uint32 nFileType, const FileRef &cRef, uint32 nPriority,
+						LoaderCallbackFn pFn = LTNULL, void *pUser = LTNULL);
 
 	// Are we loading this file or is it in our queue to load?
 	bool			IsLoadingFile(FileIdentifier *pIdent);
 
-	// Wait for the specified file to complete loading.
-	LTRESULT		WaitForFile(FileIdentifier *pIdent, void **pObj);
+	// Wait for the specified file to finish loading, finishing it right away.
+	LTRESULT		WaitForFile(FileIdentifier *pIdent, void **ppObj);
+
+	// Finish loaded files on the main thread until fBudgetMS is used up.
+	void			Update(float fBudgetMS);
+
+	// Drop everything that hasn't finished yet.  Callbacks are told LT_ERROR.
+	void			CancelAll();
+
+	// Number of files queued, loading or waiting to be finished.
+	uint32			GetNumRequests();
 
 
-// In-thread.
 protected:
 
-	virtual void	ProcessMessage(LThreadMessage &msg);
+	struct CRequest;
+	typedef std::multimap<uint32, CRequest*, std::greater<uint32> > TRequestQueue;
 
-	// After a model is loaded, this does the work of integrating it into the client
-	// (add to the models list, update placeholder models, etc).
-	void			LoadModel(FileIdentifier *pIdent);
+	struct CCallback
+	{
+		LoaderCallbackFn	m_pFn;
+		void				*m_pUser;
+	};
 
+	struct CRequest
+	{
+		FileIdentifier			*m_pIdent;
+		FileRef					m_Ref;
+		uint32					m_nFileType;
+		uint32					m_nPriority;
+		std::vector<CCallback>	m_Callbacks;
 
-};
+		// The whole file, read by a worker.
+		uint8					*m_pData;
+		uint32					m_nDataSize;
+		LTRESULT				m_dReadResult;
 
+		// Set while a worker is reading it, and once it's been read.
+		bool					m_bReading;
+		bool					m_bRead;
 
-#endif
+		// Position in m_Pending or m_Loaded (only valid while queued).
+		TRequestQueue::iterator	m_iQueuePos;
+	};
+
+	// Worker thread main loop.
+	void			WorkerMain();
+
+	// Open the file and read all of it into memory.  Runs on a worker.
+	static void		ReadRequest(CRequest *pRequest);
+
+	// Turn the data into an engine object and run the callbacks.  Main thread only.
+	void			FinishRequest(CRequest *pRequest);
+	LTRESULT		CreateObject(CRequest *pRequest, void **ppObj);
+	void			FreeRequest(CRequest *pRequest);
+
+	// Pull the request for a file out of whichever queue it's in, waiting for
+	// a worker to finish with it if it has to.  m_Mutex must be held.
+	CRequest*		RemoveRequest(FileIdentifier *pIdent, std::unique_lock<std::mutex> &cLock);
+
+	std::vector<std::thread>	m_Workers;
 
+	std::mutex					m_Mutex;
+	std::condition_variable		m_WorkCondition;
+	std::condition_variable		m_ReadCondition;
 
+	// Waiting to be read, and read and waiting to be finished.
+	TRequestQueue				m_Pending;
+	TRequestQueue				m_Loaded;
 
+	// Every request that isn't finished, for de-duping.
+	typedef std::unordered_map<FileIdentifier*, CRequest*> TRequestMap;
+	TRequestMap					m_Requests;
+
+	bool						m_bShutdown;
+};
+
+
+#endif
 
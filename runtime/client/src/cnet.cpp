@@ -13,6 +13,7 @@
 // Includes....
 #include "bdefs.h"
 #include "clientmgr.h"
+#include "clientshell.h"
 #include "consolecommands.h"
 
 
@@ -61,4 +62,17 @@ void CClientMgr::SendUpdate(CNetMgr *pNetMgr, CBaseConn *pConnID)
 
 		pNetMgr->SendPacket(CPacket_Read(cPacket), pConnID, MESSAGE_GUARANTEED);
 	}
+
+	// Acknowledge the newest unguaranteed update so the server can delta
+	// compress the next ones against it.  If this gets lost, the next one
+	// will do.
+	if (m_pCurShell && m_pCurShell->m_bUnguaranteedAckPending)
+	{
+		CPacket_Write cAckPacket;
+		cAckPacket.Writeuint8(CMSG_UPDATEACK);
+		cAckPacket.Writeuint16(m_pCurShell->m_nUnguaranteedAck);
+		pNetMgr->SendPacket(CPacket_Read(cAckPacket), pConnID, 0);
+
+		m_pCurShell->m_bUnguaranteedAckPending = false;
+	}
 }
@@ -58,6 +58,10 @@ public:
 	//after this call.
 	bool				UnregisterCustomFontFile(CCustomFontFile* pFontFile);
 
+	//provides access to the registered font files
+	uint32					GetNumFontFiles() const			{ return (uint32)m_FileList.size(); }
+	const CCustomFontFile*	GetFontFile(uint32 nFile) const	{ return m_FileList[nFile]; }
+
 private:
 
 	//prevent external construction since this is intended to be used as a singleton
@@ -194,7 +194,7 @@ void CClientMgr::UpdateFrameRate()
 }
 
 
-LTRESULT CClientMgr::AddSharedTexture3(FileIdentifier *pIdent, SharedTexture* &pTexture) {
+LTRESULT CClientMgr::AddSharedTexture3(FileIdentifier *pIdent, SharedTexture* &pTexture, ILTStream *pStream) {
     pTexture = LTNULL;
 
     if (pIdent->m_pData) {
@@ -206,6 +206,16 @@ LTRESULT CClientMgr::AddSharedTexture3(FileIdentifier *pIdent, SharedTexture* &p
         pTexture->m_pFile = pIdent;
         pIdent->m_pData = pTexture; }
 
+#if !defined(__LINUX) || defined(USE_DXVK)
+    // Load it from the data we were given so binding doesn't read the file again.
+    if (pStream && !pTexture->m_pEngineData)
+    {
+        LTRESULT dResult = r_LoadSystemTexture(pTexture, pStream);
+        if (dResult != LT_OK)
+            return dResult;
+    }
+#endif
+
     // Bind it to the renderer.
     if (!pTexture->m_pRenderData) 
 	{
@@ -0,0 +1,486 @@
+#include "bdefs.h"
+#include "glyphatlas.h"
+
+//----------------------------------------------------------------------------------------
+// Defines
+//----------------------------------------------------------------------------------------
+
+//the category that all allocations should go into
+#define MEMORY_CATEGORY			LT_MEM_TYPE_TEXTURE
+
+//the spacing added around each glyph on a page so that filtering doesn't pick up the neighbors
+#define GLYPH_SPACING			2
+
+//the page pixel that glyphs are drawn over, white with no alpha
+#define EMPTY_PIXEL				0x0FFF
+
+
+//----------------------------------------------------------------------------------------
+// Utility functions
+//----------------------------------------------------------------------------------------
+
+//builds the key that glyphs are found by on the pages and in the cache
+static inline uint64 GetGlyphKey(uint32 nFont, texture_string_type_t cGlyph)
+{
+	//the characters are signed on some platforms, so go through the unsigned type to keep them positive
+	uint32 nChar = (sizeof(texture_string_type_t) == 1) ? (uint32)(uint8)cGlyph : (uint32)cGlyph;
+	return ((uint64)nFont << 32) | nChar;
+}
+
+//the size of the cell a glyph takes up on a page
+static inline uint32 GetCellWidth(const CGlyphBitmap& Bitmap)	{ return Bitmap.m_rBlackBox.GetWidth() + GLYPH_SPACING; }
+static inline uint32 GetCellHeight(const CGlyphBitmap& Bitmap)	{ return Bitmap.m_rBlackBox.GetHeight() + GLYPH_SPACING; }
+
+
+//----------------------------------------------------------------------------------------
+// CGlyphAtlasPage
+//----------------------------------------------------------------------------------------
+
+CGlyphAtlasPage::CGlyphAtlasPage() :
+	m_hTexture(NULL),
+	m_nShelfBottom(0),
+	m_nPinCount(0),
+	m_nLastUsed(0),
+	m_bDirty(false)
+{
+	m_Pixels.resize(GLYPHATLAS_PAGE_SIZE * GLYPHATLAS_PAGE_SIZE, EMPTY_PIXEL);
+}
+
+void CGlyphAtlasPage::Clear()
+{
+	std::fill(m_Pixels.begin(), m_Pixels.end(), (uint16)EMPTY_PIXEL);
+	m_Shelves.clear();
+	m_nShelfBottom = 0;
+	m_Glyphs.clear();
+	m_nLastUsed = 0;
+
+	//the whole texture needs to be replaced
+	m_rDirty.Left()		= 0;
+	m_rDirty.Top()		= 0;
+	m_rDirty.Right()	= GLYPHATLAS_PAGE_SIZE;
+	m_rDirty.Bottom()	= GLYPHATLAS_PAGE_SIZE;
+	m_bDirty = true;
+}
+
+bool CGlyphAtlasPage::AllocateCell(std::vector<SShelf>& Shelves, uint32& nBottom, uint32 nWidth, uint32 nHeight, uint32& nX, uint32& nY)
+{
+	if((nWidth > GLYPHATLAS_PAGE_SIZE) || (nHeight > GLYPHATLAS_PAGE_SIZE))
+		return false;
+
+	//use the shortest shelf that it fits on so that the tall shelves are left for the tall glyphs
+	SShelf* pBest = NULL;
+	for(std::vector<SShelf>::iterator itShelf = Shelves.begin(); itShelf != Shelves.end(); ++itShelf)
+	{
+		if((itShelf->m_nHeight >= nHeight) && (itShelf->m_nWidthUsed + nWidth <= GLYPHATLAS_PAGE_SIZE))
+		{
+			if(!pBest || (itShelf->m_nHeight < pBest->m_nHeight))
+				pBest = &(*itShelf);
+		}
+	}
+
+	//otherwise start a new shelf
+	if(!pBest)
+	{
+		if(nBottom + nHeight > GLYPHATLAS_PAGE_SIZE)
+			return false;
+
+		SShelf NewShelf;
+		NewShelf.m_nY			= nBottom;
+		NewShelf.m_nHeight		= nHeight;
+		NewShelf.m_nWidthUsed	= 0;
+		Shelves.push_back(NewShelf);
+		nBottom += nHeight;
+
+		pBest = &Shelves.back();
+	}
+
+	nX = pBest->m_nWidthUsed;
+	nY = pBest->m_nY;
+	pBest->m_nWidthUsed += nWidth;
+	return true;
+}
+
+
+//----------------------------------------------------------------------------------------
+// CGlyphAtlas
+//----------------------------------------------------------------------------------------
+
+CGlyphAtlas::CGlyphAtlas() :
+	m_pRasterizer(NULL),
+	m_pUploader(NULL),
+	m_nMaxPages(GLYPHATLAS_MAX_PAGES),
+	m_nUseCounter(0)
+{
+	ResetStats();
+}
+
+CGlyphAtlas::~CGlyphAtlas()
+{
+	//the renderer is already gone by the time the singleton is destroyed, so the textures
+	//are left alone here
+	FreeAll();
+}
+
+CGlyphAtlas& CGlyphAtlas::GetSingleton()
+{
+	static CGlyphAtlas sSingleton;
+	return sSingleton;
+}
+
+void CGlyphAtlas::Init(CGlyphRasterizer* pRasterizer, CGlyphPageUploader* pUploader, uint32 nMaxPages)
+{
+	Term();
+
+	m_pRasterizer	= pRasterizer;
+	m_pUploader		= pUploader;
+	m_nMaxPages		= LTMAX(nMaxPages, 1);
+}
+
+void CGlyphAtlas::Term()
+{
+	if(m_pUploader)
+	{
+		for(uint32 nCurrPage = 0; nCurrPage < m_Pages.size(); nCurrPage++)
+		{
+			//pages that are still in use are about to be freed out from under their strings
+			ASSERT(m_Pages[nCurrPage]->m_nPinCount == 0);
+			m_pUploader->ReleasePage(m_Pages[nCurrPage]);
+		}
+	}
+
+	FreeAll();
+}
+
+void CGlyphAtlas::FreeAll()
+{
+	for(uint32 nCurrPage = 0; nCurrPage < m_Pages.size(); nCurrPage++)
+	{
+		delete m_Pages[nCurrPage];
+	}
+	m_Pages.clear();
+
+	m_CachedGlyphs.clear();
+	m_Fonts.clear();
+	m_FontLookup.clear();
+}
+
+void CGlyphAtlas::ResetStats()
+{
+	memset(&m_Stats, 0, sizeof(m_Stats));
+}
+
+bool CGlyphAtlas::GetFont(const CFontInfo& Font, uint32& nFont)
+{
+	//build up the key from everything that changes how the glyphs look
+	char szKey[64];
+	LTSNPrintF(szKey, LTARRAYSIZE(szKey), "|%u|%u|%u", Font.m_nHeight, Font.m_nStyle, (uint32)Font.m_lfCharSet);
+
+	std::string sKey;
+	for(const texture_string_type_t* pszChar = Font.m_szTypeface; *pszChar; pszChar++)
+	{
+		uint32 nChar = (sizeof(texture_string_type_t) == 1) ? (uint32)(uint8)*pszChar : (uint32)*pszChar;
+		sKey.append((const char*)&nChar, sizeof(nChar));
+	}
+	sKey += szKey;
+
+	std::map<std::string, uint32>::iterator itFont = m_FontLookup.find(sKey);
+	if(itFont != m_FontLookup.end())
+	{
+		nFont = itFont->second;
+		return true;
+	}
+
+	SFont NewFont;
+	NewFont.m_FontInfo = Font;
+	if(!m_pRasterizer->GetRowHeight(Font, NewFont.m_nRowHeight))
+		return false;
+
+	nFont = (uint32)m_Fonts.size();
+	m_Fonts.push_back(NewFont);
+	m_FontLookup[sKey] = nFont;
+	return true;
+}
+
+CGlyphAtlas::SCachedGlyph* CGlyphAtlas::GetCachedGlyph(uint32 nFont, texture_string_type_t cGlyph)
+{
+	uint64 nKey = GetGlyphKey(nFont, cGlyph);
+
+	TCachedGlyphMap::iterator itGlyph = m_CachedGlyphs.find(nKey);
+	if(itGlyph != m_CachedGlyphs.end())
+		return &itGlyph->second;
+
+	SCachedGlyph& Cached = m_CachedGlyphs[nKey];
+	Cached.m_nPageRefs = 0;
+	Cached.m_Bitmap.m_nTotalWidth = 0;
+
+	if(!m_pRasterizer->RasterizeGlyph(m_Fonts[nFont].m_FontInfo, cGlyph, Cached.m_Bitmap))
+	{
+		m_CachedGlyphs.erase(nKey);
+		return NULL;
+	}
+
+	m_Stats.m_nRasterizations++;
+	return &Cached;
+}
+
+bool CGlyphAtlas::CanFitGlyphs(const CGlyphAtlasPage* pPage, uint32 nFont, const CTextureStringGlyph* pGlyphs, uint32 nNumGlyphs, uint32& nNumMissing)
+{
+	//try packing the missing glyphs into a copy of the shelves
+	std::vector<CGlyphAtlasPage::SShelf> Shelves(pPage->m_Shelves);
+	uint32 nBottom = pPage->m_nShelfBottom;
+
+	nNumMissing = 0;
+	for(uint32 nCurrGlyph = 0; nCurrGlyph < nNumGlyphs; nCurrGlyph++)
+	{
+		uint64 nKey = GetGlyphKey(nFont, pGlyphs[nCurrGlyph].m_cGlyph);
+		if(pPage->m_Glyphs.find(nKey) != pPage->m_Glyphs.end())
+			continue;
+
+		nNumMissing++;
+
+		const CGlyphBitmap& Bitmap = m_CachedGlyphs[nKey].m_Bitmap;
+		uint32 nX, nY;
+		if(!CGlyphAtlasPage::AllocateCell(Shelves, nBottom, GetCellWidth(Bitmap), GetCellHeight(Bitmap), nX, nY))
+			return false;
+	}
+
+	return true;
+}
+
+CGlyphAtlasPage* CGlyphAtlas::GetEmptyPage()
+{
+	if(m_Pages.size() >= m_nMaxPages)
+	{
+		//reuse the least recently used page that no string is holding onto
+		CGlyphAtlasPage* pOldest = NULL;
+		for(uint32 nCurrPage = 0; nCurrPage < m_Pages.size(); nCurrPage++)
+		{
+			CGlyphAtlasPage* pPage = m_Pages[nCurrPage];
+			if((pPage->m_nPinCount == 0) && (!pOldest || (pPage->m_nLastUsed < pOldest->m_nLastUsed)))
+				pOldest = pPage;
+		}
+
+		if(pOldest)
+		{
+			ClearPage(pOldest);
+			m_Stats.m_nPagesEvicted++;
+			return pOldest;
+		}
+
+		//every page is in use, so the budget has to be exceeded
+	}
+
+	CGlyphAtlasPage* pNewPage;
+	LT_MEM_TRACK_ALLOC(pNewPage = new CGlyphAtlasPage, MEMORY_CATEGORY);
+	if(!pNewPage)
+		return NULL;
+
+	m_Pages.push_back(pNewPage);
+	m_Stats.m_nPagesCreated++;
+
+	//the texture has to be created with the whole page
+	pNewPage->Clear();
+	return pNewPage;
+}
+
+void CGlyphAtlas::ClearPage(CGlyphAtlasPage* pPage)
+{
+	//the cached glyphs that aren't on any page anymore are thrown out
+	for(CGlyphAtlasPage::TGlyphMap::iterator itGlyph = pPage->m_Glyphs.begin(); itGlyph != pPage->m_Glyphs.end(); ++itGlyph)
+	{
+		TCachedGlyphMap::iterator itCached = m_CachedGlyphs.find(itGlyph->first);
+		if(itCached == m_CachedGlyphs.end())
+			continue;
+
+		if(--itCached->second.m_nPageRefs == 0)
+			m_CachedGlyphs.erase(itCached);
+	}
+
+	pPage->Clear();
+}
+
+void CGlyphAtlas::PlaceGlyph(CGlyphAtlasPage* pPage, uint64 nKey, SCachedGlyph* pCached, texture_string_type_t cGlyph)
+{
+	const CGlyphBitmap& Bitmap = pCached->m_Bitmap;
+
+	uint32 nX, nY;
+	if(!CGlyphAtlasPage::AllocateCell(pPage->m_Shelves, pPage->m_nShelfBottom, GetCellWidth(Bitmap), GetCellHeight(Bitmap), nX, nY))
+	{
+		//this was checked before getting here
+		ASSERT(!"CGlyphAtlas::PlaceGlyph: Glyph doesn't fit on the page");
+		return;
+	}
+
+	LTRect2n rCopyTo;
+	rCopyTo.Left()		= nX + (GLYPH_SPACING / 2);
+	rCopyTo.Top()		= nY + (GLYPH_SPACING / 2);
+	rCopyTo.Right()		= rCopyTo.Left() + Bitmap.m_rBlackBox.GetWidth();
+	rCopyTo.Bottom()	= rCopyTo.Top() + Bitmap.m_rBlackBox.GetHeight();
+
+	//copy the coverage into the alpha of the page, leaving the color white so that the
+	//glyph can be drawn in any color
+	const uint32 nGlyphWidth = rCopyTo.GetWidth();
+	const uint32 nGlyphHeight = rCopyTo.GetHeight();
+	for(uint32 y = 0; y < nGlyphHeight; y++)
+	{
+		const uint8* pSrc = &Bitmap.m_Coverage[y * nGlyphWidth];
+		uint16* pDest = &pPage->m_Pixels[(rCopyTo.Top() + y) * GLYPHATLAS_PAGE_SIZE + rCopyTo.Left()];
+
+		for(uint32 x = 0; x < nGlyphWidth; x++)
+		{
+			uint32 nAlpha = (pSrc[x] * 15 + 127) / 255;
+			pDest[x] = (uint16)(EMPTY_PIXEL | (nAlpha << 12));
+		}
+	}
+
+	//grow the area that needs uploading
+	if(!pPage->m_bDirty)
+	{
+		pPage->m_rDirty = rCopyTo;
+		pPage->m_bDirty = true;
+	}
+	else
+	{
+		pPage->m_rDirty.Left()		= LTMIN(pPage->m_rDirty.Left(), rCopyTo.Left());
+		pPage->m_rDirty.Top()		= LTMIN(pPage->m_rDirty.Top(), rCopyTo.Top());
+		pPage->m_rDirty.Right()		= LTMAX(pPage->m_rDirty.Right(), rCopyTo.Right());
+		pPage->m_rDirty.Bottom()	= LTMAX(pPage->m_rDirty.Bottom(), rCopyTo.Bottom());
+	}
+
+	//and set up the glyph the strings will use
+	CTextureStringGlyph& Glyph = pPage->m_Glyphs[nKey];
+	Glyph.m_cGlyph		= cGlyph;
+	Glyph.m_rBlackBox	= Bitmap.m_rBlackBox;
+	Glyph.m_nTotalWidth	= Bitmap.m_nTotalWidth;
+	Glyph.m_fU			= (float)(rCopyTo.Left() + 0.5f) / (float)GLYPHATLAS_PAGE_SIZE;
+	Glyph.m_fV			= (float)(rCopyTo.Top() + 0.5f) / (float)GLYPHATLAS_PAGE_SIZE;
+	Glyph.m_fTexWidth	= rCopyTo.GetWidth() / (float)GLYPHATLAS_PAGE_SIZE;
+	Glyph.m_fTexHeight	= rCopyTo.GetHeight() / (float)GLYPHATLAS_PAGE_SIZE;
+
+	pCached->m_nPageRefs++;
+	m_Stats.m_nGlyphsPlaced++;
+}
+
+CGlyphAtlasPage* CGlyphAtlas::AcquireGlyphs(const CFontInfo& Font, CTextureStringGlyph* pGlyphs, uint32 nNumGlyphs, uint32& nRowHeight)
+{
+	if(!IsInitialized())
+		return NULL;
+
+	uint32 nFont;
+	if(!GetFont(Font, nFont))
+		return NULL;
+
+	//make sure all the glyphs are rasterized, and hold onto them while the page is found since
+	//evicting a page could otherwise throw them out
+	uint32 nNumHeld = 0;
+	bool bSuccess = true;
+	for(; nNumHeld < nNumGlyphs; nNumHeld++)
+	{
+		SCachedGlyph* pCached = GetCachedGlyph(nFont, pGlyphs[nNumHeld].m_cGlyph);
+		if(!pCached)
+		{
+			bSuccess = false;
+			break;
+		}
+		pCached->m_nPageRefs++;
+	}
+
+	//use a page that already has all the glyphs, otherwise the most recently used one that
+	//has room for the rest
+	CGlyphAtlasPage* pPage = NULL;
+	if(bSuccess)
+	{
+		for(uint32 nCurrPage = 0; nCurrPage < m_Pages.size(); nCurrPage++)
+		{
+			CGlyphAtlasPage* pCurrPage = m_Pages[nCurrPage];
+
+			uint32 nNumMissing;
+			if(!CanFitGlyphs(pCurrPage, nFont, pGlyphs, nNumGlyphs, nNumMissing))
+				continue;
+
+			if(nNumMissing == 0)
+			{
+				pPage = pCurrPage;
+				break;
+			}
+
+			if(!pPage || (pCurrPage->m_nLastUsed > pPage->m_nLastUsed))
+				pPage = pCurrPage;
+		}
+
+		//otherwise start on a new page
+		if(!pPage)
+		{
+			pPage = GetEmptyPage();
+
+			uint32 nNumMissing;
+			if(pPage && !CanFitGlyphs(pPage, nFont, pGlyphs, nNumGlyphs, nNumMissing))
+			{
+				DEBUG_PRINT(1, ("CGlyphAtlas::AcquireGlyphs: The glyphs don't fit on a single page"));
+				pPage = NULL;
+			}
+		}
+	}
+
+	if(pPage)
+	{
+		//put the missing glyphs on the page and hand back the glyph information
+		for(uint32 nCurrGlyph = 0; nCurrGlyph < nNumGlyphs; nCurrGlyph++)
+		{
+			CTextureStringGlyph& Glyph = pGlyphs[nCurrGlyph];
+			uint64 nKey = GetGlyphKey(nFont, Glyph.m_cGlyph);
+
+			CGlyphAtlasPage::TGlyphMap::iterator itGlyph = pPage->m_Glyphs.find(nKey);
+			if(itGlyph == pPage->m_Glyphs.end())
+			{
+				PlaceGlyph(pPage, nKey, &m_CachedGlyphs[nKey], Glyph.m_cGlyph);
+				itGlyph = pPage->m_Glyphs.find(nKey);
+			}
+			else
+			{
+				m_Stats.m_nGlyphHits++;
+			}
+
+			Glyph = itGlyph->second;
+		}
+
+		pPage->m_nPinCount++;
+		pPage->m_nLastUsed = ++m_nUseCounter;
+		nRowHeight = m_Fonts[nFont].m_nRowHeight;
+	}
+
+	//let go of the glyphs again, throwing out any that didn't end up on a page
+	for(uint32 nCurrGlyph = 0; nCurrGlyph < nNumHeld; nCurrGlyph++)
+	{
+		TCachedGlyphMap::iterator itCached = m_CachedGlyphs.find(GetGlyphKey(nFont, pGlyphs[nCurrGlyph].m_cGlyph));
+		if(itCached == m_CachedGlyphs.end())
+			continue;
+
+		if(--itCached->second.m_nPageRefs == 0)
+			m_CachedGlyphs.erase(itCached);
+	}
+
+	return pPage;
+}
+
+void CGlyphAtlas::ReleasePage(CGlyphAtlasPage* pPage)
+{
+	if(!pPage)
+		return;
+
+	ASSERT(pPage->m_nPinCount > 0);
+	pPage->m_nPinCount--;
+}
+
+bool CGlyphAtlas::FlushPage(CGlyphAtlasPage* pPage)
+{
+	if(!pPage || !pPage->m_bDirty)
+		return true;
+
+	if(!m_pUploader || !m_pUploader->UploadPage(pPage, pPage->m_rDirty))
+		return false;
+
+	m_Stats.m_nTexelsUploaded += pPage->m_rDirty.GetWidth() * pPage->m_rDirty.GetHeight();
+	pPage->m_bDirty = false;
+	return true;
+}
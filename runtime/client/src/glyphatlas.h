@@ -0,0 +1,239 @@
+//-------------------------------------------------------------------
+// GlyphAtlas.h
+//
+// Provides a process wide cache of glyphs for the texture strings.
+// Each glyph is rasterized once per font, size and character, and is
+// packed into shared atlas pages that the texture string images
+// reference instead of building a bitmap font of their own. Pages
+// only get new glyphs added to them, so only the changed area has to
+// be sent to the texture. Once the page budget is reached, pages that
+// no texture string is using are evicted least recently used first.
+//
+// The rasterizing and the textures are left to the platform, so the
+// atlas itself only deals with memory.
+//
+//-------------------------------------------------------------------
+
+#ifndef __GLYPHATLAS_H__
+#define __GLYPHATLAS_H__
+
+#ifndef __TEXTURESTRINGIMAGE_H__
+#	include "texturestringimage.h"
+#endif
+
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//the width and height of a single atlas page in pixels
+#define GLYPHATLAS_PAGE_SIZE		512
+
+//the default number of pages that can be around before unused ones are evicted
+#define GLYPHATLAS_MAX_PAGES		8
+
+//a single rasterized glyph. The coverage is one byte per pixel of the black box
+class CGlyphBitmap
+{
+public:
+
+	//the black box of the glyph, relative to the upper left of the glyph cell
+	LTRect2n			m_rBlackBox;
+
+	//the distance to move to get to the next character
+	uint32				m_nTotalWidth;
+
+	//the coverage values, 0..255, black box width * height
+	std::vector<uint8>	m_Coverage;
+};
+
+//handles creating the glyph images, implemented by each platform
+class CGlyphRasterizer
+{
+public:
+
+	virtual ~CGlyphRasterizer()		{}
+
+	//called to get the height of a single row of text in the font
+	virtual bool	GetRowHeight(const CFontInfo& Font, uint32& nRowHeight) = 0;
+
+	//called to rasterize a single glyph of the font
+	virtual bool	RasterizeGlyph(const CFontInfo& Font, texture_string_type_t cGlyph, CGlyphBitmap& Bitmap) = 0;
+};
+
+class CGlyphAtlasPage;
+
+//handles getting pages onto textures, implemented by each platform
+class CGlyphPageUploader
+{
+public:
+
+	virtual ~CGlyphPageUploader()	{}
+
+	//called to update the given area of the page's texture, creating the texture if needed
+	virtual bool	UploadPage(CGlyphAtlasPage* pPage, const LTRect2n& rDirty) = 0;
+
+	//called to release the page's texture when the page is evicted or the atlas is shut down
+	virtual void	ReleasePage(CGlyphAtlasPage* pPage) = 0;
+};
+
+//a single page of the atlas
+class CGlyphAtlasPage
+{
+public:
+
+	//the image of the page in ARGB4444, which is white with the glyph coverage in the alpha
+	const uint16*	GetPixels() const		{ return &m_Pixels[0]; }
+	uint32			GetSize() const			{ return GLYPHATLAS_PAGE_SIZE; }
+
+	//the number of glyphs on the page
+	uint32			GetNumGlyphs() const	{ return (uint32)m_Glyphs.size(); }
+
+	//the texture that holds this page, maintained by the page uploader
+	HTEXTURE		m_hTexture;
+
+private:
+
+	friend class CGlyphAtlas;
+
+	CGlyphAtlasPage();
+
+	//throws out all the glyphs on this page
+	void			Clear();
+
+	//a row of glyphs that the page is packed into
+	struct SShelf
+	{
+		uint32	m_nY;
+		uint32	m_nHeight;
+		uint32	m_nWidthUsed;
+	};
+
+	//finds a place for a glyph cell of the given size in the shelves, and reserves it
+	static bool		AllocateCell(std::vector<SShelf>& Shelves, uint32& nBottom, uint32 nWidth, uint32 nHeight, uint32& nX, uint32& nY);
+
+	//the image data
+	std::vector<uint16>		m_Pixels;
+
+	//the shelves, and the first row below all of them
+	std::vector<SShelf>		m_Shelves;
+	uint32					m_nShelfBottom;
+
+	//the glyphs on the page by font and character, with their texture coordinates filled in
+	typedef std::unordered_map<uint64, CTextureStringGlyph>	TGlyphMap;
+	TGlyphMap				m_Glyphs;
+
+	//the number of texture string images using this page. Pages in use are never evicted
+	uint32					m_nPinCount;
+
+	//when the page was last used, for the eviction
+	uint32					m_nLastUsed;
+
+	//the area that has changed since the page was last uploaded
+	LTRect2n				m_rDirty;
+	bool					m_bDirty;
+};
+
+//the atlas itself
+class CGlyphAtlas
+{
+public:
+
+	CGlyphAtlas();
+	~CGlyphAtlas();
+
+	//provides access to the atlas shared by all the texture strings
+	static CGlyphAtlas&		GetSingleton();
+
+	//called to set up the platform side. The atlas must be initialized before glyphs are requested
+	void					Init(CGlyphRasterizer* pRasterizer, CGlyphPageUploader* pUploader, uint32 nMaxPages = GLYPHATLAS_MAX_PAGES);
+	bool					IsInitialized() const		{ return m_pRasterizer != NULL; }
+
+	//frees all the pages and the cached glyphs
+	void					Term();
+
+	//finds a page that has all of the glyphs of the font, putting any that are missing onto it,
+	//and fills in the glyph dimensions and texture coordinates. The glyphs must have the character
+	//filled in. The page is kept until it is released. This will return NULL on failure
+	CGlyphAtlasPage*		AcquireGlyphs(const CFontInfo& Font, CTextureStringGlyph* pGlyphs, uint32 nNumGlyphs, uint32& nRowHeight);
+	void					ReleasePage(CGlyphAtlasPage* pPage);
+
+	//uploads anything that has been put on the page since it was last uploaded
+	bool					FlushPage(CGlyphAtlasPage* pPage);
+
+	//the number of pages currently allocated
+	uint32					GetNumPages() const			{ return (uint32)m_Pages.size(); }
+
+	//counters for tracking how well the cache is doing
+	struct SStats
+	{
+		uint32	m_nRasterizations;		//glyphs that had to be rasterized
+		uint32	m_nGlyphHits;			//glyphs that were already on the page that was used
+		uint32	m_nGlyphsPlaced;		//glyphs that were put onto a page
+		uint32	m_nPagesCreated;
+		uint32	m_nPagesEvicted;
+		uint32	m_nTexelsUploaded;
+	};
+
+	const SStats&			GetStats() const			{ return m_Stats; }
+	void					ResetStats();
+
+private:
+
+	//a rasterized glyph, shared by all the pages that have it
+	struct SCachedGlyph
+	{
+		CGlyphBitmap	m_Bitmap;
+		uint32			m_nPageRefs;
+	};
+
+	//a font that glyphs have been requested from
+	struct SFont
+	{
+		CFontInfo		m_FontInfo;
+		uint32			m_nRowHeight;
+	};
+
+	//finds or adds the font, returning the index of it
+	bool					GetFont(const CFontInfo& Font, uint32& nFont);
+
+	//gets the cached glyph, rasterizing it if needed
+	SCachedGlyph*			GetCachedGlyph(uint32 nFont, texture_string_type_t cGlyph);
+
+	//determines whether or not the missing glyphs will fit on the page, and how many of them are missing
+	bool					CanFitGlyphs(const CGlyphAtlasPage* pPage, uint32 nFont, const CTextureStringGlyph* pGlyphs, uint32 nNumGlyphs, uint32& nNumMissing);
+
+	//gets a page to put new glyphs on, evicting one if there are too many
+	CGlyphAtlasPage*		GetEmptyPage();
+
+	//throws out everything on a page, releasing the glyphs it held
+	void					ClearPage(CGlyphAtlasPage* pPage);
+
+	//puts a glyph onto a page
+	void					PlaceGlyph(CGlyphAtlasPage* pPage, uint64 nKey, SCachedGlyph* pCached, texture_string_type_t cGlyph);
+
+	//frees everything without going through the uploader
+	void					FreeAll();
+
+	CGlyphRasterizer*		m_pRasterizer;
+	CGlyphPageUploader*		m_pUploader;
+	uint32					m_nMaxPages;
+
+	//the fonts, which are looked up by a key built from the font info
+	std::vector<SFont>					m_Fonts;
+	std::map<std::string, uint32>		m_FontLookup;
+
+	//the glyphs that have been rasterized, by font and character
+	typedef std::unordered_map<uint64, SCachedGlyph>	TCachedGlyphMap;
+	TCachedGlyphMap						m_CachedGlyphs;
+
+	//the pages
+	std::vector<CGlyphAtlasPage*>		m_Pages;
+
+	//incremented on each request, for tracking how recently the pages have been used
+	uint32								m_nUseCounter;
+
+	SStats								m_Stats;
+};
+
+#endif
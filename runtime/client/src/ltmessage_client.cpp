@@ -10,6 +10,7 @@
 #include "packetdefs.h" // For POSITION_EXTRA_BYTE access
 #include "iltcommon.h"
 #include "stringmgr.h"
+#include "netdelta.h"
 
 // Client-side world interface
 #include "world_client_bsp.h"
@@ -89,6 +90,17 @@ LTVector CLTMessage_Read_Client::ReadCompPos(CPacket_Read &cPacket)
 	return vResult;
 }
 
+LTVector CLTMessage_Read_Client::ReadDeltaCompPos(CPacket_Read &cPacket, const NetObjState *pBaseline, NetObjState *pState)
+{
+	CompWorldPos cCompPos;
+	nd_ReadPos(cPacket, &cCompPos, pBaseline, pState);
+
+	LTVector vResult;
+	g_pWorld->DecodeCompressWorldPosition(&vResult, &cCompPos);
+
+	return vResult;
+}
+
 HOBJECT CLTMessage_Read_Client::ReadObject(CPacket_Read &cPacket)
 {
 	HOBJECT hResult = LTNULL;
@@ -34,6 +34,7 @@ public:
 
 	// Static functions for reading straight from a CPacket_Read
 	static LTVector ReadCompPos(CPacket_Read &cPacket);
+	static LTVector ReadDeltaCompPos(CPacket_Read &cPacket, const NetObjState *pBaseline, NetObjState *pState);
 	static HOBJECT ReadObject(CPacket_Read &cPacket);
 
 	static LTVector PeekCompPos(const CPacket_Read &cPacket);
@@ -232,6 +232,93 @@ static void ps_HandleParticleCollisions(LTParticleSystem *pSystem, LTFLOAT t)
 }
 
 
+// The bounding box of a set of particles.  This is the same as calling
+// ps_UpdateBox for each of them, but it's kept in locals so the compiler
+// doesn't have to write it back to the system after every particle.
+class CParticleBox
+{
+public:
+
+	CParticleBox(const LTParticleSystem *pSystem)
+	{
+		//multiply by sqrt of 2 to compensate for particles that are up to a 45 degree
+		//angle
+		m_fSizeScale = (pSystem->m_psFlags & PS_USEROTATION) ? 1.41421356237309504f : 1.0f;
+
+		m_fMinX = pSystem->m_MinPos.x;
+		m_fMinY = pSystem->m_MinPos.y;
+		m_fMinZ = pSystem->m_MinPos.z;
+		m_fMaxX = pSystem->m_MaxPos.x;
+		m_fMaxY = pSystem->m_MaxPos.y;
+		m_fMaxZ = pSystem->m_MaxPos.z;
+	}
+
+	void Add(const LTVector &cPos, float fSize)
+	{
+		fSize *= m_fSizeScale;
+
+		m_fMinX = LTMIN(m_fMinX, cPos.x - fSize);
+		m_fMinY = LTMIN(m_fMinY, cPos.y - fSize);
+		m_fMinZ = LTMIN(m_fMinZ, cPos.z - fSize);
+		m_fMaxX = LTMAX(m_fMaxX, cPos.x + fSize);
+		m_fMaxY = LTMAX(m_fMaxY, cPos.y + fSize);
+		m_fMaxZ = LTMAX(m_fMaxZ, cPos.z + fSize);
+	}
+
+	void Store(LTParticleSystem *pSystem) const
+	{
+		pSystem->m_MinPos.Init(m_fMinX, m_fMinY, m_fMinZ);
+		pSystem->m_MaxPos.Init(m_fMaxX, m_fMaxY, m_fMaxZ);
+	}
+
+private:
+
+	float	m_fSizeScale;
+	float	m_fMinX, m_fMinY, m_fMinZ;
+	float	m_fMaxX, m_fMaxY, m_fMaxZ;
+};
+
+// Move the particles along and grow the bounding box to fit them.  If
+// bCanDie is set, particles are aged and the ones that run out of life
+// are removed.
+template<bool bCanDie>
+static void ps_MoveParticles(LTParticleSystem *pSystem, float t, float gravityAccel)
+{
+	CParticleBox cBox(pSystem);
+
+	PSParticle *pParticle = pSystem->m_ParticleHead.m_pNext;
+	PSParticle *pEnd = &pSystem->m_ParticleHead;
+
+	while(pParticle != pEnd)
+	{
+		// Read the link up front so the next particle can be fetched while
+		// this one is being worked on.
+		PSParticle *pNext = pParticle->m_pNext;
+
+		if(bCanDie)
+		{
+			pParticle->m_Lifetime -= t;
+			if(pParticle->m_Lifetime < 0.0f)
+			{
+				ps_RemoveParticle(pSystem, pParticle);
+				pParticle = pNext;
+				continue;
+			}
+		}
+
+		pParticle->m_Pos.x += pParticle->m_Velocity.x * t;
+		pParticle->m_Pos.y += pParticle->m_Velocity.y * t;
+		pParticle->m_Pos.z += pParticle->m_Velocity.z * t;
+		pParticle->m_fAngle += pParticle->m_fAngularVelocity * t;
+		cBox.Add(pParticle->m_Pos, pParticle->m_Size);
+		pParticle->m_Velocity.y += gravityAccel;
+
+		pParticle = pNext;
+	}
+
+	cBox.Store(pSystem);
+}
+
 void ps_UpdateParticles(LTParticleSystem *pSystem, LTFLOAT t)
 {
 	LTVector basePos = pSystem->GetPos();
@@ -250,48 +337,16 @@ void ps_UpdateParticles(LTParticleSystem *pSystem, LTFLOAT t)
 	float gravityAccel = pSystem->m_GravityAccel * t;
 
 	// Take one of 2 loops.
-	PSParticle *pParticle = pSystem->m_ParticleHead.m_pNext;
-	PSParticle *pEnd = &pSystem->m_ParticleHead;
-	PSParticle *pNext;
-
 	if(flags & PS_NEVERDIE)
 	{
-		while(pParticle != pEnd)
-		{
-			pParticle->m_Pos.x += pParticle->m_Velocity.x * t;
-			pParticle->m_Pos.y += pParticle->m_Velocity.y * t;
-			pParticle->m_Pos.z += pParticle->m_Velocity.z * t;
-			pParticle->m_fAngle += pParticle->m_fAngularVelocity * t;
-			ps_UpdateBox(pSystem, pParticle->m_Pos, pParticle->m_Size);
-			pParticle->m_Velocity.y += gravityAccel;
-
-			pParticle = pParticle->m_pNext;
-		}
+		ps_MoveParticles<false>(pSystem, t, gravityAccel);
 	}
 	else
 	{
-		while(pParticle != pEnd)
-		{
-			pParticle->m_Lifetime -= t;
-			if(pParticle->m_Lifetime < 0.0f)
-			{
-				pNext = pParticle->m_pNext;
-				ps_RemoveParticle(pSystem, pParticle);
-				pParticle = pNext;
-				continue;
-			}
-
-			pParticle->m_Pos.x += pParticle->m_Velocity.x * t;
-			pParticle->m_Pos.y += pParticle->m_Velocity.y * t;
-			pParticle->m_Pos.z += pParticle->m_Velocity.z * t;
-			pParticle->m_fAngle += pParticle->m_fAngularVelocity * t;
-			ps_UpdateBox(pSystem, pParticle->m_Pos, pParticle->m_Size);
-			pParticle->m_Velocity.y += gravityAccel;
-
-			pParticle = pParticle->m_pNext;
-		}
+		ps_MoveParticles<true>(pSystem, t, gravityAccel);
 	}
 
+	PSParticle *pParticle, *pEnd;
 
 	// Bounce the particles.
 	if(flags & PS_BOUNCE)
@@ -467,13 +522,17 @@ void ps_OptimizeParticles(LTParticleSystem *pSystem)
 		pSystem->m_MinPos.Init(100000.0f, 100000.0f, 100000.0f);
 		pSystem->m_MaxPos = -pSystem->m_MinPos;
 
+		CParticleBox cBox(pSystem);
+
 		pCur = pSystem->m_ParticleHead.m_pNext;
 		while(pCur != &pSystem->m_ParticleHead)
 		{
-			ps_UpdateBox(pSystem, pCur->m_Pos, pCur->m_Size);
+			cBox.Add(pCur->m_Pos, pCur->m_Size);
 			pCur = pCur->m_pNext;
 		}
 
+		cBox.Store(pSystem);
+
 		ps_UpdateParticleBoundingBox(pSystem);
 	}
 }
@@ -50,6 +50,12 @@ define_holder(IWorldClientBSP, world_bsp_client);
 static IClientFileMgr *client_file_mgr;
 define_holder(IClientFileMgr, client_file_mgr);
 
+//IClientLoaderThread
+#include "client_loaderthread.h"
+#include "cloaderthread.h"
+static IClientLoaderThread *client_loaderthread;
+define_holder(IClientLoaderThread, client_loaderthread);
+
 //the ILTClient game interface
 #include "iltclient.h"
 static ILTClient *ilt_client;
@@ -197,12 +203,16 @@ static void RemoveTaggedTrackers(ModelInstance* pInst)
 	}
 }
 
-// Reads and applies animation info out of the packet.
+// Reads and applies animation info out of the packet.  If pState is given,
+// the main tracker may be delta compressed against pBaseline and is saved in
+// pState (see WriteAnimInfo).
 static LTRESULT ReadAnimInfo(CClientShell *pShell, 
 							 ModelInstance *pInst, 
 							 CPacket_Read &cPacket,
 							 bool bAllowTransition,
-							 bool bAllowReset)
+							 bool bAllowReset,
+							 const NetObjState *pBaseline = LTNULL,
+							 NetObjState *pState = LTNULL)
 {
 	//we first need to tag every tracker as one that needs to be removed
 	if( pInst )
@@ -225,26 +235,60 @@ static LTRESULT ReadAnimInfo(CClientShell *pShell,
 
 		bool bDirty = cPacket.Readbool();
 
-		if (cPacket.Readbool())
-		{
-			nAnimIndex = cPacket.ReadBits(MODELINFO_ANIMINDEX_LONG);
-			bPlaying = cPacket.Readbool();
-		}
-		else
-		{
-			nAnimIndex = cPacket.ReadBits(MODELINFO_ANIMINDEX_SHORT);
-			bPlaying = true;
-		}
-		bLooping = cPacket.Readbool();
-
-		uint32 nAnimSizeType = cPacket.ReadBits(2);
 		const int aAnimLengths[4] = {
 			MODELINFO_ANIMTIME_SIZE0,
 			MODELINFO_ANIMTIME_SIZE1,
 			MODELINFO_ANIMTIME_SIZE2,
 			MODELINFO_ANIMTIME_SIZE3
 		};
-		nAnimTime = cPacket.ReadBits(aAnimLengths[nAnimSizeType]) * MODELINFO_ANIMTIME_RES;
+
+		// The main tracker might just have the change in time from the baseline
+		bool bDelta = false;
+		if (pState && bFirstTracker)
+			bDelta = cPacket.Readbool();
+
+		uint32 nAnimSizeType;
+		uint32 nScaledAnimTime;
+		if (bDelta)
+		{
+			if (!pBaseline || !(pBaseline->m_nFields & NETSTATE_ANIM))
+			{
+				RETURN_ERROR(1, ReadAnimInfo, LT_INVALIDSERVERPACKET);
+			}
+
+			nAnimIndex = pBaseline->m_nAnimIndex;
+			bPlaying = (pBaseline->m_nAnimFlags & NETSTATE_ANIM_PLAYING) != 0;
+			bLooping = (pBaseline->m_nAnimFlags & NETSTATE_ANIM_LOOPING) != 0;
+			nAnimSizeType = pBaseline->m_nAnimTimeType;
+			nScaledAnimTime = nd_ReadValue(cPacket, pBaseline->m_nAnimTime, aAnimLengths[nAnimSizeType]);
+		}
+		else
+		{
+			if (cPacket.Readbool())
+			{
+				nAnimIndex = cPacket.ReadBits(MODELINFO_ANIMINDEX_LONG);
+				bPlaying = cPacket.Readbool();
+			}
+			else
+			{
+				nAnimIndex = cPacket.ReadBits(MODELINFO_ANIMINDEX_SHORT);
+				bPlaying = true;
+			}
+			bLooping = cPacket.Readbool();
+
+			nAnimSizeType = cPacket.ReadBits(2);
+			nScaledAnimTime = cPacket.ReadBits(aAnimLengths[nAnimSizeType]);
+		}
+		nAnimTime = nScaledAnimTime * MODELINFO_ANIMTIME_RES;
+
+		if (pState && bFirstTracker)
+		{
+			pState->m_nAnimIndex = nAnimIndex;
+			pState->m_nAnimFlags = (bPlaying ? NETSTATE_ANIM_PLAYING : 0) | (bLooping ? NETSTATE_ANIM_LOOPING : 0);
+			pState->m_nAnimTimeType = (uint8)nAnimSizeType;
+			pState->m_nAnimTime = nScaledAnimTime;
+			pState->m_nFields |= NETSTATE_ANIM;
+		}
 
 		if (bFirstTracker) 
 		{
@@ -398,6 +442,12 @@ static LTRESULT UnpackObjectChange( CClientShell *pShell,
         changeFlags |= CF_TELEPORT;
     }
 
+	// Positions and rotations are delta compressed against the last ones the
+	// server sent.  New objects start over from nothing.
+	if (changeFlags & CF_NEWOBJECT)
+		nd_ClearState(&pObject->cd.m_GuaranteedState);
+	const NetObjState cBaseline = pObject->cd.m_GuaranteedState;
+
     if (changeFlags & CF_FILENAMES) 
 	{
 		ObjectCreateStruct createStruct;
@@ -498,11 +548,12 @@ static LTRESULT UnpackObjectChange( CClientShell *pShell,
 		{
 			newPos = cPacket.ReadLTVector();
 			newVel = cPacket.ReadLTVector();
+			pObject->cd.m_GuaranteedState.m_nFields &= ~(NETSTATE_POS|NETSTATE_VEL);
         }
         else 
 		{
-			newPos = CLTMessage_Read_Client::ReadCompPos(cPacket);
-			newVel = CLTMessage_Read::ReadCompLTVector(cPacket);
+			newPos = CLTMessage_Read_Client::ReadDeltaCompPos(cPacket, &cBaseline, &pObject->cd.m_GuaranteedState);
+			newVel = CLTMessage_Read::ReadDeltaCompLTVector(cPacket, &cBaseline, &pObject->cd.m_GuaranteedState);
         }
 		pd_OnObjectMove(pShell, pObject, &newPos, &newVel, (changeFlags & CF_NEWOBJECT) != 0, (changeFlags & CF_TELEPORT) != 0);
     }
@@ -514,10 +565,11 @@ static LTRESULT UnpackObjectChange( CClientShell *pShell,
         if (pObject->m_Flags & FLAG_FULLPOSITIONRES) 
 		{
 			cPacket.ReadType(&newRot);
+			pObject->cd.m_GuaranteedState.m_nFields &= ~NETSTATE_ROT;
         }
         else 
 		{
-			newRot = CLTMessage_Read::ReadCompLTRotation(cPacket);
+			newRot = CLTMessage_Read::ReadDeltaCompLTRotation(cPacket, &cBaseline, &pObject->cd.m_GuaranteedState);
         }
 
         pd_OnObjectRotate(pShell, pObject, &newRot, (changeFlags & CF_NEWOBJECT) != 0, (changeFlags & (CF_TELEPORT | CF_SNAPROTATION)) != 0);
@@ -1215,6 +1267,27 @@ static LTRESULT OnUnguaranteedUpdatePacket(CClientShell *pShell, CPacket_Read &c
     LTObject *pObject;
     LTRESULT dResult;
 
+	// Find the update this one was built from.
+	uint16 nSequence = cPacket.Readuint16();
+	const CNetSnapshot *pBaselineSnapshot = LTNULL;
+	if (cPacket.Readbool())
+	{
+		uint16 nBaseline = nSequence - (uint16)cPacket.ReadBits(NETDELTA_SNAPSHOT_BITS);
+		pBaselineSnapshot = pShell->m_UnguaranteedSnapshots.Find(nBaseline);
+
+		// We didn't get that one (the ack must have been for a later one that
+		// came in first), so this can't be read.
+		if (!pBaselineSnapshot)
+			return LT_OK;
+	}
+
+	// Save what's in this one so later updates can be built from it.  Updates
+	// that arrive late still get applied, but aren't saved.
+	CNetSnapshot *pSnapshot = pShell->m_UnguaranteedSnapshots.Begin(nSequence);
+	static CNetSnapshot s_LateSnapshot;
+	if (!pSnapshot)
+		pSnapshot = &s_LateSnapshot;
+
     while (!cPacket.EOP())
 	{
 		id = cPacket.Readuint16();
@@ -1232,12 +1305,19 @@ static LTRESULT OnUnguaranteedUpdatePacket(CClientShell *pShell, CPacket_Read &c
         else 
 		{
             pObject = g_pClientMgr->FindObject(id);
+
+			const NetObjState *pBaseline = LTNULL;
+			if (pBaselineSnapshot)
+				pBaseline = pBaselineSnapshot->Find(id);
+
+			NetObjState cState;
+			nd_ClearState(&cState);
            			
             if (flags & UUF_POS) 
 			{
-				newPos = CLTMessage_Read_Client::ReadCompPos(cPacket);
+				newPos = CLTMessage_Read_Client::ReadDeltaCompPos(cPacket, pBaseline, &cState);
 				if (cPacket.Readbool())
-					newVel = CLTMessage_Read::ReadCompLTVector(cPacket);
+					newVel = CLTMessage_Read::ReadDeltaCompLTVector(cPacket, pBaseline, &cState);
 				else
 					newVel.Init();
 
@@ -1271,7 +1351,7 @@ static LTRESULT OnUnguaranteedUpdatePacket(CClientShell *pShell, CPacket_Read &c
 
             if (flags & UUF_YROTATION) 
 			{
-				newRot = CLTMessage_Read::ReadYRotation(cPacket);
+				newRot = CLTMessage_Read::ReadDeltaYRotation(cPacket, pBaseline, &cState);
 			
                 if (pObject) 
 				{
@@ -1280,7 +1360,7 @@ static LTRESULT OnUnguaranteedUpdatePacket(CClientShell *pShell, CPacket_Read &c
             }
             else if (flags & UUF_ROT) 
 			{
-				newRot = CLTMessage_Read::ReadCompLTRotation(cPacket);
+				newRot = CLTMessage_Read::ReadDeltaCompLTRotation(cPacket, pBaseline, &cState);
 			
                 if (pObject) 
 				{
@@ -1296,11 +1376,35 @@ static LTRESULT OnUnguaranteedUpdatePacket(CClientShell *pShell, CPacket_Read &c
 					ASSERT(!"AnimInfo update on non-model object!");
 					break;
 				}
-				ReadAnimInfo(pShell, pObject ? ToModel(pObject) : NULL, cPacket, true, false);
+				dResult = ReadAnimInfo(pShell, pObject ? ToModel(pObject) : NULL, cPacket, true, false, pBaseline, &cState);
+				if (dResult != LT_OK)
+				{
+					break;
+				}
             }
+
+			pSnapshot->Add(id, cState);
         }
     }
 
+	// Only keep it if it was all there.  Otherwise the server will keep
+	// building from an older one until we ack something else.
+	if (cPacket.EOP() && (pSnapshot != &s_LateSnapshot))
+	{
+		pSnapshot->Finish();
+
+		if (!pShell->m_bUnguaranteedReceived || nd_IsNewer(nSequence, pShell->m_nUnguaranteedAck))
+		{
+			pShell->m_nUnguaranteedAck = nSequence;
+			pShell->m_bUnguaranteedReceived = true;
+			pShell->m_bUnguaranteedAckPending = true;
+		}
+	}
+	else
+	{
+		pSnapshot->Clear();
+	}
+
     return LT_OK;
 }
 
@@ -1444,14 +1548,33 @@ static LTRESULT OnClientObjectID(CClientShell *pShell, CPacket_Read &cPacket)
     return LT_OK;
 }
 
+// Preloaded files finish in the background while we're already in the world.
+static void PreloadModelCB(FileIdentifier *pIdent, LTRESULT dResult, void *pObj, void *pUser)
+{
+	if (dResult != LT_OK)
+	{
+		DEBUG_MODEL_REZ(("model-rez: client preload model %s not found", pIdent->m_Filename));
+	}
+	else
+	{
+		DEBUG_MODEL_REZ(("model-rez: client preload model %s", pIdent->m_Filename));
+	}
+}
+
+static void PreloadTextureCB(FileIdentifier *pIdent, LTRESULT dResult, void *pObj, void *pUser)
+{
+	SharedTexture *pTexture = (SharedTexture*)pObj;
+	if (pTexture)
+	{
+		pTexture->SetFlags(pTexture->GetFlags() | ST_TAGGED);
+	}
+}
+
 static LTRESULT OnPreloadListPacket(CClientShell *pShell, CPacket_Read &cPacket) 
 {
     uint8 type;
     FileRef ref;   
-	FileIdentifier* pFileIdent ;
-    Model *pModel;
     Sprite *pSprite;
-    SharedTexture *pTexture;
 
     ref.m_FileType = FILE_SERVERFILE;
 
@@ -1487,14 +1610,10 @@ static LTRESULT OnPreloadListPacket(CClientShell *pShell, CPacket_Read &cPacket)
 			{
 				ref.m_FileID = cPacket.Readuint16();
 				
-				if (g_pClientMgr->LoadModel(ref, pModel) != LT_OK)
+				if (client_loaderthread->LoaderThread()->QueueFile(FT_MODEL, ref, LOADPRI_NORMAL, PreloadModelCB) != LT_OK)
 				{
 					DEBUG_MODEL_REZ(("model-rez: client preload model file-id(%d) not found", ref.m_FileID ));
 				}
-				else 
-				{
-					DEBUG_MODEL_REZ(("model-rez: client preload model file-id(%d)", ref.m_FileID));
-				}
             }
         }
         break;
@@ -1521,11 +1640,7 @@ static LTRESULT OnPreloadListPacket(CClientShell *pShell, CPacket_Read &cPacket)
             while (!cPacket.EOP()) 
 			{
                 ref.m_FileID = cPacket.Readuint16();
-                pTexture = g_pClientMgr->AddSharedTexture(&ref);
-                if (pTexture) 
-				{
-                    pTexture->SetFlags(pTexture->GetFlags() | ST_TAGGED);
-                }
+                client_loaderthread->LoaderThread()->QueueFile(FT_TEXTURE, ref, LOADPRI_NORMAL, PreloadTextureCB);
             }
         }
         break;
@@ -1546,11 +1661,7 @@ static LTRESULT OnPreloadListPacket(CClientShell *pShell, CPacket_Read &cPacket)
             while (!cPacket.EOP()) 
 			{
                 ref.m_FileID = cPacket.Readuint16();
-                pFileIdent = client_file_mgr->GetFileIdentifier(&ref, TYPECODE_SOUND);
-                if (pFileIdent) 
-				{
-                    GetClientILTSoundMgrImpl()->CreateBuffer(*pFileIdent);
-                }
+                client_loaderthread->LoaderThread()->QueueFile(FT_SOUND, ref, LOADPRI_LOW);
             }
         }
         break;
@@ -1593,8 +1704,7 @@ static LTRESULT OnThreadLoadPacket(CClientShell *pShell, CPacket_Read &cPacket)
     }
     else if (fileType == FT_TEXTURE) 
 	{
-        g_pClientMgr->AddSharedTexture(&ref);
-        return LT_OK;
+        return client_loaderthread->LoaderThread()->QueueFile(FT_TEXTURE, ref, LOADPRI_LOW);
     }
     else 
 	{
@@ -1713,6 +1823,11 @@ bool CClientShell::NewConnectionNotify(CBaseConn *id, bool bIsLocal)
         m_bOnServer = true;
 		id->SetBandwidth(g_CV_BandwidthTargetClient);
 
+		// The server numbers its updates from scratch.
+		m_UnguaranteedSnapshots.Clear();
+		m_bUnguaranteedReceived = false;
+		m_bUnguaranteedAckPending = false;
+
         return true;
     }
 }
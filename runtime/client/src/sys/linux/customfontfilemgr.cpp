@@ -3,22 +3,84 @@
 
 #include "dsys.h"
 
+#include <algorithm>
+
+#ifndef LTARRAYSIZE
+#define LTARRAYSIZE(a)		(sizeof(a) / (sizeof((a)[0])))
+#endif
+
+// There's nothing to register with the system here.  The font files are
+// just remembered so the texture strings can load the fonts out of them
+// (see sys/linux/texturestringimage.cpp), which is done through the client
+// file manager so they can be in rez files.
+
+//-------------------------------------------
+//CCustomFontFile
+//-------------------------------------------
+CCustomFontFile::CCustomFontFile() :
+	m_bExtracted(false)
+{
+	LTStrCpy(m_pszFilename, "", LTARRAYSIZE(m_pszFilename));
+}
+
+CCustomFontFile::~CCustomFontFile()
+{
+}
+
+//-------------------------------------------
+//CCustomFontFileMgr
+//-------------------------------------------
 CCustomFontFileMgr::CCustomFontFileMgr()
 {}
+
 CCustomFontFileMgr::~CCustomFontFileMgr()
-{}
+{
+	if ( !m_FileList.empty() )
+	{
+		DEBUG_PRINT ( 1, ("Error: Custom font files were not properly freed") );
+	}
+
+	while(!m_FileList.empty())
+	{
+		UnregisterCustomFontFile(*(m_FileList.begin()));
+	}
+}
 
 CCustomFontFileMgr& CCustomFontFileMgr::GetSingleton(){
     static CCustomFontFileMgr fontMgr{};
     return fontMgr;
 }
 
-CCustomFontFile* CCustomFontFileMgr::RegisterCustomFontFile(const char *)
+CCustomFontFile* CCustomFontFileMgr::RegisterCustomFontFile(const char* pszRelResource)
 {
-    return nullptr;
+	if(!pszRelResource || !pszRelResource[0])
+		return NULL;
+
+	CCustomFontFile* pNewFile;
+	LT_MEM_TRACK_ALLOC(pNewFile = new CCustomFontFile, LT_MEM_TYPE_UI);
+	if(!pNewFile)
+		return NULL;
+
+	LTStrCpy(pNewFile->m_pszFilename, pszRelResource, LTARRAYSIZE(pNewFile->m_pszFilename));
+
+	m_FileList.push_back(pNewFile);
+	return pNewFile;
 }
 
-bool CCustomFontFileMgr::UnregisterCustomFontFile(CCustomFontFile *)
+bool CCustomFontFileMgr::UnregisterCustomFontFile(CCustomFontFile* pFontFile)
 {
-    return true;
-}
\ No newline at end of file
+	if(!pFontFile)
+		return false;
+
+	TCustomFontFileList::iterator itFile = std::find(m_FileList.begin(), m_FileList.end(), pFontFile);
+	if(itFile == m_FileList.end())
+	{
+		DEBUG_PRINT(1, ( "Error: Attempted to remove a custom font file that wasn't in the list. Most likely releasing the same resource twice."));
+		return false;
+	}
+
+	m_FileList.erase(itFile);
+
+	delete pFontFile;
+	return true;
+}
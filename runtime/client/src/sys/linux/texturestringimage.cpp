@@ -1,38 +1,415 @@
 #include "bdefs.h"
 #include "texturestringimage.h"
+#include "glyphatlas.h"
+#include "customfontfilemgr.h"
+#include "client_filemgr.h"
+#include "stb_truetype.h"
 
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+//----------------------------------------------------------------------------------------
+// Defines
+//----------------------------------------------------------------------------------------
+
+//the category that all allocations should go into
+#define MEMORY_CATEGORY			LT_MEM_TYPE_TEXTURE
+
+//an object bank for the texture string images
+static ObjectBank<CTextureStringImage> g_TexStringImageBank(64, 64);
+
+
+
+//----------------------------------------------------------------------------------------
+// Interfaces
+//----------------------------------------------------------------------------------------
+
+// get the ILTTexInterface from the interface database
+static ILTTexInterface *g_pILTTextureMgr = NULL;
+define_holder(ILTTexInterface, g_pILTTextureMgr);
+
+//IClientFileMgr
+static IClientFileMgr *client_file_mgr;
+define_holder(IClientFileMgr, client_file_mgr);
+
+
+
+//----------------------------------------------------------------------------------------
+// Rasterizer
+//----------------------------------------------------------------------------------------
+
+//rasterizes the glyphs with stb_truetype, out of the font files registered with the custom
+//font file manager. The typeface is matched against the names in the font files, and the
+//first registered font is used if none of them have it
+class CTTFGlyphRasterizer :
+	public CGlyphRasterizer
+{
+public:
+
+	virtual bool GetRowHeight(const CFontInfo& Font, uint32& nRowHeight)
+	{
+		if(!FindFace(Font))
+			return false;
+
+		nRowHeight = Font.m_nHeight;
+		return true;
+	}
+
+	virtual bool RasterizeGlyph(const CFontInfo& Font, texture_string_type_t cGlyph, CGlyphBitmap& Bitmap)
+	{
+		const stbtt_fontinfo* pFace = FindFace(Font);
+		if(!pFace)
+			return false;
+
+		int nCodepoint = (int)(uint8)cGlyph;
+		float fScale = stbtt_ScaleForPixelHeight(pFace, (float)Font.m_nHeight);
+
+		int nAscent, nDescent, nLineGap;
+		stbtt_GetFontVMetrics(pFace, &nAscent, &nDescent, &nLineGap);
+
+		int nAdvance, nLeftBearing;
+		stbtt_GetCodepointHMetrics(pFace, nCodepoint, &nAdvance, &nLeftBearing);
+
+		int nX0, nY0, nX1, nY1;
+		stbtt_GetCodepointBitmapBox(pFace, nCodepoint, fScale, fScale, &nX0, &nY0, &nX1, &nY1);
+
+		//the box is relative to the baseline, and the glyph cell starts at the top of the ascent
+		int nBaseline = (int)(nAscent * fScale + 0.5f);
+
+		Bitmap.m_nTotalWidth		= (uint32)(nAdvance * fScale + 0.5f);
+		Bitmap.m_rBlackBox.Left()	= nX0;
+		Bitmap.m_rBlackBox.Top()	= nBaseline + nY0;
+		Bitmap.m_rBlackBox.Right()	= nX1;
+		Bitmap.m_rBlackBox.Bottom()	= nBaseline + nY1;
+
+		int nWidth = nX1 - nX0;
+		int nHeight = nY1 - nY0;
+		Bitmap.m_Coverage.assign(LTMAX(nWidth, 0) * LTMAX(nHeight, 0), 0);
+		if(nWidth > 0 && nHeight > 0)
+			stbtt_MakeCodepointBitmap(pFace, &Bitmap.m_Coverage[0], nWidth, nHeight, nWidth, fScale, fScale, nCodepoint);
+
+		return true;
+	}
+
+private:
+
+	//finds the loaded face to use for the font
+	const stbtt_fontinfo* FindFace(const CFontInfo& Font)
+	{
+		int nStyle = STBTT_MACSTYLE_NONE;
+		if(Font.IsStyleSet(CFontInfo::kStyle_Bold))
+			nStyle = STBTT_MACSTYLE_BOLD;
+		if(Font.IsStyleSet(CFontInfo::kStyle_Italic))
+			nStyle = (nStyle == STBTT_MACSTYLE_NONE) ? STBTT_MACSTYLE_ITALIC : (nStyle | STBTT_MACSTYLE_ITALIC);
+
+		char szStyle[16];
+		LTSNPrintF(szStyle, LTARRAYSIZE(szStyle), "|%d", nStyle);
+		std::string sKey = std::string(Font.m_szTypeface) + szStyle;
+
+		TFaceMap::iterator itFace = m_Faces.find(sKey);
+		if(itFace != m_Faces.end())
+			return itFace->second.m_bValid ? &itFace->second.m_Info : NULL;
+
+		SFace& Face = m_Faces[sKey];
+		Face.m_bValid = false;
+
+		//look for the typeface with the style first, then just the typeface, and then settle for anything
+		const CCustomFontFileMgr& FontFileMgr = CCustomFontFileMgr::GetSingleton();
+		const int anStyles[] = { nStyle, STBTT_MACSTYLE_DONTCARE };
+
+		for(uint32 nCurrStyle = 0; (nCurrStyle < LTARRAYSIZE(anStyles)) && !Face.m_bValid; nCurrStyle++)
+		{
+			for(uint32 nCurrFile = 0; nCurrFile < FontFileMgr.GetNumFontFiles(); nCurrFile++)
+			{
+				const std::vector<uint8>* pData = LoadFontFile(FontFileMgr.GetFontFile(nCurrFile)->GetFilename());
+				if(!pData)
+					continue;
+
+				int nOffset = stbtt_FindMatchingFont(&(*pData)[0], Font.m_szTypeface, anStyles[nCurrStyle]);
+				if((nOffset >= 0) && stbtt_InitFont(&Face.m_Info, &(*pData)[0], nOffset))
+				{
+					Face.m_bValid = true;
+					break;
+				}
+			}
+		}
+
+		for(uint32 nCurrFile = 0; (nCurrFile < FontFileMgr.GetNumFontFiles()) && !Face.m_bValid; nCurrFile++)
+		{
+			const std::vector<uint8>* pData = LoadFontFile(FontFileMgr.GetFontFile(nCurrFile)->GetFilename());
+			if(pData && stbtt_InitFont(&Face.m_Info, &(*pData)[0], stbtt_GetFontOffsetForIndex(&(*pData)[0], 0)))
+			{
+				DEBUG_PRINT(1, ("CTextureStringImage: Font %s not found, using %s", Font.m_szTypeface, FontFileMgr.GetFontFile(nCurrFile)->GetFilename()));
+				Face.m_bValid = true;
+			}
+		}
+
+		return Face.m_bValid ? &Face.m_Info : NULL;
+	}
+
+	//loads up a font file, keeping it around since the faces point into it
+	const std::vector<uint8>* LoadFontFile(const char* pszFilename)
+	{
+		TFileMap::iterator itFile = m_Files.find(pszFilename);
+		if(itFile != m_Files.end())
+			return itFile->second.empty() ? NULL : &itFile->second;
+
+		std::vector<uint8>& Data = m_Files[pszFilename];
+
+		FileRef ref;
+		ref.m_FileType = FILE_ANYFILE;
+		ref.m_pFilename = pszFilename;
+
+		ILTStream* pStream = client_file_mgr->OpenFile(&ref);
+		if(!pStream)
+		{
+			DEBUG_PRINT(1, ("CTextureStringImage: Unable to open font file %s", pszFilename));
+			return NULL;
+		}
+
+		Data.resize(pStream->GetLen());
+		if(!Data.empty())
+			pStream->Read(&Data[0], Data.size());
+		pStream->Release();
+
+		return Data.empty() ? NULL : &Data;
+	}
+
+	struct SFace
+	{
+		stbtt_fontinfo	m_Info;
+		bool			m_bValid;
+	};
+
+	//the faces by typeface and style, and the font file data by filename
+	typedef std::map<std::string, SFace>				TFaceMap;
+	typedef std::map<std::string, std::vector<uint8> >	TFileMap;
+
+	TFaceMap	m_Faces;
+	TFileMap	m_Files;
+};
+
+
+
+//----------------------------------------------------------------------------------------
+// Page uploader
+//----------------------------------------------------------------------------------------
+
+//keeps the atlas pages on textures. Only the part of the page that changed is copied into
+//the texture when the renderer lets us at its data, otherwise the whole texture is rebuilt
+class CTexturePageUploader :
+	public CGlyphPageUploader
+{
+public:
+
+	virtual bool UploadPage(CGlyphAtlasPage* pPage, const LTRect2n& rDirty)
+	{
+		if(pPage->m_hTexture)
+		{
+			const uint8* pData;
+			uint32 nWidth, nHeight, nPitch;
+			ETextureType eType;
+
+			if((g_pILTTextureMgr->GetTextureData(pPage->m_hTexture, pData, nWidth, nHeight, nPitch, eType) == LT_OK) &&
+				pData && (eType == TEXTURETYPE_ARGB4444) && (nWidth == pPage->GetSize()) && (nHeight == pPage->GetSize()))
+			{
+				const uint32 nRowBytes = rDirty.GetWidth() * sizeof(uint16);
+				for(int32 y = rDirty.Top(); y < rDirty.Bottom(); y++)
+				{
+					uint8* pDest = const_cast<uint8*>(pData) + y * nPitch + rDirty.Left() * sizeof(uint16);
+					memcpy(pDest, pPage->GetPixels() + y * pPage->GetSize() + rDirty.Left(), nRowBytes);
+				}
+
+				g_pILTTextureMgr->FlushTextureData(pPage->m_hTexture, TEXTURE_DATACHANGED);
+				return true;
+			}
+
+			//the texture can't be updated in place, so start it over
+			ReleasePage(pPage);
+		}
+
+		g_pILTTextureMgr->CreateTextureFromData(
+				pPage->m_hTexture,
+				TEXTURETYPE_ARGB4444,
+				TEXTUREFLAG_PREFER16BIT | TEXTUREFLAG_PREFER4444,
+				(uint8*)pPage->GetPixels(),
+				pPage->GetSize(),
+				pPage->GetSize());
+
+		if(!pPage->m_hTexture)
+		{
+			DEBUG_PRINT( 1, ("CTexturePageUploader:  Couldn't create texture." ));
+			return false;
+		}
+
+		return true;
+	}
+
+	virtual void ReleasePage(CGlyphAtlasPage* pPage)
+	{
+		if(pPage->m_hTexture)
+		{
+			g_pILTTextureMgr->ReleaseTextureHandle(pPage->m_hTexture);
+			pPage->m_hTexture = NULL;
+		}
+	}
+};
+
+//gets the shared atlas, setting it up the first time through
+static CGlyphAtlas& GetGlyphAtlas()
+{
+	static CTTFGlyphRasterizer sRasterizer;
+	static CTexturePageUploader sUploader;
+
+	CGlyphAtlas& Atlas = CGlyphAtlas::GetSingleton();
+	if(!Atlas.IsInitialized())
+		Atlas.Init(&sRasterizer, &sUploader);
+
+	return Atlas;
+}
+
+
+
+//----------------------------------------------------------------------------------------
+// CTextureStringImage
+//----------------------------------------------------------------------------------------
 
 CTextureStringImage::CTextureStringImage() :
     ILTRefCount{},
 	m_pGlyphList{nullptr},
+	m_nRowHeight{0},
 	m_nNumGlyphs{0},
-	m_nRowHeight{0}
+	m_hTexture{nullptr},
+	m_pAtlasPage{nullptr}
 {
 }
 
-CTextureStringImage::~CTextureStringImage() 
-{}
-
-const CTextureStringGlyph* CTextureStringImage::GetGlyph(char cGlyph) const
+CTextureStringImage::~CTextureStringImage()
 {
-    return nullptr;
+	FreeData();
 }
 
+//called to allocate a new texture string image object
 CTextureStringImage* CTextureStringImage::Allocate()
 {
-    return nullptr;
+	return g_TexStringImageBank.Allocate();
+}
+
+void CTextureStringImage::Free(CTextureStringImage* pImage)
+{
+	g_TexStringImageBank.Free(pImage);
 }
-void CTextureStringImage::Free(CTextureStringImage* img)
-{}
 
-bool CTextureStringImage::CreateBitmapFont(const char*, const CFontInfo&)
+//called to create a texture given a font and a string. The glyphs come from the shared atlas,
+//so only the ones that no other string has used get rasterized
+bool CTextureStringImage::CreateBitmapFont(const char* pszString, const CFontInfo& Font)
 {
-    return false;
+	//clear up any previous data
+	FreeData();
+
+	//first off create our unique glyph list
+	if(!SetupUniqueGlyphList(pszString))
+		return false;
+
+	//and get them from the atlas
+	m_pAtlasPage = GetGlyphAtlas().AcquireGlyphs(Font, m_pGlyphList, m_nNumGlyphs, m_nRowHeight);
+	if(!m_pAtlasPage)
+	{
+		FreeData();
+		return false;
+	}
+
+	m_FontInfo = Font;
+
+	//success
+	return true;
 }
+
+//frees all data associated with this object
 void CTextureStringImage::FreeData()
-{}
+{
+	//free the glyph list
+	delete [] m_pGlyphList;
+	m_pGlyphList = NULL;
+	m_nNumGlyphs = 0;
 
+	//let go of the atlas page
+	if(m_pAtlasPage)
+	{
+		CGlyphAtlas::GetSingleton().ReleasePage(m_pAtlasPage);
+		m_pAtlasPage = NULL;
+	}
+
+	//clear out any data
+	m_nRowHeight = 0;
+}
+
+//provides access to the texture. Glyphs that were added to the page since it was last
+//drawn are uploaded first
+HTEXTURE CTextureStringImage::GetTexture() const
+{
+	if(!m_pAtlasPage)
+		return NULL;
+
+	CGlyphAtlas::GetSingleton().FlushPage(m_pAtlasPage);
+	return m_pAtlasPage->m_hTexture;
+}
+
+//accesses a glyph in the list
+const CTextureStringGlyph* CTextureStringImage::GetGlyphByIndex(uint32 nGlyph) const
+{
+	if(nGlyph < m_nNumGlyphs)
+		return &m_pGlyphList[nGlyph];
+
+	return NULL;
+}
+
+const CTextureStringGlyph* CTextureStringImage::GetGlyph(char cGlyph) const
+{
+	//the glyph list is sorted, so this can be a binary search
+	const CTextureStringGlyph* pBegin = m_pGlyphList;
+	const CTextureStringGlyph* pEnd = m_pGlyphList + m_nNumGlyphs;
+	const CTextureStringGlyph* pFound = std::lower_bound(pBegin, pEnd, cGlyph,
+		[](const CTextureStringGlyph& Glyph, char cFind) { return Glyph.m_cGlyph < cFind; });
+
+	if((pFound != pEnd) && (pFound->m_cGlyph == cGlyph))
+		return pFound;
+
+	return NULL;
+}
+
+//------------------------------------------
+// Creation utilities
+//------------------------------------------
+
+//called during the creation to extract all the unique glyphs from a string, allocate the
+//glyph list, and set them up with the characters they reference
 bool CTextureStringImage::SetupUniqueGlyphList(const char* pszString)
 {
-    return false;
+	//sort the characters so the duplicates end up next to each other
+	std::string sUnique(pszString ? pszString : "");
+	std::sort(sUnique.begin(), sUnique.end());
+	sUnique.erase(std::unique(sUnique.begin(), sUnique.end()), sUnique.end());
+
+	uint32 nNumGlyphs = (uint32)sUnique.size();
+
+	//now allocate our glyph list
+	LT_MEM_TRACK_ALLOC(m_pGlyphList = new CTextureStringGlyph[nNumGlyphs], MEMORY_CATEGORY);
+
+	//check the allocation
+	if(!m_pGlyphList)
+		return false;
+
+	//now copy over the data
+	m_nNumGlyphs = nNumGlyphs;
+
+	for(uint32 nCurrGlyph = 0; nCurrGlyph < nNumGlyphs; nCurrGlyph++)
+	{
+		m_pGlyphList[nCurrGlyph].m_cGlyph = sUnique[nCurrGlyph];
+	}
+
+	//and success
+	return true;
 }
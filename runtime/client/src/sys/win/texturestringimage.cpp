@@ -580,7 +580,8 @@ static bool CreateGlyphTexture(CTextureStringGlyph* pGlyphs, uint32 nNumGlyphs,
 CTextureStringImage::CTextureStringImage() :
 	m_pGlyphList(NULL),
 	m_nNumGlyphs(0),
-	m_nRowHeight(0)
+	m_nRowHeight(0),
+	m_pAtlasPage(NULL)
 {
 }
 
@@ -667,6 +668,12 @@ void CTextureStringImage::FreeData()
 	m_nRowHeight = 0;
 }
 
+//provides access to the texture
+HTEXTURE CTextureStringImage::GetTexture() const
+{
+	return m_hTexture;
+}
+
 //accesses a glyph in the list
 const CTextureStringGlyph* CTextureStringImage::GetGlyphByIndex(uint32 nGlyph) const
 {
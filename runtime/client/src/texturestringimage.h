@@ -23,6 +23,8 @@
 #	include "ilttexturestring.h"
 #endif
 
+class CGlyphAtlasPage;
+
 //class that represents an actual glyph. A glyph has an associated character
 //and also a rectangle into the texture
 class CTextureStringGlyph
@@ -82,7 +84,7 @@ public:
 	const CFontInfo&			GetFont() const					{ return m_FontInfo; }
 
 	//provides access to the texture
-	HTEXTURE						GetTexture() const				{ return m_hTexture; }
+	HTEXTURE					GetTexture() const;
 
 private:
 
@@ -111,6 +113,10 @@ private:
 
 	//handle to the texture that holds the actual image data
 	HTEXTURE					m_hTexture;
+
+	//the page of the shared glyph atlas that holds the glyphs, on platforms that use it
+	//instead of a texture of their own
+	CGlyphAtlasPage*			m_pAtlasPage;
 };
 
 typedef CLTReference<CTextureStringImage>	TTextureStringImageRef;
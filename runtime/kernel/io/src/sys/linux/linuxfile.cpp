@@ -26,9 +26,6 @@
 // 4 - display file open and close and read calls
 extern int32 g_CV_ShowFileAccess;
 
-CRezItm* g_pDeFileLastRezItm;
-uint32 g_nDeFileLastRezPos;
-
 // PlayDemo profile info.
 uint32 g_PD_FOpen=0;
 
@@ -118,7 +115,9 @@ public:
 
 	LTRESULT	SeekTo(uint32 offset)
 	{
-		if(m_pRezItm->Seek(offset))
+		// The position lives in the stream rather than the rez item so that several
+		// streams (and threads) can read the same item at once.
+		if(offset <= m_pRezItm->GetSize())
 		{
 			m_SeekOffset = offset;
 			return LT_OK;
@@ -132,22 +131,18 @@ public:
 
 	LTRESULT Read(void *pData, uint32 size)
 	{
-		size_t sizeRead;
+		uint32 sizeRead;
 
 		if(size != 0)
 		{
-			if ((g_pDeFileLastRezItm == m_pRezItm) && (g_nDeFileLastRezPos == m_SeekOffset))
-			{
-				sizeRead = m_pRezItm->Read(pData, size);
-			}
-			else
+			uint32 nItemSize = m_pRezItm->GetSize();
+			sizeRead = (m_SeekOffset < nItemSize) ? LTMIN(size, nItemSize - m_SeekOffset) : 0;
+			if(sizeRead && !m_pRezItm->Get(pData, m_SeekOffset, sizeRead))
 			{
-				sizeRead = m_pRezItm->Read(pData, size, m_SeekOffset);
+				sizeRead = 0;
 			}
-			
-			m_SeekOffset += (uint32)sizeRead;
-			g_pDeFileLastRezItm = m_pRezItm;
-			g_nDeFileLastRezPos = m_SeekOffset;
+
+			m_SeekOffset += sizeRead;
 			if(sizeRead != size)
 			{
 				memset(pData, 0, size);
@@ -237,8 +232,9 @@ public:
 	}
 };
 
-static ObjectBank<UnixFileStream> g_UnixFileStreamBank(8, 8);
-static ObjectBank<RezFileStream> g_RezFileStreamBank(8, 8);
+// Loader and hashing threads open files too.
+static ObjectBank<UnixFileStream, LCriticalSection> g_UnixFileStreamBank(8, 8);
+static ObjectBank<RezFileStream, LCriticalSection> g_RezFileStreamBank(8, 8);
 
 
 void UnixFileStream::Release()
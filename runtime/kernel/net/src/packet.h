@@ -336,7 +336,7 @@ public:
 	}
 
 	// Forget everything that's been written
-	void Reset() { if (m_pData) m_pData->DecRef(); m_pData = 0; }
+	void Reset() { if (m_pData) m_pData->DecRef(); m_pData = 0; m_nBitAccumulator = 0; m_nBitsAccumulated = 0; }
 
 	// How much data have we written?
 	uint32 Size() const { return ((m_pData) ? (m_pData->Size()) : 0) + m_nBitsAccumulated; }
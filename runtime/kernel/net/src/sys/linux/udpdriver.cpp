@@ -1841,6 +1841,182 @@ bool udp_RecvFromSocket(SOCKET theSocket, CPacket_Read *pPacket, sockaddr_in *pS
 }
 
 
+// Number of datagrams moved per recvmmsg/sendmmsg call
+static const uint32 k_nUDPBatchSize = 32;
+
+// Receive buffers for the listen thread, filled in by a single recvmmsg call
+struct CUDPRecvBatch
+{
+	enum { k_nMaxUDPPacketSize = 8192 };
+
+	CUDPRecvBatch()
+	{
+		memset(m_aHeaders, 0, sizeof(m_aHeaders));
+		for (uint32 nCurMsg = 0; nCurMsg < k_nUDPBatchSize; ++nCurMsg)
+		{
+			m_aIOVecs[nCurMsg].iov_base = m_aBuffers[nCurMsg];
+			m_aIOVecs[nCurMsg].iov_len = k_nMaxUDPPacketSize;
+			m_aHeaders[nCurMsg].msg_hdr.msg_iov = &m_aIOVecs[nCurMsg];
+			m_aHeaders[nCurMsg].msg_hdr.msg_iovlen = 1;
+			m_aHeaders[nCurMsg].msg_hdr.msg_name = &m_aSenders[nCurMsg];
+		}
+	}
+
+	// Copies a received datagram into a packet.  Returns false if it should be ignored.
+	bool GetPacket(uint32 nIndex, CPacket_Read *pPacket)
+	{
+		const mmsghdr &cHeader = m_aHeaders[nIndex];
+		if (cHeader.msg_len == 0)
+		{
+			if (g_CV_UDPDebug > 1)
+			{
+				dsi_ConsolePrint("UDP: recvmmsg received a zero-length message");
+			}
+			return false;
+		}
+		if (cHeader.msg_hdr.msg_flags & MSG_TRUNC)
+		{
+			if (g_CV_UDPDebug > 1)
+			{
+				dsi_ConsolePrint("UDP: recvmmsg dropped an oversized message (max packet size %d)", k_nMaxUDPPacketSize);
+			}
+			return false;
+		}
+
+		CPacket_Write cIncomingPacket;
+		cIncomingPacket.WriteDataRaw(m_aBuffers[nIndex], cHeader.msg_len);
+		*pPacket = CPacket_Read(cIncomingPacket);
+		return true;
+	}
+
+	mmsghdr m_aHeaders[k_nUDPBatchSize];
+	iovec m_aIOVecs[k_nUDPBatchSize];
+	sockaddr_in m_aSenders[k_nUDPBatchSize];
+	uint8 m_aBuffers[k_nUDPBatchSize][k_nMaxUDPPacketSize];
+};
+
+// Tries to receive up to k_nUDPBatchSize datagrams without blocking.  Returns the number
+// received.  On failure returns 0 and sets *pResultStatus to the error code.
+static uint32 udp_RecvBatchFromSocket(SOCKET theSocket, CUDPRecvBatch &cBatch, int *pResultStatus)
+{
+	// recvmmsg overwrites these, so they need resetting every call
+	for (uint32 nCurMsg = 0; nCurMsg < k_nUDPBatchSize; ++nCurMsg)
+	{
+		cBatch.m_aHeaders[nCurMsg].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+		cBatch.m_aHeaders[nCurMsg].msg_hdr.msg_flags = 0;
+		cBatch.m_aHeaders[nCurMsg].msg_len = 0;
+	}
+
+	int status = recvmmsg(theSocket, cBatch.m_aHeaders, k_nUDPBatchSize, MSG_DONTWAIT, LTNULL);
+	if (status == SOCKET_ERROR)
+	{
+		*pResultStatus = errno;
+		if ((errno != EWOULDBLOCK) && (g_CV_UDPDebug > 1))
+		{
+			dsi_ConsolePrint("UDP: recvmmsg returned error %d", errno);
+		}
+		return 0;
+	}
+
+	*pResultStatus = status;
+	return (uint32)status;
+}
+
+// Collects outgoing datagrams on the current thread while it's in scope, and sends them
+// with sendmmsg when it fills up or goes out of scope.  CUDPDriver::SendTo routes through
+// the innermost active batch.
+class CUDPSendBatch
+{
+public:
+	CUDPSendBatch() :
+		m_Socket(INVALID_SOCKET),
+		m_nNumPackets(0),
+		m_nBufferUsed(0),
+		m_pPrevBatch(s_pActiveBatch)
+	{
+		memset(m_aHeaders, 0, sizeof(m_aHeaders));
+		s_pActiveBatch = this;
+	}
+	~CUDPSendBatch()
+	{
+		Flush();
+		s_pActiveBatch = m_pPrevBatch;
+	}
+
+	static CUDPSendBatch *GetActive() { return s_pActiveBatch; }
+
+	// Returns false if the datagram can't be batched and has to be sent directly
+	bool Queue(SOCKET theSocket, const uint8 *pData, uint32 nDataLen, const sockaddr_in *pSendTo)
+	{
+		if (nDataLen > k_nBufferSize)
+			return false;
+
+		if ((theSocket != m_Socket) ||
+			(m_nNumPackets == k_nUDPBatchSize) ||
+			((m_nBufferUsed + nDataLen) > k_nBufferSize))
+		{
+			Flush();
+			m_Socket = theSocket;
+		}
+
+		uint8 *pDest = &m_aBuffer[m_nBufferUsed];
+		memcpy(pDest, pData, nDataLen);
+		m_nBufferUsed += nDataLen;
+
+		m_aDests[m_nNumPackets] = *pSendTo;
+		m_aIOVecs[m_nNumPackets].iov_base = pDest;
+		m_aIOVecs[m_nNumPackets].iov_len = nDataLen;
+		msghdr &cHeader = m_aHeaders[m_nNumPackets].msg_hdr;
+		cHeader.msg_name = &m_aDests[m_nNumPackets];
+		cHeader.msg_namelen = sizeof(sockaddr_in);
+		cHeader.msg_iov = &m_aIOVecs[m_nNumPackets];
+		cHeader.msg_iovlen = 1;
+		++m_nNumPackets;
+
+		return true;
+	}
+
+	void Flush()
+	{
+		uint32 nCurPacket = 0;
+		while (nCurPacket < m_nNumPackets)
+		{
+			int status = sendmmsg(m_Socket, &m_aHeaders[nCurPacket], m_nNumPackets - nCurPacket, 0);
+			if (status == SOCKET_ERROR)
+			{
+				// Drop the datagram that failed, the same as a failed sendto
+				if (g_CV_UDPDebug > 1)
+				{
+					dsi_ConsolePrint("UDP: sendmmsg returned error %d", errno);
+				}
+				status = 1;
+			}
+			nCurPacket += (uint32)status;
+		}
+
+		m_nNumPackets = 0;
+		m_nBufferUsed = 0;
+	}
+
+private:
+	enum { k_nBufferSize = k_nUDPBatchSize * 1536 };
+
+	static thread_local CUDPSendBatch *s_pActiveBatch;
+
+	SOCKET m_Socket;
+	uint32 m_nNumPackets;
+	uint32 m_nBufferUsed;
+	CUDPSendBatch *m_pPrevBatch;
+
+	mmsghdr m_aHeaders[k_nUDPBatchSize];
+	iovec m_aIOVecs[k_nUDPBatchSize];
+	sockaddr_in m_aDests[k_nUDPBatchSize];
+	uint8 m_aBuffer[k_nBufferSize];
+};
+
+thread_local CUDPSendBatch *CUDPSendBatch::s_pActiveBatch = LTNULL;
+
+
 // ----------------------------------------------------------------- //
 // CUDPDriver code.
 // ----------------------------------------------------------------- //
@@ -1918,6 +2094,7 @@ void CUDPDriver::Term2(bool bFullShutdown, bool bShutdownSocket )
 	// Close down any connections.
 	m_cCS_Connections.Enter();
 	MDeleteAndRemoveElements(m_Connections);
+	m_ConnAddrMap.clear();
 	m_cCS_Connections.Leave();
 
 	if ( bShutdownSocket )
@@ -1999,6 +2176,11 @@ bool CUDPDriver::SendTo(SOCKET theSocket, const CPacket_Read &cPacket, sockaddr_
 		}
 	}
 
+	// Defer to the thread's send batch if there is one
+	CUDPSendBatch *pBatch = CUDPSendBatch::GetActive();
+	if (pBatch && pBatch->Queue(theSocket, aSendBuffer, nDataLen, pSendTo))
+		return true;
+
 	status = sendto(theSocket, (char*)aSendBuffer, nDataLen,
 		0, (sockaddr*)pSendTo, sizeof(*pSendTo));
 
@@ -2010,20 +2192,28 @@ CUDPConn* CUDPDriver::FindConnByAddr(sockaddr_in *pAddr)
 {
 	CSAccess cConnProtect(&m_cCS_Connections);
 
-	MPOS pos;
-	CUDPConn *pConn;
+	TConnAddrMap::const_iterator iConn = m_ConnAddrMap.find(GetConnAddrKey(*pAddr));
+	if (iConn == m_ConnAddrMap.end())
+		return LTNULL;
 
-	for(pos=m_Connections; pos; )
-	{
-		pConn = m_Connections.GetNext(pos);
-		
-		if(pConn->m_RemoteAddr.sin_port == pAddr->sin_port &&
-			pConn->m_RemoteAddr.sin_addr.s_addr == pAddr->sin_addr.s_addr)
-		{
-			return pConn;
-		}
-	}
-	return LTNULL;
+	return iConn->second;
+}
+
+void CUDPDriver::AddConnection(CUDPConn *pConn)
+{
+	m_Connections.AddHead(pConn, &pConn->m_Node);
+	LT_MEM_TRACK_ALLOC(m_ConnAddrMap[GetConnAddrKey(pConn->m_RemoteAddr)] = pConn, LT_MEM_TYPE_NETWORKING);
+}
+
+void CUDPDriver::RemoveConnection(CUDPConn *pConn)
+{
+	m_Connections.RemoveAt(&pConn->m_Node);
+
+	// Only drop the index entry if it's still ours; a reconnect from the same
+	// address may have replaced it.
+	TConnAddrMap::iterator iConn = m_ConnAddrMap.find(GetConnAddrKey(pConn->m_RemoteAddr));
+	if ((iConn != m_ConnAddrMap.end()) && (iConn->second == pConn))
+		m_ConnAddrMap.erase(iConn);
 }
 
 LTRESULT CUDPDriver::GetServiceList(NetService* &pListHead)
@@ -2501,6 +2691,9 @@ void CUDPDriver::Update()
 {
 	CSAccess cConnProtect(&m_cCS_Connections);
 
+	// Send everything the connections flush this frame in as few calls as possible
+	CUDPSendBatch cSendBatch;
+
 	FlushInternalQueues();
 
 	// Update the connections
@@ -2539,7 +2732,7 @@ void CUDPDriver::Disconnect(CBaseConn *id, EDisconnectReason reason, bool bSendM
 	if (bSendMessage)
 		pConn->SendDisconnectMessage( reason );
 
-	m_Connections.RemoveAt(&pConn->m_Node);
+	RemoveConnection(pConn);
 	delete pConn;
 }
 
@@ -2716,7 +2909,7 @@ void CUDPDriver::HandleUnconnectedData(CPacket_Read &cPacket, sockaddr_in *pSend
 				
 				// Add them to our connection list
 				m_cCS_Connections.Enter();
-				m_Connections.AddHead(pConn, &pConn->m_Node);
+				AddConnection(pConn);
 				m_cCS_Connections.Leave();
 
 				// Add it to the connection queue
@@ -3096,7 +3289,7 @@ bool CUDPDriver::GetLocalIpAddress(char* sBuffer, uint32 dwBufferSize, uint16 &h
 		
 		if(m_pNetMgr->NewConnectionNotify(pConn))
 		{
-			m_Connections.AddHead(pConn, &pConn->m_Node);
+			AddConnection(pConn);
 			m_Socket = theSocket;
 			StartThread_Listen();
 
@@ -3286,7 +3479,7 @@ LTRESULT CUDPDriver::ReallyJoinSession( bool bOpenNewSocket, sockaddr_in *addr )
 		
 		if(m_pNetMgr->NewConnectionNotify(pConn))
 		{
-			m_Connections.AddHead(pConn, &pConn->m_Node);
+			AddConnection(pConn);
 
 			if(g_CV_UDPDebug)
 			{
@@ -3751,17 +3944,20 @@ uint32 CUDPDriver::Thread_Listen()
 	cTimeout.tv_sec = k_nListenThread_Timeout / 1000;
 	cTimeout.tv_usec = (k_nListenThread_Timeout % 1000) * 1000;
 
+	// Receive buffers for batched reads (too big for the stack)
+	CUDPRecvBatch *pRecvBatch;
+	LT_MEM_TRACK_ALLOC(pRecvBatch = new CUDPRecvBatch, LT_MEM_TYPE_NETWORKING);
+
 	// Ok, we're starting now...
 	m_cEvent_Thread_Listen_Ready.Set();
 
 	// Semi-infinite loop...
 	while (1)
 	{
-		// Read a packet
-		CPacket_Read cIncomingPacket;
-		sockaddr_in senderAddr;
+		// Read as many packets as are waiting, up to a batch
 		int nRecvStatus;
-		if (!udp_RecvFromSocket(m_Socket, &cIncomingPacket, &senderAddr, &nRecvStatus))
+		uint32 nNumReceived = udp_RecvBatchFromSocket(m_Socket, *pRecvBatch, &nRecvStatus);
+		if (!nNumReceived)
 		{
 			// Jump out if the socket's being shut down
 			if (m_hEvent_Thread_Listen_Shutdown.IsSet())
@@ -3887,52 +4083,65 @@ uint32 CUDPDriver::Thread_Listen()
 			continue;
 		}
 
-		if (cIncomingPacket.Peekuint32() == UNCONNECTED_DATA_TOKEN)
+		// Responses to the whole batch go out together
+		CUDPSendBatch cSendBatch;
+
+		for (uint32 nCurPacket = 0; nCurPacket < nNumReceived; ++nCurPacket)
 		{
-			// Parse the unconnected data packet
-			HandleUnconnectedData(cIncomingPacket, &senderAddr);
+			CPacket_Read cIncomingPacket;
+			if (pRecvBatch->GetPacket(nCurPacket, &cIncomingPacket))
+				HandleIncomingData(cIncomingPacket, &pRecvBatch->m_aSenders[nCurPacket]);
 		}
-		else 
-		{
-			CSAccess cConnProtect(&m_cCS_Connections);
+	}
 
-			// Look up the sender
-			CUDPConn *pConn = FindConnByAddr(&senderAddr);
+	delete pRecvBatch;
 
-			if (pConn)
+	return nResult;
+}
+
+void CUDPDriver::HandleIncomingData(CPacket_Read &cIncomingPacket, sockaddr_in *pSender)
+{
+	if (cIncomingPacket.Peekuint32() == UNCONNECTED_DATA_TOKEN)
+	{
+		// Parse the unconnected data packet
+		HandleUnconnectedData(cIncomingPacket, pSender);
+	}
+	else 
+	{
+		CSAccess cConnProtect(&m_cCS_Connections);
+
+		// Look up the sender
+		CUDPConn *pConn = FindConnByAddr(pSender);
+
+		if (pConn)
+		{
+			// Handle the packet
+			CUDPConn::EIncomingPacketResult eResult;
+			eResult = pConn->HandleIncomingPacket(cIncomingPacket);
+			if (eResult == CUDPConn::eIPR_Disconnect)
 			{
-				// Handle the packet
-				CUDPConn::EIncomingPacketResult eResult;
-				eResult = pConn->HandleIncomingPacket(cIncomingPacket);
-				if (eResult == CUDPConn::eIPR_Disconnect)
-				{
-					// Handle a disconnection the next time we update
-					CDisconnectRequest cRequest;
-					cRequest.m_pConnection = pConn;
-					cRequest.m_eReason = pConn->GetLastDisconnectReason( );
+				// Handle a disconnection the next time we update
+				CDisconnectRequest cRequest;
+				cRequest.m_pConnection = pConn;
+				cRequest.m_eReason = pConn->GetLastDisconnectReason( );
 
-					CSAccess cDisconnectProtect(&m_cCS_DisconnectQueue);
-					LT_MEM_TRACK_ALLOC(m_cDisconnectQueue.push_back(cRequest), LT_MEM_TYPE_NETWORKING);
-				}
-				else
-				{
-					// Give them an update, just to keep things running as smoothly as possible
-					pConn->Update(false);
-				}
+				CSAccess cDisconnectProtect(&m_cCS_DisconnectQueue);
+				LT_MEM_TRACK_ALLOC(m_cDisconnectQueue.push_back(cRequest), LT_MEM_TYPE_NETWORKING);
 			}
 			else
 			{
-				CUnknownMessage cMsg;
-				cMsg.m_cPacket = cIncomingPacket;
-				cMsg.m_cSender = senderAddr;
-				// Handle an unknown message the next time we update
-				CSAccess cUnknownMessageProtect(&m_cCS_UnknownMessages);
-				LT_MEM_TRACK_ALLOC(m_cUnknownMessages.push_back(cMsg), LT_MEM_TYPE_NETWORKING);
+				// Give them an update, just to keep things running as smoothly as possible
+				pConn->Update(false);
 			}
 		}
+		else
+		{
+			CUnknownMessage cMsg;
+			cMsg.m_cPacket = cIncomingPacket;
+			cMsg.m_cSender = *pSender;
+			// Handle an unknown message the next time we update
+			CSAccess cUnknownMessageProtect(&m_cCS_UnknownMessages);
+			LT_MEM_TRACK_ALLOC(m_cUnknownMessages.push_back(cMsg), LT_MEM_TYPE_NETWORKING);
+		}
 	}
-
-	return nResult;
 }
-
-
@@ -1918,6 +1918,7 @@ void CUDPDriver::Term2(bool bFullShutdown, bool bShutdownSocket )
 	// Close down any connections.
 	m_cCS_Connections.Enter();
 	MDeleteAndRemoveElements(m_Connections);
+	m_ConnAddrMap.clear();
 	m_cCS_Connections.Leave();
 
 	if ( bShutdownSocket )
@@ -2010,20 +2011,28 @@ CUDPConn* CUDPDriver::FindConnByAddr(sockaddr_in *pAddr)
 {
 	CSAccess cConnProtect(&m_cCS_Connections);
 
-	MPOS pos;
-	CUDPConn *pConn;
+	TConnAddrMap::const_iterator iConn = m_ConnAddrMap.find(GetConnAddrKey(*pAddr));
+	if (iConn == m_ConnAddrMap.end())
+		return LTNULL;
 
-	for(pos=m_Connections; pos; )
-	{
-		pConn = m_Connections.GetNext(pos);
-		
-		if(pConn->m_RemoteAddr.sin_port == pAddr->sin_port &&
-			pConn->m_RemoteAddr.sin_addr.s_addr == pAddr->sin_addr.s_addr)
-		{
-			return pConn;
-		}
-	}
-	return LTNULL;
+	return iConn->second;
+}
+
+void CUDPDriver::AddConnection(CUDPConn *pConn)
+{
+	m_Connections.AddHead(pConn, &pConn->m_Node);
+	LT_MEM_TRACK_ALLOC(m_ConnAddrMap[GetConnAddrKey(pConn->m_RemoteAddr)] = pConn, LT_MEM_TYPE_NETWORKING);
+}
+
+void CUDPDriver::RemoveConnection(CUDPConn *pConn)
+{
+	m_Connections.RemoveAt(&pConn->m_Node);
+
+	// Only drop the index entry if it's still ours; a reconnect from the same
+	// address may have replaced it.
+	TConnAddrMap::iterator iConn = m_ConnAddrMap.find(GetConnAddrKey(pConn->m_RemoteAddr));
+	if ((iConn != m_ConnAddrMap.end()) && (iConn->second == pConn))
+		m_ConnAddrMap.erase(iConn);
 }
 
 LTRESULT CUDPDriver::GetServiceList(NetService* &pListHead)
@@ -2539,7 +2548,7 @@ void CUDPDriver::Disconnect(CBaseConn *id, EDisconnectReason reason, bool bSendM
 	if (bSendMessage)
 		pConn->SendDisconnectMessage( reason );
 
-	m_Connections.RemoveAt(&pConn->m_Node);
+	RemoveConnection(pConn);
 	delete pConn;
 }
 
@@ -2716,7 +2725,7 @@ void CUDPDriver::HandleUnconnectedData(CPacket_Read &cPacket, sockaddr_in *pSend
 				
 				// Add them to our connection list
 				m_cCS_Connections.Enter();
-				m_Connections.AddHead(pConn, &pConn->m_Node);
+				AddConnection(pConn);
 				m_cCS_Connections.Leave();
 
 				// Add it to the connection queue
@@ -3096,7 +3105,7 @@ bool CUDPDriver::GetLocalIpAddress(char* sBuffer, uint32 dwBufferSize, uint16 &h
 		
 		if(m_pNetMgr->NewConnectionNotify(pConn))
 		{
-			m_Connections.AddHead(pConn, &pConn->m_Node);
+			AddConnection(pConn);
 			m_Socket = theSocket;
 			StartThread_Listen();
 
@@ -3286,7 +3295,7 @@ LTRESULT CUDPDriver::ReallyJoinSession( bool bOpenNewSocket, sockaddr_in *addr )
 		
 		if(m_pNetMgr->NewConnectionNotify(pConn))
 		{
-			m_Connections.AddHead(pConn, &pConn->m_Node);
+			AddConnection(pConn);
 
 			if(g_CV_UDPDebug)
 			{
@@ -25,6 +25,7 @@
 #include "staticfifo.h"
 #include <deque>
 #include <map>
+#include <unordered_map>
 
 #define MAX_UDP_QUERY_TIMES 32
 #define BROADCAST_QUERYNUM  0xFF
@@ -529,6 +530,11 @@ public:
     static bool SendTo(SOCKET theSocket, const CPacket_Read &cPacket, sockaddr_in *pSendTo);
     CUDPConn *FindConnByAddr(sockaddr_in *pAddr);
 
+	// Adds/removes a connection from m_Connections and the address index.
+	// The caller must hold m_cCS_Connections.
+	void AddConnection(CUDPConn *pConn);
+	void RemoveConnection(CUDPConn *pConn);
+
 
     virtual LTRESULT GetServiceList(NetService* &pListHead);
     virtual LTRESULT SelectService(BaseService *pService) {return LT_OK;}
@@ -614,6 +620,10 @@ protected:
 	enum { CONN_SEND_INTERVAL =300, CONN_WAIT_TIME =10000 };
 
 	void HandleUnconnectedData(CPacket_Read &cPacket, sockaddr_in *pSender);
+#ifdef __LINUX
+	// Dispatches one datagram received by the listen thread
+	void HandleIncomingData(CPacket_Read &cPacket, sockaddr_in *pSender);
+#endif
 
 	enum {
 		k_nReconnection_Delay = 10000, // Re-connection lockout delay, in ms
@@ -746,6 +756,15 @@ public:
 	LCriticalSection m_cCS_Connections;
     CMultiLinkList<CUDPConn*> m_Connections;
 
+	// Index of m_Connections keyed on the remote address and port, so incoming
+	// datagrams don't have to walk the whole connection list.
+	static uint64 GetConnAddrKey(const sockaddr_in &cAddr)
+	{
+		return ((uint64)cAddr.sin_addr.s_addr << 16) | (uint64)cAddr.sin_port;
+	}
+	typedef std::unordered_map<uint64, CUDPConn*> TConnAddrMap;
+	TConnAddrMap m_ConnAddrMap;
+
     bool m_bWSAInitted;
     BaseService m_DummyService;
 };
@@ -1,67 +1,57 @@
 #include "counter.h"
-#define LOCK_AT_MICROSECONDS
-static uint64 g_CountDiv = 1;
 
-class CountDivSetter
+#include <string.h>
+#include <time.h>
+
+
+// Counters tick in microseconds from the monotonic clock.  The start time is
+// kept in the counters' data arrays, which are at least 64 bits.
+
+static uint64 cnt_GetTime()
 {
-public:
-	CountDivSetter()
-	{
-		g_CountDiv = 1;
-	}
-};
-static CountDivSetter __g_CountDivSetter;
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64)ts.tv_sec * 1000000 + (uint64)ts.tv_nsec / 1000;
+}
+
+static uint64 cnt_GetData(const unsigned long *pData)
+{
+	uint64 value;
+	memcpy(&value, pData, sizeof(value));
+	return value;
+}
+
+static void cnt_SetData(unsigned long *pData, uint64 value)
+{
+	memcpy(pData, &value, sizeof(value));
+}
 
 
 
 unsigned long cnt_NumTicksPerSecond()
 {
-	/*
-	LARGE_INTEGER perSec;
-
-	QueryPerformanceFrequency(&perSec);
-	return (unsigned long)(perSec.QuadPart / g_CountDiv);
-	*/
-return 0;      // DAN - temporary
+	return 1000000;
 }
 
 
 
 CounterFinal::CounterFinal(unsigned long startMode)
 {
-/*
 	if(startMode == CSTART_MICRO)
 		StartMicro();
 	else if(startMode == CSTART_MILLI)
 		StartMS();
-*/
 }
 
 
 void CounterFinal::StartMS()
 {
-	/*
-	LARGE_INTEGER *pInt;
-
-	pInt = (LARGE_INTEGER*)m_Data;
-	QueryPerformanceCounter(pInt);
-	*/
+	cnt_SetData(m_Data, cnt_GetTime());
 }
 
 unsigned long CounterFinal::EndMS()
 {
-	/*
-	LARGE_INTEGER curCount, *pInCount, perSec;
-	LONGLONG timeElapsed;
-
-	pInCount = (LARGE_INTEGER*)m_Data;
-	QueryPerformanceCounter(&curCount);
-
-	QueryPerformanceFrequency(&perSec);
-	timeElapsed = curCount.QuadPart - pInCount->QuadPart;
-	return (unsigned long)((timeElapsed*(LONGLONG)1000) / perSec.QuadPart);
-	*/
-return 0;      // DAN - temporary
+	return (unsigned long)((cnt_GetTime() - cnt_GetData(m_Data)) / 1000);
 }
 
 unsigned long CounterFinal::CountMS()
@@ -73,25 +63,12 @@ unsigned long CounterFinal::CountMS()
 
 void CounterFinal::StartMicro()
 {
-	/*
-	LARGE_INTEGER *pInt;
-
-	pInt = (LARGE_INTEGER*)m_Data;
-	QueryPerformanceCounter(pInt);
-	*/
+	cnt_SetData(m_Data, cnt_GetTime());
 }
 
 unsigned long CounterFinal::EndMicro()
 {
-	/*
-	LARGE_INTEGER curCount, *pInCount;
-
-	pInCount = (LARGE_INTEGER*)m_Data;
-	QueryPerformanceCounter(&curCount);
-
-	return (unsigned long)((curCount.QuadPart - pInCount->QuadPart) / g_CountDiv);
-	*/
-return 0;      // DAN - temporary
+	return (unsigned long)(cnt_GetTime() - cnt_GetData(m_Data));
 }
 
 unsigned long CounterFinal::CountMicro()
@@ -123,6 +100,20 @@ unsigned long cnt_EndCounterFinal(CounterFinal &pCounter)
 	return pCounter.EndMicro();
 }
 
+float CountPercent::CalcPercent()
+{
+	uint64 totalOut = cnt_GetData(m_TotalOut);
+
+	// Handle the never-got-called case
+	if (totalOut == 0)
+		return 0.0f;
+
+	uint64 totalIn = cnt_GetData(m_TotalIn);
+	uint64 result = (totalIn * 10000) / (totalIn + totalOut);
+
+	return (float)result / 10000.0f;
+}
+
 // Clears the totals
 void CountPercent::Clear()
 {
@@ -136,15 +127,40 @@ void CountPercent::Clear()
 	m_iIn = 0;
 }
 
+// Call to enter the profiled section
 uint CountPercent::In()
 {
 	if (m_iIn++)
 		return 0;
-    return 0;
+
+	uint64 now = cnt_GetTime();
+	uint64 then = cnt_GetData(m_Finger);
+	uint64 result = 0;
+
+	// Keep track of the out time
+	if (then != 0)
+	{
+		result = now - then;
+		cnt_SetData(m_TotalOut, cnt_GetData(m_TotalOut) + result);
+	}
+
+	cnt_SetData(m_Finger, now);
+
+	return (uint)result;
 }
+
+// Call to exit the profiled section
 uint CountPercent::Out()
 {
 	if (--m_iIn)
 		return 0;
-    return 0;
+
+	uint64 now = cnt_GetTime();
+	uint64 result = now - cnt_GetData(m_Finger);
+
+	// Keep track of the in time
+	cnt_SetData(m_TotalIn, cnt_GetData(m_TotalIn) + result);
+	cnt_SetData(m_Finger, now);
+
+	return (uint)result;
 }
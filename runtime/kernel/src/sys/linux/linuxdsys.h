@@ -31,7 +31,10 @@
 
 #include <cstdarg>
 
+// The dedicated server doesn't link against SDL.
+#ifndef DE_SERVER_COMPILE
 #include <SDL.h>
+#endif
 
 // ------------------------------------------------------------------------- //
 // Externs (Public C data)
@@ -137,6 +140,7 @@ LTRESULT dsi_GetVersionInfo(LTVersionInfo &info);
 // ------------------------------------------------------------------------- //
 // Class Definitions
 // ------------------------------------------------------------------------- //
+#ifndef DE_SERVER_COMPILE
 class ClientGlob {
     public:
         ClientGlob () {
@@ -200,4 +204,6 @@ class ClientGlob {
 };
 
 extern ClientGlob g_ClientGlob;
+#endif  // DE_SERVER_COMPILE
+
 #endif  // __DSYS_INTERFACE_H__
@@ -25,6 +25,7 @@ void rdll_RenderDLLSetup(RenderStruct *pStruct);
 extern RenderStruct g_Render;
 extern RMode        g_RMode;                // The current (or last successful) config for the renderer.
 class CClientMgr;
+class ILTStream;
 // Render initialization status codes.
 #define R_OK                    0
 #define R_CANTLOADLIBRARY       1
@@ -60,8 +61,9 @@ bool			r_GetTextureInfo(SharedTexture *pTexture, uint32& nWidth, uint32& nHeight
 
 //this will load the texture and bind it to the device. The texture data of the shared texture
 //will be valid until it is bound to the device, at which point it is possible that it will
-//be freed
-LTRESULT r_LoadSystemTexture(SharedTexture *pSharedTexture);
+//be freed. The texture is read from pStream if it's given (the caller still owns it),
+//otherwise from its file
+LTRESULT r_LoadSystemTexture(SharedTexture *pSharedTexture, ILTStream *pStream = LTNULL);
 
 //frees the associated texture data and cleans up references to it
 void r_UnloadSystemTexture(TextureData *pTexture);
@@ -0,0 +1,150 @@
+// This module implements the dsi_interface functions the dedicated server
+// needs.  It's the headless counterpart of linuxdsys.cpp: nothing here
+// touches SDL, the renderer, input or sound.
+
+#include <cstdarg>
+#include <cstdio>
+#include <iostream>
+#include <time.h>
+
+#include "bdefs.h"
+#include "stdlterror.h"
+#include "stringmgr.h"
+#include "sysfile.h"
+#include "servermgr.h"
+#include "classbind.h"
+#include "bindmgr.h"
+#include "linuxdsys.h"
+#include "server_interface.h"
+
+
+extern CServerMgr *g_pServerMgr;
+
+
+void dsi_OnReturnError(int err)
+{
+}
+
+
+LTRESULT dsi_SetupMessage(char *pMsg, int maxMsgLen, LTRESULT dResult, va_list marker)
+{
+	char msg[1000];
+	vsnprintf(msg, sizeof(msg) - 1, pMsg, marker);
+
+	auto &&o = (dResult == LT_OK) ? std::cout : std::cerr;
+	switch (dResult)
+	{
+		case LT_OK:
+			o << "Info  : ";
+			break;
+		case LT_ERRORCOPYINGFILE:
+			o << "Library not found: ";
+			break;
+		case LT_NOGAMERESOURCES:
+			o << "NoGameResources found ";
+			break;
+		case LT_CANTLOADGAMERESOURCES:
+			o << "GameResourceMissing: ";
+			break;
+		default:
+			o << "Error : ";
+			break;
+	}
+	o << msg << '\n';
+	return LT_OK;
+}
+
+
+int dsi_Init()
+{
+	dm_Init();	// Memory manager.
+	str_Init();	// String manager.
+	df_Init();	// File manager.
+	return 0;
+}
+
+void dsi_Term()
+{
+	df_Term();
+	str_Term();
+	dm_Term();
+}
+
+
+LTRESULT dsi_LoadServerObjects(CClassMgr *pInfo)
+{
+	const char* pGameServerObjectName = "./libObject.lto";
+
+	int version;
+	int status = cb_LoadModule(pGameServerObjectName, false, pInfo->m_ClassModule, &version);
+
+	if (status == CB_CANTFINDMODULE || status == CB_NOTCLASSMODULE)
+	{
+		return LT_INVALIDOBJECTDLL;
+	}
+	else if (status == CB_VERSIONMISMATCH)
+	{
+		return LT_INVALIDOBJECTDLLVERSION;
+	}
+
+	return LT_OK;
+}
+
+
+void dsi_OnMemoryFailure()
+{
+	std::cerr << "Error : out of memory\n";
+}
+
+
+void dsi_Sleep(uint32 ms)
+{
+	timespec req, rem;
+	req.tv_sec = ms / 1000;
+	req.tv_nsec = (long)(ms % 1000) * 1000000L;
+
+	// Keep sleeping if a signal cuts it short.
+	while (nanosleep(&req, &rem) != 0)
+	{
+		req = rem;
+	}
+}
+
+void dsi_ServerSleep(uint32 ms)
+{
+	dsi_Sleep(ms);
+}
+
+
+bool dsi_IsConsoleEnabled()
+{
+	return true;
+}
+
+void dsi_PrintToConsole(const char *pMsg, ...)
+{
+	va_list marker;
+	char msg[1000];
+
+	va_start(marker, pMsg);
+	vsnprintf(msg, sizeof(msg) - 1, pMsg, marker);
+	va_end(marker);
+
+	if (g_pServerMgr && g_pServerMgr->m_pServerAppHandler)
+	{
+		g_pServerMgr->m_pServerAppHandler->ConsoleOutputFn(msg);
+	}
+	else
+	{
+		// Nobody's listening yet (still starting up), so just print it.
+		printf("%s\n", msg);
+	}
+}
+
+
+LTRESULT dsi_GetVersionInfo(LTVersionInfo &info)
+{
+	info.m_MajorVersion = 0;
+	info.m_MinorVersion = 1;
+	return LT_OK;
+}
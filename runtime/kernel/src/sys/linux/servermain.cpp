@@ -0,0 +1,366 @@
+// The headless dedicated server.  This hosts a game with the server
+// interface the same way the Windows ServerApp does, but without a window,
+// renderer, input or sound.  The console is read from stdin.
+//
+// Usage:
+//   LithtechServer [-rez <file>]... [-config <file>] [-port <n>] [-name <name>]
+//                  [-maxplayers <n>] [-world <name>] [-guid <guid>]
+//                  [-workingdir <dir>] [+<var> <value>]...
+
+#include "bdefs.h"
+
+#include "timemgr.h"
+#include "server_interface.h"
+#include "ltmessage_server.h"
+
+#include <unistd.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+//holder for command line argument mgr interface.
+#include "icommandlineargs.h"
+static ICommandLineArgs *command_line_args;
+define_holder(ICommandLineArgs, command_line_args);
+
+
+// Must be the same as SERVERSHELL_INIT in the game's NetDefs.h.
+#define SERVERSHELL_INIT	0
+
+#define DEFAULT_MAX_PLAYERS	16
+
+// The NOLF2 game GUID (see TO2VersionMgr.cpp).  Clients only see servers
+// with their own GUID, so use -guid for other games.
+static LTGUID g_DefaultGameGUID =
+{ 0xbef696d3, 0xe5dc, 0x4db5, { 0xb3, 0xd6, 0x70, 0xaf, 0xbd, 0xd, 0x2a, 0xdd } };
+
+static volatile sig_atomic_t g_bQuit = 0;
+
+
+class CServerConsoleHandler : public ServerAppHandler
+{
+public:
+
+	virtual LTRESULT ConsoleOutputFn(const char *pMsg)
+	{
+		printf("%s\n", pMsg);
+		fflush(stdout);
+		return LT_OK;
+	}
+
+	virtual LTRESULT OutOfMemory()
+	{
+		fprintf(stderr, "Error: Out Of Memory\n");
+		exit(1);
+		return LT_OK;
+	}
+};
+
+static CServerConsoleHandler g_ConsoleHandler;
+
+
+static void OnQuitSignal(int sig)
+{
+	g_bQuit = 1;
+}
+
+
+static bool ParseGUID(const char *pStr, LTGUID &guid)
+{
+	unsigned int a, b, c, d[8];
+
+	if (sscanf(pStr, "{%8x-%4x-%4x-%2x%2x-%2x%2x%2x%2x%2x%2x}",
+		&a, &b, &c, &d[0], &d[1], &d[2], &d[3], &d[4], &d[5], &d[6], &d[7]) != 11)
+	{
+		return false;
+	}
+
+	guid.guid.a = a;
+	guid.guid.b = (uint16)b;
+	guid.guid.c = (uint16)c;
+	for (uint32 i=0; i < 8; i++)
+	{
+		guid.guid.d[i] = (uint8)d[i];
+	}
+
+	return true;
+}
+
+
+// Sets a console variable the same way "+var value" does on the client.
+static void SetConsoleVar(ServerInterface *pServer, const char *pName, const char *pValue)
+{
+	char fullCmd[512];
+	LTSNPrintF(fullCmd, sizeof(fullCmd), "(%s) (%s)", pName, pValue);
+	pServer->RunConsoleString(fullCmd);
+}
+
+
+static void PrintServerError(ServerInterface *pServer, const char *pWhat)
+{
+	char errorStr[512];
+	pServer->GetErrorString(errorStr, sizeof(errorStr));
+	fprintf(stderr, "Error: %s: %s\n", pWhat, errorStr);
+}
+
+
+static bool SelectTcpIpService(ServerInterface *pServer)
+{
+	NetService *pListHead = LTNULL;
+
+	if (!pServer->InitNetworking(LTNULL, 0))
+		return false;
+
+	if (!pServer->GetServiceList(pListHead) || !pListHead)
+		return false;
+
+	HNETSERVICE hNetService = LTNULL;
+	for (NetService *pCur=pListHead; pCur; pCur=pCur->m_pNext)
+	{
+		if (pCur->m_dwFlags & NETSERVICE_TCPIP)
+		{
+			hNetService = pCur->m_handle;
+			break;
+		}
+	}
+
+	pServer->FreeServiceList(pListHead);
+
+	return hNetService && pServer->SelectService(hNetService);
+}
+
+
+static bool StartServer(ServerInterface *pServer)
+{
+	// Resources.  Any -rez arguments replace the default set.
+	std::vector<const char*> resTree{};
+	uint32 nArgs = command_line_args->Argc();
+	for (uint32 i=0; i + 1 < nArgs; i++)
+	{
+		if (strcmp(command_line_args->Argv(i), "-rez") == 0)
+		{
+			resTree.push_back(command_line_args->Argv(i + 1));
+		}
+	}
+
+	if (resTree.empty())
+	{
+		resTree.push_back("engine.rez");
+		resTree.push_back("game.rez");
+		resTree.push_back("game2.rez");
+		resTree.push_back("sound.rez");
+	}
+
+	if (!pServer->AddResources(resTree.data(), resTree.size()))
+	{
+		PrintServerError(pServer, "unable to add resources");
+		return false;
+	}
+
+	// A dedicated server has nothing else to do with its time, so hold it
+	// to ServerFPS.  The config file and command line can override this.
+	SetConsoleVar(pServer, "LockServerFPS", "1");
+
+	const char *pConfigFile = command_line_args->FindArgDash("config");
+	if (pConfigFile && pServer->LoadConfigFile((char*)pConfigFile) != LT_OK)
+	{
+		fprintf(stderr, "Warning: unable to load config file %s\n", pConfigFile);
+	}
+
+	for (uint32 i=0; i + 1 < nArgs; i++)
+	{
+		const char *pArg = command_line_args->Argv(i);
+		if (pArg[0] == '+')
+		{
+			SetConsoleVar(pServer, &pArg[1], command_line_args->Argv(i + 1));
+		}
+	}
+
+	// Networking.
+	if (!SelectTcpIpService(pServer))
+	{
+		fprintf(stderr, "Error: unable to select the TCP/IP service\n");
+		return false;
+	}
+
+	NetHost netHost;
+	memset(&netHost, 0, sizeof(netHost));
+
+	const char *pArg = command_line_args->FindArgDash("port");
+	netHost.m_Port = pArg ? (uint32)atoi(pArg) : 0;
+
+	pArg = command_line_args->FindArgDash("maxplayers");
+	netHost.m_dwMaxConnections = pArg ? (uint32)atoi(pArg) : DEFAULT_MAX_PLAYERS;
+
+	pArg = command_line_args->FindArgDash("name");
+	LTStrCpy(netHost.m_sName, pArg ? pArg : "LithTech Server", sizeof(netHost.m_sName));
+
+	if (!pServer->HostGame(&netHost))
+	{
+		PrintServerError(pServer, "unable to host the game");
+		return false;
+	}
+
+	// The game code.
+	if (!pServer->LoadBinaries())
+	{
+		PrintServerError(pServer, "unable to load the game binaries");
+		return false;
+	}
+
+	// Either run the world we were asked for or let the server shell
+	// start its first mission, like ServerApp does.
+	const char *pWorldName = command_line_args->FindArgDash("world");
+	if (pWorldName)
+	{
+		StartGameRequest request;
+		LTStrCpy(request.m_WorldName, pWorldName, sizeof(request.m_WorldName));
+
+		if (!pServer->StartWorld(&request))
+		{
+			PrintServerError(pServer, "unable to start the world");
+			return false;
+		}
+	}
+	else
+	{
+		CPacket_Write cPacket;
+		cPacket.Writeuint8(SERVERSHELL_INIT);
+
+		CLTMsgRef_Read cMsg = CLTMessage_Read_Server::Allocate_Server(CPacket_Read(cPacket));
+		if (pServer->SendToServerShell(*cMsg) != LT_OK)
+		{
+			PrintServerError(pServer, "unable to initialize the server shell");
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+// Reads whatever's waiting on stdin without blocking and runs each complete
+// line as a console command.  Returns false once stdin is closed.
+static bool ProcessConsoleInput(ServerInterface *pServer, std::string &lineBuffer)
+{
+	pollfd pfd;
+	pfd.fd = STDIN_FILENO;
+	pfd.events = POLLIN;
+	pfd.revents = 0;
+
+	while (poll(&pfd, 1, 0) > 0 && (pfd.revents & (POLLIN | POLLHUP)))
+	{
+		char buffer[256];
+		ssize_t nRead = read(STDIN_FILENO, buffer, sizeof(buffer));
+		if (nRead <= 0)
+			return nRead < 0;
+
+		lineBuffer.append(buffer, nRead);
+
+		std::string::size_type nEnd;
+		while ((nEnd = lineBuffer.find('\n')) != std::string::npos)
+		{
+			std::string line = lineBuffer.substr(0, nEnd);
+			lineBuffer.erase(0, nEnd + 1);
+
+			if (!line.empty() && line.back() == '\r')
+				line.pop_back();
+
+			if (line.empty())
+				continue;
+
+			if (line == "quit" || line == "exit")
+			{
+				g_bQuit = 1;
+				continue;
+			}
+
+			pServer->RunConsoleString(&line[0]);
+		}
+	}
+
+	return true;
+}
+
+
+static int RunServerApp()
+{
+	const char *pArg = command_line_args->FindArgDash("workingdir");
+	// if chdir fails it returns non-zero making the expression true
+	if (pArg && chdir(pArg))
+	{
+		fprintf(stderr, "Error: unable to change to %s\n", pArg);
+		return -1;
+	}
+
+	LTGUID guid = g_DefaultGameGUID;
+	pArg = command_line_args->FindArgDash("guid");
+	if (pArg && !ParseGUID(pArg, guid))
+	{
+		fprintf(stderr, "Error: invalid GUID %s\n", pArg);
+		return -1;
+	}
+
+	uint32 initStartTime = timeGetTime();
+
+	ServerInterface *pServer = LTNULL;
+	SI_CREATESTATUS status = CreateServer(SI_VERSION, guid, &pServer);
+	if (status != SI_OK || !pServer)
+	{
+		fprintf(stderr, "Error: unable to create the server (%u)\n", status);
+		return -1;
+	}
+
+	pServer->SetAppHandler(&g_ConsoleHandler);
+
+	int ret = 0;
+	if (StartServer(pServer))
+	{
+		printf("Server running (started in %.2f seconds).\n",
+			(float)(timeGetTime() - initStartTime) / 1000.0f);
+		fflush(stdout);
+
+		std::string lineBuffer;
+		bool bReadConsole = true;
+
+		while (!g_bQuit)
+		{
+			if (!pServer->Update(0))
+			{
+				PrintServerError(pServer, "server update failed");
+				ret = -1;
+				break;
+			}
+
+			if (bReadConsole)
+			{
+				bReadConsole = ProcessConsoleInput(pServer, lineBuffer);
+			}
+		}
+	}
+	else
+	{
+		ret = -1;
+	}
+
+	pServer->SetAppHandler(LTNULL);
+	DeleteServer();
+
+	return ret;
+}
+
+
+int main(int argc, char *argv[])
+{
+	LTMemInit();
+
+	command_line_args->Init(argc, argv);
+
+	signal(SIGINT, OnQuitSignal);
+	signal(SIGTERM, OnQuitSignal);
+	signal(SIGPIPE, SIG_IGN);
+
+	return RunServerApp();
+}
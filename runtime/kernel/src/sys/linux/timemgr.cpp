@@ -1,6 +1,10 @@
-
 #include "timemgr.h"
+
+#ifdef DE_SERVER_COMPILE
+#include <chrono>
+#else
 #include <SDL.h>
+#endif
 
 float time_GetTime()
 {
@@ -9,5 +13,14 @@ float time_GetTime()
 
 uint32 timeGetTime()
 {
+#ifdef DE_SERVER_COMPILE
+	// The dedicated server has no SDL, so count from the first call
+	// the same way SDL_GetTicks counts from SDL_Init.
+	static const std::chrono::steady_clock::time_point s_Start = std::chrono::steady_clock::now();
+
+	return (uint32)std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::steady_clock::now() - s_Start).count();
+#else
 	return SDL_GetTicks();
+#endif
 }
@@ -74,7 +74,7 @@ void r_UnloadSystemTexture(TextureData *pTexture)
 }
 
 // Loads the texture and installs it.
-LTRESULT r_LoadSystemTexture(SharedTexture *pSharedTexture)
+LTRESULT r_LoadSystemTexture(SharedTexture *pSharedTexture, ILTStream *pStream)
 {
 	LTRESULT dResult;
 	FileRef ref;
@@ -90,20 +90,25 @@ LTRESULT r_LoadSystemTexture(SharedTexture *pSharedTexture)
 	//the texture data that is associated with the texture
 	TextureData* pTextureData = NULL;
 
-	ILTStream *pStream = client_file_mgr->OpenFileIdentifier(pIdent);
-	if (pStream) 
+	// Read it from the file unless we were given the data.
+	ILTStream *pFileStream = LTNULL;
+	if (!pStream)
 	{
-		dResult = dtx_Create(pStream, &pTextureData, nBaseWidth, nBaseHeight);
-		pStream->Release();
-
-		if (dResult != LT_OK) 
-			return dResult; 
-	}
-	else 
-	{
-		RETURN_ERROR_PARAM(1, r_LoadSystemTexture, LT_MISSINGFILE, pIdent->m_Filename); 
+		pFileStream = client_file_mgr->OpenFileIdentifier(pIdent);
+		if (!pFileStream) 
+		{
+			RETURN_ERROR_PARAM(1, r_LoadSystemTexture, LT_MISSINGFILE, pIdent->m_Filename); 
+		}
+		pStream = pFileStream;
 	}
 
+	dResult = dtx_Create(pStream, &pTextureData, nBaseWidth, nBaseHeight);
+	if (pFileStream)
+		pFileStream->Release();
+
+	if (dResult != LT_OK) 
+		return dResult; 
+
 	//make sure to setup the texture information
 	pSharedTexture->SetTextureInfo(nBaseWidth, nBaseHeight, pTextureData->m_PFormat);
 
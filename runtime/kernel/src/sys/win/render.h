@@ -27,6 +27,7 @@ extern RMode        g_RMode;                // The current (or last successful)
 
 
 class CClientMgr;
+class ILTStream;
 
 
 // Render initialization status codes.
@@ -70,8 +71,9 @@ void r_TerminateAllRecreatableTextureData();
 
 //this will load the texture and bind it to the device. The texture data of the shared texture
 //will be valid until it is bound to the device, at which point it is possible that it will
-//be freed
-LTRESULT r_LoadSystemTexture(SharedTexture *pSharedTexture);
+//be freed. The texture is read from pStream if it's given (the caller still owns it),
+//otherwise from its file
+LTRESULT r_LoadSystemTexture(SharedTexture *pSharedTexture, ILTStream *pStream = LTNULL);
 
 //frees the associated texture data and cleans up references to it
 void r_UnloadSystemTexture(TextureData *pTexture);
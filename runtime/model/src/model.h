@@ -197,22 +197,56 @@ private :
 // associated with the animation these channels belong to.
 // All these classes are private, viewable only by animnode.
 // ------------------------------------------------------------------------
+
+// How a channel stores its keys.  This lets the transform maker decode a
+// whole animation's worth of channels without a virtual call per key.
+enum EAnimChannelFormat
+{
+	eAnimChannel_Null,		// No data, the key is the identity.
+	eAnimChannel_Float,		// Full precision floats.
+	eAnimChannel_Int16		// 16 bit fixed point.
+};
+
 class IAnimPosChannel
 {
 public:
+					IAnimPosChannel(EAnimChannelFormat eFormat, bool bSingleKey) :
+						m_eFormat(eFormat), m_bSingleKey(bSingleKey)	{}
 	virtual ~IAnimPosChannel() {}
 
 	virtual uint32 GetDataSize() const = 0;
 	virtual void GetData(const uint8* pData, uint32 index, LTVector& vPos ) const = 0;
+
+	EAnimChannelFormat	GetFormat() const		{ return m_eFormat; }
+
+	// Does every frame use the first key?
+	bool				IsSingleKey() const		{ return m_bSingleKey; }
+
+private:
+
+	EAnimChannelFormat	m_eFormat;
+	bool				m_bSingleKey;
 };
 
 class IAnimQuatChannel
 {
 public:
+					IAnimQuatChannel(EAnimChannelFormat eFormat, bool bSingleKey) :
+						m_eFormat(eFormat), m_bSingleKey(bSingleKey)	{}
 	virtual ~IAnimQuatChannel() {}
 
 	virtual uint32 GetDataSize() const = 0;
 	virtual void GetData(const uint8* pData, uint32 index, LTRotation& rRot ) const = 0;
+
+	EAnimChannelFormat	GetFormat() const		{ return m_eFormat; }
+
+	// Does every frame use the first key?
+	bool				IsSingleKey() const		{ return m_bSingleKey; }
+
+private:
+
+	EAnimChannelFormat	m_eFormat;
+	bool				m_bSingleKey;
 };
 
 
@@ -222,6 +256,8 @@ public:
 class NULLPOSChannel : public IAnimPosChannel
 {
 public:
+	NULLPOSChannel() : IAnimPosChannel(eAnimChannel_Null, true)	{}
+
 
 	static const IAnimPosChannel*	GetSingleton();
 
@@ -236,6 +272,8 @@ public:
 class NULLQUATChannel : public IAnimQuatChannel
 {
 public:
+	NULLQUATChannel() : IAnimQuatChannel(eAnimChannel_Null, true)	{}
+
 
 	static const IAnimQuatChannel*	GetSingleton();
 
@@ -253,6 +291,8 @@ public:
 class POSChannel : public IAnimPosChannel
 {
 public:
+	POSChannel(bool bSingleKey = false) : IAnimPosChannel(eAnimChannel_Float, bSingleKey)	{}
+
 
 	static const IAnimPosChannel*	GetSingleton();
 
@@ -267,6 +307,8 @@ public:
 class SinglePOSChannel : public POSChannel
 {
 public:
+	SinglePOSChannel() : POSChannel(true)	{}
+
 
 	static const IAnimPosChannel*	GetSingleton();
 
@@ -279,6 +321,8 @@ public:
 class QUATChannel : public IAnimQuatChannel
 {
 public:
+	QUATChannel(bool bSingleKey = false) : IAnimQuatChannel(eAnimChannel_Float, bSingleKey)	{}
+
 
 	static const IAnimQuatChannel*	GetSingleton();
 
@@ -293,6 +337,8 @@ public:
 class SingleQUATChannel : public QUATChannel
 {
 public:
+	SingleQUATChannel() : QUATChannel(true)	{}
+
 
 	static const IAnimQuatChannel*	GetSingleton();
 
@@ -308,6 +354,8 @@ public:
 class POS16Channel : public IAnimPosChannel
 {
 public:
+	POS16Channel(bool bSingleKey = false) : IAnimPosChannel(eAnimChannel_Int16, bSingleKey)	{}
+
 
 	static const IAnimPosChannel*	GetSingleton();
 
@@ -328,6 +376,8 @@ public:
 class SinglePOS16Channel : public POS16Channel
 {
 public:
+	SinglePOS16Channel() : POS16Channel(true)	{}
+
 
 	static const IAnimPosChannel*	GetSingleton();
 
@@ -341,6 +391,8 @@ public:
 class QUAT16Channel : public IAnimQuatChannel
 {
 public:
+	QUAT16Channel(bool bSingleKey = false) : IAnimQuatChannel(eAnimChannel_Int16, bSingleKey)	{}
+
 
 	static const IAnimQuatChannel*	GetSingleton();
 
@@ -362,6 +414,8 @@ public:
 class SingleQUAT16Channel : public QUAT16Channel
 {
 public:
+	SingleQUAT16Channel() : QUAT16Channel(true)	{}
+
 
 	static const IAnimQuatChannel*	GetSingleton();
 
@@ -414,6 +468,12 @@ public:
 		m_pQuatChannel->GetData(m_pQuatData, frame, rot);
 	}
 
+	// The raw channels, for decoding many nodes at once.
+	const IAnimPosChannel*	GetPosChannel() const	{ return m_pPosChannel; }
+	const IAnimQuatChannel*	GetQuatChannel() const	{ return m_pQuatChannel; }
+	const uint8*			GetPosData() const		{ return m_pPosData; }
+	const uint8*			GetQuatData() const		{ return m_pQuatData; }
+
 //internal utility functions
 private:
 
@@ -4,10 +4,213 @@
 #include "bdefs.h"
 #include "transformmaker.h"
 #include "de_objects.h"
+#include "ltsysoptim.h"
+
+#include <vector>
 
 #define MAX_MODELPATH_LEN	64
 
 
+// ------------------------------------------------------------------------
+// Structure of arrays node data used by EvaluateAllNodes.
+// ------------------------------------------------------------------------
+struct SPoseSoA
+{
+	float	*m_pPos[3];
+	float	*m_pQuat[4];
+};
+
+// Scratch buffers for EvaluateAllNodes.  These are per thread so several
+// model instances can be posed at the same time.
+class CPoseScratch
+{
+public:
+
+	enum
+	{
+		// Current pose, prev and cur keys, and the blended animation.
+		k_nPoses = 4,
+		// Slerp coefficients.
+		k_nCoefs = 3
+	};
+
+	void	Setup(uint32 nNodes)
+	{
+		m_Data.resize(nNodes * (k_nPoses * 7 + k_nCoefs + 1));
+
+		float *pData = m_Data.data();
+		for(uint32 iPose=0; iPose < k_nPoses; iPose++)
+		{
+			for(uint32 i=0; i < 3; i++, pData += nNodes)
+				m_Poses[iPose].m_pPos[i] = pData;
+			for(uint32 i=0; i < 4; i++, pData += nNodes)
+				m_Poses[iPose].m_pQuat[i] = pData;
+		}
+
+		m_pScale0 = pData; pData += nNodes;
+		m_pScale1 = pData; pData += nNodes;
+		m_pSign = pData; pData += nNodes;
+		m_pParam = pData;
+	}
+
+	SPoseSoA			m_Poses[k_nPoses];
+	float				*m_pScale0;
+	float				*m_pScale1;
+	float				*m_pSign;
+	float				*m_pParam;
+
+private:
+
+	std::vector<float>	m_Data;
+};
+
+static thread_local CPoseScratch g_PoseScratch;
+
+
+// Decodes the keys for every node of an animation at one frame.
+static void tm_DecodeKeys(ModelAnim *pAnim, uint32 iFrame, uint32 nNodes, SPoseSoA &out)
+{
+	const float kPosScale16 = (1.0f/16.0f);
+	const float kQuatScale16 = 1.0f / float(0x7fff);
+
+	for(uint32 iNode=0; iNode < nNodes; iNode++)
+	{
+		const AnimNode *pNode = pAnim->GetAnimNode(iNode);
+
+		const IAnimPosChannel *pPosChannel = pNode->GetPosChannel();
+		uint32 iPosKey = pPosChannel->IsSingleKey() ? 0 : iFrame;
+		switch(pPosChannel->GetFormat())
+		{
+		case eAnimChannel_Float:
+			{
+				const float *pPos = (const float*)pNode->GetPosData() + iPosKey * 3;
+				out.m_pPos[0][iNode] = pPos[0];
+				out.m_pPos[1][iNode] = pPos[1];
+				out.m_pPos[2][iNode] = pPos[2];
+			}
+			break;
+		case eAnimChannel_Int16:
+			{
+				const int16 *pPos = (const int16*)pNode->GetPosData() + iPosKey * 3;
+				out.m_pPos[0][iNode] = float(pPos[0]) * kPosScale16;
+				out.m_pPos[1][iNode] = float(pPos[1]) * kPosScale16;
+				out.m_pPos[2][iNode] = float(pPos[2]) * kPosScale16;
+			}
+			break;
+		default:
+			out.m_pPos[0][iNode] = 0.0f;
+			out.m_pPos[1][iNode] = 0.0f;
+			out.m_pPos[2][iNode] = 0.0f;
+			break;
+		}
+
+		const IAnimQuatChannel *pQuatChannel = pNode->GetQuatChannel();
+		uint32 iQuatKey = pQuatChannel->IsSingleKey() ? 0 : iFrame;
+		switch(pQuatChannel->GetFormat())
+		{
+		case eAnimChannel_Float:
+			{
+				const float *pQuat = (const float*)pNode->GetQuatData() + iQuatKey * 4;
+				out.m_pQuat[0][iNode] = pQuat[0];
+				out.m_pQuat[1][iNode] = pQuat[1];
+				out.m_pQuat[2][iNode] = pQuat[2];
+				out.m_pQuat[3][iNode] = pQuat[3];
+			}
+			break;
+		case eAnimChannel_Int16:
+			{
+				const int16 *pQuat = (const int16*)pNode->GetQuatData() + iQuatKey * 4;
+				out.m_pQuat[0][iNode] = (float)pQuat[0] * kQuatScale16;
+				out.m_pQuat[1][iNode] = (float)pQuat[1] * kQuatScale16;
+				out.m_pQuat[2][iNode] = (float)pQuat[2] * kQuatScale16;
+				out.m_pQuat[3][iNode] = (float)pQuat[3] * kQuatScale16;
+			}
+			break;
+		default:
+			out.m_pQuat[0][iNode] = 0.0f;
+			out.m_pQuat[1][iNode] = 0.0f;
+			out.m_pQuat[2][iNode] = 0.0f;
+			out.m_pQuat[3][iNode] = 1.0f;
+			break;
+		}
+	}
+}
+
+// out = slerp(a, b, pParam[i]) and lerp(a, b, pParam[i]) for every node.
+// This is quat_Slerp split into a pass that works out the coefficients and
+// a straight multiply-add pass over the arrays.  out may be a.  If bSkipZero
+// is set, nodes with a parameter of 0 are left as a.
+static void tm_BlendSoA(SPoseSoA &out, const SPoseSoA &a, const SPoseSoA &b, const float *pParam,
+						bool bSkipZero, CPoseScratch &scratch, uint32 nNodes)
+{
+	float *pScale0 = scratch.m_pScale0;
+	float *pScale1 = scratch.m_pScale1;
+	float *pSign = scratch.m_pSign;
+
+	for(uint32 i=0; i < nNodes; i++)
+	{
+		float t = pParam[i];
+		if(bSkipZero && t == 0.0f)
+		{
+			pScale0[i] = 1.0f;
+			pScale1[i] = 0.0f;
+			pSign[i] = 1.0f;
+			continue;
+		}
+
+		float cosom = a.m_pQuat[0][i]*b.m_pQuat[0][i] + a.m_pQuat[1][i]*b.m_pQuat[1][i] + 
+			a.m_pQuat[2][i]*b.m_pQuat[2][i] + a.m_pQuat[3][i]*b.m_pQuat[3][i];
+
+		if(cosom < 0.0f)
+		{
+			cosom = -cosom;
+			pSign[i] = -1.0f;
+		}
+		else
+		{
+			pSign[i] = 1.0f;
+		}
+
+		if((1.0f - cosom) > 0.0001f)
+		{
+			float omega   = ltacosf(cosom);
+			float oosinom = 1.0f / ltsinf(omega);
+			pScale0[i] = ltsinf((1.f - t) * omega) * oosinom;
+			pScale1[i] = ltsinf(t * omega) * oosinom;
+		}
+		else
+		{
+			pScale0[i] = 1.0f - t;
+			pScale1[i] = t;
+		}
+	}
+
+	for(uint32 iComp=0; iComp < 4; iComp++)
+	{
+		float *pOut = out.m_pQuat[iComp];
+		const float *pA = a.m_pQuat[iComp];
+		const float *pB = b.m_pQuat[iComp];
+
+		for(uint32 i=0; i < nNodes; i++)
+		{
+			pOut[i] = pScale0[i] * pA[i] + pScale1[i] * (pSign[i] * pB[i]);
+		}
+	}
+
+	for(uint32 iComp=0; iComp < 3; iComp++)
+	{
+		float *pOut = out.m_pPos[iComp];
+		const float *pA = a.m_pPos[iComp];
+		const float *pB = b.m_pPos[iComp];
+
+		for(uint32 i=0; i < nNodes; i++)
+		{
+			pOut[i] = pA[i] + (pB[i] - pA[i]) * pParam[i];
+		}
+	}
+}
+
+
 bool TransformMaker::IsValid() 
 {
 	uint32 i;
@@ -46,7 +249,7 @@ bool TransformMaker::SetupTransforms()
 	if(!SetupCall()) 
 		return false;
 
-	Recurse(m_pModel->GetRootNode()->GetNodeIndex(), m_pStartMat);
+	EvaluateAllNodes();
 	return true;
 }
 
@@ -255,7 +458,6 @@ void TransformMaker::Recurse(uint32 iNode, LTMatrix *pParentT)
 	uint32 i;
 	LTMatrix *pMyGlobal;
 	ModelNode *pNode;
-	static LTMatrix mScratchMat;
 
 	for(;;)
 	{
@@ -338,6 +540,156 @@ void TransformMaker::Recurse(uint32 iNode, LTMatrix *pParentT)
 }
 
 
+// ------------------------------------------------------------------------
+// EvaluateAllNodes()
+// Same results as Recurse from the root, but a whole animation at a time.
+// Node indices are assigned depth first (see ModelNode::FillNodeList), so
+// walking them in order visits parents before children in the same order
+// Recurse does, and the node control functions see the same state.
+// ------------------------------------------------------------------------
+void TransformMaker::EvaluateAllNodes()
+{
+	uint32 i, iAnim, iNode;
+	uint32 nNodes = m_pModel->NumNodes();
+
+	CPoseScratch &scratch = g_PoseScratch;
+	scratch.Setup(nNodes);
+
+	SPoseSoA &pose	= scratch.m_Poses[0];
+	SPoseSoA &prev	= scratch.m_Poses[1];
+	SPoseSoA &cur	= scratch.m_Poses[2];
+	SPoseSoA &anim	= scratch.m_Poses[3];
+	float *pParam	= scratch.m_pParam;
+
+	for(iAnim=0; iAnim < m_nAnims; iAnim++)
+	{
+		AnimTimeRef *pTimeRef = &m_Anims[iAnim];
+
+		tm_DecodeKeys(m_pAnimPrev[iAnim], pTimeRef->m_Prev.m_iFrame, nNodes, prev);
+		tm_DecodeKeys(m_pAnimCur[iAnim], pTimeRef->m_Cur.m_iFrame, nNodes, cur);
+
+		for(i=0; i < nNodes; i++)
+		{
+			pParam[i] = pTimeRef->m_Percent;
+		}
+
+		// Don't interpolate the movement node between two different anims
+		// (see InitTransform).
+		if(m_iMoveHintNode < nNodes && pTimeRef->m_Prev.m_iAnim != pTimeRef->m_Cur.m_iAnim)
+		{
+			pParam[m_iMoveHintNode] = 1.0f;
+		}
+
+		// The first animation goes straight into the pose.
+		SPoseSoA &dest = (iAnim == 0) ? pose : anim;
+		tm_BlendSoA(dest, prev, cur, pParam, false, scratch, nNodes);
+
+		// Apply the per-animation translation.
+		if(nNodes > 0)
+		{
+			const LTVector &vTrans1 = m_pModel->GetAnimInfo(pTimeRef->m_Prev.m_iAnim)->m_vTranslation;
+			const LTVector &vTrans2 = m_pModel->GetAnimInfo(pTimeRef->m_Cur.m_iAnim)->m_vTranslation;
+			float t = pParam[0];
+			dest.m_pPos[0][0] += vTrans1.x + (vTrans2.x - vTrans1.x) * t;
+			dest.m_pPos[1][0] += vTrans1.y + (vTrans2.y - vTrans1.y) * t;
+			dest.m_pPos[2][0] += vTrans1.z + (vTrans2.z - vTrans1.z) * t;
+		}
+
+		if(iAnim == 0)
+			continue;
+
+		// Blend this animation into the pose by its weight set.  A weight of 0
+		// leaves the node alone and a weight of 2 adds the animation, so those
+		// nodes get a parameter of 0 here and additive ones are done below.
+		const WeightSet *pWeightSet = m_WeightSets[iAnim];
+		bool bAdditive = false;
+		for(i=0; i < nNodes; i++)
+		{
+			float fWeight = pWeightSet->m_Weights[i];
+			if(fWeight == 2.0f)
+			{
+				bAdditive = true;
+				pParam[i] = 0.0f;
+			}
+			else
+			{
+				pParam[i] = fWeight;
+			}
+		}
+
+		tm_BlendSoA(pose, pose, anim, pParam, true, scratch, nNodes);
+
+		if(bAdditive)
+		{
+			for(iNode=0; iNode < nNodes; iNode++)
+			{
+				if(pWeightSet->m_Weights[iNode] != 2.0f)
+					continue;
+
+				LTRotation qTransform, qPose;
+				LTVector vTransform;
+				InitTransformAdditive(iAnim, iNode, qTransform, vTransform);
+
+				for(i=0; i < 4; i++)
+					qPose.m_Quat[i] = pose.m_pQuat[i][iNode];
+
+				qPose = qPose * qTransform;
+
+				for(i=0; i < 4; i++)
+					pose.m_pQuat[i][iNode] = qPose.m_Quat[i];
+
+				pose.m_pPos[0][iNode] += vTransform.x;
+				pose.m_pPos[1][iNode] += vTransform.y;
+				pose.m_pPos[2][iNode] += vTransform.z;
+			}
+		}
+	}
+
+	// Build the global matrices.
+	LTMatrix mLocal;
+	LTRotation qNode;
+	for(iNode=0; iNode < nNodes; iNode++)
+	{
+		ModelNode *pNode = m_pModel->GetNode(iNode);
+		LTMatrix *pMyGlobal = &m_pOutput[iNode];
+
+		uint32 iParent = pNode->GetParentNodeIndex();
+		LTMatrix *pParentT = (iParent == NODEPARENT_NONE) ? m_pStartMat : &m_pOutput[iParent];
+
+		for(i=0; i < 4; i++)
+			qNode.m_Quat[i] = pose.m_pQuat[i][iNode];
+
+		qNode.ConvertToMatrix(mLocal);
+
+		// Use the offset from the parent if this node only uses rotation data
+		// from the animation.
+		if(pNode->m_Flags & MNODE_ROTATIONONLY)
+		{
+			mLocal.SetTranslation(pNode->m_vOffsetFromParent);
+		}
+		else
+		{
+			mLocal.SetTranslation(pose.m_pPos[0][iNode], pose.m_pPos[1][iNode], pose.m_pPos[2][iNode]);
+		}
+
+		MatMul(pMyGlobal, pParentT, &mLocal);
+
+		if(m_pInstance && m_pInstance->HasNodeControlFn(iNode))
+		{
+			//setup the node control data
+			NodeControlData Data;
+			Data.m_hModel					= (HOBJECT)m_pInstance;
+			Data.m_hNode					= iNode;
+			Data.m_pFromParentTransform		= &pNode->GetFromParentTransform();
+			Data.m_pNodeTransform			= pMyGlobal;
+			Data.m_pParentTransform			= pParentT;
+
+			m_pInstance->ApplyNodeControl(Data);
+		}
+	}
+}
+
+
 // ------------------------------------------------------------------------
 // RecurseWithPath( node-index, parent's-matrix )
 // evaluate the transform hierarchy only traversing nodes on a "path".
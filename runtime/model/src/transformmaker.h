@@ -58,6 +58,11 @@ private:
 
 	void			Recurse(uint32 iNode, LTMatrix *pParentT);
 
+	// Evaluates every node at once.  Each animation is decoded into
+	// structure-of-arrays buffers, blended, and then the node transforms are
+	// concatenated in node order (parents always come before their children).
+	void			EvaluateAllNodes();
+
 	void			RecurseWithPath(uint32 iNode, LTMatrix *pParentT);
 	
 
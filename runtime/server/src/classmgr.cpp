@@ -8,6 +8,7 @@
 #include "bindmgr.h"
 #include "dhashtable.h"
 #include "ltobjectcreate.h"
+#include "zoneprofiler.h"
 
 
 //------------------------------------------------------------------
@@ -724,6 +725,7 @@ static LTRESULT InitExtraClassData(CClassMgr *pClassMgr)
             LT_MEM_TRACK_ALLOC(sb_Init2(&pClassData->m_ObjectBank, pClass->m_ClassObjectSize, 1, 1), LT_MEM_TYPE_MISC);      
             pClassData->m_ClassID = (uint16)i;
             pClassData->m_pClass = pClass;
+            pClassData->m_ProfileZone = prof_RegisterZone(pClass->m_ClassName);
             pClass->m_pInternal[pClassMgr->m_ClassIndex] = pClassData;
 
             hElement = hs_AddElement(pClassMgr->m_hClassNameHash, pClass->m_ClassName, (uint32)strlen(pClass->m_ClassName));
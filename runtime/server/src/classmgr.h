@@ -87,6 +87,7 @@ class CClassData : public CGLLNode
 		ClassDef	*m_pClass;
 		LTObject	*m_pStaticObject;	// Static object for this class, if any.
 		uint16		m_ClassID;			// Unique ID for the class.
+		uint16		m_ProfileZone;		// Zone its objects' updates are profiled as.
 
 	protected :
 
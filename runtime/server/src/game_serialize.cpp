@@ -484,7 +484,8 @@ static void sm_SaveObjectData(LTObject *pObj, ILTStream *pStream, uint32 dwParam
         GS_STREAM_WRITE(((ContainerInstance *)pObj)->m_ContainerCode);
     }
 
-    GS_STREAM_WRITE(pObj->sd->m_NextUpdate);
+    float fNextUpdate = sm_GetNextUpdate(pObj);
+    GS_STREAM_WRITE(fNextUpdate);
 
     // Save other stuff.
     GS_STREAM_WRITE(pObj->m_BPriority);
@@ -834,6 +835,7 @@ static LTRESULT sm_CreateNextObject(ILTStream *pStream,
 	// This makes sure it gets in the correct active/inactive list.
 	sm_SetObjectStateFlags(pObj, tempInternalFlags & IFLAG_INACTIVE_MASK);
 	pObj->m_InternalFlags = tempInternalFlags;
+	sm_WakeObject(pObj);
 
 
 	// AddObjectToWorld ignores m_Pos for world models so really move it.
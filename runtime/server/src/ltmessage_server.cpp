@@ -10,6 +10,7 @@
 #include "packetdefs.h" // For POSITION_EXTRA_BYTE access
 #include "iltcommon.h"
 #include "stringmgr.h"
+#include "netdelta.h"
 
 // Server-side world interface
 #include "world_server_bsp.h"
@@ -50,6 +51,16 @@ void CLTMessage_Write_Server::WriteCompPos(CPacket_Write &cPacket, const LTVecto
 	#endif
 }
 
+void CLTMessage_Write_Server::WriteDeltaCompPos(CPacket_Write &cPacket, const LTVector &vPos, const NetObjState *pBaseline, NetObjState *pState)
+{
+	CompWorldPos cCompPos;
+
+	g_pWorld->EncodeCompressWorldPosition(&cCompPos, &vPos);
+
+	// Note : The extra byte isn't sent, so this can't be used with POSITION_EXTRA_BYTE
+	nd_WritePos(cPacket, cCompPos, pBaseline, pState);
+}
+
 uint8 *CLTMessage_Write_Server::FormatHString(int nStringCode, va_list *pList, uint32 *pLength)
 {
 	return str_FormatString(g_pServerMgr->m_ClassMgr.m_ClassModule.m_hModule, nStringCode, pList, (int*)pLength);
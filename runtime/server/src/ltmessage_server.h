@@ -76,6 +76,7 @@ public:
 
 	// Static function for writing straight to a CPacket_Write
 	static void WriteCompPos(CPacket_Write &cPacket, const LTVector &vPos);
+	static void WriteDeltaCompPos(CPacket_Write &cPacket, const LTVector &vPos, const NetObjState *pBaseline, NetObjState *pState);
 
 public:
 	CLTMessage_Write_Server() : 
@@ -17,6 +17,11 @@
 #include "netmgr.h"
 #include "clienthack.h"
 
+#include "workerpool.h"
+#include "zoneprofiler.h"
+#include "server_filehash.h"
+#include "sha256.h"
+
 #include <queue>
 
 //------------------------------------------------------------------
@@ -59,9 +64,25 @@ struct UpdateInfo {
 	CPacket_Write	m_cUnguaranteed;
 	uint32			m_nTargetUpdateSize;
 	uint32			m_nUpdateTime;
+	SentList		*m_pPrevSentList;	// Objects sent in the client's last update
+	SentList		*m_pCurSentList;	// Objects sent in this update
+	bool			m_bSend;			// False if the client is skipped this frame
+
+	// The unguaranteed update being delta compressed against (if any), and
+	// where this one's objects are saved.
+	const CNetSnapshot	*m_pUnguaranteedBaseline;
+	CNetSnapshot		*m_pUnguaranteedSnapshot;
 };
 
-SentList *g_pCurSentList;
+// Worker threads used to build the client updates.
+static CWorkerPool g_ClientUpdatePool;
+
+// One update per client, reused every frame.  Entries are reset once the
+// updates are sent, so growing the list only ever copies empty packets.
+static std::vector<UpdateInfo> g_ClientUpdates;
+
+// Number of threads used to build client updates (0 = one per hardware thread).
+extern int32 g_CV_ServerUpdateThreads;
 
 
 uint32 g_Ticks_ClientVis;
@@ -71,6 +92,7 @@ extern int32 g_CV_MeasurePackets;
 extern int32 g_bForceRemote;
 extern int32 g_CV_ConnTroubleCount;
 extern int32 g_CV_BandwidthTargetServer;
+extern int32 g_CV_DeltaUnguaranteed;
 
 ILTStream* sm_FTOpenFn(FTServ *hServ, const char *pFilename) 
 {
@@ -87,6 +109,18 @@ int sm_FTCantOpenFileFn(FTServ *hServ, const char *pFilename)
 	return TODO_REMOVEFILE;
 }
 
+bool sm_FTGetHashFn(FTServ *hServ, const char *pFilename, uint32 fileSize, uint8 *pHash)
+{
+	UsedFile *pUsedFile;
+	if (!server_filemgr->GetAddedUsedFile(pFilename, &pUsedFile))
+	{
+		memset(pHash, 0, SHA256_HASH_SIZE);
+		return true;
+	}
+
+	return fhash_GetHash(pUsedFile->m_hFileTree, pFilename, fileSize, pHash);
+}
+
 
 
 //------------------------------------------------------------------
@@ -105,6 +139,7 @@ Client::Client() :
 	m_hFTServ(0),
 	m_ObjInfos(0),
 	m_iPrevSentList(0),
+	m_bAllObjectsRelevant(true),
 	m_pObject(0),
 	m_pPluginUserData(0),
 	m_ClientID(0),
@@ -114,7 +149,10 @@ Client::Client() :
 	m_Name(0),
 	m_ConnectionID(0),
 	m_Events(LTLink_Init),
-	m_hFileIDTable(0)
+	m_hFileIDTable(0),
+	m_nUnguaranteedSequence(0),
+	m_nUnguaranteedAck(0),
+	m_bUnguaranteedAcked(false)
 {
 }
 
@@ -144,6 +182,7 @@ bool Client::Init( CBaseConn *pBaseConn, bool bIsLocal )
 	initStruct.m_OpenFn = sm_FTOpenFn;
 	initStruct.m_CloseFn = sm_FTCloseFn;
 	initStruct.m_CantOpenFileFn = sm_FTCantOpenFileFn;
+	initStruct.m_GetHashFn = sm_FTGetHashFn;
 	initStruct.m_pNetMgr = &g_pServerMgr->m_NetMgr;
 	initStruct.m_ConnID = pBaseConn;
 	m_hFTServ = fts_Init(&initStruct, flags);
@@ -819,8 +858,10 @@ bool sm_FlushUpdate(UpdateInfo *pInfo, const CPacket_Read &cPacket, uint32 nPack
 }
 
 
-void WriteUnguaranteedInfo(LTObject *pObject, CPacket_Write &cPacket) 
+void WriteUnguaranteedInfo(LTObject *pObject, UpdateInfo *pInfo) 
 {
+	CPacket_Write &cPacket = pInfo->m_cUnguaranteed;
+
 	uint32 flags = 0;
 
 	if (pObject->sd->m_NetFlags & NETFLAG_POSUNGUARANTEED) 
@@ -852,30 +893,40 @@ void WriteUnguaranteedInfo(LTObject *pObject, CPacket_Write &cPacket)
  	cPacket.Writeuint16(pObject->m_ObjectID);
 	cPacket.WriteBits(flags, UUF_FLAGCOUNT);
 
+	// Everything's written against what the baseline update had for the object.
+	const NetObjState *pBaseline = LTNULL;
+	if (pInfo->m_pUnguaranteedBaseline)
+		pBaseline = pInfo->m_pUnguaranteedBaseline->Find(pObject->m_ObjectID);
+
+	NetObjState cState;
+	nd_ClearState(&cState);
+
  	// Write position/rotation.
 	if (flags & UUF_POS)
 	{
-		CLTMessage_Write_Server::WriteCompPos(cPacket, pObject->GetPos());
+		CLTMessage_Write_Server::WriteDeltaCompPos(cPacket, pObject->GetPos(), pBaseline, &cState);
 		bool bWriteVelocity = pObject->m_Velocity.MagSqr() > 0.00001f;
 		cPacket.Writebool(bWriteVelocity);
 		if (bWriteVelocity)
-			CLTMessage_Write_Server::WriteCompLTVector(cPacket, pObject->m_Velocity);
+			CLTMessage_Write_Server::WriteDeltaCompLTVector(cPacket, pObject->m_Velocity, pBaseline, &cState);
 	}
 
 	if (flags & UUF_YROTATION) 
 	{
-		CLTMessage_Write_Server::WriteYRotation(cPacket, pObject->m_Rotation);
+		CLTMessage_Write_Server::WriteDeltaYRotation(cPacket, pObject->m_Rotation, pBaseline, &cState);
 	}
 	else if (flags & UUF_ROT) 
 	{
-		CLTMessage_Write_Server::WriteCompLTRotation(cPacket, pObject->m_Rotation);
+		CLTMessage_Write_Server::WriteDeltaCompLTRotation(cPacket, pObject->m_Rotation, pBaseline, &cState);
 	}
 
 	// Write anim info.
 	if (flags & UUF_ANIMINFO) 
 	{
-		WriteAnimInfo(ToModel(pObject), cPacket);
+		WriteAnimInfo(ToModel(pObject), cPacket, pBaseline, &cState);
 	}
+
+	pInfo->m_pUnguaranteedSnapshot->Add(pObject->m_ObjectID, cState);
 }
 
 void ExpandObjectIdList(SentList *pSentList)
@@ -918,7 +969,7 @@ void sm_AddObjectChangeInfo(UpdateInfo *pInfo, LTObject *pObject, ObjInfo *pObjI
 	// Update the send time
 	pObjInfo->m_nLastSentG = pInfo->m_nUpdateTime;
 
-	AddObjectIdToSentList(g_pCurSentList, pObject->m_ObjectID);
+	AddObjectIdToSentList(pInfo->m_pCurSentList, pObject->m_ObjectID);
 
 	// Setup the packet with update info.
 	CPacket_Write cSubPacket;
@@ -1037,7 +1088,7 @@ void sm_SendSoundTracks(UpdateInfo *pInfo, CPacket_Write &cPacket)
 		pObjInfo = &pInfo->m_pClient->m_ObjInfos[GetLinkID(pSoundTrack->m_pIDLink)];
 
 		uint16 nNewId = (uint16)GetLinkID(pSoundTrack->m_pIDLink);
-		AddObjectIdToSentList( g_pCurSentList, nNewId );
+		AddObjectIdToSentList( pInfo->m_pCurSentList, nNewId );
 
 		// Setup the packet with update info.  If the client already told us the sound is done, then don't
 		// send it again...
@@ -1166,63 +1217,55 @@ void SendAllObjectsGuaranteed(ObjectMgr *pObjectMgr, UpdateInfo *pInfo)
 	//determine if we are dealing with a local client. 
 	bool bLocalClient = !!(pInfo->m_pClient->m_ClientFlags & CFLAG_LOCAL);
 
-	uint32 i;
-	LTLink *pListHead, *pCur;
-	LTObject *pObject;
-
 	if(bLocalClient)
 	{
 		//we have a local client, so we can bypass queueing up, sorting, bandwidth checking
 		//and other tasks and just send all objects
-		for (i=0; i < NUM_OBJECTTYPES; i++)
-		{
-			pListHead = &pObjectMgr->m_ObjectLists[i].m_Head;
-			for (pCur=pListHead->m_pNext; pCur != pListHead; pCur=pCur->m_pNext)
-			{
-				pObject = (LTObject*)pCur->m_pData;
+		CRelevantObjectIter cRelevant(pObjectMgr, pInfo->m_pClient);
+		LTObject *pObject;
 
-				// Gotta check here too for objects not in the BSP.
-				if (!ShouldSendToClient(pInfo->m_pClient, pObject)) 
-					continue;
+		while ((pObject = cRelevant.Next()) != LTNULL)
+		{
+			// Gotta check here too for objects not in the BSP.
+			if (!ShouldSendToClient(pInfo->m_pClient, pObject)) 
+				continue;
 
-				// Don't send over the main world model
-				if (pObject->IsMainWorldModel()) 
-					continue;
+			// Don't send over the main world model
+			if (pObject->IsMainWorldModel()) 
+				continue;
 
-				UpdateSendToClientState(pObject, pInfo);
-			}
+			UpdateSendToClientState(pObject, pInfo);
 		}
 	}
 	else
 	{
 		// Do this in priority order...
-		static TGuaranteedObjQueue aObjects;
+		// (one queue per thread since clients are updated in parallel)
+		static thread_local TGuaranteedObjQueue aObjects;
 
 		// Try not to use up the whole update...
 		uint32 nUpdateSizeRemaining = pInfo->m_nTargetUpdateSize / 2;
 
-		for (i=0; i < NUM_OBJECTTYPES; i++)
-		{
-			pListHead = &pObjectMgr->m_ObjectLists[i].m_Head;
-			for (pCur=pListHead->m_pNext; pCur != pListHead; pCur=pCur->m_pNext)
-			{
-				pObject = (LTObject*)pCur->m_pData;
+		//the objects this client is interested in
+		CRelevantObjectIter cRelevant(pObjectMgr, pInfo->m_pClient);
+		LTObject *pObject;
 
-				// Gotta check here too for objects not in the BSP.
-				if (!ShouldSendToClient(pInfo->m_pClient, pObject)) 
-					continue;
+		while ((pObject = cRelevant.Next()) != LTNULL)
+		{
+			// Gotta check here too for objects not in the BSP.
+			if (!ShouldSendToClient(pInfo->m_pClient, pObject)) 
+				continue;
 
-				// Don't send over the main world model
-				if (pObject->IsMainWorldModel()) 
-					continue;
+			// Don't send over the main world model
+			if (pObject->IsMainWorldModel()) 
+				continue;
 
-				CGuaranteedObjTrack cCurObj;
-				cCurObj.m_pObject	= pObject;
-				cCurObj.m_pObjInfo	= &pInfo->m_pClient->m_ObjInfos[pObject->m_ObjectID];
-				cCurObj.m_fPriority = (float)(pInfo->m_nUpdateTime - cCurObj.m_pObjInfo->m_nLastSentG);
+			CGuaranteedObjTrack cCurObj;
+			cCurObj.m_pObject	= pObject;
+			cCurObj.m_pObjInfo	= &pInfo->m_pClient->m_ObjInfos[pObject->m_ObjectID];
+			cCurObj.m_fPriority = (float)(pInfo->m_nUpdateTime - cCurObj.m_pObjInfo->m_nLastSentG);
 
-				aObjects.push(cCurObj);
-			}
+			aObjects.push(cCurObj);
 		}
 
 		while (!aObjects.empty())
@@ -1246,7 +1289,7 @@ void SendAllObjectsGuaranteed(ObjectMgr *pObjectMgr, UpdateInfo *pInfo)
 			const CGuaranteedObjTrack &cCurObj = aObjects.top();
 
 			cCurObj.m_pObjInfo->m_ChangeFlags |= CF_SENTINFO;
-			AddObjectIdToSentList(g_pCurSentList, cCurObj.m_pObject->m_ObjectID);
+			AddObjectIdToSentList(pInfo->m_pCurSentList, cCurObj.m_pObject->m_ObjectID);
 
 			aObjects.pop();
 		}
@@ -1254,10 +1297,10 @@ void SendAllObjectsGuaranteed(ObjectMgr *pObjectMgr, UpdateInfo *pInfo)
 }
 
 //Handles writing out the unguaranteed data of an object as well as all of its attachments
-static void WriteUnguaranteedDataWithAttachments(LTObject* pObject, CPacket_Write& cUnguaranteed, const uint32 k_nUnguaranteedMask)
+static void WriteUnguaranteedDataWithAttachments(LTObject* pObject, UpdateInfo *pInfo, const uint32 k_nUnguaranteedMask)
 {
 	//write out the unguaranteed data for the object itself
-	WriteUnguaranteedInfo(pObject, cUnguaranteed);
+	WriteUnguaranteedInfo(pObject, pInfo);
 
 	//now do the same for all the attached objects
 	for (Attachment *pAttachment = pObject->m_Attachments; pAttachment; pAttachment = pAttachment->m_pNext) 
@@ -1269,7 +1312,7 @@ static void WriteUnguaranteedDataWithAttachments(LTObject* pObject, CPacket_Writ
 		if ((pAttachedObj->sd->m_NetFlags & k_nUnguaranteedMask) == 0)
 			continue;
 
-		WriteUnguaranteedInfo(pAttachedObj, cUnguaranteed);
+		WriteUnguaranteedInfo(pAttachedObj, pInfo);
 	}
 }
 
@@ -1315,22 +1358,19 @@ void SendAllObjectsUnguaranteed(ObjectMgr *pObjectMgr, UpdateInfo *pInfo)
 	{
 		//we are on a local client, we don't need to do queuing, weighting, or anything, everything
 		//can just be sent down
-		for (uint32 i = 0; i < NUM_OBJECTTYPES; i++)
-		{
-			LTLink *pListHead = &pObjectMgr->m_ObjectLists[i].m_Head;
-			for (LTLink *pCur = pListHead->m_pNext; pCur != pListHead; pCur = pCur->m_pNext)
-			{
-				LTObject *pObject = (LTObject*)pCur->m_pData;
+		CRelevantObjectIter cRelevant(pObjectMgr, pInfo->m_pClient);
+		LTObject *pObject;
 
-				if ((pObject->sd->m_NetFlags & k_nUnguaranteedMask) == 0)
-					continue;
+		while ((pObject = cRelevant.Next()) != LTNULL)
+		{
+			if ((pObject->sd->m_NetFlags & k_nUnguaranteedMask) == 0)
+				continue;
 
-				//write out all the unguaranteed data
-				WriteUnguaranteedDataWithAttachments(pObject, pInfo->m_cUnguaranteed, k_nUnguaranteedMask);
+			//write out all the unguaranteed data
+			WriteUnguaranteedDataWithAttachments(pObject, pInfo, k_nUnguaranteedMask);
 
-				// Update the send time
-				UpdateSendTimeWithAttachments(pObject, pInfo, k_nUnguaranteedMask);				
-			}
+			// Update the send time
+			UpdateSendTimeWithAttachments(pObject, pInfo, k_nUnguaranteedMask);				
 		}
 	}
 	else
@@ -1344,37 +1384,38 @@ void SendAllObjectsUnguaranteed(ObjectMgr *pObjectMgr, UpdateInfo *pInfo)
 		uint32 nUpdateSizeRemaining = pInfo->m_nTargetUpdateSize - pInfo->m_cPacket.Size();
 
 		// Do this in priority order...
-		static TUnguaranteedObjQueue aObjects;
+		// (one queue per thread since clients are updated in parallel)
+		static thread_local TUnguaranteedObjQueue aObjects;
 
-		uint32 nUnguaranteedLength = 0;
+		// What's been written so far is kept when stripping the packet.
+		uint32 nUnguaranteedLength = pInfo->m_cUnguaranteed.Size();
+		uint32 nSnapshotLength = pInfo->m_pUnguaranteedSnapshot->GetNumObjects();
 
 		const float k_fDistPriorityScale = 1.0f / 128.0f;
 
-		for (uint32 i = 0; i < NUM_OBJECTTYPES; i++)
-		{
-			LTLink *pListHead = &pObjectMgr->m_ObjectLists[i].m_Head;
-			for (LTLink *pCur = pListHead->m_pNext; pCur != pListHead; pCur = pCur->m_pNext)
-			{
-				LTObject *pObject = (LTObject*)pCur->m_pData;
+		//the objects this client is interested in
+		CRelevantObjectIter cRelevant(pObjectMgr, pInfo->m_pClient);
+		LTObject *pObject;
 
-				if ((pObject->sd->m_NetFlags & k_nUnguaranteedMask) == 0)
-					continue;
+		while ((pObject = cRelevant.Next()) != LTNULL)
+		{
+			if ((pObject->sd->m_NetFlags & k_nUnguaranteedMask) == 0)
+				continue;
 
 
-				CUnguaranteedObjTrack cCurObj;
-				cCurObj.m_pObject = pObject;
+			CUnguaranteedObjTrack cCurObj;
+			cCurObj.m_pObject = pObject;
 
-				//Determine the weight of this message based upon some rules
-				ObjInfo* pObjInfo = &pInfo->m_pClient->m_ObjInfos[pObject->m_ObjectID];
+			//Determine the weight of this message based upon some rules
+			ObjInfo* pObjInfo = &pInfo->m_pClient->m_ObjInfos[pObject->m_ObjectID];
 
-				float fDistToClient = LTMAX(pObject->m_Pos.Dist(pInfo->m_pClient->m_ViewPos) * k_fDistPriorityScale, 1.0f);
-				float fTime = (float)(pInfo->m_nUpdateTime - pObjInfo->m_nLastSentU) + 1.0f;
-				float fSize = pObject->m_Dims.MagSqr();
-				float fSpeed = (pObject->m_Velocity.Mag() * k_fDistPriorityScale) + 1.0f;
-				cCurObj.m_fPriority = (fTime * fSize * fSpeed) / fDistToClient;
+			float fDistToClient = LTMAX(pObject->m_Pos.Dist(pInfo->m_pClient->m_ViewPos) * k_fDistPriorityScale, 1.0f);
+			float fTime = (float)(pInfo->m_nUpdateTime - pObjInfo->m_nLastSentU) + 1.0f;
+			float fSize = pObject->m_Dims.MagSqr();
+			float fSpeed = (pObject->m_Velocity.Mag() * k_fDistPriorityScale) + 1.0f;
+			cCurObj.m_fPriority = (fTime * fSize * fSpeed) / fDistToClient;
 
-				aObjects.push(cCurObj);
-			}
+			aObjects.push(cCurObj);
 		}
 
 		while (!aObjects.empty())
@@ -1382,7 +1423,7 @@ void SendAllObjectsUnguaranteed(ObjectMgr *pObjectMgr, UpdateInfo *pInfo)
 			const CUnguaranteedObjTrack &cCurObj = aObjects.top();
 
 			//write out all the unguaranteed data
-			WriteUnguaranteedDataWithAttachments(cCurObj.m_pObject, pInfo->m_cUnguaranteed, k_nUnguaranteedMask);
+			WriteUnguaranteedDataWithAttachments(cCurObj.m_pObject, pInfo, k_nUnguaranteedMask);
 
 			// Jump out if we're sending too much...
 			if (pInfo->m_cUnguaranteed.Size() >= nUpdateSizeRemaining)
@@ -1390,7 +1431,10 @@ void SendAllObjectsUnguaranteed(ObjectMgr *pObjectMgr, UpdateInfo *pInfo)
 				break;
 			}
 			else
+			{
 				nUnguaranteedLength = pInfo->m_cUnguaranteed.Size();
+				nSnapshotLength = pInfo->m_pUnguaranteedSnapshot->GetNumObjects();
+			}
 
 			// Update the send time
 			UpdateSendTimeWithAttachments(cCurObj.m_pObject, pInfo, k_nUnguaranteedMask);
@@ -1408,33 +1452,37 @@ void SendAllObjectsUnguaranteed(ObjectMgr *pObjectMgr, UpdateInfo *pInfo)
 		{
 			CPacket_Read cStripUnguaranteed(CPacket_Read(pInfo->m_cUnguaranteed), 0, nUnguaranteedLength);
 			pInfo->m_cUnguaranteed.WritePacket(cStripUnguaranteed);
+
+			// The client won't know about the stripped objects either
+			pInfo->m_pUnguaranteedSnapshot->Truncate(nSnapshotLength);
 		}
 	}
 }
 
 
-void sm_UpdateClientInWorld(Client *pClient)
+// Sets up the update for a client.  Returns false if the client shouldn't
+// get an update this frame.
+static bool BeginClientUpdate(Client *pClient, UpdateInfo *pInfo)
 {
 	// If the client's queue is backed up, wait until it's ok.
 	if (IsClientInTrouble(pClient))
 	{
-		return;
+		return false;
 	}
 
 	// If they're not in the world, they don't need to be updated...
 	if (pClient->m_State != CLIENT_INWORLD)
-		return;
+		return false;
 
 	// Init the update info
-	UpdateInfo updateInfo;
-	updateInfo.m_cPacket.Writeuint8(SMSG_UPDATE);
-	updateInfo.m_cUnguaranteed.Writeuint8(SMSG_UNGUARANTEEDUPDATE);
-	updateInfo.m_pClient = pClient;
+	pInfo->m_cPacket.Writeuint8(SMSG_UPDATE);
+	pInfo->m_cUnguaranteed.Writeuint8(SMSG_UNGUARANTEEDUPDATE);
+	pInfo->m_pClient = pClient;
 
 	// Keep track of time
-	updateInfo.m_nUpdateTime = timeGetTime();
-	uint32 nTimeSinceUpdate = updateInfo.m_nUpdateTime - pClient->m_nLastUpdateTime;
-	pClient->m_nLastUpdateTime = updateInfo.m_nUpdateTime;
+	pInfo->m_nUpdateTime = timeGetTime();
+	uint32 nTimeSinceUpdate = pInfo->m_nUpdateTime - pClient->m_nLastUpdateTime;
+	pClient->m_nLastUpdateTime = pInfo->m_nUpdateTime;
 
 	// Get the available bandwidth
 	// Note : We're more interested in multi-frame bandwidth usage.
@@ -1443,35 +1491,48 @@ void sm_UpdateClientInWorld(Client *pClient)
 	if (nAvailableBandwidth <= 0)
 	{
 		// Don't update them if we're choking
-		return;
+		return false;
 	}
-	updateInfo.m_nTargetUpdateSize = (uint32)nAvailableBandwidth;
+	pInfo->m_nTargetUpdateSize = (uint32)nAvailableBandwidth;
 
-	SentList *pPrevList = &pClient->m_SentLists[pClient->m_iPrevSentList];
-	SentList *pCurList = &pClient->m_SentLists[!pClient->m_iPrevSentList];
-	g_pCurSentList = pCurList;
+	pInfo->m_pPrevSentList = &pClient->m_SentLists[pClient->m_iPrevSentList];
+	pInfo->m_pCurSentList = &pClient->m_SentLists[!pClient->m_iPrevSentList];
 
 	// Clear the CF_SENTINFO flag on all the objects we sent info on earlier.
+	SentList *pPrevList = pInfo->m_pPrevSentList;
 	for (uint32 i = 0; i < pPrevList->m_nObjectIDs; i++)
 	{
 		pClient->m_ObjInfos[pPrevList->m_ObjectIDs[i]].m_ChangeFlags &= ~CF_SENTINFO;
 	}
 
 	// Build the new SentInfo list.
-	pCurList->m_nObjectIDs = 0;
+	pInfo->m_pCurSentList->m_nObjectIDs = 0;
+
+	// Find the objects this client cares about.  Anything left out
+	// gets removed from the client by WriteObjectRemoves.
+	sm_GatherRelevantObjects(&g_pServerMgr->m_ObjectMgr, pClient);
+
+	return true;
+}
 
+// Writes the guaranteed object updates.  This only touches the client's own
+// state so it can run for several clients at once.
+static void BuildGuaranteedUpdate(UpdateInfo *pInfo)
+{
 #ifdef USE_LOCAL_STUFF
-	if (!(pClient->m_ClientFlags & CFLAG_LOCAL))
+	if (!(pInfo->m_pClient->m_ClientFlags & CFLAG_LOCAL))
 #endif
 	{
-		// Activate everything they can see.
-		{
-			CountAdder cTicks_ClientVis(&g_Ticks_ClientVis);
-
-			// Send all the alive objects to the client
-			SendAllObjectsGuaranteed(&g_pServerMgr->m_ObjectMgr, &updateInfo);
-		}
+		// Send all the alive objects to the client
+		SendAllObjectsGuaranteed(&g_pServerMgr->m_ObjectMgr, pInfo);
 	}
+}
+
+// Writes the events, sound tracks and removes.  These change shared
+// reference counts so they have to be done one client at a time.
+static void WriteClientEvents(UpdateInfo *pInfo)
+{
+	Client *pClient = pInfo->m_pClient;
 
 	// Add all the event subpackets.
 	LTLink *pCur = pClient->m_Events.m_Head.m_pNext;
@@ -1480,7 +1541,7 @@ void sm_UpdateClientInWorld(Client *pClient)
 		LTLink *pNext = pCur->m_pNext;
 	 	CServerEvent *pEvent = (CServerEvent*)pCur->m_pData;
 	
-		WriteEventToPacket(pEvent, pClient, updateInfo.m_cPacket);
+		WriteEventToPacket(pEvent, pClient, pInfo->m_cPacket);
 
 		dl_RemoveAt(&pClient->m_Events, pCur);
 		pEvent->DecrementRefCount();
@@ -1489,23 +1550,57 @@ void sm_UpdateClientInWorld(Client *pClient)
 	}
 
  	// Send sound tracking data.
-	sm_SendSoundTracks(&updateInfo, updateInfo.m_cPacket);
+	sm_SendSoundTracks(pInfo, pInfo->m_cPacket);
 	
 	// Write the list of objects to remove (objects we didn't send info on).
-	WriteObjectRemoves(&updateInfo, pPrevList);
+	WriteObjectRemoves(pInfo, pInfo->m_pPrevSentList);
 
 	// Clear out the change status on all the sound objects
-	ClearSoundChangeFlags(&updateInfo);
+	ClearSoundChangeFlags(pInfo);
+}
+
+// Writes the unguaranteed object updates.  Like the guaranteed ones, this
+// can run for several clients at once.
+static void BuildUnguaranteedUpdate(UpdateInfo *pInfo)
+{
+	Client *pClient = pInfo->m_pClient;
+
+	// Number the update, and build it from the newest one the client
+	// acknowledged if we still have it.
+	uint16 nSequence = pClient->m_nUnguaranteedSequence++;
+	uint16 nBaselineAge = (uint16)(nSequence - pClient->m_nUnguaranteedAck);
+
+	pInfo->m_pUnguaranteedBaseline = LTNULL;
+	if (g_CV_DeltaUnguaranteed && pClient->m_bUnguaranteedAcked && (nBaselineAge < NETDELTA_SNAPSHOTS))
+	{
+		pInfo->m_pUnguaranteedBaseline = pClient->m_UnguaranteedSnapshots.Find(pClient->m_nUnguaranteedAck);
+	}
+
+	pInfo->m_cUnguaranteed.Writeuint16(nSequence);
+	pInfo->m_cUnguaranteed.Writebool(pInfo->m_pUnguaranteedBaseline != LTNULL);
+	if (pInfo->m_pUnguaranteedBaseline)
+		pInfo->m_cUnguaranteed.WriteBits(nBaselineAge, NETDELTA_SNAPSHOT_BITS);
+
+	pInfo->m_pUnguaranteedSnapshot = pClient->m_UnguaranteedSnapshots.Begin(nSequence);
+	ASSERT(pInfo->m_pUnguaranteedSnapshot);
 
 	// Write unguaranteed stuff. 
-	SendAllObjectsUnguaranteed(&g_pServerMgr->m_ObjectMgr, &updateInfo);
+	SendAllObjectsUnguaranteed(&g_pServerMgr->m_ObjectMgr, pInfo);
+
+	pInfo->m_pUnguaranteedSnapshot->Finish();
 
 	// Mark the end of the unguaranteed info
-	WriteEndUpdateInfo(pClient, updateInfo.m_cUnguaranteed);
+	WriteEndUpdateInfo(pInfo->m_pClient, pInfo->m_cUnguaranteed);
+}
+
+// Sends the update and anything else the client is waiting on.
+static void EndClientUpdate(UpdateInfo *pInfo)
+{
+	Client *pClient = pInfo->m_pClient;
 
 	// Send them..
-	sm_FlushUpdate(&updateInfo, CPacket_Read(updateInfo.m_cPacket), MESSAGE_GUARANTEED);
-	sm_FlushUpdate(&updateInfo, CPacket_Read(updateInfo.m_cUnguaranteed), 0);
+	sm_FlushUpdate(pInfo, CPacket_Read(pInfo->m_cPacket), MESSAGE_GUARANTEED);
+	sm_FlushUpdate(pInfo, CPacket_Read(pInfo->m_cUnguaranteed), 0);
 
 	pClient->m_iPrevSentList = !pClient->m_iPrevSentList; // Swap this..
 
@@ -1524,6 +1619,121 @@ void sm_UpdateClientInWorld(Client *pClient)
 	}
 }
 
+// Clears a client update so it can be reused next frame.
+static void ResetClientUpdate(UpdateInfo *pInfo)
+{
+	pInfo->m_pClient = LTNULL;
+	pInfo->m_cPacket.Reset();
+	pInfo->m_cUnguaranteed.Reset();
+	pInfo->m_nTargetUpdateSize = 0;
+	pInfo->m_nUpdateTime = 0;
+	pInfo->m_pPrevSentList = LTNULL;
+	pInfo->m_pCurSentList = LTNULL;
+	pInfo->m_bSend = false;
+	pInfo->m_pUnguaranteedBaseline = LTNULL;
+	pInfo->m_pUnguaranteedSnapshot = LTNULL;
+}
+
+static void BuildGuaranteedUpdateJob(uint32 nIndex, void *pUser)
+{
+	PROFILE_ZONE("BuildGuaranteedUpdate")
+
+	UpdateInfo *pInfo = &((UpdateInfo*)pUser)[nIndex];
+	if (pInfo->m_bSend)
+		BuildGuaranteedUpdate(pInfo);
+}
+
+static void BuildUnguaranteedUpdateJob(uint32 nIndex, void *pUser)
+{
+	PROFILE_ZONE("BuildUnguaranteedUpdate")
+
+	UpdateInfo *pInfo = &((UpdateInfo*)pUser)[nIndex];
+	if (pInfo->m_bSend)
+		BuildUnguaranteedUpdate(pInfo);
+}
+
+// Clears the dirty flag on every model's trackers once all the clients have
+// had a chance to see it.
+static void ClearDirtyTrackers(ObjectMgr *pObjectMgr)
+{
+	LTLink *pListHead = &pObjectMgr->m_ObjectLists[OT_MODEL].m_Head;
+	for (LTLink *pCur = pListHead->m_pNext; pCur != pListHead; pCur = pCur->m_pNext)
+	{
+		ModelInstance *pInst = ToModel((LTObject*)pCur->m_pData);
+		for (LTAnimTracker *pTracker = pInst->m_AnimTrackers; pTracker; pTracker = pTracker->GetNext())
+		{
+			pTracker->m_bDirty = false;
+		}
+	}
+}
+
+
+void sm_UpdateClientListInWorld(LTList *pClientList)
+{
+	if (pClientList->m_nElements == 0)
+		return;
+
+	PROFILE_ZONE("UpdateClients")
+
+	// (Re)start the workers if the thread count changed.
+	uint32 nNumThreads = (g_CV_ServerUpdateThreads > 0) ? (uint32)g_CV_ServerUpdateThreads : LTMAX(std::thread::hardware_concurrency(), 1);
+	if (g_ClientUpdatePool.GetNumThreads() != nNumThreads)
+	{
+		g_ClientUpdatePool.Init(nNumThreads);
+	}
+
+	// One update per client, kept in client list order.
+	uint32 nNumClients = pClientList->m_nElements;
+	if (g_ClientUpdates.size() < nNumClients)
+	{
+		LT_MEM_TRACK_ALLOC(g_ClientUpdates.resize(nNumClients), LT_MEM_TYPE_MISC);
+	}
+	UpdateInfo *pUpdates = &g_ClientUpdates[0];
+
+	uint32 nCurClient = 0;
+	LTLink *pListHead = &pClientList->m_Head;
+	for (LTLink *pCur = pListHead->m_pNext; pCur != pListHead; pCur = pCur->m_pNext)
+	{
+		ASSERT(nCurClient < nNumClients);
+		pUpdates[nCurClient].m_bSend = BeginClientUpdate((Client*)pCur->m_pData, &pUpdates[nCurClient]);
+		++nCurClient;
+	}
+
+	{
+		CountAdder cTicks_ClientVis(&g_Ticks_ClientVis);
+
+		// Activate everything they can see.
+		g_ClientUpdatePool.ParallelFor(nNumClients, BuildGuaranteedUpdateJob, pUpdates);
+	}
+
+	uint32 i;
+	for (i = 0; i < nNumClients; i++)
+	{
+		if (pUpdates[i].m_bSend)
+			WriteClientEvents(&pUpdates[i]);
+	}
+
+	g_ClientUpdatePool.ParallelFor(nNumClients, BuildUnguaranteedUpdateJob, pUpdates);
+
+	// Send everything in the same order the clients were updated in.
+	{
+		PROFILE_ZONE("SendClientUpdates")
+
+		for (i = 0; i < nNumClients; i++)
+		{
+			if (pUpdates[i].m_bSend)
+				EndClientUpdate(&pUpdates[i]);
+		}
+	}
+
+	for (i = 0; i < nNumClients; i++)
+	{
+		ResetClientUpdate(&pUpdates[i]);
+	}
+
+	ClearDirtyTrackers(&g_pServerMgr->m_ObjectMgr);
+}
+
 
 Client* sm_FindClient(CBaseConn *connID)
 {
@@ -11,6 +11,14 @@
 #include "packetdefs.h"
 #endif
 
+#ifndef __S_INTEREST_H__
+#include "s_interest.h"
+#endif
+
+#ifndef __NETDELTA_H__
+#include "netdelta.h"
+#endif
+
 struct FTServ;
 class HHashTable;
 class CServerMgr;
@@ -91,6 +99,10 @@ struct ObjInfo
 	// Used for timing of networking updates
 	uint32			m_nLastSentG;
 	uint32			m_nLastSentU;
+
+	// What the last guaranteed update said about the object's position and
+	// rotation.  The next one is delta compressed against it.
+	NetObjState		m_GuaranteedState;
 };
 
 #define OBJINFOSOUNDF_CLIENTDONE	(1<<0)		// Sound track has completed on this client
@@ -145,6 +157,11 @@ struct Client
 	SentList	m_SentLists[2];
 	uint32		m_iPrevSentList;
 
+	// Objects relevant to this client for the current update.  Only
+	// filled in when m_bAllObjectsRelevant is false.
+	TRelevantObjectList	m_RelevantObjects;
+	bool		m_bAllObjectsRelevant;
+
 	// Every client is associated with an object.
 	LTObject	*m_pObject;			
 
@@ -175,6 +192,13 @@ struct Client
 	// FileID based information.
 	HHashTable  *m_hFileIDTable;
 
+	// Unguaranteed updates are numbered, and the client acknowledges the
+	// ones it gets.  Each update is delta compressed against the newest
+	// acknowledged one that's still in m_UnguaranteedSnapshots.
+	uint16				m_nUnguaranteedSequence;	// Number of the next update
+	uint16				m_nUnguaranteedAck;
+	bool				m_bUnguaranteedAcked;		// False until the first ack
+	CNetSnapshotRing	m_UnguaranteedSnapshots;
 };
 
 
@@ -205,8 +229,10 @@ bool sm_SetClientState(Client *pClient, int state);
 // Update the client's state in the world.
 void sm_UpdateClientState(Client *pClient);
 
-// Updates the client if it's in the world.
-void sm_UpdateClientInWorld(Client *pClient);
+// Builds and sends the updates for every client in the list that's in the world.
+// The object updates are built on worker threads (see ServerUpdateThreads)
+// but the packets are sent in list order.
+void sm_UpdateClientListInWorld(LTList *pClientList);
 
 // Finds a client given its connection ID.
 Client* sm_FindClient(CBaseConn *connID);
@@ -7,6 +7,7 @@
 #include "dhashtable.h"
 #include "s_client.h"
 #include "ltobjectcreate.h"
+#include "zoneprofiler.h"
 
 //------------------------------------------------------------------
 //------------------------------------------------------------------
@@ -273,6 +274,27 @@ void con_SpawnObject(int argc, const char **argv)
 }
 
 
+// Writes the zones the profiler has recorded as a Chrome trace.
+void con_ProfileTrace(int argc, const char **argv)
+{
+    const char *pFilename = (argc >= 1) ? argv[0] : "profile.json";
+
+    if (!g_CV_ProfileZones)
+    {
+        dsi_ConsolePrint("ProfileZones is off, so nothing new has been recorded");
+    }
+
+    if (prof_WriteTrace(pFilename) == LT_OK)
+    {
+        dsi_ConsolePrint("Wrote profile trace to %s", pFilename);
+    }
+    else
+    {
+        dsi_ConsolePrint("Couldn't write %s", pFilename);
+    }
+}
+
+
 // ------------------------------------------------------------------ //
 // Tables.
 // ------------------------------------------------------------------ //
@@ -286,6 +308,7 @@ static LTCommandStruct g_ServerCommandStructs[] =
     { "DisableWMPhysics", con_DisableWMPhysics, 0 },
     { "ExhaustMemory", con_ExhaustMemory, 0 },
     { "SpawnObject", con_SpawnObject, 0 },
+    { "ProfileTrace", con_ProfileTrace, 0 },
 	{ "Mem", LTMemConsole, 0 },
 };
 
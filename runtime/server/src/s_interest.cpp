@@ -0,0 +1,171 @@
+#include "bdefs.h"
+
+#include "s_interest.h"
+#include "s_client.h"
+#include "servermgr.h"
+#include "objectmgr.h"
+#include "world_tree.h"
+
+//------------------------------------------------------------------
+//------------------------------------------------------------------
+// Holders and their headers.
+//------------------------------------------------------------------
+//------------------------------------------------------------------
+
+//IWorld holder
+#include "world_server_bsp.h"
+static IWorldServerBSP *world_bsp_server;
+define_holder(IWorldServerBSP, world_bsp_server);
+
+
+// Radius around the client's view position that objects are sent from.
+// 0 sends every object to every client.
+extern float g_CV_ClientRelevanceRadius;
+
+// Objects that go to every client, rebuilt each frame.
+static TRelevantObjectList g_AlwaysRelevantObjects;
+
+
+struct RelevanceFindStruct
+{
+	TRelevantObjectList	*m_pObjects;
+	const LTObject		*m_pClientObject;
+};
+
+
+bool sm_IsAlwaysRelevant(const LTObject *pObject)
+{
+	// Flagged by the game.
+	if (pObject->m_Flags2 & FLAG2_ALWAYSRELEVANT)
+		return true;
+
+	// Normal objects don't have a position anybody cares about.
+	if (pObject->m_ObjectType == OT_NORMAL)
+		return true;
+
+	// Lights can affect what the client sees from outside the radius.
+	if (pObject->m_ObjectType == OT_LIGHT)
+		return true;
+
+	// The world model everything else sits in.
+	if (pObject->IsMainWorldModel())
+		return true;
+
+	// Camera-relative objects live on the always-visible list instead of in the tree.
+	if (pObject->m_Flags & FLAG_REALLYCLOSE)
+		return true;
+
+	// Anything not in the tree can't be found by position.
+	if (!((LTObject*)pObject)->IsInWorldTree())
+		return true;
+
+	return false;
+}
+
+
+void sm_UpdateAlwaysRelevantObjects(ObjectMgr *pObjectMgr)
+{
+	g_AlwaysRelevantObjects.clear();
+
+	if (g_CV_ClientRelevanceRadius <= 0.0f)
+		return;
+
+	for (uint32 i = 0; i < NUM_OBJECTTYPES; i++)
+	{
+		LTLink *pListHead = &pObjectMgr->m_ObjectLists[i].m_Head;
+		for (LTLink *pCur = pListHead->m_pNext; pCur != pListHead; pCur = pCur->m_pNext)
+		{
+			LTObject *pObject = (LTObject*)pCur->m_pData;
+
+			if (sm_IsAlwaysRelevant(pObject))
+				g_AlwaysRelevantObjects.push_back(pObject);
+		}
+	}
+}
+
+
+static void RelevanceFindCallback(WorldTreeObj *pObj, void *pCBUser)
+{
+	if (pObj->GetObjType() != WTObj_DObject)
+		return;
+
+	RelevanceFindStruct *pStruct = (RelevanceFindStruct*)pCBUser;
+	LTObject *pObject = (LTObject*)pObj;
+
+	// These were already added.
+	if ((pObject == pStruct->m_pClientObject) || sm_IsAlwaysRelevant(pObject))
+		return;
+
+	pStruct->m_pObjects->push_back(pObject);
+}
+
+
+void sm_GatherRelevantObjects(ObjectMgr *pObjectMgr, Client *pClient)
+{
+	TRelevantObjectList &aObjects = pClient->m_RelevantObjects;
+	aObjects.clear();
+
+	// Local clients get everything anyway, and without a radius so does everyone else.
+	// CRelevantObjectIter walks the object lists for them.
+	pClient->m_bAllObjectsRelevant = (g_CV_ClientRelevanceRadius <= 0.0f) || !!(pClient->m_ClientFlags & CFLAG_LOCAL);
+	if (pClient->m_bAllObjectsRelevant)
+		return;
+
+	aObjects.insert(aObjects.end(), g_AlwaysRelevantObjects.begin(), g_AlwaysRelevantObjects.end());
+
+	// The client always needs its own object, even when the view is somewhere else.
+	if (pClient->m_pObject && !sm_IsAlwaysRelevant(pClient->m_pObject))
+		aObjects.push_back(pClient->m_pObject);
+
+	// Everything touching the relevance box around the view position.
+	RelevanceFindStruct theStruct;
+	theStruct.m_pObjects = &aObjects;
+	theStruct.m_pClientObject = pClient->m_pObject;
+
+	LTVector vRadius(g_CV_ClientRelevanceRadius, g_CV_ClientRelevanceRadius, g_CV_ClientRelevanceRadius);
+	LTVector boxMin = pClient->m_ViewPos - vRadius;
+	LTVector boxMax = pClient->m_ViewPos + vRadius;
+
+	world_bsp_server->ServerTree()->FindObjectsInBox(&boxMin, &boxMax, RelevanceFindCallback, &theStruct);
+}
+
+
+CRelevantObjectIter::CRelevantObjectIter(ObjectMgr *pObjectMgr, const Client *pClient) :
+	m_pObjectMgr(pObjectMgr),
+	m_pList(pClient->m_bAllObjectsRelevant ? LTNULL : &pClient->m_RelevantObjects),
+	m_iCur(0),
+	m_pListHead(LTNULL),
+	m_pCur(LTNULL)
+{
+	if (!m_pList)
+	{
+		m_pListHead = &m_pObjectMgr->m_ObjectLists[0].m_Head;
+		m_pCur = m_pListHead->m_pNext;
+	}
+}
+
+
+LTObject *CRelevantObjectIter::Next()
+{
+	if (m_pList)
+	{
+		if (m_iCur >= m_pList->size())
+			return LTNULL;
+
+		return (*m_pList)[m_iCur++];
+	}
+
+	// Move on to the next object type whenever one runs out.
+	while (m_pCur == m_pListHead)
+	{
+		if (++m_iCur >= NUM_OBJECTTYPES)
+			return LTNULL;
+
+		m_pListHead = &m_pObjectMgr->m_ObjectLists[m_iCur].m_Head;
+		m_pCur = m_pListHead->m_pNext;
+	}
+
+	LTObject *pObject = (LTObject*)m_pCur->m_pData;
+	m_pCur = m_pCur->m_pNext;
+	return pObject;
+}
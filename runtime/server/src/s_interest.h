@@ -0,0 +1,63 @@
+// ---------------------------------------------------------------
+//
+// s_interest.h
+//
+// Interest management for the client updates.  Rather than walking
+// every object in the world for every client, each client is only
+// given the objects near its view position plus the objects that
+// every client always needs to hear about.
+//
+// ---------------------------------------------------------------
+
+#ifndef __S_INTEREST_H__
+#define __S_INTEREST_H__
+
+#include <vector>
+
+struct Client;
+class ObjectMgr;
+class LTObject;
+class LTLink;
+
+typedef std::vector<LTObject*> TRelevantObjectList;
+
+// Tells if the object goes to every client no matter where it is.  This
+// covers objects that aren't in the world tree (and can't be found by
+// position) as well as objects flagged with FLAG2_ALWAYSRELEVANT.
+bool sm_IsAlwaysRelevant(const LTObject *pObject);
+
+// Rebuilds the list of always relevant objects.  This is called once per
+// frame before the clients are updated.
+void sm_UpdateAlwaysRelevantObjects(ObjectMgr *pObjectMgr);
+
+// Finds the objects relevant to the client and keeps them on the client
+// for CRelevantObjectIter.  If the relevance radius is turned off
+// (ClientRelevanceRadius <= 0) or the client is local, every object is
+// relevant and no list is built.
+void sm_GatherRelevantObjects(ObjectMgr *pObjectMgr, Client *pClient);
+
+// Walks the objects relevant to a client.  That's the client's gathered
+// list, or every object in the object manager in list order when the
+// client gets everything.
+class CRelevantObjectIter
+{
+public:
+	CRelevantObjectIter(ObjectMgr *pObjectMgr, const Client *pClient);
+
+	// Returns the next object, or LTNULL once they've all been seen.
+	LTObject *Next();
+
+private:
+	ObjectMgr					*m_pObjectMgr;
+
+	// The gathered list, or LTNULL if walking the object lists.
+	const TRelevantObjectList	*m_pList;
+
+	// Position in m_pList, or the object type being walked.
+	uint32						m_iCur;
+
+	LTLink						*m_pListHead;
+	LTLink						*m_pCur;
+};
+
+#endif  // __S_INTEREST_H__
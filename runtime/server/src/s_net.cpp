@@ -32,6 +32,7 @@
 #include "server_filemgr.h"
 #include "ltobjectcreate.h"
 #include "ltmessage_server.h"
+#include "zoneprofiler.h"
 
 #include "misctools.h"
 
@@ -135,6 +136,28 @@ LTRESULT OnClientUpdatePacket(CPacket_Read &cPacket, Client *pClient)
 }
 
 
+LTRESULT OnClientUpdateAckPacket(CPacket_Read &cPacket, Client *pClient)
+{
+    if (!pClient)
+        return LT_OK;
+
+	uint16 nSequence = cPacket.Readuint16();
+
+	// Skip acks that came in out of order, and ones for updates we don't
+	// have anymore.
+	if (pClient->m_bUnguaranteedAcked && !nd_IsNewer(nSequence, pClient->m_nUnguaranteedAck))
+		return LT_OK;
+
+	if (!pClient->m_UnguaranteedSnapshots.Find(nSequence))
+		return LT_OK;
+
+	pClient->m_nUnguaranteedAck = nSequence;
+	pClient->m_bUnguaranteedAcked = true;
+
+	return LT_OK;
+}
+
+
 LTRESULT OnClientDisconnectPacket(CPacket_Read &cPacket, Client *pClient)
 {
     if (pClient && pClient->m_ConnectionID)
@@ -373,7 +396,7 @@ void sm_WriteChangedModelFiles(LTObject *pObj, CPacket_Write &cPacket, ObjectCre
 // ----------------------------------------------------------------------- //
 // Writes the model animation info into the packet.
 // ----------------------------------------------------------------------- //
-void WriteAnimInfo(ModelInstance *pInst, CPacket_Write &cPacket)
+void WriteAnimInfo(ModelInstance *pInst, CPacket_Write &cPacket, const NetObjState *pBaseline, NetObjState *pState)
 {
 	for (LTAnimTracker *pTracker = pInst->m_AnimTrackers; pTracker; pTracker=pTracker->GetNext())
     {
@@ -399,11 +422,10 @@ void WriteAnimInfo(ModelInstance *pInst, CPacket_Write &cPacket)
 			}
 			else // We're a user-made tracker
 			{
-				// Are we dirty?
+				// Are we dirty?  (The flag is cleared once every client has been updated)
 				if(pTracker->m_bDirty)
 				{
 					cPacket.Writebool(true);
-					pTracker->m_bDirty = false;
 				}
 				else
 				{
@@ -418,18 +440,6 @@ void WriteAnimInfo(ModelInstance *pInst, CPacket_Write &cPacket)
 		}
 		
 	    uint16 nAnimIndex = (uint16)trk_GetCurAnimIndex(pTracker);
-		bool bLongModelInfo = (nAnimIndex >= (1 << MODELINFO_ANIMINDEX_SHORT)) || ((pTracker->m_Flags & AT_PLAYING) == 0);
-		cPacket.Writebool(bLongModelInfo);
-		if (bLongModelInfo)
-		{
-			cPacket.WriteBits(nAnimIndex, MODELINFO_ANIMINDEX_LONG);
-			cPacket.Writebool((pTracker->m_Flags & AT_PLAYING) != 0);
-		}
-		else
-		{
-			cPacket.WriteBits(nAnimIndex, MODELINFO_ANIMINDEX_SHORT);
-		}
-		cPacket.Writebool((pTracker->m_Flags & AT_LOOPING) != 0);
 
 		//by default it should fall into the first category
 		uint32 animLength		= MODELINFO_ANIMTIME_SIZE0;
@@ -471,8 +481,51 @@ void WriteAnimInfo(ModelInstance *pInst, CPacket_Write &cPacket)
 			}
         }
 
-		cPacket.WriteBits(animLengthType, 2);
-		cPacket.WriteBits(animTime, animLength);
+		// If the main tracker is still playing the same animation as in the
+		// baseline, only the change in time gets sent.
+		bool bDelta = false;
+		if (pState && (pTracker == pInst->m_AnimTrackers))
+		{
+			uint8 nAnimFlags = 0;
+			if (pTracker->m_Flags & AT_PLAYING)
+				nAnimFlags |= NETSTATE_ANIM_PLAYING;
+			if (pTracker->m_Flags & AT_LOOPING)
+				nAnimFlags |= NETSTATE_ANIM_LOOPING;
+
+			bDelta = pBaseline && (pBaseline->m_nFields & NETSTATE_ANIM) &&
+				(pBaseline->m_nAnimIndex == nAnimIndex) &&
+				(pBaseline->m_nAnimFlags == nAnimFlags) &&
+				(pBaseline->m_nAnimTimeType == animLengthType);
+
+			cPacket.Writebool(bDelta);
+			if (bDelta)
+				nd_WriteValue(cPacket, animTime, pBaseline->m_nAnimTime, animLength);
+
+			pState->m_nAnimIndex = nAnimIndex;
+			pState->m_nAnimFlags = nAnimFlags;
+			pState->m_nAnimTimeType = (uint8)animLengthType;
+			pState->m_nAnimTime = animTime & ((animLength < 32) ? ((1 << animLength) - 1) : 0xFFFFFFFF);
+			pState->m_nFields |= NETSTATE_ANIM;
+		}
+
+		if (!bDelta)
+		{
+			bool bLongModelInfo = (nAnimIndex >= (1 << MODELINFO_ANIMINDEX_SHORT)) || ((pTracker->m_Flags & AT_PLAYING) == 0);
+			cPacket.Writebool(bLongModelInfo);
+			if (bLongModelInfo)
+			{
+				cPacket.WriteBits(nAnimIndex, MODELINFO_ANIMINDEX_LONG);
+				cPacket.Writebool((pTracker->m_Flags & AT_PLAYING) != 0);
+			}
+			else
+			{
+				cPacket.WriteBits(nAnimIndex, MODELINFO_ANIMINDEX_SHORT);
+			}
+			cPacket.Writebool((pTracker->m_Flags & AT_LOOPING) != 0);
+
+			cPacket.WriteBits(animLengthType, 2);
+			cPacket.WriteBits(animTime, animLength);
+		}
         
         if (pTracker != pInst->m_AnimTrackers)
         {
@@ -566,6 +619,20 @@ bool FillPacketFromInfo(Client *pClient, LTObject *pObj, ObjInfo *pInfo, CPacket
 	if (!changeFlags)
         return false;
 
+	// Positions and rotations are delta compressed against the last ones
+	// sent.  New objects start over from nothing.
+	const NetObjState *pBaseline = LTNULL;
+	NetObjState cState;
+	if (changeFlags & CF_NEWOBJECT)
+	{
+		nd_ClearState(&cState);
+	}
+	else
+	{
+		pBaseline = &pInfo->m_GuaranteedState;
+		cState = *pBaseline;
+	}
+
     // Write the header.
     if (changeFlags & CF_OTHERFLAGMASK)
     {
@@ -710,11 +777,12 @@ bool FillPacketFromInfo(Client *pClient, LTObject *pObj, ObjInfo *pInfo, CPacket
         {
 			cPacket.WriteLTVector(pObj->GetPos());
 			cPacket.WriteLTVector(vObjectVelocity);
+			cState.m_nFields &= ~(NETSTATE_POS|NETSTATE_VEL);
         }
         else 
 		{
-			CLTMessage_Write_Server::WriteCompPos(cPacket, pObj->GetPos());
-			CLTMessage_Write::WriteCompLTVector(cPacket, vObjectVelocity);
+			CLTMessage_Write_Server::WriteDeltaCompPos(cPacket, pObj->GetPos(), pBaseline, &cState);
+			CLTMessage_Write::WriteDeltaCompLTVector(cPacket, vObjectVelocity, pBaseline, &cState);
         }
     }
 
@@ -724,10 +792,11 @@ bool FillPacketFromInfo(Client *pClient, LTObject *pObj, ObjInfo *pInfo, CPacket
 		if (pObj->m_Flags & FLAG_FULLPOSITIONRES)
         {
 			cPacket.WriteType(pObj->m_Rotation);
+			cState.m_nFields &= ~NETSTATE_ROT;
         }
         else
         {
-			CLTMessage_Write::WriteCompLTRotation(cPacket, pObj->m_Rotation);
+			CLTMessage_Write::WriteDeltaCompLTRotation(cPacket, pObj->m_Rotation, pBaseline, &cState);
         }
     }
 
@@ -767,6 +836,9 @@ bool FillPacketFromInfo(Client *pClient, LTObject *pObj, ObjInfo *pInfo, CPacket
 		cPacket.WriteLTVector(pObj->GetDims());
 	}
 
+	// The client has this now.
+	pInfo->m_GuaranteedState = cState;
+
     return true;
 }
 
@@ -1242,6 +1314,8 @@ LTRESULT ProcessIncomingPacket(Client * pFromClient, const CPacket_Read &cPacket
 // ----------------------------------------------------------------------- //
 
 LTRESULT ProcessIncomingPackets() {
+    PROFILE_ZONE("ProcessPackets")
+
     LTRESULT dResult = LT_OK;
     CPacket_Read cPacket;
 	CBaseConn *pSender;
@@ -1273,6 +1347,7 @@ void InitServerNetHandlers()
 
     g_ServerHandlers[CMSG_GOODBYE].m_Fn = &OnClientDisconnectPacket;
     g_ServerHandlers[CMSG_UPDATE].m_Fn = &OnClientUpdatePacket;
+    g_ServerHandlers[CMSG_UPDATEACK].m_Fn = &OnClientUpdateAckPacket;
     g_ServerHandlers[CMSG_SOUNDUPDATE].m_Fn = &OnSoundUpdatePacket;
     g_ServerHandlers[CMSG_COMMANDSTRING].m_Fn = &OnCommandStringPacket;
     g_ServerHandlers[CMSG_MESSAGE].m_Fn = &OnMessagePacket;
@@ -12,6 +12,7 @@ class CServerEvent;
 struct Client;
 class ModelInstance;
 struct ObjInfo;
+struct NetObjState;
 class CSoundTrack;
 
 extern int32 g_bDebugPackets;
@@ -39,8 +40,10 @@ bool sm_WriteModelFiles(LTObject *pObj, CPacket_Write &cPacket);
 //for sending down of only changed files
 void sm_WriteChangedModelFiles(LTObject *pObj, CPacket_Write &cPacket, ObjectCreateStruct* pStruct);
 
-// Writes the model animation info into the packet.
-void WriteAnimInfo(ModelInstance *pInst, CPacket_Write &cPacket);
+// Writes the model animation info into the packet.  If pState is given, the
+// main tracker is delta compressed against pBaseline and saved in pState.
+void WriteAnimInfo(ModelInstance *pInst, CPacket_Write &cPacket, 
+	const NetObjState *pBaseline = LTNULL, NetObjState *pState = LTNULL);
 
 // Looks at the flags in pInfo and fills the packet with update data.
 // Returns FALSE if no info needed to be sent.
@@ -287,44 +287,90 @@ uint32 sm_GetNewObjectChangeFlags(LTObject *pObject)
 
 
 // ----------------------------------------------------------------------- //
-// Fully updates the object (called once per frame).
+// Runs the animation on a model for this frame.
 // ----------------------------------------------------------------------- //
 
-void FullObjectUpdate(LTObject *pObj)
+void AnimateObject(LTObject *pObj)
 {
-    // Update its server object if its a model instance.
-	if (pObj->m_ObjectType == OT_MODEL)
-    {
-		if(!pObj->IsPaused())
-		{
-			// Use the TrueFrameTime, otherwise the time will notbe synced with the client.
-			// If time is out of sync between client/server, movement breaks.
-			if (g_pServerMgr->m_nTrueFrameTimeMS > 0)
-			{
-				pObj->ToModel()->SetStringKeyCallback(ServerStringKeyCallback);
-				pObj->ToModel()->ServerUpdate(g_pServerMgr->m_nTrueFrameTimeMS);
-			}
-		}
-    }
+	if (pObj->IsPaused())
+		return;
 
-    // Update the object (if the m_NextUpdate countdown has gone past zero).
-    if (pObj->sd->m_NextUpdate > 0.0f)
-    {
-        pObj->sd->m_NextUpdate -= g_pServerMgr->m_FrameTime;
+	// Use the TrueFrameTime, otherwise the time will notbe synced with the client.
+	// If time is out of sync between client/server, movement breaks.
+	if (g_pServerMgr->m_nTrueFrameTimeMS > 0)
+	{
+		pObj->ToModel()->SetStringKeyCallback(ServerStringKeyCallback);
+		pObj->ToModel()->ServerUpdate(g_pServerMgr->m_nTrueFrameTimeMS);
+	}
+}
 
-        if (pObj->sd->m_NextUpdate <= 0.0f)
-        {
-            // Call the update.
-			pObj->sd->m_pObject->OnUpdate();
 
-            // Don't do anything else if it was removed.
-            if (!(pObj->m_InternalFlags & IFLAG_INWORLD))
-                return;
-        }
-    }
+// ----------------------------------------------------------------------- //
+// Object update scheduling.
+// ----------------------------------------------------------------------- //
+
+void sm_SetNextUpdate(LTObject *pObj, float fNextUpdate)
+{
+	pObj->sd->m_NextUpdate = fNextUpdate;
 
-    // Update the object's physics.
-    PhysicsUpdateObject(pObj);
+	// Inactive objects get scheduled when they're activated.
+	if (!(pObj->m_InternalFlags & IFLAG_INACTIVE_MASK))
+	{
+		g_pServerMgr->m_ThinkWheel.Schedule(&pObj->sd->m_ThinkNode, fNextUpdate);
+	}
+}
+
+
+float sm_GetNextUpdate(LTObject *pObj)
+{
+	SThinkNode *pNode = &pObj->sd->m_ThinkNode;
+
+	if (g_pServerMgr->m_ThinkWheel.IsScheduled(pNode))
+	{
+		// Don't let it round down to 0, which would turn its updates off.
+		return LTMAX(g_pServerMgr->m_ThinkWheel.GetTimeLeft(pNode), 0.001f);
+	}
+	else if (!pNode->m_Link.IsTiedOff())
+	{
+		// It's due this frame but hasn't been updated yet.
+		return 0.001f;
+	}
+
+	return pObj->sd->m_NextUpdate;
+}
+
+
+void sm_WakeObject(LTObject *pObj)
+{
+	SObjData *pData = pObj->sd;
+
+	if (!pData || !pData->m_AwakeNode.IsTiedOff())
+		return;
+
+	if (pObj->m_InternalFlags & IFLAG_INACTIVE_MASK)
+		return;
+
+	if ((pObj->m_ObjectType == OT_MODEL) || (pObj->m_InternalFlags & IFLAG_APPLYPHYSICS))
+	{
+		dl_AddTail(&g_pServerMgr->m_AwakeObjects, &pData->m_AwakeNode, pObj);
+	}
+}
+
+
+void sm_SleepObject(LTObject *pObj)
+{
+	LTLink *pNode = &pObj->sd->m_AwakeNode;
+
+	if (pNode->IsTiedOff())
+		return;
+
+	// Don't pull the list out from under PreUpdateObjects.
+	if (g_pServerMgr->m_pAwakeCursor == pNode)
+	{
+		g_pServerMgr->m_pAwakeCursor = pNode->m_pNext;
+	}
+
+	dl_RemoveAt(&g_pServerMgr->m_AwakeObjects, pNode);
 }
 
 
@@ -652,11 +698,24 @@ void sm_SetObjectStateFlags(LTObject *pObj, uint32 flags)
         if (flags)
         {
             dl_AddTail(&g_pServerMgr->m_Objects, &pObj->sd->m_ListNode, pObj);
+
+            // Hold onto the time left until it's activated again.
+            if (!oldFlags)
+            {
+                pObj->sd->m_NextUpdate = sm_GetNextUpdate(pObj);
+                g_pServerMgr->m_ThinkWheel.Unschedule(&pObj->sd->m_ThinkNode);
+                sm_SleepObject(pObj);
+            }
+
 			pObj->sd->m_pObject->OnDeactivate();
         }
         else
         {
             dl_AddHead(&g_pServerMgr->m_Objects, &pObj->sd->m_ListNode, pObj);
+
+            g_pServerMgr->m_ThinkWheel.Schedule(&pObj->sd->m_ThinkNode, pObj->sd->m_NextUpdate);
+            sm_WakeObject(pObj);
+
 			pObj->sd->m_pObject->OnActivate();
         }
     }
@@ -52,8 +52,24 @@ void DeleteModels();
 
 
 
-// Fully updates the object (called once per frame).
-void FullObjectUpdate(LTObject *pObj);
+// Runs the animation on a model for this frame.
+void AnimateObject(LTObject *pObj);
+
+// Runs physics on the object for this frame (if it has IFLAG_APPLYPHYSICS).
+void PhysicsUpdateObject(LTObject *pObj);
+
+// Sets how long until the object's OnUpdate gets called.  <= 0 turns its updates off.
+void sm_SetNextUpdate(LTObject *pObj, float fNextUpdate);
+
+// Gets how long until the object's OnUpdate gets called.  <= 0 if it doesn't update.
+float sm_GetNextUpdate(LTObject *pObj);
+
+// Puts the object on the list of objects visited every frame if it's a
+// model or has IFLAG_APPLYPHYSICS.  Use obj_ApplyPhysics to set the flag.
+void sm_WakeObject(LTObject *pObj);
+
+// Takes the object off the list of objects visited every frame.
+void sm_SleepObject(LTObject *pObj);
 
 // Loads and instantiates objects from the given world file.
 LTRESULT LoadObjects(ILTStream *pStream, const char *pWorldName, bool bAllObjects, uint32 nObjectDataOffset );
@@ -0,0 +1,567 @@
+#include "bdefs.h"
+#include "savesnapshot.h"
+#include "sysstreamsim.h"
+
+#include "zlib.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+
+// How much compressed data is read or written at a time.
+#define SAVE_BUFFER_SIZE		(64 * 1024)
+
+// Savegames are usually at least this big, so start the snapshot here.
+#define SNAPSHOT_INITIAL_SIZE	(256 * 1024)
+
+
+// ------------------------------------------------------------------ //
+// CSaveSnapshot
+// ------------------------------------------------------------------ //
+
+CSaveSnapshot::CSaveSnapshot()
+{
+	m_Data.reserve(SNAPSHOT_INITIAL_SIZE);
+	m_Pos = 0;
+	m_bError = false;
+}
+
+void CSaveSnapshot::Release()
+{
+	delete this;
+}
+
+LTRESULT CSaveSnapshot::Read(void *pData, uint32 size)
+{
+	if (m_bError || size > m_Data.size() - m_Pos)
+	{
+		m_bError = true;
+		memset(pData, 0, size);
+		return LT_ERROR;
+	}
+
+	memcpy(pData, &m_Data[m_Pos], size);
+	m_Pos += size;
+	return LT_OK;
+}
+
+LTRESULT CSaveSnapshot::Write(const void *pData, uint32 size)
+{
+	if (m_Pos + size > m_Data.size())
+	{
+		m_Data.resize(m_Pos + size);
+	}
+
+	memcpy(&m_Data[m_Pos], pData, size);
+	m_Pos += size;
+	return LT_OK;
+}
+
+LTRESULT CSaveSnapshot::ErrorStatus()
+{
+	return m_bError ? LT_ERROR : LT_OK;
+}
+
+LTRESULT CSaveSnapshot::SeekTo(uint32 offset)
+{
+	if (offset > m_Data.size())
+	{
+		m_bError = true;
+		return LT_ERROR;
+	}
+
+	m_Pos = offset;
+	return LT_OK;
+}
+
+LTRESULT CSaveSnapshot::GetPos(uint32 *offset)
+{
+	*offset = m_Pos;
+	return LT_OK;
+}
+
+LTRESULT CSaveSnapshot::GetLen(uint32 *len)
+{
+	*len = (uint32)m_Data.size();
+	return LT_OK;
+}
+
+
+// ------------------------------------------------------------------ //
+// CSaveInflateStream
+// ------------------------------------------------------------------ //
+
+// Reads a compressed savegame, inflating as it goes.  Seeking forward
+// inflates and throws away the data in between.  Seeking back starts over
+// from the beginning, which sm_RestoreObjects only does once.
+class CSaveInflateStream : public CGenLTStream
+{
+public:
+
+				CSaveInflateStream(FILE *pFile, uint32 dataStart, uint32 len);
+
+	bool		Init();
+
+	void		Release();
+
+	LTRESULT	Read(void *pData, uint32 size);
+	LTRESULT	Write(const void *pData, uint32 size);
+	LTRESULT	ErrorStatus();
+	LTRESULT	SeekTo(uint32 offset);
+	LTRESULT	GetPos(uint32 *offset);
+	LTRESULT	GetLen(uint32 *len);
+
+protected:
+
+	// Inflate the next size bytes into pOut.
+	bool		Inflate(uint8 *pOut, uint32 size);
+
+	bool		Rewind();
+
+	FILE		*m_pFile;
+	z_stream	m_Stream;
+	bool		m_bStreamInit;
+
+	// Where the compressed data starts in the file.
+	uint32		m_DataStart;
+
+	// Position and length in the uncompressed data.
+	uint32		m_Pos;
+	uint32		m_Len;
+
+	bool		m_bError;
+
+	uint8		m_InBuffer[SAVE_BUFFER_SIZE];
+};
+
+CSaveInflateStream::CSaveInflateStream(FILE *pFile, uint32 dataStart, uint32 len)
+{
+	m_pFile = pFile;
+	memset(&m_Stream, 0, sizeof(m_Stream));
+	m_bStreamInit = false;
+	m_DataStart = dataStart;
+	m_Pos = 0;
+	m_Len = len;
+	m_bError = false;
+}
+
+bool CSaveInflateStream::Init()
+{
+	m_bStreamInit = inflateInit(&m_Stream) == Z_OK;
+	return m_bStreamInit;
+}
+
+void CSaveInflateStream::Release()
+{
+	if (m_bStreamInit)
+	{
+		inflateEnd(&m_Stream);
+	}
+
+	fclose(m_pFile);
+	delete this;
+}
+
+bool CSaveInflateStream::Inflate(uint8 *pOut, uint32 size)
+{
+	m_Stream.next_out = pOut;
+	m_Stream.avail_out = size;
+
+	while (m_Stream.avail_out != 0)
+	{
+		if (m_Stream.avail_in == 0)
+		{
+			size_t nRead = fread(m_InBuffer, 1, sizeof(m_InBuffer), m_pFile);
+			if (nRead == 0)
+				return false;
+
+			m_Stream.next_in = m_InBuffer;
+			m_Stream.avail_in = (uInt)nRead;
+		}
+
+		int status = inflate(&m_Stream, Z_NO_FLUSH);
+		if (status == Z_STREAM_END)
+		{
+			if (m_Stream.avail_out != 0)
+				return false;
+		}
+		else if (status != Z_OK)
+		{
+			return false;
+		}
+	}
+
+	m_Pos += size;
+	return true;
+}
+
+bool CSaveInflateStream::Rewind()
+{
+	if (inflateReset(&m_Stream) != Z_OK || fseek(m_pFile, m_DataStart, SEEK_SET) != 0)
+		return false;
+
+	m_Stream.avail_in = 0;
+	m_Pos = 0;
+	return true;
+}
+
+LTRESULT CSaveInflateStream::Read(void *pData, uint32 size)
+{
+	if (m_bError || size > m_Len - m_Pos || !Inflate((uint8*)pData, size))
+	{
+		m_bError = true;
+		memset(pData, 0, size);
+		return LT_ERROR;
+	}
+
+	return LT_OK;
+}
+
+LTRESULT CSaveInflateStream::Write(const void *pData, uint32 size)
+{
+	return LT_ERROR;
+}
+
+LTRESULT CSaveInflateStream::ErrorStatus()
+{
+	return m_bError ? LT_ERROR : LT_OK;
+}
+
+LTRESULT CSaveInflateStream::SeekTo(uint32 offset)
+{
+	if (m_bError || offset > m_Len || (offset < m_Pos && !Rewind()))
+	{
+		m_bError = true;
+		return LT_ERROR;
+	}
+
+	uint8 skipBuffer[4096];
+	while (m_Pos < offset)
+	{
+		uint32 nSkip = LTMIN(offset - m_Pos, (uint32)sizeof(skipBuffer));
+		if (!Inflate(skipBuffer, nSkip))
+		{
+			m_bError = true;
+			return LT_ERROR;
+		}
+	}
+
+	return LT_OK;
+}
+
+LTRESULT CSaveInflateStream::GetPos(uint32 *offset)
+{
+	*offset = m_Pos;
+	return LT_OK;
+}
+
+LTRESULT CSaveInflateStream::GetLen(uint32 *len)
+{
+	*len = m_Len;
+	return LT_OK;
+}
+
+
+// ------------------------------------------------------------------ //
+// CSaveWriter
+// ------------------------------------------------------------------ //
+
+// Owns the writer thread.  Jobs stay in the queue until they're written so
+// the ones still in progress can be waited on.
+class CSaveWriter
+{
+public:
+
+				CSaveWriter();
+				~CSaveWriter();
+
+	LTRESULT	Write(const char *pFilename, CSaveSnapshot *pSnapshot);
+	LTRESULT	QueueWrite(const char *pFilename, CSaveSnapshot *pSnapshot);
+	LTRESULT	Flush();
+	void		WaitForFile(const char *pFilename);
+	void		Term();
+
+protected:
+
+	struct SaveJob
+	{
+		std::string		m_Filename;
+		std::string		m_TempFilename;
+		FILE			*m_pFile;
+		CSaveSnapshot	*m_pSnapshot;
+	};
+
+	// Writer thread main loop.
+	void		WriterMain();
+
+	// Waits for any queued write to the file and opens the job's temp file.
+	// Releases the snapshot if the file can't be created.
+	bool		StartJob(const char *pFilename, CSaveSnapshot *pSnapshot, SaveJob &job);
+
+	// Compress the job's snapshot into its temp file and move that over the
+	// savegame.  The old savegame is left alone if anything goes wrong.
+	bool		WriteJob(SaveJob &job, std::vector<uint8> &outBuffer);
+
+	// Is there a queued write to this file?  Call with m_Mutex locked.
+	bool		IsQueued(const char *pFilename) const;
+
+	std::thread					m_Thread;
+	std::mutex					m_Mutex;
+	std::condition_variable		m_JobCondition;
+	std::condition_variable		m_DoneCondition;
+
+	std::deque<SaveJob>			m_Jobs;
+	bool						m_bQuit;
+
+	// Set when a write fails, cleared by Flush.
+	bool						m_bFailed;
+};
+
+static CSaveWriter g_SaveWriter;
+
+
+CSaveWriter::CSaveWriter()
+{
+	m_bQuit = false;
+	m_bFailed = false;
+}
+
+CSaveWriter::~CSaveWriter()
+{
+	Term();
+}
+
+bool CSaveWriter::StartJob(const char *pFilename, CSaveSnapshot *pSnapshot, SaveJob &job)
+{
+	// Only one write to a file at a time since they share the temp file.
+	WaitForFile(pFilename);
+
+	job.m_Filename = pFilename;
+	job.m_TempFilename = job.m_Filename + ".tmp";
+	job.m_pSnapshot = pSnapshot;
+	job.m_pFile = fopen(job.m_TempFilename.c_str(), "wb");
+	if (!job.m_pFile)
+	{
+		pSnapshot->Release();
+		return false;
+	}
+
+	return true;
+}
+
+LTRESULT CSaveWriter::Write(const char *pFilename, CSaveSnapshot *pSnapshot)
+{
+	SaveJob job;
+	if (!StartJob(pFilename, pSnapshot, job))
+		return LT_ERROR;
+
+	std::vector<uint8> outBuffer(SAVE_BUFFER_SIZE);
+	return WriteJob(job, outBuffer) ? LT_OK : LT_ERROR;
+}
+
+LTRESULT CSaveWriter::QueueWrite(const char *pFilename, CSaveSnapshot *pSnapshot)
+{
+	SaveJob job;
+	if (!StartJob(pFilename, pSnapshot, job))
+		return LT_ERROR;
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	if (!m_Thread.joinable())
+	{
+		m_bQuit = false;
+		m_Thread = std::thread(&CSaveWriter::WriterMain, this);
+	}
+
+	m_Jobs.push_back(job);
+	m_JobCondition.notify_one();
+	return LT_OK;
+}
+
+LTRESULT CSaveWriter::Flush()
+{
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	m_DoneCondition.wait(lock, [this] { return m_Jobs.empty(); });
+
+	bool bFailed = m_bFailed;
+	m_bFailed = false;
+	return bFailed ? LT_ERROR : LT_OK;
+}
+
+void CSaveWriter::WaitForFile(const char *pFilename)
+{
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	m_DoneCondition.wait(lock, [this, pFilename] { return !IsQueued(pFilename); });
+}
+
+void CSaveWriter::Term()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_bQuit = true;
+		m_JobCondition.notify_one();
+	}
+
+	if (m_Thread.joinable())
+	{
+		m_Thread.join();
+	}
+}
+
+bool CSaveWriter::IsQueued(const char *pFilename) const
+{
+	for (const SaveJob &job : m_Jobs)
+	{
+		if (job.m_Filename == pFilename)
+			return true;
+	}
+
+	return false;
+}
+
+void CSaveWriter::WriterMain()
+{
+	std::vector<uint8> outBuffer(SAVE_BUFFER_SIZE);
+
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	for (;;)
+	{
+		m_JobCondition.wait(lock, [this] { return m_bQuit || !m_Jobs.empty(); });
+
+		// Finish everything that's queued before quitting.
+		if (m_Jobs.empty())
+			return;
+
+		// Only this thread removes jobs, so the front one stays put while
+		// it's being written.
+		SaveJob &job = m_Jobs.front();
+		lock.unlock();
+		bool bOk = WriteJob(job, outBuffer);
+		lock.lock();
+
+		m_Jobs.pop_front();
+		if (!bOk)
+		{
+			m_bFailed = true;
+		}
+
+		m_DoneCondition.notify_all();
+	}
+}
+
+bool CSaveWriter::WriteJob(SaveJob &job, std::vector<uint8> &outBuffer)
+{
+	uint32 header[3] = { SAVESNAPSHOT_ID, SAVESNAPSHOT_VERSION, job.m_pSnapshot->GetDataLen() };
+	bool bOk = fwrite(header, sizeof(header), 1, job.m_pFile) == 1;
+
+	z_stream stream;
+	memset(&stream, 0, sizeof(stream));
+	bOk = bOk && deflateInit(&stream, Z_DEFAULT_COMPRESSION) == Z_OK;
+	if (bOk)
+	{
+		stream.next_in = (Bytef*)job.m_pSnapshot->GetData();
+		stream.avail_in = job.m_pSnapshot->GetDataLen();
+
+		int status = Z_OK;
+		while (bOk && status != Z_STREAM_END)
+		{
+			stream.next_out = &outBuffer[0];
+			stream.avail_out = (uInt)outBuffer.size();
+
+			status = deflate(&stream, Z_FINISH);
+			if (status != Z_OK && status != Z_STREAM_END)
+			{
+				bOk = false;
+				break;
+			}
+
+			size_t nOut = outBuffer.size() - stream.avail_out;
+			bOk = fwrite(&outBuffer[0], 1, nOut, job.m_pFile) == nOut;
+		}
+
+		deflateEnd(&stream);
+	}
+
+	if (fclose(job.m_pFile) != 0)
+	{
+		bOk = false;
+	}
+
+	job.m_pSnapshot->Release();
+	job.m_pSnapshot = LTNULL;
+
+	if (bOk)
+	{
+		// rename won't replace an existing file everywhere.
+		remove(job.m_Filename.c_str());
+		bOk = rename(job.m_TempFilename.c_str(), job.m_Filename.c_str()) == 0;
+	}
+
+	if (!bOk)
+	{
+		remove(job.m_TempFilename.c_str());
+	}
+
+	return bOk;
+}
+
+
+// ------------------------------------------------------------------ //
+// Interface functions
+// ------------------------------------------------------------------ //
+
+LTRESULT save_Write(const char *pFilename, CSaveSnapshot *pSnapshot)
+{
+	return g_SaveWriter.Write(pFilename, pSnapshot);
+}
+
+LTRESULT save_QueueWrite(const char *pFilename, CSaveSnapshot *pSnapshot)
+{
+	return g_SaveWriter.QueueWrite(pFilename, pSnapshot);
+}
+
+LTRESULT save_FlushWrites()
+{
+	return g_SaveWriter.Flush();
+}
+
+void save_Term()
+{
+	g_SaveWriter.Term();
+}
+
+ILTStream* save_OpenForRestore(const char *pFilename)
+{
+	g_SaveWriter.WaitForFile(pFilename);
+
+	FILE *pFile = fopen(pFilename, "rb");
+	if (!pFile)
+		return LTNULL;
+
+	uint32 header[3];
+	if (fread(header, sizeof(header), 1, pFile) != 1 || header[0] != SAVESNAPSHOT_ID)
+	{
+		// An uncompressed savegame from before snapshots.
+		fclose(pFile);
+		return streamsim_Open(pFilename, "rb");
+	}
+
+	if (header[1] != SAVESNAPSHOT_VERSION)
+	{
+		fclose(pFile);
+		return LTNULL;
+	}
+
+	CSaveInflateStream *pStream;
+	LT_MEM_TRACK_ALLOC(pStream = new CSaveInflateStream(pFile, sizeof(header), header[2]), LT_MEM_TYPE_MISC);
+	if (!pStream->Init())
+	{
+		pStream->Release();
+		return LTNULL;
+	}
+
+	return pStream;
+}
@@ -0,0 +1,72 @@
+// Savegames are saved in two steps.  The objects are first serialized into
+// an in-memory snapshot during the frame, then the snapshot is compressed and
+// written to disk.  Games that ask for it (SAVEOBJECTS_BACKGROUNDWRITE) have
+// the second step done on a writer thread while the game keeps running.
+//
+// Compressed savegames start with a SAVESNAPSHOT_ID header.  Files without
+// one are read as they are, so savegames from older builds still load.
+
+#ifndef __SAVESNAPSHOT_H__
+#define __SAVESNAPSHOT_H__
+
+#ifndef __GENLTSTREAM_H__
+#include "genltstream.h"
+#endif
+
+#include <vector>
+
+
+#define SAVESNAPSHOT_ID			0x56534C4C	// 'LLSV'
+#define SAVESNAPSHOT_VERSION	1
+
+
+// A stream that saves into memory.  Seeking back and overwriting works
+// like it does on a file (sm_SaveObjectData patches in sizes that way).
+class CSaveSnapshot : public CGenLTStream
+{
+public:
+
+				CSaveSnapshot();
+
+	void		Release();
+
+	LTRESULT	Read(void *pData, uint32 size);
+	LTRESULT	Write(const void *pData, uint32 size);
+	LTRESULT	ErrorStatus();
+	LTRESULT	SeekTo(uint32 offset);
+	LTRESULT	GetPos(uint32 *offset);
+	LTRESULT	GetLen(uint32 *len);
+
+	const uint8*	GetData() const		{ return m_Data.empty() ? LTNULL : &m_Data[0]; }
+	uint32			GetDataLen() const	{ return (uint32)m_Data.size(); }
+
+protected:
+
+	std::vector<uint8>	m_Data;
+	uint32				m_Pos;
+	bool				m_bError;
+};
+
+
+// Compresses pSnapshot and writes it to pFilename before returning.  Takes
+// over the snapshot and releases it.
+LTRESULT save_Write(const char *pFilename, CSaveSnapshot *pSnapshot);
+
+// Queues pSnapshot to be compressed and written to pFilename on the writer
+// thread, which takes over the snapshot and releases it when it's done.
+// The file is opened here so this fails right away if it can't be created.
+LTRESULT save_QueueWrite(const char *pFilename, CSaveSnapshot *pSnapshot);
+
+// Waits for all the queued writes to finish.  Returns LT_ERROR if any of
+// them failed since the last flush.
+LTRESULT save_FlushWrites();
+
+// Finishes the queued writes and stops the writer thread.
+void save_Term();
+
+// Opens a savegame for restoring.  Compressed savegames are decompressed
+// as they're read.  Waits for any queued write of the file first.
+ILTStream* save_OpenForRestore(const char *pFilename);
+
+
+#endif  // __SAVESNAPSHOT_H__
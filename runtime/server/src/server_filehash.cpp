@@ -0,0 +1,208 @@
+#include "bdefs.h"
+#include "server_filehash.h"
+#include "sysfile.h"
+#include "iltstream.h"
+#include "sha256.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+
+// How much of a file is read at a time.
+#define FHASH_BUFFER_SIZE		(64 * 1024)
+
+
+// ------------------------------------------------------------------ //
+// CFileHasher
+// ------------------------------------------------------------------ //
+
+class CFileHasher
+{
+public:
+
+				CFileHasher();
+				~CFileHasher();
+
+	bool		GetHash(HLTFileTree *hTree, const char *pFilename, uint32 fileSize, uint8 *pHash);
+	void		Term();
+
+protected:
+
+	struct HashEntry
+	{
+		HLTFileTree		*m_hTree;
+		uint32			m_FileSize;
+		bool			m_bDone;
+		bool			m_bQueued;		// Waiting in m_Jobs.
+		uint8			m_Hash[SHA256_HASH_SIZE];
+	};
+
+	// Hasher thread main loop.
+	void		HasherMain();
+
+	// Reads and hashes the whole file.  Fills in zeros if it can't be read.
+	void		HashFile(HLTFileTree *hTree, const char *pFilename, uint32 fileSize,
+					std::vector<uint8> &buffer, uint8 *pHash);
+
+	std::thread					m_Thread;
+	std::mutex					m_Mutex;
+	std::condition_variable		m_JobCondition;
+
+	// Hashes by filename, finished or not.
+	std::unordered_map<std::string, HashEntry>	m_Hashes;
+
+	// Filenames waiting to be hashed.
+	std::deque<std::string>		m_Jobs;
+	bool						m_bQuit;
+};
+
+static CFileHasher g_FileHasher;
+
+
+CFileHasher::CFileHasher()
+{
+	m_bQuit = false;
+}
+
+CFileHasher::~CFileHasher()
+{
+	Term();
+}
+
+bool CFileHasher::GetHash(HLTFileTree *hTree, const char *pFilename, uint32 fileSize, uint8 *pHash)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	std::unordered_map<std::string, HashEntry>::iterator iEntry = m_Hashes.find(pFilename);
+	if (iEntry != m_Hashes.end() && iEntry->second.m_hTree == hTree && iEntry->second.m_FileSize == fileSize)
+	{
+		if (!iEntry->second.m_bDone)
+			return false;
+
+		memcpy(pHash, iEntry->second.m_Hash, SHA256_HASH_SIZE);
+		return true;
+	}
+
+	// It's new, or the file came from somewhere else last time.
+	HashEntry &entry = (iEntry != m_Hashes.end()) ? iEntry->second : m_Hashes[pFilename];
+	entry.m_hTree = hTree;
+	entry.m_FileSize = fileSize;
+	entry.m_bDone = false;
+	if (!entry.m_bQueued)
+	{
+		entry.m_bQueued = true;
+		m_Jobs.push_back(pFilename);
+	}
+
+	if (!m_Thread.joinable())
+	{
+		m_bQuit = false;
+		m_Thread = std::thread(&CFileHasher::HasherMain, this);
+	}
+
+	m_JobCondition.notify_one();
+	return false;
+}
+
+void CFileHasher::Term()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_bQuit = true;
+		m_Jobs.clear();
+		m_JobCondition.notify_one();
+	}
+
+	if (m_Thread.joinable())
+	{
+		m_Thread.join();
+	}
+
+	m_Hashes.clear();
+}
+
+void CFileHasher::HasherMain()
+{
+	std::vector<uint8> buffer(FHASH_BUFFER_SIZE);
+
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	for (;;)
+	{
+		m_JobCondition.wait(lock, [this] { return m_bQuit || !m_Jobs.empty(); });
+		if (m_bQuit)
+			return;
+
+		std::string filename = m_Jobs.front();
+		m_Jobs.pop_front();
+
+		HashEntry &entry = m_Hashes[filename];
+		entry.m_bQueued = false;
+		HLTFileTree *hTree = entry.m_hTree;
+		uint32 fileSize = entry.m_FileSize;
+
+		uint8 hash[SHA256_HASH_SIZE];
+		lock.unlock();
+		HashFile(hTree, filename.c_str(), fileSize, buffer, hash);
+		lock.lock();
+
+		// If the file changed trees while it was being read, it's been
+		// queued again.  Entries are never removed while the thread runs.
+		HashEntry &doneEntry = m_Hashes[filename];
+		if (doneEntry.m_hTree == hTree && doneEntry.m_FileSize == fileSize)
+		{
+			memcpy(doneEntry.m_Hash, hash, SHA256_HASH_SIZE);
+			doneEntry.m_bDone = true;
+		}
+	}
+}
+
+void CFileHasher::HashFile(HLTFileTree *hTree, const char *pFilename, uint32 fileSize,
+	std::vector<uint8> &buffer, uint8 *pHash)
+{
+	memset(pHash, 0, SHA256_HASH_SIZE);
+
+	ILTStream *pStream = df_Open(hTree, pFilename, 0);
+	if (!pStream)
+		return;
+
+	SHA256Context context;
+	sha256_Init(&context);
+
+	uint32 nBytesLeft = fileSize;
+	while (nBytesLeft)
+	{
+		uint32 readSize = LTMIN(nBytesLeft, (uint32)buffer.size());
+		if (pStream->Read(&buffer[0], readSize) != LT_OK)
+			break;
+
+		sha256_Update(&context, &buffer[0], readSize);
+		nBytesLeft -= readSize;
+	}
+
+	pStream->Release();
+
+	if (nBytesLeft == 0)
+	{
+		sha256_Final(&context, pHash);
+	}
+}
+
+
+// ------------------------------------------------------------------ //
+// Interface functions
+// ------------------------------------------------------------------ //
+
+bool fhash_GetHash(HLTFileTree *hTree, const char *pFilename, uint32 fileSize, uint8 *pHash)
+{
+	return g_FileHasher.GetHash(hTree, pFilename, fileSize, pHash);
+}
+
+void fhash_Term()
+{
+	g_FileHasher.Term();
+}
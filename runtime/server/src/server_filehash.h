@@ -0,0 +1,23 @@
+// Hashes the server's files for the file transfer.  Clients name the files
+// in their transfer cache by content hash, so every file that gets described
+// to a remote client needs one.  Reading and hashing a whole file would stall
+// the frame, so it's done on a worker thread and the result is kept for every
+// other client that connects.
+
+#ifndef __SERVER_FILEHASH_H__
+#define __SERVER_FILEHASH_H__
+
+typedef void* HLTFileTree;
+
+
+// Fills in the file's SHA256_HASH_SIZE byte hash and returns true if it's
+// been hashed.  Otherwise the file is queued on the worker thread and this
+// returns false until it's done.  Files that can't be read hash to all zeros.
+bool fhash_GetHash(HLTFileTree *hTree, const char *pFilename, uint32 fileSize, uint8 *pHash);
+
+// Stops the worker thread and forgets all the hashes.  Call this before the
+// file trees are closed.
+void fhash_Term();
+
+
+#endif  // __SERVER_FILEHASH_H__
@@ -8,6 +8,7 @@
 #include "s_client.h"
 #include "dhashtable.h"
 #include "ftserv.h"
+#include "server_filehash.h"
 
 
 //allocate our IServerFileMgr instance.
@@ -41,6 +42,9 @@ void IServerFileMgr::Init() {
 
 
 void IServerFileMgr::Term() {
+    // The hasher reads from the file trees.
+    fhash_Term();
+
     // Clear out the used file list.
     ClearUsedFiles();
 
@@ -104,7 +104,7 @@ LTRESULT CLTCommonServer::SetObjectFlags(HOBJECT hObj, const ObjFlagType nFlagTy
 	if (nFlagType == OFT_Flags)
 	{
 		// They changed a FLAGS_.
-		hObj->m_InternalFlags |= IFLAG_APPLYPHYSICS;
+		obj_ApplyPhysics(hObj);
 		// If we're going to nonsolid, get rid of anything standing on us.
 		if ((nChangingFlags & FLAG_SOLID) && (nFlags & FLAG_SOLID)) 
 		{
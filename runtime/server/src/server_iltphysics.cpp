@@ -63,7 +63,7 @@ LTRESULT CLTPhysicsServer::SetVelocity(HOBJECT hObj, const LTVector *pVel)
         return LT_OK;
     }
 
-    pObj->m_InternalFlags |= IFLAG_APPLYPHYSICS;
+    obj_ApplyPhysics(pObj);
 
     pObj->m_Velocity = *pVel;
     return LT_OK;
@@ -84,7 +84,7 @@ LTRESULT CLTPhysicsServer::SetAcceleration(HOBJECT hObj, const LTVector *pAccel)
     if (pObj->m_Acceleration.DistSqr(*pAccel) < 0.001f)
         return LT_OK;
 
-    pObj->m_InternalFlags |= IFLAG_APPLYPHYSICS;
+    obj_ApplyPhysics(pObj);
     pObj->m_Acceleration = *pAccel;
     return LT_OK;
 }
@@ -25,6 +25,8 @@
 #include "conparse.h"
 #include "sysstreamsim.h"
 #include "game_serialize.h"
+#include "savesnapshot.h"
+#include "syscounter.h"
 #include "server_interface.h"
 #include "sysdebugging.h"
 
@@ -103,6 +105,7 @@ define_holder_to_instance(ILTPhysics, ilt_physics_server, Server);
 
 
 extern uint32 g_dwSaveFileVersion;
+extern int32 g_CV_ShowSaveTiming;
 
 
 #define MAX_CLASS_HEIRARCHY_LEN 256
@@ -315,6 +318,7 @@ public:
 	virtual LTRESULT SendSFXMessage(ILTMessage_Read *pMsg, const LTVector &pos, uint32 flags);
 	virtual LTRESULT SendToServer(ILTMessage_Read *pMsg, HOBJECT hSender, uint32 flags);
     virtual LTRESULT GetSaveFileVersion( uint32& nSaveFileVersion ) { nSaveFileVersion = g_dwSaveFileVersion; return LT_OK; }
+	virtual LTRESULT FlushSaveObjects() { return save_FlushWrites(); }
 
 
 // Internal.
@@ -2599,7 +2603,7 @@ void si_SetNextUpdate(HOBJECT hObj, LTFLOAT nextUpdate)
 	if (!hObj)
 		return;
 
-	HandleToServerObj(hObj)->sd->m_NextUpdate = nextUpdate;
+	sm_SetNextUpdate(HandleToServerObj(hObj), nextUpdate);
 }
 
 void si_SetObjectState(HOBJECT hObj, int state)
@@ -2941,18 +2945,40 @@ void GPCCallback(WorldTreeObj *pObj, void *pUser)
 
 LTRESULT si_SaveObjects(const char *pszSaveFileName, ObjectList *pList, uint32 dwParam, uint32 flags) 
 {
-	ILTStream *pStream = streamsim_Open(pszSaveFileName, "wb");
-	if (!pStream) 
+	// Capture the objects into memory, then compress the snapshot and write
+	// it out.  The game can have the writer thread do that part.
+	CounterFinal cntCapture(CSTART_MICRO);
+
+	CSaveSnapshot *pSnapshot;
+	LT_MEM_TRACK_ALLOC(pSnapshot = new CSaveSnapshot, LT_MEM_TYPE_MISC);
+	sm_SaveObjects(pSnapshot, pList, dwParam, flags);
+
+	uint32 nCaptureMicro = cntCapture.EndMicro();
+	if (g_CV_ShowSaveTiming)
+	{
+		dsi_ConsolePrint("SaveObjects: captured %d objects (%d KB) in %.2f ms",
+			pList ? pList->m_nInList : 0, pSnapshot->GetDataLen() / 1024, (float)nCaptureMicro / 1000.0f);
+	}
+
+	LTRESULT dResult;
+	if (flags & SAVEOBJECTS_BACKGROUNDWRITE)
+	{
+		dResult = save_QueueWrite(pszSaveFileName, pSnapshot);
+	}
+	else
+	{
+		dResult = save_Write(pszSaveFileName, pSnapshot);
+	}
+
+	if (dResult != LT_OK) 
 		RETURN_ERROR(2, ILTPhysics::SaveObjects, LT_ERROR);
 
-	sm_SaveObjects(pStream, pList, dwParam, flags);
-	pStream->Release();
 	return LT_OK;
 }
 
 LTRESULT si_RestoreObjects(const char *pszRestoreFileName, uint32 dwParam, uint32 flags) 
 {
-	ILTStream *pStream = streamsim_Open(pszRestoreFileName, "rb");
+	ILTStream *pStream = save_OpenForRestore(pszRestoreFileName);
 	if (!pStream) 
 		RETURN_ERROR(2, ILTPhysics::RestoreObjects, LT_ERROR);
 
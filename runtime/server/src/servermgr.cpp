@@ -31,6 +31,8 @@
 #include "server_interface.h"
 #include "server_extradata.h"
 #include "syscounter.h"
+#include "savesnapshot.h"
+#include "zoneprofiler.h"
 #include "soundtrack.h"
 #include "serverde_impl.h"
 #include "smoveabstract.h"
@@ -43,6 +45,10 @@
 #include "soundtrack.h"
 #include "ltobjectcreate.h"
 #include <time.h>
+#include <errno.h>
+#ifdef DE_SERVER_COMPILE
+#include <chrono>
+#endif // DE_SERVER_COMPILE
 #include "ltobjref.h"
 
 
@@ -336,12 +342,10 @@ void sm_UpdateClientStates()
  
 void sm_UpdateClientsInWorld() 
 {
-	LTLink *pListHead = &g_pServerMgr->m_Clients.m_Head;
-	for (LTLink *pCur = pListHead->m_pNext; pCur != pListHead; pCur = pCur->m_pNext) 
-	{
-		Client *pClient = (Client*)pCur->m_pData;
-		sm_UpdateClientInWorld(pClient);
-	}
+	// Find the objects that go to everyone before working out what each client gets.
+	sm_UpdateAlwaysRelevantObjects(&g_pServerMgr->m_ObjectMgr);
+
+	sm_UpdateClientListInWorld(&g_pServerMgr->m_Clients);
 
 	// Clear the send/drop counts
 	g_pServerMgr->m_nSendPackets = 0;
@@ -459,6 +463,9 @@ bool CServerMgr::Init()
 	dl_TieOff(&m_FreeIDs);
 	dl_TieOff(&m_IDs);
 	dl_InitList(&m_Objects);
+	dl_InitList(&m_AwakeObjects);
+	dl_TieOff(&m_DueObjects);
+	m_pAwakeCursor = LTNULL;
 	dl_InitList(&m_Clients);
 	dl_InitList(&m_ClientReferences);
 	dl_InitList(&m_SoundDataList);
@@ -477,7 +484,7 @@ bool CServerMgr::Init()
 	m_LastServerFPS = 0.0f;
 	#ifdef DE_SERVER_COMPILE
 	m_nTargetTimeSteps = 0;
-	m_TargetTimeBase = 0.0f;
+	m_TargetTimeBase = 0.0;
 	#endif // DE_SERVER_COMPILE
 	m_GameTime = 0.0f;
 	m_nTrueFrameTimeMS = 0;
@@ -518,6 +525,9 @@ void CServerMgr::Term()
 		i_server_shell->OnServerTerm();
 	}
 
+	// Finish writing any savegames before the game goes away.
+	save_Term();
+
 	// Free game info.
 	dfree(m_pGameInfo);
 	m_pGameInfo   = LTNULL;
@@ -877,6 +887,28 @@ void sm_MergeClientChangeLists()
 }
 
 
+#ifdef _PROCESS_CLASS_TICKS_
+
+// Adds the time spent updating an object to its class.  The profiler
+// records it as a zone named after the class.
+#define START_OBJECT_TICKS(pObj) \
+	CClassData *pClassData = (CClassData*)(pObj)->sd->m_pClass->m_pInternal[m_ClassMgr.m_ClassIndex]; \
+	CProfileZone cntZone(pClassData->m_ProfileZone); \
+	Counter cntTicks; \
+	cnt_StartCounter(cntTicks);
+
+#define END_OBJECT_TICKS(pObj) \
+	pClassData->UpdateTicks((pObj), cnt_EndCounter(cntTicks));
+
+#else
+
+#define START_OBJECT_TICKS(pObj) \
+	CProfileZone cntZone(((CClassData*)(pObj)->sd->m_pClass->m_pInternal[m_ClassMgr.m_ClassIndex])->m_ProfileZone);
+#define END_OBJECT_TICKS(pObj)
+
+#endif // _PROCESS_CLASS_TICKS_
+
+
 void CServerMgr::PreUpdateObjects()
 {
  
@@ -885,74 +917,106 @@ void CServerMgr::PreUpdateObjects()
 	// Clear tick counts for each class.
 
 	m_ClassMgr.ClearTickCounts();
+
+	if (g_CV_ShowClassTicks)
+	{
+		// Normally we don't care about inactive objects, but for
+		// tracking add these to the list as well.  They're all at
+		// the end of the object list.
+		LTLink *pObjHead = &m_Objects.m_Head;
+		for (LTLink *pObjCur=pObjHead->m_pPrev; pObjCur != pObjHead; pObjCur=pObjCur->m_pPrev)
+		{
+			LTObject *pObj = (LTObject*)pObjCur->m_pData;
+			if (!(pObj->m_InternalFlags & IFLAG_INACTIVE_MASK))
+				break;
+
+			CClassData *pClassData = (CClassData*)pObj->sd->m_pClass->m_pInternal[m_ClassMgr.m_ClassIndex];
+			pClassData->UpdateTicks(pObj, 0 /*no time*/);
+		}
+	}
  
 #endif // _PROCESS_CLASS_TICKS_
 
- 
- 
-	// Call the object init/update functions.
 
-	LTLink* pHead = &m_Objects.m_Head;
-	for (LTLink* pCur=pHead->m_pNext; pCur != pHead;)
+	LTLink *pHead = &m_AwakeObjects.m_Head;
+
+
+	// Animate the models.  This happens before any OnUpdate calls so they
+	// all see this frame's animation state.
+
 	{
-		LTObject* pObj = (LTObject*)pCur->m_pData;
-		pCur=pCur->m_pNext;
+		PROFILE_ZONE("AnimateModels")
 
-		if (pObj->m_InternalFlags & IFLAG_INACTIVE_MASK)
+		m_pAwakeCursor = pHead->m_pNext;
+		while (m_pAwakeCursor != pHead)
 		{
+			LTObject *pObj = (LTObject*)m_pAwakeCursor->m_pData;
+			m_pAwakeCursor = m_pAwakeCursor->m_pNext;
 
-#ifdef _PROCESS_CLASS_TICKS_	
-
-			if (g_CV_ShowClassTicks)
-			{
-				// Normally we don't care about these objects, but for
-				// tracking add these to the list as well...
-				CClassData *pClassData = (CClassData*)pObj->sd->m_pClass->m_pInternal[m_ClassMgr.m_ClassIndex];
-				pClassData->UpdateTicks(pObj, 0 /*no time*/);
-			}
-			else
+			if ((pObj->m_ObjectType == OT_MODEL) && (pObj->m_InternalFlags & IFLAG_INWORLD))
 			{
-				break;
+				START_OBJECT_TICKS(pObj)
+				AnimateObject(pObj);
+				END_OBJECT_TICKS(pObj)
 			}
+		}
+	}
 
-#else  // Normal behavoir
 
-			// Since all inactive objects are at the end, just stop
-			// at the first one.
-			break;
+	// Call OnUpdate on the objects whose next update came due.
 
-#endif // _PROCESS_CLASS_TICKS_
+	{
+		PROFILE_ZONE("OnUpdate")
 
-		}
-		else if (pObj->m_InternalFlags & IFLAG_INWORLD)
+		m_ThinkWheel.Advance(m_FrameTime, &m_DueObjects);
+		while (m_DueObjects.m_pNext != &m_DueObjects)
 		{
+			LTLink *pLink = m_DueObjects.m_pNext;
+			LTObject *pObj = (LTObject*)pLink->m_pData;
+			dl_Remove(pLink);
 
-#ifdef _PROCESS_CLASS_TICKS_
-
-			// Start the counter for this object's update...
+			// Don't update it if it's being removed.
+			if (!(pObj->m_InternalFlags & IFLAG_INWORLD))
+				continue;
 
-			CClassData *pClassData = (CClassData*)pObj->sd->m_pClass->m_pInternal[m_ClassMgr.m_ClassIndex];
-			
-			Counter cntTicks;
-			cnt_StartCounter(cntTicks);
+			// It doesn't update again unless it asks to.
+			pObj->sd->m_NextUpdate = 0.0f;
 
-#endif // _PROCESS_CLASS_TICKS_
+			START_OBJECT_TICKS(pObj)
+			pObj->sd->m_pObject->OnUpdate();
+			END_OBJECT_TICKS(pObj)
+		}
+	}
 
-			
-			// Do the object update...
 
-			FullObjectUpdate(pObj);
-	   	
+	// Run physics on everything that's moving.
 
-#ifdef _PROCESS_CLASS_TICKS_
+	{
+		PROFILE_ZONE("Physics")
 
-			// Update the class tick counters for this object...
+		m_pAwakeCursor = pHead->m_pNext;
+		while (m_pAwakeCursor != pHead)
+		{
+			LTObject *pObj = (LTObject*)m_pAwakeCursor->m_pData;
+			m_pAwakeCursor = m_pAwakeCursor->m_pNext;
 
-			pClassData->UpdateTicks(pObj, cnt_EndCounter(cntTicks));
+			if (!(pObj->m_InternalFlags & IFLAG_INWORLD))
+				continue;
 
-#endif // _PROCESS_CLASS_TICKS_
+			{
+				START_OBJECT_TICKS(pObj)
+				PhysicsUpdateObject(pObj);
+				END_OBJECT_TICKS(pObj)
+			}
 
+			// Once it comes to rest, it isn't visited until something moves it.
+			if ((pObj->m_ObjectType != OT_MODEL) && !(pObj->m_InternalFlags & IFLAG_APPLYPHYSICS))
+			{
+				sm_SleepObject(pObj);
+			}
 		}
+
+		m_pAwakeCursor = LTNULL;
 	}
 
 
@@ -971,6 +1035,8 @@ void CServerMgr::PreUpdateObjects()
 // clears queues, etc.
 void sm_FinishUpdateFrame()
 {
+	PROFILE_ZONE("FinishUpdateFrame")
+
 	// Update client states (get clients into the world that were waiting).
 	sm_UpdateClientStates();
 
@@ -1066,9 +1132,7 @@ void CServerMgr::RemoveSounds()
 
 bool CServerMgr::Update(int32 updateFlags, uint32 nCurTimeMS)
 {
-	#ifdef DE_SERVER_COMPILE
-	static float s_serverSleepSecs = 0.0f;
-	#endif // DE_SERVER_COMPILE
+	PROFILE_ZONE("ServerUpdate")
 
 	int32 nOffsetTimeMS = (int32)nCurTimeMS + m_nTimeOffsetMS;
 
@@ -1100,43 +1164,9 @@ bool CServerMgr::Update(int32 updateFlags, uint32 nCurTimeMS)
 	//ASSERT(m_RemovedObjectHead.m_pNext == &m_RemovedObjectHead);
 	//dl_TieOff(&m_RemovedObjectHead);
 
-#ifdef DE_SERVER_COMPILE
-
-	while (s_serverSleepSecs >= 0.0f )
-	{
-		float timeStart ;
-		if (g_LockServerFPS)
-			timeStart = time_GetTime();
-
-		if (ProcessIncomingPackets() != LT_OK)
-			return false;
-
-		if (g_LockServerFPS)
-		{
-			float timeElapsed = (time_GetTime() - timeStart);
-			if (timeElapsed == 0.0f)
-				timeElapsed = 0.001f; // artificially force it to always take "at least 1 ms"
-			s_serverSleepSecs -= timeElapsed;
-			if (s_serverSleepSecs > 0.0f)
-			{
-				dsi_ServerSleep(1);
-				timeElapsed = (time_GetTime() - timeStart);
-				if (timeElapsed == 0.0f)
-					timeElapsed = 0.001f; // always "at least 1 ms"
-				s_serverSleepSecs -= timeElapsed;
-			}
-		}
-		else
-			break;
-	}
-	s_serverSleepSecs = 0.0f; // reset
-#else
-	
 	if (ProcessIncomingPackets() != LT_OK)
 		return false;
 
-#endif // if DE_SERVER_COMPILE
-
 	if (m_State == SERV_RUNNINGWORLD)
 	{
 		if (updateFlags & UPDATEFLAG_NONACTIVE || m_ServerFlags & SS_PAUSED)
@@ -1154,23 +1184,10 @@ bool CServerMgr::Update(int32 updateFlags, uint32 nCurTimeMS)
 			{
                 i_server_shell->Update( 0.0f );
             }
-
-	 		#ifdef DE_SERVER_COMPILE
-			if (g_LockServerFPS)
-				dsi_ServerSleep((uint32)((1000 >> 1) / g_ServerFPS)); // half a cycle
-  			#endif // DE_SERVER_COMPILE
 		}
 		else
 		{
 			// Do game time steps.
-			if (g_ServerFPS != m_LastServerFPS)
-			{
-				#ifdef DE_SERVER_COMPILE
-				m_TargetTimeBase = curTime; 
-				m_nTargetTimeSteps = 0;
-				#endif // DE_SERVER_COMPILE
-			}
-	
 			m_FrameTime = ((LTCLAMP(m_nTrueFrameTimeMS / 1000.0f, 0.0f, 0.2f)) * g_ServerTimeScale);
 			m_GameTime += m_FrameTime;
 
@@ -1178,37 +1195,24 @@ bool CServerMgr::Update(int32 updateFlags, uint32 nCurTimeMS)
 			// Update the sounds the server controls...
 			// MAG - 2/14/02 - use true frame time
 			// to keep client and server sound calcs in sync
-			UpdateSounds(m_nTrueFrameTimeMS / 1000.0f);
+			{
+				PROFILE_ZONE("UpdateSounds")
+				UpdateSounds(m_nTrueFrameTimeMS / 1000.0f);
+			}
 
 			// Update the server shell.
 			if (i_server_shell != NULL) {
+				PROFILE_ZONE("ServerShellUpdate")
 				i_server_shell->Update(m_FrameTime);
 			}
 
 			// Update the objects.
-			PreUpdateObjects();
-
-			m_nTrueFrameTimeMS = 0; // Reset 
-
-  			#ifdef DE_SERVER_COMPILE
-			if (g_LockServerFPS)
 			{
-				float targetTime = m_TargetTimeBase + (float)m_nTargetTimeSteps / g_ServerFPS;
-				float timeDiff = (targetTime - curTime);
-				if (timeDiff > 0.0f)
-				{
-					if (timeDiff > (1.0f / (3.0f * g_ServerFPS))) // we're ahead of where we need to be and need to wait...
-					{
- 
-						//DebugOut("diff=%.3f, targBase=%3.f, curTime=%.3f, targ=%.3f, catchup=%d\n", timeDiff, m_TargetTimeBase, curTime, targetTime, (int)m_CatchupSteps);
-						s_serverSleepSecs = timeDiff;
-
-					}
-				}
+				PROFILE_ZONE("UpdateObjects")
+				PreUpdateObjects();
 			}
-			m_nTargetTimeSteps += 1;
-  			#endif // DE_SERVER_COMPILE
 
+			m_nTrueFrameTimeMS = 0; // Reset 
 		}
 
 		// Finish the frame.
@@ -1218,13 +1222,6 @@ bool CServerMgr::Update(int32 updateFlags, uint32 nCurTimeMS)
 		// to end a looping sound before it removes it from the client.
 		RemoveSounds();
 	}
-	else
-	{
-  		#ifdef DE_SERVER_COMPILE
-		if (g_LockServerFPS)
-			dsi_ServerSleep((uint32)((1000 >> 1) / g_ServerFPS)); // have a cycle
-  		#endif // DE_SERVER_COMPILE
-	}
 
 	if (g_CV_ShowGameTime)
 	{
@@ -1237,9 +1234,109 @@ bool CServerMgr::Update(int32 updateFlags, uint32 nCurTimeMS)
 		dsi_ConsolePrint("ILTServer::FindObjectsTouchingSphere count: %d", g_SphereFindCount);
 	}
 
+	#ifdef DE_SERVER_COMPILE
+	// Hold the frame rate whether or not a world is running, so an idle
+	// server doesn't spin.  Without LockServerFPS frames are only held to
+	// a minimum length.
+	if (!WaitForNextFrame())
+		return false;
+	#endif // DE_SERVER_COMPILE
+
 	return true;
 }
 
+
+#ifdef DE_SERVER_COMPILE
+
+// The pacing clock, in seconds.
+static double sm_GetPaceTime()
+{
+#ifdef __LINUX
+	timespec cTime;
+	clock_gettime(CLOCK_MONOTONIC, &cTime);
+	return (double)cTime.tv_sec + (double)cTime.tv_nsec * 1.0e-9;
+#else
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// Sleeps until the pacing clock reaches wakeTime.
+static void sm_SleepUntil(double wakeTime)
+{
+#ifdef __LINUX
+	// An absolute deadline doesn't drift however late the thread wakes up
+	// or however often a signal interrupts it.
+	timespec cWake;
+	cWake.tv_sec = (time_t)wakeTime;
+	cWake.tv_nsec = (long)((wakeTime - (double)cWake.tv_sec) * 1.0e9);
+	if (cWake.tv_nsec >= 1000000000L)
+	{
+		++cWake.tv_sec;
+		cWake.tv_nsec -= 1000000000L;
+	}
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &cWake, NULL) == EINTR)
+	{
+	}
+#else
+	double timeLeft = wakeTime - sm_GetPaceTime();
+	if (timeLeft > 0.0)
+		dsi_ServerSleep(LTMAX((uint32)(timeLeft * 1000.0), (uint32)1));
+#endif
+}
+
+bool CServerMgr::WaitForNextFrame()
+{
+	PROFILE_ZONE("WaitForNextFrame")
+
+	// Shortest frame allowed, so a server that isn't locked to
+	// ServerFPS still doesn't spin.
+	const double kMinFrameTime = 0.001;
+
+	// How often packets are read while waiting for the next frame.
+	const double kPacketInterval = 0.005;
+
+	float fps = g_LockServerFPS ? LTMAX(g_ServerFPS, 1.0f) : (float)(1.0 / kMinFrameTime);
+	double frameLen = LTMAX(1.0 / (double)fps, kMinFrameTime);
+	double curTime = sm_GetPaceTime();
+
+	// Start a new timeline when the rate changes.  The deadlines are always
+	// computed from the base so they don't drift.
+	if (fps != m_LastServerFPS)
+	{
+		m_LastServerFPS = fps;
+		m_TargetTimeBase = curTime;
+		m_nTargetTimeSteps = 0;
+	}
+
+	++m_nTargetTimeSteps;
+	double targetTime = m_TargetTimeBase + (double)m_nTargetTimeSteps * frameLen;
+
+	// If we've fallen more than a frame behind (a level load, a hitch),
+	// don't run a burst of frames to catch up.  Just start over from now.
+	if (curTime > targetTime + frameLen)
+	{
+		m_TargetTimeBase = curTime;
+		m_nTargetTimeSteps = 0;
+		return true;
+	}
+
+	while (curTime < targetTime)
+	{
+		// Sleep straight to the deadline, waking up now and then so
+		// packets don't pile up while we wait.
+		double wakeTime = LTMIN(targetTime, curTime + kPacketInterval);
+		sm_SleepUntil(wakeTime);
+
+		curTime = sm_GetPaceTime();
+		if ((curTime < targetTime) && (ProcessIncomingPackets() != LT_OK))
+			return false;
+	}
+
+	return true;
+}
+
+#endif // DE_SERVER_COMPILE
+
 void CServerMgr::GetErrorString(char *pStr, int32 maxLen)
 {
 	LTStrCpy(pStr, m_ErrorString, maxLen);
@@ -1751,10 +1848,13 @@ LTRESULT sm_CreateServerData(ObjectCreateStruct *pStruct,
 	pRet->m_pClass = pClass;
 	pRet->m_pClient = LTNULL;
 	pRet->m_NextUpdate = pStruct->m_NextUpdate;
+	CThinkWheel::InitNode(&pRet->m_ThinkNode, pObject);
+	g_pServerMgr->m_ThinkWheel.Schedule(&pRet->m_ThinkNode, pRet->m_NextUpdate);
 	pRet->m_cSpecialEffectMsg.Clear();
 	pRet->m_pIDLink = LTNULL;
 	pRet->m_ChangeFlags = 0;
 	dl_TieOff(&pRet->m_ChangedNode);
+	pRet->m_AwakeNode.Init2(pObject);
 	pRet->m_NetFlags = 0;
 
 	// Add its name to the hash table.
@@ -1812,6 +1912,10 @@ LTRESULT sm_DestroyServerData(LTObject *pObject)
 	BreakInterLinks(pObject, LINKTYPE_CONTAINER, false);
 	BreakInterLinks(pObject, LINKTYPE_SOUND, false);
 
+	// Take it out of the update lists.
+	g_pServerMgr->m_ThinkWheel.Unschedule(&pObject->sd->m_ThinkNode);
+	sm_SleepObject(pObject);
+
 	dl_RemoveAt(&g_pServerMgr->m_Objects, &pObject->sd->m_ListNode);
 	g_pServerMgr->m_SObjBank.Free(pObject->sd);
 	return LT_OK;
@@ -2398,7 +2502,8 @@ LTRESULT sm_AddObjectToWorld( LPBASECLASS pBaseClass, ClassDef *pClass,
 		return dResult;
 	}
 
-	pObject->m_InternalFlags |= IFLAG_INWORLD | IFLAG_APPLYPHYSICS;
+	pObject->m_InternalFlags |= IFLAG_INWORLD;
+	obj_ApplyPhysics(pObject);
 
 	// Assign the id...
 	pObject->sd->m_pIDLink = pIDLink;
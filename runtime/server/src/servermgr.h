@@ -288,9 +288,15 @@ class CServerMgr : public CNetHandler
 
 		#ifdef DE_SERVER_COMPILE		
 		// Used to lock a stand-alone server to g_ServerFPS (allowing it
-		// to sleep when it gets ahead).
-		float			m_TargetTimeBase;
+		// to sleep when it gets ahead).  Frame N is due at
+		// m_TargetTimeBase + N / g_ServerFPS seconds on the pacing clock.
+		// Unlocked servers are still held to a minimum frame time.
+		double			m_TargetTimeBase;
 		uint32			m_nTargetTimeSteps;
+
+		// Waits until the next frame is due, reading packets while it waits.
+		// Returns false if processing the packets failed.
+		bool			WaitForNextFrame();
 		#endif // DE_SERVER_COMPILE
 
 	//////// Net stuff ///////////////////////////////////////////
@@ -354,6 +360,15 @@ class CServerMgr : public CNetHandler
 		LTLink 			m_IDs;	  // Allocated ID list (m_pData = ID).
 		LTList 			m_Objects;  // All the objects.
 
+		// Schedules the objects' OnUpdate calls.
+		CThinkWheel		m_ThinkWheel;
+		LTLink			m_DueObjects;		// Objects whose OnUpdate is being called this frame.
+
+		// Active objects that need to be visited every frame (models and
+		// anything with IFLAG_APPLYPHYSICS).
+		LTList			m_AwakeObjects;
+		LTLink			*m_pAwakeCursor;	// Next node while m_AwakeObjects is being walked.
+
 		
 		// All the client references (from a saved game).
 		LTList 			m_ClientReferences;
@@ -16,6 +16,10 @@
 
 #include "packet.h"
 
+#ifndef __THINKWHEEL_H__
+#include "thinkwheel.h"
+#endif
+
 class HHashElement;
 struct ClassDef;
 struct Client;
@@ -56,7 +60,8 @@ public:
 	HHashElement    *m_hName;		// LTNULL if the name is "" or set if it has a valid name.
 
 	float			m_NextUpdate;	// If this is <= 0, then it never updates the object.
-										// If it's > 0 and goes to <= 0, then it updates the object.	
+										// While the object is active, the time left lives in m_ThinkNode.
+	SThinkNode		m_ThinkNode;	// Schedules the object's OnUpdate in CServerMgr::m_ThinkWheel.
 	
 	Client			*m_pClient;		// If this is set, this object is a client's object..
 	LPBASECLASS		m_pObject;		// Object type is m_ObjectType.
@@ -84,6 +89,8 @@ public:
 
 	LTLink			m_ChangedNode;	// Used in the linked list of changed objects..
 
+	LTLink			m_AwakeNode;		// In CServerMgr::m_AwakeObjects if it's animating or has physics.
+
 	uint16			m_ChangeFlags;		// Stored during updates.
 	uint16			m_NetFlags;			// Net flags (combination of NETFLAG_ defines).
 };
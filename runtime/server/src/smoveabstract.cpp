@@ -62,7 +62,7 @@ void SMoveAbstract::DoCrush(LTObject *pObject, LTObject *pCrusher)
 
 void SMoveAbstract::PutObjectInContainer(LTObject *pObj, LTObject *pContainer)
 {
-    pObj->m_InternalFlags |= IFLAG_APPLYPHYSICS;
+    obj_ApplyPhysics(pObj);
 
     // Link them together.
     CreateInterLink(pContainer, pObj, LINKTYPE_CONTAINER);
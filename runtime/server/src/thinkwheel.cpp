@@ -0,0 +1,210 @@
+#include "bdefs.h"
+
+#include "thinkwheel.h"
+
+
+// The top level wraps around every this many ticks.
+#define THINKWHEEL_SPAN_MASK	(((uint64)1 << (CThinkWheel::k_nLevelBits * CThinkWheel::k_nLevels)) - 1)
+
+
+CThinkWheel::CThinkWheel()
+{
+	m_fTime = 0.0;
+	m_nCurTick = 1;
+	m_nScheduled = 0;
+
+	for (uint32 iLevel=0; iLevel < k_nLevels; iLevel++)
+	{
+		for (uint32 iSlot=0; iSlot < k_nLevelSlots; iSlot++)
+		{
+			dl_TieOff(&m_Slots[iLevel][iSlot]);
+		}
+	}
+
+	dl_TieOff(&m_Overflow);
+	dl_TieOff(&m_Near);
+}
+
+
+void CThinkWheel::InitNode(SThinkNode *pNode, void *pOwner)
+{
+	pNode->m_Link.Init2(pOwner);
+	pNode->m_fDueTime = -1.0;
+	pNode->m_nDueTick = 0;
+}
+
+
+void CThinkWheel::Schedule(SThinkNode *pNode, float fDelay)
+{
+	Unschedule(pNode);
+
+	if (fDelay <= 0.0f)
+		return;
+
+	pNode->m_fDueTime = m_fTime + (double)fDelay;
+	pNode->m_nDueTick = (uint64)(pNode->m_fDueTime * (double)(1 << k_nTickShift));
+	++m_nScheduled;
+
+	Place(pNode);
+}
+
+
+void CThinkWheel::Unschedule(SThinkNode *pNode)
+{
+	if (!pNode->m_Link.IsTiedOff())
+	{
+		dl_Remove(&pNode->m_Link);
+	}
+
+	if (IsScheduled(pNode))
+	{
+		ASSERT(m_nScheduled > 0);
+		--m_nScheduled;
+		pNode->m_fDueTime = -1.0;
+	}
+}
+
+
+float CThinkWheel::GetTimeLeft(const SThinkNode *pNode) const
+{
+	if (!IsScheduled(pNode))
+		return 0.0f;
+
+	return (float)LTMAX(pNode->m_fDueTime - m_fTime, 0.0);
+}
+
+
+void CThinkWheel::Advance(float fFrameTime, LTLink *pDueList)
+{
+	m_fTime += (double)fFrameTime;
+
+	// Anything left over from the last tick first.
+	CollectDue(&m_Near, pDueList);
+
+	uint64 nLastTick = (uint64)(m_fTime * (double)(1 << k_nTickShift));
+
+	while (m_nCurTick <= nLastTick)
+	{
+		// Nothing left to step through.
+		if (m_nScheduled == 0)
+		{
+			m_nCurTick = nLastTick + 1;
+			break;
+		}
+
+		uint32 iSlot = (uint32)(m_nCurTick & k_nLevelMask);
+
+		// Pull the next block of the levels above down whenever one below wraps.
+		if (iSlot == 0)
+		{
+			if ((m_nCurTick & THINKWHEEL_SPAN_MASK) == 0)
+			{
+				Cascade(&m_Overflow);
+			}
+
+			for (uint32 iLevel=1; iLevel < k_nLevels; iLevel++)
+			{
+				uint32 iLevelSlot = (uint32)((m_nCurTick >> (k_nLevelBits * iLevel)) & k_nLevelMask);
+				Cascade(&m_Slots[iLevel][iLevelSlot]);
+
+				if (iLevelSlot != 0)
+					break;
+			}
+		}
+
+		CollectDue(&m_Slots[0][iSlot], pDueList);
+		++m_nCurTick;
+	}
+}
+
+
+void CThinkWheel::Place(SThinkNode *pNode)
+{
+	LTLink *pList;
+
+	if (pNode->m_nDueTick < m_nCurTick)
+	{
+		// Its tick was already processed, so it's due sometime this tick.
+		pList = &m_Near;
+	}
+	else
+	{
+		uint64 nDelta = pNode->m_nDueTick - m_nCurTick;
+
+		pList = &m_Overflow;
+		for (uint32 iLevel=0; iLevel < k_nLevels; iLevel++)
+		{
+			if (nDelta < ((uint64)1 << (k_nLevelBits * (iLevel + 1))))
+			{
+				uint32 iSlot = (uint32)((pNode->m_nDueTick >> (k_nLevelBits * iLevel)) & k_nLevelMask);
+				pList = &m_Slots[iLevel][iSlot];
+				break;
+			}
+		}
+	}
+
+	dl_Insert(pList->m_pPrev, &pNode->m_Link);
+}
+
+
+void CThinkWheel::Cascade(LTLink *pList)
+{
+	if (pList->IsTiedOff())
+		return;
+
+	LTLink cascadeList;
+	dl_TieOff(&cascadeList);
+	MoveList(pList, &cascadeList);
+
+	while (cascadeList.m_pNext != &cascadeList)
+	{
+		SThinkNode *pNode = (SThinkNode*)cascadeList.m_pNext;
+		dl_Remove(&pNode->m_Link);
+		Place(pNode);
+	}
+}
+
+
+void CThinkWheel::CollectDue(LTLink *pList, LTLink *pDueList)
+{
+	LTLink *pCur, *pNext;
+
+	for (pCur=pList->m_pNext; pCur != pList; pCur=pNext)
+	{
+		pNext = pCur->m_pNext;
+
+		SThinkNode *pNode = (SThinkNode*)pCur;
+		if (pNode->m_fDueTime <= m_fTime)
+		{
+			dl_Remove(pCur);
+			dl_Insert(pDueList->m_pPrev, pCur);
+
+			pNode->m_fDueTime = -1.0;
+			--m_nScheduled;
+		}
+		else if (pList != &m_Near)
+		{
+			// Only happens on the last tick, which the clock is partway through.
+			dl_Remove(pCur);
+			dl_Insert(m_Near.m_pPrev, pCur);
+		}
+	}
+}
+
+
+void CThinkWheel::MoveList(LTLink *pFrom, LTLink *pTo)
+{
+	if (pFrom->IsTiedOff())
+		return;
+
+	// Splice the whole list onto the end of pTo.
+	LTLink *pFirst = pFrom->m_pNext;
+	LTLink *pLast = pFrom->m_pPrev;
+
+	pFirst->m_pPrev = pTo->m_pPrev;
+	pTo->m_pPrev->m_pNext = pFirst;
+	pLast->m_pNext = pTo;
+	pTo->m_pPrev = pLast;
+
+	dl_TieOff(pFrom);
+}
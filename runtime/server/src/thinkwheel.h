@@ -0,0 +1,102 @@
+// ---------------------------------------------------------------
+//
+// thinkwheel.h
+//
+// A hierarchical timing wheel for scheduling object updates.  Each
+// frame only the entries that have come due are touched, rather than
+// counting down every object in the world.
+//
+// Time is kept in ticks of 1/256th of a second.  The first level has
+// one slot per tick, and each level above it covers 64 times as much
+// time as the one below.  As time passes, the entries in the higher
+// levels cascade down into the lower ones until they land in the
+// first level and come due.
+//
+// ---------------------------------------------------------------
+
+#ifndef __THINKWHEEL_H__
+#define __THINKWHEEL_H__
+
+#ifndef __LTLINK_H__
+#include "ltlink.h"
+#endif
+
+
+// A node in the wheel.  This is embedded in whatever is being scheduled.
+struct SThinkNode
+{
+	LTLink			m_Link;			// m_pData is the owner.
+	double			m_fDueTime;		// Wheel time it's due at.  < 0 if it's not in the wheel.
+	uint64			m_nDueTick;		// m_fDueTime in ticks.
+};
+
+
+class CThinkWheel
+{
+public:
+
+	enum
+	{
+		k_nTickShift	= 8,						// 256 ticks per second.
+		k_nLevelBits	= 6,
+		k_nLevelSlots	= (1 << k_nLevelBits),
+		k_nLevelMask	= (k_nLevelSlots - 1),
+		k_nLevels		= 4,						// Covers 2^24 ticks (about 18 hours).
+	};
+
+					CThinkWheel();
+
+	// Sets up the node.  It starts out unscheduled.
+	static void		InitNode(SThinkNode *pNode, void *pOwner);
+
+	// Schedules the node to come due fDelay seconds from now.  If it's
+	// already scheduled, it's moved.  A delay <= 0 unschedules it.
+	void			Schedule(SThinkNode *pNode, float fDelay);
+
+	// Takes the node out of the wheel (or out of the due list it was put on).
+	void			Unschedule(SThinkNode *pNode);
+
+	bool			IsScheduled(const SThinkNode *pNode) const	{ return pNode->m_fDueTime >= 0.0; }
+
+	// How long until the node is due.  0 if it's not scheduled.
+	float			GetTimeLeft(const SThinkNode *pNode) const;
+
+	// Moves the clock forward and moves everything that came due onto
+	// pDueList, in the order it came due.  The nodes on pDueList are no
+	// longer scheduled; the caller should remove them as it goes.
+	void			Advance(float fFrameTime, LTLink *pDueList);
+
+	// The number of scheduled nodes.
+	uint32			GetNumScheduled() const		{ return m_nScheduled; }
+
+private:
+
+	// Puts a scheduled node in the right slot for m_nCurTick.
+	void			Place(SThinkNode *pNode);
+
+	// Re-places everything in the list.
+	void			Cascade(LTLink *pList);
+
+	// Moves everything in the list that's due onto the due list.
+	void			CollectDue(LTLink *pList, LTLink *pDueList);
+
+	static void		MoveList(LTLink *pFrom, LTLink *pTo);
+
+	double			m_fTime;		// The current wheel time.
+	uint64			m_nCurTick;		// The next tick to be processed.  Everything before it has been.
+	uint32			m_nScheduled;
+
+	// The slots for each level.
+	LTLink			m_Slots[k_nLevels][k_nLevelSlots];
+
+	// Nodes too far out for the top level.  These are re-placed each time
+	// the top level wraps around.
+	LTLink			m_Overflow;
+
+	// Nodes whose tick has been processed but that aren't due yet because
+	// the clock is partway through it.
+	LTLink			m_Near;
+};
+
+
+#endif  // __THINKWHEEL_H__
@@ -2491,7 +2491,7 @@ void DoObjectCollisionResponse
 			pInfo->m_vForce += force;
 		}
 
-		request.m_pObject->m_InternalFlags |= IFLAG_APPLYPHYSICS;
+		obj_ApplyPhysics(request.m_pObject);
 
 
 		// Stop their velocity on this plane!
@@ -2552,13 +2552,13 @@ void DoInterObjectCollisionResponse(MoveAbstract *pAbstract,
 	// Stop their velocities and apply the collision to their acceleration.
 	if(vDotN[0] < 0.0f && (pObj1->m_BPriority <= pObj2->m_BPriority))
 	{
-		pObj1->m_InternalFlags |= IFLAG_APPLYPHYSICS;
+		obj_ApplyPhysics(pObj1);
 		pObj1->m_Velocity += velAdd[0];
 	}
 
 	if(vDotN[1] < 0.0f && (pObj2->m_BPriority <= pObj1->m_BPriority))
 	{
-		pObj2->m_InternalFlags |= IFLAG_APPLYPHYSICS;
+		obj_ApplyPhysics(pObj2);
 		pObj2->m_Velocity += velAdd[1];
 	}
 }
@@ -25,6 +25,9 @@ int32	g_CV_CursorCenter = LTTRUE;	// Automatically resets the cursor to the cent
 int32	g_CV_VideoDebug = LTFALSE;
 
 int32	g_CV_DebugLoaders = LTFALSE; // Debug output for loader threads?
+int32	g_CV_LoaderThreads = 2;		// Worker threads reading files for the background loader
+float	g_CV_LoaderFinishBudget = 4.0f;	// ms per frame spent turning loaded files into models/textures/sounds
+int32	g_CV_ModelUpdateThreads = 0;	// threads used to animate client models (0 = one per hardware thread)
 
 
 int32	g_CV_STracePackets = LTFALSE;
@@ -197,6 +200,11 @@ int32 g_CV_IPClientPortMRU = 0;			// most-recently-used client port
 
 int32 g_CV_BandwidthTargetClient = 256000; // client send bandwidth target in bits-per-second (n/a for local unless "ForceRemote" is set)
 int32 g_CV_BandwidthTargetServer = 256000; // server send bandwidth target in bits-per-second (n/a for local unless "ForceRemote" is set)
+float g_CV_ClientRelevanceRadius = 0.0f;	// only send objects within this distance of a client's view position (0 sends everything)
+int32 g_CV_ServerUpdateThreads = 0;		// threads used to build client updates (0 = one per hardware thread)
+int32 g_CV_ShowSaveTiming = 0;			// print how long SaveObjects spends capturing the objects
+int32 g_CV_ProfileZones = 0;			// record profiler zones (see zoneprofiler.h)
+int32 g_CV_DeltaUnguaranteed = 1;		// delta compress unguaranteed updates against what the client acknowledged (see netdelta.h)
 
 int32 g_CV_NewPlayerPhysics = 1;	// Use the new player physics
 
@@ -226,6 +234,9 @@ static LTEngineVar g_LTEngineVars[] =
 
 	EV_LONG("VideoDebug", &g_CV_VideoDebug),
 	EV_LONG("DebugLoaders", &g_CV_DebugLoaders),
+	EV_LONG("LoaderThreads", &g_CV_LoaderThreads),
+	EV_FLOAT("LoaderFinishBudget", &g_CV_LoaderFinishBudget),
+	EV_LONG("ModelUpdateThreads", &g_CV_ModelUpdateThreads),
 	EV_LONG("MeasurePackets", &g_CV_MeasurePackets),
 	
 	EV_LONG("STracePackets", &g_CV_STracePackets),
@@ -332,6 +343,11 @@ static LTEngineVar g_LTEngineVars[] =
 		
 	EV_LONG("BandwidthTargetClient", &g_CV_BandwidthTargetClient), // in bytes-per-sec
 	EV_LONG("BandwidthTargetServer", &g_CV_BandwidthTargetServer), // in bytes-per-sec
+	EV_FLOAT("ClientRelevanceRadius", &g_CV_ClientRelevanceRadius),
+	EV_LONG("ServerUpdateThreads", &g_CV_ServerUpdateThreads),
+	EV_LONG("ShowSaveTiming", &g_CV_ShowSaveTiming),
+	EV_LONG("ProfileZones", &g_CV_ProfileZones),
+	EV_LONG("DeltaUnguaranteed", &g_CV_DeltaUnguaranteed),
 
 	#ifdef DE_SERVER_COMPILE
 	EV_FLOAT("ServerFPS", &g_ServerFPS),						 // server frames-per-second
@@ -1,12 +1,23 @@
-
 // Defines all the base file transfer stuff like packet IDs.
 
 #ifndef __FTBASE_H__
 #define __FTBASE_H__
 
 
-// How many file transfer blocks get sent before we wait for an ack packet?
-#define NUM_UNVERIFIED_BLOCKS   6
+// How much file data goes in each block (before compression).  The net layer
+// splits guaranteed packets bigger than MAX_PACKET_LEN, so blocks can be a lot
+// bigger than one UDP packet.
+#define FT_BLOCK_SIZE           8192
+
+// How many blocks can be sent before they're acked.  The server grows the
+// window while acks come back quickly and shrinks it when they slow down
+// (meaning the blocks are queueing up somewhere).
+#define FT_MIN_WINDOW           2
+#define FT_INITIAL_WINDOW       4
+#define FT_MAX_WINDOW           64
+
+// File data block flags.
+#define FTBLOCK_COMPRESSED      (1<<0)  // The data is zlib compressed.
 
 
 #define PACKETID_FTBASE     50
@@ -15,10 +26,12 @@
 // Server telling client about a file.
 //     WORD: file ID
 //     DWORD: file size
+//     SHA256_HASH_SIZE BYTEs: content hash (SHA-256 of the file, all zeros if
+//         the server didn't compute it)
 //     string: filename
 #define STC_FILEDESC            (PACKETID_FTBASE+0)
 
-// Start a file transferring.
+// Start a file transferring.  Its blocks follow.
 //     WORD: file ID
 #define STC_STARTTRANSFER       (PACKETID_FTBASE+1)
 
@@ -26,14 +39,20 @@
 #define STC_CANCELFILETRANSFER  (PACKETID_FTBASE+2)
 
 // File data block.
+//     DWORD: block sequence number (counts up for the whole connection)
+//     BYTE: FTBLOCK_ flags
+//     WORD: uncompressed size
+//     WORD: data size
+//     data
 #define STC_FILEBLOCK           (PACKETID_FTBASE+3)
-                            
+
 
 // Telling if we need a file.
 //     WORD: file ID, high bit says if we have it or not.
 #define CTS_FILESTATUS          (PACKETID_FTBASE+4)
 
 // Client acknowledging data blocks.
+//     DWORD: sequence number of the next block it expects
 #define CTS_DATARECEIVED        (PACKETID_FTBASE+6)
 
 
@@ -4,6 +4,16 @@
 #include "packet.h"
 #include "ftbase.h"
 #include "netmgr.h"
+#include "sha256.h"
+
+#include "zlib.h"
+
+#include <map>
+#include <string>
+#include <sys/stat.h>
+#ifndef __LINUX
+#include <direct.h>
+#endif
 
 //------------------------------------------------------------------
 //------------------------------------------------------------------
@@ -26,21 +36,248 @@ define_holder(IClientFileMgr, client_file_mgr);
 // Structures.
 // ----------------------------------------------------------------------- //
 
+// A file the server told us about that needs to be transferred.
+struct FTCFile
+{
+    std::string     m_Filename;
+    uint32          m_FileSize;
+    uint8           m_ContentHash[SHA256_HASH_SIZE];
+};
+
 struct FTClient
 {
     // The current file we're transferring.
-    void            *m_pCurFile;
+    FILE            *m_pCurFile;
     uint16          m_CurFileID;
+    uint32          m_nCurBytesLeft;
+    SHA256Context   m_CurHash;
+
+    // The files we're waiting for, by ID.
+    std::map<uint16, FTCFile>   m_WantedFiles;
     
     // All the function pointers.
     FTCInitStruct   m_Init;
+    std::string     m_CacheDir;
 
     void            *m_pUserData1;
+
+    uint8           m_PackedBlock[FT_BLOCK_SIZE];
+    uint8           m_RawBlock[FT_BLOCK_SIZE];
 };
 
 // Only used by the clienthack stuff.
 static FTClient *g_pFTClient=LTNULL;
 
+// What the current file is called while it's being transferred.
+#define FTC_DOWNLOAD_FILENAME   "download.tmp"
+
+
+// ----------------------------------------------------------------------- //
+// Internal helpers.
+// ----------------------------------------------------------------------- //
+
+static std::string ftc_GetCachePath(FTClient *pClient, const char *pFilename)
+{
+    return pClient->m_CacheDir + "/" + pFilename;
+}
+
+
+// Files in the cache are named by their hash and size, so if one's
+// there with the right size, it's the one we want.
+static bool ftc_IsInCache(FTClient *pClient, const char *pCacheFilename, uint32 fileSize)
+{
+    struct stat info;
+    if (stat(ftc_GetCachePath(pClient, pCacheFilename).c_str(), &info) != 0)
+        return false;
+
+    return (uint32)info.st_size == fileSize;
+}
+
+
+// Throw away whatever we have of the current file.
+static void ftc_AbortFile(FTClient *pClient)
+{
+    if (!pClient->m_pCurFile)
+        return;
+
+    fclose(pClient->m_pCurFile);
+    pClient->m_pCurFile = LTNULL;
+    remove(ftc_GetCachePath(pClient, FTC_DOWNLOAD_FILENAME).c_str());
+}
+
+
+// The whole file is here.  Move it into the cache and tell the file manager.
+static void ftc_FinishFile(FTClient *pClient)
+{
+    fclose(pClient->m_pCurFile);
+    pClient->m_pCurFile = LTNULL;
+
+    std::map<uint16, FTCFile>::iterator iFile = pClient->m_WantedFiles.find(pClient->m_CurFileID);
+    if (iFile == pClient->m_WantedFiles.end())
+        return;
+
+    FTCFile &file = iFile->second;
+    std::string downloadPath = ftc_GetCachePath(pClient, FTC_DOWNLOAD_FILENAME);
+
+    uint8 hash[SHA256_HASH_SIZE];
+    sha256_Final(&pClient->m_CurHash, hash);
+    if (memcmp(hash, file.m_ContentHash, SHA256_HASH_SIZE) != 0)
+    {
+        dsi_ConsolePrint("File transfer of %s failed (bad checksum)", file.m_Filename.c_str());
+        remove(downloadPath.c_str());
+        pClient->m_WantedFiles.erase(iFile);
+        return;
+    }
+
+    char cacheFilename[FTC_CACHE_FILENAME_LEN];
+    ftc_GetCacheFilename(file.m_ContentHash, file.m_FileSize, cacheFilename, sizeof(cacheFilename));
+
+    std::string cachePath = ftc_GetCachePath(pClient, cacheFilename);
+    remove(cachePath.c_str());
+    if (rename(downloadPath.c_str(), cachePath.c_str()) == 0)
+    {
+        client_file_mgr->OnNewFile(pClient, file.m_Filename.c_str(), file.m_FileSize, pClient->m_CurFileID, cacheFilename);
+    }
+
+    pClient->m_WantedFiles.erase(iFile);
+}
+
+
+static void ftc_OnFileDesc(FTClient *pClient, CPacket_Read &cPacket_Incoming)
+{
+	CPacket_Write cPacket_Response;
+	bool bRespond = false;
+	cPacket_Response.Writeuint8(CTS_FILESTATUS);
+
+	while (!cPacket_Incoming.EOP())
+	{
+		uint32 nFileID = cPacket_Incoming.Readuint16();
+		uint32 nFileSize = cPacket_Incoming.Readuint32();
+		uint8 aContentHash[SHA256_HASH_SIZE];
+		cPacket_Incoming.ReadData(aContentHash, SHA256_HASH_SIZE * 8);
+		char aFileName[MAX_PATH];
+		cPacket_Incoming.ReadString(aFileName, sizeof(aFileName));
+
+        bool bHasHash = false;
+        for (uint32 i = 0; i < SHA256_HASH_SIZE; i++)
+        {
+            if (aContentHash[i])
+                bHasHash = true;
+        }
+
+        char aCacheFileName[FTC_CACHE_FILENAME_LEN];
+        const char *pCacheFileName = LTNULL;
+        if (bHasHash)
+        {
+            ftc_GetCacheFilename(aContentHash, nFileSize, aCacheFileName, sizeof(aCacheFileName));
+            if (ftc_IsInCache(pClient, aCacheFileName, nFileSize))
+                pCacheFileName = aCacheFileName;
+        }
+
+        int status = client_file_mgr->OnNewFile(pClient, aFileName, nFileSize, nFileID, pCacheFileName);
+        if (status == NF_DONTHAVEFILE && !bHasHash)
+        {
+            // It can't be cached without a hash, so don't bother.
+            dsi_ConsolePrint("Unable to find server file: %s", aFileName);
+            status = NF_HAVEFILE;
+        }
+
+        if (status == NF_HAVEFILE)
+        {
+            nFileID |= 0x8000;
+        }
+        else
+        {
+            FTCFile &file = pClient->m_WantedFiles[(uint16)nFileID];
+            file.m_Filename = aFileName;
+            file.m_FileSize = nFileSize;
+            memcpy(file.m_ContentHash, aContentHash, SHA256_HASH_SIZE);
+        }
+
+        cPacket_Response.Writeuint16((uint16)nFileID);
+		bRespond = true;
+    }
+
+	if (bRespond)
+    {
+		pClient->m_Init.m_pNetMgr->SendPacket(CPacket_Read(cPacket_Response), pClient->m_Init.m_ConnID);
+    }
+}
+
+
+static void ftc_OnStartTransfer(FTClient *pClient, CPacket_Read &cPacket_Incoming)
+{
+    ftc_AbortFile(pClient);
+
+    pClient->m_CurFileID = cPacket_Incoming.Readuint16();
+
+    std::map<uint16, FTCFile>::iterator iFile = pClient->m_WantedFiles.find(pClient->m_CurFileID);
+    if (iFile == pClient->m_WantedFiles.end())
+        return;
+
+    // If this fails, the blocks are just dropped.
+    pClient->m_pCurFile = fopen(ftc_GetCachePath(pClient, FTC_DOWNLOAD_FILENAME).c_str(), "wb");
+    pClient->m_nCurBytesLeft = iFile->second.m_FileSize;
+    sha256_Init(&pClient->m_CurHash);
+
+    if (pClient->m_pCurFile && pClient->m_nCurBytesLeft == 0)
+        ftc_FinishFile(pClient);
+}
+
+
+static void ftc_OnFileBlock(FTClient *pClient, CPacket_Read &cPacket_Incoming)
+{
+    uint32 nSeq = cPacket_Incoming.Readuint32();
+    uint8 nBlockFlags = cPacket_Incoming.Readuint8();
+    uint32 nRawSize = cPacket_Incoming.Readuint16();
+    uint32 nDataSize = cPacket_Incoming.Readuint16();
+
+    // Ack it right away so the server can keep its window moving.
+    CPacket_Write cPacket_Ack;
+    cPacket_Ack.Writeuint8(CTS_DATARECEIVED);
+    cPacket_Ack.Writeuint32(nSeq + 1);
+    pClient->m_Init.m_pNetMgr->SendPacket(CPacket_Read(cPacket_Ack), pClient->m_Init.m_ConnID);
+
+    if (!pClient->m_pCurFile)
+        return;
+
+    if (nRawSize > FT_BLOCK_SIZE || nDataSize > FT_BLOCK_SIZE || nRawSize > pClient->m_nCurBytesLeft)
+    {
+        ftc_AbortFile(pClient);
+        return;
+    }
+
+    const uint8 *pData = pClient->m_RawBlock;
+    if (nBlockFlags & FTBLOCK_COMPRESSED)
+    {
+        cPacket_Incoming.ReadData(pClient->m_PackedBlock, nDataSize * 8);
+
+        uLongf nUnpackedSize = nRawSize;
+        if (uncompress(pClient->m_RawBlock, &nUnpackedSize, pClient->m_PackedBlock, nDataSize) != Z_OK ||
+            nUnpackedSize != nRawSize)
+        {
+            ftc_AbortFile(pClient);
+            return;
+        }
+    }
+    else
+    {
+        cPacket_Incoming.ReadData(pClient->m_RawBlock, nRawSize * 8);
+    }
+
+    if (fwrite(pData, 1, nRawSize, pClient->m_pCurFile) != nRawSize)
+    {
+        ftc_AbortFile(pClient);
+        return;
+    }
+
+    sha256_Update(&pClient->m_CurHash, pData, nRawSize);
+    pClient->m_nCurBytesLeft -= nRawSize;
+
+    if (pClient->m_nCurBytesLeft == 0)
+        ftc_FinishFile(pClient);
+}
+
 
 // ----------------------------------------------------------------------- //
 // Interface functions.
@@ -50,11 +287,23 @@ FTClient *ftc_Init(FTCInitStruct *pStruct)
 {
     FTClient *pClient;
     
-    LT_MEM_TRACK_ALLOC(pClient = (FTClient*)dalloc(sizeof(FTClient)),LT_MEM_TYPE_MISC);
+    LT_MEM_TRACK_ALLOC(pClient = new FTClient, LT_MEM_TYPE_MISC);
     if (pClient)
     {
-        memset(pClient, 0, sizeof(FTClient));
+        pClient->m_pCurFile = LTNULL;
+        pClient->m_CurFileID = 0;
+        pClient->m_nCurBytesLeft = 0;
+        sha256_Init(&pClient->m_CurHash);
+        pClient->m_pUserData1 = LTNULL;
         memcpy(&pClient->m_Init, pStruct, sizeof(FTCInitStruct));
+
+        pClient->m_CacheDir = pStruct->m_pCacheDir ? pStruct->m_pCacheDir : ".";
+#ifdef __LINUX
+        mkdir(pClient->m_CacheDir.c_str(), 0755);
+#else
+        _mkdir(pClient->m_CacheDir.c_str());
+#endif
+
         g_pFTClient = pClient;
     }
     
@@ -67,7 +316,8 @@ void ftc_Term(FTClient *pClient)
     if (!pClient)
         return;
 
-    dfree(pClient);
+    ftc_AbortFile(pClient);
+    delete pClient;
     g_pFTClient = LTNULL;
 }
 
@@ -102,33 +352,31 @@ void ftc_ProcessPacket(FTClient *pClient, const CPacket_Read &cPacket)
 
 	cPacket_Incoming.SeekTo(0);
 	
-	if (cPacket_Incoming.Readuint8() != STC_FILEDESC)
-		return;
-
-	CPacket_Write cPacket_Response;
-	bool bRespond = false;
-	cPacket_Response.Writeuint8(CTS_FILESTATUS);
-
-	while (!cPacket_Incoming.EOP())
+	switch (cPacket_Incoming.Readuint8())
 	{
-		uint32 nFileID = cPacket_Incoming.Readuint16();
-		uint32 nFileSize = cPacket_Incoming.Readuint32();
-		char aFileName[MAX_PATH];
-		cPacket_Incoming.ReadString(aFileName, sizeof(aFileName));
+		case STC_FILEDESC :
+			ftc_OnFileDesc(pClient, cPacket_Incoming);
+			break;
+		case STC_STARTTRANSFER :
+			ftc_OnStartTransfer(pClient, cPacket_Incoming);
+			break;
+		case STC_CANCELFILETRANSFER :
+			ftc_AbortFile(pClient);
+			break;
+		case STC_FILEBLOCK :
+			ftc_OnFileBlock(pClient, cPacket_Incoming);
+			break;
+	}
+}
 
-        if (client_file_mgr->OnNewFile(pClient, aFileName, nFileSize, nFileID) == NF_HAVEFILE)
-        {
-            nFileID |= 0x8000;
-        }
 
-        cPacket_Response.Writeuint16((uint16)nFileID);
-		bRespond = true;
-    }
-
-	if (bRespond)
+void ftc_GetCacheFilename(const uint8 *pContentHash, uint32 fileSize, char *pOut, uint32 outLen)
+{
+    char hashString[SHA256_HASH_SIZE * 2 + 1];
+    for (uint32 i = 0; i < SHA256_HASH_SIZE; i++)
     {
-		pClient->m_Init.m_pNetMgr->SendPacket(CPacket_Read(cPacket_Response), pClient->m_Init.m_ConnID);
+        LTSNPrintF(&hashString[i * 2], 3, "%02X", pContentHash[i]);
     }
-}
-
 
+    LTSNPrintF(pOut, outLen, "%s%08X.ltc", hashString, fileSize);
+}
@@ -9,6 +9,10 @@
 
 // You will be notified when a file transfer is complete.
 
+// Transferred files are kept in a cache directory, named by their content
+// hash, so if the server (or any other server) uses the same file again
+// later, it doesn't need to be transferred again.
+
 // The file transfer client also maintains a map from file IDs to filenames,
 // so when the server is referencing files, it can send WORDs for the file
 // IDs instead of sending entire filenames.
@@ -41,6 +45,7 @@ struct FTCInitStruct
 {
     CNetMgr     *m_pNetMgr;
     CBaseConn   *m_ConnID;  // Who we're talking to.
+    const char  *m_pCacheDir;   // Where transferred files go.  Created if it doesn't exist.
 };
 
 
@@ -57,6 +62,13 @@ void ftc_SetUserData1(FTClient *hClient, void *pUser);
 void ftc_Update(FTClient *hClient);
 void ftc_ProcessPacket(FTClient *hClient, const CPacket_Read &cPacket);
 
+// Big enough for any cache filename.
+#define FTC_CACHE_FILENAME_LEN  80
+
+// The name (relative to the cache directory) a file with this content
+// (its SHA256_HASH_SIZE byte hash) is stored under.
+void ftc_GetCacheFilename(const uint8 *pContentHash, uint32 fileSize, char *pOut, uint32 outLen);
+
 
 #endif  // __FTCLIENT_H__
 
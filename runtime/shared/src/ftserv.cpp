@@ -6,6 +6,9 @@
 #include "packet.h"
 #include "ftbase.h"
 #include "netmgr.h"
+#include "sha256.h"
+
+#include "zlib.h"
 
 
 // ----------------------------------------------------------------------- //
@@ -16,6 +19,11 @@
 #define FTSTATE_NONE			0
 #define FTSTATE_TRANSFERRING	1
 
+// When a block's round trip takes this much longer than the shortest one
+// we've seen, the blocks are queueing up and the window shrinks.
+#define FTS_RTT_BACKOFF_SCALE	2.0f
+#define FTS_RTT_BACKOFF_SLACK	0.05f
+
 // ----------------------------------------------------------------------- //
 // Structures.
 // ----------------------------------------------------------------------- //
@@ -28,6 +36,7 @@ struct FTFile
 	uint32		m_FileSize;
 	const char*	m_Filename;
 	uint16		m_Flags;
+	uint32		m_AckSeq;		// Once the client acks up to this, it has the whole file.
 };
 
 
@@ -47,17 +56,17 @@ struct FTServ
 	// How many total files are there?
 	int			m_nTotalFiles;
 
+	// How many files have FFLAG_HASHWAIT set?
+	int			m_nHashWaits;
+
 	// Current state (states defined in ftserv.cpp).
 	int			m_State;
 
 	// Flags for how we're operating.
 	uint32		m_ServerFlags;
 
-	// The maximum transfer rate.
-	float		m_BytesPerSecond;
-
-	// Time delta since the last packet was sent.
-	float		m_TimeDelta;
+	// Time since the server was created (the sum of the update deltas).
+	double		m_Time;
 
 	// The init structure is just copied over into here.
 	FTSInitStruct	m_InitStruct;
@@ -68,8 +77,25 @@ struct FTServ
 	// Info about the current file transfer.
 	ILTStream	*m_pCurFileStream;
 	FTFile		*m_pCurFile;
-	uint32		m_nUnverifiedBlocks;
 	uint32		m_nBytesLeft;
+
+	// Block sequence numbers.  Everything before m_AckedSeq has been acked.
+	uint32		m_NextSeq;
+	uint32		m_AckedSeq;
+
+	// How many blocks can be unacked (between FT_MIN_WINDOW and FT_MAX_WINDOW).
+	float		m_Window;
+	bool		m_bSlowStart;		// Double the window each round trip until the first backoff.
+	uint32		m_BackoffSeq;		// Don't back off again until this block is acked.
+
+	// The shortest round trip seen so far (< 0 until there is one).
+	float		m_MinRTT;
+
+	// When each unacked block was sent, indexed by sequence % FT_MAX_WINDOW.
+	double		m_SendTimes[FT_MAX_WINDOW];
+
+	uint8		m_RawBlock[FT_BLOCK_SIZE];
+	uint8		m_PackedBlock[FT_BLOCK_SIZE];
 };
 
 
@@ -86,7 +112,7 @@ static FTFile* fts_FindFileToSend(FTServ *pServ)
 	{
 		pFile = (FTFile*)pCur->m_pData;
 
-		if( (pFile->m_Flags & FFLAG_CLIENTWANTS) )
+		if( (pFile->m_Flags & FFLAG_CLIENTWANTS) && !(pFile->m_Flags & FFLAG_TRANSFERRING) )
 		{
 			return pFile;
 		}
@@ -118,86 +144,232 @@ static void fts_RemoveFile(FTServ *pServ, FTFile *pFile)
 	--pServ->m_nTotalFiles;
 	if(pFile->m_Flags & FFLAG_NEEDED)
 		--pServ->m_nNeededFiles;
+	if(pFile->m_Flags & FFLAG_HASHWAIT)
+		--pServ->m_nHashWaits;
 
 	dl_Remove(&pFile->m_Link);
 	pServ->m_FTFileBank.Free(pFile);
 }
 
 
-static void fts_MaybeSendDataBlock(FTServ *pServ)
+// Remove the files the client has acked all of.
+static void fts_RemoveAckedFiles(FTServ *pServ)
 {
-	ASSERT(pServ->m_State == FTSTATE_TRANSFERRING);
-	ASSERT(pServ->m_pCurFileStream);
+	LTLink *pCur, *pNext;
+	FTFile *pFile;
 
-	if(pServ->m_nUnverifiedBlocks == NUM_UNVERIFIED_BLOCKS)
+	for(pCur=pServ->m_Files.m_pNext; pCur != &pServ->m_Files; pCur=pNext)
 	{
-		// Ok, wait for an ack packet before sending more.
-		return;
+		pNext = pCur->m_pNext;
+
+		pFile = (FTFile*)pCur->m_pData;
+		if((pFile->m_Flags & FFLAG_WAITINGFORACK) && pFile->m_AckSeq <= pServ->m_AckedSeq)
+		{
+			fts_RemoveFile(pServ, pFile);
+		}
 	}
+}
 
-	// Are we ready to send off another data block?
-	uint32 sendSize = MAX_PACKET_LEN - 40;
 
-	float bytesPerSecond = (float)sendSize / pServ->m_TimeDelta;
-	if(bytesPerSecond > pServ->m_BytesPerSecond)
+// Called when a file can't be opened or read.  Returns false if the server
+// should stop trying to send files for now.
+static bool fts_HandleCantOpenFile(FTServ *pServ, FTFile *pFile)
+{
+	int todo = pServ->m_InitStruct.m_CantOpenFileFn(pServ, pFile->m_Filename);
+	if(todo == TODO_REMOVEFILE)
 	{
-		return;
+		fts_RemoveFile(pServ, pFile);
+		return true;
 	}
 
-	uint8 tempData[MAX_PACKET_LEN];
-	bool bDone = false;
+	return false;
+}
 
-	// Ok, send out a packet!
-	CPacket_Write cDataPacket;
-	cDataPacket.Writeuint8(STC_FILEBLOCK);
 
-	if(sendSize >= pServ->m_nBytesLeft)
+static bool fts_StartFile(FTServ *pServ, FTFile *pFile)
+{
+	ILTStream *pStream = pServ->m_InitStruct.m_OpenFn(pServ, pFile->m_Filename);
+	if(!pStream)
+		return fts_HandleCantOpenFile(pServ, pFile);
+
+	// Cooooool, start the transfer.
+	pFile->m_Flags |= FFLAG_TRANSFERRING;
+	pServ->m_pCurFile = pFile;
+	pServ->m_pCurFileStream = pStream;
+	pServ->m_State = FTSTATE_TRANSFERRING;
+	pServ->m_nBytesLeft = pFile->m_FileSize;
+
+	CPacket_Write cPacket;
+	cPacket.Writeuint8(STC_STARTTRANSFER);
+	cPacket.Writeuint16((uint16)pFile->m_FileID);
+	pServ->m_InitStruct.m_pNetMgr->SendPacket(CPacket_Read(cPacket), pServ->m_InitStruct.m_ConnID);
+	return true;
+}
+
+
+// The whole current file has been sent.  It stays in the list until the
+// client acks the last of it.
+static void fts_FinishFile(FTServ *pServ)
+{
+	FTFile *pFile = pServ->m_pCurFile;
+
+	pServ->m_InitStruct.m_CloseFn(pServ, pServ->m_pCurFileStream);
+	pServ->m_pCurFileStream = LTNULL;
+	pServ->m_pCurFile = LTNULL;
+	pServ->m_State = FTSTATE_NONE;
+
+	pFile->m_Flags |= FFLAG_WAITINGFORACK;
+	pFile->m_AckSeq = pServ->m_NextSeq;
+
+	fts_RemoveAckedFiles(pServ);
+}
+
+
+// Sends the next block of the current file.  Returns false if the file
+// couldn't be read.
+static bool fts_SendDataBlock(FTServ *pServ)
+{
+	ASSERT(pServ->m_State == FTSTATE_TRANSFERRING);
+	ASSERT(pServ->m_pCurFileStream);
+
+	uint32 rawSize = LTMIN(pServ->m_nBytesLeft, (uint32)FT_BLOCK_SIZE);
+	if(pServ->m_pCurFileStream->Read(pServ->m_RawBlock, rawSize) != LT_OK)
+		return false;
+
+	// Only send it compressed if that makes it smaller.  compress2 fails
+	// if the output doesn't fit in the buffer, which is just as good.
+	uint8 blockFlags = 0;
+	const uint8 *pData = pServ->m_RawBlock;
+	uLongf dataSize = sizeof(pServ->m_PackedBlock);
+
+	if(compress2(pServ->m_PackedBlock, &dataSize, pServ->m_RawBlock, rawSize, Z_BEST_SPEED) == Z_OK &&
+		dataSize < rawSize)
+	{
+		blockFlags |= FTBLOCK_COMPRESSED;
+		pData = pServ->m_PackedBlock;
+	}
+	else
 	{
-		bDone = true;
-		sendSize = pServ->m_nBytesLeft;
+		dataSize = rawSize;
 	}
 
-	// Send the block.
-	pServ->m_pCurFileStream->Read(tempData, sendSize);
-	cDataPacket.WriteData(tempData, (uint16)sendSize);
+	CPacket_Write cDataPacket;
+	cDataPacket.Writeuint8(STC_FILEBLOCK);
+	cDataPacket.Writeuint32(pServ->m_NextSeq);
+	cDataPacket.Writeuint8(blockFlags);
+	cDataPacket.Writeuint16((uint16)rawSize);
+	cDataPacket.Writeuint16((uint16)dataSize);
+	cDataPacket.WriteData(pData, (uint32)dataSize * 8);
 	pServ->m_InitStruct.m_pNetMgr->SendPacket(CPacket_Read(cDataPacket), pServ->m_InitStruct.m_ConnID);
 
-	// If this file transfer is done, then cleanup.
-	if(bDone)
+	pServ->m_SendTimes[pServ->m_NextSeq % FT_MAX_WINDOW] = pServ->m_Time;
+	++pServ->m_NextSeq;
+	pServ->m_nBytesLeft -= rawSize;
+
+	return true;
+}
+
+
+// Grows or shrinks the window based on how long the last acked block took.
+static void fts_AdjustWindow(FTServ *pServ, float roundTrip, uint32 nAcked)
+{
+	if(pServ->m_MinRTT < 0.0f || roundTrip < pServ->m_MinRTT)
+		pServ->m_MinRTT = roundTrip;
+
+	if(roundTrip > pServ->m_MinRTT * FTS_RTT_BACKOFF_SCALE + FTS_RTT_BACKOFF_SLACK)
 	{
-		fts_RemoveFile(pServ, pServ->m_pCurFile);
-		pServ->m_pCurFile = LTNULL;
-		
-		pServ->m_InitStruct.m_CloseFn(pServ, pServ->m_pCurFileStream);
-		pServ->m_pCurFileStream = LTNULL;
+		// Blocks are queueing up.  Back off, but only once per window's
+		// worth of blocks since the ones already sent will be late too.
+		if(pServ->m_AckedSeq > pServ->m_BackoffSeq)
+		{
+			pServ->m_Window = LTMAX(pServ->m_Window * 0.5f, (float)FT_MIN_WINDOW);
+			pServ->m_bSlowStart = false;
+			pServ->m_BackoffSeq = pServ->m_NextSeq;
+		}
+	}
+	else if(pServ->m_bSlowStart)
+	{
+		pServ->m_Window += (float)nAcked;
+	}
+	else
+	{
+		// About one more block per round trip.
+		pServ->m_Window += (float)nAcked / pServ->m_Window;
 	}
 
-	++pServ->m_nUnverifiedBlocks;
-	pServ->m_TimeDelta = 0;
+	pServ->m_Window = LTMIN(pServ->m_Window, (float)FT_MAX_WINDOW);
 }
 
 
 inline int fts_FileDescLen(FTFile *pFile)
 {
-	return sizeof(uint16) + sizeof(uint32) + (int)strlen(pFile->m_Filename);
+	return sizeof(uint16) + sizeof(uint32) + SHA256_HASH_SIZE + (int)strlen(pFile->m_Filename);
 }
 
 
-inline void fts_WriteFileDesc(FTServ *pServ, FTFile *pFile, CPacket_Write &cPacket)
+// Adds the file's description to the packet.  If its hash isn't ready yet,
+// the file is marked FFLAG_HASHWAIT and this returns false.
+static bool fts_WriteFileDesc(FTServ *pServ, FTFile *pFile, CPacket_Write &cPacket)
 {
+	uint8 hash[SHA256_HASH_SIZE];
+
+	// The client uses the hash to find the file in its cache.  The local
+	// client already has all our files, so it doesn't bother.
+	if((pServ->m_ServerFlags & FTSFLAG_LOCAL) || !pServ->m_InitStruct.m_GetHashFn)
+	{
+		memset(hash, 0, sizeof(hash));
+	}
+	else if(!pServ->m_InitStruct.m_GetHashFn(pServ, pFile->m_Filename, pFile->m_FileSize, hash))
+	{
+		if(!(pFile->m_Flags & FFLAG_HASHWAIT))
+		{
+			pFile->m_Flags |= FFLAG_HASHWAIT;
+			++pServ->m_nHashWaits;
+		}
+		return false;
+	}
+
+	if(pFile->m_Flags & FFLAG_HASHWAIT)
+	{
+		pFile->m_Flags &= ~FFLAG_HASHWAIT;
+		--pServ->m_nHashWaits;
+	}
+
 	if (cPacket.Empty())
 		cPacket.Writeuint8(STC_FILEDESC);
 	cPacket.Writeuint16((uint16)pFile->m_FileID);
 	cPacket.Writeuint32(pFile->m_FileSize);
+	cPacket.WriteData(hash, SHA256_HASH_SIZE * 8);
 	cPacket.WriteString(pFile->m_Filename);
+	return true;
 }
 
 
 inline void fts_SendFileDesc(FTServ *pServ, FTFile *pFile)
 {
 	CPacket_Write cPacket;
-	fts_WriteFileDesc(pServ, pFile, cPacket);
-	pServ->m_InitStruct.m_pNetMgr->SendPacket(CPacket_Read(cPacket), pServ->m_InitStruct.m_ConnID);
+	if(fts_WriteFileDesc(pServ, pFile, cPacket))
+		pServ->m_InitStruct.m_pNetMgr->SendPacket(CPacket_Read(cPacket), pServ->m_InitStruct.m_ConnID);
+}
+
+
+// Sends the descriptions of the files whose hashes have come in since the
+// last update, all in one packet.
+static void fts_SendHashedFileDescs(FTServ *pServ)
+{
+	CPacket_Write cPacket;
+
+	for(LTLink *pCur = pServ->m_Files.m_pNext; pCur != &pServ->m_Files; pCur = pCur->m_pNext)
+	{
+		FTFile *pFile = (FTFile*)pCur->m_pData;
+		if(pFile->m_Flags & FFLAG_HASHWAIT)
+			fts_WriteFileDesc(pServ, pFile, cPacket);
+	}
+
+	if (!cPacket.Empty())
+	{
+		pServ->m_InitStruct.m_pNetMgr->SendPacket(CPacket_Read(cPacket), pServ->m_InitStruct.m_ConnID);
+	}
 }
 
 
@@ -213,14 +385,20 @@ FTServ *fts_Init(FTSInitStruct *pStruct, uint32 flags)
 
 	pRet->m_nNeededFiles = 0;
 	pRet->m_nTotalFiles = 0;
+	pRet->m_nHashWaits = 0;
 	pRet->m_State = 0;
 	pRet->m_ServerFlags = flags;
-	pRet->m_TimeDelta = 0.0f;
+	pRet->m_Time = 0.0;
 	pRet->m_UserData1 = LTNULL;
 	pRet->m_pCurFileStream = LTNULL;
 	pRet->m_pCurFile = LTNULL;
-	pRet->m_nUnverifiedBlocks = 0;
 	pRet->m_nBytesLeft = 0;
+	pRet->m_NextSeq = 0;
+	pRet->m_AckedSeq = 0;
+	pRet->m_Window = (float)FT_INITIAL_WINDOW;
+	pRet->m_bSlowStart = true;
+	pRet->m_BackoffSeq = 0;
+	pRet->m_MinRTT = -1.0f;
 
 	pRet->m_Strings.SetAllocSize(4096);
 	LT_MEM_TRACK_ALLOC(pRet->m_FTFileBank.Init(128, 128), LT_MEM_TYPE_MISC);
@@ -228,7 +406,6 @@ FTServ *fts_Init(FTSInitStruct *pStruct, uint32 flags)
 	memcpy(&pRet->m_InitStruct, pStruct, sizeof(FTSInitStruct));
 	dl_TieOff(&pRet->m_Files);
 	pRet->m_State = FTSTATE_NONE;
-	pRet->m_BytesPerSecond = 100000.0f; // Basically, send as fast as possible.
 
 	// This was being reset causing models to be loaded more than once in single
 	// player games... contact Peter Higley if this causes a problem
@@ -311,6 +488,7 @@ int fts_AddFile(FTServ *pServ, const char *pFilename, uint32 fileSize, uint32 fi
 	pFile->m_FileID = fileID;
 	pFile->m_FileSize = fileSize;
 	pFile->m_Filename = pFilename;
+	pFile->m_AckSeq = 0;
 
 	if(pFile->m_Flags & FFLAG_NEEDED)
 	{
@@ -423,7 +601,7 @@ bool fts_ProcessPacket(FTServ *pServ, const CPacket_Read &cPacket)
 				nFileID &= ~0x8000;
 
 				FTFile *pFile = fts_FindFileByID(pServ, nFileID);
-				if(pFile)
+				if(pFile && !(pFile->m_Flags & FFLAG_TRANSFERRING))
 				{
 					if(bClientHasFile)
 						fts_RemoveFile(pServ, pFile);
@@ -435,9 +613,16 @@ bool fts_ProcessPacket(FTServ *pServ, const CPacket_Read &cPacket)
 		}
 		case CTS_DATARECEIVED :
 		{
-			if(pServ->m_State == FTSTATE_TRANSFERRING)
-				pServ->m_nUnverifiedBlocks = 0;
+			uint32 nextSeq = cPacket_Input.Readuint32();
+			if(nextSeq <= pServ->m_AckedSeq || nextSeq > pServ->m_NextSeq)
+				break;
 
+			uint32 nAcked = nextSeq - pServ->m_AckedSeq;
+			float roundTrip = (float)(pServ->m_Time - pServ->m_SendTimes[(nextSeq - 1) % FT_MAX_WINDOW]);
+
+			pServ->m_AckedSeq = nextSeq;
+			fts_AdjustWindow(pServ, roundTrip, nAcked);
+			fts_RemoveAckedFiles(pServ);
 			break;
 		}
 		default : 
@@ -451,21 +636,24 @@ bool fts_ProcessPacket(FTServ *pServ, const CPacket_Read &cPacket)
 void fts_Update(FTServ *pServ, float timeDelta)
 {
 	FTFile *pFile;
-	ILTStream *pStream;
-	int todo;
-	
 
 	if(!pServ)
 		return;
-	
-	// What's our state?
-	if(pServ->m_State == FTSTATE_NONE)
+
+	pServ->m_Time += (double)timeDelta;
+
+	if(pServ->m_nHashWaits)
+		fts_SendHashedFileDescs(pServ);
+
+	// Keep the window full, moving on to the next file as each one is sent.
+	while(pServ->m_NextSeq - pServ->m_AckedSeq < (uint32)pServ->m_Window)
 	{
-		// Do we have any files that need to be sent?
-		pFile = fts_FindFileToSend(pServ);
-		if(pFile)
+		if(pServ->m_State == FTSTATE_NONE)
 		{
-			pServ->m_TimeDelta = 0.0f;
+			// Do we have any files that need to be sent?
+			pFile = fts_FindFileToSend(pServ);
+			if(!pFile)
+				return;
 
 			// If they don't want us to send files at all right now, don't,
 			if(pServ->m_ServerFlags & FTSFLAG_DONTSENDANYTHING)
@@ -479,42 +667,30 @@ void fts_Update(FTServ *pServ, float timeDelta)
 				{
 					return;
 				}
-			}			   
-
-			pStream = pServ->m_InitStruct.m_OpenFn(pServ, pFile->m_Filename);
-			if(pStream)
-			{
-				// Cooooool, start the transfer.
-				pFile->m_Flags |= FFLAG_TRANSFERRING;
-				pServ->m_pCurFile = pFile;
-				pServ->m_pCurFileStream = pStream;
-				pServ->m_State = FTSTATE_TRANSFERRING;
-				pServ->m_nUnverifiedBlocks = 0;
-				pServ->m_nBytesLeft = pFile->m_FileSize;
-			}
-			else
-			{
-				todo = pServ->m_InitStruct.m_CantOpenFileFn(pServ, pFile->m_Filename);
-				if(todo == TODO_REMOVEFILE)
-				{
-					dl_Remove(&pFile->m_Link);
-					pServ->m_FTFileBank.Free(pFile);
-				}
-				else if(todo == TODO_RETURN)
-				{
-					return;
-				}
 			}
+
+			if(!fts_StartFile(pServ, pFile))
+				return;
+
+			continue;
 		}
-	}
-	else if(pServ->m_State == FTSTATE_TRANSFERRING)
-	{
-		pServ->m_TimeDelta += timeDelta;
 
-		fts_MaybeSendDataBlock(pServ);
-	}
-}
+		if(pServ->m_nBytesLeft && !fts_SendDataBlock(pServ))
+		{
+			// Couldn't read it.  Tell the client to drop what it has.
+			pFile = pServ->m_pCurFile;
+			fts_StopTransfer(pServ);
 
+			if(!fts_HandleCantOpenFile(pServ, pFile))
+				return;
 
+			continue;
+		}
 
+		if(pServ->m_nBytesLeft == 0)
+		{
+			fts_FinishFile(pServ);
+		}
+	}
+}
 
@@ -22,7 +22,9 @@ enum {
                                 // doesn't send a separate packet for each file.
     FFLAG_CLIENTWANTS = (1<<1), // The client requested this file to be sent.
                                 // (intentionally the same as FFLAG_SENDWAIT)
-    FFLAG_TRANSFERRING = (1<<2) // This file is currently being transferred.
+    FFLAG_TRANSFERRING = (1<<2), // This file is currently being transferred.
+    FFLAG_WAITINGFORACK = (1<<3), // All of it has been sent, waiting for the client to ack it.
+    FFLAG_HASHWAIT  =   (1<<4)  // Its description goes out once m_GetHashFn has its hash.
 };
 
 
@@ -56,6 +58,12 @@ struct FTSInitStruct
     // Called when a file can't be opened.  Return a TODO number (defined above).
     int (*m_CantOpenFileFn)(FTServ *hServ, const char *pFilename);
 
+    // Fills in the file's SHA256_HASH_SIZE byte content hash (all zeros if it
+    // can't be read).  Hashing a file can take a while, so this should start
+    // it somewhere else and return false until it's done.  The server asks
+    // again each update.
+    bool (*m_GetHashFn)(FTServ *hServ, const char *pFilename, uint32 fileSize, uint8 *pHash);
+
     CNetMgr         *m_pNetMgr; 
     CBaseConn       *m_ConnID; // Who we're talking to.
 };
@@ -86,7 +94,8 @@ uint32 fts_GetNumTotalFiles(FTServ *hServ);
 // stores the pointer instead of using up more memory.
 int fts_AddFile(FTServ *hServ, const char *pFilename, uint32 fileSize, uint32 fileID, uint16 flags);
 
-// Send out all the info for files with FFLAG_SENDWAIT.
+// Send out all the info for files with FFLAG_SENDWAIT.  Files whose hashes
+// aren't ready yet go out from fts_Update when they are.
 void fts_FlushAddedFiles(FTServ *hServ);
 
 // Clear the file list.  Does NOT stop the current file transfer, so
@@ -100,7 +109,8 @@ void fts_StopTransfer(FTServ *hServ);
 // Call this when a packet comes in from the client.
 bool fts_ProcessPacket(FTServ *hServ, const CPacket_Read &cPacket);
 
-// Call as often as possible.
+// Call as often as possible.  This sends as many blocks as the transfer
+// window allows.
 void fts_Update(FTServ *hServ, float timeDelta);
 
 
@@ -4,6 +4,7 @@
 #include "ltmessage.h"
 #include "stringmgr.h"
 #include "de_objects.h"
+#include "netdelta.h"
 
 // Compressor interface
 #include "compress.h"
@@ -124,11 +125,37 @@ void CLTMessage_Write::WriteObject(CPacket_Write &cPacket, HOBJECT hObj)
 	}
 }
 
-void CLTMessage_Write::WriteYRotation(CPacket_Write &cPacket, const LTRotation &cRotation)
+static int8 CompressYRotation(const LTRotation &cRotation)
 {
 	LTVector forward = cRotation.Forward();
 	float fAngle = (float)atan2(forward.x, forward.z);
-	cPacket.Writeint8((int8)(fAngle * (127.0f / MATH_PI)));
+	return (int8)(fAngle * (127.0f / MATH_PI));
+}
+
+void CLTMessage_Write::WriteYRotation(CPacket_Write &cPacket, const LTRotation &cRotation)
+{
+	cPacket.Writeint8(CompressYRotation(cRotation));
+}
+
+void CLTMessage_Write::WriteDeltaCompLTVector(CPacket_Write &cPacket, const LTVector &vVec, const NetObjState *pBaseline, NetObjState *pState)
+{
+	CompVector compVec;
+	g_pCompressor->EncodeCompressVector(&compVec, &vVec);
+
+	nd_WriteVel(cPacket, compVec, pBaseline, pState);
+}
+
+void CLTMessage_Write::WriteDeltaCompLTRotation(CPacket_Write &cPacket, const LTRotation &cRotation, const NetObjState *pBaseline, NetObjState *pState)
+{
+	CompRot compRot;
+	g_pCompressor->EncodeCompressRotation(&cRotation, &compRot);
+
+	nd_WriteRot(cPacket, compRot, pBaseline, pState);
+}
+
+void CLTMessage_Write::WriteDeltaYRotation(CPacket_Write &cPacket, const LTRotation &cRotation, const NetObjState *pBaseline, NetObjState *pState)
+{
+	nd_WriteYRot(cPacket, CompressYRotation(cRotation), pBaseline, pState);
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -228,6 +255,34 @@ LTRotation CLTMessage_Read::ReadYRotation(CPacket_Read &cPacket)
 	return LTRotation(0.0f, (float)(nAngle) * (MATH_PI / 127.0f), 0.0f);
 }
 
+LTVector CLTMessage_Read::ReadDeltaCompLTVector(CPacket_Read &cPacket, const NetObjState *pBaseline, NetObjState *pState)
+{
+	CompVector compVec;
+	nd_ReadVel(cPacket, &compVec, pBaseline, pState);
+
+	LTVector vResult;
+	g_pCompressor->DecodeCompressVector(&vResult, &compVec);
+
+	return vResult;
+}
+
+LTRotation CLTMessage_Read::ReadDeltaCompLTRotation(CPacket_Read &cPacket, const NetObjState *pBaseline, NetObjState *pState)
+{
+	CompRot compRot;
+	nd_ReadRot(cPacket, &compRot, pBaseline, pState);
+
+	LTRotation cResult;
+	g_pCompressor->UncompressRotation(compRot.m_Bytes, &cResult);
+
+	return cResult;
+}
+
+LTRotation CLTMessage_Read::ReadDeltaYRotation(CPacket_Read &cPacket, const NetObjState *pBaseline, NetObjState *pState)
+{
+	int8 nAngle = nd_ReadYRot(cPacket, pBaseline, pState);
+	return LTRotation(0.0f, (float)(nAngle) * (MATH_PI / 127.0f), 0.0f);
+}
+
 ILTMessage_Read *CLTMessage_Read::PeekMessage() const
 {
 	uint32 nSize = m_cPacket.Peekuint16();
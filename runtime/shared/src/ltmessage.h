@@ -11,6 +11,7 @@
 #include "packet.h"
 
 class CLTMessage_Read;
+struct NetObjState;
 
 class CLTMessage_Write : public ILTMessage_Write {
 public:
@@ -58,6 +59,11 @@ public:
 	static void WriteCompLTRotation(CPacket_Write &cPacket, const LTRotation &cRotation);
 	static void WriteObject(CPacket_Write &cPacket, HOBJECT hObj);
 	static void WriteYRotation(CPacket_Write &cPacket, const LTRotation &cRotation);
+
+	// Write against a baseline state and save what was written in pState (see netdelta.h)
+	static void WriteDeltaCompLTVector(CPacket_Write &cPacket, const LTVector &vVec, const NetObjState *pBaseline, NetObjState *pState);
+	static void WriteDeltaCompLTRotation(CPacket_Write &cPacket, const LTRotation &cRotation, const NetObjState *pBaseline, NetObjState *pState);
+	static void WriteDeltaYRotation(CPacket_Write &cPacket, const LTRotation &cRotation, const NetObjState *pBaseline, NetObjState *pState);
 protected:
 	CLTMessage_Write() {}
 
@@ -140,6 +146,11 @@ public:
 	static LTVector PeekCompLTVector(const CPacket_Read &cPacket);
 	static LTRotation PeekCompLTRotation(const CPacket_Read &cPacket);
 	static LTRotation PeekYRotation(const CPacket_Read &cPacket);
+
+	// Read what was written with the WriteDelta functions
+	static LTVector ReadDeltaCompLTVector(CPacket_Read &cPacket, const NetObjState *pBaseline, NetObjState *pState);
+	static LTRotation ReadDeltaCompLTRotation(CPacket_Read &cPacket, const NetObjState *pBaseline, NetObjState *pState);
+	static LTRotation ReadDeltaYRotation(CPacket_Read &cPacket, const NetObjState *pBaseline, NetObjState *pState);
 protected:
 	CLTMessage_Read() {}
 	CLTMessage_Read(const CPacket_Read &cPacket) :
@@ -113,7 +113,7 @@ void DetachObjectsStandingOn(LTObject *pObj)
 		
 		pStandingObj = (LTObject*)pCur->m_pData;
 		DetachObjectStanding(pStandingObj);
-		pStandingObj->m_InternalFlags |= IFLAG_APPLYPHYSICS;
+		obj_ApplyPhysics(pStandingObj);
 		
 		pCur = pNext;
 	}
@@ -1464,7 +1464,8 @@ void MoveObject
 
 	// Set the moving flag so we can't be moved by things we push. 
 	// Also set the apply physics flag so we do physics calcs next time around.
-	pState->m_pObj->m_InternalFlags |= IFLAG_MOVING | IFLAG_APPLYPHYSICS;
+	pState->m_pObj->m_InternalFlags |= IFLAG_MOVING;
+	obj_ApplyPhysics(pState->m_pObj);
 
 	// If object is teleporting, then it doesn't really need to travel from somewhere...
 	if(flags & MO_TELEPORT)
@@ -0,0 +1,284 @@
+#include "bdefs.h"
+#include "netdelta.h"
+#include "packet.h"
+#include "iltcommon.h"
+
+#include <algorithm>
+
+
+// ----------------------------------------------------------------------- //
+// Values
+// ----------------------------------------------------------------------- //
+
+// Changes are written as a sign-folded difference: 0, -1, 1, -2, 2...
+// becomes 0, 1, 2, 3, 4...
+//   0           unchanged
+//   10 + 4      small change
+//   110 + 8     medium change
+//   111 + n     the whole value
+
+#define DELTA_SMALL_BITS	4
+#define DELTA_MEDIUM_BITS	8
+
+static inline uint32 nd_Mask(uint32 nBits)
+{
+	return (nBits >= 32) ? 0xFFFFFFFF : ((1u << nBits) - 1);
+}
+
+void nd_WriteValue(CPacket_Write &cPacket, uint32 nValue, uint32 nBaseline, uint32 nBits)
+{
+	uint32 nMask = nd_Mask(nBits);
+	nValue &= nMask;
+
+	// Sign extend the difference out of nBits.
+	uint32 nDiff = (nValue - nBaseline) & nMask;
+	int64 nSigned = (int64)nDiff;
+	if (nDiff & (1u << (nBits - 1)))
+		nSigned -= (int64)1 << nBits;
+
+	uint64 nFolded = (nSigned < 0) ? ((uint64)(-nSigned) * 2 - 1) : ((uint64)nSigned * 2);
+
+	if (nFolded == 0)
+	{
+		cPacket.Writebool(false);
+	}
+	else if (nFolded < (1 << DELTA_SMALL_BITS))
+	{
+		cPacket.WriteBits(0x1, 2);
+		cPacket.WriteBits((uint32)nFolded, DELTA_SMALL_BITS);
+	}
+	else if (nFolded < (1 << DELTA_MEDIUM_BITS) && DELTA_MEDIUM_BITS < nBits)
+	{
+		cPacket.WriteBits(0x3, 3);
+		cPacket.WriteBits((uint32)nFolded, DELTA_MEDIUM_BITS);
+	}
+	else
+	{
+		cPacket.WriteBits(0x7, 3);
+		cPacket.WriteBits(nValue, nBits);
+	}
+}
+
+uint32 nd_ReadValue(CPacket_Read &cPacket, uint32 nBaseline, uint32 nBits)
+{
+	uint32 nMask = nd_Mask(nBits);
+
+	if (!cPacket.Readbool())
+		return nBaseline & nMask;
+
+	uint32 nFolded;
+	if (!cPacket.Readbool())
+		nFolded = cPacket.ReadBits(DELTA_SMALL_BITS);
+	else if (!cPacket.Readbool())
+		nFolded = cPacket.ReadBits(DELTA_MEDIUM_BITS);
+	else
+		return cPacket.ReadBits(nBits);
+
+	// Unfold it and apply it.
+	uint32 nDiff = (nFolded & 1) ? (0 - ((nFolded + 1) >> 1)) : (nFolded >> 1);
+	return (nBaseline + nDiff) & nMask;
+}
+
+
+// ----------------------------------------------------------------------- //
+// Fields
+// ----------------------------------------------------------------------- //
+
+static const NetObjState g_ZeroState = { 0 };
+
+// Get the baseline to write a field against.
+static inline const NetObjState* nd_GetBaseline(const NetObjState *pBaseline, uint32 nField)
+{
+	return (pBaseline && (pBaseline->m_nFields & nField)) ? pBaseline : &g_ZeroState;
+}
+
+void nd_WritePos(CPacket_Write &cPacket, const CompWorldPos &cPos, const NetObjState *pBaseline, NetObjState *pState)
+{
+	const NetObjState *pBase = nd_GetBaseline(pBaseline, NETSTATE_POS);
+
+	for (uint32 i = 0; i < 3; i++)
+	{
+		nd_WriteValue(cPacket, cPos.m_Pos[i], pBase->m_Pos[i], 16);
+		pState->m_Pos[i] = cPos.m_Pos[i];
+	}
+	pState->m_nFields |= NETSTATE_POS;
+}
+
+void nd_ReadPos(CPacket_Read &cPacket, CompWorldPos *pPos, const NetObjState *pBaseline, NetObjState *pState)
+{
+	const NetObjState *pBase = nd_GetBaseline(pBaseline, NETSTATE_POS);
+
+	for (uint32 i = 0; i < 3; i++)
+	{
+		pPos->m_Pos[i] = (uint16)nd_ReadValue(cPacket, pBase->m_Pos[i], 16);
+		pState->m_Pos[i] = pPos->m_Pos[i];
+	}
+	pPos->m_Extra = 0;
+	pState->m_nFields |= NETSTATE_POS;
+}
+
+void nd_WriteVel(CPacket_Write &cPacket, const CompVector &cVel, const NetObjState *pBaseline, NetObjState *pState)
+{
+	const NetObjState *pBase = nd_GetBaseline(pBaseline, NETSTATE_VEL);
+
+	uint32 nA;
+	memcpy(&nA, &cVel.fA, sizeof(nA));
+
+	nd_WriteValue(cPacket, nA, pBase->m_VelA, 32);
+	nd_WriteValue(cPacket, cVel.dwB, pBase->m_VelB, 16);
+	nd_WriteValue(cPacket, cVel.dwC, pBase->m_VelC, 16);
+	nd_WriteValue(cPacket, cVel.order, pBase->m_VelOrder, 8);
+
+	pState->m_VelA = nA;
+	pState->m_VelB = (uint16)cVel.dwB;
+	pState->m_VelC = (uint16)cVel.dwC;
+	pState->m_VelOrder = cVel.order;
+	pState->m_nFields |= NETSTATE_VEL;
+}
+
+void nd_ReadVel(CPacket_Read &cPacket, CompVector *pVel, const NetObjState *pBaseline, NetObjState *pState)
+{
+	const NetObjState *pBase = nd_GetBaseline(pBaseline, NETSTATE_VEL);
+
+	uint32 nA = nd_ReadValue(cPacket, pBase->m_VelA, 32);
+	memcpy(&pVel->fA, &nA, sizeof(nA));
+	pVel->dwB = nd_ReadValue(cPacket, pBase->m_VelB, 16);
+	pVel->dwC = nd_ReadValue(cPacket, pBase->m_VelC, 16);
+	pVel->order = (uint8)nd_ReadValue(cPacket, pBase->m_VelOrder, 8);
+
+	pState->m_VelA = nA;
+	pState->m_VelB = (uint16)pVel->dwB;
+	pState->m_VelC = (uint16)pVel->dwC;
+	pState->m_VelOrder = pVel->order;
+	pState->m_nFields |= NETSTATE_VEL;
+}
+
+// The first byte of a compressed rotation tells if it's the 3 byte form, so
+// that goes first and the reader knows how many more to expect.
+void nd_WriteRot(CPacket_Write &cPacket, const CompRot &cRot, const NetObjState *pBaseline, NetObjState *pState)
+{
+	const NetObjState *pBase = nd_GetBaseline(pBaseline, NETSTATE_ROT);
+
+	uint32 nBytes = (cRot.m_Bytes[0] < 0) ? 3 : 6;
+	for (uint32 i = 0; i < 6; i++)
+	{
+		int8 nByte = (i < nBytes) ? (int8)cRot.m_Bytes[i] : 0;
+		if (i < nBytes)
+			nd_WriteValue(cPacket, (uint8)nByte, (uint8)pBase->m_Rot[i], 8);
+		pState->m_Rot[i] = nByte;
+	}
+	pState->m_nFields |= NETSTATE_ROT;
+}
+
+void nd_ReadRot(CPacket_Read &cPacket, CompRot *pRot, const NetObjState *pBaseline, NetObjState *pState)
+{
+	const NetObjState *pBase = nd_GetBaseline(pBaseline, NETSTATE_ROT);
+
+	uint32 nBytes = 6;
+	for (uint32 i = 0; i < 6; i++)
+	{
+		int8 nByte = 0;
+		if (i < nBytes)
+			nByte = (int8)nd_ReadValue(cPacket, (uint8)pBase->m_Rot[i], 8);
+		if (i == 0 && nByte < 0)
+			nBytes = 3;
+		pRot->m_Bytes[i] = nByte;
+		pState->m_Rot[i] = nByte;
+	}
+	pState->m_nFields |= NETSTATE_ROT;
+}
+
+void nd_WriteYRot(CPacket_Write &cPacket, int8 nYRot, const NetObjState *pBaseline, NetObjState *pState)
+{
+	const NetObjState *pBase = nd_GetBaseline(pBaseline, NETSTATE_YROT);
+
+	nd_WriteValue(cPacket, (uint8)nYRot, (uint8)pBase->m_YRot, 8);
+	pState->m_YRot = nYRot;
+	pState->m_nFields |= NETSTATE_YROT;
+}
+
+int8 nd_ReadYRot(CPacket_Read &cPacket, const NetObjState *pBaseline, NetObjState *pState)
+{
+	const NetObjState *pBase = nd_GetBaseline(pBaseline, NETSTATE_YROT);
+
+	pState->m_YRot = (int8)nd_ReadValue(cPacket, (uint8)pBase->m_YRot, 8);
+	pState->m_nFields |= NETSTATE_YROT;
+	return pState->m_YRot;
+}
+
+
+// ----------------------------------------------------------------------- //
+// CNetSnapshot
+// ----------------------------------------------------------------------- //
+
+void CNetSnapshot::Clear()
+{
+	m_Objects.clear();
+	m_bValid = false;
+}
+
+void CNetSnapshot::Add(uint16 nObjectID, const NetObjState &cState)
+{
+	SObject cObject;
+	cObject.m_nObjectID = nObjectID;
+	cObject.m_State = cState;
+	m_Objects.push_back(cObject);
+}
+
+void CNetSnapshot::Truncate(uint32 nCount)
+{
+	if (nCount < m_Objects.size())
+		m_Objects.resize(nCount);
+}
+
+void CNetSnapshot::Finish()
+{
+	// Stable so repeats stay in the order they were written.
+	std::stable_sort(m_Objects.begin(), m_Objects.end(),
+		[](const SObject &a, const SObject &b) { return a.m_nObjectID < b.m_nObjectID; });
+	m_bValid = true;
+}
+
+const NetObjState* CNetSnapshot::Find(uint16 nObjectID) const
+{
+	// Find the last one with this ID.
+	std::vector<SObject>::const_iterator iFound = std::upper_bound(m_Objects.begin(), m_Objects.end(), nObjectID,
+		[](uint16 nID, const SObject &cObject) { return nID < cObject.m_nObjectID; });
+
+	if (iFound == m_Objects.begin())
+		return LTNULL;
+	--iFound;
+	if (iFound->m_nObjectID != nObjectID)
+		return LTNULL;
+	return &iFound->m_State;
+}
+
+
+// ----------------------------------------------------------------------- //
+// CNetSnapshotRing
+// ----------------------------------------------------------------------- //
+
+CNetSnapshot* CNetSnapshotRing::Begin(uint16 nSequence)
+{
+	CNetSnapshot *pSnapshot = &m_Snapshots[nSequence & (NETDELTA_SNAPSHOTS - 1)];
+	if (pSnapshot->m_bValid && !nd_IsNewer(nSequence, pSnapshot->m_nSequence))
+		return LTNULL;
+
+	pSnapshot->Clear();
+	pSnapshot->m_nSequence = nSequence;
+	return pSnapshot;
+}
+
+const CNetSnapshot* CNetSnapshotRing::Find(uint16 nSequence) const
+{
+	const CNetSnapshot *pSnapshot = &m_Snapshots[nSequence & (NETDELTA_SNAPSHOTS - 1)];
+	if (!pSnapshot->m_bValid || pSnapshot->m_nSequence != nSequence)
+		return LTNULL;
+	return pSnapshot;
+}
+
+void CNetSnapshotRing::Clear()
+{
+	for (uint32 i = 0; i < NETDELTA_SNAPSHOTS; i++)
+		m_Snapshots[i].Clear();
+}
@@ -0,0 +1,154 @@
+
+// Delta compression for object updates.  Each object update is written as a
+// difference from a baseline state the other end is known to have.  For the
+// guaranteed updates that's simply the last state sent, since they always
+// arrive and in order.  The unguaranteed updates are numbered and the client
+// acknowledges them, and the server builds each one from the newest update
+// the client says it got.  Both ends keep the last NETDELTA_SNAPSHOTS updates
+// around as snapshots for that.
+//
+// The states hold the values as they go out on the wire (compressed
+// positions, rotations and so on), so both ends always agree exactly on what
+// the baseline is.
+
+#ifndef __NETDELTA_H__
+#define __NETDELTA_H__
+
+#include <vector>
+
+class CPacket_Read;
+class CPacket_Write;
+struct CompVector;
+class CompRot;
+class CompWorldPos;
+
+
+// Number of unguaranteed updates remembered.  Must be a power of 2.
+#define NETDELTA_SNAPSHOTS		32
+#define NETDELTA_SNAPSHOT_BITS	5	// Bits needed for the distance back to a baseline
+
+
+// Which fields of a NetObjState are filled in.
+#define NETSTATE_POS		(1<<0)
+#define NETSTATE_VEL		(1<<1)
+#define NETSTATE_ROT		(1<<2)
+#define NETSTATE_YROT		(1<<3)
+#define NETSTATE_ANIM		(1<<4)
+
+
+// What was last sent about an object, as it was sent.  This is kept in
+// arrays that get memset and memcpy'd, so it has to stay a POD.
+struct NetObjState
+{
+	uint8		m_nFields;			// NETSTATE_ flags
+
+	uint16		m_Pos[3];			// Compressed world position
+	uint32		m_VelA;				// Compressed velocity (CompVector, with fA as its bits)
+	uint16		m_VelB, m_VelC;
+	uint8		m_VelOrder;
+	int8		m_Rot[6];			// Compressed rotation (the last 3 are 0 for the short form)
+	int8		m_YRot;
+
+	// Main animation tracker.
+	uint16		m_nAnimIndex;
+	uint8		m_nAnimFlags;		// NETSTATE_ANIM_ flags
+	uint8		m_nAnimTimeType;	// Which MODELINFO_ANIMTIME_SIZE the time needs
+	uint32		m_nAnimTime;		// In MODELINFO_ANIMTIME_RES units
+};
+
+#define NETSTATE_ANIM_PLAYING	(1<<0)
+#define NETSTATE_ANIM_LOOPING	(1<<1)
+
+
+inline void nd_ClearState(NetObjState *pState)
+{
+	memset(pState, 0, sizeof(*pState));
+}
+
+
+// Write a value as a difference from the baseline.  Unchanged values are 1
+// bit, small changes 6 or 11 bits, anything else nBits + 3.  Values wrap at
+// nBits, so it works for unsigned and signed fields alike.
+void nd_WriteValue(CPacket_Write &cPacket, uint32 nValue, uint32 nBaseline, uint32 nBits);
+uint32 nd_ReadValue(CPacket_Read &cPacket, uint32 nBaseline, uint32 nBits);
+
+
+// Write a field against the baseline, and save it in pState.  pBaseline may
+// be LTNULL, or not have the field, in which case it's written against 0.
+void nd_WritePos(CPacket_Write &cPacket, const CompWorldPos &cPos, const NetObjState *pBaseline, NetObjState *pState);
+void nd_WriteVel(CPacket_Write &cPacket, const CompVector &cVel, const NetObjState *pBaseline, NetObjState *pState);
+void nd_WriteRot(CPacket_Write &cPacket, const CompRot &cRot, const NetObjState *pBaseline, NetObjState *pState);
+void nd_WriteYRot(CPacket_Write &cPacket, int8 nYRot, const NetObjState *pBaseline, NetObjState *pState);
+
+void nd_ReadPos(CPacket_Read &cPacket, CompWorldPos *pPos, const NetObjState *pBaseline, NetObjState *pState);
+void nd_ReadVel(CPacket_Read &cPacket, CompVector *pVel, const NetObjState *pBaseline, NetObjState *pState);
+void nd_ReadRot(CPacket_Read &cPacket, CompRot *pRot, const NetObjState *pBaseline, NetObjState *pState);
+int8 nd_ReadYRot(CPacket_Read &cPacket, const NetObjState *pBaseline, NetObjState *pState);
+
+
+// The object states written in one unguaranteed update.
+class CNetSnapshot
+{
+public:
+
+				CNetSnapshot() : m_nSequence(0), m_bValid(false) {}
+
+	void		Clear();
+
+	// Add an object as it's written.  An object can be written more than
+	// once (attachments), the last one wins.
+	void		Add(uint16 nObjectID, const NetObjState &cState);
+
+	uint32		GetNumObjects() const	{ return (uint32)m_Objects.size(); }
+
+	// Throw away everything after the first nCount objects.
+	void		Truncate(uint32 nCount);
+
+	// Call once all the objects are in, before using Find.
+	void		Finish();
+
+	const NetObjState*	Find(uint16 nObjectID) const;
+
+	uint16		m_nSequence;
+	bool		m_bValid;
+
+protected:
+
+	struct SObject
+	{
+		uint16		m_nObjectID;
+		NetObjState	m_State;
+	};
+
+	std::vector<SObject>	m_Objects;
+};
+
+
+// The last NETDELTA_SNAPSHOTS snapshots, by sequence number.
+class CNetSnapshotRing
+{
+public:
+
+	// Get the snapshot to fill in for an update.  Returns LTNULL if it would
+	// replace a newer one, which happens when updates arrive out of order.
+	CNetSnapshot*		Begin(uint16 nSequence);
+
+	// Get a finished snapshot, LTNULL if it's been replaced or never was.
+	const CNetSnapshot*	Find(uint16 nSequence) const;
+
+	void				Clear();
+
+protected:
+
+	CNetSnapshot		m_Snapshots[NETDELTA_SNAPSHOTS];
+};
+
+
+// Is sequence number a newer than b?  (They wrap.)
+inline bool nd_IsNewer(uint16 a, uint16 b)
+{
+	return (int16)(a - b) > 0;
+}
+
+
+#endif
@@ -211,6 +211,7 @@ void LTObject::Clear()
 
     cd.m_hLineSystem = LTNULL;
 
+    nd_ClearState(&cd.m_GuaranteedState);
 }
 
 
@@ -414,6 +415,9 @@ ModelInstance::ModelInstance()
 	m_CachedTransforms			= NULL;
 	m_CachedTransformInfo		= NULL;
 	m_RenderingTransforms		= NULL;
+	m_ModelSpaceTransforms		= NULL;
+	m_bModelSpacePosed			= false;
+	m_bPoseUsed					= false;
 
     m_LastDirLightAmount		= -1.0f;
 	m_nRenderInfoIndex			= INVALID_MODEL_INFO_INDEX;
@@ -765,6 +769,9 @@ void ModelInstance::AddNodeControlFn( HMODELNODE hNode, NodeControlFn pFn, void
 
 	//add it into the list
 	m_pNodeInfo[hNode].m_pNodeControls = pInfo;
+
+	//the node controls have to see the pose in world space
+	m_bModelSpacePosed = false;
 }
 
 // ------------------------------------------------------------------------
@@ -966,6 +973,9 @@ void ModelInstance::EnableTransformCache()
 	{
 		LT_MEM_TRACK_ALLOC( m_RenderingTransforms= new DDMatrix [ nNumNodes ], 
 							LT_MEM_TYPE_OBJECT);
+
+		LT_MEM_TRACK_ALLOC( m_ModelSpaceTransforms= new LTMatrix [ nNumNodes ], 
+							LT_MEM_TYPE_OBJECT);
 	}
 
 	ResetCachedTransformNodeStates();
@@ -987,6 +997,10 @@ void ModelInstance::DisableTransformCache()
 
 	delete [] m_RenderingTransforms;
 	m_RenderingTransforms = NULL ;
+
+	delete [] m_ModelSpaceTransforms;
+	m_ModelSpaceTransforms = NULL ;
+	m_bModelSpacePosed = false;
 }
 
 // ------------------------------------------------------------------------
@@ -1090,6 +1104,7 @@ bool ModelInstance::ForceUpdateCachedTransforms()
     LTAnimTracker *pCur;
 
 	SetupTransform(mToWorld);
+	m_bPoseUsed = true;
 
     tMaker.m_nAnims = 0;
     for (pCur=m_AnimTrackers; pCur; pCur=(LTAnimTracker*)pCur->m_Link.m_pNext)
@@ -1151,6 +1166,54 @@ bool ModelInstance::GetCachedTransform( uint32 iNode, LTMatrix &transform )
 	}
 }
 
+// ------------------------------------------------------------------------
+// BuildModelSpacePose()
+// Evaluate every node with an identity start transform.  Node controls are
+// handed world space matrices, so models with any are left to be evaluated
+// the normal way.
+// ------------------------------------------------------------------------
+bool ModelInstance::BuildModelSpacePose()
+{
+	m_bModelSpacePosed = false;
+
+	if( !m_ModelSpaceTransforms || !GetModelDB() )
+		return false;
+
+	uint32 nNumNodes = GetModelDB()->NumNodes();
+	for( uint32 iNode = 0 ; iNode < nNumNodes ; iNode++ )
+	{
+		if( HasNodeControlFn(iNode) )
+			return false;
+	}
+
+	TransformMaker	tMaker;
+	LTMatrix		mIdentity;
+	LTAnimTracker	*pCur;
+
+	mIdentity.Identity();
+
+	tMaker.m_nAnims = 0;
+	for (pCur=m_AnimTrackers; pCur; pCur=(LTAnimTracker*)pCur->m_Link.m_pNext)
+	{
+		if (tMaker.m_nAnims >= MAX_GVP_ANIMS)
+			return false;
+
+		tMaker.m_Anims[ tMaker.m_nAnims ] = pCur->m_TimeRef;
+		tMaker.m_nAnims++;
+	}
+
+	tMaker.m_iMoveHintNode	= m_AnimTrackers->m_hHintNode ;
+	tMaker.m_pInstance		= this;
+	tMaker.m_pStartMat		= &mIdentity;
+	tMaker.m_pOutput		= m_ModelSpaceTransforms;
+
+	if (!tMaker.SetupTransforms())
+		return false;
+
+	m_bModelSpacePosed = true;
+	return true;
+}
+
 // ------------------------------------------------------------------------
 // GetRenderingTransforms()
 // get the matrix for use in rendering of the current animation state.
@@ -1199,6 +1262,8 @@ void ModelInstance::ResetCachedTransformNodeStates()
 		SetNodeEvaluated(nCurrNode, false);
 		SetNodeEvaluatedRendering(nCurrNode, false);
 	}
+
+	m_bModelSpacePosed = false;
 }
 
 
@@ -1214,6 +1279,23 @@ bool ModelInstance::UpdateCachedTransformsWithPath()
 
 	// create the transform that's the current pos/orient
 	SetupTransform(mStartTransform);
+	m_bPoseUsed = true;
+
+	// if the pose has already been built, just move it into place.
+	if( m_bModelSpacePosed )
+	{
+		for( uint32 iNode = 0 ; iNode < GetModelDB()->NumNodes() ; iNode++ )
+		{
+			if( !IsNodeEvaluated(iNode) )
+			{
+				MatMul(&m_CachedTransforms[iNode], &mStartTransform, &m_ModelSpaceTransforms[iNode]);
+				SetNodeEvaluated(iNode, true);
+			}
+			SetShouldEvaluateNode(iNode, false);
+		}
+
+		return true;
+	}
 
 	tMaker.m_nAnims = 0;
 	// animations to update.
@@ -29,7 +29,7 @@
 
 
 // Each time the protocol is updated, this number should be incremented.
-#define LT_NET_PROTOCOL_VERSION		7	// 7 == LithTech 3.0 (spring 2001)
+#define LT_NET_PROTOCOL_VERSION		10	// 7 == LithTech 3.0 (spring 2001), 8 == windowed file transfer, 9 == delta compressed object updates, 10 == sha-256 file hashes
 
 
 #define DEFAULT_CLIENT_UPDATE_RATE	10
@@ -104,6 +104,10 @@
 #define SMSG_UPDATE				(PACKETID_SERVERBASE+3)
 
 // Unguaranteed server update.  Contains positions and rotations.
+// uint16: Sequence number (acknowledged with CMSG_UPDATEACK)
+// bool: Delta compressed against an earlier update
+//  -NETDELTA_SNAPSHOT_BITS: How many updates back that one is
+// Object updates, then the ID_TIMESTAMP end info
 #define SMSG_UNGUARANTEEDUPDATE		(PACKETID_SERVERBASE+5)
 
 // The first packet sent by the server.
@@ -270,6 +274,10 @@ struct FileIDInfo
 // Used for testing (when the client blasts the server).
 #define CMSG_TEST				(PACKETID_CLIENTBASE+7)
 
+// Tells the server which SMSG_UNGUARANTEEDUPDATE the client got last.  Sent unguaranteed.
+// uint16: Sequence number of the newest one
+#define CMSG_UPDATEACK			(PACKETID_CLIENTBASE+8)
+
 
 #endif  // __PACKETDEFS_H__
 
@@ -2,6 +2,11 @@
 #include "bdefs.h"
 #include "pixelformat.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PIXELFORMAT_SSE2
+#include <emmintrin.h>
+#endif
+
 
 #define SRC_8	(*pSrc)
 #define SRC_16	(*((uint16*)pSrc))
@@ -638,6 +643,313 @@ LTRESULT Convert2Pass(FormatMgr *pFormatMgr, const FMConvertRequest *pRequest, S
 	return LT_OK;
 }
 
+#ifdef PIXELFORMAT_SSE2
+
+// ------------------------------------------------------------------------------ //
+// SSE2 conversion classes.
+// These give the same results as the conversion classes above, eight pixels at a
+// time, with each color plane held as 8-bit values in 16-bit lanes.  Init returns
+// false for formats they can't match the per-pixel converters on.
+// ------------------------------------------------------------------------------ //
+
+class SSE_16toBF
+{
+public:
+	enum { k_nBlockBytes = 8 * sizeof(uint16) };
+
+	bool Init(const FormatMgr *pFormatMgr, const FMConvertRequest *pRequest)
+	{
+		return Init(pFormatMgr, pRequest->m_pSrcFormat);
+	}
+
+	bool Init(const FormatMgr *pFormatMgr, const PFormat *pSrcFormat)
+	{
+		for(uint32 i=0; i < NUM_COLORPLANES; i++)
+		{
+			uint32 nBits = pSrcFormat->m_nBits[i];
+			if(nBits >= NUM_SCALE_TABLES)
+				return false;
+
+			// The scale tables are only sized for masks with no gaps.
+			uint32 mask = pSrcFormat->m_Masks[i];
+			if(mask > 0xFFFF || mask != (((1u << nBits) - 1) << (pSrcFormat->m_FirstBits[i] & 31)))
+				return false;
+
+			// Planes that aren't there come out 0.
+			m_bUsed[i] = (nBits != 0);
+			if(!m_bUsed[i])
+				continue;
+
+			const ScaleTo8Mul &scale = pFormatMgr->m_ScaleTo8Mul[nBits];
+			if(!scale.m_Mul)
+				return false;
+
+			m_Masks[i] = _mm_set1_epi16((short)pSrcFormat->m_Masks[i]);
+			m_Shifts[i] = _mm_cvtsi32_si128(pSrcFormat->m_FirstBits[i]);
+			m_Pre[i] = _mm_set1_epi16((short)scale.m_Pre);
+			m_Mul[i] = _mm_set1_epi16((short)scale.m_Mul);
+			m_ScaleShifts[i] = _mm_cvtsi32_si128(scale.m_Shift);
+		}
+
+		return true;
+	}
+
+	void Unpack(const uint8 *pSrc, __m128i *pPlanes) const
+	{
+		__m128i src = _mm_loadu_si128((const __m128i*)pSrc);
+
+		for(uint32 i=0; i < NUM_COLORPLANES; i++)
+		{
+			if(!m_bUsed[i])
+			{
+				pPlanes[i] = _mm_setzero_si128();
+				continue;
+			}
+
+			__m128i val = _mm_srl_epi16(_mm_and_si128(src, m_Masks[i]), m_Shifts[i]);
+			val = _mm_mulhi_epu16(_mm_mullo_epi16(val, m_Pre[i]), m_Mul[i]);
+			pPlanes[i] = _mm_srl_epi16(val, m_ScaleShifts[i]);
+		}
+	}
+
+	bool	m_bUsed[NUM_COLORPLANES];
+	__m128i	m_Masks[NUM_COLORPLANES];
+	__m128i	m_Shifts[NUM_COLORPLANES];
+	__m128i	m_Pre[NUM_COLORPLANES];
+	__m128i	m_Mul[NUM_COLORPLANES];
+	__m128i	m_ScaleShifts[NUM_COLORPLANES];
+};
+
+
+class SSE_32toBF
+{
+public:
+	enum { k_nBlockBytes = 8 * sizeof(uint32) };
+
+	bool Init(const FormatMgr *pFormatMgr, const FMConvertRequest *pRequest)
+	{
+		for(uint32 i=0; i < NUM_COLORPLANES; i++)
+		{
+			uint32 firstBit = pRequest->m_pSrcFormat->m_FirstBits[i];
+
+			// A plane with no mask starts at bit 32, which CC_32toBF shifts by 
+			// however the compiler sees fit.  That's only safe to skip if the
+			// destination doesn't keep the plane either.
+			m_bUsed[i] = (firstBit < 32);
+			if(!m_bUsed[i] && pRequest->m_pDestFormat->m_nBits[i])
+				return false;
+
+			m_Shifts[i] = _mm_cvtsi32_si128(firstBit);
+		}
+
+		return true;
+	}
+
+	void Unpack(const uint8 *pSrc, __m128i *pPlanes) const
+	{
+		__m128i src0 = _mm_loadu_si128((const __m128i*)pSrc);
+		__m128i src1 = _mm_loadu_si128((const __m128i*)(pSrc + 16));
+		__m128i byteMask = _mm_set1_epi32(0xFF);
+
+		for(uint32 i=0; i < NUM_COLORPLANES; i++)
+		{
+			if(!m_bUsed[i])
+			{
+				pPlanes[i] = _mm_setzero_si128();
+				continue;
+			}
+
+			pPlanes[i] = _mm_packs_epi32(
+				_mm_and_si128(_mm_srl_epi32(src0, m_Shifts[i]), byteMask),
+				_mm_and_si128(_mm_srl_epi32(src1, m_Shifts[i]), byteMask));
+		}
+	}
+
+	bool	m_bUsed[NUM_COLORPLANES];
+	__m128i	m_Shifts[NUM_COLORPLANES];
+};
+
+
+class BaseSSE_BFToAny
+{
+public:
+
+	bool Init(const FormatMgr *pFormatMgr, const PFormat *pDestFormat)
+	{
+		for(uint32 i=0; i < NUM_COLORPLANES; i++)
+		{
+			uint32 nBits = pDestFormat->m_nBits[i];
+			if(nBits >= NUM_SCALE_TABLES)
+				return false;
+
+			// Planes that aren't there scale to 0.
+			m_bUsed[i] = (nBits != 0);
+			m_MaxVals[i] = _mm_set1_epi16((short)((1 << nBits) - 1));
+			m_Shifts[i] = _mm_cvtsi32_si128(pDestFormat->m_FirstBits[i]);
+		}
+
+		return true;
+	}
+
+	// Scales plane i down to the destination's bit count, the same as m_ScaleFrom8.
+	__m128i Scale(const __m128i *pPlanes, uint32 i) const
+	{
+		// (x * maxVal) / 255, using x / 255 == (x + (x >> 8) + 1) >> 8 for x <= 255*255.
+		__m128i val = _mm_mullo_epi16(pPlanes[i], m_MaxVals[i]);
+		val = _mm_add_epi16(val, _mm_srli_epi16(val, 8));
+		return _mm_srli_epi16(_mm_add_epi16(val, _mm_set1_epi16(1)), 8);
+	}
+
+	bool	m_bUsed[NUM_COLORPLANES];
+	__m128i	m_MaxVals[NUM_COLORPLANES];
+	__m128i	m_Shifts[NUM_COLORPLANES];
+};
+
+
+class SSE_BFto16 : public BaseSSE_BFToAny
+{
+public:
+	enum { k_nBlockBytes = 8 * sizeof(uint16) };
+	typedef uint16 Pixel;
+
+	__m128i Pack(const __m128i *pPlanes) const
+	{
+		__m128i ret = _mm_setzero_si128();
+		for(uint32 i=0; i < NUM_COLORPLANES; i++)
+		{
+			if(m_bUsed[i])
+				ret = _mm_or_si128(ret, _mm_sll_epi16(Scale(pPlanes, i), m_Shifts[i]));
+		}
+		return ret;
+	}
+
+	// Eight pixels with each one in the low half of a 32-bit lane.
+	void Pack32(const __m128i *pPlanes, __m128i *pLow, __m128i *pHigh) const
+	{
+		__m128i ret = Pack(pPlanes);
+		*pLow = _mm_unpacklo_epi16(ret, _mm_setzero_si128());
+		*pHigh = _mm_unpackhi_epi16(ret, _mm_setzero_si128());
+	}
+
+	void Store(const __m128i *pPlanes, uint8 *pDest) const
+	{
+		_mm_storeu_si128((__m128i*)pDest, Pack(pPlanes));
+	}
+
+	// Stores four pixels held in 32-bit lanes.
+	static void StoreRow(uint8 *pDest, __m128i pixels)
+	{
+		// Sign extend so the saturating pack keeps the low halves as they are.
+		pixels = _mm_srai_epi32(_mm_slli_epi32(pixels, 16), 16);
+		_mm_storel_epi64((__m128i*)pDest, _mm_packs_epi32(pixels, pixels));
+	}
+};
+
+
+class SSE_BFto32 : public BaseSSE_BFToAny
+{
+public:
+	enum { k_nBlockBytes = 8 * sizeof(uint32) };
+	typedef uint32 Pixel;
+
+	void Pack32(const __m128i *pPlanes, __m128i *pLow, __m128i *pHigh) const
+	{
+		__m128i zero = _mm_setzero_si128();
+		__m128i low = zero, high = zero;
+		for(uint32 i=0; i < NUM_COLORPLANES; i++)
+		{
+			if(!m_bUsed[i])
+				continue;
+
+			__m128i val = Scale(pPlanes, i);
+			low = _mm_or_si128(low, _mm_sll_epi32(_mm_unpacklo_epi16(val, zero), m_Shifts[i]));
+			high = _mm_or_si128(high, _mm_sll_epi32(_mm_unpackhi_epi16(val, zero), m_Shifts[i]));
+		}
+		*pLow = low;
+		*pHigh = high;
+	}
+
+	void Store(const __m128i *pPlanes, uint8 *pDest) const
+	{
+		__m128i low, high;
+		Pack32(pPlanes, &low, &high);
+		_mm_storeu_si128((__m128i*)pDest, low);
+		_mm_storeu_si128((__m128i*)(pDest + 16), high);
+	}
+
+	static void StoreRow(uint8 *pDest, __m128i pixels)
+	{
+		_mm_storeu_si128((__m128i*)pDest, pixels);
+	}
+};
+
+
+// Converts eight pixels at a time through the SSE2 classes, and whatever's left 
+// at the end of each row through the per-pixel ones.  Returns false without
+// touching anything if the SSE2 classes can't handle the formats.
+template<class SS, class DS, class S, class D>
+bool ConvertSSE(FormatMgr *pFormatMgr, const FMConvertRequest *pRequest, SS *pSrcSSE, DS *pDestSSE, S *pSrcTo32Bit, D *p32BitToDest)
+{
+	uint8 *pSrcLine, *pDestLine, *pSrcPos, *pDestPos;
+	uint32 yCount, xCount;
+	SS srcSSE;
+	DS destSSE;
+	S srcConvert;
+	D destConvert;
+	__m128i planes[NUM_COLORPLANES];
+	uint32 tempPixel;
+
+	if(!pFormatMgr->m_bUseSIMD || 
+		!srcSSE.Init(pFormatMgr, pRequest) || 
+		!destSSE.Init(pFormatMgr, pRequest->m_pDestFormat))
+	{
+		return false;
+	}
+
+	srcConvert.Init(pFormatMgr, pRequest);
+	destConvert.Init(pFormatMgr, pRequest);
+
+	pSrcLine = pRequest->m_pSrc;
+	pDestLine = pRequest->m_pDest;
+	yCount = pRequest->m_Height;
+	while (yCount) {
+		--yCount;
+
+		pSrcPos = pSrcLine;
+		pDestPos = pDestLine;
+		xCount = pRequest->m_Width;
+
+		while (xCount >= 8)
+		{
+			xCount -= 8;
+
+			srcSSE.Unpack(pSrcPos, planes);
+			destSSE.Store(planes, pDestPos);
+
+			pSrcPos += SS::k_nBlockBytes;
+			pDestPos += DS::k_nBlockBytes;
+		}
+
+		while (xCount) 
+		{
+			--xCount;
+			
+			srcConvert.Convert(pSrcPos, (uint8*)&tempPixel);
+			destConvert.Convert((uint8*)&tempPixel, pDestPos);			
+		
+			srcConvert.IncSrc(pSrcPos);
+			destConvert.IncDest(pDestPos); 
+		}
+
+		pSrcLine += pRequest->m_SrcPitch;
+		pDestLine += pRequest->m_DestPitch;
+	}
+
+	return true;
+}
+
+#endif // PIXELFORMAT_SSE2
+
 // --------------------------------------------------------------------------------- //
 // All the conversion function callbacks.
 // --------------------------------------------------------------------------------- //
@@ -706,12 +1018,22 @@ LTRESULT Convert16to16(FormatMgr *pFormatMgr, const FMConvertRequest *pRequest,
 	}
 	else
 	{
+#ifdef PIXELFORMAT_SSE2
+		if(!pTransColor && ConvertSSE(pFormatMgr, pRequest, (SSE_16toBF*)LTNULL, (SSE_BFto16*)LTNULL, (CC_16toBF*)LTNULL, (CC_BFto16*)LTNULL))
+			return LT_OK;
+#endif
+
 		return Convert2Pass(pFormatMgr, pRequest, (CC_16toBF*)LTNULL, (CC_BFto16*)LTNULL, pTransColor);
 	}
 }
 
 LTRESULT Convert16to32(FormatMgr *pFormatMgr, const FMConvertRequest *pRequest, LTRGB* pTransColor)
 {
+#ifdef PIXELFORMAT_SSE2
+	if(!pTransColor && ConvertSSE(pFormatMgr, pRequest, (SSE_16toBF*)LTNULL, (SSE_BFto32*)LTNULL, (CC_16toBF*)LTNULL, (CC_BFto32*)LTNULL))
+		return LT_OK;
+#endif
+
 	if(pRequest->m_pDestFormat->IsSameFormat(&pFormatMgr->m_32BitFormat))
 	{
 		return Convert1Pass(pFormatMgr, pRequest, (CC_16toBF*)LTNULL, pTransColor);
@@ -750,6 +1072,11 @@ LTRESULT Convert32to8(FormatMgr *pFormatMgr, const FMConvertRequest *pRequest, L
 
 LTRESULT Convert32to16(FormatMgr *pFormatMgr, const FMConvertRequest *pRequest, LTRGB* pTransColor)
 {
+#ifdef PIXELFORMAT_SSE2
+	if(!pTransColor && ConvertSSE(pFormatMgr, pRequest, (SSE_32toBF*)LTNULL, (SSE_BFto16*)LTNULL, (CC_32toBF*)LTNULL, (CC_BFto16*)LTNULL))
+		return LT_OK;
+#endif
+
 	if(pRequest->m_pSrcFormat->IsSameFormat(&pFormatMgr->m_32BitFormat))
 	{
 		return Convert1Pass(pFormatMgr, pRequest, (CC_BFto16*)LTNULL, pTransColor);
@@ -778,6 +1105,11 @@ LTRESULT Convert32to32(FormatMgr *pFormatMgr, const FMConvertRequest *pRequest,
 	}
 	else
 	{
+#ifdef PIXELFORMAT_SSE2
+		if(!pTransColor && ConvertSSE(pFormatMgr, pRequest, (SSE_32toBF*)LTNULL, (SSE_BFto32*)LTNULL, (CC_32toBF*)LTNULL, (CC_BFto32*)LTNULL))
+			return LT_OK;
+#endif
+
 		return Convert2Pass(pFormatMgr, pRequest, (CC_32toBF*)LTNULL, (CC_BFto32*)LTNULL, pTransColor);
 	}
 }
@@ -794,6 +1126,91 @@ LTRESULT Convert32Pto32(FormatMgr *pFormatMgr, const FMConvertRequest *pRequest,
 }					   
 					   
 
+// Fills in the 4 colors of a DXT color block in the base format.
+static void GetDXTColors(CC_16toBF *pCC16toBF, uint8 *pSrcPos8, 
+	uint32 defaultPValueAlphaMask, uint32 defaultByteAlphaMask, uint32 *pIdent32)
+{
+	uint16 *pSrcPos16;
+	uint16 val1, val2;
+	uint32 comp[2][4];
+
+	pSrcPos16 = (uint16*)pSrcPos8;
+
+	// 16-bit 565 values.
+	val1 = *pSrcPos16;
+	val2 = *(pSrcPos16 + 1);
+
+	// Convert to base format.
+	pCC16toBF->Convert((uint8*)&val1, (uint8*)&pIdent32[0]);
+	pCC16toBF->Convert((uint8*)&val2, (uint8*)&pIdent32[1]);
+
+	// Get the components.
+	PValue_Get(pIdent32[0], comp[0][0], comp[0][1], comp[0][2], comp[0][3]);
+	PValue_Get(pIdent32[1], comp[1][0], comp[1][1], comp[1][2], comp[1][3]);
+
+	pIdent32[0] |= defaultPValueAlphaMask;
+	pIdent32[1] |= defaultPValueAlphaMask;
+
+	// Convert to output format.
+	if(val1 > val2)
+	{
+		// 4-color block, alpha is opaque.
+		pIdent32[2] = PValue_Set(
+			defaultByteAlphaMask,
+			(comp[0][1]*2 + comp[1][1]) / 3,
+			(comp[0][2]*2 + comp[1][2]) / 3,
+			(comp[0][3]*2 + comp[1][3]) / 3);
+		
+		pIdent32[3] = PValue_Set(
+			defaultByteAlphaMask,
+			(comp[0][1] + comp[1][1]*2) / 3,
+			(comp[0][2] + comp[1][2]*2) / 3,
+			(comp[0][3] + comp[1][3]*2) / 3);
+	}
+	else
+	{
+		// 3-color block, last color is translucent alpha.
+		pIdent32[2] = PValue_Set(
+			defaultByteAlphaMask,
+			(comp[0][1] + comp[1][1]) >> 1,
+			(comp[0][2] + comp[1][2]) >> 1,
+			(comp[0][3] + comp[1][3]) >> 1);
+
+		pIdent32[3] = 0;
+	}
+}
+
+
+// Fills in the 8 alpha values of a DXT5 alpha block.
+static void GetDXT5Alphas(uint8 *pSrcPos8, uint32 *pAlphas)
+{
+	// 2 bytes for the alpha values.
+	pAlphas[0] = *pSrcPos8;
+	pAlphas[1] = *(pSrcPos8+1);
+
+	if(pAlphas[0] > pAlphas[1])
+	{
+		// 8 values going between these alpha values.
+		pAlphas[2] = (pAlphas[0]*6 + pAlphas[1]*1) / 7;
+		pAlphas[3] = (pAlphas[0]*5 + pAlphas[1]*2) / 7;
+		pAlphas[4] = (pAlphas[0]*4 + pAlphas[1]*3) / 7;
+		pAlphas[5] = (pAlphas[0]*3 + pAlphas[1]*4) / 7;
+		pAlphas[6] = (pAlphas[0]*2 + pAlphas[1]*5) / 7;
+		pAlphas[7] = (pAlphas[0]*1 + pAlphas[1]*6) / 7;
+	}
+	else
+	{
+		// 6 values going between these alpha values.  The others are 0 and 0xFF.						
+		pAlphas[2] = (pAlphas[0]*4 + pAlphas[1]*1) / 5;
+		pAlphas[3] = (pAlphas[0]*3 + pAlphas[1]*2) / 5;
+		pAlphas[4] = (pAlphas[0]*2 + pAlphas[1]*3) / 5;
+		pAlphas[5] = (pAlphas[0]*1 + pAlphas[1]*4) / 5;
+		pAlphas[6] = 0;
+		pAlphas[7] = 0xFF;
+	}
+}
+
+
 template<class C, class A>
 LTRESULT ConvertDXTGeneric(FormatMgr *pFormatMgr,
 	const FMConvertRequest *pRequest, C *pConvert, A *pAbstract)
@@ -804,11 +1221,9 @@ LTRESULT ConvertDXTGeneric(FormatMgr *pFormatMgr,
 	uint32 nBlocksX, nBlocksY;
 	uint32 xBlock, yBlock;
 	uint32 ident32[4];
-	uint32 comp[2][4];
+	uint32 alphas[8];
 	uint8 *pSrcPos8;
-	uint16 *pSrcPos16;
 	void *pDestPos;
-	uint16 val1, val2;
 	uint32 i, blockData, bytesPerBlockShift, alphaExtra, invAlphaMask;
 	LTBOOL bAlpha, bInterpolatedAlpha;
 	uint32 tempIndex;
@@ -866,50 +1281,8 @@ LTRESULT ConvertDXTGeneric(FormatMgr *pFormatMgr,
 		{
 			pSrcPos8 = pRequest->m_pSrc + (xBlock<<bytesPerBlockShift) + ((yBlock*nBlocksX)<<bytesPerBlockShift);
 			pSrcPos8 += alphaExtra;
-			pSrcPos16 = (uint16*)pSrcPos8;
-
-			// 16-bit 565 values.
-			val1 = *pSrcPos16;
-			val2 = *(pSrcPos16 + 1);
 
-			// Convert to base format.
-			cc16toBF.Convert((uint8*)&val1, (uint8*)&ident32[0]);
-			cc16toBF.Convert((uint8*)&val2, (uint8*)&ident32[1]);
-
-			// Get the components.
-			PValue_Get(ident32[0], comp[0][0], comp[0][1], comp[0][2], comp[0][3]);
-			PValue_Get(ident32[1], comp[1][0], comp[1][1], comp[1][2], comp[1][3]);
-
-			ident32[0] |= defaultPValueAlphaMask;
-			ident32[1] |= defaultPValueAlphaMask;
-
-			// Convert to output format.
-			if(val1 > val2)
-			{
-				// 4-color block, alpha is opaque.
-				ident32[2] = PValue_Set(
-					defaultByteAlphaMask,
-					(comp[0][1]*2 + comp[1][1]) / 3,
-					(comp[0][2]*2 + comp[1][2]) / 3,
-					(comp[0][3]*2 + comp[1][3]) / 3);
-				
-				ident32[3] = PValue_Set(
-					defaultByteAlphaMask,
-					(comp[0][1] + comp[1][1]*2) / 3,
-					(comp[0][2] + comp[1][2]*2) / 3,
-					(comp[0][3] + comp[1][3]*2) / 3);
-			}
-			else
-			{
-				// 3-color block, last color is translucent alpha.
-				ident32[2] = PValue_Set(
-					defaultByteAlphaMask,
-					(comp[0][1] + comp[1][1]) >> 1,
-					(comp[0][2] + comp[1][2]) >> 1,
-					(comp[0][3] + comp[1][3]) >> 1);
-
-				ident32[3] = 0;
-			}
+			GetDXTColors(&cc16toBF, pSrcPos8, defaultPValueAlphaMask, defaultByteAlphaMask, ident32);
 
 			ccBFtoGeneric.Convert((uint8*)&ident32[0], (uint8*)&abstract.m_Ident[0]);
 			ccBFtoGeneric.Convert((uint8*)&ident32[1], (uint8*)&abstract.m_Ident[1]);
@@ -936,41 +1309,14 @@ LTRESULT ConvertDXTGeneric(FormatMgr *pFormatMgr,
 
 				if(bInterpolatedAlpha)
 				{
-					// 2 bytes for the alpha values.
-					ALPHAVAL[0] = *pSrcPos8;
-					ALPHAVAL[1] = *(pSrcPos8+1);
+					GetDXT5Alphas(pSrcPos8, alphas);
 
-					if(ALPHAVAL[0] > ALPHAVAL[1])
-					{
-						// 8 values going between these alpha values.
-						ALPHAVAL[2] = (ALPHAVAL[0]*6 + ALPHAVAL[1]*1) / 7;
-						ALPHAVAL[3] = (ALPHAVAL[0]*5 + ALPHAVAL[1]*2) / 7;
-						ALPHAVAL[4] = (ALPHAVAL[0]*4 + ALPHAVAL[1]*3) / 7;
-						ALPHAVAL[5] = (ALPHAVAL[0]*3 + ALPHAVAL[1]*4) / 7;
-						ALPHAVAL[6] = (ALPHAVAL[0]*2 + ALPHAVAL[1]*5) / 7;
-						ALPHAVAL[7] = (ALPHAVAL[0]*1 + ALPHAVAL[1]*6) / 7;
-					}
-					else
+					// Put them in the dest format.
+					for(i=0; i < 8; i++)
 					{
-						// 6 values going between these alpha values.  The others are 0 and 0xFF.						
-						ALPHAVAL[2] = (ALPHAVAL[0]*4 + ALPHAVAL[1]*1) / 5;
-						ALPHAVAL[3] = (ALPHAVAL[0]*3 + ALPHAVAL[1]*2) / 5;
-						ALPHAVAL[4] = (ALPHAVAL[0]*2 + ALPHAVAL[1]*3) / 5;
-						ALPHAVAL[5] = (ALPHAVAL[0]*1 + ALPHAVAL[1]*4) / 5;
-						ALPHAVAL[6] = 0;
-						ALPHAVAL[7] = 0xFF;
+						ALPHAVAL[i] = pAlphaScaleTable[alphas[i]] << alphaShift;
 					}
 
-					// Put them in the dest format.
-					ALPHAVAL[0] = pAlphaScaleTable[ALPHAVAL[0]] << alphaShift;
-					ALPHAVAL[1] = pAlphaScaleTable[ALPHAVAL[1]] << alphaShift;
-					ALPHAVAL[2] = pAlphaScaleTable[ALPHAVAL[2]] << alphaShift;
-					ALPHAVAL[3] = pAlphaScaleTable[ALPHAVAL[3]] << alphaShift;
-					ALPHAVAL[4] = pAlphaScaleTable[ALPHAVAL[4]] << alphaShift;
-					ALPHAVAL[5] = pAlphaScaleTable[ALPHAVAL[5]] << alphaShift;
-					ALPHAVAL[6] = pAlphaScaleTable[ALPHAVAL[6]] << alphaShift;
-					ALPHAVAL[7] = pAlphaScaleTable[ALPHAVAL[7]] << alphaShift;
-
 					// 6 bytes for the pixels (3 bits per pixel, 16 pixels, 
 					// 3*16=48 bits=6 bytes).  
 					alphaData[0] = *((uint32*)(pSrcPos8+2));
@@ -1014,13 +1360,310 @@ LTRESULT ConvertDXTGeneric(FormatMgr *pFormatMgr,
 }
 
 
+#ifdef PIXELFORMAT_SSE2
+
+// Divides 16-bit lanes by 3, 5 and 7 for the DXT palettes.  These are exact for
+// anything the palette math can give them.
+inline __m128i DXTDiv3(__m128i val) { return _mm_srli_epi16(_mm_mulhi_epu16(val, _mm_set1_epi16((short)0xAAAB)), 1); }
+inline __m128i DXTDiv5(__m128i val) { return _mm_mulhi_epu16(val, _mm_set1_epi16(13108)); }
+inline __m128i DXTDiv7(__m128i val) { return _mm_mulhi_epu16(val, _mm_set1_epi16(9363)); }
+
+// Picks b where the mask is set and c where it isn't.
+inline __m128i DXTSelect(__m128i mask, __m128i b, __m128i c)
+{
+	return _mm_or_si128(_mm_and_si128(mask, b), _mm_andnot_si128(mask, c));
+}
+
+
+// Same as ConvertDXTGeneric, but works out the palettes for 8 blocks at a time 
+// and picks the colors and alpha values for a whole row of a block at once.  
+// Returns false without touching anything if the SSE2 classes can't handle the 
+// destination format.
+template<class DS>
+bool ConvertDXTSSE(FormatMgr *pFormatMgr, const FMConvertRequest *pRequest, DS *pDestSSE)
+{
+	enum { k_nBatch = 8 };
+
+	SSE_16toBF sse16toBF;
+	DS destSSE;
+	uint32 nBlocksX, nBlocksY, nBatch;
+	uint32 xBatch, xBlock, yBlock;
+	uint8 *pSrcPos8, *pDestPos;
+	uint32 i, k, blockData, bytesPerBlockShift, alphaExtra;
+	uint32 alphaData[2], alphaRows[4];
+	LTBOOL bAlpha, bInterpolatedAlpha;
+	uint16 colorEnds[2][k_nBatch], alphaEnds[2][k_nBatch];
+	uint32 colorPalettes[4][k_nBatch], alphaPalettes[8][k_nBatch];
+	__m128i planes[NUM_COLORPLANES], ends[2][NUM_COLORPLANES], palettes[4][NUM_COLORPLANES];
+	__m128i colors[4], alphaVals[8], rows[4], alphaLow, alphaHigh, fourColor, eightAlpha;
+	__m128i colorIndexMask, colorIndices[4], alphaIndexMask, alphaIndices[8];
+	__m128i invAlphaMask, nibbleShift, opaque, signBit, alpha0, alpha1;
+
+	if(!pFormatMgr->m_bUseSIMD || 
+		!sse16toBF.Init(pFormatMgr, &pFormatMgr->m_RGB565Format) ||
+		!destSSE.Init(pFormatMgr, pRequest->m_pDestFormat))
+	{
+		return false;
+	}
+
+	// Will we be decompressing with alpha?  The colors are opaque unless DXT5 
+	// alpha is going to be ORed into them.
+	opaque = _mm_set1_epi16(0xFF);
+	bAlpha = bInterpolatedAlpha = LTFALSE;
+	if(pRequest->m_pSrcFormat->GetType() == BPP_S3TC_DXT3)
+	{
+		bAlpha = LTTRUE;
+	}
+	else if(pRequest->m_pSrcFormat->GetType() == BPP_S3TC_DXT5)
+	{
+		bAlpha = bInterpolatedAlpha = LTTRUE;
+		opaque = _mm_setzero_si128();
+	}
+
+	invAlphaMask = _mm_set1_epi32(~pRequest->m_pDestFormat->m_Masks[CP_ALPHA]);
+
+	if(bAlpha)
+	{
+		bytesPerBlockShift = 4;
+		alphaExtra = 8; // 8 bytes of alpha data.
+	}
+	else
+	{
+		bytesPerBlockShift = 3;
+		alphaExtra = 0;
+	}
+
+	// Each lane picks out the index of its pixel in the row.
+	colorIndexMask = _mm_setr_epi32(3, 3<<2, 3<<4, 3<<6);
+	for(k=0; k < 4; k++)
+	{
+		colorIndices[k] = _mm_setr_epi32(k, k<<2, k<<4, k<<6);
+	}
+
+	alphaIndexMask = _mm_setr_epi32(7, 7<<3, 7<<6, 7<<9);
+	for(k=0; k < 8; k++)
+	{
+		alphaIndices[k] = _mm_setr_epi32(k, k<<3, k<<6, k<<9);
+	}
+
+	// Moves each pixel's DXT3 alpha nibble to the top of its 16-bit lane.
+	nibbleShift = _mm_setr_epi16(1<<12, 1<<8, 1<<4, 1, 1<<12, 1<<8, 1<<4, 1);
+
+	// For unsigned 16-bit compares.
+	signBit = _mm_set1_epi16((short)0x8000);
+
+	for(i=0; i < NUM_COLORPLANES; i++)
+	{
+		planes[i] = _mm_setzero_si128();
+	}
+
+	memset(colorEnds, 0, sizeof(colorEnds));
+	memset(alphaEnds, 0, sizeof(alphaEnds));
+
+	nBlocksX = pRequest->m_Width >> 2;
+	nBlocksY = pRequest->m_Height >> 2;
+
+	// For each row of blocks...
+	for(yBlock=0; yBlock < nBlocksY; yBlock++)
+	{
+		for(xBatch=0; xBatch < nBlocksX; xBatch += k_nBatch)
+		{
+			nBatch = LTMIN(nBlocksX - xBatch, (uint32)k_nBatch);
+
+			// Gather up the ends of each block's ranges.
+			for(xBlock=0; xBlock < nBatch; xBlock++)
+			{
+				pSrcPos8 = pRequest->m_pSrc + ((xBatch + xBlock)<<bytesPerBlockShift) + ((yBlock*nBlocksX)<<bytesPerBlockShift);
+
+				colorEnds[0][xBlock] = *((uint16*)(pSrcPos8 + alphaExtra));
+				colorEnds[1][xBlock] = *((uint16*)(pSrcPos8 + alphaExtra + 2));
+				alphaEnds[0][xBlock] = pSrcPos8[0];
+				alphaEnds[1][xBlock] = pSrcPos8[1];
+			}
+
+			// Color palettes, the same as GetDXTColors.
+			sse16toBF.Unpack((uint8*)colorEnds[0], ends[0]);
+			sse16toBF.Unpack((uint8*)colorEnds[1], ends[1]);
+			fourColor = _mm_cmpgt_epi16(
+				_mm_xor_si128(_mm_loadu_si128((const __m128i*)colorEnds[0]), signBit),
+				_mm_xor_si128(_mm_loadu_si128((const __m128i*)colorEnds[1]), signBit));
+
+			for(i=CP_RED; i <= CP_BLUE; i++)
+			{
+				__m128i end0 = ends[0][i], end1 = ends[1][i];
+
+				palettes[0][i] = end0;
+				palettes[1][i] = end1;
+				palettes[2][i] = DXTSelect(fourColor, 
+					DXTDiv3(_mm_add_epi16(_mm_add_epi16(end0, end0), end1)),
+					_mm_srli_epi16(_mm_add_epi16(end0, end1), 1));
+				palettes[3][i] = _mm_and_si128(fourColor, 
+					DXTDiv3(_mm_add_epi16(end0, _mm_add_epi16(end1, end1))));
+			}
+
+			palettes[0][CP_ALPHA] = palettes[1][CP_ALPHA] = palettes[2][CP_ALPHA] = opaque;
+			palettes[3][CP_ALPHA] = _mm_and_si128(fourColor, opaque);
+
+			for(k=0; k < 4; k++)
+			{
+				destSSE.Pack32(palettes[k], &alphaLow, &alphaHigh);
+				_mm_storeu_si128((__m128i*)&colorPalettes[k][0], alphaLow);
+				_mm_storeu_si128((__m128i*)&colorPalettes[k][4], alphaHigh);
+			}
+
+			// Alpha palettes, the same as GetDXT5Alphas.
+			if(bInterpolatedAlpha)
+			{
+				alpha0 = _mm_loadu_si128((const __m128i*)alphaEnds[0]);
+				alpha1 = _mm_loadu_si128((const __m128i*)alphaEnds[1]);
+				eightAlpha = _mm_cmpgt_epi16(alpha0, alpha1);
+
+				for(k=0; k < 8; k++)
+				{
+					if(k == 0)
+					{
+						planes[CP_ALPHA] = alpha0;
+					}
+					else if(k == 1)
+					{
+						planes[CP_ALPHA] = alpha1;
+					}
+					else
+					{
+						// 8 values going between the ends, or 6 and then 0 and 0xFF.
+						__m128i eight = DXTDiv7(_mm_add_epi16(
+							_mm_mullo_epi16(alpha0, _mm_set1_epi16((short)(8-k))),
+							_mm_mullo_epi16(alpha1, _mm_set1_epi16((short)(k-1)))));
+						__m128i six;
+
+						if(k < 6)
+						{
+							six = DXTDiv5(_mm_add_epi16(
+								_mm_mullo_epi16(alpha0, _mm_set1_epi16((short)(6-k))),
+								_mm_mullo_epi16(alpha1, _mm_set1_epi16((short)(k-1)))));
+						}
+						else
+						{
+							six = _mm_set1_epi16((k == 6) ? 0 : 0xFF);
+						}
+
+						planes[CP_ALPHA] = DXTSelect(eightAlpha, eight, six);
+					}
+
+					// Put them in the dest format.
+					destSSE.Pack32(planes, &alphaLow, &alphaHigh);
+					_mm_storeu_si128((__m128i*)&alphaPalettes[k][0], alphaLow);
+					_mm_storeu_si128((__m128i*)&alphaPalettes[k][4], alphaHigh);
+				}
+			}
+
+			// Now decode each block.
+			for(xBlock=0; xBlock < nBatch; xBlock++)
+			{
+				pSrcPos8 = pRequest->m_pSrc + ((xBatch + xBlock)<<bytesPerBlockShift) + ((yBlock*nBlocksX)<<bytesPerBlockShift);
+
+				for(k=0; k < 4; k++)
+				{
+					colors[k] = _mm_set1_epi32(colorPalettes[k][xBlock]);
+				}
+
+				// The next 4 bytes are the pixel data, a byte per row.
+				blockData = *((uint32*)(pSrcPos8 + alphaExtra + 4));
+				for(i=0; i < 4; i++)
+				{
+					__m128i index = _mm_and_si128(_mm_set1_epi32((blockData >> (i*8)) & 0xFF), colorIndexMask);
+
+					rows[i] = _mm_and_si128(_mm_cmpeq_epi32(index, colorIndices[0]), colors[0]);
+					for(k=1; k < 4; k++)
+					{
+						rows[i] = _mm_or_si128(rows[i], 
+							_mm_and_si128(_mm_cmpeq_epi32(index, colorIndices[k]), colors[k]));
+					}
+				}
+
+				// Read in the alpha block?
+				if(bInterpolatedAlpha)
+				{
+					for(k=0; k < 8; k++)
+					{
+						alphaVals[k] = _mm_set1_epi32(alphaPalettes[k][xBlock]);
+					}
+
+					// 6 bytes for the pixels, 12 bits per row.
+					alphaData[0] = *((uint32*)(pSrcPos8+2));
+					alphaData[1] = *((uint16*)(pSrcPos8+6));
+
+					alphaRows[0] = alphaData[0] & 0xFFF;
+					alphaRows[1] = (alphaData[0] >> 12) & 0xFFF;
+					alphaRows[2] = (alphaData[0] >> 24) | ((alphaData[1] & 0xF) << 8);
+					alphaRows[3] = alphaData[1] >> 4;
+
+					for(i=0; i < 4; i++)
+					{
+						__m128i index = _mm_and_si128(_mm_set1_epi32(alphaRows[i]), alphaIndexMask);
+
+						for(k=0; k < 8; k++)
+						{
+							rows[i] = _mm_or_si128(rows[i], 
+								_mm_and_si128(_mm_cmpeq_epi32(index, alphaIndices[k]), alphaVals[k]));
+						}
+					}
+				}
+				else if(bAlpha)
+				{
+					planes[CP_ALPHA] = _mm_setzero_si128();
+
+					// 4 bits per pixel, 2 rows at a time.
+					for(i=0; i < 2; i++)
+					{
+						blockData = *((uint32*)(pSrcPos8 + i*4));
+
+						__m128i nibbles = _mm_setr_epi16(
+							(short)blockData, (short)blockData, (short)blockData, (short)blockData, 
+							(short)(blockData >> 16), (short)(blockData >> 16), (short)(blockData >> 16), (short)(blockData >> 16));
+						nibbles = _mm_srli_epi16(_mm_mullo_epi16(nibbles, nibbleShift), 12);
+						planes[CP_ALPHA] = _mm_mullo_epi16(nibbles, _mm_set1_epi16(17));
+
+						destSSE.Pack32(planes, &alphaLow, &alphaHigh);
+						rows[i*2+0] = _mm_or_si128(_mm_and_si128(rows[i*2+0], invAlphaMask), alphaLow);
+						rows[i*2+1] = _mm_or_si128(_mm_and_si128(rows[i*2+1], invAlphaMask), alphaHigh);
+					}
+				}
+
+				pDestPos = pRequest->m_pDest + 
+					((yBlock<<2) * pRequest->m_DestPitch) + ((xBatch + xBlock)<<2) * sizeof(typename DS::Pixel);
+				for(i=0; i < 4; i++)
+				{
+					DS::StoreRow(pDestPos, rows[i]);
+					pDestPos += pRequest->m_DestPitch;
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+#endif // PIXELFORMAT_SSE2
+
+
 LTRESULT ConvertDXTto16(FormatMgr *pFormatMgr, const FMConvertRequest *pRequest, LTRGB* pTransColor)
 {
+#ifdef PIXELFORMAT_SSE2
+	if(ConvertDXTSSE(pFormatMgr, pRequest, (SSE_BFto16*)LTNULL))
+		return LT_OK;
+#endif
+
 	return ConvertDXTGeneric(pFormatMgr, pRequest, (CC_BFto16*)LTNULL, (Abstract_Word*)LTNULL);
 }
 
 LTRESULT ConvertDXTto32(FormatMgr *pFormatMgr, const FMConvertRequest *pRequest, LTRGB* pTransColor)
 {
+#ifdef PIXELFORMAT_SSE2
+	if(ConvertDXTSSE(pFormatMgr, pRequest, (SSE_BFto32*)LTNULL))
+		return LT_OK;
+#endif
+
 	return ConvertDXTGeneric(pFormatMgr, pRequest, (CC_BFto32*)LTNULL, (Abstract_DWord*)LTNULL);
 }
 
@@ -1290,6 +1933,7 @@ FormatMgr::FormatMgr()
 {
 	m_32BitFormat.InitPValueFormat();
 	m_RGB565Format.Init(BPP_16, 0, 0xF800, 0x7E0, 0x1F);
+	m_bUseSIMD = true;
 
 	InitScaleTables();
 }
@@ -1410,6 +2054,49 @@ void FormatMgr::InitScaleTables()
 		{
 			m_ScaleFrom8[i][j] = (uint8)((j * maxVal) / 255);
 		}
+
+		InitScaleTo8Mul(i);
+	}
+}
+
+
+void FormatMgr::InitScaleTo8Mul(uint32 nBits)
+{
+	uint32 maxVal, preShift, shift, mul, pre, j;
+	ScaleTo8Mul &scale = m_ScaleTo8Mul[nBits];
+
+	scale.m_Pre = scale.m_Mul = scale.m_Shift = 0;
+
+	maxVal = (1 << nBits) - 1;
+	if(maxVal == 0)
+		return;
+
+	// (j * 255) / maxVal is about (j * 255 * 2^(16+shift) / maxVal) >> (16+shift).  Try
+	// the multipliers closest to that and keep the first that matches the table
+	// exactly.  j * pre has to stay within 16 bits.
+	for(preShift=0; (maxVal * (255 << preShift)) <= 0xFFFF; preShift++)
+	{
+		pre = 255 << preShift;
+		for(shift=0; shift < 16; shift++)
+		{
+			uint32 estimate = ((1 << (16 + shift)) + (maxVal << preShift) - 1) / (maxVal << preShift);
+			for(mul=estimate ? estimate-1 : 0; mul <= estimate+1 && mul <= 0xFFFF; mul++)
+			{
+				for(j=0; j <= maxVal; j++)
+				{
+					if((((j * pre) * mul) >> (16 + shift)) != m_ScaleTo8[nBits][j])
+						break;
+				}
+
+				if(j > maxVal)
+				{
+					scale.m_Pre = (uint16)pre;
+					scale.m_Mul = (uint16)mul;
+					scale.m_Shift = (uint16)shift;
+					return;
+				}
+			}
+		}
 	}
 }
 
@@ -185,6 +185,17 @@ public:
 };
 
 
+// Scales X bits to 8 the same as a FormatMgr::m_ScaleTo8 table, with two 16-bit
+// multiplies and a shift: ((value * m_Pre) * m_Mul) >> (16 + m_Shift).
+// m_Mul is 0 if no values were found that match the table.
+struct ScaleTo8Mul
+{
+    uint16      m_Pre;
+    uint16      m_Mul;
+    uint16      m_Shift;
+};
+
+
 class FormatMgr 
 {
 public:
@@ -205,6 +216,7 @@ public:
 
 protected:
     void        InitScaleTables();
+    void        InitScaleTo8Mul(uint32 nBits);
 
 public:
     // The internal format used for 32-bit pixel conversion.
@@ -226,6 +238,13 @@ public:
     uint8       m_6to8[(1<<6)];
     uint8       m_7to8[(1<<7)];
     uint8       m_8to8[(1<<8)];
+
+    // Multipliers matching m_ScaleTo8 for the SSE2 converters.
+    ScaleTo8Mul m_ScaleTo8Mul[NUM_SCALE_TABLES];
+
+    // Convert 16 and 32-bit formats and decompress DXT blocks with SSE2 where it's 
+    // compiled in.  Turning this off sends everything through the per-pixel converters.
+    bool        m_bUseSIMD;
 };
 
 
@@ -0,0 +1,158 @@
+#include "bdefs.h"
+#include "sha256.h"
+
+
+static const uint32 g_SHA256Constants[64] =
+{
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+
+inline uint32 sha256_RotR(uint32 x, uint32 n)
+{
+	return (x >> n) | (x << (32 - n));
+}
+
+
+static void sha256_Transform(SHA256Context *pContext, const uint8 *pBlock)
+{
+	uint32 w[64];
+	uint32 i;
+
+	for (i=0; i < 16; i++)
+	{
+		w[i] = ((uint32)pBlock[i*4] << 24) | ((uint32)pBlock[i*4+1] << 16) |
+			((uint32)pBlock[i*4+2] << 8) | (uint32)pBlock[i*4+3];
+	}
+
+	for (i=16; i < 64; i++)
+	{
+		uint32 s0 = sha256_RotR(w[i-15], 7) ^ sha256_RotR(w[i-15], 18) ^ (w[i-15] >> 3);
+		uint32 s1 = sha256_RotR(w[i-2], 17) ^ sha256_RotR(w[i-2], 19) ^ (w[i-2] >> 10);
+		w[i] = w[i-16] + s0 + w[i-7] + s1;
+	}
+
+	uint32 a = pContext->m_State[0];
+	uint32 b = pContext->m_State[1];
+	uint32 c = pContext->m_State[2];
+	uint32 d = pContext->m_State[3];
+	uint32 e = pContext->m_State[4];
+	uint32 f = pContext->m_State[5];
+	uint32 g = pContext->m_State[6];
+	uint32 h = pContext->m_State[7];
+
+	for (i=0; i < 64; i++)
+	{
+		uint32 S1 = sha256_RotR(e, 6) ^ sha256_RotR(e, 11) ^ sha256_RotR(e, 25);
+		uint32 ch = (e & f) ^ (~e & g);
+		uint32 temp1 = h + S1 + ch + g_SHA256Constants[i] + w[i];
+		uint32 S0 = sha256_RotR(a, 2) ^ sha256_RotR(a, 13) ^ sha256_RotR(a, 22);
+		uint32 maj = (a & b) ^ (a & c) ^ (b & c);
+		uint32 temp2 = S0 + maj;
+
+		h = g;
+		g = f;
+		f = e;
+		e = d + temp1;
+		d = c;
+		c = b;
+		b = a;
+		a = temp1 + temp2;
+	}
+
+	pContext->m_State[0] += a;
+	pContext->m_State[1] += b;
+	pContext->m_State[2] += c;
+	pContext->m_State[3] += d;
+	pContext->m_State[4] += e;
+	pContext->m_State[5] += f;
+	pContext->m_State[6] += g;
+	pContext->m_State[7] += h;
+}
+
+
+void sha256_Init(SHA256Context *pContext)
+{
+	pContext->m_State[0] = 0x6a09e667;
+	pContext->m_State[1] = 0xbb67ae85;
+	pContext->m_State[2] = 0x3c6ef372;
+	pContext->m_State[3] = 0xa54ff53a;
+	pContext->m_State[4] = 0x510e527f;
+	pContext->m_State[5] = 0x9b05688c;
+	pContext->m_State[6] = 0x1f83d9ab;
+	pContext->m_State[7] = 0x5be0cd19;
+	pContext->m_nBytes = 0;
+	pContext->m_nBlockBytes = 0;
+}
+
+
+void sha256_Update(SHA256Context *pContext, const void *pData, uint32 size)
+{
+	const uint8 *pIn = (const uint8*)pData;
+
+	pContext->m_nBytes += size;
+
+	// Finish off a partial block first.
+	if (pContext->m_nBlockBytes)
+	{
+		uint32 nCopy = LTMIN(size, SHA256_BLOCK_SIZE - pContext->m_nBlockBytes);
+		memcpy(&pContext->m_Block[pContext->m_nBlockBytes], pIn, nCopy);
+		pContext->m_nBlockBytes += nCopy;
+		pIn += nCopy;
+		size -= nCopy;
+
+		if (pContext->m_nBlockBytes < SHA256_BLOCK_SIZE)
+			return;
+
+		sha256_Transform(pContext, pContext->m_Block);
+		pContext->m_nBlockBytes = 0;
+	}
+
+	while (size >= SHA256_BLOCK_SIZE)
+	{
+		sha256_Transform(pContext, pIn);
+		pIn += SHA256_BLOCK_SIZE;
+		size -= SHA256_BLOCK_SIZE;
+	}
+
+	memcpy(pContext->m_Block, pIn, size);
+	pContext->m_nBlockBytes = size;
+}
+
+
+void sha256_Final(SHA256Context *pContext, uint8 *pHash)
+{
+	uint64 nBits = pContext->m_nBytes * 8;
+	uint32 i;
+
+	// Pad with a 1 bit and zeros up to the length, which goes in the last 8 bytes.
+	pContext->m_Block[pContext->m_nBlockBytes++] = 0x80;
+	if (pContext->m_nBlockBytes > SHA256_BLOCK_SIZE - 8)
+	{
+		memset(&pContext->m_Block[pContext->m_nBlockBytes], 0, SHA256_BLOCK_SIZE - pContext->m_nBlockBytes);
+		sha256_Transform(pContext, pContext->m_Block);
+		pContext->m_nBlockBytes = 0;
+	}
+
+	memset(&pContext->m_Block[pContext->m_nBlockBytes], 0, SHA256_BLOCK_SIZE - 8 - pContext->m_nBlockBytes);
+	for (i=0; i < 8; i++)
+	{
+		pContext->m_Block[SHA256_BLOCK_SIZE - 1 - i] = (uint8)(nBits >> (i * 8));
+	}
+	sha256_Transform(pContext, pContext->m_Block);
+
+	for (i=0; i < 8; i++)
+	{
+		pHash[i*4]   = (uint8)(pContext->m_State[i] >> 24);
+		pHash[i*4+1] = (uint8)(pContext->m_State[i] >> 16);
+		pHash[i*4+2] = (uint8)(pContext->m_State[i] >> 8);
+		pHash[i*4+3] = (uint8)pContext->m_State[i];
+	}
+}
@@ -0,0 +1,30 @@
+// SHA-256 (FIPS 180-4).  The file transfer uses it to name cached files by
+// their contents, so a file from one server can't be mistaken for a
+// different one from another server.
+
+#ifndef __SHA256_H__
+#define __SHA256_H__
+
+
+#define SHA256_HASH_SIZE	32
+#define SHA256_BLOCK_SIZE	64
+
+
+struct SHA256Context
+{
+	uint32		m_State[8];
+	uint64		m_nBytes;		// Total bytes hashed so far.
+	uint8		m_Block[SHA256_BLOCK_SIZE];
+	uint32		m_nBlockBytes;	// Bytes waiting in m_Block.
+};
+
+
+void sha256_Init(SHA256Context *pContext);
+void sha256_Update(SHA256Context *pContext, const void *pData, uint32 size);
+
+// Writes the SHA256_HASH_SIZE byte hash to pHash.  The context has to be
+// initialized again before it's used for anything else.
+void sha256_Final(SHA256Context *pContext, uint8 *pHash);
+
+
+#endif  // __SHA256_H__
@@ -0,0 +1,135 @@
+#include "bdefs.h"
+#include "workerpool.h"
+
+
+CWorkerPool::CWorkerPool() :
+	m_pJobFn(LTNULL),
+	m_pJobUser(LTNULL),
+	m_nJobCount(0),
+	m_nNextJob(0),
+	m_nJobsDone(0),
+	m_nActiveWorkers(0),
+	m_nGeneration(0),
+	m_bShutdown(false)
+{
+}
+
+
+CWorkerPool::~CWorkerPool()
+{
+	Term();
+}
+
+
+void CWorkerPool::Init(uint32 nNumThreads)
+{
+	Term();
+
+	if (nNumThreads == 0)
+		nNumThreads = LTMAX(std::thread::hardware_concurrency(), 1);
+
+	m_bShutdown = false;
+
+	// The caller is one of the threads.
+	for (uint32 i = 1; i < nNumThreads; i++)
+	{
+		m_Workers.push_back(std::thread(&CWorkerPool::WorkerMain, this));
+	}
+}
+
+
+void CWorkerPool::Term()
+{
+	if (m_Workers.empty())
+		return;
+
+	{
+		std::lock_guard<std::mutex> cLock(m_Mutex);
+		m_bShutdown = true;
+	}
+	m_StartCondition.notify_all();
+
+	for (std::vector<std::thread>::iterator iCur = m_Workers.begin(); iCur != m_Workers.end(); ++iCur)
+	{
+		iCur->join();
+	}
+	m_Workers.clear();
+}
+
+
+void CWorkerPool::ParallelFor(uint32 nCount, JobFn pFn, void *pUser)
+{
+	if (nCount == 0)
+		return;
+
+	// Not worth waking anyone up.
+	if (m_Workers.empty() || (nCount == 1))
+	{
+		for (uint32 i = 0; i < nCount; i++)
+			pFn(i, pUser);
+		return;
+	}
+
+	{
+		// A worker that woke up late for the last loop may still be on its way out.
+		std::unique_lock<std::mutex> cLock(m_Mutex);
+		m_DoneCondition.wait(cLock, [this] { return m_nActiveWorkers == 0; });
+
+		m_pJobFn = pFn;
+		m_pJobUser = pUser;
+		m_nJobCount = nCount;
+		m_nNextJob = 0;
+		m_nJobsDone = 0;
+		++m_nGeneration;
+	}
+	m_StartCondition.notify_all();
+
+	// Help out.
+	RunJobs();
+
+	// Wait for the stragglers.
+	std::unique_lock<std::mutex> cLock(m_Mutex);
+	m_DoneCondition.wait(cLock, [this] { return (m_nJobsDone == m_nJobCount) && (m_nActiveWorkers == 0); });
+	m_pJobFn = LTNULL;
+}
+
+
+void CWorkerPool::RunJobs()
+{
+	for (;;)
+	{
+		uint32 nJob = m_nNextJob++;
+		if (nJob >= m_nJobCount)
+			return;
+
+		m_pJobFn(nJob, m_pJobUser);
+
+		++m_nJobsDone;
+	}
+}
+
+
+void CWorkerPool::WorkerMain()
+{
+	uint32 nSeenGeneration = 0;
+
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> cLock(m_Mutex);
+			m_StartCondition.wait(cLock, [this, nSeenGeneration] { return m_bShutdown || (m_nGeneration != nSeenGeneration); });
+			if (m_bShutdown)
+				return;
+			nSeenGeneration = m_nGeneration;
+			++m_nActiveWorkers;
+		}
+
+		RunJobs();
+
+		{
+			std::lock_guard<std::mutex> cLock(m_Mutex);
+			--m_nActiveWorkers;
+		}
+		m_DoneCondition.notify_all();
+	}
+}
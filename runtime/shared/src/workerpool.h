@@ -0,0 +1,74 @@
+
+// This class manages a fixed set of worker threads that can split an
+// indexed loop between them.  The calling thread takes part in the loop,
+// and ParallelFor doesn't return until every index has been processed,
+// so callers don't need any synchronization of their own as long as each
+// index only touches its own data.
+
+#ifndef __WORKERPOOL_H__
+#define __WORKERPOOL_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class CWorkerPool
+{
+public:
+
+	// Called once for each index in the loop.
+	typedef void (*JobFn)(uint32 nIndex, void *pUser);
+
+				CWorkerPool();
+				~CWorkerPool();
+
+	// Start the workers.  nNumThreads is the total number of threads that run
+	// jobs, including the caller, so 1 means everything runs on the caller.
+	// 0 uses one thread per hardware thread.
+	void		Init(uint32 nNumThreads);
+	void		Term();
+
+	// Total number of threads running jobs, including the caller.
+	uint32		GetNumThreads() const	{ return (uint32)m_Workers.size() + 1; }
+
+	// Call pFn for every index in [0, nCount) and wait for them all to finish.
+	void		ParallelFor(uint32 nCount, JobFn pFn, void *pUser);
+
+protected:
+
+	// Worker thread main loop.
+	void		WorkerMain();
+
+	// Run jobs from the current loop until there are none left.
+	void		RunJobs();
+
+	std::vector<std::thread>	m_Workers;
+
+	std::mutex					m_Mutex;
+	std::condition_variable		m_StartCondition;
+	std::condition_variable		m_DoneCondition;
+
+	// The loop being run.
+	JobFn						m_pJobFn;
+	void						*m_pJobUser;
+	uint32						m_nJobCount;
+	std::atomic<uint32>			m_nNextJob;
+
+	// Number of jobs that have finished in the current loop.
+	std::atomic<uint32>			m_nJobsDone;
+
+	// Number of workers still inside the current loop.  A new loop can't
+	// start until they've all left, or a late worker could grab its jobs.
+	uint32						m_nActiveWorkers;
+
+	// Bumped for every loop so the workers can tell a new one started.
+	uint32						m_nGeneration;
+
+	// Set when the workers should exit.
+	bool						m_bShutdown;
+};
+
+
+#endif
@@ -0,0 +1,193 @@
+#include "bdefs.h"
+#include "zoneprofiler.h"
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+// One recorded zone.
+struct ProfileEvent
+{
+	uint64	m_StartTime;
+	uint32	m_Duration;		// Nanoseconds (a zone can't run longer than 4 seconds).
+	uint16	m_ZoneID;
+};
+
+// A thread's ring buffer.  Only the owning thread writes to it.
+struct ProfileThread
+{
+	uint32					m_ThreadIndex;
+	std::atomic<uint32>		m_nRecorded;
+	ProfileEvent			m_Events[PROFILE_EVENTS_PER_THREAD];
+};
+
+
+// Guards everything below.
+static std::mutex g_ProfileMutex;
+
+static std::vector<std::string> g_ZoneNames;
+static std::map<std::string, uint16> g_ZoneIDs;
+
+// Every buffer ever made, and the ones whose threads have exited.  Buffers
+// are handed to new threads before any more get made, so restarting a
+// worker pool doesn't use more memory (and the old events are kept).
+static std::vector<ProfileThread*> g_ProfileThreads;
+static std::vector<ProfileThread*> g_FreeProfileThreads;
+
+
+// Gives the buffer back when its thread exits.
+class CProfileThreadHolder
+{
+public:
+
+	CProfileThreadHolder()
+	{
+		m_pThread = LTNULL;
+	}
+
+	~CProfileThreadHolder()
+	{
+		if (m_pThread)
+		{
+			std::lock_guard<std::mutex> lock(g_ProfileMutex);
+			g_FreeProfileThreads.push_back(m_pThread);
+		}
+	}
+
+	ProfileThread	*m_pThread;
+};
+
+static thread_local CProfileThreadHolder t_ProfileThread;
+
+
+static ProfileThread* prof_GetThread()
+{
+	if (t_ProfileThread.m_pThread)
+		return t_ProfileThread.m_pThread;
+
+	std::lock_guard<std::mutex> lock(g_ProfileMutex);
+
+	ProfileThread *pThread;
+	if (!g_FreeProfileThreads.empty())
+	{
+		pThread = g_FreeProfileThreads.back();
+		g_FreeProfileThreads.pop_back();
+	}
+	else
+	{
+		LT_MEM_TRACK_ALLOC(pThread = new ProfileThread, LT_MEM_TYPE_MISC);
+		pThread->m_ThreadIndex = (uint32)g_ProfileThreads.size();
+		pThread->m_nRecorded = 0;
+		g_ProfileThreads.push_back(pThread);
+	}
+
+	t_ProfileThread.m_pThread = pThread;
+	return pThread;
+}
+
+
+uint16 prof_RegisterZone(const char *pName)
+{
+	std::lock_guard<std::mutex> lock(g_ProfileMutex);
+
+	std::map<std::string, uint16>::iterator iZone = g_ZoneIDs.find(pName);
+	if (iZone != g_ZoneIDs.end())
+		return iZone->second;
+
+	uint16 zoneID = (uint16)g_ZoneNames.size();
+	g_ZoneNames.push_back(pName);
+	g_ZoneIDs[pName] = zoneID;
+	return zoneID;
+}
+
+
+void prof_RecordZone(uint16 zoneID, uint64 startTime, uint64 endTime)
+{
+	ProfileThread *pThread = prof_GetThread();
+
+	uint32 nRecorded = pThread->m_nRecorded.load(std::memory_order_relaxed);
+	ProfileEvent &event = pThread->m_Events[nRecorded % PROFILE_EVENTS_PER_THREAD];
+	event.m_StartTime = startTime;
+	event.m_Duration = (uint32)LTMIN(endTime - startTime, (uint64)0xFFFFFFFF);
+	event.m_ZoneID = zoneID;
+
+	pThread->m_nRecorded.store(nRecorded + 1, std::memory_order_release);
+}
+
+
+// Writes pStr as a JSON string.
+static void prof_WriteJSONString(FILE *fp, const char *pStr)
+{
+	fputc('"', fp);
+	for (; *pStr; pStr++)
+	{
+		if (*pStr == '"' || *pStr == '\\')
+		{
+			fputc('\\', fp);
+			fputc(*pStr, fp);
+		}
+		else if ((uint8)*pStr >= ' ')
+		{
+			fputc(*pStr, fp);
+		}
+	}
+	fputc('"', fp);
+}
+
+
+LTRESULT prof_WriteTrace(const char *pFilename)
+{
+	FILE *fp = fopen(pFilename, "wt");
+	if (!fp)
+		return LT_ERROR;
+
+	std::lock_guard<std::mutex> lock(g_ProfileMutex);
+
+	// Trace times are in microseconds.  Start them at the oldest event so
+	// they're readable.
+	uint64 baseTime = (uint64)-1;
+	for (ProfileThread *pThread : g_ProfileThreads)
+	{
+		uint32 nRecorded = pThread->m_nRecorded.load(std::memory_order_acquire);
+		uint32 nEvents = LTMIN(nRecorded, (uint32)PROFILE_EVENTS_PER_THREAD);
+		for (uint32 i = nRecorded - nEvents; i != nRecorded; i++)
+		{
+			baseTime = LTMIN(baseTime, pThread->m_Events[i % PROFILE_EVENTS_PER_THREAD].m_StartTime);
+		}
+	}
+
+	fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+	bool bFirst = true;
+	for (ProfileThread *pThread : g_ProfileThreads)
+	{
+		fprintf(fp, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"Thread %u\"}}",
+			bFirst ? "" : ",\n", pThread->m_ThreadIndex, pThread->m_ThreadIndex);
+		bFirst = false;
+
+		uint32 nRecorded = pThread->m_nRecorded.load(std::memory_order_acquire);
+		uint32 nEvents = LTMIN(nRecorded, (uint32)PROFILE_EVENTS_PER_THREAD);
+		for (uint32 i = nRecorded - nEvents; i != nRecorded; i++)
+		{
+			const ProfileEvent &event = pThread->m_Events[i % PROFILE_EVENTS_PER_THREAD];
+
+			fprintf(fp, ",\n{\"name\":");
+			prof_WriteJSONString(fp, g_ZoneNames[event.m_ZoneID].c_str());
+			fprintf(fp, ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+				pThread->m_ThreadIndex,
+				(double)(event.m_StartTime - baseTime) / 1000.0,
+				(double)event.m_Duration / 1000.0);
+		}
+	}
+
+	fprintf(fp, "\n]}\n");
+
+	bool bOk = !ferror(fp);
+	if (fclose(fp) != 0)
+		bOk = false;
+
+	return bOk ? LT_OK : LT_ERROR;
+}
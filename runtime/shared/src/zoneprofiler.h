@@ -0,0 +1,84 @@
+// A low overhead profiler for finding out where the time in a frame went.
+// Code marks what it wants timed with PROFILE_ZONE.  While the ProfileZones
+// console variable is set, each thread records the zones it runs into its
+// own ring buffer, which keeps the last PROFILE_EVENTS_PER_THREAD of them.
+// prof_WriteTrace dumps the buffers as a Chrome trace-event file that can
+// be loaded in chrome://tracing or Perfetto.
+
+#ifndef __ZONEPROFILER_H__
+#define __ZONEPROFILER_H__
+
+#ifdef __LINUX
+#include <time.h>
+#else
+#include <chrono>
+#endif
+
+
+// How many zones each thread remembers.
+#define PROFILE_EVENTS_PER_THREAD	(256 * 1024)
+
+
+// Recording is on while this is nonzero.
+extern int32 g_CV_ProfileZones;
+
+
+// The profiler clock, in nanoseconds.
+inline uint64 prof_GetTime()
+{
+#ifdef __LINUX
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64)ts.tv_sec * 1000000000 + (uint64)ts.tv_nsec;
+#else
+	return (uint64)std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// Zones are registered by name once and recorded by ID.  Registering the
+// same name again returns the same ID.  The name is copied.
+uint16 prof_RegisterZone(const char *pName);
+
+// Add a zone to the calling thread's buffer.
+void prof_RecordZone(uint16 zoneID, uint64 startTime, uint64 endTime);
+
+// Write everything in the buffers to pFilename.  Call this from the main
+// thread between frames, while the worker threads are idle.
+LTRESULT prof_WriteTrace(const char *pFilename);
+
+
+// Times the scope it's declared in.
+class CProfileZone
+{
+public:
+
+	CProfileZone(uint16 zoneID)
+	{
+		m_ZoneID = zoneID;
+		m_StartTime = g_CV_ProfileZones ? prof_GetTime() : 0;
+	}
+
+	~CProfileZone()
+	{
+		if (m_StartTime)
+		{
+			prof_RecordZone(m_ZoneID, m_StartTime, prof_GetTime());
+		}
+	}
+
+	uint64	m_StartTime;
+	uint16	m_ZoneID;
+};
+
+
+#define PROFILE_ZONE_CONCAT2(a, b)	a##b
+#define PROFILE_ZONE_CONCAT(a, b)	PROFILE_ZONE_CONCAT2(a, b)
+
+// Times the rest of the scope as pName (a string literal).
+#define PROFILE_ZONE(pName) \
+	static const uint16 PROFILE_ZONE_CONCAT(__profZoneID, __LINE__) = prof_RegisterZone(pName); \
+	CProfileZone PROFILE_ZONE_CONCAT(__profZone, __LINE__)(PROFILE_ZONE_CONCAT(__profZoneID, __LINE__));
+
+
+#endif  // __ZONEPROFILER_H__
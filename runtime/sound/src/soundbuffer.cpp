@@ -62,7 +62,7 @@ CSoundBuffer::~CSoundBuffer()
     Term();
 }
 
-LTRESULT CSoundBuffer::Init(FileIdentifier &fileIdent)
+LTRESULT CSoundBuffer::Init(FileIdentifier &fileIdent, ILTStream *pStream)
 {
     // Start fresh
     Term();
@@ -70,7 +70,7 @@ LTRESULT CSoundBuffer::Init(FileIdentifier &fileIdent)
     m_pFileIdent = &fileIdent;
     m_bTouched = LTTRUE;
 
-    if (LoadData() != LT_OK)
+    if (LoadData(pStream) != LT_OK)
         return LT_ERROR;
 
     dl_InitList(&m_InstanceList);
@@ -188,15 +188,15 @@ inline void CSoundBuffer::CalcSampleType(S32 &sampleType, WAVEFORMATEX &waveForm
     }
 }
 
-LTRESULT CSoundBuffer::LoadData()
+LTRESULT CSoundBuffer::LoadData(ILTStream *pStream)
 {
     uint8 *pTempBuffer;
     LTBOOL bRet;
     ILTStream *pFileStream;
     uint32 dwTemp;
 
-    // Open the file for reading
-    pFileStream = client_file_mgr->OpenFileIdentifier(m_pFileIdent);
+    // Open the file for reading, unless it's already been read.
+    pFileStream = pStream ? pStream : client_file_mgr->OpenFileIdentifier(m_pFileIdent);
     if (!pFileStream)
     {
         if (g_nSoundDebugLevel > 0)
@@ -219,7 +219,8 @@ LTRESULT CSoundBuffer::LoadData()
     if (!bRet)
     {
         // Close the file
-        pFileStream->Release();
+        if (!pStream)
+            pFileStream->Release();
 
         if (g_DebugLevel >= 2)
         {
@@ -271,7 +272,8 @@ LTRESULT CSoundBuffer::LoadData()
         pFileStream->Read(m_pFileData, m_dwFileSize);
 
         // Close the file
-        pFileStream->Release();
+        if (!pStream)
+            pFileStream->Release();
 
         m_pSoundData = &m_pFileData[ m_WaveHeader.m_dwDataPos ];
 
@@ -360,7 +362,8 @@ LTRESULT CSoundBuffer::LoadData()
     else
     {
         // Close the file
-        pFileStream->Release();
+        if (!pStream)
+            pFileStream->Release();
     }
 
     CalcSampleType(m_nSampleType, m_WaveHeader.m_WaveFormat);
@@ -27,7 +27,9 @@ public:
 
 	virtual ~CSoundBuffer();
 
-	virtual LTRESULT	Init( FileIdentifier &fileIdent );
+	// Reads the sound from pStream if it's given (the caller still owns it),
+	// otherwise from the file.
+	virtual LTRESULT	Init( FileIdentifier &fileIdent, ILTStream *pStream = LTNULL );
 
 	virtual LTRESULT	InitFromCompressed( CSoundBuffer &compressedSoundBuffer );
 
@@ -142,7 +144,7 @@ protected:
 
 	LTRESULT			CopySoundData16to8( uint8 *pDest, uint8 *pSource, uint32 nSize );
 
-	virtual LTRESULT	LoadData( );
+	virtual LTRESULT	LoadData( ILTStream *pStream = LTNULL );
 
 	LTRESULT			LoadDataFromDecompressed( )	;
 
@@ -1066,10 +1066,11 @@ IDirectMusic* CSoundMgr::GetDirectMusic()
 //
 //  CSoundMgr::CreateBuffer()
 //
-//  Creates a sound buffer from a sound file.
+//  Creates a sound buffer from a sound file, or from pStream if the file
+//  has already been read.
 // 
 //----------------------------------------------------------------------------------------------
-CSoundBuffer *CSoundMgr::CreateBuffer(FileIdentifier &fileIdent)
+CSoundBuffer *CSoundMgr::CreateBuffer(FileIdentifier &fileIdent, ILTStream *pStream)
 {
     CSoundBuffer *pSoundBuffer;
 
@@ -1101,7 +1102,7 @@ CSoundBuffer *CSoundMgr::CreateBuffer(FileIdentifier &fileIdent)
         return LTNULL;
     }
 
-    if (pSoundBuffer->Init(fileIdent) != LT_OK)
+    if (pSoundBuffer->Init(fileIdent, pStream) != LT_OK)
     {
         m_SoundBufferBank.Free(pSoundBuffer);
         return LTNULL;
@@ -204,7 +204,7 @@ public:
 #endif
 //	===========================================================================
 
-	CSoundBuffer *CreateBuffer( FileIdentifier &fileIdent );
+	CSoundBuffer *CreateBuffer( FileIdentifier &fileIdent, ILTStream *pStream = LTNULL );
 
 	LTRESULT	RemoveBuffer( FileIdentifier &fileIdent );
 
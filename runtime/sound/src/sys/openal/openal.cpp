@@ -12,6 +12,10 @@
 #include <mpg123.h>
 #include <vector>
 
+#include "sounddecoder.h"
+
+#include <deque>
+
 typedef sint16	S16;
 typedef uint16	U16;
 typedef sint32	S32;
@@ -47,226 +51,178 @@ enum
 
 #define C3D_REFERENCE_DISTANCE 2000.0f
 
-//ADPCM decoding from https://github.com/dbry/adpcm-xq/
-//see adpcm_license.txt for details.
-
-/* step table */
-static const uint16_t step_table[89] = {
-    7, 8, 9, 10, 11, 12, 13, 14,
-    16, 17, 19, 21, 23, 25, 28, 31,
-    34, 37, 41, 45, 50, 55, 60, 66,
-    73, 80, 88, 97, 107, 118, 130, 143,
-    157, 173, 190, 209, 230, 253, 279, 307,
-    337, 371, 408, 449, 494, 544, 598, 658,
-    724, 796, 876, 963, 1060, 1166, 1282, 1411,
-    1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024,
-    3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484,
-    7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
-    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794,
-    32767
-};
-
-/* step index tables */
-static const int index_table[] = {
-    /* adpcm data size is 4 */
-    -1, -1, -1, -1, 2, 4, 6, 8
-};
+// the decoded chunks of all the sounds that are decoded as they play
+static CDecodedSoundCache g_DecodeCache;
 
-#define CLIP(data, min, max) \
-if ((data) > (max)) data = max; \
-else if ((data) < (min)) data = min;
+//! CMP3Decoder
 
-int adpcm_decode_block (int16_t *outbuf, const uint8_t *inbuf, size_t inbufsize, int channels)
+// mpg123 can only decode forward, so going back to an earlier chunk starts
+// over from the beginning. That only happens when a streamed sound loops or
+// is moved back, everything else asks for the chunks in order
+class CMP3Decoder : public CSoundDecoder
 {
-    int ch, samples = 1, chunks;
-    int32_t pcmdata[2];
-    int8_t index[2];
-
-    if (inbufsize < (uint32_t) channels * 4)
-        return 0;
-
-    for (ch = 0; ch < channels; ch++) {
-        *outbuf++ = pcmdata[ch] = (int16_t) (inbuf [0] | (inbuf [1] << 8));
-        index[ch] = inbuf [2];
-
-        if (index [ch] < 0 || index [ch] > 88 || inbuf [3])     // sanitize the input a little...
-            return 0;
-
-        inbufsize -= 4;
-        inbuf += 4;
-    }
-
-    chunks = inbufsize / (channels * 4);
-    samples += chunks * 8;
-
-    while (chunks--) {
-        int ch, i;
-
-        for (ch = 0; ch < channels; ++ch) {
-
-            for (i = 0; i < 4; ++i) {
-                int step = step_table [index [ch]], delta = step >> 3;
-
-                if (*inbuf & 1) delta += (step >> 2);
-                if (*inbuf & 2) delta += (step >> 1);
-                if (*inbuf & 4) delta += step;
-                if (*inbuf & 8) delta = -delta;
-
-                pcmdata[ch] += delta;
-                index[ch] += index_table [*inbuf & 0x7];
-                CLIP(index[ch], 0, 88);
-                CLIP(pcmdata[ch], -32768, 32767);
-                outbuf [i * 2 * channels] = pcmdata[ch];
-
-                step = step_table [index [ch]], delta = step >> 3;
-
-                if (*inbuf & 0x10) delta += (step >> 2);
-                if (*inbuf & 0x20) delta += (step >> 1);
-                if (*inbuf & 0x40) delta += step;
-                if (*inbuf & 0x80) delta = -delta;
+public:
+	CMP3Decoder( );
+	virtual ~CMP3Decoder( );
 
-                pcmdata[ch] += delta;
-                index[ch] += index_table [(*inbuf >> 4) & 0x7];
-                CLIP(index[ch], 0, 88);
-                CLIP(pcmdata[ch], -32768, 32767);
-                outbuf [(i * 2 + 1) * channels] = pcmdata[ch];
+	bool Init( const void* pData, uint32 uiDataSize, bool bCopy );
+	virtual bool DecodeChunk( uint32 uiChunk, std::vector<uint8>& Out );
 
-                inbuf++;
-            }
+private:
+	// starts decoding over from the beginning, returning false if the format isn't usable
+	bool Restart( );
 
-            outbuf++;
-        }
+	// decodes up to uiSize bytes onto the end of the output, or throws them out without it
+	bool Read( uint32 uiSize, std::vector<uint8>* pOut );
 
-        outbuf += channels * 7;
-    }
+	mpg123_handle*	m_hHandle;
+	uint32			m_uiNextChunk;
+	bool			m_bEnded;
+};
 
-    return samples;
+CMP3Decoder::CMP3Decoder( ) :
+	m_hHandle( NULL ),
+	m_uiNextChunk( 0 ),
+	m_bEnded( false )
+{
 }
 
-static char* adpcm_decode_data(void* p, int num_channels,
-	size_t num_samples, int block_size)
+CMP3Decoder::~CMP3Decoder( )
 {
-    int samples_per_block = (block_size - num_channels * 4) * (num_channels ^ 3) + 1;
-    char* pcm_block = new char[num_samples * num_channels * 2];
-    unsigned char* adpcm_block = new unsigned char[block_size];
-    int ret_samples;
-    char* pcm_ptr = pcm_block;
-
-    if (!pcm_block || !adpcm_block)
-    {
-        return NULL;
-    }
+	if( m_hHandle )
+		mpg123_delete( m_hHandle );
+}
 
-    while (num_samples)
-    {
-		int this_block_adpcm_samples = samples_per_block;
-		int this_block_pcm_samples = samples_per_block;
+bool CMP3Decoder::Init( const void* pData, uint32 uiDataSize, bool bCopy )
+{
+	int ret;
+	m_hHandle = mpg123_new( NULL, &ret );
+	if( m_hHandle == NULL )
+	{
+		printf("Unable to create mpg123 handle: %s\n", mpg123_plain_strerror(ret));
+		return false;
+	}
 
-		if (this_block_adpcm_samples > num_samples)
-		{
-			this_block_adpcm_samples = ((num_samples + 6) & ~7) + 1;
-			block_size = (this_block_adpcm_samples - 1) / (num_channels ^ 3) + (num_channels * 4);
-			this_block_pcm_samples = num_samples;
-		}
+	mpg123_param( m_hHandle, MPG123_FLAGS, MPG123_QUIET, 0.0 );
 
-		memcpy(adpcm_block, p, block_size);
-		p = (char*)p + block_size;
+	SetData( pData, uiDataSize, bCopy );
+	if( !Restart( ))
+		return false;
 
-		ret_samples = adpcm_decode_block ((int16_t*)pcm_ptr,
-			(uint8_t*)adpcm_block, block_size, num_channels);
-		if (ret_samples != this_block_adpcm_samples)
-		{
-			return NULL;
-		}
+	m_Format.wFormatTag = WAVE_FORMAT_PCM;
+	m_Format.nBlockAlign = m_Format.nChannels * 2;
+	m_Format.nAvgBytesPerSec = m_Format.nSamplesPerSec * m_Format.nBlockAlign;
+	m_uiChunkSize = ( SOUNDDECODE_CHUNK_SIZE / m_Format.nBlockAlign ) * m_Format.nBlockAlign;
+	return true;
+}
 
-		pcm_ptr += (this_block_pcm_samples * 2);
-		num_samples -= this_block_pcm_samples;
+bool CMP3Decoder::Restart( )
+{
+	mpg123_close( m_hHandle );
+	mpg123_open_feed( m_hHandle );
 
-    }
+	// the whole sound is fed in at once, the output is read out a chunk at a time
+	int ret = mpg123_feed( m_hHandle, m_pData, m_uiDataSize );
+	if( ret != MPG123_OK )
+		return false;
 
-    delete [] adpcm_block;
-    return (char*)pcm_block;
-}
+	m_uiNextChunk = 0;
+	m_bEnded = false;
 
-#define OUTBUFF 1024
-static char* mpeg3_decode(char* p, unsigned int length,
-	unsigned int* uncompressedSize, WAVEFORMATEX* wfmt)
-{
-	mpg123_handle* handle;
+	// reading nothing gets the format
+	size_t uiRead;
+	ret = mpg123_read( m_hHandle, NULL, 0, &uiRead );
+	if( ret != MPG123_NEW_FORMAT )
+	{
+		printf("mpg123 error: %s\n", mpg123_strerror(m_hHandle));
+		return false;
+	}
 
-	size_t size;
-	char* newbuf;
-	std::vector<char> test;
-	unsigned char out[OUTBUFF]; /* output buffer */
-	size_t len;
-	int ret;
-	size_t in = 0, outc = 0;
-	unsigned int i;
-	handle = mpg123_new(NULL, &ret);
 	long rate;
 	int channels, enc;
-	if(handle == NULL)
+	mpg123_getformat( m_hHandle, &rate, &channels, &enc );
+	if( enc != MPG123_ENC_SIGNED_16 || ( channels != 1 && channels != 2 ))
 	{
-		printf("Unable to create mpg123 handle: %s\n", mpg123_plain_strerror(ret));
-		return NULL;
+		printf("mpg123 format not handled, %i channels, encoding %i\n", channels, enc);
+		return false;
 	}
 
-	mpg123_param(handle, MPG123_FLAGS, MPG123_QUIET, 0.0);
-	mpg123_open_feed(handle);
+	m_Format.nChannels = channels;
+	m_Format.nSamplesPerSec = rate;
+	m_Format.wBitsPerSample = 16;
+	return true;
+}
 
-	if(handle == NULL)
-	{
-		return NULL;
-	}
+bool CMP3Decoder::Read( uint32 uiSize, std::vector<uint8>* pOut )
+{
+	uint8 aDiscard[ 4096 ];
 
-	/* Feed input chunk and get first chunk of decoded audio. */
-	ret = mpg123_decode(handle,(unsigned char*)p,length,out,OUTBUFF,&size);
-	if(ret == MPG123_NEW_FORMAT)
+	while( uiSize > 0 && !m_bEnded )
 	{
-		mpg123_getformat(handle, &rate, &channels, &enc);
-		//printf( "New format: %li Hz, %i channels, encoding value %i\n", rate, channels, enc);
-		wfmt->nChannels = channels;
-		if (enc == MPG123_ENC_SIGNED_16)
+		uint8* pDest = aDiscard;
+		uint32 uiWant = LTMIN( uiSize, ( uint32 )sizeof( aDiscard ));
+		if( pOut )
 		{
-			wfmt->wBitsPerSample = 16;
+			size_t uiOldSize = pOut->size( );
+			pOut->resize( uiOldSize + uiSize );
+			pDest = &( *pOut )[ uiOldSize ];
+			uiWant = uiSize;
 		}
-		else
+
+		size_t uiRead = 0;
+		int ret = mpg123_read( m_hHandle, pDest, uiWant, &uiRead );
+		if( pOut )
+			pOut->resize( pOut->size( ) - ( uiWant - uiRead ));
+
+		uiSize -= ( uint32 )uiRead;
+
+		if( ret == MPG123_NEED_MORE || ret == MPG123_DONE )
 		{
-			//assume invalid for now
-			wfmt->wBitsPerSample = 0;
+			m_bEnded = true;
 		}
-		wfmt->nSamplesPerSec = rate;
-	}
-	outc += size;
-
-	while(ret != MPG123_ERR && ret != MPG123_NEED_MORE)
-	{
-		ret = mpg123_decode(handle,NULL,0,out,OUTBUFF,&size);
-		for (i = 0; i < size; i++)
+		else if( ret != MPG123_OK && ret != MPG123_NEW_FORMAT )
 		{
-			test.push_back(out[i]);
+			printf("mpg123 error: %s\n", mpg123_strerror(m_hHandle));
+			return false;
 		}
-		outc += size;
 	}
 
-	if(ret == MPG123_ERR)
+	return true;
+}
+
+bool CMP3Decoder::DecodeChunk( uint32 uiChunk, std::vector<uint8>& Out )
+{
+	Out.clear( );
+
+	if( m_uiDecodedSize != 0 && ( uint64 )uiChunk * m_uiChunkSize >= m_uiDecodedSize )
+		return true;
+
+	if( uiChunk < m_uiNextChunk )
 	{
-		printf("mpg123 error: %s", mpg123_strerror(handle));
-		return NULL;
+		if( !Restart( ))
+			return false;
 	}
 
-	if (test.size() == 0)
+	// skip ahead to the chunk
+	while( m_uiNextChunk < uiChunk && !m_bEnded )
 	{
-		return NULL;
+		if( !Read( m_uiChunkSize, NULL ))
+			return false;
+		m_uiNextChunk++;
 	}
 
-	newbuf = new char[test.size()];
-	memcpy(newbuf, test.data(), test.size() * sizeof(char));
+	if( !Read( m_uiChunkSize, &Out ))
+		return false;
+
+	// only a whole number of samples can be played
+	Out.resize( Out.size( ) - Out.size( ) % m_Format.nBlockAlign );
+	m_uiNextChunk++;
 
-	*uncompressedSize = outc;
-	mpg123_delete(handle);
+	// now the length is known
+	if( m_bEnded && m_uiDecodedSize == 0 )
+		m_uiDecodedSize = uiChunk * m_uiChunkSize + ( uint32 )Out.size( );
 
-	return newbuf;
+	return true;
 }
 
 class COpenALSoundSys;
@@ -333,6 +289,24 @@ public:
 	void HandleLoop( COpenALSoundSys* pSoundSys );
 	void DisplayError();
 
+//	===========================================================================
+//	Streaming of sounds that are too long to keep decoded
+public:
+	bool InitStreaming( const TSoundDecoderPtr& pDecoder, uint32 uiPlaybackRate );
+	bool IsStreaming( ) { return m_pDecoder.get( ) != NULL; }
+
+	// unqueues the buffers that have played and queues up more, called every frame
+	void UpdateStream( );
+
+protected:
+	bool PlayStream( );
+	void QueueStreamBuffers( );
+	void ClearStreamQueue( );
+	void TermStream( );
+
+	// the byte position in the sound that the source is at
+	uint32 GetStreamPosition( );
+
 
 public:
 	unsigned int m_dwPlayFlags;
@@ -354,15 +328,29 @@ public:
 	bool					m_bLooping;
 	float					m_fVolume;
 
+	// set when the sound is decoded as it plays
+	TSoundDecoderPtr		m_pDecoder;
+	ALuint					m_StreamBuffers[ SOUNDDECODE_NUM_BUFFERS ];
+	std::vector<ALuint>		m_FreeStreamBuffers;
+	// the chunks on the source's queue and their sizes, oldest first
+	std::deque< std::pair<uint32, uint32> >	m_QueuedChunks;
+	uint32					m_uiNextStreamChunk;
+	bool					m_bStreamPlaying;
+	bool					m_bStreamEnded;
+	LTLink					m_lnkStream;
+
 	static 	LTLink			m_lstSampleLoopHead;
+	static 	LTLink			m_lstStreamHead;
 };
 
 LTLink CSample::m_lstSampleLoopHead;
+LTLink CSample::m_lstStreamHead( LTLink_Init );
 
 CSample::CSample( )
 {
 	memset( &m_userData, 0, sizeof( m_userData ));
 	m_bLoopBlock = false;
+	m_lnkStream.Init2( this );
 	Reset( );
 }
 
@@ -383,6 +371,9 @@ void CSample::Reset( )
 	buffer = 0;
 	error = 0;
 	m_fVolume = 0.0f;
+	m_uiNextStreamChunk = 0;
+	m_bStreamPlaying = false;
+	m_bStreamEnded = false;
 	alGetError();
 }
 
@@ -410,6 +401,9 @@ void CSample::DisplayError()
 
 void CSample::Term( )
 {
+	if( IsStreaming( ))
+		TermStream( );
+
 	alDeleteSources(1, &source);
 	alDeleteBuffers(1, &buffer);
 
@@ -457,6 +451,10 @@ bool CSample::IsPlaying( )
 	if( source == 0 )
 		return false;
 
+	// the source stops for a moment if it runs out of data before the next chunk is ready
+	if( IsStreaming( ))
+		return m_bStreamPlaying;
+
 	alGetSourcei(source, AL_SOURCE_STATE, &status);
 	if (status == AL_PLAYING)
 	{
@@ -467,6 +465,15 @@ bool CSample::IsPlaying( )
 
 void CSample::SetLooping( COpenALSoundSys* pSoundSys, bool bLoop )
 {
+	// the looping is done by going back to the first chunk when the end is reached
+	if( IsStreaming( ))
+	{
+		if( bLoop )
+			m_bStreamEnded = false;
+		m_bLooping = bLoop;
+		return;
+	}
+
 	if( bLoop != m_bLooping )
 	{
 		if( IsPlaying( ))
@@ -494,6 +501,14 @@ bool CSample::SetCurrentPosition( unsigned int dwStartOffset )
 	if( source == 0 )
 		return false;
 
+	if( IsStreaming( ))
+	{
+		m_nLastPlayPos = dwStartOffset - dwStartOffset % m_waveFormat.nBlockAlign;
+		if( m_bStreamPlaying )
+			PlayStream( );
+		return true;
+	}
+
 	alSourcei(source, AL_BYTE_OFFSET, dwStartOffset);
 
 	// Set the last play pos to zero, because doing this on a playing sound
@@ -505,6 +520,9 @@ bool CSample::SetCurrentPosition( unsigned int dwStartOffset )
 
 bool CSample::Play( )
 {
+	if( IsStreaming( ))
+		return PlayStream( );
+
 	if( buffer == 0 )
 		return false;
 
@@ -539,13 +557,24 @@ bool CSample::Stop( bool bReset )
 	if( source == 0 )
 		return false;
 
-	alSourceStop(source);
-
-	alGetSourcei(source, AL_BYTE_OFFSET, &m_nLastPlayPos);
-	if( bReset )
+	if( IsStreaming( ))
 	{
-		m_nLastPlayPos = 0;
+		uint32 uiPosition = GetStreamPosition( );
+		alSourceStop(source);
+		ClearStreamQueue( );
+		m_bStreamPlaying = false;
+		m_nLastPlayPos = bReset ? 0 : uiPosition;
+	}
+	else
+	{
+		alSourceStop(source);
 
+		alGetSourcei(source, AL_BYTE_OFFSET, &m_nLastPlayPos);
+		if( bReset )
+		{
+			m_nLastPlayPos = 0;
+
+		}
 	}
 	if (! m_bLooping )
 	{
@@ -566,6 +595,11 @@ void CSample::Restore( )
 bool CSample::Fill( )
 {
 	ALenum fmt;
+
+	// streamed sounds fill their buffers as they play
+	if( IsStreaming( ))
+		return true;
+
 	if( m_pSoundData == NULL)
 	{
 		printf("Error in Fill - data is null!\n");
@@ -615,6 +649,223 @@ bool CSample::Fill( )
 	return true;
 }
 
+bool CSample::InitStreaming( const TSoundDecoderPtr& pDecoder, uint32 uiPlaybackRate )
+{
+	m_pDecoder = pDecoder;
+	m_waveFormat = pDecoder->GetFormat( );
+	if( uiPlaybackRate != 0 )
+	{
+		m_waveFormat.nSamplesPerSec = uiPlaybackRate;
+		m_waveFormat.nAvgBytesPerSec = m_waveFormat.nBlockAlign * m_waveFormat.nSamplesPerSec;
+	}
+
+	alGetError();
+	alGenBuffers( SOUNDDECODE_NUM_BUFFERS, m_StreamBuffers );
+	error = alGetError();
+	if( error != AL_NO_ERROR )
+	{
+		std::cout << "CSample::InitStreaming genBuffers: ";
+		DisplayError();
+		m_pDecoder.reset( );
+		return false;
+	}
+
+	m_FreeStreamBuffers.assign( m_StreamBuffers, m_StreamBuffers + SOUNDDECODE_NUM_BUFFERS );
+	m_QueuedChunks.clear( );
+	m_uiNextStreamChunk = 0;
+	m_bStreamPlaying = false;
+	m_bStreamEnded = false;
+
+	dl_Insert( m_lstStreamHead.m_pPrev, &m_lnkStream );
+
+	// get the start decoded so it's ready when the sound is played
+	g_DecodeCache.Prefetch( m_pDecoder, 0 );
+	return true;
+}
+
+void CSample::TermStream( )
+{
+	if( source != 0 )
+	{
+		alSourceStop( source );
+		ClearStreamQueue( );
+	}
+
+	alDeleteBuffers( SOUNDDECODE_NUM_BUFFERS, m_StreamBuffers );
+	m_FreeStreamBuffers.clear( );
+
+	g_DecodeCache.RemoveDecoder( m_pDecoder.get( ));
+	m_pDecoder.reset( );
+
+	dl_Remove( &m_lnkStream );
+}
+
+void CSample::ClearStreamQueue( )
+{
+	// taking the buffer off of a stopped source unqueues everything
+	if( source != 0 )
+		alSourcei( source, AL_BUFFER, 0 );
+
+	m_FreeStreamBuffers.assign( m_StreamBuffers, m_StreamBuffers + SOUNDDECODE_NUM_BUFFERS );
+	m_QueuedChunks.clear( );
+}
+
+void CSample::QueueStreamBuffers( )
+{
+	ALenum fmt = m_waveFormat.nChannels == 2 ? AL_FORMAT_STEREO16 : AL_FORMAT_MONO16;
+
+	while( !m_FreeStreamBuffers.empty( ) && !m_bStreamEnded )
+	{
+		TDecodedChunk pChunk = g_DecodeCache.GetChunk( m_pDecoder, m_uiNextStreamChunk );
+		if( !pChunk )
+		{
+			printf("Error in QueueStreamBuffers - chunk %u couldn't be decoded!\n", m_uiNextStreamChunk);
+			m_bStreamEnded = true;
+			break;
+		}
+
+		if( pChunk->empty( ))
+		{
+			// past the end, so go back to the start if we're looping
+			if( m_bLooping && m_uiNextStreamChunk != 0 )
+			{
+				m_uiNextStreamChunk = 0;
+				continue;
+			}
+
+			m_bStreamEnded = true;
+			break;
+		}
+
+		ALuint uiBuffer = m_FreeStreamBuffers.back( );
+		m_FreeStreamBuffers.pop_back( );
+
+		alBufferData( uiBuffer, fmt, &( *pChunk )[0], ( ALsizei )pChunk->size( ), m_waveFormat.nSamplesPerSec );
+		alSourceQueueBuffers( source, 1, &uiBuffer );
+
+		m_QueuedChunks.push_back( std::make_pair( m_uiNextStreamChunk, ( uint32 )pChunk->size( )));
+		m_uiNextStreamChunk++;
+	}
+
+	if( m_bStreamEnded )
+		return;
+
+	// have the decode thread get started on what comes next
+	uint32 uiNextChunk = m_uiNextStreamChunk;
+	uint32 uiDecodedSize = m_pDecoder->GetDecodedSize( );
+	if( m_bLooping && uiDecodedSize != 0 && ( uint64 )uiNextChunk * m_pDecoder->GetChunkSize( ) >= uiDecodedSize )
+		uiNextChunk = 0;
+
+	g_DecodeCache.Prefetch( m_pDecoder, uiNextChunk );
+	g_DecodeCache.Prefetch( m_pDecoder, uiNextChunk + 1 );
+}
+
+bool CSample::PlayStream( )
+{
+	if (source == 0)
+	{
+		alGetError(); // clear errors, prior to create a new source
+		alGenSources(1, &source);
+		error = alGetError();
+		if (error != AL_NO_ERROR) {
+			std::cout << "CSample::PlayStream genSources: ";
+			DisplayError();
+			return false;
+		}
+	}
+
+	alSourceStop( source );
+	ClearStreamQueue( );
+
+	uint32 uiChunkSize = m_pDecoder->GetChunkSize( );
+	uint32 uiStartChunk = ( uint32 )m_nLastPlayPos / uiChunkSize;
+	m_uiNextStreamChunk = uiStartChunk;
+	m_bStreamEnded = false;
+
+	QueueStreamBuffers( );
+	if( m_QueuedChunks.empty( ))
+	{
+		m_bStreamPlaying = false;
+		return false;
+	}
+
+	// if the position was past the end, a looping sound will have gone back to the start
+	ALint nOffset = 0;
+	if( m_QueuedChunks.front( ).first == uiStartChunk )
+		nOffset = m_nLastPlayPos - uiStartChunk * uiChunkSize;
+
+	alSourcei(source, AL_BYTE_OFFSET, nOffset);
+	alSource3i(source, AL_POSITION, 0, 0, 0);
+	alSourcei(source, AL_LOOPING, AL_FALSE);
+	alSourcef(source, AL_GAIN, m_fVolume);
+	alSourcePlay(source);
+	error = alGetError();
+	if (error != AL_NO_ERROR){
+		std::cout << "CSample::PlayStream: ";
+		DisplayError();
+	}
+
+	m_bStreamPlaying = true;
+	return true;
+}
+
+uint32 CSample::GetStreamPosition( )
+{
+	if( source == 0 || m_QueuedChunks.empty( ))
+		return 0;
+
+	// the offset is from the start of the queue, including the buffers that have played
+	ALint nOffset = 0;
+	alGetSourcei( source, AL_BYTE_OFFSET, &nOffset );
+
+	uint32 uiOffset = ( uint32 )LTMAX( nOffset, ( ALint )0 );
+	for( size_t i = 0; i < m_QueuedChunks.size( ); i++ )
+	{
+		if( uiOffset < m_QueuedChunks[i].second )
+			return m_QueuedChunks[i].first * m_pDecoder->GetChunkSize( ) + uiOffset;
+
+		uiOffset -= m_QueuedChunks[i].second;
+	}
+
+	return 0;
+}
+
+void CSample::UpdateStream( )
+{
+	if( !IsStreaming( ) || source == 0 || !m_bStreamPlaying )
+		return;
+
+	ALint nProcessed = 0;
+	alGetSourcei( source, AL_BUFFERS_PROCESSED, &nProcessed );
+	while( nProcessed-- > 0 )
+	{
+		ALuint uiBuffer;
+		alSourceUnqueueBuffers( source, 1, &uiBuffer );
+		m_FreeStreamBuffers.push_back( uiBuffer );
+
+		if( !m_QueuedChunks.empty( ))
+			m_QueuedChunks.pop_front( );
+	}
+
+	QueueStreamBuffers( );
+
+	ALint nState;
+	alGetSourcei( source, AL_SOURCE_STATE, &nState );
+	if( nState != AL_PLAYING )
+	{
+		// either it ran dry before the next chunk was queued, or it's done
+		if( !m_QueuedChunks.empty( ))
+		{
+			alSourcePlay( source );
+		}
+		else
+		{
+			m_bStreamPlaying = false;
+			m_nLastPlayPos = 0;
+		}
+	}
+}
+
 //! I3DObject
 
 class I3DObject
@@ -1057,6 +1308,12 @@ bool CStream::IsDone( )
 uint32 CStream::FillBuffer( COpenALSoundSys* pSoundSys )
 {
     ALenum fmt;
+
+	// the buffers are queued up as the stream plays, so just make sure it
+	// decodes, which leaves the first chunk ready to go
+	if( IsStreaming( ))
+		return g_DecodeCache.GetChunk( m_pDecoder, 0 ) ? 1 : 0;
+
 	if( m_pSoundData == NULL)
 	{
 		printf("Error in Fill - data is null!\n");
@@ -1105,6 +1362,12 @@ uint32 CStream::FillBuffer( COpenALSoundSys* pSoundSys )
 
 void CStream::SetLooping( COpenALSoundSys* pSoundSys, bool bLoop )
 {
+	if( IsStreaming( ))
+	{
+		CSample::SetLooping( pSoundSys, bLoop );
+		return;
+	}
+
 	m_bLooping = bLoop;
 }
 
@@ -1113,6 +1376,16 @@ bool CStream::SetCurrentPosition( unsigned int dwStartOffset )
 	if( source == 0 )
 		return false;
 
+	if( IsStreaming( ))
+	{
+		CSample::SetCurrentPosition( dwStartOffset );
+
+		m_uiNextWriteOffset = 0;
+		m_uiLastPlayPos = 0;
+		m_uiTotalPlayed = dwStartOffset;
+		return true;
+	}
+
 	alSourcef(source, AL_BYTE_OFFSET, dwStartOffset);
 
 	// Set the last play pos to zero, because doing this on a playing sound
@@ -1188,7 +1461,7 @@ public:
 	virtual LH3DPOBJECT	Open3DListener( LHPROVIDER hLib );
 	virtual void		Close3DListener( LH3DPOBJECT hListener );
 	virtual void		SetListenerDoppler( LH3DPOBJECT hListener, float fDoppler ) {};
-	virtual void		CommitDeferred() {};
+	virtual void		CommitDeferred();
 
 	// 3d sound object functions
 	virtual void		Set3DPosition( LH3DPOBJECT hObj, float fX, float fY, float fZ);
@@ -1287,6 +1560,12 @@ public:
 
 public:
 	bool SetSampleNotify( CSample* pSample, bool bEnable );
+
+	// creates the decoder for the sample data of a wave file. The data is only
+	// referenced unless bCopy is set
+	TSoundDecoderPtr CreateDecoder( WAVEFORMATEX* pWaveFormat, void* pSampleData, uint32 uiSampleDataSize,
+		uint32 uiFactSamples, bool bCopy );
+
 	static COpenALSoundSys m_OpenALSoundSys;
 	static const char*	m_pCOpenALSoundSysDesc;
 	WAVEFORMATEX		sys_waveFormat;
@@ -1340,11 +1619,21 @@ S32	COpenALSoundSys::Startup( void )
 		printf("Couldn't init MPG123!\n");
 	}
 
+	g_DecodeCache.Init( SOUNDDECODE_CACHE_SIZE, true );
+
 	return 0;
 }
 
 void COpenALSoundSys::Shutdown( void )
 {
+	// the streams have sources and buffers to free, so they go before the context does
+	while( m_pStreams != NULL )
+	{
+		CStream* pStream = m_pStreams;
+		m_pStreams = m_pStreams->m_pNext;
+		delete pStream;
+	}
+
 	alcMakeContextCurrent(0);
 	if (alcontext)
 	{
@@ -1357,16 +1646,74 @@ void COpenALSoundSys::Shutdown( void )
 		aldevice = NULL;
 	}
 
-	while( m_pStreams != NULL )
+	CDecodedSoundCache::SStats Stats = g_DecodeCache.GetStats( );
+	if( Stats.m_uiChunksDecoded != 0 )
 	{
-		CStream* pStream = m_pStreams;
-		m_pStreams = m_pStreams->m_pNext;
-		delete pStream;
+		double fSeconds = ( double )Stats.m_uiDecodeMicroseconds / 1000000.0;
+		double fMegabytes = ( double )Stats.m_uiBytesDecoded / ( 1024.0 * 1024.0 );
+		printf("Sound decoding: %.1f MB in %u chunks, %.1f MB/s, %u hits, %u misses, %u evicted\n",
+			fMegabytes, Stats.m_uiChunksDecoded, fSeconds > 0.0 ? fMegabytes / fSeconds : 0.0,
+			Stats.m_uiHits, Stats.m_uiMisses, Stats.m_uiEvictions);
 	}
+	g_DecodeCache.Term( );
 
 	mpg123_exit();
 }
 
+void COpenALSoundSys::CommitDeferred( )
+{
+	// keep the streamed sounds fed
+	LTLink* pLink = CSample::m_lstStreamHead.m_pNext;
+	while( pLink != &CSample::m_lstStreamHead )
+	{
+		LTLink* pNext = pLink->m_pNext;
+
+		CSample* pSample = ( CSample* )pLink->m_pData;
+		if( pSample )
+			pSample->UpdateStream( );
+
+		pLink = pNext;
+	}
+}
+
+TSoundDecoderPtr COpenALSoundSys::CreateDecoder( WAVEFORMATEX* pWaveFormat, void* pSampleData, uint32 uiSampleDataSize,
+	uint32 uiFactSamples, bool bCopy )
+{
+	switch( pWaveFormat->wFormatTag )
+	{
+		case WAVE_FORMAT_PCM:
+		{
+			std::shared_ptr<CPCMDecoder> pDecoder( new CPCMDecoder );
+			if( pDecoder->Init( *pWaveFormat, pSampleData, uiSampleDataSize, bCopy ))
+				return pDecoder;
+			break;
+		}
+
+		case WAVE_FORMAT_IMA_ADPCM:
+		{
+			std::shared_ptr<CADPCMDecoder> pDecoder( new CADPCMDecoder );
+			if( pDecoder->Init( *pWaveFormat, pSampleData, uiSampleDataSize, uiFactSamples, bCopy ))
+				return pDecoder;
+			break;
+		}
+
+		case WAVE_FORMAT_MPEGLAYER3:
+		{
+			std::shared_ptr<CMP3Decoder> pDecoder( new CMP3Decoder );
+			if( pDecoder->Init( pSampleData, uiSampleDataSize, bCopy ))
+				return pDecoder;
+			break;
+		}
+
+		default:
+			printf("error in CreateDecoder - format tag %i not handled yet!\n", pWaveFormat->wFormatTag);
+			return TSoundDecoderPtr( );
+	}
+
+	printf("error in CreateDecoder - couldn't decode format %i!\n", pWaveFormat->wFormatTag);
+	return TSoundDecoderPtr( );
+}
+
 U32	COpenALSoundSys::MsCount( void )
 {
 	return SDL_GetTicks();
@@ -1804,9 +2151,8 @@ sint32	COpenALSoundSys::Init3DSampleFromFile( LH3DSAMPLE hS, void* pFile_image,
 
 	C3DSample* p3DSample = ( C3DSample* ) hS;
 	CSample* pSample = &p3DSample->m_sample;
-	WaveFile wave;
 	char* PCM;
-	unsigned int uncompressedSize;
+	uint32 uiPCMSize;
 
 	bool bSuccess = false;
 
@@ -1835,60 +2181,46 @@ sint32	COpenALSoundSys::Init3DSampleFromFile( LH3DSAMPLE hS, void* pFile_image,
 		return LTFALSE;
 	}
 
-	if( pWaveFormatEx->wFormatTag == WAVE_FORMAT_PCM )
+	if( pWaveFormatEx->wFormatTag == WAVE_FORMAT_PCM && uiSampleDataSize <= SOUNDDECODE_RESIDENT_SIZE )
 	{
 		return Init3DSampleFromAddress( hS, pSampleData, uiSampleDataSize, pWaveFormatEx, siPlaybackRate, pFilterData  );
 	}
-	else if (pWaveFormatEx->wFormatTag == WAVE_FORMAT_IMA_ADPCM)
-	{
-		uint32 dwSamplesPerBlock = 4 << ( pWaveFormatEx->nChannels / 2 );
-		uint32 dwSamples;
-		dwSamplesPerBlock = 1 + ( pWaveFormatEx->nBlockAlign - dwSamplesPerBlock ) * 8 / dwSamplesPerBlock;
-		dwSamples = (( uiSampleDataSize + pWaveFormatEx->nBlockAlign - 1 ) /
-			pWaveFormatEx->nBlockAlign ) * dwSamplesPerBlock;
 
-		PCM = adpcm_decode_data(pSampleData, pWaveFormatEx->nChannels, dwSamples, pWaveFormatEx->nBlockAlign);
-		pWaveFormatEx->wBitsPerSample = 16;
-		if (num_fact_samples < dwSamples && num_fact_samples > dwSamples - dwSamplesPerBlock)
-		{
-			dwSamples = num_fact_samples;
-		}
-		uiSampleDataSize = dwSamples * 2 * pWaveFormatEx->nChannels;
-		pSampleData = PCM;
+	// the file data stays around as long as the sample does, so the decoder can use it
+	TSoundDecoderPtr pDecoder = CreateDecoder( pWaveFormatEx, pSampleData, uiSampleDataSize, num_fact_samples, false );
+	if( !pDecoder )
+		return LTFALSE;
 
-		if ( !Init3DSampleFromAddress( hS, pSampleData, uiSampleDataSize, pWaveFormatEx, siPlaybackRate, pFilterData ) )
+	// mp3s play at the rate they decode to
+	WAVEFORMATEX waveFormat = pDecoder->GetFormat( );
+	if( pWaveFormatEx->wFormatTag == WAVE_FORMAT_MPEGLAYER3 )
+		siPlaybackRate = waveFormat.nSamplesPerSec;
+
+	// short sounds are decoded whole, the way they always were
+	PCM = pDecoder->DecodeAll( SOUNDDECODE_RESIDENT_SIZE, uiPCMSize );
+	if( PCM )
+	{
+		if ( !Init3DSampleFromAddress( hS, PCM, uiPCMSize, &waveFormat, siPlaybackRate, pFilterData ) )
 		{
 			delete [] PCM;
 			return LTFALSE;
 		}
 		pSample->m_bAllocatedSoundData = true;
+		return LTTRUE;
 	}
-	else if( pWaveFormatEx->wFormatTag == WAVE_FORMAT_MPEGLAYER3 )
-	{
-		PCM = mpeg3_decode ((char*)pFile_image, uiSampleDataSize, &uncompressedSize, pWaveFormatEx);
-
-		if( !pSample->Init( m_hResult, NULL, uncompressedSize, false, pWaveFormatEx, pFilterData ) )
-			return LTFALSE;
 
-		pSample->m_pSoundData = PCM;
-		pSample->m_bAllocatedSoundData = true;
-		pSample->m_uiSoundDataLen = uncompressedSize;
-
-		if( !pSample->Fill( ))
-		{
-			p3DSample->Term( );
-			return LTFALSE;
-		}
-
-		// set up new looping, if appropriate
-		if  ( !SetSampleNotify( pSample, true ) )
-			return LTFALSE;
-	}
-	else
+	// longer ones are decoded as they play
+	if( !p3DSample->Init( m_hResult, NULL, 0, &waveFormat, pFilterData ) ||
+		!pSample->InitStreaming( pDecoder, siPlaybackRate ))
 	{
-		printf("error in Init3DSampleFromFile - format tag %i not handled yet!\n", pWaveFormatEx->wFormatTag);
+		p3DSample->Term( );
+		return LTFALSE;
 	}
 
+	// set up new looping, if appropriate
+	if  ( !SetSampleNotify( pSample, true ) )
+		return LTFALSE;
+
 	return LTTRUE;
 }
 
@@ -2179,6 +2511,13 @@ void COpenALSoundSys::SetSampleMsPosition( LHSAMPLE hS, S32 siMilliseconds )
 	if( siMilliseconds < 0 )
 		siMilliseconds = 0;
 
+	// there's no buffer with the whole sound in it to measure
+	if( pSample->IsStreaming( ))
+	{
+		m_hResult = pSample->SetCurrentPosition(( uint32 )(( uint64 )siMilliseconds * pSample->m_waveFormat.nAvgBytesPerSec / 1000 ));
+		return;
+	}
+
 	ALint sizeInBytes;
 	ALint channels;
 	ALint bits;
@@ -2224,10 +2563,8 @@ LHSTREAM COpenALSoundSys::OpenStream( char* sFilename, uint32 nOffset, LHDIGDRIV
 {
 	LHSTREAM hStream = NULL;
 	WaveFile* pWaveFile;
-	char* PCM;
 	int i;
 	bool bSuccess = false;
-	unsigned int uncompressedSize;
 
 	uint32 uiWaveFormatSize = 0;
 	uint32 uiSampleDataSize = 0;
@@ -2246,58 +2583,38 @@ LHSTREAM COpenALSoundSys::OpenStream( char* sFilename, uint32 nOffset, LHDIGDRIV
 	for(i = 0; i < MAX_WAVE_STREAMS; i++)
 	{
 		if(!m_WaveStream[i].IsActive())
-		{
-			PCM = NULL;
-			if( pWaveFormatEx->wFormatTag == WAVE_FORMAT_MPEGLAYER3 )
-			{
-				PCM = mpeg3_decode (sStream, siStream_mem, &uncompressedSize, &m_WaveStream[i].m_wfmt);
-			}
-			else if( pWaveFormatEx->wFormatTag == WAVE_FORMAT_PCM )
-			{
-				printf("error in OpenStream for %s - PCM not handled yet!\n", sFilename);
-			}
-			else if (pWaveFormatEx->wFormatTag == WAVE_FORMAT_IMA_ADPCM)
-			{
-				printf("error in OpenStream for %s - ADPCM not handled yet!\n", sFilename);
-			}
-			else
-			{
-				printf("error in OpenStream for %s - format %i not handled yet!\n", sFilename, pWaveFormatEx->wFormatTag);
-			}
-
-			if(PCM == NULL)
-			{
-				return NULL;
-			}
-			else
-			{
-				break;
-			}
-		}
+			break;
 	}
 
 	// Error: all streams are full (max = MAX_WAVE_STREAMS)
 	if(i == MAX_WAVE_STREAMS)
 		return NULL;
 
+	// the file data is freed once the stream is open, so the decoder needs its own copy
+	TSoundDecoderPtr pDecoder = CreateDecoder( pWaveFormatEx, pSampleData, uiSampleDataSize, num_fact_samples, true );
+	if( !pDecoder )
+	{
+		printf("error in OpenStream for %s - couldn't decode it!\n", sFilename);
+		return NULL;
+	}
+
 	pWaveFile = &m_WaveStream[i];
+	pWaveFile->m_wfmt = pDecoder->GetFormat( );
 
 	CStream* pStream;
 	LT_MEM_TRACK_ALLOC(pStream = new CStream( m_pStreams, NULL ),LT_MEM_TYPE_SOUND);
 
 	pStream->Reset();
 
-	pStream->Init( m_hResult, NULL, uncompressedSize, false, NULL );
-	pStream->m_pSoundData = PCM;
-	pStream->m_uiSoundDataLen = uncompressedSize;
+	pStream->Init( m_hResult, NULL, 0, false, &pWaveFile->m_wfmt );
 	pStream->m_pWaveFile = pWaveFile;
 	pStream->m_uiNextWriteOffset = 0;
 	pStream->m_uiLastPlayPos = 0;
 	pStream->m_uiTotalPlayed = 0;
-	pStream->m_waveFormat = pWaveFile->m_wfmt;
 
-	if ( !pStream->FillBuffer( this ) )
+	if ( !pStream->InitStreaming( pDecoder, 0 ) || !pStream->FillBuffer( this ) )
 	{
+		delete pStream;
 		return NULL;
 	}
 
@@ -2319,6 +2636,14 @@ void COpenALSoundSys::SetStreamMsPosition( LHSTREAM hS, S32 siMilliseconds )
 		siMilliseconds = 0;
 
 	CStream* pStream = ( CStream* )hS;
+
+	// there's no buffer with the whole sound in it to measure
+	if( pStream->IsStreaming( ))
+	{
+		m_hResult = pStream->SetCurrentPosition(( uint32 )(( uint64 )siMilliseconds * pStream->m_waveFormat.nAvgBytesPerSec / 1000 ));
+		return;
+	}
+
 	ALint sizeInBytes;
 	ALint channels;
 	ALint bits;
@@ -2484,11 +2809,10 @@ sint32 COpenALSoundSys::InitSampleFromFile( LHSAMPLE hS, void* pFile_image, sint
 		return LTFALSE;
 
 	CSample* pSample = ( CSample* ) hS;
-	WaveFile wave;
 	char* PCM;
+	uint32 uiPCMSize;
 
 	bool bSuccess = false;
-	unsigned int uncompressedSize;
 
 	uint32 uiWaveFormatSize = 0;
 	uint32 uiSampleDataSize = 0;
@@ -2504,62 +2828,46 @@ sint32 COpenALSoundSys::InitSampleFromFile( LHSAMPLE hS, void* pFile_image, sint
 
 	WAVEFORMATEX* pWaveFormatEx = ( WAVEFORMATEX* )pWaveFormat;
 
-	if( pWaveFormatEx->wFormatTag == WAVE_FORMAT_MPEGLAYER3 )
-	{
-		PCM = mpeg3_decode ((char*)pFile_image, uiSampleDataSize, &uncompressedSize, pWaveFormatEx);
-
-		if( !pSample->Init( m_hResult, NULL, uncompressedSize, false, pWaveFormatEx, pFilterData ) )
-			return LTFALSE;
-
-		pSample->m_pSoundData = PCM;
-		pSample->m_bAllocatedSoundData = true;
-		pSample->m_uiSoundDataLen = uncompressedSize;
-
-		if( !pSample->Fill( ))
-		{
-			pSample->Term( );
-			return LTFALSE;
-		}
-
-		// set up new looping, if appropriate
-		if  ( !SetSampleNotify( pSample, true ) )
-			return LTFALSE;
-	}
-	else if( pWaveFormatEx->wFormatTag == WAVE_FORMAT_PCM )
+	if( pWaveFormatEx->wFormatTag == WAVE_FORMAT_PCM && uiSampleDataSize <= SOUNDDECODE_RESIDENT_SIZE )
 	{
 		return InitSampleFromAddress(hS, pSampleData, uiSampleDataSize, pWaveFormatEx, siPlaybackRate, pFilterData);
 	}
-	else if (pWaveFormatEx->wFormatTag == WAVE_FORMAT_IMA_ADPCM)
-	{
-		uint32 dwSamplesPerBlock = 4 << ( pWaveFormatEx->nChannels / 2 );
-		uint32 dwSamples;
-		dwSamplesPerBlock = 1 + ( pWaveFormatEx->nBlockAlign - dwSamplesPerBlock ) * 8 / dwSamplesPerBlock;
-		dwSamples = (( uiSampleDataSize + pWaveFormatEx->nBlockAlign - 1 ) /
-			pWaveFormatEx->nBlockAlign ) * dwSamplesPerBlock;
 
-		PCM = adpcm_decode_data(pSampleData, pWaveFormatEx->nChannels, dwSamples, pWaveFormatEx->nBlockAlign);
+	// the file data stays around as long as the sample does, so the decoder can use it
+	TSoundDecoderPtr pDecoder = CreateDecoder( pWaveFormatEx, pSampleData, uiSampleDataSize, num_fact_samples, false );
+	if( !pDecoder )
+		return LTFALSE;
 
-		pWaveFormatEx->wBitsPerSample = 16;
-		if (num_fact_samples < dwSamples && num_fact_samples > dwSamples - dwSamplesPerBlock)
-		{
-			dwSamples = num_fact_samples;
-		}
-		uiSampleDataSize = dwSamples * 2 * pWaveFormatEx->nChannels;
-		pSampleData = PCM;
+	// mp3s play at the rate they decode to
+	WAVEFORMATEX waveFormat = pDecoder->GetFormat( );
+	if( pWaveFormatEx->wFormatTag == WAVE_FORMAT_MPEGLAYER3 )
+		siPlaybackRate = waveFormat.nSamplesPerSec;
 
-		if ( !InitSampleFromAddress( hS, pSampleData, uiSampleDataSize, pWaveFormatEx, siPlaybackRate, pFilterData ) )
+	// short sounds are decoded whole, the way they always were
+	PCM = pDecoder->DecodeAll( SOUNDDECODE_RESIDENT_SIZE, uiPCMSize );
+	if( PCM )
+	{
+		if ( !InitSampleFromAddress( hS, PCM, uiPCMSize, &waveFormat, siPlaybackRate, pFilterData ) )
 		{
 			delete [] PCM;
 			return LTFALSE;
 		}
 		pSample->m_bAllocatedSoundData = true;
+		return LTTRUE;
 	}
-	else
+
+	// longer ones are decoded as they play
+	if( !pSample->Init( m_hResult, NULL, 0, false, &waveFormat, pFilterData ) ||
+		!pSample->InitStreaming( pDecoder, siPlaybackRate ))
 	{
-		printf("error in InitSampleFromFile - format tag %i not handled yet!\n", pWaveFormatEx->wFormatTag);
+		pSample->Term( );
 		return LTFALSE;
 	}
 
+	// set up new looping, if appropriate
+	if  ( !SetSampleNotify( pSample, true ) )
+		return LTFALSE;
+
 	return LTTRUE;
 }
 
@@ -0,0 +1,688 @@
+#include "sounddecoder.h"
+
+#include <atomic>
+#include <chrono>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ADPCM_SSE2
+#include <emmintrin.h>
+#endif
+
+//ADPCM decoding from https://github.com/dbry/adpcm-xq/
+//see adpcm_license.txt for details.
+
+/* step table */
+static const uint16 step_table[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14,
+    16, 17, 19, 21, 23, 25, 28, 31,
+    34, 37, 41, 45, 50, 55, 60, 66,
+    73, 80, 88, 97, 107, 118, 130, 143,
+    157, 173, 190, 209, 230, 253, 279, 307,
+    337, 371, 408, 449, 494, 544, 598, 658,
+    724, 796, 876, 963, 1060, 1166, 1282, 1411,
+    1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024,
+    3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484,
+    7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794,
+    32767
+};
+
+/* step index tables */
+static const int index_table[] = {
+    /* adpcm data size is 4 */
+    -1, -1, -1, -1, 2, 4, 6, 8
+};
+
+// Rather than working out the delta and the next step index from the step
+// for every nibble, they're looked up in a table indexed by the step index
+// times 16 plus the nibble. Each entry has the delta in the upper 20 bits
+// and the next step index times 16 in the lower 12, so one lookup does it.
+#define ADPCM_DELTA_SHIFT	12
+#define ADPCM_INDEX_MASK	0xFF0
+
+struct SADPCMTable
+{
+	SADPCMTable( )
+	{
+		for( int nIndex = 0; nIndex < 89; nIndex++ )
+		{
+			for( int nNibble = 0; nNibble < 16; nNibble++ )
+			{
+				int step = step_table[nIndex], delta = step >> 3;
+
+				if (nNibble & 1) delta += (step >> 2);
+				if (nNibble & 2) delta += (step >> 1);
+				if (nNibble & 4) delta += step;
+				if (nNibble & 8) delta = -delta;
+
+				int nNext = nIndex + index_table[nNibble & 7];
+				if( nNext < 0 ) nNext = 0;
+				else if( nNext > 88 ) nNext = 88;
+
+				m_Entries[nIndex * 16 + nNibble] = ( int32 )( delta * ( 1 << ADPCM_DELTA_SHIFT )) | ( nNext * 16 );
+			}
+		}
+	}
+
+	int32	m_Entries[89 * 16];
+};
+
+static const int32* GetADPCMTable( )
+{
+	static const SADPCMTable s_Table;
+	return s_Table.m_Entries;
+}
+
+static inline int16 adpcm_decode_nibble( const int32* pTable, int32& nPCM, int32& nIndex, uint32 nNibble )
+{
+	int32 nEntry = pTable[nIndex + nNibble];
+	nIndex = nEntry & ADPCM_INDEX_MASK;
+	nPCM += nEntry >> ADPCM_DELTA_SHIFT;
+	if( nPCM > 32767 ) nPCM = 32767;
+	else if( nPCM < -32768 ) nPCM = -32768;
+	return ( int16 )nPCM;
+}
+
+uint32 adpcm_samples_per_block( uint32 nBlockSize, uint32 nChannels )
+{
+	if( nBlockSize < nChannels * 4 )
+		return 0;
+
+	return 1 + ( nBlockSize - nChannels * 4 ) / ( nChannels * 4 ) * 8;
+}
+
+uint32 adpcm_decode_block( int16* pOut, const uint8* pIn, uint32 nBlockSize, uint32 nChannels )
+{
+	const int32* pTable = GetADPCMTable( );
+	int32 nPCM[8];
+	int32 nIndex[8];
+
+	if( nChannels == 0 || nChannels > 8 || nBlockSize < nChannels * 4 )
+		return 0;
+
+	for( uint32 ch = 0; ch < nChannels; ch++ )
+	{
+		*pOut++ = ( int16 )( nPCM[ch] = ( int16 )( pIn[0] | ( pIn[1] << 8 )));
+
+		// sanitize the input a little...
+		if( pIn[2] > 88 || pIn[3] )
+			return 0;
+
+		nIndex[ch] = pIn[2] * 16;
+		pIn += 4;
+	}
+
+	uint32 nGroups = ( nBlockSize - nChannels * 4 ) / ( nChannels * 4 );
+	for( uint32 nGroup = 0; nGroup < nGroups; nGroup++ )
+	{
+		for( uint32 ch = 0; ch < nChannels; ch++ )
+		{
+			int32 nChannelPCM = nPCM[ch];
+			int32 nChannelIndex = nIndex[ch];
+			int16* pChannelOut = pOut + ch;
+
+			for( uint32 i = 0; i < 4; i++ )
+			{
+				uint8 nByte = *pIn++;
+				pChannelOut[( i * 2 ) * nChannels] = adpcm_decode_nibble( pTable, nChannelPCM, nChannelIndex, nByte & 0xF );
+				pChannelOut[( i * 2 + 1 ) * nChannels] = adpcm_decode_nibble( pTable, nChannelPCM, nChannelIndex, nByte >> 4 );
+			}
+
+			nPCM[ch] = nChannelPCM;
+			nIndex[ch] = nChannelIndex;
+		}
+
+		pOut += 8 * nChannels;
+	}
+
+	return 1 + nGroups * 8;
+}
+
+#ifdef ADPCM_SSE2
+
+// Each channel of a block depends on the sample before it, so there's nothing
+// to do in parallel within one channel. Every block starts over though, so this
+// decodes four channels at once, each SIMD lane being one channel of one block:
+// four blocks of a mono sound or two of a stereo one. The table lookups are
+// still done a lane at a time, but the accumulating and the clamping, which
+// the pack does for free, are shared.
+static bool adpcm_decode_lanes( int16* pOut, const uint8* pIn, uint32 nBlockSize, uint32 nChannels, uint32 nSamplesPerBlock )
+{
+	const int32* pTable = GetADPCMTable( );
+
+	const uint8* pLaneIn[4];
+	int16* pLaneOut[4];
+	int32 nIndex[4];
+	int32 nStart[4];
+
+	for( uint32 nLane = 0; nLane < 4; nLane++ )
+	{
+		uint32 nBlock = nLane / nChannels;
+		uint32 ch = nLane % nChannels;
+		const uint8* pHeader = pIn + nBlock * nBlockSize + ch * 4;
+
+		if( pHeader[2] > 88 || pHeader[3] )
+			return false;
+
+		nStart[nLane] = ( int16 )( pHeader[0] | ( pHeader[1] << 8 ));
+		nIndex[nLane] = pHeader[2] * 16;
+
+		pLaneOut[nLane] = pOut + nBlock * nSamplesPerBlock * nChannels + ch;
+		*pLaneOut[nLane] = ( int16 )nStart[nLane];
+		pLaneOut[nLane] += nChannels;
+
+		pLaneIn[nLane] = pIn + nBlock * nBlockSize + nChannels * 4 + ch * 4;
+	}
+
+	__m128i vPCM = _mm_set_epi32( nStart[3], nStart[2], nStart[1], nStart[0] );
+	const uint32 nStride = nChannels;
+	const uint32 nGroups = ( nBlockSize - nChannels * 4 ) / ( nChannels * 4 );
+
+	for( uint32 nGroup = 0; nGroup < nGroups; nGroup++ )
+	{
+		for( uint32 i = 0; i < 4; i++ )
+		{
+			uint32 nBytes[4] = { pLaneIn[0][i], pLaneIn[1][i], pLaneIn[2][i], pLaneIn[3][i] };
+
+			for( uint32 nShift = 0; nShift < 8; nShift += 4 )
+			{
+				int32 e0 = pTable[nIndex[0] + (( nBytes[0] >> nShift ) & 0xF )];
+				int32 e1 = pTable[nIndex[1] + (( nBytes[1] >> nShift ) & 0xF )];
+				int32 e2 = pTable[nIndex[2] + (( nBytes[2] >> nShift ) & 0xF )];
+				int32 e3 = pTable[nIndex[3] + (( nBytes[3] >> nShift ) & 0xF )];
+				nIndex[0] = e0 & ADPCM_INDEX_MASK;
+				nIndex[1] = e1 & ADPCM_INDEX_MASK;
+				nIndex[2] = e2 & ADPCM_INDEX_MASK;
+				nIndex[3] = e3 & ADPCM_INDEX_MASK;
+
+				vPCM = _mm_add_epi32( vPCM, _mm_srai_epi32( _mm_set_epi32( e3, e2, e1, e0 ), ADPCM_DELTA_SHIFT ));
+
+				// saturate to 16 bits, and widen back out for the next sample
+				__m128i vClamped = _mm_packs_epi32( vPCM, vPCM );
+				vPCM = _mm_srai_epi32( _mm_unpacklo_epi16( vClamped, vClamped ), 16 );
+
+				*pLaneOut[0] = ( int16 )_mm_extract_epi16( vClamped, 0 );
+				*pLaneOut[1] = ( int16 )_mm_extract_epi16( vClamped, 1 );
+				*pLaneOut[2] = ( int16 )_mm_extract_epi16( vClamped, 2 );
+				*pLaneOut[3] = ( int16 )_mm_extract_epi16( vClamped, 3 );
+				pLaneOut[0] += nStride;
+				pLaneOut[1] += nStride;
+				pLaneOut[2] += nStride;
+				pLaneOut[3] += nStride;
+			}
+		}
+
+		for( uint32 nLane = 0; nLane < 4; nLane++ )
+			pLaneIn[nLane] += nChannels * 4;
+	}
+
+	return true;
+}
+
+#endif	// ADPCM_SSE2
+
+bool adpcm_has_simd( )
+{
+#ifdef ADPCM_SSE2
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool adpcm_decode_blocks( int16* pOut, const uint8* pIn, uint32 nNumBlocks, uint32 nBlockSize, uint32 nChannels, bool bSIMD )
+{
+	uint32 nSamplesPerBlock = adpcm_samples_per_block( nBlockSize, nChannels );
+	if( nSamplesPerBlock == 0 )
+		return false;
+
+	uint32 nBlock = 0;
+
+#ifdef ADPCM_SSE2
+	if( bSIMD && ( nChannels == 1 || nChannels == 2 ))
+	{
+		uint32 nBlocksPerPass = 4 / nChannels;
+		for( ; nBlock + nBlocksPerPass <= nNumBlocks; nBlock += nBlocksPerPass )
+		{
+			if( !adpcm_decode_lanes( pOut + nBlock * nSamplesPerBlock * nChannels, pIn + nBlock * nBlockSize,
+				nBlockSize, nChannels, nSamplesPerBlock ))
+				return false;
+		}
+	}
+#endif
+
+	for( ; nBlock < nNumBlocks; nBlock++ )
+	{
+		if( adpcm_decode_block( pOut + nBlock * nSamplesPerBlock * nChannels, pIn + nBlock * nBlockSize,
+			nBlockSize, nChannels ) != nSamplesPerBlock )
+			return false;
+	}
+
+	return true;
+}
+
+//! CSoundDecoder
+
+static std::atomic<uint32> s_uiNextDecoderID( 1 );
+
+CSoundDecoder::CSoundDecoder( ) :
+	m_uiChunkSize( 0 ),
+	m_uiDecodedSize( 0 ),
+	m_pData( NULL ),
+	m_uiDataSize( 0 ),
+	m_uiID( s_uiNextDecoderID++ )
+{
+	memset( &m_Format, 0, sizeof( m_Format ));
+}
+
+CSoundDecoder::~CSoundDecoder( )
+{
+}
+
+void CSoundDecoder::SetData( const void* pData, uint32 uiDataSize, bool bCopy )
+{
+	if( bCopy )
+	{
+		m_DataCopy.assign(( const uint8* )pData, ( const uint8* )pData + uiDataSize );
+		m_pData = m_DataCopy.empty( ) ? NULL : &m_DataCopy[0];
+	}
+	else
+	{
+		m_DataCopy.clear( );
+		m_pData = ( const uint8* )pData;
+	}
+
+	m_uiDataSize = uiDataSize;
+}
+
+char* CSoundDecoder::DecodeAll( uint32 uiMaxSize, uint32& uiSize )
+{
+	uiSize = 0;
+	if( m_uiDecodedSize > uiMaxSize )
+		return NULL;
+
+	std::lock_guard<std::mutex> cLock( m_Mutex );
+
+	std::vector<uint8> Decoded;
+	std::vector<uint8> Chunk;
+	for( uint32 uiChunk = 0; ; uiChunk++ )
+	{
+		if( !DecodeChunk( uiChunk, Chunk ))
+			return NULL;
+
+		if( Chunk.empty( ))
+			break;
+
+		if( Decoded.size( ) + Chunk.size( ) > uiMaxSize )
+			return NULL;
+
+		Decoded.insert( Decoded.end( ), Chunk.begin( ), Chunk.end( ));
+	}
+
+	if( Decoded.empty( ))
+		return NULL;
+
+	char* pDecoded;
+	LT_MEM_TRACK_ALLOC( pDecoded = new char[ Decoded.size( ) ], LT_MEM_TYPE_SOUND );
+	memcpy( pDecoded, &Decoded[0], Decoded.size( ));
+	uiSize = ( uint32 )Decoded.size( );
+	return pDecoded;
+}
+
+//! CPCMDecoder
+
+bool CPCMDecoder::Init( const WAVEFORMATEX& Format, const void* pData, uint32 uiDataSize, bool bCopy )
+{
+	if( Format.wFormatTag != WAVE_FORMAT_PCM || Format.nBlockAlign == 0 || pData == NULL )
+		return false;
+
+	SetData( pData, uiDataSize, bCopy );
+
+	m_Format = Format;
+	m_uiChunkSize = ( SOUNDDECODE_CHUNK_SIZE / Format.nBlockAlign ) * Format.nBlockAlign;
+	if( m_uiChunkSize == 0 )
+		m_uiChunkSize = Format.nBlockAlign;
+	m_uiDecodedSize = ( uiDataSize / Format.nBlockAlign ) * Format.nBlockAlign;
+	return true;
+}
+
+bool CPCMDecoder::DecodeChunk( uint32 uiChunk, std::vector<uint8>& Out )
+{
+	Out.clear( );
+
+	uint64 uiStart = ( uint64 )uiChunk * m_uiChunkSize;
+	if( uiStart >= m_uiDecodedSize )
+		return true;
+
+	uint32 uiSize = ( uint32 )LTMIN(( uint64 )m_uiChunkSize, m_uiDecodedSize - uiStart );
+	Out.assign( m_pData + uiStart, m_pData + uiStart + uiSize );
+	return true;
+}
+
+//! CADPCMDecoder
+
+CADPCMDecoder::CADPCMDecoder( ) :
+	m_uiBlockSize( 0 ),
+	m_uiSamplesPerBlock( 0 ),
+	m_uiBlocksPerChunk( 0 ),
+	m_uiNumBlocks( 0 ),
+	m_bSIMD( true )
+{
+}
+
+bool CADPCMDecoder::Init( const WAVEFORMATEX& Format, const void* pData, uint32 uiDataSize, uint32 uiFactSamples, bool bCopy )
+{
+	if( Format.wFormatTag != WAVE_FORMAT_IMA_ADPCM || pData == NULL || Format.nChannels == 0 || Format.nChannels > 8 )
+		return false;
+
+	m_uiBlockSize = Format.nBlockAlign;
+	m_uiSamplesPerBlock = adpcm_samples_per_block( m_uiBlockSize, Format.nChannels );
+	if( m_uiSamplesPerBlock == 0 )
+		return false;
+
+	SetData( pData, uiDataSize, bCopy );
+
+	// the last block can be short
+	m_uiNumBlocks = ( uiDataSize + m_uiBlockSize - 1 ) / m_uiBlockSize;
+	uint32 uiLastBlockSize = uiDataSize - ( m_uiNumBlocks - 1 ) * m_uiBlockSize;
+	uint32 uiSamples = ( m_uiNumBlocks - 1 ) * m_uiSamplesPerBlock + adpcm_samples_per_block( uiLastBlockSize, Format.nChannels );
+
+	// the fact chunk has the real length, as long as it's within the last block
+	if( uiFactSamples != 0 && uiFactSamples < uiSamples && uiFactSamples > uiSamples - m_uiSamplesPerBlock )
+		uiSamples = uiFactSamples;
+
+	uint32 uiBytesPerBlock = m_uiSamplesPerBlock * Format.nChannels * 2;
+	m_uiBlocksPerChunk = LTMAX( SOUNDDECODE_CHUNK_SIZE / uiBytesPerBlock, ( uint32 )1 );
+
+	m_Format = Format;
+	m_Format.wFormatTag = WAVE_FORMAT_PCM;
+	m_Format.wBitsPerSample = 16;
+	m_Format.nBlockAlign = Format.nChannels * 2;
+	m_Format.nAvgBytesPerSec = m_Format.nSamplesPerSec * m_Format.nBlockAlign;
+	m_Format.cbSize = 0;
+
+	m_uiChunkSize = m_uiBlocksPerChunk * uiBytesPerBlock;
+	m_uiDecodedSize = uiSamples * m_Format.nBlockAlign;
+	return true;
+}
+
+bool CADPCMDecoder::DecodeChunk( uint32 uiChunk, std::vector<uint8>& Out )
+{
+	Out.clear( );
+
+	uint64 uiStart = ( uint64 )uiChunk * m_uiChunkSize;
+	if( uiStart >= m_uiDecodedSize )
+		return true;
+
+	uint32 uiFirstBlock = uiChunk * m_uiBlocksPerChunk;
+	uint32 uiNumBlocks = LTMIN( m_uiBlocksPerChunk, m_uiNumBlocks - uiFirstBlock );
+	uint32 uiChannels = m_Format.nChannels;
+
+	Out.resize(( size_t )uiNumBlocks * m_uiSamplesPerBlock * uiChannels * 2 );
+	int16* pOut = ( int16* )&Out[0];
+	const uint8* pIn = m_pData + ( size_t )uiFirstBlock * m_uiBlockSize;
+
+	// all but the last block of the sound are full
+	uint32 uiFullBlocks = uiNumBlocks;
+	if( uiFirstBlock + uiNumBlocks == m_uiNumBlocks )
+		uiFullBlocks--;
+
+	if( !adpcm_decode_blocks( pOut, pIn, uiFullBlocks, m_uiBlockSize, uiChannels, m_bSIMD ))
+		return false;
+
+	if( uiFullBlocks != uiNumBlocks )
+	{
+		uint32 uiLastBlockSize = m_uiDataSize - ( m_uiNumBlocks - 1 ) * m_uiBlockSize;
+		if( adpcm_decode_block( pOut + uiFullBlocks * m_uiSamplesPerBlock * uiChannels,
+			pIn + uiFullBlocks * m_uiBlockSize, uiLastBlockSize, uiChannels ) == 0 )
+			return false;
+	}
+
+	Out.resize(( size_t )LTMIN(( uint64 )m_uiChunkSize, m_uiDecodedSize - uiStart ));
+	return true;
+}
+
+//! CDecodedSoundCache
+
+CDecodedSoundCache::CDecodedSoundCache( ) :
+	m_uiMaxSize( SOUNDDECODE_CACHE_SIZE ),
+	m_uiDecoding( 0 ),
+	m_bShutdown( false )
+{
+	memset( &m_Stats, 0, sizeof( m_Stats ));
+}
+
+CDecodedSoundCache::~CDecodedSoundCache( )
+{
+	Term( );
+}
+
+void CDecodedSoundCache::Init( uint32 uiMaxSize, bool bThreaded )
+{
+	Term( );
+
+	m_uiMaxSize = uiMaxSize;
+	m_bShutdown = false;
+
+	if( bThreaded )
+		m_Thread = std::thread( &CDecodedSoundCache::DecodeMain, this );
+}
+
+void CDecodedSoundCache::Term( )
+{
+	if( m_Thread.joinable( ))
+	{
+		{
+			std::lock_guard<std::mutex> cLock( m_Mutex );
+			m_bShutdown = true;
+		}
+		m_RequestCondition.notify_all( );
+		m_Thread.join( );
+	}
+
+	std::lock_guard<std::mutex> cLock( m_Mutex );
+	m_Requests.clear( );
+	m_Requested.clear( );
+	m_Entries.clear( );
+	m_EntryMap.clear( );
+	m_Stats.m_uiCachedSize = 0;
+}
+
+TDecodedChunk CDecodedSoundCache::Find( uint64 uiKey )
+{
+	std::unordered_map<uint64, TEntryList::iterator>::iterator itEntry = m_EntryMap.find( uiKey );
+	if( itEntry == m_EntryMap.end( ))
+		return TDecodedChunk( );
+
+	// move it to the front, since it's now the most recently used
+	m_Entries.splice( m_Entries.begin( ), m_Entries, itEntry->second );
+	return itEntry->second->second;
+}
+
+void CDecodedSoundCache::Add( uint64 uiKey, const TDecodedChunk& pChunk )
+{
+	if( m_EntryMap.find( uiKey ) != m_EntryMap.end( ))
+		return;
+
+	m_Entries.push_front( TEntry( uiKey, pChunk ));
+	m_EntryMap[uiKey] = m_Entries.begin( );
+	m_Stats.m_uiCachedSize += ( uint32 )pChunk->size( );
+
+	// keep the one that was just added, even if it's bigger than the whole cache.
+	// Anyone still using an evicted chunk has a reference to it, so it stays valid
+	while( m_Stats.m_uiCachedSize > m_uiMaxSize && m_Entries.size( ) > 1 )
+	{
+		TEntry& Oldest = m_Entries.back( );
+		m_Stats.m_uiCachedSize -= ( uint32 )Oldest.second->size( );
+		m_EntryMap.erase( Oldest.first );
+		m_Entries.pop_back( );
+		m_Stats.m_uiEvictions++;
+	}
+}
+
+TDecodedChunk CDecodedSoundCache::Decode( CSoundDecoder* pDecoder, uint32 uiChunk, bool bPrefetch )
+{
+	uint64 uiKey = GetKey( pDecoder, uiChunk );
+
+	std::lock_guard<std::mutex> cDecoderLock( pDecoder->GetMutex( ));
+
+	// it might have been decoded while waiting for the decoder
+	{
+		std::lock_guard<std::mutex> cLock( m_Mutex );
+		TDecodedChunk pChunk = Find( uiKey );
+		if( pChunk )
+		{
+			if( !bPrefetch )
+				m_Stats.m_uiHits++;
+			return pChunk;
+		}
+	}
+
+	std::chrono::steady_clock::time_point StartTime = std::chrono::steady_clock::now( );
+
+	std::shared_ptr<std::vector<uint8> > pDecoded( new std::vector<uint8> );
+	bool bSuccess = pDecoder->DecodeChunk( uiChunk, *pDecoded );
+
+	uint64 uiMicroseconds = ( uint64 )std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::steady_clock::now( ) - StartTime ).count( );
+
+	std::lock_guard<std::mutex> cLock( m_Mutex );
+	if( !bPrefetch )
+		m_Stats.m_uiMisses++;
+
+	if( !bSuccess )
+		return TDecodedChunk( );
+
+	m_Stats.m_uiBytesDecoded += pDecoded->size( );
+	m_Stats.m_uiDecodeMicroseconds += uiMicroseconds;
+
+	// the end of the sound isn't worth keeping
+	if( pDecoded->empty( ))
+		return pDecoded;
+
+	m_Stats.m_uiChunksDecoded++;
+	Add( uiKey, pDecoded );
+	return pDecoded;
+}
+
+TDecodedChunk CDecodedSoundCache::GetChunk( const TSoundDecoderPtr& pDecoder, uint32 uiChunk )
+{
+	if( !pDecoder )
+		return TDecodedChunk( );
+
+	{
+		std::lock_guard<std::mutex> cLock( m_Mutex );
+		TDecodedChunk pChunk = Find( GetKey( pDecoder.get( ), uiChunk ));
+		if( pChunk )
+		{
+			m_Stats.m_uiHits++;
+			return pChunk;
+		}
+	}
+
+	return Decode( pDecoder.get( ), uiChunk, false );
+}
+
+void CDecodedSoundCache::Prefetch( const TSoundDecoderPtr& pDecoder, uint32 uiChunk )
+{
+	if( !pDecoder || !m_Thread.joinable( ))
+		return;
+
+	// don't bother with chunks that are known to be past the end
+	if( pDecoder->GetDecodedSize( ) != 0 && ( uint64 )uiChunk * pDecoder->GetChunkSize( ) >= pDecoder->GetDecodedSize( ))
+		return;
+
+	uint64 uiKey = GetKey( pDecoder.get( ), uiChunk );
+
+	{
+		std::lock_guard<std::mutex> cLock( m_Mutex );
+		if( m_EntryMap.find( uiKey ) != m_EntryMap.end( ) || !m_Requested.insert( uiKey ).second )
+			return;
+
+		m_Requests.push_back( std::make_pair( pDecoder, uiChunk ));
+	}
+
+	m_RequestCondition.notify_one( );
+}
+
+void CDecodedSoundCache::RemoveDecoder( const CSoundDecoder* pDecoder )
+{
+	if( !pDecoder )
+		return;
+
+	std::lock_guard<std::mutex> cLock( m_Mutex );
+
+	for( std::deque<std::pair<TSoundDecoderPtr, uint32> >::iterator itRequest = m_Requests.begin( ); itRequest != m_Requests.end( ); )
+	{
+		if( itRequest->first.get( ) == pDecoder )
+		{
+			m_Requested.erase( GetKey( pDecoder, itRequest->second ));
+			itRequest = m_Requests.erase( itRequest );
+		}
+		else
+			++itRequest;
+	}
+
+	for( TEntryList::iterator itEntry = m_Entries.begin( ); itEntry != m_Entries.end( ); )
+	{
+		if(( uint32 )( itEntry->first >> 32 ) == pDecoder->GetID( ))
+		{
+			m_Stats.m_uiCachedSize -= ( uint32 )itEntry->second->size( );
+			m_EntryMap.erase( itEntry->first );
+			itEntry = m_Entries.erase( itEntry );
+		}
+		else
+			++itEntry;
+	}
+}
+
+void CDecodedSoundCache::WaitForPrefetches( )
+{
+	std::unique_lock<std::mutex> cLock( m_Mutex );
+	m_IdleCondition.wait( cLock, [this] { return m_Requests.empty( ) && m_uiDecoding == 0; } );
+}
+
+CDecodedSoundCache::SStats CDecodedSoundCache::GetStats( )
+{
+	std::lock_guard<std::mutex> cLock( m_Mutex );
+	return m_Stats;
+}
+
+void CDecodedSoundCache::ResetStats( )
+{
+	std::lock_guard<std::mutex> cLock( m_Mutex );
+	uint32 uiCachedSize = m_Stats.m_uiCachedSize;
+	memset( &m_Stats, 0, sizeof( m_Stats ));
+	m_Stats.m_uiCachedSize = uiCachedSize;
+}
+
+void CDecodedSoundCache::DecodeMain( )
+{
+	std::unique_lock<std::mutex> cLock( m_Mutex );
+
+	for( ;; )
+	{
+		m_RequestCondition.wait( cLock, [this] { return m_bShutdown || !m_Requests.empty( ); } );
+		if( m_bShutdown )
+			break;
+
+		// the request holds a reference, so the decoder stays around while it's decoded
+		// even if the sound is released in the meantime
+		std::pair<TSoundDecoderPtr, uint32> Request = m_Requests.front( );
+		m_Requests.pop_front( );
+		m_Requested.erase( GetKey( Request.first.get( ), Request.second ));
+		m_uiDecoding++;
+
+		cLock.unlock( );
+		Decode( Request.first.get( ), Request.second, true );
+		Request.first.reset( );
+		cLock.lock( );
+
+		m_uiDecoding--;
+		if( m_Requests.empty( ) && m_uiDecoding == 0 )
+			m_IdleCondition.notify_all( );
+	}
+
+	m_IdleCondition.notify_all( );
+}
@@ -0,0 +1,238 @@
+//------------------------------------------------------------------
+//
+//	FILE	  : sounddecoder.h
+//
+//	PURPOSE	  : Decoding of compressed sounds into 16 bit PCM a chunk
+//				at a time, and the size limited cache the decoded
+//				chunks are kept in.
+//
+//				Short sounds are still decoded whole when they are
+//				loaded. Longer ones are decoded as they play, with the
+//				upcoming chunks decoded ahead of time on the decode
+//				thread, so only the part of the sound that is playing
+//				has to be kept around as PCM.
+//
+//------------------------------------------------------------------
+
+#ifndef __SOUNDDECODER_H__
+#define __SOUNDDECODER_H__
+
+#ifndef __WAVE_H__
+#include "wave.h"
+#endif
+
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// the size of the decoded chunks. Decoders round this to whole blocks
+#define SOUNDDECODE_CHUNK_SIZE			(64 * 1024)
+
+// sounds that decode to this size or less are kept whole
+#define SOUNDDECODE_RESIDENT_SIZE		(512 * 1024)
+
+// the amount of decoded data the cache holds before chunks are evicted
+#define SOUNDDECODE_CACHE_SIZE			(16 * 1024 * 1024)
+
+// the number of buffers queued up on a source that is playing a streamed sound
+#define SOUNDDECODE_NUM_BUFFERS			4
+
+// decodes IMA ADPCM blocks, which must all be nBlockSize long, into interleaved
+// 16 bit samples. Returns false if a block header is bad. When bSIMD is set, the
+// blocks are decoded several channels at a time where the CPU supports it
+bool adpcm_decode_blocks( int16* pOut, const uint8* pIn, uint32 nNumBlocks, uint32 nBlockSize, uint32 nChannels, bool bSIMD = true );
+
+// decodes a single IMA ADPCM block that may be shorter than the block size,
+// returning the number of samples per channel that were decoded
+uint32 adpcm_decode_block( int16* pOut, const uint8* pIn, uint32 nBlockSize, uint32 nChannels );
+
+// the number of samples per channel in a full IMA ADPCM block
+uint32 adpcm_samples_per_block( uint32 nBlockSize, uint32 nChannels );
+
+// whether adpcm_decode_blocks has a SIMD path on this build
+bool adpcm_has_simd( );
+
+
+//! CSoundDecoder
+
+// produces the PCM for a compressed sound a chunk at a time. Every chunk except
+// for the last is GetChunkSize bytes long, so a byte position in the sound maps
+// straight onto a chunk. Decoders aren't thread safe, the mutex has to be held
+// while decoding
+class CSoundDecoder
+{
+public:
+
+	CSoundDecoder( );
+	virtual ~CSoundDecoder( );
+
+	// the format of the decoded data, always 16 bit PCM
+	const WAVEFORMATEX&	GetFormat( ) const			{ return m_Format; }
+
+	// the size of a decoded chunk in bytes
+	uint32				GetChunkSize( ) const		{ return m_uiChunkSize; }
+
+	// the total size of the decoded sound, 0 if that isn't known until it has been decoded to the end
+	uint32				GetDecodedSize( ) const		{ return m_uiDecodedSize; }
+
+	// identifies the decoder in the cache
+	uint32				GetID( ) const				{ return m_uiID; }
+
+	std::mutex&			GetMutex( )					{ return m_Mutex; }
+
+	// decodes the chunk, leaving the output empty past the end of the sound. Returns
+	// false if the data is bad
+	virtual bool		DecodeChunk( uint32 uiChunk, std::vector<uint8>& Out ) = 0;
+
+	// decodes the whole sound if it is no bigger than uiMaxSize, returning an array
+	// allocated with new[]. Returns NULL if the sound is too big or can't be decoded
+	char*				DecodeAll( uint32 uiMaxSize, uint32& uiSize );
+
+protected:
+
+	// takes a copy of the compressed data if asked to, since streams don't keep theirs
+	void				SetData( const void* pData, uint32 uiDataSize, bool bCopy );
+
+	WAVEFORMATEX		m_Format;
+	uint32				m_uiChunkSize;
+	uint32				m_uiDecodedSize;
+
+	const uint8*		m_pData;
+	uint32				m_uiDataSize;
+	std::vector<uint8>	m_DataCopy;
+
+private:
+
+	uint32				m_uiID;
+	std::mutex			m_Mutex;
+};
+
+//! CPCMDecoder
+
+// PCM doesn't need decoding, but going through a decoder lets long PCM
+// sounds stream the same way as the compressed ones
+class CPCMDecoder : public CSoundDecoder
+{
+public:
+
+	bool				Init( const WAVEFORMATEX& Format, const void* pData, uint32 uiDataSize, bool bCopy );
+	virtual bool		DecodeChunk( uint32 uiChunk, std::vector<uint8>& Out );
+};
+
+//! CADPCMDecoder
+
+// IMA ADPCM, where each block starts over, so any chunk can be decoded
+// without decoding the ones before it
+class CADPCMDecoder : public CSoundDecoder
+{
+public:
+
+	CADPCMDecoder( );
+
+	// uiFactSamples is the sample count from the fact chunk, 0 if there isn't one
+	bool				Init( const WAVEFORMATEX& Format, const void* pData, uint32 uiDataSize, uint32 uiFactSamples, bool bCopy );
+	virtual bool		DecodeChunk( uint32 uiChunk, std::vector<uint8>& Out );
+
+	// turns the SIMD decoding on and off, for comparing the two
+	void				SetUseSIMD( bool bSIMD )	{ m_bSIMD = bSIMD; }
+
+private:
+
+	uint32				m_uiBlockSize;
+	uint32				m_uiSamplesPerBlock;
+	uint32				m_uiBlocksPerChunk;
+	uint32				m_uiNumBlocks;
+	bool				m_bSIMD;
+};
+
+typedef std::shared_ptr<CSoundDecoder>				TSoundDecoderPtr;
+typedef std::shared_ptr<const std::vector<uint8> >	TDecodedChunk;
+
+
+//! CDecodedSoundCache
+
+// holds on to the most recently used decoded chunks of all the streamed sounds,
+// and runs the thread that decodes the chunks ahead of when they're needed
+class CDecodedSoundCache
+{
+public:
+
+	CDecodedSoundCache( );
+	~CDecodedSoundCache( );
+
+	// uiMaxSize is the number of bytes of decoded data to keep. Without the decode
+	// thread, chunks are only decoded when they are asked for
+	void				Init( uint32 uiMaxSize, bool bThreaded );
+	void				Term( );
+
+	// gets a decoded chunk, decoding it here if the decode thread hasn't already.
+	// The chunk is empty past the end of the sound, and NULL if it couldn't be decoded
+	TDecodedChunk		GetChunk( const TSoundDecoderPtr& pDecoder, uint32 uiChunk );
+
+	// asks the decode thread to decode a chunk that will be needed soon
+	void				Prefetch( const TSoundDecoderPtr& pDecoder, uint32 uiChunk );
+
+	// throws out everything for a decoder that is going away
+	void				RemoveDecoder( const CSoundDecoder* pDecoder );
+
+	// waits until the decode thread has gone through all the chunks it was asked for
+	void				WaitForPrefetches( );
+
+	struct SStats
+	{
+		uint64	m_uiBytesDecoded;		// decoded output, both here and on the decode thread
+		uint64	m_uiDecodeMicroseconds;	// time spent decoding it
+		uint32	m_uiChunksDecoded;
+		uint32	m_uiHits;				// chunks that were already decoded when they were asked for
+		uint32	m_uiMisses;				// chunks that had to be decoded when they were asked for
+		uint32	m_uiEvictions;
+		uint32	m_uiCachedSize;			// bytes of decoded data currently held
+	};
+
+	SStats				GetStats( );
+	void				ResetStats( );
+
+private:
+
+	typedef std::pair<uint64, TDecodedChunk>	TEntry;
+	typedef std::list<TEntry>					TEntryList;
+
+	static uint64		GetKey( const CSoundDecoder* pDecoder, uint32 uiChunk )	{ return ( ( uint64 )pDecoder->GetID( ) << 32 ) | uiChunk; }
+
+	// decodes a chunk with the decoder locked and adds it. Called without the cache locked
+	TDecodedChunk		Decode( CSoundDecoder* pDecoder, uint32 uiChunk, bool bPrefetch );
+
+	// these need the cache locked
+	TDecodedChunk		Find( uint64 uiKey );
+	void				Add( uint64 uiKey, const TDecodedChunk& pChunk );
+
+	// decode thread main loop
+	void				DecodeMain( );
+
+	std::mutex			m_Mutex;
+
+	// most recently used first
+	TEntryList			m_Entries;
+	std::unordered_map<uint64, TEntryList::iterator>	m_EntryMap;
+	uint32				m_uiMaxSize;
+
+	// the chunks the decode thread has been asked for
+	std::deque<std::pair<TSoundDecoderPtr, uint32> >	m_Requests;
+	std::unordered_set<uint64>							m_Requested;
+	uint32				m_uiDecoding;
+
+	std::thread			m_Thread;
+	std::condition_variable	m_RequestCondition;
+	std::condition_variable	m_IdleCondition;
+	bool				m_bShutdown;
+
+	SStats				m_Stats;
+};
+
+#endif	// __SOUNDDECODER_H__
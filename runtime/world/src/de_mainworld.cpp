@@ -20,6 +20,9 @@
 #include "packetdefs.h"
 #include "s_client.h"
 #include "servermgr.h"
+#include "world_bsp_blob.h"
+
+#include <vector>
 
 #ifndef __LINUX
      #include "renderstruct.h"
@@ -265,7 +268,9 @@ void WorldBsp::Clear()
     m_nPoints = 0;
 
     m_TextureNameData = NULL;
+    m_TextureNameDataSize = 0;
     m_TextureNames = NULL;
+    m_nTextures = 0;
 
     m_MinBox.Init();
     m_MaxBox.Init();
@@ -276,6 +281,8 @@ void WorldBsp::Clear()
 
     m_PolyData = NULL;
     m_PolyDataSize = 0;
+
+    m_BlobData = NULL;
     
     m_WorldInfoFlags = 0;
 
@@ -286,15 +293,23 @@ void WorldBsp::Clear()
 void WorldBsp::Term()
 {
 	//free up all of our allocations
-    dfree(m_PolyData);
-    dfree(m_Polies);
-    dfree(m_Points);
-    dfree(m_Planes);
-    delete [] m_Surfaces;
-    delete [] m_Nodes;
-    
-    dfree(m_TextureNames);
-    dfree(m_TextureNameData);
+    if (m_BlobData)
+    {
+        //everything lives in the blob.
+        dfree(m_BlobData);
+    }
+    else
+    {
+        dfree(m_PolyData);
+        dfree(m_Polies);
+        dfree(m_Points);
+        dfree(m_Planes);
+        delete [] m_Surfaces;
+        delete [] m_Nodes;
+        
+        dfree(m_TextureNames);
+        dfree(m_TextureNameData);
+    }
 
     g_WorldGeometryMemory -= m_MemoryUse;
 
@@ -369,11 +384,9 @@ struct SDiskPoly
 ELoadWorldStatus WorldBsp::Load(ILTStream *pStream, bool bUsePlaneTypes) 
 {
     uint32 i, k;
-    uint16 wLeaf;
 
-    uint32 curVert, nLeafs;
+    uint32 nLeafs;
     uint32 nPoints, nPolies, nVerts, totalVisListSize;
-    uint32 poliesStartPos;
     uint32 poliesSize;
     
     uint32 curPos;
@@ -386,7 +399,6 @@ ELoadWorldStatus WorldBsp::Load(ILTStream *pStream, bool bUsePlaneTypes)
     uint16 tempWord;
     ConParse conParse;
     uint32 nSections;
-    uint8 nVertices;
 	uint32 nUserPortals;
 	uint32 nLeafLists;
       
@@ -429,33 +441,44 @@ ELoadWorldStatus WorldBsp::Load(ILTStream *pStream, bool bUsePlaneTypes)
     LT_MEM_TRACK_ALLOC(m_TextureNameData = (char*)dalloc_z(nNamesLen),LT_MEM_TYPE_WORLD);
     LT_MEM_TRACK_ALLOC(m_TextureNames = (char**)dalloc_z(sizeof(char*) * nTextures),LT_MEM_TYPE_WORLD);
 
+    m_TextureNameDataSize = nNamesLen;
+    m_nTextures = nTextures;
+
+    // The names are stored back to back, so read them all at once and split them up.
+    pStream->Read(m_TextureNameData, nNamesLen);
+
     curPos = 0;
     for (i=0; i < nTextures; i++)
     {
         m_TextureNames[i] = &m_TextureNameData[curPos];
-        for (;;)
+        while ((curPos < nNamesLen) && (m_TextureNameData[curPos] != 0))
         {
-            STREAM_READ(m_TextureNameData[curPos]);
             curPos++;
-            if (m_TextureNameData[curPos-1] == 0)
-                break;
         }
+
+        if (curPos >= nNamesLen)
+            return LoadWorld_InvalidFile;
+
+        curPos++;
     }
 	
-    // Figure out how much space to allocate for the polygon buffers.
-    poliesSize = 0;
-    pStream->GetPos(&poliesStartPos);
+    // Read the vertex counts of all the polies so we can figure out how much
+    // space to allocate for the polygon buffers.
+    std::vector<uint8> vertexCounts(nPolies);
+    pStream->Read(vertexCounts.data(), nPolies);
 
-    // Read in the initial structure sizes so it can do structure alignment.    
+    poliesSize = 0;
+    uint32 diskPoliesSize = 0;
 	for (i=0; i < nPolies; i++) 
 	{
-		STREAM_READ(nVertices);
+        if (vertexCounts[i] > MAX_WORLDPOLY_VERTS)
+            return LoadWorld_InvalidFile;
 
-		poliesSize += WORLDPOLY_SIZE(nVertices);
+		poliesSize += WORLDPOLY_SIZE(vertexCounts[i]);
 		poliesSize = ALIGN_MEMORY(poliesSize); 
-	}
 
-    pStream->SeekTo(poliesStartPos);
+        diskPoliesSize += SDiskPoly::CalcPolyReadSize(vertexCounts[i]);
+	}
 
     // (Try to) allocate all the data.
     m_PolyDataSize = poliesSize;
@@ -485,19 +508,15 @@ ELoadWorldStatus WorldBsp::Load(ILTStream *pStream, bool bUsePlaneTypes)
     m_nSurfaces = nSurfaces;
 
     // Construct all the polygons.
-    curVert = 0;
     curPos = 0;
     for (i=0; i < nPolies; i++) 
 	{
-        STREAM_READ(nVertices);
-
         pPoly = (WorldPoly*)(&m_PolyData[curPos]);
         pPoly->SetIndex(i);
         m_Polies[i] = pPoly;
-        pPoly->SetNumVertices(nVertices);
+        pPoly->SetNumVertices(vertexCounts[i]);
 
-        curVert += nVertices;
-		curPos  += WORLDPOLY_SIZE(nVertices);
+		curPos  += WORLDPOLY_SIZE(vertexCounts[i]);
         curPos  = ALIGN_MEMORY(curPos); 
 	}
 
@@ -534,54 +553,69 @@ ELoadWorldStatus WorldBsp::Load(ILTStream *pStream, bool bUsePlaneTypes)
 	pStream->Read(m_Planes, sizeof(LTPlane) * nPlanes);
 
     // Read in the surfaces.
-	SDiskSurface DiskSurface;
+    std::vector<SDiskSurface> diskSurfaces(nSurfaces);
+	pStream->Read(diskSurfaces.data(), sizeof(SDiskSurface) * nSurfaces);
+
     for (i=0; i < nSurfaces; i++)
     {
-		pStream->Read(&DiskSurface, sizeof(DiskSurface));
-
 		m_Surfaces[i].m_pTexture		= NULL;
-        m_Surfaces[i].m_Flags			= DiskSurface.m_nFlags;
-        m_Surfaces[i].m_iTexture		= DiskSurface.m_nTexture;
-        m_Surfaces[i].m_TextureFlags	= DiskSurface.m_nTextureFlags;
+        m_Surfaces[i].m_Flags			= diskSurfaces[i].m_nFlags;
+        m_Surfaces[i].m_iTexture		= diskSurfaces[i].m_nTexture;
+        m_Surfaces[i].m_TextureFlags	= diskSurfaces[i].m_nTextureFlags;
     }
 
     // Read in all the polies.
-	SDiskPoly DiskPoly;
+    std::vector<uint32> diskPolies(diskPoliesSize / sizeof(uint32));
+	pStream->Read(diskPolies.data(), diskPoliesSize);
+
+    const uint32 *pDiskPoly = diskPolies.data();
     for (i=0; i < nPolies; i++)
     {
         pPoly = m_Polies[i];
 
-		//read in our polygon from disk
-		pStream->Read(&DiskPoly, SDiskPoly::CalcPolyReadSize(pPoly->GetNumVertices()));
+		//each polygon is its surface, its plane and then its vertex indices
+        uint32 nSurface = pDiskPoly[0];
+        uint32 nPlane = pDiskPoly[1];
+        const uint32 *pVerts = &pDiskPoly[2];
+        pDiskPoly += 2 + pPoly->GetNumVertices();
 
-        if (DiskPoly.m_nSurface >= m_nSurfaces) 
+        if (nSurface >= m_nSurfaces) 
             return LoadWorld_InvalidFile; 
 
 		//Get the plane of this polygon
-		if(DiskPoly.m_nPlane >= m_nPlanes)
+		if(nPlane >= m_nPlanes)
 			return LoadWorld_InvalidFile;
 
-        pPoly->SetSurface(&m_Surfaces[DiskPoly.m_nSurface]);
-		pPoly->SetPlane(&m_Planes[DiskPoly.m_nPlane]);
+        pPoly->SetSurface(&m_Surfaces[nSurface]);
+		pPoly->SetPlane(&m_Planes[nPlane]);
         
-        // Read in the list of indices.
+        // Set up the list of indices.
 		for (k=0; k < pPoly->GetNumVertices(); k++) 
 		{
-			if (DiskPoly.m_nVerts[k] >= m_nPoints) 
+			if (pVerts[k] >= m_nPoints) 
 				return LoadWorld_InvalidFile; 
 
-			pPoly->GetVertices()[k].m_Vertex = &m_Points[DiskPoly.m_nVerts[k]]; 
+			pPoly->GetVertices()[k].m_Vertex = &m_Points[pVerts[k]]; 
 		} 
 	}
 
-    // Read nodes.
-	uint32 nNodeIndices[2];
+    // Read nodes.  On disk each one is a poly index, a leaf index and the
+    // indices of its two children.
+    const uint32 nDiskNodeSize = sizeof(uint32) + sizeof(uint16) + sizeof(int32) * 2;
+    std::vector<uint8> diskNodes(nDiskNodeSize * m_nNodes);
+	pStream->Read(diskNodes.data(), nDiskNodeSize * m_nNodes);
+
+	int32 nNodeIndices[2];
 
+    const uint8 *pDiskNode = diskNodes.data();
     for (i=0; i < m_nNodes; i++)
     {
         pNode = &m_Nodes[i];
         
-        STREAM_READ(iPoly);
+        memcpy(&iPoly, pDiskNode, sizeof(iPoly));
+        memcpy(nNodeIndices, pDiskNode + sizeof(uint32) + sizeof(uint16), sizeof(nNodeIndices));
+        pDiskNode += nDiskNodeSize;
+
         if (iPoly >= m_nPolies)
         {
             return LoadWorld_InvalidFile;
@@ -591,9 +625,6 @@ ELoadWorldStatus WorldBsp::Load(ILTStream *pStream, bool bUsePlaneTypes)
 		pNode->m_Flags		= 0;
 		pNode->m_PlaneType	= 0;
 
-        STREAM_READ(wLeaf);
-        STREAM_READ(nNodeIndices);
-
         for (j=0; j < 2; j++)
         {
             pNode->m_Sides[j] = w_NodeForIndex(m_Nodes, m_nNodes, nNodeIndices[j]);
@@ -637,6 +668,280 @@ ELoadWorldStatus WorldBsp::Load(ILTStream *pStream, bool bUsePlaneTypes)
     return LoadWorld_Ok;
 }
 
+// Is an array of nCount elements at nOffset inside a blob of nDataSize bytes?
+static bool w_IsBlobArrayValid(uint32 nOffset, uint32 nCount, uint32 nElementSize, uint32 nDataSize)
+{
+    if ((nOffset % sizeof(void*)) != 0)
+        return false;
+
+    return ((uint64)nOffset + (uint64)nCount * nElementSize) <= nDataSize;
+}
+
+ELoadWorldStatus WorldBsp::LoadBlob(ILTStream *pStream, bool bUsePlaneTypes)
+{
+    uint32 i, k;
+
+    SWorldBspBlobHeader header;
+    pStream->Read(&header, sizeof(header));
+    if (pStream->ErrorStatus() != LT_OK)
+        return LoadWorld_InvalidFile;
+
+    // Make sure everything is inside the data.
+    if (!w_IsBlobArrayValid(header.m_nPlaneOffset, header.m_nPlanes, sizeof(LTPlane), header.m_nDataSize) ||
+        !w_IsBlobArrayValid(header.m_nNodeOffset, header.m_nNodes, sizeof(Node), header.m_nDataSize) ||
+        !w_IsBlobArrayValid(header.m_nSurfaceOffset, header.m_nSurfaces, sizeof(Surface), header.m_nDataSize) ||
+        !w_IsBlobArrayValid(header.m_nPolyListOffset, header.m_nPolies, sizeof(WorldPoly*), header.m_nDataSize) ||
+        !w_IsBlobArrayValid(header.m_nPointOffset, header.m_nPoints, sizeof(Vertex), header.m_nDataSize) ||
+        !w_IsBlobArrayValid(header.m_nPolyDataOffset, header.m_nPolyDataSize, 1, header.m_nDataSize) ||
+        !w_IsBlobArrayValid(header.m_nTextureNameOffset, header.m_nTextures, sizeof(char*), header.m_nDataSize) ||
+        !w_IsBlobArrayValid(header.m_nTextureNameDataOffset, header.m_nTextureNameDataSize, 1, header.m_nDataSize))
+    {
+        return LoadWorld_InvalidFile;
+    }
+
+    // Everything comes in with one read.
+    LT_MEM_TRACK_ALLOC(m_BlobData = (char*)dalloc(header.m_nDataSize),LT_MEM_TYPE_WORLD);
+    if (!m_BlobData)
+        return LoadWorld_Error;
+
+    pStream->Read(m_BlobData, header.m_nDataSize);
+    if (pStream->ErrorStatus() != LT_OK)
+        return LoadWorld_InvalidFile;
+
+    m_WorldInfoFlags = (uint16)header.m_WorldInfoFlags;
+    LTStrCpy(m_WorldName, header.m_WorldName, sizeof(m_WorldName));
+
+    m_MinBox = header.m_MinBox;
+    m_MaxBox = header.m_MaxBox;
+    m_WorldTranslation = header.m_WorldTranslation;
+
+    m_Planes = (LTPlane*)&m_BlobData[header.m_nPlaneOffset];
+    m_nPlanes = header.m_nPlanes;
+    m_Nodes = (Node*)&m_BlobData[header.m_nNodeOffset];
+    m_nNodes = header.m_nNodes;
+    m_Surfaces = (Surface*)&m_BlobData[header.m_nSurfaceOffset];
+    m_nSurfaces = header.m_nSurfaces;
+    m_Polies = (WorldPoly**)&m_BlobData[header.m_nPolyListOffset];
+    m_nPolies = header.m_nPolies;
+    m_Points = (Vertex*)&m_BlobData[header.m_nPointOffset];
+    m_nPoints = header.m_nPoints;
+    m_PolyData = &m_BlobData[header.m_nPolyDataOffset];
+    m_PolyDataSize = header.m_nPolyDataSize;
+    m_TextureNames = (char**)&m_BlobData[header.m_nTextureNameOffset];
+    m_nTextures = header.m_nTextures;
+    m_TextureNameData = &m_BlobData[header.m_nTextureNameDataOffset];
+    m_TextureNameDataSize = header.m_nTextureNameDataSize;
+
+    // Turn the stored indices and offsets back into pointers.
+    for (i=0; i < m_nTextures; i++)
+    {
+        uintptr_t nOffset = (uintptr_t)m_TextureNames[i];
+        if (nOffset >= m_TextureNameDataSize)
+            return LoadWorld_InvalidFile;
+
+        m_TextureNames[i] = &m_TextureNameData[nOffset];
+    }
+
+    if (m_TextureNameDataSize && m_TextureNameData[m_TextureNameDataSize - 1] != 0)
+        return LoadWorld_InvalidFile;
+
+    for (i=0; i < m_nSurfaces; i++)
+    {
+        m_Surfaces[i].m_pTexture = NULL;
+    }
+
+    for (i=0; i < m_nPolies; i++)
+    {
+        uintptr_t nOffset = (uintptr_t)m_Polies[i];
+        if (((nOffset % sizeof(void*)) != 0) || (nOffset + sizeof(WorldPoly) > m_PolyDataSize))
+            return LoadWorld_InvalidFile;
+
+        WorldPoly *pPoly = (WorldPoly*)&m_PolyData[nOffset];
+        if ((pPoly->GetNumVertices() > MAX_WORLDPOLY_VERTS) ||
+            (nOffset + WORLDPOLY_SIZE(pPoly->GetNumVertices()) > m_PolyDataSize))
+        {
+            return LoadWorld_InvalidFile;
+        }
+
+        uintptr_t nSurface = (uintptr_t)pPoly->GetSurface();
+        uintptr_t nPlane = (uintptr_t)pPoly->GetPlane();
+        if ((nSurface >= m_nSurfaces) || (nPlane >= m_nPlanes))
+            return LoadWorld_InvalidFile;
+
+        pPoly->SetSurface(&m_Surfaces[nSurface]);
+        pPoly->SetPlane(&m_Planes[nPlane]);
+
+        SPolyVertex *pVerts = pPoly->GetVertices();
+        for (k=0; k < pPoly->GetNumVertices(); k++)
+        {
+            uintptr_t nVert = (uintptr_t)pVerts[k].m_Vertex;
+            if (nVert >= m_nPoints)
+                return LoadWorld_InvalidFile;
+
+            pVerts[k].m_Vertex = &m_Points[nVert];
+        }
+
+        m_Polies[i] = pPoly;
+    }
+
+    for (i=0; i < m_nNodes; i++)
+    {
+        Node *pNode = &m_Nodes[i];
+
+        uintptr_t nPoly = (uintptr_t)pNode->m_pPoly;
+        if (nPoly >= m_nPolies)
+            return LoadWorld_InvalidFile;
+
+        pNode->m_pPoly = m_Polies[nPoly];
+
+        for (k=0; k < 2; k++)
+        {
+            uintptr_t nSide = (uintptr_t)pNode->m_Sides[k];
+            if (nSide == WORLDBSPBLOB_NODE_IN)
+                pNode->m_Sides[k] = NODE_IN;
+            else if (nSide == WORLDBSPBLOB_NODE_OUT)
+                pNode->m_Sides[k] = NODE_OUT;
+            else if (nSide < m_nNodes)
+                pNode->m_Sides[k] = &m_Nodes[nSide];
+            else
+                return LoadWorld_InvalidFile;
+        }
+    }
+
+    // Classify its plane.
+    w_SetPlaneTypes(m_Nodes, m_nNodes, bUsePlaneTypes);
+
+    m_RootNode = w_NodeForIndex(m_Nodes, m_nNodes, header.m_iRootNode);
+    if (!m_RootNode)
+        return LoadWorld_InvalidFile;
+
+    m_MemoryUse = header.m_nDataSize + sizeof(WorldBsp);
+    g_WorldGeometryMemory += m_MemoryUse;
+
+    return LoadWorld_Ok;
+}
+
+// Round a blob offset up so the next array is pointer aligned.
+static uint32 w_AlignBlobOffset(uint32 nOffset)
+{
+    return (nOffset + sizeof(void*) - 1) & ~(uint32)(sizeof(void*) - 1);
+}
+
+bool WorldBsp::SaveBlob(ILTStream *pStream) const
+{
+    uint32 i, k;
+
+    // Zeroed as raw bytes so the padding written to the file is zero too.
+    SWorldBspBlobHeader header;
+    memset((void*)&header, 0, sizeof(header));
+
+    header.m_WorldInfoFlags = m_WorldInfoFlags;
+    LTStrCpy(header.m_WorldName, m_WorldName, sizeof(header.m_WorldName));
+
+    header.m_MinBox = m_MinBox;
+    header.m_MaxBox = m_MaxBox;
+    header.m_WorldTranslation = m_WorldTranslation;
+
+    header.m_nPlanes = m_nPlanes;
+    header.m_nNodes = m_nNodes;
+    header.m_nSurfaces = m_nSurfaces;
+    header.m_nPolies = m_nPolies;
+    header.m_nPoints = m_nPoints;
+    header.m_nTextures = m_nTextures;
+    header.m_nPolyDataSize = m_PolyDataSize;
+    header.m_nTextureNameDataSize = m_TextureNameDataSize;
+
+    if (m_RootNode == NODE_IN)
+        header.m_iRootNode = -1;
+    else if (m_RootNode == NODE_OUT)
+        header.m_iRootNode = -2;
+    else
+        header.m_iRootNode = (int32)(m_RootNode - m_Nodes);
+
+    // Lay out the data.
+    uint32 nSize = 0;
+    header.m_nPlaneOffset = nSize;
+    nSize = w_AlignBlobOffset(nSize + sizeof(LTPlane) * m_nPlanes);
+    header.m_nNodeOffset = nSize;
+    nSize = w_AlignBlobOffset(nSize + sizeof(Node) * m_nNodes);
+    header.m_nSurfaceOffset = nSize;
+    nSize = w_AlignBlobOffset(nSize + sizeof(Surface) * m_nSurfaces);
+    header.m_nPolyListOffset = nSize;
+    nSize = w_AlignBlobOffset(nSize + sizeof(WorldPoly*) * m_nPolies);
+    header.m_nPointOffset = nSize;
+    nSize = w_AlignBlobOffset(nSize + sizeof(Vertex) * m_nPoints);
+    header.m_nPolyDataOffset = nSize;
+    nSize = w_AlignBlobOffset(nSize + m_PolyDataSize);
+    header.m_nTextureNameOffset = nSize;
+    nSize = w_AlignBlobOffset(nSize + sizeof(char*) * m_nTextures);
+    header.m_nTextureNameDataOffset = nSize;
+    nSize = w_AlignBlobOffset(nSize + m_TextureNameDataSize);
+    header.m_nDataSize = nSize;
+
+    std::vector<char> data(nSize, 0);
+
+    memcpy(&data[header.m_nPlaneOffset], m_Planes, sizeof(LTPlane) * m_nPlanes);
+    memcpy(&data[header.m_nPointOffset], m_Points, sizeof(Vertex) * m_nPoints);
+    memcpy(&data[header.m_nPolyDataOffset], m_PolyData, m_PolyDataSize);
+    memcpy(&data[header.m_nTextureNameDataOffset], m_TextureNameData, m_TextureNameDataSize);
+
+    // Replace all the pointers with indices or offsets.
+    Surface *pSurfaces = (Surface*)&data[header.m_nSurfaceOffset];
+    for (i=0; i < m_nSurfaces; i++)
+    {
+        pSurfaces[i] = m_Surfaces[i];
+        pSurfaces[i].m_pTexture = NULL;
+    }
+
+    Node *pNodes = (Node*)&data[header.m_nNodeOffset];
+    for (i=0; i < m_nNodes; i++)
+    {
+        const Node *pSrc = &m_Nodes[i];
+
+        pNodes[i] = *pSrc;
+        pNodes[i].m_pPoly = (WorldPoly*)(uintptr_t)pSrc->m_pPoly->GetIndex();
+
+        for (k=0; k < 2; k++)
+        {
+            if (pSrc->m_Sides[k] == NODE_IN)
+                pNodes[i].m_Sides[k] = (Node*)WORLDBSPBLOB_NODE_IN;
+            else if (pSrc->m_Sides[k] == NODE_OUT)
+                pNodes[i].m_Sides[k] = (Node*)WORLDBSPBLOB_NODE_OUT;
+            else
+                pNodes[i].m_Sides[k] = (Node*)(uintptr_t)(pSrc->m_Sides[k] - m_Nodes);
+        }
+    }
+
+    WorldPoly **pPolies = (WorldPoly**)&data[header.m_nPolyListOffset];
+    for (i=0; i < m_nPolies; i++)
+    {
+        const WorldPoly *pSrc = m_Polies[i];
+        uintptr_t nOffset = (uintptr_t)((const char*)pSrc - m_PolyData);
+
+        pPolies[i] = (WorldPoly*)nOffset;
+
+        WorldPoly *pPoly = (WorldPoly*)&data[header.m_nPolyDataOffset + nOffset];
+        pPoly->SetSurface((Surface*)(uintptr_t)(pSrc->GetSurface() - m_Surfaces));
+        pPoly->SetPlane((LTPlane*)(uintptr_t)(pSrc->GetPlane() - m_Planes));
+
+        for (k=0; k < pSrc->GetNumVertices(); k++)
+        {
+            pPoly->GetVertices()[k].m_Vertex = (Vertex*)(uintptr_t)(pSrc->GetVertices()[k].m_Vertex - m_Points);
+        }
+    }
+
+    char **pTextureNames = (char**)&data[header.m_nTextureNameOffset];
+    for (i=0; i < m_nTextures; i++)
+    {
+        pTextureNames[i] = (char*)(uintptr_t)(m_TextureNames[i] - m_TextureNameData);
+    }
+
+    pStream->Write(&header, sizeof(header));
+    pStream->Write(data.data(), nSize);
+
+    return pStream->ErrorStatus() == LT_OK;
+}
+
 void WorldBsp::CalcBoundingSpheres() 
 {
     uint32 i, j;
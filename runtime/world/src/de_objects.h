@@ -60,6 +60,10 @@ struct ObjectCreateStruct;
 #include "transformmaker.h"
 #endif
 
+#ifndef __NETDELTA_H__
+#include "netdelta.h"
+#endif
+
 #define INVALID_OBJECTID ((unsigned short)-1)
 
 #define INVALID_SERIALIZEID 0xFFFF
@@ -118,6 +122,10 @@ struct ClientData
     uint32			m_ClientFlags;      // Client-side object flags..
 
     void            *m_pUserData;       // User data..
+
+    // What the last guaranteed update had for the position and rotation.
+    // The next one is delta compressed against it.
+    NetObjState		m_GuaranteedState;
 };
 
 
@@ -435,6 +443,11 @@ public:
 	bool				UpdateCachedTransformsWithPath();
 	// this ignores flags, and just updates. 
 	bool				ForceUpdateCachedTransforms();
+	// poses every node relative to the model (client only).  The cached transforms
+	// are then built from this pose and the model's transform the next time they're
+	// needed.  Doesn't touch anything outside this instance, so it can be run on a
+	// worker thread.  Returns false if the model has node controls.
+	bool				BuildModelSpacePose();
 
 	// node control
 
@@ -547,6 +560,7 @@ public:
 	uint16				m_nRenderInfoIndex;						// Index to use during rendering of the global model info cache (used for client side rendering only, this will be INVALID_MODEL_INFO_INDEX outside of rendering)
 	uint16				m_nRenderInfoParentIndex;				// Index of parent's render information. Used in rendering to work around attachments
 	uint8				m_nNumSprites;							// The number of sprites this model has loaded on it. Primarily for optimizing away the need to update sprites
+	bool				m_bPoseUsed;							// Set when the cached transforms are evaluated (drawn or queried).  Cleared by the client's model update
 
 #if(MODEL_OBB)
 	// Oriented Bounding Box (OBB) Methods.
@@ -572,6 +586,10 @@ protected :
 	LTMatrix			*m_CachedTransforms;
 	DDMatrix			*m_RenderingTransforms ; 
 
+	// Pose built by BuildModelSpacePose, valid until the cached transforms are reset.
+	LTMatrix			*m_ModelSpaceTransforms;
+	bool				m_bModelSpacePosed;
+
 	// state of every node in tranform cache 
 	struct SCachedTransformInfo
 	{
@@ -898,6 +916,21 @@ struct LTRecord
 // Setup the transformation for a WorldModel.
 void obj_SetupWorldModelTransform(WorldModelInstance *pWorldModel);
 
+// Defined by the server.
+void sm_WakeObject(LTObject *pObj);
+
+// Sets IFLAG_APPLYPHYSICS.  The server only runs physics on the objects it's
+// been told need it, so use this rather than setting the flag directly.
+inline void obj_ApplyPhysics(LTObject *pObj)
+{
+    pObj->m_InternalFlags |= IFLAG_APPLYPHYSICS;
+
+    if (pObj->sd)
+    {
+        sm_WakeObject(pObj);
+    }
+}
+
 
 #endif  // __DE_OBJECTS_H__
 
@@ -382,6 +382,12 @@ public:
     //loads the bsp.
     ELoadWorldStatus Load(ILTStream *pStream, bool bUsePlaneTypes);
 
+    //loads the bsp from the compiled format (see world_bsp_blob.h).
+    ELoadWorldStatus LoadBlob(ILTStream *pStream, bool bUsePlaneTypes);
+
+    //writes the bsp out in the compiled format.
+    bool            SaveBlob(ILTStream *pStream) const;
+
     // Get bounding radius of the world.
     float			GetBoundRadiusSqr() const {return (m_MaxBox - m_MinBox).MagSqr();}
 
@@ -430,7 +436,9 @@ public:
     uint32			m_nPoints;
 
     char			*m_TextureNameData; // The list of texture names used in this world.
+    uint32			m_TextureNameDataSize;
     char			**m_TextureNames;
+    uint32			m_nTextures;
 
     LTVector        m_MinBox, m_MaxBox; // Bounding box on the whole WorldBsp.
 
@@ -446,6 +454,8 @@ public:
     char            *m_PolyData;        // Data blocks
     uint32          m_PolyDataSize;
 
+    char            *m_BlobData;        // Everything, when loaded with LoadBlob.
+
     char            m_WorldName[MAX_WORLDNAME_LEN+1];   // Name of this world.
 };
 
@@ -0,0 +1,193 @@
+#include "bdefs.h"
+
+#include "world_blocker_bvh.h"
+
+#include <algorithm>
+
+namespace
+{
+	// Orders items by the center of their bounds along one axis
+	struct SCenterLess
+	{
+		SCenterLess(const std::vector<LTVector> &aMins, const std::vector<LTVector> &aMaxs, uint32 nAxis) :
+			m_aMins(aMins), m_aMaxs(aMaxs), m_nAxis(nAxis)
+		{}
+
+		bool operator()(uint32 nLeft, uint32 nRight) const
+		{
+			return (m_aMins[nLeft][m_nAxis] + m_aMaxs[nLeft][m_nAxis]) <
+				(m_aMins[nRight][m_nAxis] + m_aMaxs[nRight][m_nAxis]);
+		}
+
+		const std::vector<LTVector> &m_aMins;
+		const std::vector<LTVector> &m_aMaxs;
+		uint32 m_nAxis;
+	};
+}
+
+void CBlockerBVH::Term()
+{
+	std::vector<SNode>().swap(m_aNodes);
+	std::vector<uint32>().swap(m_aItems);
+}
+
+void CBlockerBVH::Build(const std::vector<LTVector> &aMins, const std::vector<LTVector> &aMaxs)
+{
+	Term();
+
+	ASSERT(aMins.size() == aMaxs.size());
+	uint32 nNumItems = (uint32)aMins.size();
+	if (!nNumItems)
+		return;
+
+	LT_MEM_TRACK_ALLOC(m_aItems.resize(nNumItems), LT_MEM_TYPE_WORLD);
+	for (uint32 nItem = 0; nItem < nNumItems; ++nItem)
+		m_aItems[nItem] = nItem;
+
+	// Every node has at least two children once there's more than a leaf's worth
+	LT_MEM_TRACK_ALLOC(m_aNodes.reserve(nNumItems / (k_nLeafSize / 2) + 1), LT_MEM_TYPE_WORLD);
+
+	BuildNode(0, nNumItems, aMins, aMaxs);
+}
+
+void CBlockerBVH::GetBounds(
+	uint32 nFirst,
+	uint32 nCount,
+	const std::vector<LTVector> &aMins,
+	const std::vector<LTVector> &aMaxs,
+	LTVector *pMin,
+	LTVector *pMax) const
+{
+	*pMin = aMins[m_aItems[nFirst]];
+	*pMax = aMaxs[m_aItems[nFirst]];
+	for (uint32 nCur = nFirst + 1; nCur < nFirst + nCount; ++nCur)
+	{
+		VEC_MIN(*pMin, *pMin, aMins[m_aItems[nCur]]);
+		VEC_MAX(*pMax, *pMax, aMaxs[m_aItems[nCur]]);
+	}
+}
+
+int32 CBlockerBVH::BuildNode(uint32 nFirst, uint32 nCount, const std::vector<LTVector> &aMins, const std::vector<LTVector> &aMaxs)
+{
+	// Split the items into up to four groups by halving twice along the
+	// longest axis of their centers
+	uint32 aGroupFirst[4], aGroupCount[4];
+	uint32 nNumGroups = 0;
+
+	uint32 aHalfFirst[2], aHalfCount[2];
+	uint32 nNumHalves = 0;
+
+	if (nCount <= k_nLeafSize)
+	{
+		aGroupFirst[0] = nFirst;
+		aGroupCount[0] = nCount;
+		nNumGroups = 1;
+	}
+	else
+	{
+		aHalfFirst[0] = nFirst;
+		aHalfCount[0] = nCount;
+		nNumHalves = 1;
+	}
+
+	for (uint32 nPass = 0; nPass < 2; ++nPass)
+	{
+		uint32 aSplitFirst[4], aSplitCount[4];
+		uint32 nNumSplits = 0;
+
+		for (uint32 nHalf = 0; nHalf < nNumHalves; ++nHalf)
+		{
+			uint32 nCurFirst = aHalfFirst[nHalf];
+			uint32 nCurCount = aHalfCount[nHalf];
+
+			if ((nPass > 0) && (nCurCount <= k_nLeafSize))
+			{
+				aGroupFirst[nNumGroups] = nCurFirst;
+				aGroupCount[nNumGroups] = nCurCount;
+				++nNumGroups;
+				continue;
+			}
+
+			LTVector vCenterMin, vCenterMax;
+			vCenterMin = vCenterMax = aMins[m_aItems[nCurFirst]] + aMaxs[m_aItems[nCurFirst]];
+			for (uint32 nCur = nCurFirst + 1; nCur < nCurFirst + nCurCount; ++nCur)
+			{
+				LTVector vCenter = aMins[m_aItems[nCur]] + aMaxs[m_aItems[nCur]];
+				VEC_MIN(vCenterMin, vCenterMin, vCenter);
+				VEC_MAX(vCenterMax, vCenterMax, vCenter);
+			}
+			LTVector vExtent = vCenterMax - vCenterMin;
+			uint32 nAxis = 0;
+			if (vExtent.y > vExtent[nAxis])
+				nAxis = 1;
+			if (vExtent.z > vExtent[nAxis])
+				nAxis = 2;
+
+			uint32 nHalfCount = nCurCount / 2;
+			std::vector<uint32>::iterator iFirst = m_aItems.begin() + nCurFirst;
+			std::nth_element(iFirst, iFirst + nHalfCount, iFirst + nCurCount, SCenterLess(aMins, aMaxs, nAxis));
+
+			aSplitFirst[nNumSplits] = nCurFirst;
+			aSplitCount[nNumSplits] = nHalfCount;
+			++nNumSplits;
+			aSplitFirst[nNumSplits] = nCurFirst + nHalfCount;
+			aSplitCount[nNumSplits] = nCurCount - nHalfCount;
+			++nNumSplits;
+		}
+
+		if (nPass > 0)
+		{
+			for (uint32 nSplit = 0; nSplit < nNumSplits; ++nSplit)
+			{
+				aGroupFirst[nNumGroups] = aSplitFirst[nSplit];
+				aGroupCount[nNumGroups] = aSplitCount[nSplit];
+				++nNumGroups;
+			}
+		}
+		else
+		{
+			for (uint32 nSplit = 0; nSplit < nNumSplits; ++nSplit)
+			{
+				aHalfFirst[nSplit] = aSplitFirst[nSplit];
+				aHalfCount[nSplit] = aSplitCount[nSplit];
+			}
+			nNumHalves = nNumSplits;
+		}
+	}
+
+	ASSERT(nNumGroups > 0 && nNumGroups <= 4);
+
+	int32 nNodeIndex = (int32)m_aNodes.size();
+	LT_MEM_TRACK_ALLOC(m_aNodes.push_back(SNode()), LT_MEM_TYPE_WORLD);
+	memset(&m_aNodes[nNodeIndex], 0, sizeof(SNode));
+
+	for (uint32 nGroup = 0; nGroup < nNumGroups; ++nGroup)
+	{
+		LTVector vMin, vMax;
+		GetBounds(aGroupFirst[nGroup], aGroupCount[nGroup], aMins, aMaxs, &vMin, &vMax);
+
+		int32 nChild;
+		uint32 nChildCount = 0;
+		if (aGroupCount[nGroup] <= k_nLeafSize)
+		{
+			nChild = ~(int32)aGroupFirst[nGroup];
+			nChildCount = aGroupCount[nGroup];
+		}
+		else
+			nChild = BuildNode(aGroupFirst[nGroup], aGroupCount[nGroup], aMins, aMaxs);
+
+		// Note : Building the children may have moved the node
+		SNode &cNode = m_aNodes[nNodeIndex];
+		cNode.m_aMinX[nGroup] = vMin.x;
+		cNode.m_aMinY[nGroup] = vMin.y;
+		cNode.m_aMinZ[nGroup] = vMin.z;
+		cNode.m_aMaxX[nGroup] = vMax.x;
+		cNode.m_aMaxY[nGroup] = vMax.y;
+		cNode.m_aMaxZ[nGroup] = vMax.z;
+		cNode.m_aChild[nGroup] = nChild;
+		cNode.m_aCount[nGroup] = nChildCount;
+		cNode.m_nValidMask |= 1 << nGroup;
+	}
+
+	return nNodeIndex;
+}
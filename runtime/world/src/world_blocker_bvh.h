@@ -0,0 +1,189 @@
+//////////////////////////////////////////////////////////////////////////////
+// Bounding volume hierarchy over blocker polygons.  Built once when the
+// blocker data is loaded so player and particle queries only have to test
+// the blockers near them instead of every blocker in the world.
+
+#ifndef __WORLD_BLOCKER_BVH_H__
+#define __WORLD_BLOCKER_BVH_H__
+
+#include <vector>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define BLOCKER_BVH_SSE
+#include <xmmintrin.h>
+#endif
+
+class CBlockerBVH
+{
+public:
+	CBlockerBVH() {}
+
+	void Term();
+
+	// Build the tree around a list of item bounds.  Items are referred to by
+	// their position in the lists.
+	void Build(const std::vector<LTVector> &aMins, const std::vector<LTVector> &aMaxs);
+
+	// Call cVisitor(nItem) for every item whose bounds overlap the box.
+	// Items are visited in no particular order.
+	template <class TVisitor>
+	void VisitBox(const LTVector &vMin, const LTVector &vMax, TVisitor &cVisitor) const;
+
+	// Call cVisitor(nItem) for every item whose bounds come within fRadius
+	// of vCenter.  Items are visited in no particular order.
+	template <class TVisitor>
+	void VisitSphere(const LTVector &vCenter, float fRadius, TVisitor &cVisitor) const;
+
+private:
+	enum { k_nLeafSize = 4, k_nMaxStack = 128 };
+
+	// Four children per node, with their bounds stored by axis so one node
+	// can be tested against a query at once.
+	struct SNode
+	{
+		float m_aMinX[4], m_aMinY[4], m_aMinZ[4];
+		float m_aMaxX[4], m_aMaxY[4], m_aMaxZ[4];
+		// >= 0 is a node index, < 0 is ~(first entry in m_aItems) of a leaf
+		int32 m_aChild[4];
+		uint32 m_aCount[4];
+		uint32 m_nValidMask;
+	};
+
+	int32 BuildNode(uint32 nFirst, uint32 nCount, const std::vector<LTVector> &aMins, const std::vector<LTVector> &aMaxs);
+	void GetBounds(uint32 nFirst, uint32 nCount, const std::vector<LTVector> &aMins, const std::vector<LTVector> &aMaxs, LTVector *pMin, LTVector *pMax) const;
+
+	uint32 OverlapBox(const SNode &cNode, const LTVector &vMin, const LTVector &vMax) const;
+	uint32 OverlapSphere(const SNode &cNode, const LTVector &vCenter, float fRadiusSqr) const;
+
+	template <class TVisitor>
+	void VisitChildren(const SNode &cNode, uint32 nMask, int32 *pStack, uint32 &nStackSize, TVisitor &cVisitor) const;
+
+	std::vector<SNode> m_aNodes;
+	std::vector<uint32> m_aItems;
+};
+
+inline uint32 CBlockerBVH::OverlapBox(const SNode &cNode, const LTVector &vMin, const LTVector &vMax) const
+{
+	// Written as "not disjoint" so it agrees with a plain AABB rejection test
+#ifdef BLOCKER_BVH_SSE
+	__m128 vOverlap = _mm_and_ps(
+		_mm_cmpngt_ps(_mm_set1_ps(vMin.x), _mm_loadu_ps(cNode.m_aMaxX)),
+		_mm_cmpngt_ps(_mm_loadu_ps(cNode.m_aMinX), _mm_set1_ps(vMax.x)));
+	vOverlap = _mm_and_ps(vOverlap, _mm_and_ps(
+		_mm_cmpngt_ps(_mm_set1_ps(vMin.y), _mm_loadu_ps(cNode.m_aMaxY)),
+		_mm_cmpngt_ps(_mm_loadu_ps(cNode.m_aMinY), _mm_set1_ps(vMax.y))));
+	vOverlap = _mm_and_ps(vOverlap, _mm_and_ps(
+		_mm_cmpngt_ps(_mm_set1_ps(vMin.z), _mm_loadu_ps(cNode.m_aMaxZ)),
+		_mm_cmpngt_ps(_mm_loadu_ps(cNode.m_aMinZ), _mm_set1_ps(vMax.z))));
+	return (uint32)_mm_movemask_ps(vOverlap) & cNode.m_nValidMask;
+#else
+	uint32 nResult = 0;
+	for (uint32 nChild = 0; nChild < 4; ++nChild)
+	{
+		if ((vMin.x > cNode.m_aMaxX[nChild]) || (cNode.m_aMinX[nChild] > vMax.x) ||
+			(vMin.y > cNode.m_aMaxY[nChild]) || (cNode.m_aMinY[nChild] > vMax.y) ||
+			(vMin.z > cNode.m_aMaxZ[nChild]) || (cNode.m_aMinZ[nChild] > vMax.z))
+			continue;
+		nResult |= 1 << nChild;
+	}
+	return nResult & cNode.m_nValidMask;
+#endif
+}
+
+inline uint32 CBlockerBVH::OverlapSphere(const SNode &cNode, const LTVector &vCenter, float fRadiusSqr) const
+{
+	// Squared distance from the center to each box
+#ifdef BLOCKER_BVH_SSE
+	__m128 vZero = _mm_setzero_ps();
+	__m128 vCenterX = _mm_set1_ps(vCenter.x);
+	__m128 vCenterY = _mm_set1_ps(vCenter.y);
+	__m128 vCenterZ = _mm_set1_ps(vCenter.z);
+	__m128 vDistX = _mm_add_ps(
+		_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(cNode.m_aMinX), vCenterX), vZero),
+		_mm_max_ps(_mm_sub_ps(vCenterX, _mm_loadu_ps(cNode.m_aMaxX)), vZero));
+	__m128 vDistY = _mm_add_ps(
+		_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(cNode.m_aMinY), vCenterY), vZero),
+		_mm_max_ps(_mm_sub_ps(vCenterY, _mm_loadu_ps(cNode.m_aMaxY)), vZero));
+	__m128 vDistZ = _mm_add_ps(
+		_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(cNode.m_aMinZ), vCenterZ), vZero),
+		_mm_max_ps(_mm_sub_ps(vCenterZ, _mm_loadu_ps(cNode.m_aMaxZ)), vZero));
+	__m128 vDistSqr = _mm_add_ps(_mm_mul_ps(vDistX, vDistX),
+		_mm_add_ps(_mm_mul_ps(vDistY, vDistY), _mm_mul_ps(vDistZ, vDistZ)));
+	return (uint32)_mm_movemask_ps(_mm_cmple_ps(vDistSqr, _mm_set1_ps(fRadiusSqr))) & cNode.m_nValidMask;
+#else
+	uint32 nResult = 0;
+	for (uint32 nChild = 0; nChild < 4; ++nChild)
+	{
+		float fDistX = LTMAX(cNode.m_aMinX[nChild] - vCenter.x, 0.0f) + LTMAX(vCenter.x - cNode.m_aMaxX[nChild], 0.0f);
+		float fDistY = LTMAX(cNode.m_aMinY[nChild] - vCenter.y, 0.0f) + LTMAX(vCenter.y - cNode.m_aMaxY[nChild], 0.0f);
+		float fDistZ = LTMAX(cNode.m_aMinZ[nChild] - vCenter.z, 0.0f) + LTMAX(vCenter.z - cNode.m_aMaxZ[nChild], 0.0f);
+		if ((fDistX * fDistX + fDistY * fDistY + fDistZ * fDistZ) <= fRadiusSqr)
+			nResult |= 1 << nChild;
+	}
+	return nResult & cNode.m_nValidMask;
+#endif
+}
+
+template <class TVisitor>
+inline void CBlockerBVH::VisitChildren(const SNode &cNode, uint32 nMask, int32 *pStack, uint32 &nStackSize, TVisitor &cVisitor) const
+{
+	for (uint32 nChild = 0; nMask; ++nChild, nMask >>= 1)
+	{
+		if (!(nMask & 1))
+			continue;
+
+		int32 nChildIndex = cNode.m_aChild[nChild];
+		if (nChildIndex >= 0)
+		{
+			ASSERT(nStackSize < k_nMaxStack);
+			pStack[nStackSize++] = nChildIndex;
+			continue;
+		}
+
+		const uint32 *pCurItem = &m_aItems[~nChildIndex];
+		const uint32 *pEndItem = pCurItem + cNode.m_aCount[nChild];
+		for (; pCurItem != pEndItem; ++pCurItem)
+			cVisitor(*pCurItem);
+	}
+}
+
+template <class TVisitor>
+void CBlockerBVH::VisitBox(const LTVector &vMin, const LTVector &vMax, TVisitor &cVisitor) const
+{
+	if (m_aNodes.empty())
+		return;
+
+	int32 aStack[k_nMaxStack];
+	uint32 nStackSize = 0;
+	aStack[nStackSize++] = 0;
+
+	while (nStackSize)
+	{
+		const SNode &cNode = m_aNodes[aStack[--nStackSize]];
+		uint32 nMask = OverlapBox(cNode, vMin, vMax);
+		VisitChildren(cNode, nMask, aStack, nStackSize, cVisitor);
+	}
+}
+
+template <class TVisitor>
+void CBlockerBVH::VisitSphere(const LTVector &vCenter, float fRadius, TVisitor &cVisitor) const
+{
+	if (m_aNodes.empty() || (fRadius != fRadius))
+		return;
+
+	// A negative radius still finds the boxes containing the center
+	float fRadiusSqr = (fRadius > 0.0f) ? fRadius * fRadius : 0.0f;
+
+	int32 aStack[k_nMaxStack];
+	uint32 nStackSize = 0;
+	aStack[nStackSize++] = 0;
+
+	while (nStackSize)
+	{
+		const SNode &cNode = m_aNodes[aStack[--nStackSize]];
+		uint32 nMask = OverlapSphere(cNode, vCenter, fRadiusSqr);
+		VisitChildren(cNode, nMask, aStack, nStackSize, cVisitor);
+	}
+}
+
+#endif //__WORLD_BLOCKER_BVH_H__
@@ -3,7 +3,9 @@
 #include "world_blocker_data.h"
 
 #include "world_blocker_math.h"
+#include "world_blocker_bvh.h"
 
+#include <algorithm>
 #include <vector>
 
 // Some base-type vectors
@@ -263,6 +265,9 @@ private:
 	typedef std::vector<CBlockerPoly> TBlockerPolyList;
 	TBlockerPolyList m_aPolys;
 
+	// Tree around the polys, built on load
+	CBlockerBVH m_cPolyTree;
+
 	bool GetPolysInSphere(const LTVector &vCenter, float fRadius, TIntList *pResults);
 
 	bool CalcPolyIntersectTime(
@@ -300,6 +305,7 @@ CWorldBlockerData::~CWorldBlockerData()
 void CWorldBlockerData::Term()
 {
 	m_aPolys.clear();
+	m_cPolyTree.Term();
 }
 
 ELoadWorldStatus CWorldBlockerData::Load(ILTStream *pStream)
@@ -320,9 +326,46 @@ ELoadWorldStatus CWorldBlockerData::Load(ILTStream *pStream)
 	*pStream >> nDummy;
 	ASSERT(nDummy == 0);
 
+	// Build the tree for the sphere queries.  GetPtDistToCircle never comes out 
+	// less than the distance to the center minus the radius, so a box around that 
+	// sphere holds every point a poly can be found from.  The padding covers 
+	// rounding differences between the two tests.
+	TVectorList aMins, aMaxs;
+	LT_MEM_TRACK_ALLOC(aMins.resize(nNumPolys), LT_MEM_TYPE_WORLD);
+	LT_MEM_TRACK_ALLOC(aMaxs.resize(nNumPolys), LT_MEM_TYPE_WORLD);
+	for (uint32 nCurPoly = 0; nCurPoly < nNumPolys; ++nCurPoly)
+	{
+		const CBlockerPoly &cPoly = m_aPolys[nCurPoly];
+		float fExtent = cPoly.m_fRadius + 0.01f + (cPoly.m_vCenter.Mag() + cPoly.m_fRadius) * 0.0001f;
+		LTVector vExtent(fExtent, fExtent, fExtent);
+		aMins[nCurPoly] = cPoly.m_vCenter - vExtent;
+		aMaxs[nCurPoly] = cPoly.m_vCenter + vExtent;
+	}
+	m_cPolyTree.Build(aMins, aMaxs);
+
 	return LoadWorld_Ok;
 }
 
+// Collects the polys from the tree that pass the real sphere test
+struct SPolySphereVisitor
+{
+	SPolySphereVisitor(const std::vector<CBlockerPoly> &aPolys, const LTVector &vCenter, float fRadius, TIntList *pResults) :
+		m_aPolys(aPolys), m_vCenter(vCenter), m_fRadius(fRadius), m_pResults(pResults)
+	{}
+
+	void operator()(uint32 nIndex)
+	{
+		float fPolyDist = m_aPolys[nIndex].GetPtDistToCircle(m_vCenter);
+		if (fPolyDist <= m_fRadius)
+			m_pResults->push_back((int)nIndex);
+	}
+
+	const std::vector<CBlockerPoly> &m_aPolys;
+	const LTVector &m_vCenter;
+	float m_fRadius;
+	TIntList *m_pResults;
+};
+
 // Get the polys touching a sphere
 bool CWorldBlockerData::GetPolysInSphere(const LTVector &vCenter, float fRadius, TIntList *pResults)
 {
@@ -330,13 +373,12 @@ bool CWorldBlockerData::GetPolysInSphere(const LTVector &vCenter, float fRadius,
 
 	size_t nOldSize = pResults->size();
 
-	TBlockerPolyList::iterator iCurPoly = m_aPolys.begin();
-	for (int nIndex = 0; iCurPoly != m_aPolys.end(); ++iCurPoly, ++nIndex)
-	{
-		float fPolyDist = (*iCurPoly).GetPtDistToCircle(vCenter);
-		if (fPolyDist <= fRadius)
-			pResults->push_back(nIndex);
-	}
+	SPolySphereVisitor cVisitor(m_aPolys, vCenter, fRadius, pResults);
+	m_cPolyTree.VisitSphere(vCenter, fRadius, cVisitor);
+
+	// Keep the polys in the order they're stored in, since the collision 
+	// routines prefer the first of two polys hit at the same time
+	std::sort(pResults->begin() + nOldSize, pResults->end());
 
 	return nOldSize != pResults->size();
 }
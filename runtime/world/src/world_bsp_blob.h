@@ -0,0 +1,112 @@
+#ifndef __WORLD_BSP_BLOB_H__
+#define __WORLD_BSP_BLOB_H__
+
+//
+// The compiled world BSP format.
+//
+// Each WorldBsp is stored as one block of data laid out exactly like the
+// runtime structures (planes, nodes, surfaces, polies, points and texture
+// names), so it can be loaded with a single read followed by a pass that
+// turns the stored indices back into pointers.  Every pointer in the block
+// is stored as an index (or a byte offset for the poly and texture name
+// tables), which keeps the data position independent.
+//
+// The blobs for all the world models live in a section appended to the end
+// of the .dat file by the WorldBlob tool.  The world header's first reserved
+// dword after the packer info holds the position of that section, and it's
+// 0 for worlds that haven't been converted.  Since the section depends on
+// the structure layout of the build that wrote it, the engine falls back to
+// the regular world model data whenever the layout doesn't match its own.
+//
+
+#ifndef __DE_WORLD_H__
+#include "de_world.h"
+#endif
+
+#define WORLDBSPBLOB_ID			0x50534257	// 'WBSP'
+#define WORLDBSPBLOB_VERSION	1
+
+// Node sides that point at NODE_IN and NODE_OUT.
+#define WORLDBSPBLOB_NODE_IN	((uintptr_t)-1)
+#define WORLDBSPBLOB_NODE_OUT	((uintptr_t)-2)
+
+// The header of the section holding all the blobs.
+struct SWorldBspBlobSection
+{
+	uint32	m_nID;
+	uint32	m_nVersion;
+
+	// Layout of the build that wrote it.
+	uint16	m_nPointerSize;
+	uint16	m_nPlaneSize;
+	uint16	m_nNodeSize;
+	uint16	m_nSurfaceSize;
+	uint16	m_nPolySize;
+	uint16	m_nPolyVertexSize;
+	uint16	m_nVertexSize;
+	uint16	m_nPad;
+
+	// Number of blobs that follow, one per world model.
+	uint32	m_nNumBsps;
+
+	// Fill in the layout of this build.
+	void	Init(uint32 nNumBsps)
+	{
+		m_nID				= WORLDBSPBLOB_ID;
+		m_nVersion			= WORLDBSPBLOB_VERSION;
+		m_nPointerSize		= (uint16)sizeof(void*);
+		m_nPlaneSize		= (uint16)sizeof(LTPlane);
+		m_nNodeSize			= (uint16)sizeof(Node);
+		m_nSurfaceSize		= (uint16)sizeof(Surface);
+		m_nPolySize			= (uint16)sizeof(WorldPoly);
+		m_nPolyVertexSize	= (uint16)sizeof(SPolyVertex);
+		m_nVertexSize		= (uint16)sizeof(Vertex);
+		m_nPad				= 0;
+		m_nNumBsps			= nNumBsps;
+	}
+
+	// Can this build use the blobs?
+	bool	IsCompatible() const
+	{
+		SWorldBspBlobSection cThis;
+		cThis.Init(m_nNumBsps);
+		return memcmp(this, &cThis, sizeof(cThis)) == 0;
+	}
+};
+
+// The header in front of each blob.  All the offsets are from the start of
+// the data, which immediately follows the header.
+struct SWorldBspBlobHeader
+{
+	uint32	m_nDataSize;
+
+	uint32	m_WorldInfoFlags;
+	char	m_WorldName[MAX_WORLDNAME_LEN+1];
+	uint8	m_nPad[3];
+
+	LTVector	m_MinBox;
+	LTVector	m_MaxBox;
+	LTVector	m_WorldTranslation;
+
+	uint32	m_nPlanes;
+	uint32	m_nNodes;
+	uint32	m_nSurfaces;
+	uint32	m_nPolies;
+	uint32	m_nPoints;
+	uint32	m_nTextures;
+	uint32	m_nPolyDataSize;
+	uint32	m_nTextureNameDataSize;
+	int32	m_iRootNode;
+
+	uint32	m_nPlaneOffset;
+	uint32	m_nNodeOffset;
+	uint32	m_nSurfaceOffset;
+	uint32	m_nPolyListOffset;
+	uint32	m_nPointOffset;
+	uint32	m_nPolyDataOffset;
+	uint32	m_nTextureNameOffset;
+	uint32	m_nTextureNameDataOffset;
+};
+
+
+#endif
@@ -1,5 +1,8 @@
 #include "bdefs.h"
 #include "world_particle_blocker_data.h"
+#include "world_blocker_bvh.h"
+
+#include <algorithm>
 
 
 //------------------------
@@ -151,6 +154,9 @@ public:
 
 private:
 	std::vector<CParticleBlocker*> m_Blockers;
+
+	// tree around the blocker bounds, built on load
+	CBlockerBVH m_BlockerTree;
 };
 
 define_interface(CWorldParticleBlockerData, IWorldParticleBlockerData);
@@ -176,6 +182,7 @@ void CWorldParticleBlockerData::Term()
 	}
 
 	std::vector<CParticleBlocker*>().swap( m_Blockers );
+	m_BlockerTree.Term();
 }
 
 
@@ -204,10 +211,46 @@ ELoadWorldStatus CWorldParticleBlockerData::Load( ILTStream *pStream )
 	*pStream >> dummy;
 	ASSERT( dummy == 0 );
 
+	// build the tree around the blocker bounds
+	std::vector<LTVector> mins( numPolys );
+	std::vector<LTVector> maxs( numPolys );
+	for( uint32 i = 0; i < numPolys; i++ )
+	{
+		mins[i] = m_Blockers[i]->m_MinBounds;
+		maxs[i] = m_Blockers[i]->m_MaxBounds;
+	}
+	m_BlockerTree.Build( mins, maxs );
+
 	return LoadWorld_Ok;
 }
 
 
+// collects the blockers from the tree whose bounds really overlap the box
+struct SBlockerBoxVisitor
+{
+	SBlockerBoxVisitor( const std::vector<CParticleBlocker*>& blockers, const LTVector& min, const LTVector& max, std::vector<uint32>& indices ) :
+		m_Blockers( blockers ), m_Min( min ), m_Max( max ), m_Indices( indices )
+	{}
+
+	void operator()( uint32 i )
+	{
+		// check if the AABBs are disjoint
+		if( ((m_Min.x > m_Blockers[i]->m_MaxBounds.x) || (m_Blockers[i]->m_MinBounds.x > m_Max.x)) ||
+			((m_Min.y > m_Blockers[i]->m_MaxBounds.y) || (m_Blockers[i]->m_MinBounds.y > m_Max.y)) ||
+			((m_Min.z > m_Blockers[i]->m_MaxBounds.z) || (m_Blockers[i]->m_MinBounds.z > m_Max.z)) )
+				return;
+
+		// they overlap, so add the blocker to the vector
+		m_Indices.push_back( i );
+	}
+
+	const std::vector<CParticleBlocker*>& m_Blockers;
+	const LTVector& m_Min;
+	const LTVector& m_Max;
+	std::vector<uint32>& m_Indices;
+};
+
+
 bool CWorldParticleBlockerData::GetBlockersInAABB( const LTVector& pos, const LTVector& dims, std::vector<uint32>& indices )
 {
 	indices.clear();
@@ -215,18 +258,11 @@ bool CWorldParticleBlockerData::GetBlockersInAABB( const LTVector& pos, const LT
 	LTVector min = pos - dims;
 	LTVector max = pos + dims;
 
-	// a hierarchical approach might be better, but the number of blockers in a scene should be quite small in practice
-	for( uint32 i = 0; i < m_Blockers.size(); i++ )
-	{
-		// check if the AABBs are disjoint
-		if( ((min.x > m_Blockers[i]->m_MaxBounds.x) || (m_Blockers[i]->m_MinBounds.x > max.x)) ||
-			((min.y > m_Blockers[i]->m_MaxBounds.y) || (m_Blockers[i]->m_MinBounds.y > max.y)) ||
-			((min.z > m_Blockers[i]->m_MaxBounds.z) || (m_Blockers[i]->m_MinBounds.z > max.z)) )
-				continue;
+	SBlockerBoxVisitor visitor( m_Blockers, min, max, indices );
+	m_BlockerTree.VisitBox( min, max, visitor );
 
-		// they overlap, so add the blocker to the vector
-		indices.push_back( i );
-	}
+	// hand the blockers back in the order they were loaded
+	std::sort( indices.begin(), indices.end() );
 
 	return true;
 }
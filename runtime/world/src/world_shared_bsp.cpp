@@ -1,6 +1,7 @@
 #include "bdefs.h"
 
 #include "world_shared_bsp.h"
+#include "world_bsp_blob.h"
 #include "parse_world_info.h"
 #include "syscounter.h"
 #include "ltserverobj.h"
@@ -148,13 +149,15 @@ ELoadWorldStatus CWorldSharedBSP::Load(ILTStream *pStream, WorldTree &world_tree
 
     //read the world file version, and the object and lightmap data positions.
     uint32 file_version;
+    uint32 bsp_blob_pos;
     if( ReadWorldHeader( pStream, file_version,
 						object_data_pos,
 						blind_object_data_pos,
 						lightgrid_pos,
 						collision_data_pos,
 						particle_blocker_data_pos,
-						render_data_pos ) == false )
+						render_data_pos,
+						&bsp_blob_pos ) == false )
 	{
 		ASSERT(!"The world being loaded is the incorrect version. Try reprocessing it");
         //the version was old.
@@ -197,6 +200,28 @@ ELoadWorldStatus CWorldSharedBSP::Load(ILTStream *pStream, WorldTree &world_tree
     //read the number of world models
     STREAM_READ(num_world_models);
 
+    //see if we can use the compiled world models instead.
+    bool bUseBlobs = false;
+    if (bsp_blob_pos != 0)
+    {
+        uint32 world_models_pos = pStream->GetPos();
+
+        SWorldBspBlobSection blob_section;
+        pStream->SeekTo(bsp_blob_pos);
+        pStream->Read(&blob_section, sizeof(blob_section));
+
+        if ((pStream->ErrorStatus() == LT_OK) && blob_section.IsCompatible() &&
+            (blob_section.m_nNumBsps == num_world_models))
+        {
+            bUseBlobs = true;
+        }
+        else
+        {
+            //they were written by a build with a different layout.
+            pStream->SeekTo(world_models_pos);
+        }
+    }
+
     //allocate the array of world models.
     LT_MEM_TRACK_ALLOC(world_models = (WorldData **)dalloc_z(num_world_models * sizeof(WorldData *)),LT_MEM_TYPE_WORLD);
 
@@ -220,8 +245,11 @@ ELoadWorldStatus CWorldSharedBSP::Load(ILTStream *pStream, WorldTree &world_tree
             return LoadWorld_Error;
         }
 
-        uint32 nDummy;
-        *pStream >> nDummy;
+        if (!bUseBlobs)
+        {
+            uint32 nDummy;
+            *pStream >> nDummy;
+        }
 
         //get the starting position of this worldmodel.
         uint32 start_position;
@@ -238,7 +266,7 @@ ELoadWorldStatus CWorldSharedBSP::Load(ILTStream *pStream, WorldTree &world_tree
         }       
 
         //load the worldbsp.
-        ELoadWorldStatus loadbsp_status = loaded_bsp->Load(pStream, true);
+        ELoadWorldStatus loadbsp_status = bUseBlobs ? loaded_bsp->LoadBlob(pStream, true) : loaded_bsp->Load(pStream, true);
         if (loadbsp_status != LoadWorld_Ok) 
 		{
             //delete the bsp we allocated.
@@ -268,7 +296,7 @@ ELoadWorldStatus CWorldSharedBSP::Load(ILTStream *pStream, WorldTree &world_tree
 	        }       
 
             //load the bsp.
-            loadbsp_status = loaded_bsp->Load(pStream, false);
+            loadbsp_status = bUseBlobs ? loaded_bsp->LoadBlob(pStream, false) : loaded_bsp->Load(pStream, false);
 
             //check if we loaded it correctly.
             if (loadbsp_status != LoadWorld_Ok) {
@@ -310,6 +338,7 @@ ELoadWorldStatus CWorldSharedBSP::Load(ILTStream *pStream, WorldTree &world_tree
     CalcBoundingSpheres(world_models, num_world_models);
 
     //Gen our list of static lights...
+    pStream->SeekTo(object_data_pos);
     AddStaticLights(pStream);
 
     //insert the static light objects into the given world tree.
@@ -369,7 +398,8 @@ bool IWorldSharedBSP::ReadWorldHeader
 	uint32 &lightgrid_pos,
 	uint32 &collisionDataPos,
 	uint32 &particleBlockerDataPos,
-	uint32 &renderDataPos
+	uint32 &renderDataPos,
+	uint32 *pBspBlobPos
 )
 {
     uint32 packertype, packerversion;
@@ -401,11 +431,17 @@ bool IWorldSharedBSP::ReadWorldHeader
 	//read the position of the rendering data.
 	*pStream >> renderDataPos;
 
-    //read 8 uint32's.
-	uint32 dummyNum;
-	*pStream >> packertype >> packerversion >> dummyNum >> dummyNum;
+    //read 8 uint32's.  The first one after the packer info is the position
+    //of the compiled world models, if the world has been converted.
+	uint32 dummyNum, bspBlobPos;
+	*pStream >> packertype >> packerversion >> bspBlobPos >> dummyNum;
 	*pStream >> dummyNum >> dummyNum >> dummyNum >> dummyNum;
 
+	if (pBspBlobPos)
+	{
+		*pBspBlobPos = bspBlobPos;
+	}
+
     //the version matches.
 	return true;
 }
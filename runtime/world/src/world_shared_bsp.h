@@ -85,7 +85,8 @@ public:
 
     static bool ReadWorldHeader(ILTStream *pStream, uint32 &version, 
         uint32 &objectDataPos, uint32& blindObjectDataPos, uint32& lightgrid_pos,
-		uint32 &collisionDataPos, uint32 &particleBlockerDataPos, uint32 &renderDataPos);
+		uint32 &collisionDataPos, uint32 &particleBlockerDataPos, uint32 &renderDataPos,
+		uint32 *pBspBlobPos = LTNULL);
 
     static WorldData *FindWorldModel(WorldData **&world_models, uint32 &num_world_models, const char *name);
 
@@ -5,6 +5,8 @@
 
 #include "worldtreehelper.h"
 
+#include <vector>
+
 
 // Used by some of the recursive routines.
 typedef void (*FilterFn_R)(WorldTreeNode *pNode, void *pData);
@@ -22,10 +24,97 @@ public:
 };
 
 
+// The objects a query has already reached.  Only objects sitting on more than
+// one node can be reached twice, so this stays small, and since it belongs to
+// the query rather than the objects, queries on other threads don't disturb it.
+class WTVisitedSet
+{
+public:
+
+	WTVisitedSet() :
+		m_pSlots(m_InlineSlots),
+		m_nMask(NUM_INLINE_SLOTS - 1),
+		m_nCount(0)
+	{
+		memset(m_InlineSlots, 0, sizeof(m_InlineSlots));
+	}
+
+	// Returns true the first time it's called for an object.
+	bool Add(const WorldTreeObj *pObj)
+	{
+		// Keep it at most half full.
+		if((m_nCount + 1) * 2 > m_nMask + 1)
+			Grow();
+
+		uint32 iSlot = Hash(pObj) & m_nMask;
+		while(m_pSlots[iSlot])
+		{
+			if(m_pSlots[iSlot] == pObj)
+				return false;
+
+			iSlot = (iSlot + 1) & m_nMask;
+		}
+
+		m_pSlots[iSlot] = pObj;
+		m_nCount++;
+		return true;
+	}
+
+private:
+
+	enum { NUM_INLINE_SLOTS = 32 };
+
+	static uint32 Hash(const WorldTreeObj *pObj)
+	{
+		uint32 nHash = (uint32)((uintptr_t)pObj >> 4) ^ (uint32)((uint64)(uintptr_t)pObj >> 32);
+		nHash *= 0x9E3779B1;
+		return nHash ^ (nHash >> 16);
+	}
+
+	void Grow()
+	{
+		std::vector<const WorldTreeObj*> oldSlots(m_pSlots, m_pSlots + m_nMask + 1);
+
+		m_HeapSlots.assign((m_nMask + 1) * 2, (const WorldTreeObj*)NULL);
+		m_pSlots = &m_HeapSlots[0];
+		m_nMask = (uint32)m_HeapSlots.size() - 1;
+		m_nCount = 0;
+
+		for(uint32 i=0; i < oldSlots.size(); i++)
+		{
+			if(oldSlots[i])
+				Add(oldSlots[i]);
+		}
+	}
+
+	const WorldTreeObj					*m_InlineSlots[NUM_INLINE_SLOTS];
+	std::vector<const WorldTreeObj*>	m_HeapSlots;
+	const WorldTreeObj					**m_pSlots;
+	uint32								m_nMask;
+	uint32								m_nCount;
+};
+
+
+// Returns true the first time a query reaches an object.
+inline bool VisitObj(WTVisitedSet *pVisited, const WorldTreeObj *pObj)
+{
+	return pObj->m_nNodeLinks <= 1 || pVisited->Add(pObj);
+}
+
+
+// The state of a FindObjectsInBox query.
+class FindBoxInfo
+{
+public:
+	FindObjInfo		*m_pInfo;
+	WTVisitedSet	m_Visited;
+};
+
+
 class ISInfo
 {
 public:
-	WorldTree		*m_pTree;
+	WTVisitedSet	m_Visited;
 	NodeObjArray	m_iObjArray;
 	LTVector		m_Pts[2];
 	ISCallback		m_CB;
@@ -135,12 +224,13 @@ inline PolySide GetDimBoxStatus(const LTVector &pt0, const LTVector &pt1,
 
 // Filters the box down the tree and calls the callback for any objects
 // that the box touches.
-static void FindObjectsInBox_R(WorldTreeNode *pNode, FindObjInfo *pInfo)
+static void FindObjectsInBox_R(WorldTreeNode *pNode, FindBoxInfo *pBoxInfo)
 {
 	// Check objects sitting on this node.	
 	if(pNode->GetNumObjectsOnOrBelow() == 0)
 		return;
 
+	FindObjInfo *pInfo = pBoxInfo->m_pInfo;
 	LTLink *pCur, *pListHead;
 	WorldTreeObj *pObj;
 
@@ -152,12 +242,10 @@ static void FindObjectsInBox_R(WorldTreeNode *pNode, FindObjInfo *pInfo)
 		// KEF - 04/03/00 - Increment the link pointer here in case this link goes away in the callback
 		pCur = pCur->m_pNext;
 	
-		// Check the frame code.
-		if(pObj->m_WTFrameCode == pInfo->m_pTree->GetTempFrameCode())
+		// Skip it if it was on a node we already went through.
+		if(!VisitObj(&pBoxInfo->m_Visited, pObj))
 			continue;
 
-		pObj->m_WTFrameCode = pInfo->m_pTree->GetTempFrameCode();
-
 		// Do the boxes intersect?
 		if(DoBoxesTouch(pObj->GetBBoxMin(), pObj->GetBBoxMax(), pInfo->m_Min, pInfo->m_Max))
 		{
@@ -168,7 +256,7 @@ static void FindObjectsInBox_R(WorldTreeNode *pNode, FindObjInfo *pInfo)
 	// Recurse into appropriate nodes.
 	if(pNode->HasChildren())
 	{
-		FilterBox(&pInfo->m_Min, &pInfo->m_Max, pNode, (FilterFn_R)FindObjectsInBox_R, pInfo);
+		FilterBox(&pInfo->m_Min, &pInfo->m_Max, pNode, (FilterFn_R)FindObjectsInBox_R, pBoxInfo);
 	}
 }
 
@@ -284,11 +372,10 @@ static bool IntersectSegment_R(WorldTreeNode *pNode, ISInfo *pInfo)
 		// KEF - 04/03/00 - Increment the link pointer here in case this link goes away in the callback
 		pCur = pCur->m_pNext;
 	
-		// Check the frame code.
-		if(pObj->m_WTFrameCode == pInfo->m_pTree->GetTempFrameCode())
+		// Skip it if it was on a node we already went through.
+		if(!VisitObj(&pInfo->m_Visited, pObj))
 			continue;
 
-		pObj->m_WTFrameCode = pInfo->m_pTree->GetTempFrameCode();
 		bIntersected |= pInfo->m_CB(pObj, pInfo->m_pCBUser);
 	}
 
@@ -332,6 +419,7 @@ WorldTreeObj::WorldTreeObj(WTObjType objType)
 	}
 
 	m_ObjType = objType;
+	m_nNodeLinks = 0;
 	m_WTFrameCode = FRAMECODE_NOTINTREE;
 }
 
@@ -408,6 +496,13 @@ void WorldTreeNode::RemoveLink(WTObjLink* pLink)
 {
 	pLink->m_Link.Remove();
 	pLink->m_Link.TieOff();
+
+	if(pLink->m_pNode)
+	{
+		WorldTreeObj *pObj = (WorldTreeObj*)pLink->m_Link.m_pData;
+		assert(pObj->m_nNodeLinks > 0);
+		pObj->m_nNodeLinks--;
+	}
 		
 	// Remove references from this node all the way up the tree
 	while(pLink->m_pNode)
@@ -520,6 +615,7 @@ void WorldTreeNode::AddObjectToList(WTObjLink *pLink, NodeObjArray iArray)
 
 	dl_Insert(&m_Objects[iArray], &pLink->m_Link);
 	pLink->m_pNode = this;
+	((WorldTreeObj*)pLink->m_Link.m_pData)->m_nNodeLinks++;
 	
 	// Add a reference to all the nodes above here.
 	pTempNode = this;
@@ -620,11 +716,11 @@ void WorldTree::FindObjectsInBox(const LTVector *pMin, const LTVector *pMax,
 
 void WorldTree::FindObjectsInBox2(FindObjInfo *pInfo)
 {
-	ASSERT(m_pHelper);
-	m_nTempFrameCode = m_pHelper->IncFrameCode();
+	FindBoxInfo boxInfo;
 
 	pInfo->m_pTree = this;
-	FindObjectsInBox_R(&m_RootNode, pInfo);
+	boxInfo.m_pInfo = pInfo;
+	FindObjectsInBox_R(&m_RootNode, &boxInfo);
 }
 
 
@@ -640,11 +736,6 @@ void WorldTree::IntersectSegment(const LTVector *pPt1, const LTVector *pPt2,
 {
 	ISInfo isInfo;
 
-	
-	ASSERT(m_pHelper);
-	m_nTempFrameCode = m_pHelper->IncFrameCode();
-
-	isInfo.m_pTree = this;
 	isInfo.m_iObjArray = iArray;
 	isInfo.m_Pts[0] = *pPt1;
 	isInfo.m_Pts[1] = *pPt2;
@@ -13,6 +13,11 @@ schemes.  If an object moves into a node with a vis container object, it is adde
 that object's visibility structure.  When the renderer encounters the node with
 the vis container object, it stops recursing through the WorldTree, and asks
 the vis container to output any visible objects.
+
+Queries (FindObjectsInBox, FindObjectsOnPoint and IntersectSegment) don't write
+to the tree or its objects, so any number of threads can query the same tree at
+once as long as nothing is being inserted or removed.  Inserting and removing
+objects has to stay on one thread and can't overlap with queries on others.
 */
 
 class WorldTreeHelper;
@@ -104,7 +109,7 @@ public:
     }
 
     inline bool IsInWorldTree() {
-        return m_WTFrameCode != FRAMECODE_NOTINTREE;
+        return m_nNodeLinks != 0 || !m_Links[OBJ_NODE_LINK_ALWAYSVIS].m_Link.IsTiedOff();
     }
 
     // This is called before the object is added to the world tree.
@@ -138,8 +143,12 @@ public:
     // Tells what kind of object this is.
     WTObjType       m_ObjType;
 
-    // Used in conjunction with WorldTree::m_CurFrameCode.
-    // Set to FRAMECODE_NOTINTREE if the object is not in the WorldTree.
+    // How many of m_Links are on nodes.  Queries only have to watch for
+    // reaching an object twice if it's on more than one.
+    uint32          m_nNodeLinks;
+
+    // Used by the renderer to mark the objects it has visited this frame.
+    // Set to FRAMECODE_NOTINTREE when the object is removed from the WorldTree.
     uint32          m_WTFrameCode;
 };
 
@@ -269,9 +278,6 @@ public:
     // Load/save the node layout.
     bool            LoadLayout(ILTStream *pStream);
 
-	//gets the current temporary frame code of the tree
-	uint32			GetTempFrameCode() const		{ return m_nTempFrameCode; }
-
     WorldTreeNode*			GetRootNode()			{ return &m_RootNode; }
 	const WorldTreeNode*	GetRootNode() const		{ return &m_RootNode; }
 
@@ -290,9 +296,6 @@ private:
 	//the helper for this world tree
     WorldTreeHelper *m_pHelper;
 
-    // Gotten from m_pHelper and used during queries.
-    uint32          m_nTempFrameCode;
-
     // Root of tree (depth value 0).        
     WorldTreeNode   m_RootNode;
 
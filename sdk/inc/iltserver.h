@@ -49,7 +49,8 @@ Load/save objects flags.
 
 enum
 {
-    SAVEOBJECTS_SAVEGAMECONSOLE  = 1   //! Save the game console state?
+    SAVEOBJECTS_SAVEGAMECONSOLE  = 1,       //! Save the game console state?
+    SAVEOBJECTS_BACKGROUNDWRITE  = (1<<8)   //! Write the file in the background?  See ILTServer::FlushSaveObjects.
 };
 
 
@@ -1444,7 +1445,9 @@ Save game
 
 \return \b LT_ERROR if file could not be opened.  \b LT_OK on success.
 
-Save objects to a file.
+Save objects to a file.  With \b SAVEOBJECTS_BACKGROUNDWRITE the file is
+still being written when this returns, so the game has to call
+FlushSaveObjects before touching it.
 
 Used for: Misc.
 */
@@ -1917,6 +1920,17 @@ Used for: Special FX.
 */
     LTRESULT (*SetGlobalLightObject)(HOBJECT hObj);
 
+/*!
+\return \b LT_ERROR if any save since the last flush couldn't be written.
+\b LT_OK on success.
+
+Waits until every save made with \b SAVEOBJECTS_BACKGROUNDWRITE has been
+written, so the files can be copied or moved.
+
+Used for: Misc.
+*/
+    virtual LTRESULT FlushSaveObjects() = 0;
+
 };
 
 #endif  //! __ILTSERVER_H__
@@ -2062,6 +2062,12 @@ Enables the use of Model OBBs on IntersectSegment calls() for this object
 */
    FLAG2_USEMODELOBBS		=		(1<<10),
 
+/*!
+Server only.  Sends the object to every client no matter how far it is
+from the client's view position (see the ClientRelevanceRadius console variable).
+*/
+	FLAG2_ALWAYSRELEVANT	=		(1<<16),
+
 };
 
 /*!
@@ -23,6 +23,7 @@
 void LTMemInit();
 
 // Terminate LTMem system
+// takes back what every thread is holding, so no other thread may be using LTMem
 void LTMemTerm();
 
 // LTMem Allocation function
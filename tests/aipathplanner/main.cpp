@@ -0,0 +1,278 @@
+// random query benchmark for the AI path planner
+// builds a big grid of volumes with holes, expensive volumes and locked
+// connections, then runs the same random queries through a flat search,
+// the clustered search and the path cache, and checks they agree on which
+// queries have a path
+
+#include "ltbasetypes.h"
+#include "AIPathPlanner.h"
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <set>
+#include <vector>
+
+static const int kGridSize = 120;
+static const float kVolumeSize = 256.0f;
+static const size_t kQueries = 4000;
+static const size_t kCachedPairs = 400;
+
+struct Volume;
+
+struct Neighbor
+{
+  Volume *pVolume;
+  LTVector vConnection;
+};
+
+struct Volume
+{
+  LTVector vCenter;
+  float fWeight;
+  uint32 iPathNode;
+  std::vector<Neighbor> neighbors;
+};
+
+class Graph
+{
+public:
+  typedef Volume NODE;
+
+  uint32 GetNumNodes() const { return (uint32)volumes.size(); }
+  Volume* GetNode(uint32 iNode) const { return volumes[iNode]; }
+
+  uint32 GetNumNeighbors(Volume *pVolume) const { return (uint32)pVolume->neighbors.size(); }
+  Volume* GetNeighbor(Volume *pVolume, uint32 iNeighbor) const { return pVolume->neighbors[iNeighbor].pVolume; }
+
+  LTVector GetNodeCenter(Volume *pVolume) const { return pVolume->vCenter; }
+
+  uint32 GetNodeIndex(Volume *pVolume) const { return pVolume->iPathNode; }
+  void SetNodeIndex(Volume *pVolume, uint32 iNode) { pVolume->iPathNode = iNode; }
+
+  std::vector<Volume*> volumes;
+};
+
+// stands in for AIVOLUME_PATH_SEARCH, with locked connections playing the
+// part of locked doors
+struct Search
+{
+  bool CanUse(Volume *pVolume) { return fMinPathWeight <= 0.0f || pVolume->fWeight <= fMinPathWeight; }
+
+  float GetStepCost(Volume *pVolume, const LTVector &vEntry, uint32 iNeighbor, LTVector *pvNeighborEntry)
+  {
+    *pvNeighborEntry = pVolume->neighbors[iNeighbor].vConnection;
+    return pVolume->fWeight * vEntry.DistSqr(*pvNeighborEntry);
+  }
+
+  bool CanStep(Volume *pPrev, Volume *pFrom, Volume *pTo)
+  {
+    return locked->find(std::make_pair(pFrom, pTo)) == locked->end();
+  }
+
+  std::set<std::pair<Volume*, Volume*> > *locked;
+  float fMinPathWeight;
+};
+
+typedef CAIPathPlanner<Graph> Planner;
+
+static float pathCost(Graph &graph, Search &search, const std::vector<uint32> &path, const LTVector &vStart)
+{
+  float fCost = 0.0f;
+  LTVector vEntry = vStart;
+  for (size_t i = 1; i < path.size(); i++)
+  {
+    Volume *pFrom = graph.GetNode(path[i - 1]);
+    Volume *pTo = graph.GetNode(path[i]);
+    for (uint32 iNeighbor = 0; iNeighbor < pFrom->neighbors.size(); iNeighbor++)
+    {
+      if (pFrom->neighbors[iNeighbor].pVolume == pTo)
+      {
+        LTVector vNext;
+        fCost += search.GetStepCost(pFrom, vEntry, iNeighbor, &vNext);
+        vEntry = vNext;
+        break;
+      }
+    }
+  }
+  return fCost;
+}
+
+static void buildGraph(Graph &graph, std::set<std::pair<Volume*, Volume*> > &locked, std::mt19937 &rng)
+{
+  std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+  std::vector<Volume*> grid(kGridSize * kGridSize, nullptr);
+
+  for (int y = 0; y < kGridSize; y++)
+    for (int x = 0; x < kGridSize; x++)
+    {
+      // leave holes so the shortest paths have to go around things
+      if (unit(rng) < 0.15f)
+        continue;
+      Volume *pVolume = new Volume;
+      pVolume->vCenter.Init(x * kVolumeSize, 0.0f, y * kVolumeSize);
+      pVolume->fWeight = unit(rng) < 0.1f ? 4.0f : 1.0f;
+      pVolume->iPathNode = 0;
+      grid[y * kGridSize + x] = pVolume;
+      graph.volumes.push_back(pVolume);
+    }
+
+  for (int y = 0; y < kGridSize; y++)
+    for (int x = 0; x < kGridSize; x++)
+    {
+      Volume *pVolume = grid[y * kGridSize + x];
+      if (!pVolume)
+        continue;
+      const int dx[4] = { 1, -1, 0, 0 };
+      const int dy[4] = { 0, 0, 1, -1 };
+      for (int i = 0; i < 4; i++)
+      {
+        int nx = x + dx[i], ny = y + dy[i];
+        if (nx < 0 || ny < 0 || nx >= kGridSize || ny >= kGridSize || !grid[ny * kGridSize + nx])
+          continue;
+        Neighbor neighbor;
+        neighbor.pVolume = grid[ny * kGridSize + nx];
+        neighbor.vConnection = (pVolume->vCenter + neighbor.pVolume->vCenter) * 0.5f;
+        pVolume->neighbors.push_back(neighbor);
+        if (unit(rng) < 0.03f)
+          locked.insert(std::make_pair(pVolume, neighbor.pVolume));
+      }
+    }
+}
+
+int main()
+{
+  std::mt19937 rng(1337);
+
+  Graph graph;
+  std::set<std::pair<Volume*, Volume*> > locked;
+  buildGraph(graph, locked, rng);
+
+  // levels small enough for the old planner keep getting exact paths
+  Graph smallGraph;
+  smallGraph.volumes.assign(graph.volumes.begin(), graph.volumes.begin() + (Planner::kDefaultMinNodesForClusters - 1));
+  Planner smallPlanner;
+  smallPlanner.Init(&smallGraph);
+  if (smallPlanner.GetNumClusters() != 0)
+  {
+    std::cout << "FAILED: " << smallGraph.volumes.size() << " volumes were clustered\n";
+    return 1;
+  }
+  smallPlanner.Term();
+
+  Planner planner;
+  planner.Init(&graph);
+  std::cout << graph.volumes.size() << " volumes, " << planner.GetNumClusters() << " clusters, "
+            << locked.size() << " locked connections\n";
+
+  Search search;
+  search.locked = &locked;
+  search.fMinPathWeight = 0.0f;
+
+  // queries come from a limited set of pairs, the way a level's AIs keep
+  // going between the same few places
+  std::uniform_int_distribution<uint32> pickVolume(0, (uint32)graph.volumes.size() - 1);
+  std::vector<std::pair<uint32, uint32> > pairs;
+  for (size_t i = 0; i < kCachedPairs; i++)
+    pairs.push_back(std::make_pair(pickVolume(rng), pickVolume(rng)));
+  std::uniform_int_distribution<size_t> pickPair(0, pairs.size() - 1);
+  std::vector<std::pair<uint32, uint32> > queries;
+  for (size_t i = 0; i < kQueries; i++)
+    queries.push_back(pairs[pickPair(rng)]);
+
+  std::vector<bool> flatFound(kQueries);
+  std::vector<float> flatCost(kQueries);
+  std::vector<uint32> path;
+  uint64 flatExpanded = 0, clusterExpanded = 0;
+
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < kQueries; i++)
+  {
+    Volume *pSrc = graph.GetNode(queries[i].first);
+    Volume *pDest = graph.GetNode(queries[i].second);
+    flatFound[i] = planner.FindPath(search, pSrc, pSrc->vCenter, pDest, false);
+    flatExpanded += planner.GetNodesExpanded();
+    if (flatFound[i])
+    {
+      planner.GetPath(pDest, &path);
+      flatCost[i] = pathCost(graph, search, path, pSrc->vCenter);
+    }
+  }
+  std::chrono::duration<double> flatTime = std::chrono::steady_clock::now() - start;
+
+  size_t mismatches = 0, found = 0, longer = 0;
+  double worstRatio = 1.0;
+
+  start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < kQueries; i++)
+  {
+    Volume *pSrc = graph.GetNode(queries[i].first);
+    Volume *pDest = graph.GetNode(queries[i].second);
+    bool bFound = planner.FindPath(search, pSrc, pSrc->vCenter, pDest);
+    clusterExpanded += planner.GetNodesExpanded();
+    if (bFound != flatFound[i])
+    {
+      mismatches++;
+      continue;
+    }
+    if (!bFound)
+      continue;
+    found++;
+
+    // the path has to actually go from the source to the destination
+    planner.GetPath(pDest, &path);
+    if (path.empty() || path.front() != queries[i].first || path.back() != queries[i].second)
+    {
+      mismatches++;
+      continue;
+    }
+
+    float fCost = pathCost(graph, search, path, pSrc->vCenter);
+    if (fCost > flatCost[i] * 1.0001f)
+    {
+      longer++;
+      worstRatio = std::max(worstRatio, (double)fCost / flatCost[i]);
+    }
+  }
+  std::chrono::duration<double> clusterTime = std::chrono::steady_clock::now() - start;
+
+  CAIPathCache cache;
+  start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < kQueries; i++)
+  {
+    AIPATH_CACHE_KEY key;
+    key.pOwner = nullptr;
+    key.iSrc = queries[i].first;
+    key.iDest = queries[i].second;
+    key.nFlags = 0;
+    key.nParam = 0;
+    if (cache.Find(key))
+      continue;
+    Volume *pSrc = graph.GetNode(queries[i].first);
+    Volume *pDest = graph.GetNode(queries[i].second);
+    if (planner.FindPath(search, pSrc, pSrc->vCenter, pDest))
+    {
+      planner.GetPath(pDest, &path);
+      cache.Add(key, path);
+    }
+  }
+  std::chrono::duration<double> cachedTime = std::chrono::steady_clock::now() - start;
+
+  std::cout << kQueries << " queries, " << found << " with a path\n"
+            << "flat: " << flatTime.count() * 1.0e6 / kQueries << " us/query, "
+            << flatExpanded / kQueries << " volumes expanded\n"
+            << "clustered: " << clusterTime.count() * 1.0e6 / kQueries << " us/query, "
+            << clusterExpanded / kQueries << " volumes expanded, "
+            << longer << " paths longer than flat (worst " << worstRatio << "x)\n"
+            << "cached: " << cachedTime.count() * 1.0e6 / kQueries << " us/query, "
+            << cache.GetNumHits() << " hits, " << cache.GetNumMisses() << " misses\n";
+
+  for (auto pVolume : graph.volumes)
+    delete pVolume;
+
+  if (mismatches)
+  {
+    std::cout << "FAILED: " << mismatches << " queries disagree with the flat search\n";
+    return 1;
+  }
+  return 0;
+}
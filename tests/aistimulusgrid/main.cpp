@@ -0,0 +1,164 @@
+// stimulus grid benchmark
+// scatters AIs and stimuli over a level sized area, then finds the stimuli
+// each AI can sense by testing every stimulus, which is what the stimulus
+// manager did before the grid, and by testing only the ones the grid hands
+// back. the two have to find the same stimuli in the same (alarm) order, and
+// are timed against each other
+
+#include "ltbasetypes.h"
+#include "AIStimulusGrid.h"
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+
+static const uint32 kStimuli = 3000;
+static const uint32 kAIs = 300;
+static const uint32 kSenses = 6;
+static const uint32 kPasses = 20;
+static const float kLevelSize = 40000.0f;
+
+struct Stimulus
+{
+  LTVector vPos;
+  float fRadius;
+  float fVerticalRadius;
+  uint32 nSense;
+};
+
+struct Sensing
+{
+  LTVector vPos;
+  uint32 nSenses;
+  float fSenseDistance[kSenses];
+};
+
+// the distance part of CAIStimulusMgr::CanSense
+static bool canSense(const Sensing &sensing, const Stimulus &stimulus)
+{
+  if (!(sensing.nSenses & stimulus.nSense))
+    return false;
+
+  if (stimulus.fVerticalRadius > 0.0f)
+  {
+    if (sensing.vPos.y > stimulus.vPos.y + stimulus.fVerticalRadius)
+      return false;
+    if (sensing.vPos.y < stimulus.vPos.y - stimulus.fVerticalRadius)
+      return false;
+  }
+
+  uint32 iSense = 0;
+  while (!(stimulus.nSense & (1 << iSense)))
+    iSense++;
+
+  float fDistance = (stimulus.vPos - sensing.vPos).Mag();
+  return fDistance < sensing.fSenseDistance[iSense] + stimulus.fRadius;
+}
+
+static double seconds(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main()
+{
+  std::mt19937 rng(1701);
+  std::uniform_real_distribution<float> position(-kLevelSize * 0.5f, kLevelSize * 0.5f);
+  std::uniform_real_distribution<float> height(-500.0f, 500.0f);
+  std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+  // stimuli are in alarm order already, like the stimulus map. most are
+  // footsteps and the like, a few are explosions heard across the level
+  std::vector<Stimulus> stimuli(kStimuli);
+  uint32 nAllSenses = 0;
+  for (uint32 i = 0; i < kStimuli; i++)
+  {
+    Stimulus &stimulus = stimuli[i];
+    stimulus.vPos.Init(position(rng), height(rng), position(rng));
+    float fRoll = unit(rng);
+    stimulus.fRadius = (fRoll < 0.01f) ? 30000.0f : (fRoll < 0.1f) ? 1500.0f : 300.0f * unit(rng);
+    stimulus.fVerticalRadius = (unit(rng) < 0.3f) ? 200.0f : 0.0f;
+    stimulus.nSense = 1 << (rng() % kSenses);
+    nAllSenses |= stimulus.nSense;
+  }
+
+  // a few AIs have every sense turned way up, so the grid has to hand them
+  // everything
+  std::vector<Sensing> sensing(kAIs);
+  for (uint32 i = 0; i < kAIs; i++)
+  {
+    Sensing &ai = sensing[i];
+    ai.vPos.Init(position(rng), height(rng), position(rng));
+    ai.nSenses = rng() & ((1 << kSenses) - 1);
+    bool bHawkEyed = (i % 50) == 0;
+    for (uint32 iSense = 0; iSense < kSenses; iSense++)
+      ai.fSenseDistance[iSense] = bHawkEyed ? 60000.0f : 200.0f + 2000.0f * unit(rng);
+  }
+
+  CAIStimulusGrid grid;
+  std::vector<uint32> nearStimuli;
+  std::vector<uint32> linearSensed, gridSensed;
+
+  double fLinear = 1e9, fGrid = 1e9, fBuild = 1e9;
+  uint64 nCandidates = 0;
+  for (uint32 pass = 0; pass < kPasses; pass++)
+  {
+    linearSensed.clear();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (uint32 i = 0; i < kAIs; i++)
+    {
+      for (uint32 iStimulus = 0; iStimulus < kStimuli; iStimulus++)
+      {
+        if (canSense(sensing[i], stimuli[iStimulus]))
+          linearSensed.push_back(i * kStimuli + iStimulus);
+      }
+    }
+    fLinear = std::min(fLinear, seconds(start));
+
+    // the manager rebuilds the grid every update, so that counts too
+    gridSensed.clear();
+    nCandidates = 0;
+    start = std::chrono::steady_clock::now();
+    grid.Clear();
+    for (uint32 iStimulus = 0; iStimulus < kStimuli; iStimulus++)
+      grid.AddItem(iStimulus, stimuli[iStimulus].vPos, stimuli[iStimulus].fRadius);
+    grid.Build();
+    fBuild = std::min(fBuild, seconds(start));
+    for (uint32 i = 0; i < kAIs; i++)
+    {
+      float fSenseDistance = 0.0f;
+      uint32 nSenses = sensing[i].nSenses & nAllSenses;
+      for (uint32 iSense = 0; nSenses; iSense++, nSenses >>= 1)
+      {
+        if (nSenses & 1)
+          fSenseDistance = std::max(fSenseDistance, sensing[i].fSenseDistance[iSense]);
+      }
+
+      grid.GetItemsNear(sensing[i].vPos, fSenseDistance, &nearStimuli);
+      nCandidates += nearStimuli.size();
+      for (uint32 iNear = 0; iNear < nearStimuli.size(); iNear++)
+      {
+        if (canSense(sensing[i], stimuli[nearStimuli[iNear]]))
+          gridSensed.push_back(i * kStimuli + nearStimuli[iNear]);
+      }
+    }
+    fGrid = std::min(fGrid, seconds(start));
+
+    if (gridSensed != linearSensed)
+    {
+      uint32 nFirst = 0;
+      while (nFirst < gridSensed.size() && nFirst < linearSensed.size() && gridSensed[nFirst] == linearSensed[nFirst])
+        nFirst++;
+      std::cout << "FAILED: grid found " << gridSensed.size() << " stimuli, expected " << linearSensed.size()
+        << ", first difference at " << nFirst << "\n";
+      return 1;
+    }
+  }
+
+  std::cout << kAIs << " AIs, " << kStimuli << " stimuli, " << linearSensed.size() << " sensed, "
+    << nCandidates / kAIs << " candidates per AI, cell size " << grid.GetCellSize() << "\n";
+  std::cout << "every stimulus: " << fLinear * 1000.0 << " ms, grid: " << fGrid * 1000.0
+    << " ms (" << fBuild * 1000.0 << " ms to build, " << fLinear / fGrid << "x)\n";
+
+  return 0;
+}
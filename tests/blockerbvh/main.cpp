@@ -0,0 +1,398 @@
+// blocker query benchmark
+// builds a level's worth of player and particle blocker quads, loads the
+// particle blockers into the engine's blocker data, and runs particle box
+// queries and player movement sphere queries against them. every result is
+// checked against testing every blocker, which is what the queries did before
+// the blockers were put in a tree, and the two are timed against each other
+
+#include "bdefs.h"
+#include "world_blocker_bvh.h"
+#include "world_blocker_data.h"
+#include "world_particle_blocker_data.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+
+static IWorldBlockerData *g_iWorldBlockerData = LTNULL;
+define_holder(IWorldBlockerData, g_iWorldBlockerData);
+
+static IWorldParticleBlockerData *g_iWorldParticleBlockerData = LTNULL;
+define_holder(IWorldParticleBlockerData, g_iWorldParticleBlockerData);
+
+static const uint32 kBlockers = 6000;
+static const uint32 kQueries = 20000;
+static const uint32 kPasses = 5;
+
+// just enough of a stream to hand the blocker data its polys
+class BlockerStream : public ILTStream
+{
+public:
+  BlockerStream(const std::vector<uint8> &data) : m_Data(data), m_nPos(0), m_bError(false) {}
+
+  virtual void Release() {}
+  virtual LTRESULT Read(void *pData, uint32 size)
+  {
+    if (m_nPos + size > m_Data.size())
+    {
+      memset(pData, 0, size);
+      m_bError = true;
+      return LT_ERROR;
+    }
+    memcpy(pData, &m_Data[m_nPos], size);
+    m_nPos += size;
+    return LT_OK;
+  }
+  virtual LTRESULT ReadString(char *pStr, uint32 maxBytes) { return LT_ERROR; }
+  virtual LTRESULT ErrorStatus() { return m_bError ? LT_ERROR : LT_OK; }
+  virtual LTRESULT SeekTo(uint32 offset) { m_nPos = offset; return LT_OK; }
+  virtual LTRESULT GetPos(uint32 *offset) { *offset = m_nPos; return LT_OK; }
+  virtual LTRESULT GetLen(uint32 *len) { *len = (uint32)m_Data.size(); return LT_OK; }
+  virtual LTRESULT WriteStream(ILTStream &dsSource, uint32 dwMin, uint32 dwMax) { return LT_ERROR; }
+  virtual LTRESULT Write(const void *pData, uint32 size) { return LT_ERROR; }
+  virtual LTRESULT WriteString(const char *pStr) { return LT_ERROR; }
+
+private:
+  const std::vector<uint8> &m_Data;
+  uint32 m_nPos;
+  bool m_bError;
+};
+
+template<class T> static void append(std::vector<uint8> &data, const T &value)
+{
+  const uint8 *p = (const uint8*)&value;
+  data.insert(data.end(), p, p + sizeof(value));
+}
+
+struct Quad
+{
+  LTVector vNormal;
+  LTVector aVerts[4];
+  LTVector vMin, vMax;
+
+  // the sphere the player blocker polys are found by
+  LTVector vCenter;
+  float fRadius;
+};
+
+// walls, ramps and the odd ceiling spread around a big level, mostly in
+// clusters the way blockers end up around stairs and doorways
+static void makeQuads(std::mt19937 &rng, std::vector<Quad> &quads)
+{
+  std::uniform_real_distribution<float> pos(-7500.0f, 7500.0f);
+  std::uniform_real_distribution<float> height(-900.0f, 800.0f);
+  std::uniform_real_distribution<float> spread(-400.0f, 400.0f);
+  std::uniform_real_distribution<float> size(32.0f, 384.0f);
+  std::uniform_real_distribution<float> angle(0.0f, 6.2832f);
+  std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+  LTVector vCluster;
+  for (uint32 i = 0; i < kBlockers; i++)
+  {
+    if ((i % 12) == 0)
+      vCluster.Init(pos(rng), height(rng), pos(rng));
+
+    Quad quad;
+    LTVector vPos = vCluster + LTVector(spread(rng), spread(rng) * 0.25f, spread(rng));
+    float a = angle(rng);
+    LTVector vAcross(cosf(a), 0.0f, sinf(a));
+    LTVector vUp(0.0f, 1.0f, 0.0f);
+    float kind = unit(rng);
+    if (kind > 0.9f)
+      vUp.Init(-sinf(a), 0.0f, cosf(a));
+    else if (kind > 0.7f)
+      vUp = LTVector(-sinf(a), 1.0f, cosf(a)).Unit();
+    vAcross *= size(rng) * 0.5f;
+    vUp *= size(rng) * 0.5f;
+
+    quad.aVerts[0] = vPos - vAcross - vUp;
+    quad.aVerts[1] = vPos - vAcross + vUp;
+    quad.aVerts[2] = vPos + vAcross + vUp;
+    quad.aVerts[3] = vPos + vAcross - vUp;
+    // wound the way the blocker polys expect, clockwise looking at the front
+    quad.vNormal = (quad.aVerts[2] - quad.aVerts[0]).Cross(quad.aVerts[1] - quad.aVerts[0]).Unit();
+
+    quad.vMin = quad.vMax = quad.aVerts[0];
+    for (uint32 v = 1; v < 4; v++)
+    {
+      VEC_MIN(quad.vMin, quad.vMin, quad.aVerts[v]);
+      VEC_MAX(quad.vMax, quad.vMax, quad.aVerts[v]);
+    }
+
+    // same as CBlockerPoly::PreCalc
+    quad.vCenter = (quad.vMin + quad.vMax) * 0.5f;
+    quad.vCenter -= quad.vNormal * (quad.vNormal.Dot(quad.vCenter) - quad.vNormal.Dot(quad.aVerts[0]));
+    quad.fRadius = quad.vCenter.Dist(quad.aVerts[0]);
+    for (uint32 v = 1; v < 4; v++)
+      quad.fRadius = LTMIN(quad.fRadius, quad.vCenter.Dist(quad.aVerts[v]));
+
+    quads.push_back(quad);
+  }
+}
+
+// the layout both blocker loaders read, the particle loader flipping the
+// sign of the plane distance
+static std::vector<uint8> writeBlockers(const std::vector<Quad> &quads, bool bParticle)
+{
+  std::vector<uint8> data;
+  append(data, (uint32)quads.size());
+  for (size_t i = 0; i < quads.size(); i++)
+  {
+    const Quad &quad = quads[i];
+    float fDist = quad.vNormal.Dot(quad.aVerts[0]);
+    append(data, quad.vNormal.x);
+    append(data, quad.vNormal.y);
+    append(data, quad.vNormal.z);
+    append(data, bParticle ? -fDist : fDist);
+    append(data, (uint32)4);
+    for (uint32 v = 0; v < 4; v++)
+    {
+      append(data, quad.aVerts[v].x);
+      append(data, quad.aVerts[v].y);
+      append(data, quad.aVerts[v].z);
+    }
+  }
+  append(data, (uint32)0);
+  return data;
+}
+
+// the player blocker sphere test, from CBlockerPoly::GetPtDistToCircle
+static bool polyInSphere(const Quad &quad, const LTVector &vPt, float fRadius)
+{
+  LTVector vOffset = vPt - quad.vCenter;
+  float fDist = vOffset.Mag();
+  vOffset /= fDist;
+  fDist -= (1.0f - fabsf(vOffset.Dot(quad.vNormal))) * quad.fRadius;
+  return fDist <= fRadius;
+}
+
+static bool boxesTouch(const LTVector &vMin1, const LTVector &vMax1, const LTVector &vMin2, const LTVector &vMax2)
+{
+  return !(vMin1.x > vMax2.x || vMin2.x > vMax1.x ||
+           vMin1.y > vMax2.y || vMin2.y > vMax1.y ||
+           vMin1.z > vMax2.z || vMin2.z > vMax1.z);
+}
+
+struct SphereVisitor
+{
+  const std::vector<Quad> *pQuads;
+  LTVector vPt;
+  float fRadius;
+  std::vector<uint32> *pFound;
+
+  void operator()(uint32 nIndex)
+  {
+    if (polyInSphere((*pQuads)[nIndex], vPt, fRadius))
+      pFound->push_back(nIndex);
+  }
+};
+
+struct SphereQuery
+{
+  LTVector vCenter;
+  float fRadius;
+};
+
+struct BoxQuery
+{
+  LTVector vPos, vDims;
+};
+
+static double seconds(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main()
+{
+  std::mt19937 rng(1138);
+
+  std::vector<Quad> quads;
+  makeQuads(rng, quads);
+
+  // particle blockers go through the engine's blocker data
+  std::vector<uint8> particleData = writeBlockers(quads, true);
+  BlockerStream particleStream(particleData);
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  if (g_iWorldParticleBlockerData->Load(&particleStream) != LoadWorld_Ok || particleStream.ErrorStatus() != LT_OK)
+  {
+    std::cout << "FAILED: couldn't load the particle blockers\n";
+    return 1;
+  }
+  std::cout << kBlockers << " particle blockers loaded in " << seconds(start) * 1000.0 << " ms\n";
+
+  std::uniform_real_distribution<float> pos(-7800.0f, 7800.0f);
+  std::uniform_real_distribution<float> height(-1000.0f, 900.0f);
+  std::uniform_real_distribution<float> extent(50.0f, 400.0f);
+  std::uniform_real_distribution<float> move(0.0f, 48.0f);
+
+  std::vector<BoxQuery> boxes(kQueries);
+  for (uint32 i = 0; i < kQueries; i++)
+  {
+    // half of the particle systems sit near blockers
+    const Quad &quad = quads[i % kBlockers];
+    if (i & 1)
+      boxes[i].vPos = quad.vCenter + LTVector(move(rng), move(rng), move(rng));
+    else
+      boxes[i].vPos.Init(pos(rng), height(rng), pos(rng));
+    boxes[i].vDims.Init(extent(rng), extent(rng), extent(rng));
+  }
+
+  std::vector<std::vector<uint32> > found(kQueries);
+  std::vector<std::vector<uint32> > expected(kQueries);
+
+  double fTree = 1e9, fLinear = 1e9;
+  size_t nTotal = 0;
+  for (uint32 pass = 0; pass < kPasses; pass++)
+  {
+    start = std::chrono::steady_clock::now();
+    for (uint32 i = 0; i < kQueries; i++)
+      g_iWorldParticleBlockerData->GetBlockersInAABB(boxes[i].vPos, boxes[i].vDims, found[i]);
+    fTree = std::min(fTree, seconds(start));
+
+    start = std::chrono::steady_clock::now();
+    for (uint32 i = 0; i < kQueries; i++)
+    {
+      std::vector<uint32> &list = expected[i];
+      list.clear();
+      LTVector vMin = boxes[i].vPos - boxes[i].vDims;
+      LTVector vMax = boxes[i].vPos + boxes[i].vDims;
+      for (uint32 b = 0; b < kBlockers; b++)
+        if (boxesTouch(vMin, vMax, quads[b].vMin, quads[b].vMax))
+          list.push_back(b);
+    }
+    fLinear = std::min(fLinear, seconds(start));
+  }
+  for (uint32 i = 0; i < kQueries; i++)
+  {
+    if (found[i] != expected[i])
+    {
+      std::cout << "FAILED: particle box query " << i << " found " << found[i].size() << " blockers, expected " << expected[i].size() << "\n";
+      return 1;
+    }
+    nTotal += found[i].size();
+  }
+  std::cout << "particle box queries (" << (double)nTotal / kQueries << " blockers each):\n";
+  std::cout << "  every blocker: " << fLinear * 1e9 / kQueries << " ns/query\n";
+  std::cout << "  tree:          " << fTree * 1e9 / kQueries << " ns/query\n";
+
+  // player blockers find polys by sphere, with the tree built around the
+  // padded boxes CWorldBlockerData::Load gives it
+  std::vector<LTVector> mins(kBlockers), maxs(kBlockers);
+  for (uint32 b = 0; b < kBlockers; b++)
+  {
+    float fExtent = quads[b].fRadius + 0.01f + (quads[b].vCenter.Mag() + quads[b].fRadius) * 0.0001f;
+    mins[b] = quads[b].vCenter - LTVector(fExtent, fExtent, fExtent);
+    maxs[b] = quads[b].vCenter + LTVector(fExtent, fExtent, fExtent);
+  }
+  CBlockerBVH tree;
+  start = std::chrono::steady_clock::now();
+  tree.Build(mins, maxs);
+  std::cout << "player blocker tree built in " << seconds(start) * 1000.0 << " ms\n";
+
+  // a move is tested with a sphere around its midpoint that takes in the
+  // whole move and the player's dims
+  std::vector<SphereQuery> spheres(kQueries);
+  float fDimsMag = LTVector(24.0f, 53.0f, 24.0f).Mag();
+  for (uint32 i = 0; i < kQueries; i++)
+  {
+    const Quad &quad = quads[(i * 7) % kBlockers];
+    if (i & 1)
+      spheres[i].vCenter = quad.vCenter + LTVector(move(rng), move(rng), move(rng)) * 2.0f;
+    else
+      spheres[i].vCenter.Init(pos(rng), height(rng), pos(rng));
+    spheres[i].fRadius = move(rng) * 0.5f + fDimsMag;
+  }
+  // right on a poly's center, where the distance test divides by zero
+  spheres[0].vCenter = quads[0].vCenter;
+
+  fTree = 1e9;
+  fLinear = 1e9;
+  nTotal = 0;
+  for (uint32 pass = 0; pass < kPasses; pass++)
+  {
+    start = std::chrono::steady_clock::now();
+    for (uint32 i = 0; i < kQueries; i++)
+    {
+      found[i].clear();
+      SphereVisitor visitor = { &quads, spheres[i].vCenter, spheres[i].fRadius, &found[i] };
+      tree.VisitSphere(spheres[i].vCenter, spheres[i].fRadius, visitor);
+      std::sort(found[i].begin(), found[i].end());
+    }
+    fTree = std::min(fTree, seconds(start));
+
+    start = std::chrono::steady_clock::now();
+    for (uint32 i = 0; i < kQueries; i++)
+    {
+      expected[i].clear();
+      for (uint32 b = 0; b < kBlockers; b++)
+        if (polyInSphere(quads[b], spheres[i].vCenter, spheres[i].fRadius))
+          expected[i].push_back(b);
+    }
+    fLinear = std::min(fLinear, seconds(start));
+  }
+  for (uint32 i = 0; i < kQueries; i++)
+  {
+    if (found[i] != expected[i])
+    {
+      std::cout << "FAILED: player sphere query " << i << " found " << found[i].size() << " polys, expected " << expected[i].size() << "\n";
+      return 1;
+    }
+    nTotal += found[i].size();
+  }
+  std::cout << "player sphere queries (" << (double)nTotal / kQueries << " polys each):\n";
+  std::cout << "  every poly: " << fLinear * 1e9 / kQueries << " ns/query\n";
+  std::cout << "  tree:       " << fTree * 1e9 / kQueries << " ns/query\n";
+
+  // and the player blocker data itself, walking into walls
+  std::vector<uint8> playerData = writeBlockers(quads, false);
+  BlockerStream playerStream(playerData);
+  if (g_iWorldBlockerData->Load(&playerStream) != LoadWorld_Ok || playerStream.ErrorStatus() != LT_OK)
+  {
+    std::cout << "FAILED: couldn't load the player blockers\n";
+    return 1;
+  }
+
+  LTVector vDims(24.0f, 53.0f, 24.0f);
+  uint32 nHits = 0;
+  start = std::chrono::steady_clock::now();
+  for (uint32 i = 0; i < kQueries; i++)
+  {
+    const Quad &quad = quads[i % kBlockers];
+    LTVector vStart = spheres[i].vCenter;
+    LTVector vEnd = vStart + LTVector(move(rng) - 24.0f, 0.0f, move(rng) - 24.0f);
+    // straight at the front of a wall
+    bool bWall = (i & 1) && (quad.vNormal.y == 0.0f);
+    if (bWall)
+    {
+      vStart = quad.vCenter + quad.vNormal * 64.0f;
+      vEnd = quad.vCenter + quad.vNormal * 8.0f;
+    }
+    float fTime;
+    LTVector vNormal;
+    if (g_iWorldBlockerData->Intersect(vStart, vEnd, vDims, &fTime, &vNormal))
+      ++nHits;
+    else if (bWall)
+    {
+      std::cout << "FAILED: walking into blocker " << (i % kBlockers) << " didn't hit anything\n";
+      return 1;
+    }
+  }
+  std::cout << "player moves: " << seconds(start) * 1e9 / kQueries << " ns/move, " << nHits << " of " << kQueries << " blocked\n";
+
+  g_iWorldBlockerData->Term();
+  g_iWorldParticleBlockerData->Term();
+
+  // nothing loaded, nothing found
+  std::vector<uint32> none(1, 0);
+  g_iWorldParticleBlockerData->GetBlockersInAABB(boxes[0].vPos, boxes[0].vDims, none);
+  if (!none.empty())
+  {
+    std::cout << "FAILED: found particle blockers after unloading them\n";
+    return 1;
+  }
+
+  return 0;
+}
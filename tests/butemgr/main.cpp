@@ -0,0 +1,357 @@
+// attribute file parse and lookup benchmark
+// writes out a large attribute file of every value type, parses it as text,
+// compiles it and loads the compiled form back, and reads every key by name
+// from both and through key handles, checking they all agree
+
+#include "stdafx.h"
+#include "butemgr.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <stdlib.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+void* DefStdlithAlloc(uint32 size)
+{
+  return malloc(size);
+}
+
+void DefStdlithFree(void *ptr)
+{
+  free(ptr);
+}
+
+static const uint32 kTags = 2500;
+static const uint32 kLookupRounds = 20;
+
+struct Key
+{
+  std::string tag;
+  std::string att;
+  CButeMgr::SymTypes type;
+};
+
+static const char *kNames[] = { "Pistol", "Rifle", "Shotgun", "Grenade", "Knife", "Launcher", "Dart", "Taser" };
+
+static std::string makeAttributes(std::mt19937 &rng, std::vector<Key> &keys)
+{
+  std::uniform_int_distribution<int> num(-1000, 1000);
+  std::uniform_int_distribution<int> pick(0, 7);
+  std::string text;
+  char line[512];
+
+  text += "// generated weapon attributes\r\n";
+  for (uint32 t = 0; t < kTags; t++)
+  {
+    snprintf(line, sizeof(line), "Weapon%u", t);
+    std::string tag = line;
+    text += "\r\n[" + tag + "]\r\n\r\n";
+
+    auto add = [&](const char *att, CButeMgr::SymTypes type, const char *value)
+    {
+      snprintf(line, sizeof(line), "%s = %s\r\n", att, value);
+      text += line;
+      keys.push_back(Key{ tag, att, type });
+    };
+
+    char value[256];
+    snprintf(value, sizeof(value), "\"%s %u\"", kNames[pick(rng)], t);
+    add("Name", CButeMgr::StringType, value);
+    snprintf(value, sizeof(value), "\"Guns\\\\%s.ltb\"", kNames[pick(rng)]);
+    add("Model", CButeMgr::StringType, value);
+    snprintf(value, sizeof(value), "\"Skins\\\\%s%d.dtx\"", kNames[pick(rng)], pick(rng));
+    add("Skin", CButeMgr::StringType, value);
+    snprintf(value, sizeof(value), "%d", num(rng));
+    add("Damage", CButeMgr::IntType, value);
+    snprintf(value, sizeof(value), "%d", num(rng));
+    add("AmmoCount", CButeMgr::IntType, value);
+    snprintf(value, sizeof(value), "%d", num(rng));
+    add("ClipSize", CButeMgr::IntType, value);
+    snprintf(value, sizeof(value), "(DWORD)%u", (unsigned)(num(rng) + 1000) * 4096u);
+    add("Flags", CButeMgr::DwordType, value);
+    snprintf(value, sizeof(value), "(BYTE)%d", pick(rng) * 31);
+    add("Slot", CButeMgr::ByteType, value);
+    add("Silenced", CButeMgr::BoolType, pick(rng) & 1 ? "TRUE" : "FALSE");
+    add("Automatic", CButeMgr::BoolType, pick(rng) & 1 ? "TRUE" : "FALSE");
+    snprintf(value, sizeof(value), "%d.%03d", num(rng), pick(rng) * 125);
+    add("FireRate", CButeMgr::DoubleType, value);
+    snprintf(value, sizeof(value), "%d.%03d", num(rng), pick(rng) * 125);
+    add("Spread", CButeMgr::DoubleType, value);
+    snprintf(value, sizeof(value), "%d.%02df", num(rng), pick(rng) * 12);
+    add("Range", CButeMgr::FloatType, value);
+    snprintf(value, sizeof(value), "(FLOAT)%d.%02d", num(rng), pick(rng) * 12);
+    add("Recoil", CButeMgr::FloatType, value);
+    snprintf(value, sizeof(value), "<%d.0, %d.5, %d.25>", num(rng), num(rng), num(rng));
+    add("MuzzlePos", CButeMgr::VectorType, value);
+    snprintf(value, sizeof(value), "<%d.0, %d.5, %d.25>", num(rng), num(rng), num(rng));
+    add("BreachOffset", CButeMgr::VectorType, value);
+    snprintf(value, sizeof(value), "[%d.0, %d.5]", num(rng), num(rng));
+    add("ZoomRange", CButeMgr::RangeType, value);
+    snprintf(value, sizeof(value), "(%d, %d, %d, %d)", num(rng), num(rng), num(rng), num(rng));
+    add("IconRect", CButeMgr::RectType, value);
+    snprintf(value, sizeof(value), "(%d, %d)", num(rng), num(rng));
+    add("HudPos", CButeMgr::PointType, value);
+    snprintf(value, sizeof(value), "\"Snd\\\\Weapons\\\\%s\\\\Fire%d.wav\"", kNames[pick(rng)], pick(rng));
+    add("FireSound", CButeMgr::StringType, value);
+  }
+  return text;
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// reads a key by name with the getter for its type, folding the value into a sum
+static double readByName(CButeMgr &bm, const Key &key)
+{
+  static CRect defRect(0, 0, 0, 0);
+  static CPoint defPoint(0, 0);
+  static CARange defRange(0, 0);
+  const char *tag = key.tag.c_str(), *att = key.att.c_str();
+  switch (key.type)
+  {
+  case CButeMgr::IntType: return bm.GetInt(tag, att, 0);
+  case CButeMgr::DwordType: return bm.GetDword(tag, att, 0);
+  case CButeMgr::ByteType: return bm.GetByte(tag, att, 0);
+  case CButeMgr::BoolType: return bm.GetBool(tag, att, false);
+  case CButeMgr::DoubleType: return bm.GetDouble(tag, att, 0.0);
+  case CButeMgr::FloatType: return bm.GetFloat(tag, att, 0.0f);
+  case CButeMgr::StringType: return strlen(bm.GetString(tag, att, "")) + (uint8)bm.GetString(tag, att, "")[0];
+  case CButeMgr::RectType: { CRect &rc = bm.GetRect(tag, att, defRect); return rc.left + 3 * rc.top + 5 * rc.right + 7 * rc.bottom; }
+  case CButeMgr::PointType: { CPoint &pt = bm.GetPoint(tag, att, defPoint); return pt.x + 3 * pt.y; }
+  case CButeMgr::VectorType: { CAVector v = bm.GetVector(tag, att, CAVector(0, 0, 0)); return v.Geti() + 3 * v.Getj() + 5 * v.Getk(); }
+  case CButeMgr::RangeType: { CARange &r = bm.GetRange(tag, att, defRange); return r.GetMin() + 3 * r.GetMax(); }
+  default: return 0;
+  }
+}
+
+// the same through a key handle
+static double readByHandle(CButeMgr &bm, CButeMgr::KeyHandle hKey, CButeMgr::SymTypes type)
+{
+  static CRect defRect(0, 0, 0, 0);
+  static CPoint defPoint(0, 0);
+  static CARange defRange(0, 0);
+  switch (type)
+  {
+  case CButeMgr::IntType: return bm.GetInt(hKey, 0);
+  case CButeMgr::DwordType: return bm.GetDword(hKey, 0);
+  case CButeMgr::ByteType: return bm.GetByte(hKey, 0);
+  case CButeMgr::BoolType: return bm.GetBool(hKey, false);
+  case CButeMgr::DoubleType: return bm.GetDouble(hKey, 0.0);
+  case CButeMgr::FloatType: return bm.GetFloat(hKey, 0.0f);
+  case CButeMgr::StringType: return strlen(bm.GetString(hKey, "")) + (uint8)bm.GetString(hKey, "")[0];
+  case CButeMgr::RectType: { CRect &rc = bm.GetRect(hKey, defRect); return rc.left + 3 * rc.top + 5 * rc.right + 7 * rc.bottom; }
+  case CButeMgr::PointType: { CPoint &pt = bm.GetPoint(hKey, defPoint); return pt.x + 3 * pt.y; }
+  case CButeMgr::VectorType: { CAVector v = bm.GetVector(hKey, CAVector(0, 0, 0)); return v.Geti() + 3 * v.Getj() + 5 * v.Getk(); }
+  case CButeMgr::RangeType: { CARange &r = bm.GetRange(hKey, defRange); return r.GetMin() + 3 * r.GetMax(); }
+  default: return 0;
+  }
+}
+
+static bool countTag(const char *pszTagName, void *pContext)
+{
+  (*(uint32*)pContext)++;
+  return true;
+}
+
+static uint32 tagCount(CButeMgr &bm)
+{
+  uint32 nTags = 0;
+  bm.GetTags(countTag, &nTags);
+  return nTags;
+}
+
+int main()
+{
+  std::mt19937 rng(1234);
+  std::vector<Key> keys;
+  std::string text = makeAttributes(rng, keys);
+  double megabytes = text.size() / (1024.0 * 1024.0);
+  uint32 nSourceHash = CButeMgr::HashSource(text.data(), (unsigned long)text.size());
+
+  char dir[] = "/tmp/butemgrXXXXXX";
+  if (!mkdtemp(dir))
+  {
+    std::cout << "FAILED: can't make a temporary directory\n";
+    return 1;
+  }
+  std::string compiledName = std::string(dir) + "/weapons.txtc";
+
+  bool ok = true;
+
+  // the text, the way the game parses rezzed files, and the compiled file;
+  // best of a few runs each, keeping the last managers for the checks below
+  static const int kLoadRuns = 3;
+  CButeMgr *pText = NULL, *pCompiled = NULL;
+  double parseSeconds = 1e9, compileSeconds = 0.0, loadSeconds = 1e9;
+  for (int run = 0; run < kLoadRuns; run++)
+  {
+    delete pText;
+    pText = new CButeMgr;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    if (!pText->Parse((void*)text.data(), (unsigned long)text.size()))
+    {
+      std::cout << "FAILED: the text didn't parse\n";
+      return 1;
+    }
+    parseSeconds = std::min(parseSeconds, secondsSince(start));
+  }
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  if (!pText->SaveCompiled(compiledName.c_str(), nSourceHash))
+  {
+    std::cout << "FAILED: couldn't write the compiled file\n";
+    return 1;
+  }
+  compileSeconds = secondsSince(start);
+
+  for (int run = 0; run < kLoadRuns; run++)
+  {
+    delete pCompiled;
+    pCompiled = new CButeMgr;
+    start = std::chrono::steady_clock::now();
+    if (!pCompiled->LoadCompiled(compiledName.c_str(), nSourceHash))
+    {
+      std::cout << "FAILED: the compiled file didn't load\n";
+      return 1;
+    }
+    loadSeconds = std::min(loadSeconds, secondsSince(start));
+  }
+
+  std::cout << keys.size() << " keys in " << kTags << " tags, " << megabytes << " MB of text\n";
+  std::cout << "parse " << parseSeconds * 1000.0 << " ms, compile " << compileSeconds * 1000.0 << " ms, load compiled "
+            << loadSeconds * 1000.0 << " ms (" << parseSeconds / loadSeconds << "x)\n";
+
+  if (pCompiled->GetChecksum() != pText->GetChecksum() || tagCount(*pCompiled) != kTags)
+  {
+    std::cout << "FAILED: the compiled file has a different checksum or tag count\n";
+    ok = false;
+  }
+
+  // every key reads the same from the text, the compiled file and a handle,
+  // whatever the case of the names
+  std::vector<CButeMgr::KeyHandle> handles;
+  for (const Key &key : keys)
+  {
+    double textValue = readByName(*pText, key);
+    bool textFound = pText->Success();
+    double compiledValue = readByName(*pCompiled, key);
+    bool compiledFound = pCompiled->Success();
+    std::string upperTag = key.tag, upperAtt = key.att;
+    for (char &c : upperTag) c = toupper(c);
+    for (char &c : upperAtt) c = toupper(c);
+    CButeMgr::KeyHandle hKey = pCompiled->GetKeyHandle(upperTag.c_str(), upperAtt.c_str());
+    double handleValue = readByHandle(*pCompiled, hKey, key.type);
+    if (!textFound || !compiledFound || !hKey || pCompiled->GetType(key.tag.c_str(), key.att.c_str()) != key.type ||
+        textValue != compiledValue || textValue != handleValue ||
+        (key.type == CButeMgr::StringType && strcmp(pText->GetString(key.tag.c_str(), key.att.c_str(), ""), pCompiled->GetString(hKey, ""))))
+    {
+      std::cout << "FAILED: [" << key.tag << "]:" << key.att << " reads differently\n";
+      ok = false;
+      break;
+    }
+    handles.push_back(hKey);
+  }
+
+  // lookups of keys that aren't there
+  if (pCompiled->GetKeyHandle("Weapon1", "NoSuchKey") || pCompiled->GetKeyHandle("NoSuchTag", "Name") ||
+      pCompiled->GetInt((CButeMgr::KeyHandle)NULL, 7) != 7 || pCompiled->Success() ||
+      pCompiled->GetInt("Weapon1", "NoSuchKey", 9) != 9 || pCompiled->Exist("Weapon1", "NoSuchKey"))
+  {
+    std::cout << "FAILED: a missing key was found\n";
+    ok = false;
+  }
+
+  // sets show through handles, and new keys are found next to the indexed ones
+  CButeMgr::KeyHandle hDamage = pCompiled->GetKeyHandle("Weapon7", "Damage");
+  pCompiled->SetInt("Weapon7", "Damage", 123456);
+  pCompiled->SetInt("Weapon7", "Added", 42);
+  pCompiled->SetString("NewTag", "Added", "new");
+  if (pCompiled->GetInt(hDamage, 0) != 123456 || pCompiled->GetInt("weapon7", "damage", 0) != 123456 ||
+      pCompiled->GetInt("Weapon7", "Added", 0) != 42 || strcmp(pCompiled->GetString("NewTag", "Added", ""), "new"))
+  {
+    std::cout << "FAILED: sets on the compiled file didn't read back\n";
+    ok = false;
+  }
+
+  // lookup timing, each key read with the getter for its type
+  double sum[3] = { 0, 0, 0 };
+  start = std::chrono::steady_clock::now();
+  for (uint32 r = 0; r < kLookupRounds; r++)
+    for (const Key &key : keys)
+      sum[0] += readByName(*pText, key);
+  double textLookupSeconds = secondsSince(start);
+
+  start = std::chrono::steady_clock::now();
+  for (uint32 r = 0; r < kLookupRounds; r++)
+    for (const Key &key : keys)
+      sum[1] += readByName(*pCompiled, key);
+  double indexLookupSeconds = secondsSince(start);
+
+  start = std::chrono::steady_clock::now();
+  for (uint32 r = 0; r < kLookupRounds; r++)
+    for (uint32 i = 0; i < handles.size(); i++)
+      sum[2] += readByHandle(*pCompiled, handles[i], keys[i].type);
+  double handleLookupSeconds = secondsSince(start);
+
+  if (sum[1] != sum[2])
+  {
+    std::cout << "FAILED: names and handles summed differently\n";
+    ok = false;
+  }
+
+  double lookups = (double)keys.size() * kLookupRounds;
+  std::cout << "lookups: by name (parsed) " << (int)(textLookupSeconds * 1e9 / lookups) << " ns, by name (compiled index) "
+            << (int)(indexLookupSeconds * 1e9 / lookups) << " ns, by handle " << (int)(handleLookupSeconds * 1e9 / lookups) << " ns\n";
+
+  // a stale or damaged compiled file is turned down without touching the tables
+  CButeMgr stale;
+  std::vector<char> image;
+  FILE *fp = fopen(compiledName.c_str(), "rb");
+  char block[65536];
+  size_t got;
+  while (fp && (got = fread(block, 1, sizeof(block), fp)) > 0)
+    image.insert(image.end(), block, block + got);
+  if (fp)
+    fclose(fp);
+  std::vector<char> damaged = image;
+  damaged[damaged.size() / 2] ^= 0x55;
+  if (stale.LoadCompiled(compiledName.c_str(), nSourceHash + 1) ||
+      stale.LoadCompiled(image.data(), (unsigned long)image.size() - 1, nSourceHash) ||
+      tagCount(stale) != 0 ||
+      !stale.LoadCompiled(image.data(), (unsigned long)image.size(), nSourceHash) ||
+      stale.GetInt("Weapon3", "Damage", 0) != pText->GetInt("Weapon3", "Damage", 0))
+  {
+    std::cout << "FAILED: a stale or truncated compiled file was accepted\n";
+    ok = false;
+  }
+  CButeMgr flipped;
+  if (flipped.LoadCompiled(damaged.data(), (unsigned long)damaged.size(), nSourceHash))
+  {
+    // a flipped value byte still loads, but must never read out of bounds
+    for (const Key &key : keys)
+      readByName(flipped, key);
+  }
+
+  // a compiled file loaded after text still answers for both
+  CButeMgr mixed;
+  const char *extra = "[Extra]\r\nValue = 5\r\n";
+  if (!mixed.Parse((void*)extra, (unsigned long)strlen(extra)) || !mixed.LoadCompiled(compiledName.c_str(), nSourceHash) ||
+      mixed.GetInt("Extra", "Value", 0) != 5 || mixed.GetInt("Weapon3", "Damage", 0) != pText->GetInt("Weapon3", "Damage", 0))
+  {
+    std::cout << "FAILED: text and compiled files didn't mix\n";
+    ok = false;
+  }
+
+  delete pText;
+  delete pCompiled;
+  unlink(compiledName.c_str());
+  rmdir(dir);
+
+  return ok ? 0 : 1;
+}
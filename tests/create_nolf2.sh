@@ -4,7 +4,7 @@ Build=${2:-.}
 
 mkdir -pv ${Dest}/Game
 
-cp -v ${Build}/OUT/Lithtech ${Build}/NOLF2/Client{Res/TO2/libCRes,ShellDLL/TO2/libCShell}.so ${Build}/libs/ServerDir/libServerDir.so ${Dest}/
+cp -v ${Build}/OUT/Lithtech{,Server} ${Build}/runtime/server/libServer.so ${Build}/NOLF2/Client{Res/TO2/libCRes,ShellDLL/TO2/libCShell}.so ${Build}/libs/ServerDir/libServerDir.so ${Dest}/
 cp -v ${Build}/NOLF2/{ClientFxDLL/libClientFx.fxd,ObjectDLL/TO2/libObject.lto} ${Dest}/Game/
 
 ln -vs Game/libObject.lto ${Dest}/
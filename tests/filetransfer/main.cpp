@@ -0,0 +1,353 @@
+// loopback benchmark for the file transfer server and client
+// sends a 100 MB content set (half compressible, half not) from an FTServ to
+// an FTClient over a simulated link, then connects again with the same cache
+// to check every file gets skipped. the hashes come in a frame late the
+// first time, like they do from the server's hashing thread
+
+#include "bdefs.h"
+#include "ftserv.h"
+#include "ftclient.h"
+#include "netmgr.h"
+#include "packet.h"
+#include "client_filemgr.h"
+#include "sha256.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+static const uint32 kNumFiles = 100;
+static const uint32 kFileSize = 1024 * 1024;
+static const float kFrameTime = 1.0f / 30.0f;       // server update rate
+static const double kLinkBytesPerSecond = 12.5e6;   // 100 Mbit
+
+static std::map<std::string, std::vector<uint8>> g_Files;
+
+// stand-ins for the two ends of the connection
+static int g_ServerConn, g_ClientConn;
+#define SERVER_CONN ((CBaseConn*)&g_ServerConn)
+#define CLIENT_CONN ((CBaseConn*)&g_ClientConn)
+
+static std::deque<CPacket_Read> g_ToClient, g_ToServer;
+static uint64 g_WireBytes = 0;
+
+bool CNetMgr::SendPacket(const CPacket_Read &cPacket, CBaseConn *idSendTo, uint32 packetFlags)
+{
+  if (idSendTo == CLIENT_CONN)
+  {
+    g_WireBytes += cPacket.Size() / 8;
+    g_ToClient.push_back(cPacket);
+  }
+  else
+  {
+    g_ToServer.push_back(cPacket);
+  }
+  return true;
+}
+
+void dsi_PrintToConsole(const char *pMsg, ...)
+{
+  va_list marker;
+  va_start(marker, pMsg);
+  vprintf(pMsg, marker);
+  va_end(marker);
+  printf("\n");
+}
+
+void* DefStdlithAlloc(uint32 size)
+{
+  return malloc(size);
+}
+
+void DefStdlithFree(void *ptr)
+{
+  free(ptr);
+}
+
+
+class CMemStream : public ILTStream
+{
+public:
+  CMemStream(const std::vector<uint8> &data) : m_Data(data), m_Pos(0) {}
+
+  void Release() { delete this; }
+
+  LTRESULT Read(void *pData, uint32 size)
+  {
+    if (m_Pos + size > m_Data.size())
+      return LT_ERROR;
+    memcpy(pData, &m_Data[m_Pos], size);
+    m_Pos += size;
+    return LT_OK;
+  }
+
+  LTRESULT ReadString(char *pStr, uint32 maxBytes) { return LT_ERROR; }
+  LTRESULT ErrorStatus() { return LT_OK; }
+  LTRESULT SeekTo(uint32 offset) { m_Pos = offset; return LT_OK; }
+  LTRESULT GetPos(uint32 *offset) { *offset = m_Pos; return LT_OK; }
+  LTRESULT GetLen(uint32 *len) { *len = (uint32)m_Data.size(); return LT_OK; }
+  LTRESULT WriteStream(ILTStream &dsSource, uint32 dwMin, uint32 dwMax) { return LT_ERROR; }
+  LTRESULT Write(const void *pData, uint32 size) { return LT_ERROR; }
+  LTRESULT WriteString(const char *pStr) { return LT_ERROR; }
+
+private:
+  const std::vector<uint8> &m_Data;
+  uint32 m_Pos;
+};
+
+ILTStream* OpenFn(FTServ *hServ, const char *pFilename)
+{
+  return new CMemStream(g_Files[pFilename]);
+}
+
+void CloseFn(FTServ *hServ, ILTStream *pStream)
+{
+  pStream->Release();
+}
+
+int CantOpenFileFn(FTServ *hServ, const char *pFilename)
+{
+  return TODO_REMOVEFILE;
+}
+
+static void hashFile(const char *pFilename, uint8 *pHash)
+{
+  const std::vector<uint8> &data = g_Files[pFilename];
+  SHA256Context context;
+  sha256_Init(&context);
+  sha256_Update(&context, data.data(), (uint32)data.size());
+  sha256_Final(&context, pHash);
+}
+
+// files that have been asked for once, and so are "hashed" by the next frame
+static std::map<std::string, bool> g_HashQueued;
+static uint32 g_nHashWaits = 0;
+
+bool GetHashFn(FTServ *hServ, const char *pFilename, uint32 fileSize, uint8 *pHash)
+{
+  if (!g_HashQueued[pFilename])
+  {
+    g_HashQueued[pFilename] = true;
+    ++g_nHashWaits;
+    return false;
+  }
+
+  hashFile(pFilename, pHash);
+  return true;
+}
+
+
+// the client side just remembers which cache file each file ID ended up in
+class CTestClientFileMgr : public IClientFileMgr
+{
+public:
+  declare_interface(CTestClientFileMgr);
+
+  void Init() {}
+  void Term() {}
+  void ProcessPacket(const CPacket_Read &cPacket) {}
+  void OnConnect(CBaseConn *serverID) {}
+  void OnDisconnect() {}
+  void AddResourceTrees(const char **pTreeNames, int nTrees, TreeType *pTreeTypes, int *nTreesLoaded) {}
+  const char* GetFilename(FileRef *pFileRef) { return LTNULL; }
+  FileEntry* GetFileList(const char *pDirName) { return LTNULL; }
+  FileIdentifier* GetFileIdentifier(FileRef *pDesc, uint8 typeCode) { return LTNULL; }
+  ILTStream* OpenFileIdentifier(FileIdentifier *pFile) { return LTNULL; }
+  ILTStream* OpenFile(FileRef *pDesc) { return LTNULL; }
+  FileIdentifier* FindFileIdentifier(const char *pFilename, uint8 typeCode) { return LTNULL; }
+  LTRESULT CopyFile(const char *pSrc, const char *pDest) { return LT_ERROR; }
+  FTClient* GetFTClient() { return LTNULL; }
+
+  int OnNewFile(FTClient *hClient, const char *pFilename, uint32 size, uint32 fileID,
+    const char *pCachedFilename)
+  {
+    if (!pCachedFilename)
+      return NF_DONTHAVEFILE;
+
+    m_CachedFiles[pFilename] = pCachedFilename;
+    return NF_HAVEFILE;
+  }
+
+  std::map<std::string, std::string> m_CachedFiles;
+};
+
+define_interface(CTestClientFileMgr, IClientFileMgr);
+
+static IClientFileMgr *client_file_mgr;
+define_holder(IClientFileMgr, client_file_mgr);
+
+
+void makeContentSet()
+{
+  static const char *kWords[] = { "world", "model", "texture", "sound", "brush", "light",
+    "object", "prop", "door", "key", "sky", "portal" };
+
+  std::mt19937 rng(1234);
+  for (uint32 i = 0; i < kNumFiles; i++)
+  {
+    char name[64];
+    snprintf(name, sizeof(name), "content/file%03u.dat", i);
+    std::vector<uint8> &data = g_Files[name];
+    data.reserve(kFileSize);
+
+    if (i & 1)
+    {
+      // text-ish, like attribute files and level scripts
+      while (data.size() < kFileSize)
+      {
+        const char *pWord = kWords[rng() % (sizeof(kWords) / sizeof(kWords[0]))];
+        data.insert(data.end(), pWord, pWord + strlen(pWord));
+        data.push_back((rng() % 8) ? ' ' : '\n');
+      }
+      data.resize(kFileSize);
+    }
+    else
+    {
+      // already compressed, like sounds and DXT textures
+      while (data.size() < kFileSize)
+        data.push_back((uint8)rng());
+    }
+  }
+}
+
+
+struct TransferResult
+{
+  double m_SimSeconds;
+  double m_WallSeconds;
+  uint64 m_WireBytes;
+};
+
+TransferResult runTransfer(const char *pCacheDir)
+{
+  FTSInitStruct servInit;
+  servInit.m_OpenFn = OpenFn;
+  servInit.m_CloseFn = CloseFn;
+  servInit.m_CantOpenFileFn = CantOpenFileFn;
+  servInit.m_GetHashFn = GetHashFn;
+  servInit.m_pNetMgr = LTNULL;
+  servInit.m_ConnID = CLIENT_CONN;
+  FTServ *hServ = fts_Init(&servInit, 0);
+
+  FTCInitStruct clientInit;
+  clientInit.m_pNetMgr = LTNULL;
+  clientInit.m_ConnID = SERVER_CONN;
+  clientInit.m_pCacheDir = pCacheDir;
+  FTClient *hClient = ftc_Init(&clientInit);
+
+  g_WireBytes = 0;
+  auto start = std::chrono::steady_clock::now();
+
+  uint32 fileID = 0;
+  for (auto &file : g_Files)
+    fts_AddFile(hServ, file.first.c_str(), (uint32)file.second.size(), fileID++, FFLAG_NEEDED | FFLAG_SENDWAIT);
+  fts_FlushAddedFiles(hServ);
+
+  // each frame the link delivers what its bandwidth allows, so anything
+  // the server sends beyond that queues up and shows as a longer round trip
+  uint32 nFrames = 0;
+  double linkBudget = 0.0;
+  while (fts_GetNumTotalFiles(hServ) != 0)
+  {
+    linkBudget = std::min(linkBudget + kLinkBytesPerSecond * kFrameTime, kLinkBytesPerSecond * kFrameTime);
+    while (!g_ToClient.empty() && linkBudget >= g_ToClient.front().Size() / 8)
+    {
+      linkBudget -= g_ToClient.front().Size() / 8;
+      ftc_ProcessPacket(hClient, g_ToClient.front());
+      g_ToClient.pop_front();
+    }
+
+    while (!g_ToServer.empty())
+    {
+      fts_ProcessPacket(hServ, g_ToServer.front());
+      g_ToServer.pop_front();
+    }
+
+    fts_Update(hServ, kFrameTime);
+
+    if (++nFrames > 1000000)
+      throw "transfer never finished";
+  }
+
+  std::chrono::duration<double> wallTime = std::chrono::steady_clock::now() - start;
+
+  fts_Term(hServ);
+  ftc_Term(hClient);
+  g_ToClient.clear();
+  g_ToServer.clear();
+
+  return TransferResult{ nFrames * kFrameTime, wallTime.count(), g_WireBytes };
+}
+
+
+void checkCache(const char *pCacheDir)
+{
+  CTestClientFileMgr *pFileMgr = (CTestClientFileMgr*)client_file_mgr;
+  if (pFileMgr->m_CachedFiles.size() != g_Files.size())
+    throw "not every file made it into the cache";
+
+  for (auto &cached : pFileMgr->m_CachedFiles)
+  {
+    std::string path = std::string(pCacheDir) + "/" + cached.second;
+    FILE *fp = fopen(path.c_str(), "rb");
+    if (!fp)
+      throw "cache file is missing";
+
+    uint8 hash[SHA256_HASH_SIZE];
+    char cacheFilename[FTC_CACHE_FILENAME_LEN];
+    hashFile(cached.first.c_str(), hash);
+    ftc_GetCacheFilename(hash, (uint32)g_Files[cached.first].size(), cacheFilename, sizeof(cacheFilename));
+    if (cached.second != cacheFilename)
+      throw "cache file isn't named by its hash";
+
+    const std::vector<uint8> &data = g_Files[cached.first];
+    std::vector<uint8> cacheData(data.size() + 1);
+    size_t nRead = fread(cacheData.data(), 1, cacheData.size(), fp);
+    fclose(fp);
+
+    if (nRead != data.size() || memcmp(cacheData.data(), data.data(), data.size()) != 0)
+      throw "cache file doesn't match the server's";
+  }
+}
+
+
+int main()
+{
+  makeContentSet();
+
+  char cacheDir[] = "/tmp/ltftcacheXXXXXX";
+  if (!mkdtemp(cacheDir))
+    throw "can't make the cache directory";
+
+  double totalMB = (double)kNumFiles * kFileSize / (1024.0 * 1024.0);
+  std::cout << "sending " << totalMB << " MB in " << kNumFiles << " files over a "
+            << kLinkBytesPerSecond * 8.0 / 1.0e6 << " Mbit link at " << 1.0f / kFrameTime << " updates/sec\n";
+
+  TransferResult first = runTransfer(cacheDir);
+  checkCache(cacheDir);
+  if (g_nHashWaits != kNumFiles)
+    throw "the server didn't wait for the hashes";
+  std::cout << "empty cache: " << first.m_SimSeconds << " s transfer ("
+            << totalMB / first.m_SimSeconds << " MB/s), "
+            << first.m_WireBytes / (1024.0 * 1024.0) << " MB sent, "
+            << first.m_WallSeconds << " s cpu\n";
+
+  TransferResult second = runTransfer(cacheDir);
+  std::cout << "warm cache:  " << second.m_SimSeconds << " s transfer, "
+            << second.m_WireBytes / 1024.0 << " KB sent\n";
+
+  if (second.m_WireBytes > 64 * 1024)
+    throw "cached files were sent again";
+
+  std::string cleanup = std::string("rm -rf ") + cacheDir;
+  if (system(cleanup.c_str()) != 0)
+    std::cout << "couldn't remove " << cacheDir << "\n";
+
+  return 0;
+}
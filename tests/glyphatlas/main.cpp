@@ -0,0 +1,349 @@
+// cpu only test for the texture string glyph atlas
+// rebuilds the strings a HUD, chat and scoreboard go through every frame the
+// way CTextureStringImage::CreateBitmapFont does, and counts rasterizations,
+// atlas hits and uploaded texels against giving every string its own bitmap
+// font. then runs a lot of fonts through a two page budget to force
+// evictions. every glyph handed out is checked against its page, including
+// the ones on pages that strings are still holding
+
+#include "bdefs.h"
+#include "glyphatlas.h"
+
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+static const uint32 kFrames = 600;
+
+int32 g_DebugLevel = 1;
+
+void dsi_PrintToConsole(const char *pMsg, ...)
+{
+  va_list marker;
+  va_start(marker, pMsg);
+  vprintf(pMsg, marker);
+  va_end(marker);
+  printf("\n");
+}
+
+// makes up a glyph from the character and size, so the results can be checked
+class TestRasterizer : public CGlyphRasterizer
+{
+public:
+  TestRasterizer() : nRasterizations(0) {}
+
+  virtual bool GetRowHeight(const CFontInfo& Font, uint32& nRowHeight)
+  {
+    nRowHeight = Font.m_nHeight;
+    return true;
+  }
+
+  virtual bool RasterizeGlyph(const CFontInfo& Font, texture_string_type_t cGlyph, CGlyphBitmap& Bitmap)
+  {
+    nRasterizations++;
+    Expected(Font, cGlyph, Bitmap);
+    return true;
+  }
+
+  static void Expected(const CFontInfo& Font, texture_string_type_t cGlyph, CGlyphBitmap& Bitmap)
+  {
+    uint32 nChar = (uint8)cGlyph;
+    int32 nWidth = (cGlyph == ' ') ? 0 : (int32)(2 + nChar % 7 + Font.m_nHeight / 3);
+    int32 nHeight = (cGlyph == ' ') ? 0 : (int32)(Font.m_nHeight * 3 / 4 - nChar % 3);
+    Bitmap.m_rBlackBox.Left() = 1;
+    Bitmap.m_rBlackBox.Top() = (int32)(nChar % 3);
+    Bitmap.m_rBlackBox.Right() = 1 + nWidth;
+    Bitmap.m_rBlackBox.Bottom() = Bitmap.m_rBlackBox.Top() + nHeight;
+    Bitmap.m_nTotalWidth = nWidth + 2;
+    Bitmap.m_Coverage.resize(nWidth * nHeight);
+    for (int32 y = 0; y < nHeight; y++)
+      for (int32 x = 0; x < nWidth; x++)
+        Bitmap.m_Coverage[y * nWidth + x] = (uint8)(nChar * 31 + x * 7 + y * 13 + Font.m_nHeight + Font.m_nStyle * 50);
+  }
+
+  uint32 nRasterizations;
+};
+
+// stands in for the textures, just counting what would be sent
+class TestUploader : public CGlyphPageUploader
+{
+public:
+  TestUploader() : nUploads(0), nTexels(0), nNextTexture(1), nLive(0) {}
+
+  virtual bool UploadPage(CGlyphAtlasPage* pPage, const LTRect2n& rDirty)
+  {
+    if (!pPage->m_hTexture)
+    {
+      pPage->m_hTexture = (HTEXTURE)(uintptr_t)(nNextTexture++);
+      nLive++;
+    }
+    nUploads++;
+    nTexels += rDirty.GetWidth() * rDirty.GetHeight();
+    return true;
+  }
+
+  virtual void ReleasePage(CGlyphAtlasPage* pPage)
+  {
+    if (pPage->m_hTexture)
+      nLive--;
+    pPage->m_hTexture = NULL;
+  }
+
+  uint32 nUploads;
+  uint64 nTexels;
+  uintptr_t nNextTexture;
+  uint32 nLive;
+};
+
+// what a texture string image holds onto
+struct Image
+{
+  CFontInfo font;
+  std::vector<CTextureStringGlyph> glyphs;
+  CGlyphAtlasPage* pPage;
+};
+
+static uint32 g_nBadGlyphs = 0;
+
+// checks the glyphs have the right size and that the page has them where
+// the texture coordinates say
+static void checkImage(const Image& image)
+{
+  for (size_t i = 0; i < image.glyphs.size(); i++)
+  {
+    const CTextureStringGlyph& glyph = image.glyphs[i];
+    CGlyphBitmap expected;
+    TestRasterizer::Expected(image.font, glyph.m_cGlyph, expected);
+    if (glyph.m_rBlackBox.Left() != expected.m_rBlackBox.Left() || glyph.m_rBlackBox.Top() != expected.m_rBlackBox.Top() ||
+        glyph.m_rBlackBox.Right() != expected.m_rBlackBox.Right() || glyph.m_rBlackBox.Bottom() != expected.m_rBlackBox.Bottom() ||
+        glyph.m_nTotalWidth != expected.m_nTotalWidth)
+    {
+      g_nBadGlyphs++;
+      continue;
+    }
+
+    uint32 nSize = image.pPage->GetSize();
+    int32 nLeft = (int32)(glyph.m_fU * nSize);
+    int32 nTop = (int32)(glyph.m_fV * nSize);
+    int32 nWidth = expected.m_rBlackBox.GetWidth();
+    int32 nHeight = expected.m_rBlackBox.GetHeight();
+    const uint16* pPixels = image.pPage->GetPixels();
+    for (int32 y = 0; y < nHeight; y++)
+      for (int32 x = 0; x < nWidth; x++)
+      {
+        uint32 nAlpha = (expected.m_Coverage[y * nWidth + x] * 15 + 127) / 255;
+        if (pPixels[(nTop + y) * nSize + nLeft + x] != (uint16)(0x0FFF | (nAlpha << 12)))
+        {
+          g_nBadGlyphs++;
+          return;
+        }
+      }
+  }
+}
+
+// same as CTextureStringImage::CreateBitmapFont
+static bool createImage(CGlyphAtlas& atlas, const CFontInfo& font, const std::string& text, Image& image)
+{
+  std::string unique(text);
+  std::sort(unique.begin(), unique.end());
+  unique.erase(std::unique(unique.begin(), unique.end()), unique.end());
+
+  image.font = font;
+  image.glyphs.resize(unique.size());
+  for (size_t i = 0; i < unique.size(); i++)
+    image.glyphs[i].m_cGlyph = unique[i];
+
+  uint32 nRowHeight;
+  image.pPage = atlas.AcquireGlyphs(font, image.glyphs.empty() ? NULL : &image.glyphs[0], (uint32)image.glyphs.size(), nRowHeight);
+  if (!image.pPage)
+    return false;
+
+  checkImage(image);
+  atlas.FlushPage(image.pPage);
+  return true;
+}
+
+// what building a bitmap font for the string used to take: a rasterization
+// per unique character, and at least the area of all the glyph cells
+static void perStringCost(const CFontInfo& font, const std::string& text, uint64& nRasterizations, uint64& nTexels)
+{
+  std::set<char> unique(text.begin(), text.end());
+  nRasterizations += unique.size();
+  for (std::set<char>::const_iterator it = unique.begin(); it != unique.end(); ++it)
+  {
+    CGlyphBitmap bitmap;
+    TestRasterizer::Expected(font, *it, bitmap);
+    nTexels += (bitmap.m_rBlackBox.GetWidth() + 2) * (bitmap.m_rBlackBox.GetHeight() + 2);
+  }
+}
+
+static std::string randomWord(std::mt19937& rng)
+{
+  static const char* kLetters = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
+  std::uniform_int_distribution<int> length(2, 9), letter(0, 51);
+  std::string word;
+  for (int i = length(rng); i > 0; i--)
+    word += kLetters[letter(rng)];
+  return word;
+}
+
+static bool runHud(std::mt19937& rng)
+{
+  TestRasterizer rasterizer;
+  TestUploader uploader;
+  CGlyphAtlas atlas;
+  atlas.Init(&rasterizer, &uploader);
+
+  CFontInfo hudFont("Hud", 24);
+  CFontInfo chatFont("Chat", 14);
+  CFontInfo scoreFont("Score", 16, LTDEFAULT_CHARSET, CFontInfo::kStyle_Bold);
+
+  std::vector<std::string> chat;
+  std::vector<std::string> names;
+  for (int i = 0; i < 16; i++)
+    names.push_back(randomWord(rng));
+
+  std::uniform_int_distribution<int> health(1, 100), ammo(0, 120), score(-5, 60);
+  std::set<std::pair<uint32, char> > distinct;
+  uint64 nOldRasterizations = 0, nOldTexels = 0, nStrings = 0;
+  std::vector<Image> held;
+
+  for (uint32 nFrame = 0; nFrame < kFrames; nFrame++)
+  {
+    // every string on screen gets rebuilt each frame
+    std::vector<std::pair<const CFontInfo*, std::string> > strings;
+    char szText[64];
+    LTSNPrintF(szText, sizeof(szText), "%d", health(rng));
+    strings.push_back(std::make_pair(&hudFont, std::string(szText)));
+    LTSNPrintF(szText, sizeof(szText), "%d/%d", ammo(rng), 120);
+    strings.push_back(std::make_pair(&hudFont, std::string(szText)));
+    LTSNPrintF(szText, sizeof(szText), "%02u:%02u", (nFrame / 20) / 60, (nFrame / 20) % 60);
+    strings.push_back(std::make_pair(&hudFont, std::string(szText)));
+
+    if (nFrame % 20 == 0)
+    {
+      std::string line = names[nFrame % names.size()] + ": ";
+      for (int i = 0; i < 6; i++)
+        line += randomWord(rng) + " ";
+      chat.push_back(line);
+      if (chat.size() > 8)
+        chat.erase(chat.begin());
+    }
+    for (size_t i = 0; i < chat.size(); i++)
+      strings.push_back(std::make_pair(&chatFont, chat[i]));
+
+    for (size_t i = 0; i < names.size(); i++)
+    {
+      LTSNPrintF(szText, sizeof(szText), "%s %d %d", names[i].c_str(), score(rng), health(rng));
+      strings.push_back(std::make_pair(&scoreFont, std::string(szText)));
+    }
+
+    std::vector<Image> images(strings.size());
+    for (size_t i = 0; i < strings.size(); i++)
+    {
+      if (!createImage(atlas, *strings[i].first, strings[i].second, images[i]))
+      {
+        std::cout << "FAILED: couldn't create \"" << strings[i].second << "\"\n";
+        return false;
+      }
+      perStringCost(*strings[i].first, strings[i].second, nOldRasterizations, nOldTexels);
+      for (size_t c = 0; c < strings[i].second.size(); c++)
+        distinct.insert(std::make_pair(strings[i].first->m_nHeight, strings[i].second[c]));
+    }
+    nStrings += strings.size();
+
+    // last frame's strings go away once the new ones are up
+    for (size_t i = 0; i < held.size(); i++)
+      atlas.ReleasePage(held[i].pPage);
+    held.swap(images);
+  }
+
+  for (size_t i = 0; i < held.size(); i++)
+  {
+    checkImage(held[i]);
+    atlas.ReleasePage(held[i].pPage);
+  }
+
+  const CGlyphAtlas::SStats& stats = atlas.GetStats();
+  std::cout << "hud: " << kFrames << " frames, " << nStrings << " strings, " << atlas.GetNumPages() << " pages\n"
+            << "  atlas: " << rasterizer.nRasterizations << " rasterizations, " << stats.m_nGlyphHits << " hits, "
+            << stats.m_nGlyphsPlaced << " placed, " << uploader.nTexels << " texels uploaded in "
+            << uploader.nUploads << " uploads\n"
+            << "  bitmap font per string: " << nOldRasterizations << " rasterizations, at least "
+            << nOldTexels << " texels uploaded\n";
+
+  // nothing was evicted, so each glyph should only have been rasterized once
+  if (rasterizer.nRasterizations != distinct.size() || stats.m_nPagesEvicted != 0)
+  {
+    std::cout << "FAILED: " << rasterizer.nRasterizations << " rasterizations for " << distinct.size() << " glyphs\n";
+    return false;
+  }
+
+  atlas.Term();
+  return uploader.nLive == 0;
+}
+
+static bool runEviction()
+{
+  TestRasterizer rasterizer;
+  TestUploader uploader;
+  CGlyphAtlas atlas;
+  atlas.Init(&rasterizer, &uploader, 2);
+
+  std::string printable;
+  for (char c = ' '; c <= '~'; c++)
+    printable += c;
+
+  // one string holds on the whole time, so its page can never be evicted
+  Image pinned;
+  if (!createImage(atlas, CFontInfo("Pinned", 20), "The quick brown fox", pinned))
+    return false;
+
+  uint32 nMaxPages = 0;
+  for (uint32 nPass = 0; nPass < 3; nPass++)
+    for (uint32 nHeight = 10; nHeight < 50; nHeight++)
+    {
+      Image image;
+      if (!createImage(atlas, CFontInfo("Big", nHeight), printable, image))
+      {
+        std::cout << "FAILED: couldn't create the " << nHeight << " font\n";
+        return false;
+      }
+      nMaxPages = std::max(nMaxPages, atlas.GetNumPages());
+      atlas.ReleasePage(image.pPage);
+      checkImage(pinned);
+    }
+
+  atlas.ReleasePage(pinned.pPage);
+
+  const CGlyphAtlas::SStats& stats = atlas.GetStats();
+  std::cout << "eviction: " << stats.m_nPagesCreated << " pages created, " << stats.m_nPagesEvicted << " evicted, "
+            << nMaxPages << " at most, " << rasterizer.nRasterizations << " rasterizations\n";
+
+  if (nMaxPages > 2 || stats.m_nPagesEvicted == 0)
+  {
+    std::cout << "FAILED: the page budget wasn't kept\n";
+    return false;
+  }
+
+  atlas.Term();
+  return uploader.nLive == 0;
+}
+
+int main()
+{
+  std::mt19937 rng(1337);
+
+  bool bOk = runHud(rng) && runEviction();
+  if (g_nBadGlyphs)
+  {
+    std::cout << "FAILED: " << g_nBadGlyphs << " glyphs didn't match their pages\n";
+    return 1;
+  }
+  return bOk ? 0 : 1;
+}
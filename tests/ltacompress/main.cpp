@@ -0,0 +1,319 @@
+// compressed LTA read benchmark
+// writes out a world-sized LTA file of brushes, polies and objects through the
+// LTA library's compressor, then reads it back with the old bit-at-a-time
+// decoder, the new ReadByte, the new block ReadUpTo and the tokenizer, and
+// checks every one of them gets back exactly what was written
+
+#include "ltafile.h"
+#include "ltareader.h"
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <stdlib.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+static const uint32 kBrushes = 3000;
+static const uint32 kObjects = 1000;
+
+static const char *kTextures[] = {
+  "Textures/Walls/Brick01.dtx", "Textures/Walls/Concrete03.dtx", "Textures/Floors/Tile12.dtx",
+  "Textures/Metal/Grate02.dtx", "Textures/Sky/Clouds.dtx", "Textures/Trim/Wood07.dtx"
+};
+
+static const char *kClasses[] = { "Light", "AI_Soldier", "Door", "Prop", "SoundFX", "TriggerVolume" };
+
+static std::string makeLTA(std::mt19937 &rng)
+{
+  std::uniform_int_distribution<int> coord(-64, 64);
+  std::uniform_int_distribution<int> pick(0, 5);
+  std::string lta;
+  char line[512];
+
+  lta += "( world\n\t( header\n\t\t( versioncode 2 )\n\t\t( infostring \"Generated\" )\n\t)\n\t( polyhedronlist\n";
+  for (uint32 b = 0; b < kBrushes; b++)
+  {
+    int x = coord(rng) * 64, y = coord(rng) * 16, z = coord(rng) * 64;
+    int w = (pick(rng) + 1) * 32, h = (pick(rng) + 1) * 32, d = (pick(rng) + 1) * 32;
+    lta += "\t\t( polyhedron\n\t\t\t( color 255 255 255 )\n\t\t\t( pointlist\n";
+    for (int p = 0; p < 8; p++)
+    {
+      snprintf(line, sizeof(line), "\t\t\t\t( %f %f %f 255 255 255 255 )\n",
+               (float)(x + ((p & 1) ? w : 0)), (float)(y + ((p & 2) ? h : 0)), (float)(z + ((p & 4) ? d : 0)));
+      lta += line;
+    }
+    lta += "\t\t\t)\n\t\t\t( polylist\n";
+    static const int faces[6][4] = { {0, 1, 3, 2}, {4, 6, 7, 5}, {0, 4, 5, 1}, {2, 3, 7, 6}, {0, 2, 6, 4}, {1, 5, 7, 3} };
+    static const float normals[6][3] = { {0, 0, -1}, {0, 0, 1}, {0, -1, 0}, {0, 1, 0}, {-1, 0, 0}, {1, 0, 0} };
+    for (int f = 0; f < 6; f++)
+    {
+      snprintf(line, sizeof(line),
+               "\t\t\t\t( editpoly\n\t\t\t\t\t( f %d %d %d %d )\n\t\t\t\t\t( n %f %f %f )\n\t\t\t\t\t( dist %f )\n"
+               "\t\t\t\t\t( textureinfo\n\t\t\t\t\t\t( %f %f %f )\n\t\t\t\t\t\t( 1.000000 0.000000 0.000000 )\n"
+               "\t\t\t\t\t\t( 0.000000 0.000000 1.000000 )\n\t\t\t\t\t\t( sticktopoly 1 )\n\t\t\t\t\t\t( name \"%s\" )\n\t\t\t\t\t)\n"
+               "\t\t\t\t\t( flags )\n\t\t\t\t\t( shade 0 0 0 )\n\t\t\t\t\t( physicsmaterial \"Default\" )\n\t\t\t\t)\n",
+               faces[f][0], faces[f][1], faces[f][2], faces[f][3], normals[f][0], normals[f][1], normals[f][2],
+               (float)(f < 2 ? z : (f < 4 ? y : x)), (float)x, (float)y, (float)z, kTextures[pick(rng)]);
+      lta += line;
+    }
+    lta += "\t\t\t)\n\t\t)\n";
+  }
+  lta += "\t)\n\t( objectlist\n";
+  for (uint32 o = 0; o < kObjects; o++)
+  {
+    const char *cls = kClasses[pick(rng)];
+    snprintf(line, sizeof(line),
+             "\t\t( object\n\t\t\t( type %s )\n\t\t\t( properties\n\t\t\t\t( name \"%s%u\" )\n"
+             "\t\t\t\t( pos <%f, %f, %f> )\n\t\t\t\t( rotation <0.000000, %f, 0.000000> )\n"
+             "\t\t\t\t( radius %f )\n\t\t\t\t( visible 1 )\n\t\t\t)\n\t\t)\n",
+             cls, cls, o, (float)coord(rng) * 64.0f, (float)coord(rng) * 16.0f, (float)coord(rng) * 64.0f,
+             (float)pick(rng) * 1.5708f, (float)(pick(rng) + 1) * 128.0f);
+    lta += line;
+  }
+  lta += "\t)\n)\n";
+  return lta;
+}
+
+// the decoder as it was, reading a bit at a time, to check against and time
+class OldDecoder
+{
+public:
+  OldDecoder(const std::vector<uint8> &data) : m_Data(data), m_nPos(0), m_nCurrData(0), m_nMask(0), m_nDecSpanLen(0), m_nDecWndPos(1)
+  {
+    uint8 nVal;
+    for (uint32 i = 0; i < 32; i++)
+      GetBit(nVal);
+  }
+
+  bool GetBit(uint8 &nVal)
+  {
+    if (m_nMask == 0x00)
+    {
+      if (m_nPos >= m_Data.size())
+        return false;
+      m_nCurrData = m_Data[m_nPos++];
+      m_nMask = 0x01;
+    }
+    nVal = m_nCurrData & m_nMask;
+    m_nMask <<= 1;
+    return true;
+  }
+
+  bool ReadByte(uint8 &nByte)
+  {
+    if (m_nDecSpanLen == 0)
+    {
+      uint8 nType;
+      if (GetBit(nType) == false)
+        return false;
+
+      if (nType == 0)
+      {
+        uint8 nBit = 0;
+        uint32 nCurrBit;
+        m_nDecSpanPos = 0;
+        for (nCurrBit = 0; nCurrBit < NUM_OFFSET_BITS; nCurrBit++)
+        {
+          m_nDecSpanPos <<= 1;
+          GetBit(nBit);
+          if (nBit)
+            m_nDecSpanPos |= 1;
+        }
+        if (m_nDecSpanPos == 0)
+          return false;
+        m_nDecSpanLen = 0;
+        for (nCurrBit = 0; nCurrBit < NUM_LENGTH_BITS; nCurrBit++)
+        {
+          m_nDecSpanLen <<= 1;
+          GetBit(nBit);
+          if (nBit)
+            m_nDecSpanLen |= 1;
+        }
+        m_nDecSpanLen += (BREAK_EVEN_POINT + 1);
+      }
+      else
+      {
+        nByte = 0;
+        uint8 nBit = 0;
+        for (uint32 nCurrBit = 0; nCurrBit < 8; nCurrBit++)
+        {
+          nByte <<= 1;
+          GetBit(nBit);
+          if (nBit)
+            nByte |= 1;
+        }
+        m_DecWnd[m_nDecWndPos] = nByte;
+        m_nDecWndPos = WINDOW_POS(m_nDecWndPos + 1);
+        return true;
+      }
+    }
+
+    nByte = m_DecWnd[m_nDecWndPos] = m_DecWnd[m_nDecSpanPos];
+    m_nDecSpanPos = WINDOW_POS(m_nDecSpanPos + 1);
+    m_nDecWndPos = WINDOW_POS(m_nDecWndPos + 1);
+    m_nDecSpanLen--;
+    return true;
+  }
+
+private:
+  const std::vector<uint8> &m_Data;
+  size_t m_nPos;
+  uint8 m_nCurrData;
+  uint8 m_nMask;
+  uint8 m_DecWnd[WINDOW_SIZE];
+  uint32 m_nDecSpanLen;
+  uint32 m_nDecSpanPos;
+  uint32 m_nDecWndPos;
+};
+
+static double secondsSince(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static std::vector<std::string> tokenize(const char *pszFile, bool bCompressed, double &seconds)
+{
+  std::vector<std::string> tokens;
+  CLTAReader reader;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  if (!reader.Open(pszFile, bCompressed))
+    return tokens;
+
+  char value[1024];
+  CLTAReader::ETokenType type;
+  while ((type = reader.NextToken(value, sizeof(value))) != CLTAReader::TK_ERROR)
+  {
+    if (type == CLTAReader::TK_BEGINNODE)
+      tokens.push_back("(");
+    else if (type == CLTAReader::TK_ENDNODE)
+      tokens.push_back(")");
+    else
+      tokens.push_back(value);
+  }
+  seconds = secondsSince(start);
+  return tokens;
+}
+
+int main()
+{
+  std::mt19937 rng(1234);
+  std::string lta = makeLTA(rng);
+  double megabytes = lta.size() / (1024.0 * 1024.0);
+
+  char dir[] = "/tmp/ltacompressXXXXXX";
+  if (!mkdtemp(dir))
+  {
+    std::cout << "FAILED: can't make a temporary directory\n";
+    return 1;
+  }
+  std::string compressedName = std::string(dir) + "/world.ltc";
+  std::string plainName = std::string(dir) + "/world.lta";
+
+  {
+    CLTAFile compressed(compressedName.c_str(), false, true);
+    CLTAFile plain(plainName.c_str(), false, false);
+    if (!compressed.Write((const uint8*)lta.data(), (uint32)lta.size()) || !plain.Write((const uint8*)lta.data(), (uint32)lta.size()))
+    {
+      std::cout << "FAILED: couldn't write the files\n";
+      return 1;
+    }
+  }
+
+  std::vector<uint8> compressedData;
+  FILE *fp = fopen(compressedName.c_str(), "rb");
+  uint8 block[65536];
+  size_t got;
+  while (fp && (got = fread(block, 1, sizeof(block), fp)) > 0)
+    compressedData.insert(compressedData.end(), block, block + got);
+  if (fp)
+    fclose(fp);
+  std::cout << megabytes << " MB of LTA compresses to " << compressedData.size() / (1024.0 * 1024.0) << " MB\n";
+
+  bool ok = true;
+
+  // the old decoder, from memory so the file reading doesn't count against it
+  std::string decoded;
+  decoded.reserve(lta.size());
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  {
+    OldDecoder *pOld = new OldDecoder(compressedData);
+    uint8 nByte;
+    while (pOld->ReadByte(nByte))
+      decoded += (char)nByte;
+    delete pOld;
+  }
+  double oldSeconds = secondsSince(start);
+  if (decoded != lta)
+  {
+    std::cout << "FAILED: the old decoder didn't get back what was written\n";
+    ok = false;
+  }
+
+  // ReadByte, a byte at a time like the tokenizer used to
+  decoded.clear();
+  start = std::chrono::steady_clock::now();
+  {
+    CLTAFile file(compressedName.c_str(), true, true);
+    uint8 nByte;
+    while (file.ReadByte(nByte))
+      decoded += (char)nByte;
+  }
+  double byteSeconds = secondsSince(start);
+  if (decoded != lta)
+  {
+    std::cout << "FAILED: ReadByte didn't get back what was written\n";
+    ok = false;
+  }
+
+  // ReadUpTo, a block at a time
+  decoded.clear();
+  start = std::chrono::steady_clock::now();
+  {
+    CLTAFile file(compressedName.c_str(), true, true);
+    uint32 nRead;
+    while ((nRead = file.ReadUpTo(block, sizeof(block))) > 0)
+      decoded.append((const char*)block, nRead);
+  }
+  double blockSeconds = secondsSince(start);
+  if (decoded != lta)
+  {
+    std::cout << "FAILED: ReadUpTo didn't get back what was written\n";
+    ok = false;
+  }
+
+  // and a block size that doesn't line up with anything
+  decoded.clear();
+  {
+    CLTAFile file(compressedName.c_str(), true, true);
+    uint32 nRead;
+    while ((nRead = file.ReadUpTo(block, 7)) > 0)
+      decoded.append((const char*)block, nRead);
+  }
+  if (decoded != lta)
+  {
+    std::cout << "FAILED: ReadUpTo in small blocks didn't get back what was written\n";
+    ok = false;
+  }
+
+  std::cout << "decoding: old " << (int)(megabytes / oldSeconds) << " MB/s, ReadByte " << (int)(megabytes / byteSeconds)
+            << " MB/s, ReadUpTo " << (int)(megabytes / blockSeconds) << " MB/s\n";
+
+  double compressedTokenSeconds = 0.0, plainTokenSeconds = 0.0;
+  std::vector<std::string> compressedTokens = tokenize(compressedName.c_str(), true, compressedTokenSeconds);
+  std::vector<std::string> plainTokens = tokenize(plainName.c_str(), false, plainTokenSeconds);
+  if (compressedTokens.empty() || compressedTokens != plainTokens)
+  {
+    std::cout << "FAILED: the compressed file tokenized differently\n";
+    ok = false;
+  }
+  std::cout << "tokenizing " << compressedTokens.size() << " tokens: compressed " << (int)(megabytes / compressedTokenSeconds)
+            << " MB/s, uncompressed " << (int)(megabytes / plainTokenSeconds) << " MB/s\n";
+
+  unlink(compressedName.c_str());
+  unlink(plainName.c_str());
+  rmdir(dir);
+
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,170 @@
+// multi-threaded alloc/free benchmark for LTMemAlloc/LTMemFree
+// runs every thread count with the thread caches off and on so the cost
+// of the LTMem critical section shows up in the difference. the small
+// workload only uses simple heap sizes, which is what the caches hold, the
+// mixed one sends about a third of its allocations to the general heap.
+// afterwards checks that LTMemTerm takes back what other threads are holding
+
+#include "ltmem.h"
+#include "ltmemthreadcache.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+static const size_t kIterations = 400000;
+static const size_t kLiveAllocs = 256;
+static const unsigned int kRuns = 3;
+static const unsigned int kMaxThreads = 8;
+
+void allocFreeLoop(unsigned int seed, uint32 maxSize)
+{
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<uint32> sizeDist(4, maxSize);
+  std::vector<uint8*> live(kLiveAllocs, nullptr);
+  std::vector<uint32> sizes(kLiveAllocs, 0);
+
+  for (size_t i = 0; i < kIterations; i++)
+  {
+    size_t slot = rng() % kLiveAllocs;
+    if (live[slot])
+    {
+      // make sure nobody else touched our memory while we held it
+      if (live[slot][0] != uint8(slot) || live[slot][sizes[slot] - 1] != uint8(slot))
+        throw "ltmem block was modified while allocated";
+      LTMemFree(live[slot]);
+    }
+    sizes[slot] = sizeDist(rng);
+    live[slot] = (uint8*)LTMemAlloc(sizes[slot]);
+    if (!live[slot])
+      throw "ltmem allocation failed";
+    std::memset(live[slot], uint8(slot), sizes[slot]);
+  }
+
+  for (auto pMem : live)
+    LTMemFree(pMem);
+}
+
+double runThreads(unsigned int numThreads, uint32 maxSize)
+{
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (unsigned int i = 0; i < numThreads; i++)
+    threads.emplace_back([i, maxSize]() { allocFreeLoop(1337 + i, maxSize); });
+  for (auto &t : threads)
+    t.join();
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+// best of a few runs, so the first one touching the heap pages doesn't count
+double bestRun(unsigned int numThreads, uint32 maxSize)
+{
+  double best = runThreads(numThreads, maxSize);
+  for (unsigned int i = 1; i < kRuns; i++)
+    best = std::min(best, runThreads(numThreads, maxSize));
+  return best;
+}
+
+void benchmark(const char *name, uint32 maxSize)
+{
+  std::cout << name << " (4 to " << maxSize << " bytes):\n";
+  for (unsigned int numThreads = 1; numThreads <= kMaxThreads; numThreads *= 2)
+  {
+    LTMemThreadCacheEnable(false);
+    double locked = bestRun(numThreads, maxSize);
+
+    LTMemThreadCacheEnable(true);
+    uint32 lockCount = LTMemThreadCacheGetLockCount();
+    double cached = bestRun(numThreads, maxSize);
+    lockCount = (LTMemThreadCacheGetLockCount() - lockCount) / kRuns;
+
+    double ops = double(kIterations) * 2.0 * numThreads;
+    std::cout << "  threads: " << numThreads
+              << ", locked: " << (ops / locked) / 1.0e6 << " Mops/s"
+              << ", cached: " << (ops / cached) / 1.0e6 << " Mops/s"
+              << " (" << lockCount << " lock acquisitions per run)\n";
+  }
+}
+
+// a thread that fills its cache and then waits, like a worker between jobs
+struct ParkedThread
+{
+  std::mutex mutex;
+  std::condition_variable cond;
+  bool bParked = false;
+  bool bWake = false;
+  std::thread thread;
+
+  void start()
+  {
+    thread = std::thread([this]() {
+      // freeing these leaves them in this thread's cache
+      std::vector<void*> mem;
+      for (uint32 i = 0; i < 48; i++)
+        mem.push_back(LTMemAlloc(4 + (i % 4) * 16));
+      for (auto pMem : mem)
+        LTMemFree(pMem);
+
+      std::unique_lock<std::mutex> lock(mutex);
+      bParked = true;
+      cond.notify_all();
+      cond.wait(lock, [this]() { return bWake; });
+      lock.unlock();
+
+      // the cache was emptied out from under us, it has to start over
+      void *pMem = LTMemAlloc(24);
+      if (pMem)
+        std::memset(pMem, 0xcd, 24);
+      LTMemFree(pMem);
+    });
+
+    std::unique_lock<std::mutex> lock(mutex);
+    cond.wait(lock, [this]() { return bParked; });
+  }
+
+  void finish()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      bWake = true;
+      cond.notify_all();
+    }
+    thread.join();
+  }
+};
+
+int main() {
+  LTMemInit();
+
+  benchmark("small", 64);
+  benchmark("mixed", 96);
+
+  // LTMemTerm has to empty every thread's cache, not just the caller's
+  std::vector<ParkedThread> parked(4);
+  for (auto &p : parked)
+    p.start();
+
+  uint32 lockCount = LTMemThreadCacheGetLockCount();
+  LTMemTerm();
+  lockCount = LTMemThreadCacheGetLockCount() - lockCount;
+  if (lockCount < parked.size())
+  {
+    std::cout << "FAILED: LTMemTerm only returned " << lockCount << " batches for " << parked.size() << " parked threads\n";
+    return 1;
+  }
+  std::cout << "LTMemTerm returned " << lockCount << " batches from parked threads\n";
+
+  // the parked threads go on using LTMem after it starts up again
+  LTMemInit();
+  for (auto &p : parked)
+    p.finish();
+  LTMemTerm();
+
+  return 0;
+}
@@ -0,0 +1,405 @@
+// packet size benchmark for the delta compressed object updates
+// plays back a recorded-style stream of actor movement (walking, turning,
+// idling, switching animations) through the old full unguaranteed update
+// format and through the delta compressed one, over a link that drops some
+// packets and acks late, and checks the client decodes exactly what was sent
+
+#include "bdefs.h"
+#include "packetdefs.h"
+#include "packet.h"
+#include "netdelta.h"
+#include "compress.h"
+
+#include <deque>
+#include <iostream>
+#include <random>
+#include <vector>
+
+static ICompress *g_pCompressor;
+define_holder(ICompress, g_pCompressor);
+
+static const uint32 kActors = 64;
+static const uint32 kIdleActors = 16;	// stand around playing an idle loop
+static const uint32 kPlayers = 4;		// full rotations instead of Y only
+static const uint32 kFrames = 1200;		// a minute at 20 updates a second
+static const uint32 kFrameMS = 50;
+static const uint32 kAckLatency = 3;	// frames before an ack gets back to the server
+static const float kLoss = 0.05f;
+
+static const LTVector kWorldMin(-8192.0f, -2048.0f, -8192.0f);
+static const LTVector kWorldMax(8192.0f, 2048.0f, 8192.0f);
+
+struct Actor
+{
+  LTVector vPos;
+  LTVector vVel;
+  bool bIdle;
+  float fYaw, fPitch;
+  uint16 nAnim;
+  uint32 nAnimLength;	// ms
+  uint32 nAnimTime;		// ms
+  uint32 nNextAnimChange;
+};
+
+// what goes out for an object, compressed the way the server does it
+struct Sent
+{
+  uint16 nID;
+  uint32 nFlags;
+  CompWorldPos cPos;
+  bool bVel;
+  CompVector cVel;
+  CompRot cRot;
+  int8 nYRot;
+  uint16 nAnim;
+  bool bLooping;
+  uint32 nAnimTimeType, nAnimTimeBits, nAnimTime;
+};
+
+static void compressActor(const Actor &actor, uint16 nID, bool bPlayer, Sent *pSent)
+{
+  LTVector vInvDiff(1.0f / (kWorldMax.x - kWorldMin.x), 1.0f / (kWorldMax.y - kWorldMin.y), 1.0f / (kWorldMax.z - kWorldMin.z));
+
+  pSent->nID = nID;
+  pSent->nFlags = UUF_POS | UUF_ANIMINFO | (bPlayer ? UUF_ROT : UUF_YROTATION);
+  g_pCompressor->EncodeCompressWorldPosition(&pSent->cPos, &actor.vPos, kWorldMin, vInvDiff, false);
+  pSent->bVel = actor.vVel.MagSqr() > 0.00001f;
+  memset(&pSent->cVel, 0, sizeof(pSent->cVel));
+  if (pSent->bVel)
+    g_pCompressor->EncodeCompressVector(&pSent->cVel, &actor.vVel);
+
+  LTRotation cRot(actor.fPitch, actor.fYaw, 0.0f);
+  memset(&pSent->cRot, 0, sizeof(pSent->cRot));
+  g_pCompressor->EncodeCompressRotation(&cRot, &pSent->cRot);
+  LTVector forward = cRot.Forward();
+  pSent->nYRot = (int8)((float)atan2(forward.x, forward.z) * (127.0f / MATH_PI));
+
+  // same time size rules as WriteAnimInfo
+  pSent->nAnim = actor.nAnim;
+  pSent->bLooping = true;
+  uint32 nScaledLength = (actor.nAnimLength + (MODELINFO_ANIMTIME_RES - 1)) / MODELINFO_ANIMTIME_RES;
+  pSent->nAnimTime = (actor.nAnimTime + (MODELINFO_ANIMTIME_RES - 1)) / MODELINFO_ANIMTIME_RES;
+  if (nScaledLength > (1 << MODELINFO_ANIMTIME_SIZE2) - 1)
+  {
+    pSent->nAnimTimeType = 3;
+    pSent->nAnimTimeBits = MODELINFO_ANIMTIME_SIZE3;
+  }
+  else if (nScaledLength > (1 << MODELINFO_ANIMTIME_SIZE1) - 1)
+  {
+    pSent->nAnimTimeType = 2;
+    pSent->nAnimTimeBits = MODELINFO_ANIMTIME_SIZE2;
+  }
+  else
+  {
+    pSent->nAnimTimeType = 1;
+    pSent->nAnimTimeBits = MODELINFO_ANIMTIME_SIZE1;
+  }
+}
+
+static void writeFullAnim(CPacket_Write &cPacket, const Sent &sent)
+{
+  bool bLong = sent.nAnim >= (1 << MODELINFO_ANIMINDEX_SHORT);
+  cPacket.Writebool(bLong);
+  if (bLong)
+  {
+    cPacket.WriteBits(sent.nAnim, MODELINFO_ANIMINDEX_LONG);
+    cPacket.Writebool(true);
+  }
+  else
+    cPacket.WriteBits(sent.nAnim, MODELINFO_ANIMINDEX_SHORT);
+  cPacket.Writebool(sent.bLooping);
+  cPacket.WriteBits(sent.nAnimTimeType, 2);
+  cPacket.WriteBits(sent.nAnimTime, sent.nAnimTimeBits);
+}
+
+// the layout WriteUnguaranteedInfo used before the delta compression
+static void writeFull(CPacket_Write &cPacket, const Sent &sent)
+{
+  cPacket.Writeuint16(sent.nID);
+  cPacket.WriteBits(sent.nFlags, UUF_FLAGCOUNT);
+  for (uint32 i = 0; i < 3; i++)
+    cPacket.Writeuint16(sent.cPos.m_Pos[i]);
+  cPacket.Writebool(sent.bVel);
+  if (sent.bVel)
+  {
+    cPacket.Writefloat(sent.cVel.fA);
+    cPacket.Writeuint16((uint16)sent.cVel.dwB);
+    cPacket.Writeuint16((uint16)sent.cVel.dwC);
+    cPacket.Writeuint8(sent.cVel.order);
+  }
+  if (sent.nFlags & UUF_YROTATION)
+    cPacket.Writeint8(sent.nYRot);
+  else
+  {
+    uint32 nBytes = (sent.cRot.m_Bytes[0] < 0) ? 3 : 6;
+    for (uint32 i = 0; i < nBytes; i++)
+      cPacket.Writeint8(sent.cRot.m_Bytes[i]);
+  }
+  writeFullAnim(cPacket, sent);
+}
+
+// the layout WriteUnguaranteedInfo and WriteAnimInfo use now
+static void writeDelta(CPacket_Write &cPacket, const Sent &sent, const NetObjState *pBaseline, NetObjState *pState)
+{
+  cPacket.Writeuint16(sent.nID);
+  cPacket.WriteBits(sent.nFlags, UUF_FLAGCOUNT);
+  nd_WritePos(cPacket, sent.cPos, pBaseline, pState);
+  cPacket.Writebool(sent.bVel);
+  if (sent.bVel)
+    nd_WriteVel(cPacket, sent.cVel, pBaseline, pState);
+  if (sent.nFlags & UUF_YROTATION)
+    nd_WriteYRot(cPacket, sent.nYRot, pBaseline, pState);
+  else
+    nd_WriteRot(cPacket, sent.cRot, pBaseline, pState);
+
+  uint8 nAnimFlags = NETSTATE_ANIM_PLAYING | (sent.bLooping ? NETSTATE_ANIM_LOOPING : 0);
+  bool bDelta = pBaseline && (pBaseline->m_nFields & NETSTATE_ANIM) &&
+    (pBaseline->m_nAnimIndex == sent.nAnim) &&
+    (pBaseline->m_nAnimFlags == nAnimFlags) &&
+    (pBaseline->m_nAnimTimeType == sent.nAnimTimeType);
+  cPacket.Writebool(bDelta);
+  if (bDelta)
+    nd_WriteValue(cPacket, sent.nAnimTime, pBaseline->m_nAnimTime, sent.nAnimTimeBits);
+  else
+    writeFullAnim(cPacket, sent);
+
+  pState->m_nAnimIndex = sent.nAnim;
+  pState->m_nAnimFlags = nAnimFlags;
+  pState->m_nAnimTimeType = (uint8)sent.nAnimTimeType;
+  pState->m_nAnimTime = sent.nAnimTime;
+  pState->m_nFields |= NETSTATE_ANIM;
+}
+
+static bool readDelta(CPacket_Read &cPacket, const Sent &expected, const NetObjState *pBaseline, NetObjState *pState)
+{
+  static const uint32 aTimeBits[4] = { MODELINFO_ANIMTIME_SIZE0, MODELINFO_ANIMTIME_SIZE1, MODELINFO_ANIMTIME_SIZE2, MODELINFO_ANIMTIME_SIZE3 };
+  bool bMatch = true;
+
+  cPacket.ReadBits(UUF_FLAGCOUNT);
+
+  CompWorldPos cPos;
+  nd_ReadPos(cPacket, &cPos, pBaseline, pState);
+  for (uint32 i = 0; i < 3; i++)
+    bMatch &= cPos.m_Pos[i] == expected.cPos.m_Pos[i];
+
+  bool bVel = cPacket.Readbool();
+  bMatch &= bVel == expected.bVel;
+  if (bVel)
+  {
+    CompVector cVel;
+    nd_ReadVel(cPacket, &cVel, pBaseline, pState);
+    bMatch &= memcmp(&cVel.fA, &expected.cVel.fA, sizeof(float)) == 0;
+    bMatch &= cVel.dwB == (uint16)expected.cVel.dwB && cVel.dwC == (uint16)expected.cVel.dwC;
+    bMatch &= cVel.order == expected.cVel.order;
+  }
+
+  if (expected.nFlags & UUF_YROTATION)
+    bMatch &= nd_ReadYRot(cPacket, pBaseline, pState) == expected.nYRot;
+  else
+  {
+    CompRot cRot;
+    nd_ReadRot(cPacket, &cRot, pBaseline, pState);
+    uint32 nBytes = (expected.cRot.m_Bytes[0] < 0) ? 3 : 6;
+    for (uint32 i = 0; i < nBytes; i++)
+      bMatch &= cRot.m_Bytes[i] == expected.cRot.m_Bytes[i];
+  }
+
+  uint16 nAnim;
+  uint8 nAnimFlags;
+  uint32 nTimeType, nTime;
+  if (cPacket.Readbool())
+  {
+    if (!pBaseline || !(pBaseline->m_nFields & NETSTATE_ANIM))
+      return false;
+    nAnim = pBaseline->m_nAnimIndex;
+    nAnimFlags = pBaseline->m_nAnimFlags;
+    nTimeType = pBaseline->m_nAnimTimeType;
+    nTime = nd_ReadValue(cPacket, pBaseline->m_nAnimTime, aTimeBits[nTimeType]);
+  }
+  else
+  {
+    nAnimFlags = 0;
+    if (cPacket.Readbool())
+    {
+      nAnim = (uint16)cPacket.ReadBits(MODELINFO_ANIMINDEX_LONG);
+      if (cPacket.Readbool())
+        nAnimFlags |= NETSTATE_ANIM_PLAYING;
+    }
+    else
+    {
+      nAnim = (uint16)cPacket.ReadBits(MODELINFO_ANIMINDEX_SHORT);
+      nAnimFlags |= NETSTATE_ANIM_PLAYING;
+    }
+    if (cPacket.Readbool())
+      nAnimFlags |= NETSTATE_ANIM_LOOPING;
+    nTimeType = cPacket.ReadBits(2);
+    nTime = cPacket.ReadBits(aTimeBits[nTimeType]);
+  }
+  bMatch &= nAnim == expected.nAnim && nTime == expected.nAnimTime && nTimeType == expected.nAnimTimeType;
+
+  pState->m_nAnimIndex = nAnim;
+  pState->m_nAnimFlags = nAnimFlags;
+  pState->m_nAnimTimeType = (uint8)nTimeType;
+  pState->m_nAnimTime = nTime;
+  pState->m_nFields |= NETSTATE_ANIM;
+
+  return bMatch;
+}
+
+static void stepActor(Actor &actor, uint32 nTime, std::mt19937 &rng)
+{
+  std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+  float fDT = kFrameMS / 1000.0f;
+
+  actor.nAnimTime = (actor.nAnimTime + kFrameMS) % actor.nAnimLength;
+  if (nTime >= actor.nNextAnimChange)
+  {
+    actor.nAnim = (uint16)(unit(rng) * 300.0f);
+    actor.nAnimLength = 400 + (uint32)(unit(rng) * 2000.0f);
+    actor.nAnimTime = 0;
+    actor.nNextAnimChange = nTime + 1000 + (uint32)(unit(rng) * 4000.0f);
+  }
+
+  if (actor.bIdle)
+    return;
+
+  // wander: turn a little every frame, sometimes stop and go
+  actor.fYaw += (unit(rng) - 0.5f) * 0.2f;
+  actor.fPitch = (unit(rng) - 0.5f) * 0.1f;
+  float fSpeed = unit(rng) < 0.02f ? 0.0f : 280.0f;
+  actor.vVel.Init((float)sin(actor.fYaw) * fSpeed, 0.0f, (float)cos(actor.fYaw) * fSpeed);
+  actor.vPos += actor.vVel * fDT;
+}
+
+int main()
+{
+  std::mt19937 rng(1337);
+  std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+  std::vector<Actor> actors(kActors);
+  for (uint32 i = 0; i < kActors; i++)
+  {
+    Actor &actor = actors[i];
+    actor.vPos.Init((unit(rng) - 0.5f) * 8000.0f, (unit(rng) - 0.5f) * 400.0f, (unit(rng) - 0.5f) * 8000.0f);
+    actor.vVel.Init(0.0f, 0.0f, 0.0f);
+    actor.bIdle = i < kIdleActors;
+    actor.fYaw = unit(rng) * MATH_CIRCLE;
+    actor.fPitch = 0.0f;
+    actor.nAnim = (uint16)(unit(rng) * 300.0f);
+    actor.nAnimLength = 400 + (uint32)(unit(rng) * 2000.0f);
+    actor.nAnimTime = 0;
+    actor.nNextAnimChange = (i < kIdleActors) ? 0xFFFFFFFF : (uint32)(unit(rng) * 4000.0f);
+  }
+
+  // server and client ends of the delta compression
+  CNetSnapshotRing serverRing, clientRing;
+  uint16 nSequence = 0, nAck = 0;
+  bool bAcked = false;
+  std::deque<std::pair<uint32, uint16> > acks;	// frame it arrives, sequence
+
+  uint64 nFullBits = 0, nDeltaBits = 0;
+  uint32 nLost = 0, nDropped = 0, nDeltaFrames = 0, nMismatches = 0;
+
+  for (uint32 nFrame = 0; nFrame < kFrames; nFrame++)
+  {
+    for (uint32 i = 0; i < kActors; i++)
+      stepActor(actors[i], nFrame * kFrameMS, rng);
+
+    while (!acks.empty() && acks.front().first <= nFrame)
+    {
+      uint16 nAcked = acks.front().second;
+      acks.pop_front();
+      if ((!bAcked || nd_IsNewer(nAcked, nAck)) && serverRing.Find(nAcked))
+      {
+        nAck = nAcked;
+        bAcked = true;
+      }
+    }
+
+    std::vector<Sent> sent(kActors);
+    for (uint32 i = 0; i < kActors; i++)
+      compressActor(actors[i], (uint16)(i + 1), i >= kActors - kPlayers, &sent[i]);
+
+    CPacket_Write cFull;
+    for (uint32 i = 0; i < kActors; i++)
+      writeFull(cFull, sent[i]);
+    nFullBits += cFull.Size();
+
+    // same as BuildUnguaranteedUpdate
+    uint16 nThis = nSequence++;
+    uint16 nAge = (uint16)(nThis - nAck);
+    const CNetSnapshot *pBaseline = (bAcked && nAge < NETDELTA_SNAPSHOTS) ? serverRing.Find(nAck) : LTNULL;
+
+    CPacket_Write cDelta;
+    cDelta.Writeuint16(nThis);
+    cDelta.Writebool(pBaseline != LTNULL);
+    if (pBaseline)
+      cDelta.WriteBits(nAge, NETDELTA_SNAPSHOT_BITS);
+
+    CNetSnapshot *pSnapshot = serverRing.Begin(nThis);
+    for (uint32 i = 0; i < kActors; i++)
+    {
+      NetObjState cState;
+      nd_ClearState(&cState);
+      writeDelta(cDelta, sent[i], pBaseline ? pBaseline->Find(sent[i].nID) : LTNULL, &cState);
+      pSnapshot->Add(sent[i].nID, cState);
+    }
+    pSnapshot->Finish();
+    nDeltaBits += cDelta.Size();
+    if (pBaseline)
+      nDeltaFrames++;
+
+    if (unit(rng) < kLoss)
+    {
+      nLost++;
+      continue;
+    }
+
+    // same as OnUnguaranteedUpdatePacket
+    CPacket_Read cRead(cDelta);
+    uint16 nReadSequence = cRead.Readuint16();
+    const CNetSnapshot *pClientBaseline = LTNULL;
+    if (cRead.Readbool())
+    {
+      uint16 nReadAge = (uint16)cRead.ReadBits(NETDELTA_SNAPSHOT_BITS);
+      pClientBaseline = clientRing.Find((uint16)(nReadSequence - nReadAge));
+      if (!pClientBaseline)
+      {
+        nDropped++;
+        continue;
+      }
+    }
+
+    CNetSnapshot *pClientSnapshot = clientRing.Begin(nReadSequence);
+    for (uint32 i = 0; i < kActors; i++)
+    {
+      uint16 nID = cRead.Readuint16();
+      NetObjState cState;
+      nd_ClearState(&cState);
+      if (nID != sent[i].nID ||
+          !readDelta(cRead, sent[i], pClientBaseline ? pClientBaseline->Find(nID) : LTNULL, &cState))
+      {
+        nMismatches++;
+        break;
+      }
+      pClientSnapshot->Add(nID, cState);
+    }
+    pClientSnapshot->Finish();
+
+    acks.push_back(std::make_pair(nFrame + kAckLatency, nReadSequence));
+  }
+
+  double fFullBytes = nFullBits / 8.0 / kFrames;
+  double fDeltaBytes = nDeltaBits / 8.0 / kFrames;
+  std::cout << kFrames << " updates of " << kActors << " actors, " << nLost << " lost, "
+            << nDeltaFrames << " delta compressed, " << nDropped << " dropped for a missing baseline\n"
+            << "full: " << fFullBytes << " bytes/update\n"
+            << "delta: " << fDeltaBytes << " bytes/update (" << fDeltaBytes * 100.0 / fFullBytes << "%)\n";
+
+  if (nMismatches)
+  {
+    std::cout << "FAILED: " << nMismatches << " updates didn't decode to what was sent\n";
+    return 1;
+  }
+  return 0;
+}
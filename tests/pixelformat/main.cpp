@@ -0,0 +1,197 @@
+// pixel format conversion benchmark
+// fills random images in every format the format manager knows, converts them
+// to every format it can convert them to, and checks the SSE2 converters come
+// out byte for byte the same as the per-pixel ones. both are timed against
+// each other
+
+#include "bdefs.h"
+#include "pixelformat.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// whole DXT blocks, but not a multiple of 8 so the ends of the rows get tested
+static const uint32 kWidth = 252;
+static const uint32 kHeight = 128;
+static const uint32 kPasses = 5;
+
+struct Format
+{
+  const char *pName;
+  BPPIdent eType;
+  uint32 aMask, rMask, gMask, bMask;
+};
+
+static const Format g_Formats[] =
+{
+  { "8P", BPP_8P, 0, 0, 0, 0 },
+  { "332", BPP_8, 0, 0xE0, 0x1C, 0x03 },
+  { "565", BPP_16, 0, 0xF800, 0x07E0, 0x001F },
+  { "555", BPP_16, 0, 0x7C00, 0x03E0, 0x001F },
+  { "1555", BPP_16, 0x8000, 0x7C00, 0x03E0, 0x001F },
+  { "4444", BPP_16, 0xF000, 0x0F00, 0x00F0, 0x000F },
+  { "ARGB", BPP_32, 0xFF000000, 0x00FF0000, 0x0000FF00, 0x000000FF },
+  { "ABGR", BPP_32, 0xFF000000, 0x000000FF, 0x0000FF00, 0x00FF0000 },
+  { "XRGB", BPP_32, 0, 0x00FF0000, 0x0000FF00, 0x000000FF },
+  { "DXT1", BPP_S3TC_DXT1, 0, 0, 0, 0 },
+  { "DXT3", BPP_S3TC_DXT3, 0, 0, 0, 0 },
+  { "DXT5", BPP_S3TC_DXT5, 0, 0, 0, 0 },
+  { "32P", BPP_32P, 0, 0, 0, 0 },
+  { "24", BPP_24, 0, 0, 0, 0 },
+};
+static const uint32 kNumFormats = sizeof(g_Formats) / sizeof(g_Formats[0]);
+
+static uint32 blockBytes(BPPIdent eType)
+{
+  return (eType == BPP_S3TC_DXT1) ? 8 : 16;
+}
+
+static bool isDXT(BPPIdent eType)
+{
+  return eType == BPP_S3TC_DXT1 || eType == BPP_S3TC_DXT3 || eType == BPP_S3TC_DXT5;
+}
+
+static uint32 rowBytes(const Format &format)
+{
+  if (isDXT(format.eType))
+    return (kWidth / 4) * blockBytes(format.eType);
+  return kWidth * (format.eType == BPP_16 ? 2 : format.eType == BPP_32 ? 4 : format.eType == BPP_24 ? 3 : 1);
+}
+
+static uint32 imageBytes(const Format &format)
+{
+  if (isDXT(format.eType))
+    return rowBytes(format) * (kHeight / 4);
+  return rowBytes(format) * kHeight;
+}
+
+static double seconds(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main()
+{
+  std::mt19937 rng(1701);
+
+  FormatMgr formatMgr;
+
+  RPaletteColor palette[256];
+  for (uint32 i = 0; i < 256; i++)
+    palette[i].dword = rng();
+
+  std::vector<std::vector<uint8> > images(kNumFormats);
+  for (uint32 i = 0; i < kNumFormats; i++)
+  {
+    images[i].resize(imageBytes(g_Formats[i]));
+    for (uint32 j = 0; j < images[i].size(); j++)
+      images[i][j] = (uint8)rng();
+
+    // DXT blocks both ways round, so both the 4 and 3 color (and 8 and 6
+    // alpha) blocks are covered
+    if (isDXT(g_Formats[i].eType))
+    {
+      uint32 nBlockBytes = blockBytes(g_Formats[i].eType);
+      for (uint32 j = 0; j + nBlockBytes <= images[i].size(); j += nBlockBytes * 4)
+      {
+        std::swap(images[i][j + nBlockBytes - 8], images[i][j + nBlockBytes - 6]);
+        std::swap(images[i][j + nBlockBytes - 7], images[i][j + nBlockBytes - 5]);
+        if (g_Formats[i].eType == BPP_S3TC_DXT5)
+          std::swap(images[i][j], images[i][j + 1]);
+      }
+    }
+  }
+
+  // a few bytes past the end of each row that nothing should write to
+  uint32 nDestPad = 12;
+  std::vector<uint8> simdOut, scalarOut;
+
+  double fTotalSIMD = 0.0, fTotalScalar = 0.0;
+  uint32 nPairs = 0;
+  for (uint32 src = 0; src < kNumFormats; src++)
+  {
+    for (uint32 dest = 0; dest < kNumFormats; dest++)
+    {
+      const Format &srcFormat = g_Formats[src];
+      const Format &destFormat = g_Formats[dest];
+
+      FMConvertRequest request;
+      request.m_pSrcFormat->Init(srcFormat.eType, srcFormat.aMask, srcFormat.rMask, srcFormat.gMask, srcFormat.bMask);
+      request.m_pDestFormat->Init(destFormat.eType, destFormat.aMask, destFormat.rMask, destFormat.gMask, destFormat.bMask);
+      request.m_pSrc = &images[src][0];
+      request.m_SrcPitch = rowBytes(srcFormat);
+      request.m_pSrcPalette = palette;
+      request.m_DestPitch = rowBytes(destFormat) + nDestPad;
+      request.m_Width = kWidth;
+      request.m_Height = kHeight;
+
+      // DXT images only copy to themselves, all in one go
+      uint32 nDestBytes = request.m_DestPitch * kHeight;
+      if (isDXT(destFormat.eType))
+      {
+        if (src != dest)
+          continue;
+        nDestBytes = imageBytes(destFormat);
+      }
+
+      double fSIMD = 1e9, fScalar = 1e9;
+      LTRESULT simdResult = LT_OK, scalarResult = LT_OK;
+      for (uint32 pass = 0; pass < kPasses; pass++)
+      {
+        simdOut.assign(nDestBytes, 0xCD);
+        request.m_pDest = &simdOut[0];
+        formatMgr.m_bUseSIMD = true;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        simdResult = formatMgr.ConvertPixels(&request);
+        fSIMD = std::min(fSIMD, seconds(start));
+
+        scalarOut.assign(nDestBytes, 0xCD);
+        request.m_pDest = &scalarOut[0];
+        formatMgr.m_bUseSIMD = false;
+        start = std::chrono::steady_clock::now();
+        scalarResult = formatMgr.ConvertPixels(&request);
+        fScalar = std::min(fScalar, seconds(start));
+      }
+
+      if (simdResult != scalarResult)
+      {
+        std::cout << "FAILED: " << srcFormat.pName << " to " << destFormat.pName << " returned " << simdResult << ", expected " << scalarResult << "\n";
+        return 1;
+      }
+      if (scalarResult == LT_UNSUPPORTED)
+        continue;
+      if (scalarResult != LT_OK)
+      {
+        std::cout << "FAILED: " << srcFormat.pName << " to " << destFormat.pName << " returned " << scalarResult << "\n";
+        return 1;
+      }
+
+      if (simdOut != scalarOut)
+      {
+        uint32 nByte = 0;
+        while (simdOut[nByte] == scalarOut[nByte])
+          nByte++;
+        std::cout << "FAILED: " << srcFormat.pName << " to " << destFormat.pName << " differs at byte " << nByte
+          << " (row " << nByte / request.m_DestPitch << ", " << (uint32)simdOut[nByte] << " instead of " << (uint32)scalarOut[nByte] << ")\n";
+        return 1;
+      }
+
+      std::cout << "  " << srcFormat.pName << " to " << destFormat.pName << ": "
+        << fScalar * 1e9 / (kWidth * kHeight) << " ns/pixel, "
+        << fSIMD * 1e9 / (kWidth * kHeight) << " ns/pixel with SSE2 ("
+        << fScalar / fSIMD << "x)\n";
+
+      fTotalSIMD += fSIMD;
+      fTotalScalar += fScalar;
+      nPairs++;
+    }
+  }
+
+  std::cout << nPairs << " format pairs converted, " << fTotalScalar * 1000.0 << " ms per-pixel, "
+    << fTotalSIMD * 1000.0 << " ms with SSE2\n";
+
+  return 0;
+}
@@ -0,0 +1,574 @@
+// cpu only test for the streamed sound decoding in the OpenAL driver
+// encodes some long dialogue and music as IMA ADPCM, checks the table driven
+// and SIMD decoders against the original adpcm-xq decoder and reports how fast
+// each of them is. then plays a handful of the sounds through the decoded
+// chunk cache the way CSample::UpdateStream does, a frame at a time with the
+// decode thread running, and checks what gets queued against decoding the
+// whole sound up front, and how much decoded data is held while doing it
+
+#include "sounddecoder.h"
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+static const uint16 kStepTable[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31,
+    34, 37, 41, 45, 50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143,
+    157, 173, 190, 209, 230, 253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658,
+    724, 796, 876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024,
+    3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+static const int kIndexTable[] = { -1, -1, -1, -1, 2, 4, 6, 8 };
+
+// the decoder openal.cpp used to have, from adpcm-xq, to check the new ones against
+static int referenceDecodeBlock(int16_t *outbuf, const uint8_t *inbuf, size_t inbufsize, int channels)
+{
+  int ch, samples = 1, chunks;
+  int32_t pcmdata[2];
+  int8_t index[2];
+
+  if (inbufsize < (uint32_t) channels * 4)
+    return 0;
+
+  for (ch = 0; ch < channels; ch++) {
+    *outbuf++ = pcmdata[ch] = (int16_t) (inbuf [0] | (inbuf [1] << 8));
+    index[ch] = inbuf [2];
+
+    if (index [ch] < 0 || index [ch] > 88 || inbuf [3])
+      return 0;
+
+    inbufsize -= 4;
+    inbuf += 4;
+  }
+
+  chunks = inbufsize / (channels * 4);
+  samples += chunks * 8;
+
+  while (chunks--) {
+    int ch, i;
+
+    for (ch = 0; ch < channels; ++ch) {
+
+      for (i = 0; i < 4; ++i) {
+        int step = kStepTable [index [ch]], delta = step >> 3;
+
+        if (*inbuf & 1) delta += (step >> 2);
+        if (*inbuf & 2) delta += (step >> 1);
+        if (*inbuf & 4) delta += step;
+        if (*inbuf & 8) delta = -delta;
+
+        pcmdata[ch] += delta;
+        index[ch] += kIndexTable [*inbuf & 0x7];
+        if (index[ch] > 88) index[ch] = 88; else if (index[ch] < 0) index[ch] = 0;
+        if (pcmdata[ch] > 32767) pcmdata[ch] = 32767; else if (pcmdata[ch] < -32768) pcmdata[ch] = -32768;
+        outbuf [i * 2 * channels] = pcmdata[ch];
+
+        step = kStepTable [index [ch]], delta = step >> 3;
+
+        if (*inbuf & 0x10) delta += (step >> 2);
+        if (*inbuf & 0x20) delta += (step >> 1);
+        if (*inbuf & 0x40) delta += step;
+        if (*inbuf & 0x80) delta = -delta;
+
+        pcmdata[ch] += delta;
+        index[ch] += kIndexTable [(*inbuf >> 4) & 0x7];
+        if (index[ch] > 88) index[ch] = 88; else if (index[ch] < 0) index[ch] = 0;
+        if (pcmdata[ch] > 32767) pcmdata[ch] = 32767; else if (pcmdata[ch] < -32768) pcmdata[ch] = -32768;
+        outbuf [(i * 2 + 1) * channels] = pcmdata[ch];
+
+        inbuf++;
+      }
+
+      outbuf++;
+    }
+
+    outbuf += channels * 7;
+  }
+
+  return samples;
+}
+
+struct EncoderState
+{
+  int32 pcm;
+  int32 index;
+};
+
+static uint8 encodeSample(EncoderState& state, int32 sample)
+{
+  int32 step = kStepTable[state.index];
+  int32 diff = sample - state.pcm;
+  uint8 nibble = 0;
+  if (diff < 0)
+  {
+    nibble = 8;
+    diff = -diff;
+  }
+  for (int32 mask = 4, size = step; mask; mask >>= 1, size >>= 1)
+  {
+    if (diff >= size)
+    {
+      nibble |= mask;
+      diff -= size;
+    }
+  }
+
+  // track what the decoder will come up with
+  int32 delta = step >> 3;
+  if (nibble & 1) delta += step >> 2;
+  if (nibble & 2) delta += step >> 1;
+  if (nibble & 4) delta += step;
+  if (nibble & 8) delta = -delta;
+  state.pcm = std::min(std::max(state.pcm + delta, -32768), 32767);
+  state.index = std::min(std::max(state.index + kIndexTable[nibble & 7], 0), 88);
+  return nibble;
+}
+
+struct Sound
+{
+  const char* name;
+  WAVEFORMATEX format;
+  std::vector<uint8> data;
+  std::vector<int16> pcm;
+  uint32 factSamples;
+};
+
+// encodes interleaved samples as IMA ADPCM. The last block is cut short
+static void encode(Sound& sound, uint32 channels, uint32 rate, uint32 blockSize)
+{
+  uint32 samplesPerBlock = adpcm_samples_per_block(blockSize, channels);
+  uint32 numSamples = (uint32)(sound.pcm.size() / channels);
+  EncoderState state[2] = { { 0, 0 }, { 0, 0 } };
+
+  for (uint32 start = 0; start < numSamples; start += samplesPerBlock)
+  {
+    for (uint32 ch = 0; ch < channels; ch++)
+    {
+      state[ch].pcm = sound.pcm[start * channels + ch];
+      sound.data.push_back((uint8)(state[ch].pcm & 0xFF));
+      sound.data.push_back((uint8)((state[ch].pcm >> 8) & 0xFF));
+      sound.data.push_back((uint8)state[ch].index);
+      sound.data.push_back(0);
+    }
+
+    for (uint32 group = start + 1; group < start + samplesPerBlock && group < numSamples; group += 8)
+    {
+      for (uint32 ch = 0; ch < channels; ch++)
+      {
+        for (uint32 i = 0; i < 8; i += 2)
+        {
+          uint32 s = group + i;
+          int32 a = s < numSamples ? sound.pcm[s * channels + ch] : 0;
+          int32 b = s + 1 < numSamples ? sound.pcm[(s + 1) * channels + ch] : 0;
+          uint8 lo = encodeSample(state[ch], a);
+          uint8 hi = encodeSample(state[ch], b);
+          sound.data.push_back(lo | (hi << 4));
+        }
+      }
+    }
+  }
+
+  memset(&sound.format, 0, sizeof(sound.format));
+  sound.format.wFormatTag = WAVE_FORMAT_IMA_ADPCM;
+  sound.format.nChannels = channels;
+  sound.format.nSamplesPerSec = rate;
+  sound.format.nBlockAlign = blockSize;
+  sound.format.wBitsPerSample = 4;
+  sound.factSamples = numSamples;
+}
+
+static void makeDialogue(Sound& sound, uint32 seconds, std::mt19937& rng)
+{
+  const uint32 rate = 22050;
+  std::normal_distribution<float> noise(0.0f, 600.0f);
+  sound.pcm.resize(rate * seconds + 1234);
+  for (size_t i = 0; i < sound.pcm.size(); i++)
+  {
+    float t = (float)i / rate;
+    float pitch = 140.0f + 40.0f * sinf(t * 1.3f);
+    float envelope = 0.5f + 0.5f * sinf(t * 5.0f);
+    float v = envelope * (6000.0f * sinf(t * pitch * 6.2832f) + 2500.0f * sinf(t * pitch * 3.0f * 6.2832f)) + noise(rng);
+    sound.pcm[i] = (int16)std::min(std::max(v, -32768.0f), 32767.0f);
+  }
+  encode(sound, 1, rate, 512);
+}
+
+static void makeMusic(Sound& sound, uint32 seconds, std::mt19937& rng)
+{
+  const uint32 rate = 44100;
+  std::normal_distribution<float> noise(0.0f, 300.0f);
+  sound.pcm.resize((rate * seconds + 777) * 2);
+  for (size_t i = 0; i < sound.pcm.size() / 2; i++)
+  {
+    float t = (float)i / rate;
+    float bass = 9000.0f * sinf(t * 55.0f * 6.2832f);
+    float lead = 7000.0f * sinf(t * (440.0f + 220.0f * floorf(fmodf(t * 2.0f, 4.0f))) * 6.2832f);
+    sound.pcm[i * 2] = (int16)std::min(std::max(bass + lead + noise(rng), -32768.0f), 32767.0f);
+    sound.pcm[i * 2 + 1] = (int16)std::min(std::max(bass - lead * 0.5f + noise(rng), -32768.0f), 32767.0f);
+  }
+  encode(sound, 2, rate, 2048);
+}
+
+// decodes the whole sound with the reference decoder, trimmed to the fact length
+static std::vector<int16> referenceDecode(const Sound& sound)
+{
+  uint32 channels = sound.format.nChannels;
+  uint32 blockSize = sound.format.nBlockAlign;
+  std::vector<int16> out;
+  std::vector<int16> block(adpcm_samples_per_block(blockSize, channels) * channels);
+  for (size_t offset = 0; offset < sound.data.size(); offset += blockSize)
+  {
+    size_t size = std::min((size_t)blockSize, sound.data.size() - offset);
+    int samples = referenceDecodeBlock(&block[0], &sound.data[offset], size, channels);
+    out.insert(out.end(), block.begin(), block.begin() + samples * channels);
+  }
+  out.resize(sound.factSamples * channels);
+  return out;
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static bool checkDecoders(const std::vector<Sound>& sounds)
+{
+  for (size_t i = 0; i < sounds.size(); i++)
+  {
+    std::vector<int16> reference = referenceDecode(sounds[i]);
+
+    for (int simd = 0; simd < 2; simd++)
+    {
+      CADPCMDecoder decoder;
+      if (!decoder.Init(sounds[i].format, &sounds[i].data[0], (uint32)sounds[i].data.size(), sounds[i].factSamples, false))
+      {
+        std::cout << "FAILED: couldn't set up the decoder for " << sounds[i].name << "\n";
+        return false;
+      }
+      decoder.SetUseSIMD(simd != 0);
+
+      std::vector<uint8> decoded, chunk;
+      for (uint32 c = 0; decoder.DecodeChunk(c, chunk) && !chunk.empty(); c++)
+        decoded.insert(decoded.end(), chunk.begin(), chunk.end());
+
+      if (decoded.size() != reference.size() * 2 || decoder.GetDecodedSize() != decoded.size() ||
+          memcmp(&decoded[0], &reference[0], decoded.size()) != 0)
+      {
+        std::cout << "FAILED: " << sounds[i].name << (simd ? " SIMD" : " scalar") << " decode doesn't match the reference\n";
+        return false;
+      }
+    }
+
+    // the encoder is only so good, but the decoded sound should still be the sound
+    double error = 0.0;
+    for (size_t s = 0; s < reference.size(); s++)
+      error += fabs((double)reference[s] - sounds[i].pcm[s]);
+    error /= reference.size();
+    std::cout << sounds[i].name << ": " << sounds[i].data.size() / 1024 << " KB of ADPCM decodes to "
+              << reference.size() * 2 / 1024 << " KB, average error " << error << "\n";
+    if (error > 1000.0)
+    {
+      std::cout << "FAILED: " << sounds[i].name << " didn't survive encoding\n";
+      return false;
+    }
+  }
+  return true;
+}
+
+static void benchmarkDecoders(const std::vector<Sound>& sounds)
+{
+  for (size_t i = 0; i < sounds.size(); i++)
+  {
+    const Sound& sound = sounds[i];
+    uint32 channels = sound.format.nChannels;
+    uint32 blockSize = sound.format.nBlockAlign;
+    uint32 samplesPerBlock = adpcm_samples_per_block(blockSize, channels);
+    uint32 numBlocks = (uint32)(sound.data.size() / blockSize);
+    std::vector<int16> out((size_t)numBlocks * samplesPerBlock * channels);
+    double megabytes = out.size() * 2.0 / (1024.0 * 1024.0);
+    const int reps = 5;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int r = 0; r < reps; r++)
+      for (uint32 b = 0; b < numBlocks; b++)
+        referenceDecodeBlock(&out[(size_t)b * samplesPerBlock * channels], &sound.data[(size_t)b * blockSize], blockSize, channels);
+    double reference = secondsSince(start) / reps;
+
+    start = std::chrono::steady_clock::now();
+    for (int r = 0; r < reps; r++)
+      adpcm_decode_blocks(&out[0], &sound.data[0], numBlocks, blockSize, channels, false);
+    double table = secondsSince(start) / reps;
+
+    start = std::chrono::steady_clock::now();
+    for (int r = 0; r < reps; r++)
+      adpcm_decode_blocks(&out[0], &sound.data[0], numBlocks, blockSize, channels, true);
+    double simd = secondsSince(start) / reps;
+
+    std::cout << sound.name << " decode: adpcm-xq " << (int)(megabytes / reference) << " MB/s, table "
+              << (int)(megabytes / table) << " MB/s, " << (adpcm_has_simd() ? "SIMD " : "SIMD (not built) ")
+              << (int)(megabytes / simd) << " MB/s\n";
+  }
+}
+
+// what CSample keeps for a sound that's playing from the cache
+struct Player
+{
+  TSoundDecoderPtr decoder;
+  const std::vector<int16>* reference;
+  bool looping;
+  uint32 bytesPerFrame;
+  uint32 startFrame;
+
+  std::vector<std::pair<uint32, TDecodedChunk> > queue;
+  uint32 nextChunk;
+  uint32 playedInFront;
+  uint64 bytesPlayed;
+  bool ended;
+  bool mismatch;
+};
+
+static void queueBuffers(CDecodedSoundCache& cache, Player& player)
+{
+  while (player.queue.size() < SOUNDDECODE_NUM_BUFFERS && !player.ended)
+  {
+    TDecodedChunk chunk = cache.GetChunk(player.decoder, player.nextChunk);
+    if (!chunk)
+    {
+      player.mismatch = true;
+      player.ended = true;
+      break;
+    }
+    if (chunk->empty())
+    {
+      if (player.looping && player.nextChunk != 0)
+      {
+        player.nextChunk = 0;
+        continue;
+      }
+      player.ended = true;
+      break;
+    }
+
+    // everything queued has to be exactly what decoding it all up front gives
+    size_t offset = (size_t)player.nextChunk * player.decoder->GetChunkSize();
+    if (offset + chunk->size() > player.reference->size() * 2 ||
+        memcmp(&(*chunk)[0], (const uint8*)&(*player.reference)[0] + offset, chunk->size()) != 0)
+      player.mismatch = true;
+
+    player.queue.push_back(std::make_pair(player.nextChunk, chunk));
+    player.nextChunk++;
+  }
+
+  if (player.ended)
+    return;
+
+  uint32 next = player.nextChunk;
+  if (player.looping && (uint64)next * player.decoder->GetChunkSize() >= player.decoder->GetDecodedSize())
+    next = 0;
+  cache.Prefetch(player.decoder, next);
+  cache.Prefetch(player.decoder, next + 1);
+}
+
+static bool runPlayback(const std::vector<Sound>& sounds, const std::vector<std::vector<int16> >& references)
+{
+  // a small cache so the oldest chunks get thrown out while playing
+  const uint32 cacheSize = 2 * 1024 * 1024;
+  const uint32 frameMs = 16;
+  const uint32 numFrames = 40 * 1000 / frameMs;
+
+  CDecodedSoundCache cache;
+  cache.Init(cacheSize, true);
+
+  uint64 wholeSize = 0;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < sounds.size(); i++)
+  {
+    CADPCMDecoder decoder;
+    decoder.Init(sounds[i].format, &sounds[i].data[0], (uint32)sounds[i].data.size(), sounds[i].factSamples, false);
+    uint32 size;
+    char* pcm = decoder.DecodeAll(0xFFFFFFFF, size);
+    wholeSize += size;
+    delete [] pcm;
+  }
+  double wholeSeconds = secondsSince(start);
+
+  // each sound plays twice, the second one starting later, and the music loops
+  std::vector<Player> players;
+  for (size_t i = 0; i < sounds.size() * 2; i++)
+  {
+    const Sound& sound = sounds[i % sounds.size()];
+    std::shared_ptr<CADPCMDecoder> decoder(new CADPCMDecoder);
+    decoder->Init(sound.format, &sound.data[0], (uint32)sound.data.size(), sound.factSamples, false);
+
+    Player player;
+    player.decoder = decoder;
+    player.reference = &references[i % sounds.size()];
+    player.looping = sound.format.nChannels == 2;
+    player.bytesPerFrame = decoder->GetFormat().nAvgBytesPerSec * frameMs / 1000;
+    player.startFrame = (uint32)(i / sounds.size()) * 300;
+    player.nextChunk = 0;
+    player.playedInFront = 0;
+    player.bytesPlayed = 0;
+    player.ended = false;
+    player.mismatch = false;
+    players.push_back(player);
+  }
+
+  start = std::chrono::steady_clock::now();
+  double firstChunkSeconds = 0.0;
+  uint32 peakCached = 0;
+  for (uint32 frame = 0; frame < numFrames; frame++)
+  {
+    for (size_t i = 0; i < players.size(); i++)
+    {
+      Player& player = players[i];
+      if (frame < player.startFrame)
+        continue;
+
+      if (frame == player.startFrame)
+      {
+        std::chrono::steady_clock::time_point queueStart = std::chrono::steady_clock::now();
+        queueBuffers(cache, player);
+        firstChunkSeconds = std::max(firstChunkSeconds, secondsSince(queueStart));
+        continue;
+      }
+
+      // play a frame's worth, unqueueing the buffers that are done
+      uint32 toPlay = player.bytesPerFrame;
+      while (toPlay > 0 && !player.queue.empty())
+      {
+        uint32 left = (uint32)player.queue.front().second->size() - player.playedInFront;
+        uint32 played = std::min(left, toPlay);
+        toPlay -= played;
+        player.playedInFront += played;
+        player.bytesPlayed += played;
+        if (player.playedInFront == player.queue.front().second->size())
+        {
+          player.queue.erase(player.queue.begin());
+          player.playedInFront = 0;
+        }
+      }
+
+      queueBuffers(cache, player);
+    }
+
+    peakCached = std::max(peakCached, cache.GetStats().m_uiCachedSize);
+
+    // the frame takes a little while, which is when the decode thread gets ahead
+    std::this_thread::sleep_for(std::chrono::microseconds(500));
+  }
+  double playSeconds = secondsSince(start);
+
+  CDecodedSoundCache::SStats stats = cache.GetStats();
+  std::cout << "playback: " << players.size() << " sounds for " << numFrames * frameMs / 1000 << " seconds in "
+            << (int)(playSeconds * 1000) << " ms\n"
+            << "  decoding everything at load: " << wholeSize / 1024 << " KB in " << (int)(wholeSeconds * 1000) << " ms\n"
+            << "  streaming: at most " << peakCached / 1024 << " KB held, worst start " << (int)(firstChunkSeconds * 1000000)
+            << " us, " << stats.m_uiBytesDecoded / 1024 << " KB decoded at "
+            << (int)(stats.m_uiBytesDecoded / (1024.0 * 1024.0) / (stats.m_uiDecodeMicroseconds / 1000000.0)) << " MB/s\n"
+            << "  " << stats.m_uiChunksDecoded << " chunks decoded, " << stats.m_uiHits << " ready when needed, "
+            << stats.m_uiMisses << " decoded when needed, " << stats.m_uiEvictions << " evicted\n";
+
+  bool ok = true;
+  for (size_t i = 0; i < players.size(); i++)
+  {
+    // the frames after the first each play a frame's worth, unless the sound ran out
+    uint32 frames = numFrames - players[i].startFrame - 1;
+    uint64 expected = (uint64)frames * players[i].bytesPerFrame;
+    if (!players[i].looping)
+      expected = std::min(expected, (uint64)players[i].reference->size() * 2);
+
+    if (players[i].mismatch || players[i].bytesPlayed != expected)
+    {
+      std::cout << "FAILED: sound " << i << " played " << players[i].bytesPlayed << " bytes, expected " << expected
+                << (players[i].mismatch ? ", and didn't match" : "") << "\n";
+      ok = false;
+    }
+  }
+
+  // a chunk can go over the budget by itself, but no more than that
+  if (peakCached > cacheSize + SOUNDDECODE_CHUNK_SIZE)
+  {
+    std::cout << "FAILED: the cache went over its budget\n";
+    ok = false;
+  }
+
+  for (size_t i = 0; i < players.size(); i++)
+  {
+    cache.RemoveDecoder(players[i].decoder.get());
+    players[i].queue.clear();
+  }
+  if (cache.GetStats().m_uiCachedSize != 0)
+  {
+    std::cout << "FAILED: chunks were left in the cache\n";
+    ok = false;
+  }
+
+  cache.Term();
+  return ok;
+}
+
+static bool checkPCM()
+{
+  std::vector<int16> samples(100000);
+  for (size_t i = 0; i < samples.size(); i++)
+    samples[i] = (int16)(i * 37);
+
+  WAVEFORMATEX format;
+  memset(&format, 0, sizeof(format));
+  format.wFormatTag = WAVE_FORMAT_PCM;
+  format.nChannels = 2;
+  format.nSamplesPerSec = 44100;
+  format.nBlockAlign = 4;
+  format.wBitsPerSample = 16;
+
+  CPCMDecoder decoder;
+  if (!decoder.Init(format, &samples[0], (uint32)samples.size() * 2, true))
+    return false;
+
+  // it kept its own copy
+  std::vector<int16> original(samples);
+  samples.assign(samples.size(), 0);
+
+  std::vector<uint8> decoded, chunk;
+  for (uint32 c = 0; decoder.DecodeChunk(c, chunk) && !chunk.empty(); c++)
+    decoded.insert(decoded.end(), chunk.begin(), chunk.end());
+  return decoded.size() == original.size() * 2 && memcmp(&decoded[0], &original[0], decoded.size()) == 0;
+}
+
+int main()
+{
+  std::mt19937 rng(2024);
+
+  std::vector<Sound> sounds(3);
+  sounds[0].name = "dialogue";
+  makeDialogue(sounds[0], 90, rng);
+  sounds[1].name = "music";
+  makeMusic(sounds[1], 60, rng);
+  sounds[2].name = "short dialogue";
+  makeDialogue(sounds[2], 12, rng);
+
+  if (!checkDecoders(sounds))
+    return 1;
+
+  if (!checkPCM())
+  {
+    std::cout << "FAILED: PCM decoder\n";
+    return 1;
+  }
+
+  benchmarkDecoders(sounds);
+
+  std::vector<std::vector<int16> > references;
+  for (size_t i = 0; i < sounds.size(); i++)
+    references.push_back(referenceDecode(sounds[i]));
+
+  return runPlayback(sounds, references) ? 0 : 1;
+}
@@ -0,0 +1,309 @@
+// think wheel test
+// schedules objects at random delays, from less than a tick out to past the
+// top level of the wheel, and runs the clock forward with frames of random
+// length, including long jumps that cascade every level and wrap the top one.
+// objects think again, move and get unscheduled along the way, and halfway
+// through the wheel is saved and restored into a new one the way a saved
+// game does it. every object has to come due exactly once per schedule, in
+// the first frame that reaches its due time, in tick order
+
+#include "bdefs.h"
+#include "thinkwheel.h"
+
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+static const uint32 kObjects = 2000;
+static const uint32 kFrames = 20000;
+static const uint32 kChangesPerFrame = 4;
+static const double kTicksPerSecond = (double)(1 << CThinkWheel::k_nTickShift);
+
+// the range of each list in the wheel, in ticks
+static const double kLevelTicks[CThinkWheel::k_nLevels] = {
+  (double)((uint64)1 << (CThinkWheel::k_nLevelBits * 1)),
+  (double)((uint64)1 << (CThinkWheel::k_nLevelBits * 2)),
+  (double)((uint64)1 << (CThinkWheel::k_nLevelBits * 3)),
+  (double)((uint64)1 << (CThinkWheel::k_nLevelBits * 4)) };
+
+struct TestObj
+{
+  SThinkNode cNode;
+  bool bScheduled;
+  double fDueTime;		// same sum the wheel does
+  uint32 nScheduled;
+  uint32 nFired;
+};
+
+static std::mt19937 g_Rand(1234);
+
+static double randRange(double fMin, double fMax)
+{
+  return std::uniform_real_distribution<double>(fMin, fMax)(g_Rand);
+}
+
+// what the delays are counted against, so the test can tell it hit them all
+enum
+{
+  kSubTick,
+  kLevel0,
+  kLevel1,
+  kLevel2,
+  kLevel3,
+  kOverflow,
+  kNumKinds
+};
+
+static const char *g_KindNames[kNumKinds] = { "under a tick", "level 0", "level 1", "level 2", "level 3", "past the top level" };
+static uint32 g_KindCounts[kNumKinds];
+
+// spread out evenly over the log of the delay, so every level gets used
+static float randDelay()
+{
+  uint32 nKind = std::uniform_int_distribution<uint32>(0, kNumKinds - 1)(g_Rand);
+  double fMinTicks = (nKind == kSubTick) ? 0.05 : (nKind == kLevel0) ? 1.0 : kLevelTicks[nKind - kLevel1];
+  double fMaxTicks = (nKind == kSubTick) ? 1.0 : (nKind == kOverflow) ? kLevelTicks[CThinkWheel::k_nLevels - 1] * 3.0 : kLevelTicks[nKind - kLevel0];
+
+  ++g_KindCounts[nKind];
+  return (float)(std::exp(randRange(std::log(fMinTicks), std::log(fMaxTicks))) / kTicksPerSecond);
+}
+
+static void schedule(CThinkWheel &cWheel, double fTime, TestObj &obj, float fDelay)
+{
+  cWheel.Schedule(&obj.cNode, fDelay);
+  obj.bScheduled = true;
+  obj.fDueTime = fTime + (double)fDelay;
+  ++obj.nScheduled;
+}
+
+// frames mostly run at game rates, with the odd long stall or level load
+static float randFrameTime()
+{
+  double fRoll = randRange(0.0, 1.0);
+  if (fRoll < 0.02)
+    return (float)randRange(60.0, 3000.0);
+  if (fRoll < 0.05)
+    return (float)randRange(0.5, 30.0);
+  if (fRoll < 0.10)
+    return (float)randRange(0.0001, 0.002);   // partway into a tick
+  return (float)randRange(0.005, 0.05);
+}
+
+// advances the wheel and checks what came due against what should have
+static bool runFrame(CThinkWheel &cWheel, double &fTime, float fFrameTime, std::vector<TestObj> &objs, bool bThink)
+{
+  double fPrevTime = fTime;
+  fTime += (double)fFrameTime;
+
+  LTLink dueList;
+  dl_TieOff(&dueList);
+  cWheel.Advance(fFrameTime, &dueList);
+
+  std::vector<TestObj*> fired;
+  double fLastTick = 0.0;
+  while (dueList.m_pNext != &dueList)
+  {
+    LTLink *pLink = dueList.m_pNext;
+    TestObj *pObj = (TestObj*)pLink->m_pData;
+    dl_Remove(pLink);
+
+    if (!pObj->bScheduled)
+    {
+      std::cout << "FAILED: object " << (pObj - &objs[0]) << " came due when it wasn't scheduled\n";
+      return false;
+    }
+    if ((pObj->fDueTime > fTime) || (pObj->fDueTime <= fPrevTime))
+    {
+      std::cout << "FAILED: object " << (pObj - &objs[0]) << " due at " << pObj->fDueTime
+        << " came due in the frame from " << fPrevTime << " to " << fTime << "\n";
+      return false;
+    }
+
+    double fTick = std::floor(pObj->fDueTime * kTicksPerSecond);
+    if (fTick < fLastTick)
+    {
+      std::cout << "FAILED: object " << (pObj - &objs[0]) << " came due out of tick order\n";
+      return false;
+    }
+    fLastTick = fTick;
+
+    if (cWheel.IsScheduled(&pObj->cNode))
+    {
+      std::cout << "FAILED: object " << (pObj - &objs[0]) << " is still scheduled after coming due\n";
+      return false;
+    }
+
+    pObj->bScheduled = false;
+    ++pObj->nFired;
+    fired.push_back(pObj);
+  }
+
+  uint32 nScheduled = 0;
+  for (uint32 i = 0; i < objs.size(); i++)
+  {
+    if (!objs[i].bScheduled)
+      continue;
+
+    if (objs[i].fDueTime <= fTime)
+    {
+      std::cout << "FAILED: object " << i << " due at " << objs[i].fDueTime << " didn't come due by " << fTime << "\n";
+      return false;
+    }
+    ++nScheduled;
+  }
+
+  if (cWheel.GetNumScheduled() != nScheduled)
+  {
+    std::cout << "FAILED: the wheel has " << cWheel.GetNumScheduled() << " objects scheduled, should be " << nScheduled << "\n";
+    return false;
+  }
+
+  // most objects think again, like the server's do from OnUpdate
+  if (bThink)
+  {
+    for (uint32 i = 0; i < fired.size(); i++)
+    {
+      if (randRange(0.0, 1.0) < 0.8)
+        schedule(cWheel, fTime, *fired[i], randDelay());
+    }
+  }
+
+  return true;
+}
+
+// saves the time left on everything and schedules it in a new wheel,
+// the same as game_serialize does through sm_GetNextUpdate
+static bool saveAndRestore(CThinkWheel &cWheel, double fTime, CThinkWheel &cNewWheel, double &fNewTime, std::vector<TestObj> &objs)
+{
+  std::vector<float> timeLeft(objs.size(), 0.0f);
+  for (uint32 i = 0; i < objs.size(); i++)
+  {
+    if (!objs[i].bScheduled)
+      continue;
+
+    timeLeft[i] = LTMAX(cWheel.GetTimeLeft(&objs[i].cNode), 0.001f);
+
+    double fExpected = objs[i].fDueTime - fTime;
+    if (std::fabs(cWheel.GetTimeLeft(&objs[i].cNode) - fExpected) > 0.001 + (fExpected * 1e-6))
+    {
+      std::cout << "FAILED: object " << i << " has " << cWheel.GetTimeLeft(&objs[i].cNode) << " left, should be " << fExpected << "\n";
+      return false;
+    }
+
+    cWheel.Unschedule(&objs[i].cNode);
+    objs[i].bScheduled = false;
+  }
+
+  if (cWheel.GetNumScheduled() != 0)
+  {
+    std::cout << "FAILED: " << cWheel.GetNumScheduled() << " objects left in the old wheel\n";
+    return false;
+  }
+
+  for (uint32 i = 0; i < objs.size(); i++)
+  {
+    CThinkWheel::InitNode(&objs[i].cNode, &objs[i]);
+    if (timeLeft[i] > 0.0f)
+      schedule(cNewWheel, fNewTime, objs[i], timeLeft[i]);
+  }
+
+  return true;
+}
+
+static bool runWheel(CThinkWheel &cWheel, double &fTime, uint32 nFrames, std::vector<TestObj> &objs)
+{
+  for (uint32 nFrame = 0; nFrame < nFrames; nFrame++)
+  {
+    // objects get moved, turned off and turned back on between frames
+    for (uint32 i = 0; i < kChangesPerFrame; i++)
+    {
+      TestObj &obj = objs[std::uniform_int_distribution<uint32>(0, (uint32)objs.size() - 1)(g_Rand)];
+      if (obj.bScheduled && (randRange(0.0, 1.0) < 0.3))
+      {
+        cWheel.Unschedule(&obj.cNode);
+        obj.bScheduled = false;
+      }
+      else
+      {
+        schedule(cWheel, fTime, obj, randDelay());
+      }
+    }
+
+    if (!runFrame(cWheel, fTime, randFrameTime(), objs, true))
+      return false;
+  }
+
+  return true;
+}
+
+int main(int argc, char **argv)
+{
+  std::vector<TestObj> objs(kObjects);
+
+  CThinkWheel cWheel;
+  double fTime = 0.0;
+
+  for (uint32 i = 0; i < kObjects; i++)
+  {
+    CThinkWheel::InitNode(&objs[i].cNode, &objs[i]);
+    objs[i].bScheduled = false;
+    objs[i].fDueTime = 0.0;
+    objs[i].nScheduled = 0;
+    objs[i].nFired = 0;
+
+    schedule(cWheel, fTime, objs[i], randDelay());
+  }
+
+  if (!runWheel(cWheel, fTime, kFrames / 2, objs))
+    return 1;
+
+  std::cout << "saving at " << fTime << "s with " << cWheel.GetNumScheduled() << " objects scheduled\n";
+
+  // a restored game starts its own clock, which isn't where the old one was
+  CThinkWheel cRestored;
+  LTLink dueList;
+  dl_TieOff(&dueList);
+  cRestored.Advance(12.34f, &dueList);
+  double fRestoredTime = (double)12.34f;
+
+  if (!saveAndRestore(cWheel, fTime, cRestored, fRestoredTime, objs))
+    return 1;
+
+  if (!runWheel(cRestored, fRestoredTime, kFrames / 2, objs))
+    return 1;
+
+  // run everything that's left out
+  while (cRestored.GetNumScheduled() != 0)
+  {
+    if (!runFrame(cRestored, fRestoredTime, 600.0f, objs, false))
+      return 1;
+  }
+
+  uint32 nScheduled = 0, nFired = 0;
+  for (uint32 i = 0; i < kObjects; i++)
+  {
+    nScheduled += objs[i].nScheduled;
+    nFired += objs[i].nFired;
+  }
+
+  std::cout << nScheduled << " schedules, " << nFired << " came due, " << (fTime + fRestoredTime) << "s run\n";
+  for (uint32 i = 0; i < kNumKinds; i++)
+  {
+    std::cout << "  " << g_KindCounts[i] << " " << g_KindNames[i] << "\n";
+    if (g_KindCounts[i] == 0)
+    {
+      std::cout << "FAILED: no delays " << g_KindNames[i] << "\n";
+      return 1;
+    }
+  }
+
+  // both clocks together have to get past the top level a couple of times
+  if ((fTime + fRestoredTime) * kTicksPerSecond < kLevelTicks[CThinkWheel::k_nLevels - 1] * 2.0)
+  {
+    std::cout << "FAILED: the clock never wrapped the top level\n";
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,364 @@
+// world tree query benchmark
+// fills a quadtree the size of a big level with characters, props and a few
+// large objects that straddle nodes, then runs AI sensing style box queries
+// and projectile style segment queries from several threads at once. every
+// result is checked against a brute force search, and the throughput is
+// compared with running the same queries one at a time behind a lock, which
+// is what sharing the tree between threads took before
+
+#include "bdefs.h"
+#include "world_tree.h"
+#include "worldtreehelper.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+static const uint32 kLayoutDepth = 6;
+static const uint32 kObjects = 20000;
+static const uint32 kLargeObjects = 500;
+static const uint32 kQueries = 4096;
+static const uint32 kPasses = 4;
+static const uint32 kMaxThreads = 8;
+
+static const LTVector kWorldMin(-8192.0f, -1024.0f, -8192.0f);
+static const LTVector kWorldMax(8192.0f, 1024.0f, 8192.0f);
+
+class TestHelper : public WorldTreeHelper
+{
+public:
+  TestHelper() : m_nFrameCode(0) {}
+  virtual uint32 IncFrameCode() { return ++m_nFrameCode; }
+  virtual uint32 GetFrameCode() { return m_nFrameCode; }
+  uint32 m_nFrameCode;
+};
+
+class TestObj : public WorldTreeObj
+{
+public:
+  TestObj() : WorldTreeObj(WTObj_DObject), m_nIndex(0) {}
+  uint32 m_nIndex;
+};
+
+// just enough of a stream to hand the tree its node layout
+class LayoutStream : public ILTStream
+{
+public:
+  LayoutStream(const std::vector<uint8> &data) : m_Data(data), m_nPos(0), m_bError(false) {}
+
+  virtual void Release() {}
+  virtual LTRESULT Read(void *pData, uint32 size)
+  {
+    if (m_nPos + size > m_Data.size())
+    {
+      memset(pData, 0, size);
+      m_bError = true;
+      return LT_ERROR;
+    }
+    memcpy(pData, &m_Data[m_nPos], size);
+    m_nPos += size;
+    return LT_OK;
+  }
+  virtual LTRESULT ReadString(char *pStr, uint32 maxBytes) { return LT_ERROR; }
+  virtual LTRESULT ErrorStatus() { return m_bError ? LT_ERROR : LT_OK; }
+  virtual LTRESULT SeekTo(uint32 offset) { m_nPos = offset; return LT_OK; }
+  virtual LTRESULT GetPos(uint32 *offset) { *offset = m_nPos; return LT_OK; }
+  virtual LTRESULT GetLen(uint32 *len) { *len = (uint32)m_Data.size(); return LT_OK; }
+  virtual LTRESULT WriteStream(ILTStream &dsSource, uint32 dwMin, uint32 dwMax) { return LT_ERROR; }
+  virtual LTRESULT Write(const void *pData, uint32 size) { return LT_ERROR; }
+  virtual LTRESULT WriteString(const char *pStr) { return LT_ERROR; }
+
+private:
+  const std::vector<uint8> &m_Data;
+  uint32 m_nPos;
+  bool m_bError;
+};
+
+template<class T> static void append(std::vector<uint8> &data, const T &value)
+{
+  const uint8 *p = (const uint8*)&value;
+  data.insert(data.end(), p, p + sizeof(value));
+}
+
+// a full quadtree, written the way the world packer writes it: one bit per
+// node, depth first, set if the node is subdivided
+static std::vector<uint8> makeLayout(uint32 depth)
+{
+  std::vector<bool> bits;
+  std::vector<uint32> stack(1, 0);
+  while (!stack.empty())
+  {
+    uint32 level = stack.back();
+    stack.pop_back();
+    bits.push_back(level < depth);
+    if (level < depth)
+      for (uint32 i = 0; i < MAX_WTNODE_CHILDREN; i++)
+        stack.push_back(level + 1);
+  }
+
+  std::vector<uint8> data;
+  append(data, kWorldMin);
+  append(data, kWorldMax);
+  append(data, (uint32)bits.size());
+  append(data, (uint32)0);
+  for (size_t i = 0; i < bits.size(); i += 8)
+  {
+    uint8 byte = 0;
+    for (size_t bit = 0; bit < 8 && i + bit < bits.size(); bit++)
+      if (bits[i + bit])
+        byte |= 1 << bit;
+    data.push_back(byte);
+  }
+  return data;
+}
+
+struct BoxQuery
+{
+  LTVector vMin, vMax;
+};
+
+struct SegmentQuery
+{
+  LTVector vFrom, vTo;
+};
+
+typedef std::vector<std::vector<uint32> > Results;
+
+static void boxCallback(WorldTreeObj *pObj, void *pUser)
+{
+  ((std::vector<uint32>*)pUser)->push_back(((TestObj*)pObj)->m_nIndex);
+}
+
+static bool segmentCallback(WorldTreeObj *pObj, void *pUser)
+{
+  ((std::vector<uint32>*)pUser)->push_back(((TestObj*)pObj)->m_nIndex);
+  return false;
+}
+
+static bool boxesTouch(const LTVector &vMin1, const LTVector &vMax1, const LTVector &vMin2, const LTVector &vMax2)
+{
+  return !(vMin1.x > vMax2.x || vMin1.y > vMax2.y || vMin1.z > vMax2.z ||
+           vMax1.x < vMin2.x || vMax1.y < vMin2.y || vMax1.z < vMin2.z);
+}
+
+// whether the segment passes through the box in X and Z, which is as much as
+// the tree sorts by
+static bool segmentTouchesBoxXZ(const LTVector &vFrom, const LTVector &vTo, const LTVector &vMin, const LTVector &vMax)
+{
+  float t0 = 0.0f, t1 = 1.0f;
+  for (uint32 dim = 0; dim < 3; dim += 2)
+  {
+    float d = vTo[dim] - vFrom[dim];
+    if (fabsf(d) < 0.0001f)
+    {
+      if (vFrom[dim] < vMin[dim] || vFrom[dim] > vMax[dim])
+        return false;
+      continue;
+    }
+    float ta = (vMin[dim] - vFrom[dim]) / d;
+    float tb = (vMax[dim] - vFrom[dim]) / d;
+    t0 = std::max(t0, std::min(ta, tb));
+    t1 = std::min(t1, std::max(ta, tb));
+  }
+  // a little slack for the tree's own rounding at the node edges
+  return t0 <= t1 - 0.0001f;
+}
+
+static void runQueries(WorldTree &tree, const std::vector<BoxQuery> &boxes, const std::vector<SegmentQuery> &segments,
+                       uint32 first, uint32 count, Results &boxResults, Results &segmentResults, std::mutex *pLock)
+{
+  for (uint32 i = first; i < first + count; i++)
+  {
+    std::vector<uint32> &found = boxResults[i];
+    found.clear();
+    if (pLock)
+      pLock->lock();
+    tree.FindObjectsInBox(&boxes[i].vMin, &boxes[i].vMax, boxCallback, &found);
+    if (pLock)
+      pLock->unlock();
+    std::sort(found.begin(), found.end());
+
+    std::vector<uint32> &hit = segmentResults[i];
+    hit.clear();
+    if (pLock)
+      pLock->lock();
+    tree.IntersectSegment(&segments[i].vFrom, &segments[i].vTo, segmentCallback, &hit);
+    if (pLock)
+      pLock->unlock();
+    std::sort(hit.begin(), hit.end());
+  }
+}
+
+// runs all the queries split between the threads, a few times over, and
+// returns the queries done per second
+static double runThreads(WorldTree &tree, const std::vector<BoxQuery> &boxes, const std::vector<SegmentQuery> &segments,
+                         uint32 numThreads, bool bLocked, Results &boxResults, Results &segmentResults)
+{
+  std::mutex lock;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (uint32 pass = 0; pass < kPasses; pass++)
+  {
+    std::vector<std::thread> threads;
+    uint32 perThread = kQueries / numThreads;
+    for (uint32 t = 0; t < numThreads; t++)
+      threads.push_back(std::thread(runQueries, std::ref(tree), std::cref(boxes), std::cref(segments),
+                                    t * perThread, perThread, std::ref(boxResults), std::ref(segmentResults),
+                                    bLocked ? &lock : (std::mutex*)NULL));
+    for (size_t t = 0; t < threads.size(); t++)
+      threads[t].join();
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  return kPasses * kQueries * 2 / seconds;
+}
+
+static bool checkResults(const std::vector<TestObj> &objects, const std::vector<BoxQuery> &boxes,
+                         const std::vector<SegmentQuery> &segments, const Results &boxResults, const Results &segmentResults)
+{
+  for (uint32 i = 0; i < kQueries; i++)
+  {
+    std::vector<uint32> expected;
+    for (uint32 o = 0; o < objects.size(); o++)
+      if (boxesTouch(objects[o].GetBBoxMin(), objects[o].GetBBoxMax(), boxes[i].vMin, boxes[i].vMax))
+        expected.push_back(o);
+
+    if (boxResults[i] != expected)
+    {
+      std::cout << "FAILED: box query " << i << " found " << boxResults[i].size() << " objects, expected " << expected.size() << "\n";
+      return false;
+    }
+
+    // the segment query hands back everything on the nodes it crosses, so it
+    // has to have every object the segment goes through, and each only once
+    const std::vector<uint32> &hit = segmentResults[i];
+    if (std::adjacent_find(hit.begin(), hit.end()) != hit.end())
+    {
+      std::cout << "FAILED: segment query " << i << " reported an object twice\n";
+      return false;
+    }
+    for (uint32 o = 0; o < objects.size(); o++)
+    {
+      if (segmentTouchesBoxXZ(segments[i].vFrom, segments[i].vTo, objects[o].GetBBoxMin(), objects[o].GetBBoxMax()) &&
+          !std::binary_search(hit.begin(), hit.end(), o))
+      {
+        std::cout << "FAILED: segment query " << i << " missed object " << o << "\n";
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+static void placeObject(WorldTree &tree, TestObj &obj, std::mt19937 &rng)
+{
+  std::uniform_real_distribution<float> pos(-7500.0f, 7500.0f);
+  std::uniform_real_distribution<float> height(-900.0f, 800.0f);
+  LTVector vPos(pos(rng), height(rng), pos(rng));
+  LTVector vDims;
+  if (obj.m_nIndex < kLargeObjects)
+  {
+    // doors, vehicles and world models, big enough to sit across nodes
+    std::uniform_real_distribution<float> size(100.0f, 600.0f);
+    vDims.Init(size(rng), size(rng) * 0.5f, size(rng));
+  }
+  else
+  {
+    std::uniform_real_distribution<float> size(16.0f, 48.0f);
+    vDims.Init(size(rng), 64.0f, size(rng));
+  }
+  obj.UpdateBBox(vPos, vDims);
+  tree.InsertObject(&obj);
+}
+
+int main()
+{
+  std::mt19937 rng(77);
+
+  TestHelper helper;
+  WorldTree tree;
+  tree.InitWorldTree(&helper);
+
+  std::vector<uint8> layout = makeLayout(kLayoutDepth);
+  LayoutStream stream(layout);
+  if (!tree.LoadLayout(&stream))
+  {
+    std::cout << "FAILED: couldn't load the tree layout\n";
+    return 1;
+  }
+
+  std::vector<TestObj> objects(kObjects);
+  uint32 multiNode = 0;
+  for (uint32 i = 0; i < kObjects; i++)
+  {
+    objects[i].m_nIndex = i;
+    placeObject(tree, objects[i], rng);
+    if (!objects[i].IsInWorldTree())
+    {
+      std::cout << "FAILED: object " << i << " isn't in the tree after inserting it\n";
+      return 1;
+    }
+    if (objects[i].m_nNodeLinks > 1)
+      multiNode++;
+  }
+  std::cout << kObjects << " objects, " << multiNode << " of them on more than one node\n";
+
+  std::vector<BoxQuery> boxes(kQueries);
+  std::vector<SegmentQuery> segments(kQueries);
+  std::uniform_real_distribution<float> pos(-8192.0f, 8192.0f);
+  std::uniform_real_distribution<float> radius(256.0f, 1024.0f);
+  std::uniform_real_distribution<float> length(100.0f, 3000.0f);
+  std::uniform_real_distribution<float> angle(0.0f, 6.2832f);
+  for (uint32 i = 0; i < kQueries; i++)
+  {
+    LTVector vCenter(pos(rng), 0.0f, pos(rng));
+    float r = radius(rng);
+    boxes[i].vMin = vCenter - LTVector(r, 512.0f, r);
+    boxes[i].vMax = vCenter + LTVector(r, 512.0f, r);
+
+    float a = angle(rng), l = length(rng);
+    segments[i].vFrom.Init(pos(rng), 32.0f, pos(rng));
+    segments[i].vTo = segments[i].vFrom + LTVector(cosf(a) * l, -16.0f, sinf(a) * l);
+
+    // the tree doesn't look past the edge of the world
+    segments[i].vTo.x = LTCLAMP(segments[i].vTo.x, kWorldMin.x, kWorldMax.x);
+    segments[i].vTo.z = LTCLAMP(segments[i].vTo.z, kWorldMin.z, kWorldMax.z);
+  }
+
+  Results boxResults(kQueries), segmentResults(kQueries);
+
+  bool ok = true;
+  for (uint32 round = 0; round < 2 && ok; round++)
+  {
+    if (round == 1)
+    {
+      // move a tenth of everything around, with nothing querying
+      for (uint32 i = 0; i < kObjects; i += 10)
+        placeObject(tree, objects[i], rng);
+      objects[5].RemoveFromWorldTree();
+      if (objects[5].IsInWorldTree() || objects[5].m_nNodeLinks != 0)
+      {
+        std::cout << "FAILED: object is still in the tree after removing it\n";
+        return 1;
+      }
+      placeObject(tree, objects[5], rng);
+      std::cout << "after moving objects:\n";
+    }
+
+    double locked = runThreads(tree, boxes, segments, kMaxThreads, true, boxResults, segmentResults);
+    ok = checkResults(objects, boxes, segments, boxResults, segmentResults);
+    std::cout << "  " << kMaxThreads << " threads taking turns: " << (int)locked << " queries/s\n";
+
+    for (uint32 numThreads = 1; numThreads <= kMaxThreads && ok; numThreads *= 2)
+    {
+      double rate = runThreads(tree, boxes, segments, numThreads, false, boxResults, segmentResults);
+      ok = checkResults(objects, boxes, segments, boxResults, segmentResults);
+      std::cout << "  " << numThreads << (numThreads == 1 ? " thread" : " threads") << " at once: " << (int)rate << " queries/s\n";
+    }
+  }
+
+  std::cout << "(" << std::thread::hardware_concurrency() << " hardware threads)\n";
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,216 @@
+//------------------------------------------------------------------
+//
+//  FILE      : main.cpp
+//
+//  PURPOSE   :	Converts the world models in a processed world (.dat)
+//				into the compiled format the engine can load with a
+//				single read per world model.  See world_bsp_blob.h.
+//
+//------------------------------------------------------------------
+
+#include "bdefs.h"
+
+#include "de_world.h"
+#include "world_shared_bsp.h"
+#include "world_bsp_blob.h"
+#include "streamsim.h"
+
+#include <stdio.h>
+#include <vector>
+
+
+// Offsets into the world header.
+#define HEADER_OBJECTDATAPOS	(sizeof(uint32) * 1)
+#define HEADER_BSPBLOBPOS		(sizeof(uint32) * 9)
+#define HEADER_SIZE				(sizeof(uint32) * 15)
+
+
+// The engine's memory manager reports allocation failures through this.
+void dsi_OnMemoryFailure()
+{
+	printf("Out of memory\n");
+}
+
+static void printUsage()
+{
+	printf("usage: WorldBlob <world.dat> [output.dat]\n");
+	printf("  Appends the compiled world models to the world.  The output\n");
+	printf("  defaults to overwriting the input.  Converting a world again\n");
+	printf("  replaces its compiled world models.\n");
+}
+
+static bool readFile(const char *pFilename, std::vector<uint8> &data)
+{
+	FILE *fp = fopen(pFilename, "rb");
+	if (!fp)
+		return false;
+
+	fseek(fp, 0, SEEK_END);
+	long nSize = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+
+	data.resize(nSize);
+	bool bOk = (nSize == 0) || (fread(&data[0], nSize, 1, fp) == 1);
+
+	fclose(fp);
+	return bOk;
+}
+
+static uint32 readUint32(const std::vector<uint8> &data, uint32 nPos)
+{
+	uint32 nVal = 0;
+	if (nPos + sizeof(nVal) <= data.size())
+		memcpy(&nVal, &data[nPos], sizeof(nVal));
+	return nVal;
+}
+
+// Find the start of the world models.  This is just past the info string,
+// the world extents and the world tree layout.
+static bool findWorldModels(const std::vector<uint8> &data, uint32 &nPos)
+{
+	nPos = HEADER_SIZE;
+
+	// Info string.
+	nPos += sizeof(uint32) + readUint32(data, nPos);
+
+	// Extents and the offset to the source world.
+	nPos += sizeof(LTVector) * 3;
+
+	// World tree bounding box, node count and terrain depth, followed by a
+	// bit for every node saying whether it's subdivided.
+	nPos += sizeof(LTVector) * 2;
+	uint32 nTreeNodes = readUint32(data, nPos);
+	nPos += sizeof(uint32) * 2;
+	nPos += (nTreeNodes + 7) / 8;
+
+	return nPos <= data.size();
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 2 || argc > 3)
+	{
+		printUsage();
+		return 1;
+	}
+
+	const char *pInFile = argv[1];
+	const char *pOutFile = (argc > 2) ? argv[2] : argv[1];
+
+	std::vector<uint8> data;
+	if (!readFile(pInFile, data) || data.size() < HEADER_SIZE)
+	{
+		printf("Unable to read %s\n", pInFile);
+		return 1;
+	}
+
+	if (readUint32(data, 0) != CURRENT_WORLD_VERSION)
+	{
+		printf("%s is version %d, expected %d.  Try reprocessing it.\n",
+			pInFile, readUint32(data, 0), CURRENT_WORLD_VERSION);
+		return 1;
+	}
+
+	// Drop the compiled world models from an earlier conversion.
+	uint32 nOldBlobPos = readUint32(data, HEADER_BSPBLOBPOS);
+	if (nOldBlobPos != 0 && nOldBlobPos <= data.size())
+	{
+		data.resize(nOldBlobPos);
+	}
+
+	uint32 nWorldModelPos;
+	if (!findWorldModels(data, nWorldModelPos))
+	{
+		printf("%s is corrupt\n", pInFile);
+		return 1;
+	}
+
+	// Load all the world models the normal way.
+	ILTStream *pInStream = streamsim_Open(pInFile, "rb");
+	if (!pInStream)
+	{
+		printf("Unable to open %s\n", pInFile);
+		return 1;
+	}
+
+	pInStream->SeekTo(nWorldModelPos);
+
+	uint32 nWorldModels;
+	*pInStream >> nWorldModels;
+
+	std::vector<WorldBsp*> bsps;
+	bool bLoaded = true;
+	for (uint32 i = 0; i < nWorldModels; i++)
+	{
+		uint32 nDummy;
+		*pInStream >> nDummy;
+
+		WorldBsp *pBsp = new WorldBsp;
+		bsps.push_back(pBsp);
+
+		if (pBsp->Load(pInStream, true) != LoadWorld_Ok)
+		{
+			printf("Unable to load world model %d from %s\n", i, pInFile);
+			bLoaded = false;
+			break;
+		}
+	}
+
+	// The world models should end where the objects start.
+	if (bLoaded && pInStream->GetPos() != readUint32(data, HEADER_OBJECTDATAPOS))
+	{
+		printf("%s is corrupt\n", pInFile);
+		bLoaded = false;
+	}
+
+	pInStream->Release();
+
+	// Write the original world followed by the compiled world models.
+	ILTStream *pOutStream = LTNULL;
+	if (bLoaded)
+	{
+		uint32 nBlobPos = (uint32)data.size();
+		memcpy(&data[HEADER_BSPBLOBPOS], &nBlobPos, sizeof(nBlobPos));
+
+		pOutStream = streamsim_Open(pOutFile, "wb");
+		if (!pOutStream)
+		{
+			printf("Unable to open %s for writing\n", pOutFile);
+			bLoaded = false;
+		}
+	}
+
+	if (bLoaded)
+	{
+		pOutStream->Write(&data[0], (uint32)data.size());
+
+		SWorldBspBlobSection section;
+		section.Init(nWorldModels);
+		pOutStream->Write(&section, sizeof(section));
+
+		for (uint32 i = 0; i < nWorldModels; i++)
+		{
+			if (!bsps[i]->SaveBlob(pOutStream))
+			{
+				printf("Unable to write %s\n", pOutFile);
+				bLoaded = false;
+				break;
+			}
+		}
+
+		if (bLoaded)
+		{
+			printf("%s: compiled %d world models (%d bytes)\n", pOutFile, nWorldModels,
+				pOutStream->GetPos() - (uint32)data.size());
+		}
+
+		pOutStream->Release();
+	}
+
+	for (uint32 i = 0; i < bsps.size(); i++)
+	{
+		delete bsps[i];
+	}
+
+	return bLoaded ? 0 : 1;
+}